@@ -13,19 +13,70 @@
 // =============================================================================
 
 // Preprocessor define dla symulacji OBD
-#define OBD_SIMULATION_MODE 0                                       // 1 = symulacja, 0 = rzeczywiste OBD
+#define OBD_SIMULATION_MODE 0                                       // 1 = emulator ELM327 zamiast Bluetooth, 0 = rzeczywiste OBD
 
 namespace OBD_CONFIG {
     constexpr const char* DEVICE_NAME = "V-LINK";                   // Nazwa modułu Bluetooth OBD-II
     constexpr const char* DEVICE_MAC_STR = "10:21:3e:4e:e5:84";     // Adres MAC modułu Bluetooth OBD-II
+
+    // Harmonogram odpytywania (obd_scheduler.h): okres, termin nieaktualności [ms], priorytet 1-10
+    constexpr int MAF_PERIOD_MS = 500;          // Spalanie - dominuje w taryfie za litr
+    constexpr int MAF_STALE_MS = 2000;
+    constexpr int MAF_PRIORITY = 8;
+    constexpr int SPEED_PERIOD_MS = 500;        // Prędkość - całkowanie dystansu (razem z MAF)
+    constexpr int SPEED_STALE_MS = 2000;
+    constexpr int SPEED_PRIORITY = 5;
+    constexpr int ODO_PERIOD_MS = 10000;        // Odometr - rozdzielczość 1 km, zmienia się wolno
+    constexpr int ODO_STALE_MS = 60000;
+    constexpr int ODO_PRIORITY = 2;
+    constexpr int LINK_UTIL_PCT = 80;           // Maksymalna zajętość łącza ELM327 [%]
+    constexpr int BATCH_REJECTS = 3;            // Kolejne odpowiedzi NO DATA na zapytanie zbiorcze -> pojedyncze PID
+    constexpr int IDLE_POLL_MS = 250;           // Maksymalne uśpienie taska między terminami
+    constexpr int REQUEST_QUEUE_LEN = 8;        // Kolejka żądań do taska OBD (ekrany)
+    constexpr int WATCH_MS = 3000;              // Podtrzymanie odpytywania przez ekran diagnostyki
+    constexpr int FUEL_GAP_MS = 1500;           // Przerwa w próbkach spalania mostkowana liniowo (fuel_accumulator.h)
+    constexpr int FUEL_MAX_GAP_MS = 10000;      // Dłuższa przerwa nie jest całkowana (np. utrata łącza)
+
+    // Fuzja OBD / GPS (distance_fusion.h): niepewności pomiarów, dystans do rozliczenia
+    constexpr int FUSION_ACCEL_MMS2 = 1500;     // Szum procesu - odchylenie przyspieszenia [mm/s^2]
+    constexpr int FUSION_OBD_SPEED_MMS = 400;   // Prędkość OBD (kwantyzacja 1 km/h, opóźnienie) [mm/s]
+    constexpr int FUSION_GPS_SPEED_MMS = 300;   // Prędkość Dopplera przy HDOP <= 1 [mm/s]
+    constexpr int FUSION_GPS_POSITION_MM = 10000;   // Dystans z pozycji przy HDOP <= 1 [mm]
+    constexpr int FUSION_GPS_WINDOW_M = 200;    // Przesunięcie odniesienia dystansu z pozycji co [m]
+    constexpr int FUSION_ODO_TICK_MM = 20000;   // Położenie granicy km odometru [mm]
+    constexpr int FUSION_SCALE_SIGMA_PPM = 50000;   // Początkowa niepewność skali prędkości OBD [ppm]
+    constexpr int FUSION_SCALE_DRIFT_PPM = 100; // Dryf skali OBD [ppm/sqrt(s)]
+    constexpr int FUSION_GATE_SIGMA = 5;        // Pomiar GPS dalej niż tyle odchyleń - odrzucony
+    constexpr int FUSION_BLIND_MS = 5000;       // Bez pomiaru prędkości / pozycji dłużej - bez całkowania
+    constexpr int FUSION_BUDGET_CYCLES = 4000;  // Budżet cykli CPU na aktualizację filtru (log przekroczeń)
+
+    // Połączenie w tle (obd_connection.h): przerwa między próbami x2 po każdym błędzie
+    constexpr int RECONNECT_MIN_MS = 1000;      // Pierwsza przerwa po nieudanej próbie
+    constexpr int RECONNECT_MAX_MS = 30000;     // Maksymalna przerwa między próbami
+    constexpr int DEGRADED_TIMEOUTS = 3;        // Kolejne zapytania bez odpowiedzi -> DEGRADED
+    constexpr int LINK_LOST_TIMEOUTS = 8;       // Kolejne zapytania bez odpowiedzi -> ponowne łączenie
+
+    // Nasłuch ramek rozgłoszeniowych (can_monitor.h, linie "can" profilu pojazdu): prędkość i odometr bez odpytywania
+    constexpr bool MONITOR_MODE = false;        // true = ATMA w wolnym czasie łącza, false = tylko odpytywanie
+    constexpr int MONITOR_MIN_WINDOW_MS = 200;  // Krótsza przerwa między zapytaniami - bez nasłuchu
+    constexpr int MONITOR_MAX_WINDOW_MS = 1000; // Maksymalne okno nasłuchu (żądania ekranów czekają)
+    constexpr int MONITOR_PROBE_MS = 3000;      // Nasłuch bez ramek sygnałów -> powrót do odpytywania
+
+    // Emulator ELM327 w trybie symulacji (elm327_emulator.h, skrypt domyślny)
+    constexpr int SIM_LATENCY_MS = 60;          // Bazowy czas odpowiedzi ECU
+    constexpr int SIM_JITTER_MS = 40;           // Losowy rozrzut czasu odpowiedzi
+    constexpr int SIM_NOISE_PCT = 5;            // Szum wartości PID (+/- %)
+    constexpr int SIM_NO_DATA_PCT = 2;          // Odpowiedzi "NO DATA" [%]
+    constexpr int SIM_DROP_PCT = 0;             // Odpowiedzi utracone [%]
+    constexpr int SIM_CAN_SPEED_MS = 20;        // Okres ramki z prędkością (nasłuch ATMA)
+    constexpr int SIM_CAN_ODO_MS = 1000;        // Okres ramki z odometrem
 }
 
-// PID definicje dla Volvo V40 2014+
-namespace CarPID {
-    constexpr const char* ODOMETER = "22DD01";                      // Odometer PID 
-    constexpr const char* ODOMETER_RESP_PREFIX = "62DD01";          // Odpowiedź odometru
-    constexpr const char* MAF = "0110";                             // Mass Air Flow (backup dla paliwa)
-    constexpr const char* MAF_RESP_PREFIX = "4110";                 // Odpowiedź MAF
+// Profil pojazdu (vehicle_profile.h): odometr producenta, ramki CAN, paliwo, silnik
+// Brak pliku = profil wbudowany VehicleProfile::BUILTIN (Volvo V40 2014+)
+namespace VEHICLE {
+    constexpr const char* FILE_PATH = "/vehicle.txt";       // Profil pojazdu na karcie SD
+    constexpr int FILE_MAX_BYTES = 2048;                    // Maksymalny rozmiar pliku profilu
 }
 
 
@@ -35,19 +86,111 @@ namespace CarPID {
 namespace GPS {
     constexpr int PIN_RX = 26;          // Pin RX dla GPS
     constexpr int PIN_TX = 25;          // Pin TX dla GPS
-    constexpr int BAUD_RATE = 9600;     // Prędkość UART
-    constexpr int SAMPLE_MS = 1000;     // Częstotliwość próbkowania
+    constexpr int PIN_PPS = -1;         // Pin impulsu PPS modułu (-1 = niepodłączony, czas tylko z NMEA)
+    constexpr int BAUD_RATE = 9600;     // Prędkość UART modułu po włączeniu zasilania
+    constexpr int SAMPLE_MS = 1000;     // Częstotliwość próbkowania (zapis trasy)
+
+    // Konfiguracja modułu przy starcie (gps_setup.h, UBX) i start z ostatnią pozycją
+    constexpr int CONFIG_BAUD = 115200;         // Prędkość UART po konfiguracji
+    constexpr int FIX_RATE_MS = 200;            // Okres epok pozycji (5 Hz; M8: do 100 = 10 Hz)
+    constexpr int CONFIG_ACK_MS = 300;          // Oczekiwanie na UBX-ACK
+    constexpr int AIDING_POS_ACC_M = 2000;      // Niepewność zapisanej pozycji (auto mogło odjechać)
+    constexpr int AIDING_SAVE_MS = 120000;      // Zapis pozycji do flash nie częściej niż co
+    constexpr int AIDING_MIN_MOVE_M = 200;      // Zapis tylko po przesunięciu o co najmniej
+    constexpr int RATE_WINDOW_MS = 5000;        // Okno pomiaru częstotliwości epok
+
+    // Task GPS sterowany zdarzeniami UART (gps_reader.cpp)
+    constexpr int RX_BUFFER_BYTES = 2048;   // Bufor RX sterownika UART (~2 s NMEA przy 5 Hz)
+    constexpr int RX_FIFO_FULL = 64;        // Zdarzenie odbioru co tyle bajtów w FIFO
+    constexpr int RX_TIMEOUT_SYMBOLS = 4;   // Zdarzenie po przerwie (koniec paczki zdań) [znaki]
+    constexpr int IDLE_WAKE_MS = 1000;      // Maksymalny czas uśpienia taska bez zdarzeń
+    constexpr int FIX_STALE_MS = 2000;      // Fix starszy = nieważny
+    constexpr int STATUS_LOG_MS = 10000;    // Co ile ms status GPS trafia na Serial
+    constexpr int MAX_LISTENERS = 4;        // Taski powiadamiane o nowym Fix
+    constexpr int TASK_PRIORITY = 3;        // Priorytet taska GPS (krótka praca, nad OBD)
+
+    // Dystans z pozycji (gps_odometer.h): kontrola dystansu OBD i zastępstwo w przerwach łącza
+    constexpr int ODO_MAX_HDOP = 300;           // Maks. HDOP x100 fixu liczonego do dystansu
+    constexpr int ODO_MIN_SATS = 5;             // Min. liczba satelitów
+    constexpr int ODO_STATIONARY_MMS = 700;     // Prędkość Dopplera poniżej = postój [mm/s]
+    constexpr int ODO_DRIFT_MIN_MM = 10000;     // Promień szumu pozycji przy HDOP <= 1 [mm]
+    constexpr int ODO_MAX_SPEED_MMS = 70000;    // Maks. prędkość wynikająca z odcinka [mm/s]
+    constexpr int ODO_JUMP_MARGIN_MMS = 5000;   // Margines skoku ponad prędkość bieżącą [mm/s]
+    constexpr int ODO_DOPPLER_WINDOW_MS = 3000; // Dłuższa przerwa w odbiorze - tylko test prędkości maks.
+    constexpr int ODO_MAX_OUTLIERS = 3;         // Odrzucone skoki z rzędu -> przeniesienie kotwicy
+    constexpr int ODO_CHECK_MIN_M = 500;        // Min. dystans OBD do podania rozbieżności OBD/GPS
 }  // namespace GPS
 
 
+// =============================================================================
+// CZAS UTC KONFIGURACJA (timebase.h)
+// =============================================================================
+namespace TIMEBASE {
+    constexpr int NMEA_LATENCY_MS = 40;     // Początek paczki zdań po epoce (pomiar przy PPS: Timebase::Stats::nmeaLagUs)
+    constexpr int NMEA_ACC_MS = 50;         // Niepewność chwili epoki ze zdań NMEA
+    constexpr int PPS_ACC_US = 50;          // Niepewność chwili impulsu PPS (opóźnienie przerwania)
+    constexpr int SYSTEM_ACC_MS = 2000;     // Niepewność zegara systemowego po restarcie ESP32
+    constexpr int BURST_GAP_MS = 20;        // Przerwa w odbiorze NMEA = nowa paczka zdań (epoka)
+    constexpr int WINDOW_S = 600;           // Stała czasowa zapominania odniesień NMEA
+    constexpr int PPS_WINDOW_S = 60;        // Stała czasowa przy PPS (wahania dryfu z temperaturą)
+    constexpr int MIN_SPAN_S = 60;          // Min. rozpiętość odniesień do wyznaczenia dryfu kwarcu
+    constexpr int MAX_PPM = 200;            // Ograniczenie dryfu
+    constexpr int STEP_MS = 1000;           // Różnica od modelu = skok czasu (nowy model)
+    constexpr int HOLDOVER_MS = 3000;       // Bez odniesienia dłużej = czas z modelu (holdover)
+    constexpr int CLOCK_SYNC_MS = 100;      // Zegar systemowy ustawiany przy rozbieżności ponad
+}  // namespace TIMEBASE
+
+
 // =============================================================================
 // SD CARD KONFIGURACJA (SPI)
 // =============================================================================
+
+// Preprocessor define dla formatu logów trasy
+#define SD_LOG_BINARY_FORMAT 0                                      // 1 = binarne gps_log.bin/obd_log.bin, 0 = CSV
+
 namespace SDCARD {
     constexpr int PIN_CLK = 27;             // SCK (Serial Clock)
     constexpr int PIN_MOSI_DATA = 14;       // MOSI (Master Out, Slave In)
     constexpr int PIN_MISO_DATA = 12;       // MISO (Master In, Slave Out)
     constexpr int PIN_CS_SD = 13;           // CS (Chip Select)
+
+    // Asynchroniczny logger tras (trip_logger.cpp)
+    constexpr int LOG_QUEUE_LEN = 64;       // Pojemność bufora rekordów w RAM
+    constexpr int LOG_CONTROL_SLOTS = 4;    // Miejsca w buforze tylko dla sesji/podsumowania (próbki ich nie zajmą)
+    constexpr int LOG_CONTROL_WAIT_MS = 500; // Maks. czekanie na miejsce dla rekordu sesji/podsumowania
+    constexpr int LOG_BATCH_BYTES = 512;    // Rozmiar paczki zapisu (1 sektor SD)
+    constexpr int LOG_SYNC_MS = 5000;       // Co ile ms pliki są synchronizowane (flush)
+    constexpr int LOG_IDLE_WAKE_MS = 1000;  // Maksymalny czas uśpienia taska zapisu
+    constexpr int LOG_TASK_PRIORITY = 1;    // Priorytet taska zapisu (najniższy użytkowy)
+
+    // Upraszczanie śladu GPS przed zapisem gps_log (track_simplifier.h)
+    constexpr bool TRACK_SIMPLIFY = true;       // false = każda próbka GPS::SAMPLE_MS
+    constexpr int TRACK_TOLERANCE_MM = 10000;   // Maks. błąd odtworzenia pozycji w dowolnej chwili [mm]
+    constexpr int TRACK_MAX_GAP_MS = 120000;    // Punkt co najmniej co tyle ms (postój, nieważny fix)
+
+    // Przechwytywanie surowego ruchu ELM327 / NMEA (link_capture.cpp)
+    constexpr bool CAPTURE_MODE = false;        // true = link_capture.bin w każdym folderze trasy
+    constexpr int CAPTURE_BUFFER_BYTES = 16384; // Bufor bajtów w RAM (potęga 2)
+    constexpr int CAPTURE_CHUNK_MAX = 256;      // Maksymalny fragment jednego zapisu [B]
 }  // namespace SDCARD
 
+
+// =============================================================================
+// PAMIĘĆ USTAWIEŃ (FLASH) KONFIGURACJA
+// =============================================================================
+namespace STORAGE {
+    constexpr const char* PARTITION_LABEL = "cabstore";     // Partycja magazynu rekordów (partitions.csv)
+    constexpr int LEGACY_EEPROM_SIZE = 100;                 // Rozmiar starego obszaru EEPROM (migracja)
+}  // namespace STORAGE
+
+
+// =============================================================================
+// TARYFA KONFIGURACJA
+// =============================================================================
+namespace TARIFF {
+    constexpr const char* FILE_PATH = "/tariff.txt";        // Opis taryfy wieloskładnikowej na karcie SD
+    constexpr int FILE_MAX_BYTES = 2048;                    // Maksymalny rozmiar pliku taryfy
+    constexpr const char* TIME_ZONE = "CET-1CEST,M3.5.0,M10.5.0/3"; // Strefa czasu mnożników dni/godzin i świąt (POSIX TZ)
+}  // namespace TARIFF
+
 #endif
@@ -0,0 +1,157 @@
+/**
+ * @file can_monitor.h
+ * @brief Nasłuch ramek rozgłoszeniowych CAN (ELM327 ATMA) - parser strumieniowy
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Prędkość i odometr są nadawane cyklicznie na magistrali przez moduły
+ * pojazdu, więc zamiast odpytywać ECU (010D, 22DD01) można je odczytać
+ * z ruchu na magistrali. ELM327 w trybie nasłuchu (ATMA) wypisuje każdą
+ * ramkę jako linię tekstu:
+ * ```
+ * 1A0 0A 28 00 00 00 00 00 00      (ATS1, ATH1)
+ * 1A00A28000000000000              (ATS0, ATH1)
+ * ```
+ * Parser:
+ * - przyjmuje bajty w dowolnych fragmentach (handler Bluetooth), stan
+ *   między fragmentami to kilka liczników i bufor ośmiu bajtów danych -
+ *   bez alokacji i bez kopiowania linii
+ * - pierwsze 3 cyfry hex linii to identyfikator 11 bit, kolejne pary cyfr
+ *   to bajty danych (spacje dowolne, ale nie wewnątrz bajtu)
+ * - linie tekstowe ELM327 są liczone osobno: "BUFFER FULL" (adapter nie
+ *   nadąża z wysyłaniem), "?" (adapter bez ATMA); "STOPPED" (przerwanie
+ *   nasłuchu) jest pomijany, pozostałe (CAN ERROR...) liczone jako błędne
+ * - ramka o znanym identyfikatorze jest dekodowana od razu: sygnał to 1-4
+ *   bajty big-endian, wartość = surowa x scale + offset
+ *
+ * Koszt to kilka porównań na znak, więc kilkaset ramek na sekundę
+ * (~30 znaków na ramkę) nie obciąża handlera odbioru.
+ *
+ * Filtr ATCRA (filterPattern) przepuszcza tylko identyfikatory zgodne
+ * z sygnałami - na magistrali jest ich zwykle kilkaset razy więcej.
+ *
+ * Klasa nie zależy od Arduino (walidacja na hoście: tools/can_replay.cpp).
+ */
+
+#ifndef CAN_MONITOR_H
+#define CAN_MONITOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @class CanMonitor
+ * @brief Dekodowanie sygnałów z tekstowego strumienia ramek ATMA
+ */
+class CanMonitor {
+public:
+    static constexpr size_t MAX_SIGNALS = 4;        ///< Maksymalna liczba sygnałów
+    static constexpr size_t MAX_DATA = 8;           ///< Bajty danych ramki CAN
+    static constexpr size_t ID_DIGITS = 3;          ///< Cyfry hex identyfikatora 11 bit
+
+    /**
+     * @struct Signal
+     * @brief Położenie sygnału w ramce
+     */
+    struct Signal {
+        uint16_t id;            ///< Identyfikator ramki (11 bit)
+        uint8_t start;          ///< Pierwszy bajt sygnału (0-7)
+        uint8_t length;         ///< Liczba bajtów (1-4, big-endian)
+        float scale;            ///< Jednostka na wartość surową
+        float offset;           ///< Przesunięcie po przeskalowaniu
+        uint32_t invalidRaw;    ///< Wartość surowa "brak sygnału" (np. 0xFFFF), 0 = brak
+    };
+
+    /**
+     * @struct Stats
+     * @brief Liczniki parsera
+     */
+    struct Stats {
+        uint32_t frames;        ///< Poprawne ramki (wszystkie identyfikatory)
+        uint32_t matched;       ///< Ramki zdekodowane do sygnału
+        uint32_t malformed;     ///< Linie niebędące ramką (np. CAN ERROR)
+        uint32_t bufferFull;    ///< Komunikaty "BUFFER FULL"
+        uint32_t rejected;      ///< Odpowiedzi "?" (adapter bez ATMA)
+        uint32_t bytes;         ///< Przetworzone znaki
+    };
+
+    CanMonitor();
+
+    /**
+     * @brief Dodaje sygnał
+     * @return Indeks sygnału lub -1 (brak miejsca, błędne położenie)
+     */
+    int addSignal(const Signal& signal);
+
+    /**
+     * @brief Zeruje parser, odczyty i liczniki (sygnały zostają)
+     */
+    void reset();
+
+    /**
+     * @brief Przetwarza fragment strumienia
+     * @param data Znaki z adaptera (dowolny podział na fragmenty)
+     * @param len Liczba znaków
+     * @param nowMs Czas odbioru fragmentu - czas próbek z ramek zakończonych w nim [ms]
+     */
+    void feed(const uint8_t* data, size_t len, uint32_t nowMs);
+
+    /**
+     * @brief Ostatnia wartość sygnału, o ile nowa od poprzedniego take()
+     * @param index Indeks z addSignal()
+     * @param[out] value Wartość w jednostkach sygnału
+     * @param[out] tMs Czas odbioru ramki [ms]
+     * @return false gdy od poprzedniego wywołania nie było ramki z sygnałem
+     */
+    bool take(size_t index, float& value, uint32_t& tMs);
+
+    /**
+     * @brief Wzorzec ATCRA obejmujący identyfikatory sygnałów (np. "XA0")
+     *
+     * Cyfra wspólna dla wszystkich identyfikatorów zostaje, różniące się
+     * zastępuje 'X' (dowolna).
+     * @param[out] out Bufor (min. 4 znaki)
+     * @return false gdy nie ma sygnałów
+     */
+    bool filterPattern(char* out, size_t size) const;
+
+    /**
+     * @brief Liczniki parsera
+     */
+    Stats stats() const { return st; }
+
+    /**
+     * @brief Liczba sygnałów
+     */
+    size_t signalCount() const { return count; }
+
+private:
+    struct Reading {
+        float value;
+        uint32_t tMs;
+        bool fresh;
+    };
+
+    void endLine(uint32_t nowMs);
+    void dispatch(uint32_t nowMs);
+
+    Signal signals[MAX_SIGNALS];
+    Reading readings[MAX_SIGNALS];
+    size_t count;
+    Stats st;
+
+    // Stan bieżącej linii
+    uint16_t id;
+    uint8_t idDigits;
+    uint8_t data[MAX_DATA];
+    uint8_t dataLen;
+    uint8_t nibble;             ///< Starsza połowa bajtu (gdy halfByte)
+    bool halfByte;
+    bool bad;                   ///< Linia nie jest ramką
+    bool empty;                 ///< Brak znaków od początku linii
+    char first;                 ///< Pierwszy znak linii (rozpoznanie komunikatu)
+    char second;
+};
+
+#endif  // CAN_MONITOR_H
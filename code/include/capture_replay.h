@@ -0,0 +1,101 @@
+/**
+ * @file capture_replay.h
+ * @brief Odtwarzanie pliku link_capture.bin na hoście
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Czyta nagranie ruchu łącza (link_capture.h, format STREAM_CAPTURE
+ * z trip_log_format.h) i przekazuje fragmenty kolejnych kanałów do
+ * handlera w kolejności i z czasem, w jakim trafiły do ESP32. Handler
+ * podaje bajty do prawdziwego kodu parsowania (ObdPid, ObdDiscovery,
+ * CanMonitor, parser NMEA) - błąd zgłoszony z samochodu można odtworzyć
+ * i poprawić bez wyjazdu.
+ *
+ * Tempo:
+ * - speed = 0 - najszybciej jak się da (regresja, benchmark)
+ * - speed = 1 - czas rzeczywisty (np. przez emulowany port do firmware'u)
+ * - speed = N - N razy szybciej niż nagranie
+ *
+ * Czas micros() z ESP32 przepełnia się co ~71 minut - odtwarzanie rozwija
+ * go do 64 bitów licząc od pierwszego fragmentu. Bloki z błędnym CRC są
+ * pomijane i liczone w statystykach; każdy blok zaczyna się od czasu
+ * bezwzględnego, więc utracony blok nie przesuwa czasu kolejnych.
+ *
+ * Moduł nie zależy od Arduino (narzędzie: tools/capture_replay.cpp).
+ */
+
+#ifndef CAPTURE_REPLAY_H
+#define CAPTURE_REPLAY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "trip_log_format.h"
+
+/**
+ * @class CaptureReplay
+ * @brief Odtwarzacz nagrania ruchu łącza z bufora w pamięci
+ */
+class CaptureReplay {
+public:
+
+    /**
+     * @brief Odbiorca fragmentów
+     * @param ctx Kontekst przekazany do run()
+     * @param timeUs Czas od pierwszego fragmentu nagrania [us]
+     * @param channel TripLogFormat::CaptureChannel
+     * @param data Bajty (nullptr dla CAPTURE_LOST)
+     * @param len Liczba bajtów (CAPTURE_LOST: liczba utraconych bajtów)
+     */
+    typedef void (*Handler)(void* ctx, uint64_t timeUs, uint8_t channel, const uint8_t* data, size_t len);
+
+    /// Zegar monotoniczny hosta [us] (tempo speed > 0)
+    typedef uint64_t (*ClockUs)();
+
+    /// Uśpienie na zadany czas [us] (tempo speed > 0)
+    typedef void (*SleepUs)(uint64_t us);
+
+    /**
+     * @struct Stats
+     * @brief Statystyki ostatniego odtworzenia
+     */
+    struct Stats {
+        uint32_t blocks;                                        ///< Poprawne bloki
+        uint32_t badBlocks;                                     ///< Bloki z błędnym CRC lub uszkodzone
+        uint32_t chunks;                                        ///< Fragmenty przekazane do handlera
+        uint64_t bytes[TripLogFormat::CAPTURE_CHANNELS];        ///< Bajty na kanał (CAPTURE_LOST: utracone)
+        uint64_t durationUs;                                    ///< Czas ostatniego fragmentu od pierwszego
+        uint64_t maxLagUs;                                      ///< Największe spóźnienie względem tempa (speed > 0)
+    };
+
+    /**
+     * @brief Ustawia nagranie (bez kopiowania - bufor musi żyć do końca run())
+     * @param file Zawartość pliku link_capture.bin
+     * @param len Rozmiar pliku
+     * @return false gdy nagłówek pliku nie jest nagłówkiem STREAM_CAPTURE
+     */
+    bool load(const uint8_t* file, size_t len);
+
+    /**
+     * @brief Odtwarza nagranie
+     * @param handler Odbiorca fragmentów
+     * @param ctx Kontekst handlera
+     * @param speed 0 = bez czekania, 1 = czas rzeczywisty, N = N razy szybciej
+     * @param clock Zegar hosta (wymagany dla speed > 0)
+     * @param sleep Uśpienie (wymagane dla speed > 0)
+     * @return false gdy nie wczytano nagrania lub brak zegara przy speed > 0
+     */
+    bool run(Handler handler, void* ctx, double speed = 0.0, ClockUs clock = nullptr, SleepUs sleep = nullptr);
+
+    /**
+     * @brief Statystyki ostatniego run()
+     */
+    const Stats& stats() const { return st; }
+
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    Stats st = {};
+};
+
+#endif  // CAPTURE_REPLAY_H
@@ -0,0 +1,177 @@
+/**
+ * @file clock_discipline.h
+ * @brief Odwzorowanie zegara monotonicznego na UTC z dryfem - stały koszt przeliczenia
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Zegar monotoniczny ESP32 (esp_timer, kwarc) odbiega od UTC o kilkadziesiąt
+ * ppm i zmienia się z temperaturą - jednorazowe ustawienie czasu z GPS po
+ * godzinie jazdy myli się o setki ms. Klasa dostaje odniesienia (chwila
+ * zegara monotonicznego, UTC) i utrzymuje model liniowy:
+ *
+ *   UTC(t) = utcUs + (t - monoUs) x (1 + ppb / 1e9)
+ *
+ * - Przesunięcie i dryf to prosta regresji przesunięcia (UTC - t) od t
+ *   z wykładniczym zapominaniem (stała czasowa windowS; przy PPS krótsza -
+ *   ppsWindowS, bo szum odniesień jest mały, a dryf kwarcu zmienia się
+ *   z temperaturą). Sumy są
+ *   przesuwane do chwili ostatniego odniesienia, więc wartości pozostają
+ *   małe (bez utraty precyzji double) i każde odniesienie to stała liczba
+ *   działań. Dryf jest wyznaczany dopiero, gdy odniesienia obejmują co
+ *   najmniej minSpanS - wcześniej obowiązuje ostatni znany dryf.
+ * - Źródła (Source) mają rosnącą jakość: zegar systemowy (RTC przetrwał
+ *   restart), zdania NMEA, impuls PPS. Lepsze źródło zaczyna regresję od
+ *   nowa (z dryfem poprzedniej), gorsze jest pomijane, dopóki lepsze nie
+ *   zamilknie na holdoverMs.
+ * - Odniesienie dalsze od przewidywania niż gate (4 niepewności odniesienia
+ *   i modelu, nie mniej niż gateMinUs) jest odrzucane; stepUs lub
+ *   rejectSteps odrzuceń z rzędu oznacza skok czasu - model startuje od
+ *   odniesienia.
+ * - Bez odniesień model dalej liczy z ostatnim dryfem (holdover), a
+ *   niepewność rośnie z niepewnością dryfu.
+ *
+ * Przeliczenie (Model::utcUs) to kilka działań całkowitych - Model jest
+ * trywialnie kopiowalny i publikowany przez seqlock (timebase.h).
+ *
+ * Klasa nie zależy od Arduino (walidacja na hoście: tools/timebase_bench.cpp).
+ */
+
+#ifndef CLOCK_DISCIPLINE_H
+#define CLOCK_DISCIPLINE_H
+
+#include <stdint.h>
+
+// Moduł celowo nie używa Arduino.h - kompiluje się również na hoście
+
+/**
+ * @class ClockDiscipline
+ * @brief Model UTC(zegar monotoniczny) z przesunięciem i dryfem
+ */
+class ClockDiscipline {
+public:
+
+    /**
+     * @enum Source
+     * @brief Źródło czasu (rosnąca jakość; wartość trafia do logów)
+     */
+    enum Source : uint8_t {
+        SOURCE_NONE = 0,        ///< Czas UTC nieznany
+        SOURCE_SYSTEM = 1,      ///< Zegar systemowy z poprzedniej pracy (restart ESP32 bez utraty zasilania)
+        SOURCE_HOLDOVER = 2,    ///< Bez odniesienia dłużej niż holdoverMs - model z ostatnim dryfem
+        SOURCE_NMEA = 3,        ///< Czas epok ze zdań NMEA (opóźnienie nadawania)
+        SOURCE_PPS = 4          ///< Impuls PPS modułu GPS
+    };
+
+    /**
+     * @struct Config
+     * @brief Parametry regresji i progi (wartości firmware: cabulator_settings.h, TIMEBASE::*)
+     */
+    struct Config {
+        uint32_t windowS = 600;         ///< Stała czasowa zapominania odniesień NMEA [s]
+        uint32_t ppsWindowS = 60;       ///< Stała czasowa przy PPS (szybsze śledzenie wahań kwarcu) [s]
+        uint32_t minSpanS = 60;         ///< Min. rozpiętość odniesień do wyznaczenia dryfu [s]
+        uint32_t maxPpm = 200;          ///< Ograniczenie dryfu [ppm]
+        uint32_t driftFloorPpb = 5000;  ///< Min. niepewność dryfu (kwarc w kabinie - zmiany temperatury) [ppb]
+        uint32_t gateMinUs = 20000;     ///< Min. próg odrzucenia odniesienia [us]
+        uint32_t stepUs = 1000000;      ///< Różnica od przewidywania = skok czasu [us]
+        uint8_t rejectSteps = 3;        ///< Odrzucenia z rzędu = skok czasu
+        uint32_t holdoverMs = 3000;     ///< Bez odniesienia dłużej = SOURCE_HOLDOVER [ms]
+    };
+
+    /**
+     * @struct Model
+     * @brief Opublikowany model - przeliczenie w stałym czasie z dowolnego tasku
+     */
+    struct Model {
+        int64_t monoUs;         ///< Chwila ostatniego odniesienia (zegar monotoniczny) [us]
+        int64_t utcUs;          ///< UTC w chwili monoUs [us od 1970-01-01]
+        int32_t ppb;            ///< Korekta częstotliwości zegara monotonicznego [1e-9]
+        uint32_t accUs;         ///< Niepewność utcUs [us]
+        uint32_t driftPpb;      ///< Niepewność ppb (wzrost niepewności poza monoUs) [1e-9]
+        uint32_t holdoverUs;    ///< Config::holdoverMs [us]
+        uint8_t source;         ///< Źródło ostatniego odniesienia (SOURCE_NONE = brak modelu)
+
+        /// @brief UTC w chwili t zegara monotonicznego [us]
+        int64_t utcAt(int64_t t) const {
+            int64_t d = t - monoUs;
+            return utcUs + d + d * ppb / 1000000000;
+        }
+
+        /// @brief Niepewność UTC w chwili t [us]
+        uint32_t accuracyAt(int64_t t) const {
+            int64_t d = t > monoUs ? t - monoUs : monoUs - t;
+            int64_t acc = accUs + d * driftPpb / 1000000000;
+            return acc < UINT32_MAX ? (uint32_t)acc : UINT32_MAX;
+        }
+
+        /// @brief Jakość czasu w chwili t (SOURCE_HOLDOVER po holdoverUs bez odniesienia)
+        Source sourceAt(int64_t t) const {
+            if (source == SOURCE_NONE || source == SOURCE_SYSTEM) return (Source)source;
+            return t - monoUs > (int64_t)holdoverUs ? SOURCE_HOLDOVER : (Source)source;
+        }
+    };
+
+    /**
+     * @struct Stats
+     * @brief Liczniki odniesień
+     */
+    struct Stats {
+        uint32_t references;        ///< Odniesienia użyte w regresji
+        uint32_t ignored;           ///< Odniesienia gorszego źródła (lepsze aktywne)
+        uint32_t rejected;          ///< Odniesienia odrzucone progiem
+        uint32_t steps;             ///< Skoki czasu (w tym pierwsze odniesienie)
+        int32_t lastErrorUs;        ///< Różnica ostatniego odniesienia od przewidywania [us]
+        uint32_t maxErrorUs;        ///< Największa |różnica| od ostatniego skoku [us]
+    };
+
+    /// @brief Nazwa źródła do logów i ekranów ("none", "system", "holdover", "nmea", "pps")
+    static const char* sourceName(uint8_t source) {
+        static const char* const names[] = { "none", "system", "holdover", "nmea", "pps" };
+        return source < sizeof(names) / sizeof(names[0]) ? names[source] : "?";
+    }
+
+    ClockDiscipline();
+    explicit ClockDiscipline(const Config& config);
+
+    /// @brief Brak modelu (czas nieznany)
+    void reset();
+
+    /**
+     * @brief Odniesienie czasu
+     * @param monoUs Chwila zegara monotonicznego [us]
+     * @param utcUs UTC w tej chwili [us od 1970-01-01]
+     * @param accUs Niepewność odniesienia [us]
+     * @param source Źródło (SOURCE_SYSTEM, SOURCE_NMEA, SOURCE_PPS)
+     * @return true gdy odniesienie zmieniło model
+     */
+    bool addReference(int64_t monoUs, int64_t utcUs, uint32_t accUs, Source source);
+
+    /// @brief Bieżący model
+    const Model& model() const { return m; }
+
+    /// @brief Czy dryf jest wyznaczony z regresji (a nie przyjęty)
+    bool driftFitted() const { return fitted; }
+
+    /// @brief Liczniki
+    Stats stats() const { return st; }
+
+private:
+    void restart(int64_t monoUs, int64_t utcUs, uint32_t accUs, Source source);
+    void fit(uint32_t accUs);
+
+    Config cfg;
+    Stats st;
+    Model m;
+
+    // Regresja przesunięcia y = UTC - t [us] względem x = t - m.monoUs [s],
+    // sumy ważone zapominaniem; y względem offsetUs
+    double sw, sx, sy, sxx, sxy, syy;
+    int64_t offsetUs;
+    bool fitted;
+    int32_t priorPpb;           // Ostatni wyznaczony dryf (do zebrania minSpanS)
+    uint32_t priorAccPpb;
+    uint8_t rejects;            // Odrzucenia z rzędu
+};
+
+#endif  // CLOCK_DISCIPLINE_H
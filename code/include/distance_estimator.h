@@ -0,0 +1,107 @@
+/**
+ * @file distance_estimator.h
+ * @brief Dystans z dokładnością do metra - całkowanie prędkości z kotwiczeniem do odometru
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Odometr (22DD01) ma rozdzielczość 1 km, więc sam w sobie daje skoki co km
+ * i opóźnienie do prawie kilometra. Estymator:
+ *
+ * - całkuje prędkość PID 010D metodą trapezów (km/h x ms, bez zaokrągleń);
+ *   przerwa między próbkami dłuższa niż MAX_GAP_MS nie jest całkowana
+ * - przy zmianie wskazania odometru kotwiczy dystans do granicy km:
+ *   pierwsza zmiana wyznacza położenie startu wewnątrz kilometra (nieznane
+ *   przy starcie), każda kolejna koryguje błąd całkowania
+ * - moment zmiany jest znany z dokładnością do okresu odczytu odometru,
+ *   więc dystans po granicy km jest szacowany w oknie między odczytami
+ * - dopóki odometr się nie zmienił, dystans od ostatniej granicy nie może
+ *   przekroczyć 1 km - błąd jest ograniczony niezależnie od długości trasy
+ * - dystans wyjściowy nigdy nie maleje (korekta w dół wstrzymuje przyrost,
+ *   aż całkowanie dogoni kotwicę)
+ *
+ * Bez prędkości (PID nieobsługiwany) estymator zachowuje się jak sam odometr.
+ *
+ * Klasa nie zależy od Arduino (walidacja na hoście: tools/distance_replay.cpp).
+ */
+
+#ifndef DISTANCE_ESTIMATOR_H
+#define DISTANCE_ESTIMATOR_H
+
+#include <stdint.h>
+
+/**
+ * @class DistanceEstimator
+ * @brief Dystans przejazdu [mm] z prędkości i odometru
+ */
+class DistanceEstimator {
+public:
+    static constexpr uint32_t MM_PER_KM = 1000000;  ///< mm w kilometrze
+    static constexpr uint32_t MAX_GAP_MS = 5000;    ///< Maks. odstęp próbek prędkości do całkowania
+
+    /**
+     * @struct Stats
+     * @brief Diagnostyka kotwiczenia
+     */
+    struct Stats {
+        uint32_t ticks;             ///< Zmiany odometru od startu [km]
+        int32_t lastCorrectionMm;   ///< Ostatnia korekta przy zmianie odometru [mm]
+        uint32_t maxCorrectionMm;   ///< Największa korekta (wartość bezwzględna) [mm]
+        uint32_t gaps;              ///< Przerwy w próbkach prędkości > MAX_GAP_MS
+        bool anchored;              ///< Czy znane jest położenie startu w km
+    };
+
+    DistanceEstimator();
+
+    /// @brief Nowy przejazd
+    void reset();
+
+    /**
+     * @brief Próbka prędkości
+     * @param tMs Czas próbki [ms]
+     * @param speedKmh Prędkość [km/h], < 0 = brak odczytu (przerwa w całkowaniu)
+     */
+    void addSpeed(uint32_t tMs, int speedKmh);
+
+    /**
+     * @brief Odczyt odometru
+     * @param tMs Czas odczytu [ms]
+     * @param km Wskazanie [km]
+     */
+    void addOdometer(uint32_t tMs, long km);
+
+    /**
+     * @brief Dystans od startu przejazdu [mm] (niemalejący)
+     */
+    uint32_t distanceMm() const { return reportedMm; }
+
+    /// @brief Diagnostyka kotwiczenia
+    Stats stats() const { return st; }
+
+private:
+    uint64_t integratedMm() const;
+    void publish();
+
+    // Całkowanie: suma (v1 + v2) x dt [km/h x ms], mm = suma x 10 / 72
+    uint64_t speedAcc;
+    bool haveSpeed;
+    uint32_t lastSpeedMs;
+    int lastSpeed;
+
+    // Odometr
+    bool haveOdometer;
+    long lastKm;
+    uint32_t lastOdoMs;
+    uint64_t integratedAtLastOdo;   ///< Całka w chwili poprzedniego odczytu [mm]
+
+    // Kotwica: dystans przejazdu w chwili ostatniej zmiany odometru
+    uint64_t anchorMm;
+    uint64_t integratedAtAnchor;    ///< Całka odpowiadająca kotwicy [mm]
+    uint64_t firstTickMm;           ///< Dystans przy pierwszej zmianie (start wewnątrz km)
+    long firstTickKm;
+
+    uint32_t reportedMm;
+    Stats st;
+};
+
+#endif  // DISTANCE_ESTIMATOR_H
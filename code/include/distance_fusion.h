@@ -0,0 +1,198 @@
+/**
+ * @file distance_fusion.h
+ * @brief Fuzja OBD i GPS - jeden dystans i prędkość z filtru Kalmana, stała pamięć i koszt
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Żadne źródło osobno nie wystarcza do rozliczenia: odometr ma rozdzielczość
+ * 1 km, prędkość OBD jest zawyżona o kilka % (skala licznika), a GPS gubi
+ * fixy w tunelach i między budynkami. Filtr łączy wszystkie pomiary
+ * w jednym stanie:
+ *
+ * - s - dystans od startu [m] (reszta ponad pełne metry bazy w liczbie całkowitej),
+ * - v - prędkość [m/s],
+ * - k - skala prędkości OBD (OBD = k x v),
+ * - r - kopia s w punkcie odniesienia pozycji GPS (pomiar przyrostu s - r).
+ *
+ * Predykcja: s += v x dt, szum przyspieszenia (model stałej prędkości),
+ * powolny dryf skali. Pomiary (każdy skalarny, stała liczba działań):
+ *
+ * - prędkość OBD (PID 010D) - h = k x v; skala uczy się z Dopplera i odometru,
+ *   więc w tunelu dystans z OBD jest już skorygowany
+ * - prędkość Dopplera z RMC - h = v, niepewność rośnie z HDOP; poniżej progu
+ *   postoju pomiar = 0 (szum Dopplera na postoju nie nabija dystansu)
+ * - dystans z pozycji (GpsOdometer, Fix::odometerMm) - h = s - r, przyrost od
+ *   punktu odniesienia przesuwanego co gpsWindowM; używany tylko bez Dopplera
+ *   (GpsOdometer opóźnia przyrost, Doppler jest dokładniejszy) oraz jako cięciwa
+ *   po przerwie w fixach, w której filtr był "ślepy" - wtedy jest jedyną
+ *   informacją; po zwykłej przerwie odniesienie zaczyna się od nowa (cięciwa
+ *   tunelu jest krótsza niż droga zliczona z OBD)
+ * - zmiana odometru - chwila przejścia przez pełny km leży między odczytami,
+ *   więc pomiar dotyczy s - v x dt / 2 z niepewnością okna odczytu; pierwsza
+ *   zmiana wyznacza położenie startu wewnątrz km, a bez zmiany dystans od
+ *   ostatniej granicy nie może przekroczyć 1 km (ograniczenie jednostronne)
+ *
+ * Przerwy: bez GPS dystans liczy prędkość OBD (ze skalą), bez łącza OBD -
+ * Doppler i pozycja. Gdy przez blindMs nie ma żadnego pomiaru prędkości ani
+ * pozycji, filtr przestaje całkować (jak DistanceEstimator::MAX_GAP_MS),
+ * a niepewność dystansu rośnie - brakujący odcinek uzupełni pozycja GPS lub
+ * odometr.
+ *
+ * Wyjście: niemalejący dystans [mm] (korekta w dół wstrzymuje przyrost)
+ * i prędkość [km/h]. Pomiary prędkości i pozycji dalsze niż gateSigma
+ * odchyleń od przewidywania są odrzucane (odbicia sygnału GPS).
+ *
+ * Każda metoda wykonuje stałą liczbę działań zmiennoprzecinkowych pojedynczej
+ * precyzji (FPU ESP32), bez pętli i alokacji - koszt jest stały
+ * (task OBD mierzy cykle, benchmark: tools/fusion_replay.cpp).
+ *
+ * Klasa nie zależy od Arduino (walidacja na hoście: tools/fusion_replay.cpp).
+ */
+
+#ifndef DISTANCE_FUSION_H
+#define DISTANCE_FUSION_H
+
+#include <stdint.h>
+
+/**
+ * @class DistanceFusion
+ * @brief Dystans [mm] i prędkość z OBD i GPS (filtr Kalmana, 4 stany)
+ */
+class DistanceFusion {
+public:
+
+    /**
+     * @struct Config
+     * @brief Niepewności pomiarów i progi (wartości firmware: cabulator_settings.h, OBD_CONFIG::FUSION_*)
+     */
+    struct Config {
+        float accelSigma = 1.5f;            ///< Szum procesu - odchylenie przyspieszenia [m/s^2]
+        float obdSpeedSigma = 0.4f;         ///< Prędkość OBD (kwantyzacja 1 km/h, opóźnienie) [m/s]
+        float gpsSpeedSigma = 0.3f;         ///< Prędkość Dopplera przy HDOP <= 1 [m/s]
+        float gpsPositionSigma = 10.0f;     ///< Dystans z pozycji przy HDOP <= 1 [m]
+        float gpsWindowM = 200.0f;          ///< Przesunięcie odniesienia dystansu z pozycji co [m]
+        float odoTickSigma = 20.0f;         ///< Położenie granicy km odometru [m]
+        float scaleSigma = 0.05f;           ///< Początkowa niepewność skali OBD
+        float scaleDrift = 1e-4f;           ///< Dryf skali OBD [1/sqrt(s)]
+        float gateSigma = 5.0f;             ///< Odrzucenie pomiaru GPS dalszego niż tyle odchyleń
+        uint32_t stationaryMmS = 700;       ///< Doppler poniżej = postój [mm/s]
+        uint32_t blindMs = 5000;            ///< Bez pomiaru dłużej - bez całkowania [ms]
+        uint32_t gpsGapMs = 3000;           ///< Dłuższa przerwa w fixach - nowe odniesienie pozycji [ms]
+        uint16_t maxHdop = 300;             ///< Maks. HDOP x100 fixu użytego w filtrze
+        uint8_t minSats = 5;                ///< Min. liczba satelitów
+    };
+
+    /**
+     * @struct Stats
+     * @brief Liczniki pomiarów
+     */
+    struct Stats {
+        uint32_t obdSpeed;          ///< Pomiary prędkości OBD
+        uint32_t gpsSpeed;          ///< Pomiary Dopplera
+        uint32_t gpsPosition;       ///< Pomiary dystansu z pozycji
+        uint32_t odometerTicks;     ///< Zmiany odometru
+        uint32_t rejected;          ///< Pomiary GPS odrzucone testem odchylenia
+        uint32_t blind;             ///< Przerwy bez pomiarów dłuższe niż blindMs
+        int32_t lastCorrectionMm;   ///< Ostatnia różnica odometr - filtr przy zmianie km [mm]
+        uint32_t maxCorrectionMm;   ///< Największa różnica (wartość bezwzględna) [mm]
+    };
+
+    DistanceFusion();
+    explicit DistanceFusion(const Config& config);
+
+    /// @brief Nowy przejazd
+    void reset();
+
+    /**
+     * @brief Próbka prędkości OBD
+     * @param tMs Czas próbki [ms]
+     * @param speedKmh Prędkość [km/h], < 0 = brak odczytu (pomijana)
+     */
+    void addObdSpeed(uint32_t tMs, int speedKmh);
+
+    /**
+     * @brief Odczyt odometru
+     * @param tMs Czas odczytu [ms]
+     * @param km Wskazanie [km], < 0 = brak
+     */
+    void addOdometer(uint32_t tMs, long km);
+
+    /**
+     * @brief Epoka GPS (raz na epokę pozycji)
+     * @param tMs Czas epoki [ms]
+     * @param valid Czy fix jest ważny
+     * @param speedMmS Prędkość Dopplera [mm/s], < 0 = nieznana
+     * @param odometerMm GpsOdometer::distanceMm() po tej epoce (licznik przekręca się)
+     * @param hdop HDOP x100
+     * @param sats Liczba satelitów
+     */
+    void addGps(uint32_t tMs, bool valid, int32_t speedMmS, uint32_t odometerMm, uint16_t hdop, uint8_t sats);
+
+    /**
+     * @brief Przewidywanie do chwili tMs bez pomiaru (odczyt wyjścia między pomiarami)
+     */
+    void advance(uint32_t tMs);
+
+    /**
+     * @brief Dystans od startu przejazdu [mm] (niemalejący)
+     */
+    uint32_t distanceMm() const { return reportedMm; }
+
+    /**
+     * @brief Prędkość [km/h], -1 gdy filtr nie ma pomiarów dłużej niż blindMs
+     */
+    float speedKmh() const;
+
+    /// @brief Skala prędkości OBD (OBD / rzeczywista)
+    float obdScale() const { return k; }
+
+    /// @brief Odchylenie standardowe dystansu [m]
+    float sigmaM() const;
+
+    /// @brief Liczniki pomiarów
+    Stats stats() const { return st; }
+
+private:
+    void predict(uint32_t tMs);
+    void propagate(float dt);
+    void enterBlind();
+    void aided(uint32_t tMs);
+    void clone();
+    bool correct(float y, float h0, float h1, float h2, float h3, float rv, bool gate);
+    int64_t estimateMm() const;
+    void publish();
+
+    Config cfg;
+    Stats st;
+
+    // Stan [s, v, k, r] (r - kopia s w odniesieniu pozycji GPS) i kowariancja symetryczna
+    float s, v, k, r;
+    float pss, psv, psk, psr, pvv, pvk, pvr, pkk, pkr, prr;
+    int64_t baseMm;             // Pełne metry przeniesione z s [mm]
+
+    bool started;
+    uint32_t lastMs;            // Chwila stanu
+    uint32_t aidMs;             // Ostatni pomiar prędkości lub pozycji
+    bool blind;                 // Bez pomiarów dłużej niż blindMs - s nie jest całkowane
+    uint32_t blindFromMs;       // Początek przerwy bez pomiarów
+
+    // Dystans z pozycji: przyrost Fix::odometerMm od odniesienia
+    bool gpsRef;
+    uint32_t gpsRefOdoMm;       // Licznik GpsOdometer w odniesieniu
+    uint16_t gpsRefUpdates;     // Pomiary od odniesienia
+    uint32_t gpsLastMs;
+    bool gpsBlind;              // Filtr był ślepy od ostatniego fixu
+
+    // Odometr
+    bool haveOdometer;
+    long lastKm;
+    uint32_t lastOdoMs;
+    bool odoRef;
+    long refKm;                 // Wskazanie przy pierwszej zmianie
+    int64_t refMm;              // Dystans filtru w chwili pierwszej zmiany [mm]
+
+    uint32_t reportedMm;
+};
+
+#endif  // DISTANCE_FUSION_H
@@ -0,0 +1,233 @@
+/**
+ * @file elm327_emulator.h
+ * @brief Emulator adaptera ELM327 sterowany skryptem PID
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Emulator odpowiada na komendy tak jak adapter ELM327 podłączony do ECU,
+ * więc tryb symulacji i narzędzia hosta przechodzą przez cały stos OBD:
+ * sekwencję ATZ/ATE0/ATSP6/0100, ObdLink (ramkowanie po '>'), parsery
+ * ObdPid i harmonogram.
+ *
+ * Obsługiwane komendy:
+ * - AT: Z, I, @1, D, E0/1, L0/1, S0/1, H0/1, SPx, SPAx, TPx, DPN, RV (reszta -> "?");
+ *   protokół automatyczny (po ATZ, ATSP0) jest "wyszukiwany" przy pierwszym
+ *   zapytaniu, protokół ustawiony na inny niż ECU daje "UNABLE TO CONNECT"
+ * - Mode 01: pojedyncze i zbiorcze zapytania (do 6 PID), mapy obsługiwanych
+ *   PID (0100, 0120, ...) wyliczane ze skryptu, odpowiedzi dłuższe niż
+ *   jedna ramka CAN w formacie wieloramkowym ISO-TP ("00A", "0:...", "1:...")
+ * - 0902 - VIN z Config::vin (wieloramkowo)
+ * - inne tryby (np. 22DD01) - odpowiedź ze skryptu (tryb + 0x40)
+ * - ATMA (nasłuch) i ATCRA (filtr identyfikatorów, 'X' = dowolna cyfra):
+ *   ramki rozgłoszeniowe Config::broadcasts z wartościami skryptu i ruch
+ *   innych modułów (Config::busFps); nasłuch przerywa dowolny znak - ramki
+ *   z całego okna są wtedy wysyłane linia po linii, a po nich "STOPPED"
+ *   i znak zachęty; ponad Config::monitorMaxFps ramek/s adapter kończy
+ *   komunikatem "BUFFER FULL"
+ *
+ * Skrypt (tekst, linia = punkt kontrolny):
+ * ```
+ * # czas[ms] komenda dane(hex)
+ * 0      010D   00
+ * 30000  010D   32        # 50 km/h po 30 s (liniowo od 0)
+ * 0      22DD01 00C350    # odometr 50000 km
+ * ```
+ * Wartości (do 4 bajtów, big-endian) są interpolowane liniowo między
+ * punktami tej samej komendy; przed pierwszym i po ostatnim punkcie
+ * utrzymywana jest wartość skrajna.
+ *
+ * Ramka rozgłoszeniowa przenosi wartość komendy skryptu przeliczoną
+ * na jednostki sygnału (np. 010D x 100 = prędkość co 0.01 km/h).
+ *
+ * Zakłócenia (Config): opóźnienie z rozrzutem, szum wartości Mode 01,
+ * losowe "NO DATA", odpowiedzi utracone (timeout po stronie ObdLink),
+ * "SEARCHING..." przed pierwszą odpowiedzią, rozłączenia co N komend,
+ * dzielenie odpowiedzi na fragmenty.
+ *
+ * Odpowiedź jest dostarczana do handlera wewnątrz write() po odczekaniu
+ * opóźnienia przez Config::sleepMs (firmware: vTaskDelay, host: zegar
+ * wirtualny). Moduł nie zależy od Arduino.
+ */
+
+#ifndef ELM327_EMULATOR_H
+#define ELM327_EMULATOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "obd_transport.h"
+
+/**
+ * @class Elm327Emulator
+ * @brief Transport OBD z emulowanym adapterem ELM327 i ECU
+ */
+class Elm327Emulator : public ObdTransport {
+public:
+    static constexpr size_t MAX_KEYFRAMES = 64;     ///< Punkty kontrolne skryptu
+    static constexpr size_t MAX_COMMAND = 12;       ///< Długość komendy hex (np. "22DD01")
+    static constexpr size_t MAX_RESPONSE = 512;     ///< Bufor odpowiedzi [B]
+
+    /// Skrypt domyślny - godzina jazdy: postój, miasto 50 km/h, trasa 100 km/h
+    static const char* const DEFAULT_SCRIPT;
+
+    /**
+     * @struct Broadcast
+     * @brief Ramka nadawana cyklicznie na magistrali (nasłuch ATMA)
+     */
+    struct Broadcast {
+        uint16_t id;                ///< Identyfikator ramki (11 bit)
+        uint16_t periodMs;          ///< Okres nadawania [ms]
+        const char* cmd;            ///< Komenda skryptu - źródło wartości (np. "010D")
+        uint8_t start;              ///< Pierwszy bajt sygnału w ramce
+        uint8_t length;             ///< Długość sygnału [B] (big-endian)
+        float factor;               ///< Wartość surowa = wartość skryptu x factor
+    };
+
+    /**
+     * @struct Config
+     * @brief Zachowanie adaptera i łącza
+     */
+    struct Config {
+        uint32_t latencyMs;         ///< Bazowy czas odpowiedzi [ms]
+        uint32_t jitterMs;          ///< Losowy dodatek 0..jitterMs [ms]
+        uint32_t perPidMs;          ///< Dodatek za każdy kolejny PID w zapytaniu [ms]
+        uint8_t noisePct;           ///< Szum wartości Mode 01 (+/- %)
+        uint8_t noDataPct;          ///< Prawdopodobieństwo "NO DATA" [%]
+        uint8_t dropPct;            ///< Prawdopodobieństwo braku odpowiedzi [%]
+        bool searching;             ///< "SEARCHING..." przed pierwszą odpowiedzią w protokole automatycznym
+        uint32_t searchMs;          ///< Czas wyszukiwania protokołu [ms]
+        uint32_t resetMs;           ///< Czas wykonania ATZ [ms]
+        uint8_t protocol;           ///< Protokół ECU (numer ELM327, 1-C)
+        const char* vin;            ///< VIN (17 znaków) lub nullptr = ECU bez 0902
+        bool multiPid;              ///< Czy ECU przyjmuje zapytania z wieloma PID
+        uint32_t disconnectAfter;   ///< Rozłączenie co tyle komend (0 = nigdy)
+        uint32_t disconnectMs;      ///< Czas rozłączenia [ms]
+        uint16_t chunkBytes;        ///< Wielkość fragmentów odpowiedzi (0 = całość)
+        bool monitor;               ///< Czy adapter obsługuje ATMA (false -> "?")
+        const Broadcast* broadcasts;    ///< Ramki rozgłoszeniowe (nullptr = brak)
+        uint8_t broadcastCount;
+        uint16_t busFps;            ///< Ramki innych modułów na magistrali [1/s]
+        uint16_t monitorMaxFps;     ///< Przepustowość nasłuchu [ramki/s] (0 = bez limitu)
+        uint32_t seed;              ///< Ziarno generatora losowego
+        uint32_t (*nowMs)();        ///< Źródło czasu (wymagane)
+        void (*sleepMs)(uint32_t);  ///< Oczekiwanie na odpowiedź (nullptr = bez opóźnienia)
+    };
+
+    /**
+     * @struct Stats
+     * @brief Liczniki emulatora
+     */
+    struct Stats {
+        uint32_t commands;          ///< Odebrane komendy
+        uint32_t obdRequests;       ///< Zapytania do ECU (nie AT)
+        uint32_t noData;            ///< Odpowiedzi "NO DATA"
+        uint32_t dropped;           ///< Komendy bez odpowiedzi
+        uint32_t disconnects;       ///< Rozłączenia
+        uint32_t monitorFrames;     ///< Ramki wysłane w trybie nasłuchu
+    };
+
+    /**
+     * @brief Konfiguracja domyślna: 50 ms +/- 20 ms, bez zakłóceń, CAN 11 bit 500 kbps
+     */
+    static Config defaultConfig(uint32_t (*nowMs)(), void (*sleepMs)(uint32_t));
+
+    explicit Elm327Emulator(const Config& config);
+
+    /**
+     * @brief Wczytuje skrypt PID (zastępuje poprzedni)
+     * @param text Tekst skryptu
+     * @param[out] errorLine Numer błędnej linii (opcjonalnie)
+     * @return false przy błędzie składni, przepełnieniu lub czasie malejącym
+     *         w obrębie komendy
+     */
+    bool loadScript(const char* text, int* errorLine = nullptr);
+
+    /**
+     * @brief Wartość skryptu w chwili tMs (bez szumu)
+     * @param cmd Komenda (np. "010D", "22DD01")
+     * @param[out] data Bajty danych
+     * @param[out] len Liczba bajtów
+     * @return false gdy skrypt nie zawiera komendy
+     */
+    bool scriptValue(const char* cmd, uint32_t tMs, uint8_t* data, uint8_t* len) const;
+
+    /**
+     * @brief Zmienia konfigurację (np. między etapami testu)
+     */
+    void setConfig(const Config& config);
+
+    /**
+     * @brief Bieżąca konfiguracja
+     */
+    const Config& getConfig() const { return cfg; }
+
+    /**
+     * @brief Zwraca liczniki
+     */
+    Stats getStats() const { return stats; }
+
+    void setHandler(DataHandler handler) override;
+    size_t write(const uint8_t* data, size_t len) override;
+    bool connected() override;
+    bool connect() override;                ///< Udana, gdy minął czas rozłączenia
+    void disconnect() override;
+
+private:
+    struct Keyframe {
+        uint32_t tMs;
+        char cmd[MAX_COMMAND + 1];
+        uint8_t len;
+        uint32_t value;
+    };
+
+    void resetAdapter();
+    void handleCommand(char* cmd);
+    void handleAt(const char* at);
+    void handleObd(const char* cmd);
+    bool supportBitmap(uint8_t base, uint8_t* data) const;
+    uint32_t noisy(uint32_t value, uint8_t len);
+    void appendLine(const char* text);
+    void appendFrames(const uint8_t* payload, size_t len);
+    void deliver(uint32_t delayMs);
+    void stopMonitor();
+    bool passesFilter(uint16_t id) const;
+    void emitFrame(uint16_t id, const uint8_t* data, size_t len);
+    void emitLine(const char* text);
+    uint32_t random();
+    uint32_t elapsedMs() const;
+
+    Config cfg;
+    DataHandler handler;
+    Stats stats;
+
+    Keyframe keyframes[MAX_KEYFRAMES];
+    size_t keyframeCount;
+    uint32_t startMs;
+
+    // Stan adaptera (ustawienia AT)
+    bool echo;
+    bool linefeeds;
+    bool spaces;
+    bool headers;
+    bool searchPending;
+    uint8_t protocol;               ///< Ustawiony protokół (0 = automatyczny)
+    bool autoProtocol;              ///< ATSP0 / ATSPAx - raport DPN z prefiksem 'A'
+    bool connectedEcu;              ///< Czy protokół został już wyszukany / potwierdzony
+    uint32_t extraDelayMs;          ///< Dodatkowy czas bieżącej komendy (ATZ, wyszukiwanie)
+    bool monitoring;                ///< Trwa ATMA
+    uint32_t monitorStartMs;        ///< Początek nasłuchu [ms, nowMs()]
+    char receiveFilter[4];          ///< Wzorzec ATCRA ("" = wszystkie identyfikatory)
+
+    // Połączenie
+    bool online;
+    uint32_t offlineUntilMs;
+    uint32_t sinceDisconnect;
+
+    char input[64];
+    size_t inputLen;
+    char out[MAX_RESPONSE];
+    size_t outLen;
+    uint32_t rng;
+};
+
+#endif  // ELM327_EMULATOR_H
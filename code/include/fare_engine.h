@@ -0,0 +1,184 @@
+/**
+ * @file fare_engine.h
+ * @brief Stałoprzecinkowe liczenie należności za przejazd
+ * @version 1.1
+ * @date 2025-01-20
+ *
+ * @details
+ * Jedno miejsce liczenia dystansu, paliwa i należności dla ekranu trasy,
+ * taska OBD (zapis co 10 s) i finalizacji trasy. Wszystkie wartości są
+ * całkowite:
+ *
+ * | Wielkość  | Stan wewnętrzny | Snapshot |
+ * |-----------|-----------------|----------|
+ * | Dystans   | mm              | m        |
+ * | Paliwo    | µl              | ml       |
+ * | Czas      | ms              | ms       |
+ * | Należność | gr x µl x %     | grosze   |
+ *
+ * Przyrosty są sumowane bez zaokrągleń (reszty poniżej km / litra są
+ * przechowywane osobno), więc należność nie dryfuje niezależnie od liczby
+ * próbek. Aktualizacja stanu i wyliczenie snapshotu są O(1).
+ *
+ * Składniki należności (TariffTable, tariff_table.h):
+ * - opłata początkowa
+ * - MODE_KM: każdy rozpoczęty kilometr wg stawki progu, w którym się zaczyna,
+ *   z mnożnikiem obowiązującym w chwili rozpoczęcia km
+ * - MODE_LITRE: stawka x zużyte paliwo x mnożnik
+ * - postój: stawka za minutę, gdy prędkość próbki jest poniżej progu
+ *
+ * Każdy składnik jest zaokrąglany do grosza osobno (połówki w górę).
+ *
+ * Klasa FareEngine nie zależy od Arduino (walidacja na hoście: tools/fare_bench.cpp).
+ * Współdzielona instancja dla firmware jest dostępna przez namespace Fare
+ * (chroniona sekcją krytyczną).
+ */
+
+#ifndef FARE_ENGINE_H
+#define FARE_ENGINE_H
+
+#include <stdint.h>
+#include "tariff_table.h"
+
+/**
+ * @class FareEngine
+ * @brief Akumulator przejazdu z wyliczaniem należności w groszach
+ */
+class FareEngine {
+public:
+    static constexpr uint32_t MM_PER_KM = 1000000;      ///< mm w kilometrze
+    static constexpr uint32_t UL_PER_LITRE = 1000000;   ///< µl w litrze
+
+    /**
+     * @struct Snapshot
+     * @brief Spójny obraz stanu przejazdu dla wszystkich odbiorców
+     */
+    struct Snapshot {
+        uint32_t distanceM;     ///< Przejechany dystans [m]
+        uint32_t fuelMl;        ///< Zużyte paliwo [ml]
+        uint32_t elapsedMs;     ///< Czas naliczania (bez pauz) [ms]
+        uint32_t waitingMs;     ///< Czas postoju [ms]
+        uint32_t startedKm;     ///< Rozpoczęte kilometry (minimum 1)
+        uint32_t dueGr;         ///< Należność [gr]
+        uint32_t flagFallGr;    ///< W tym: opłata początkowa [gr]
+        uint32_t waitingGr;     ///< W tym: postój [gr]
+        uint32_t rateGr;        ///< Bieżąca stawka [gr/km lub gr/l]
+        uint8_t multiplierPct;  ///< Bieżący mnożnik [%]
+        uint8_t mode;           ///< Tryb taryfy (TariffTable::Mode)
+        uint32_t samples;       ///< Liczba przyjętych próbek
+    };
+
+    FareEngine();
+
+    /// @brief Zeruje przejazd (taryfa i mnożnik pozostają bez zmian)
+    void reset();
+
+    /**
+     * @brief Ustawia taryfę prostą (jedna stawka)
+     * @param mode Tryb taryfy (0 = za km, 1 = za litr)
+     * @param rateGr Stawka w groszach za jednostkę
+     */
+    void setTariff(uint8_t mode, uint32_t rateGr);
+
+    /**
+     * @brief Ustawia skompilowaną taryfę
+     *
+     * Nowe stawki obowiązują od kolejnego rozpoczętego km / próbki,
+     * już naliczona kwota nie jest przeliczana.
+     */
+    void setTable(const TariffTable& table);
+
+    /// @brief Zwraca aktywną taryfę
+    const TariffTable& table() const { return tariff; }
+
+    /**
+     * @brief Ustawia bieżący czas lokalny (mnożnik pory dnia / święta)
+     *
+     * Wystarczy wywoływać raz na minutę lub przy każdej próbce - tablica
+     * jest odczytywana tylko gdy zmieni się godzina lub dzień.
+     * @param weekday 0=pon .. 6=nd, 0xFF gdy czas nieznany (mnożnik 100%)
+     */
+    void setClock(uint8_t weekday, uint8_t hour, uint8_t month, uint8_t day);
+
+    /**
+     * @brief Odtwarza stan przejazdu (np. z checkpointu po restarcie)
+     * @param dueGr Należność zapisana w checkpoincie (0 = przelicz z dystansu/paliwa)
+     * @param waitingGr W tym: postój (Snapshot::waitingGr) - po odtworzeniu
+     *                  rozbicie należności zgadza się z sumą
+     */
+    void restore(uint32_t distanceM, uint32_t fuelMl, uint32_t elapsedMs,
+                 uint32_t waitingMs = 0, uint32_t dueGr = 0, uint32_t waitingGr = 0);
+
+    /**
+     * @brief Dodaje przyrost przejazdu - O(1)
+     * @param distanceMm Przyrost dystansu [mm]
+     * @param fuelUl Przyrost zużycia paliwa [µl]
+     * @param elapsedMs Przyrost czasu [ms]
+     * @param speedKmh Prędkość chwilowa [km/h] do wykrywania postoju,
+     *                 -1 = średnia prędkość z distanceMm / elapsedMs
+     */
+    void addSample(uint32_t distanceMm, uint32_t fuelUl, uint32_t elapsedMs, int16_t speedKmh = -1);
+
+    /// @brief Zwraca bieżący stan z wyliczoną należnością - O(1)
+    Snapshot snapshot() const;
+
+private:
+    TariffTable tariff;
+    uint8_t pct;                // Bieżący mnożnik [%]
+    uint8_t band;               // Indeks bieżącego progu km
+    uint16_t clockKey;          // Ostatni (dzień << 8 | godzina) dla setClock
+    uint8_t clockMonth;
+    uint8_t clockDay;
+
+    uint32_t km;                // Pełne kilometry
+    uint32_t mmInKm;            // Reszta dystansu poniżej km [mm]
+    uint32_t litres;            // Pełne litry
+    uint32_t ulInLitre;         // Reszta paliwa poniżej litra [µl]
+    uint32_t elapsed;           // [ms]
+    uint32_t waiting;           // [ms]
+    uint32_t samples;
+
+    uint32_t chargedKm;         // Rozpoczęte km już naliczone
+    uint32_t carriedGr;         // Należność przeniesiona z checkpointu (bez opłaty początkowej i postoju)
+    uint64_t kmAcc;             // Suma stawka x mnożnik za km [gr x %]
+    uint64_t fuelAcc;           // Suma µl x stawka x mnożnik [µl x gr x %]
+    uint64_t waitAcc;           // Suma ms x stawka x mnożnik [ms x gr/min x %]
+
+    uint32_t kmRate(uint32_t kmIndex);
+    void chargeStartedKm();
+    void loadMultiplier();
+};
+
+/**
+ * @namespace Fare
+ * @brief Współdzielony licznik przejazdu firmware (UI, task OBD, SD)
+ *
+ * Funkcje są bezpieczne do wywołania z dowolnego taska.
+ */
+namespace Fare {
+
+    /// @brief Zeruje licznik przejazdu
+    void reset();
+
+    /// @brief Ustawia taryfę prostą (stawka w groszach)
+    void setTariff(uint8_t mode, uint32_t rateGr);
+
+    /// @brief Ustawia skompilowaną taryfę
+    void setTable(const TariffTable& table);
+
+    /// @brief Aktualizuje mnożnik pory dnia na podstawie czasu systemowego (lokalnego, TARIFF::TIME_ZONE)
+    void updateClock();
+
+    /// @brief Odtwarza stan przejazdu z checkpointu
+    void restore(uint32_t distanceM, uint32_t fuelMl, uint32_t elapsedMs,
+                 uint32_t waitingMs, uint32_t dueGr, uint32_t waitingGr);
+
+    /// @brief Dodaje przyrost przejazdu [mm, µl, ms] z prędkością chwilową [km/h] (-1 = brak)
+    void addSample(uint32_t distanceMm, uint32_t fuelUl, uint32_t elapsedMs, int16_t speedKmh);
+
+    /// @brief Zwraca spójny snapshot przejazdu
+    FareEngine::Snapshot snapshot();
+
+}  // namespace Fare
+
+#endif  // FARE_ENGINE_H
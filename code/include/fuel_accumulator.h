@@ -0,0 +1,88 @@
+/**
+ * @file fuel_accumulator.h
+ * @brief Zużycie paliwa - całkowanie metodą trapezów próbek ze znacznikiem czasu
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Zastępuje regułę prostokątów (spalanie sprzed zapytania x czas od
+ * poprzedniej iteracji taska), która wliczała w przedział opóźnienie
+ * zapytań innych kanałów, a nieudany odczyt niejawnie wydłużał kolejny
+ * przedział:
+ *
+ * - każda próbka ma czas nadejścia odpowiedzi ECU (nie czas iteracji taska)
+ * - przedział między kolejnymi udanymi próbkami jest całkowany metodą
+ *   trapezów; nieudany odczyt nie przerywa całkowania - przedział trwa
+ *   do następnej udanej próbki
+ * - przedział dłuższy niż gapMs jest mostkowany liniowo i liczony w statystyce
+ *   (bridged); dłuższy niż maxGapMs nie jest całkowany (dropped) - np. utrata
+ *   łącza w trakcie trasy
+ * - całka w liczbach całkowitych ((q1 + q2) x dt, q w mL/h) - bez błędów
+ *   zaokrągleń narastających z liczbą próbek; koszt próbki jest stały
+ *   (mnożenie i dodawanie), więc częstsze odpytywanie spalania nie obciąża CPU
+ *
+ * Klasa nie zależy od Arduino (walidacja na hoście: tools/fuel_cycles.cpp).
+ */
+
+#ifndef FUEL_ACCUMULATOR_H
+#define FUEL_ACCUMULATOR_H
+
+#include <stdint.h>
+
+/**
+ * @class FuelAccumulator
+ * @brief Paliwo zużyte od startu przejazdu [µl] ze spalania chwilowego [L/h]
+ */
+class FuelAccumulator {
+public:
+    /**
+     * @struct Stats
+     * @brief Diagnostyka całkowania
+     */
+    struct Stats {
+        uint32_t samples;           ///< Udane próbki
+        uint32_t failed;            ///< Nieudane odczyty (przedział trwa dalej)
+        uint32_t bridged;           ///< Przedziały > gapMs całkowane liniowo
+        uint32_t bridgedMs;         ///< Łączny czas mostkowanych przedziałów [ms]
+        uint32_t dropped;           ///< Przedziały > maxGapMs pominięte
+        uint32_t droppedMs;         ///< Łączny czas pominiętych przedziałów [ms]
+    };
+
+    /**
+     * @param gapMs Przedział dłuższy = przerwa mostkowana (statystyka bridged)
+     * @param maxGapMs Przedział dłuższy = przerwa bez całkowania (dropped)
+     */
+    FuelAccumulator(uint32_t gapMs, uint32_t maxGapMs);
+
+    /// @brief Nowy przejazd
+    void reset();
+
+    /**
+     * @brief Próbka spalania
+     * @param tMs Czas nadejścia odpowiedzi ECU [ms]
+     * @param lph Spalanie [L/h], < 0 = nieudany odczyt
+     * @return false gdy przedział zakończony tą próbką został pominięty (> maxGapMs)
+     */
+    bool addSample(uint32_t tMs, float lph);
+
+    /**
+     * @brief Paliwo od startu przejazdu [µl] (niemalejące)
+     */
+    uint64_t totalUl() const;
+
+    /// @brief Diagnostyka całkowania
+    Stats stats() const { return st; }
+
+private:
+    uint32_t gapMs;
+    uint32_t maxGapMs;
+
+    // Całkowanie: suma (q1 + q2) x dt [mL/h x ms], µl = suma / 7200
+    uint64_t acc;
+    bool haveSample;
+    uint32_t lastMs;
+    uint32_t lastMlph;              ///< Ostatnie spalanie [mL/h]
+    Stats st;
+};
+
+#endif  // FUEL_ACCUMULATOR_H
@@ -0,0 +1,157 @@
+/**
+ * @file gps_emulator.h
+ * @brief Emulator odbiornika GPS u-blox (NMEA + komendy UBX) na zegarze wirtualnym
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Emulator zachowuje się jak moduł podłączony do UART, więc narzędzia hosta
+ * przechodzą przez konfigurację GpsSetup (gps_setup.h) i parser NMEA
+ * (nmea_parser.h) tak jak firmware:
+ *
+ * - po włączeniu zasilania: prędkość Config::baud, 1 Hz, zdania GGA, GLL,
+ *   GSA, GSV (3 zdania), RMC, VTG
+ * - bajty nadane przy innej prędkości niż bieżąca modułu są dla niego
+ *   szumem, a jego bajty odbierane przy złej prędkości są przekłamane
+ * - nadawanie jest ograniczone prędkością UART; zdania epoki, które nie
+ *   mieszczą się w buforze nadawczym (TX_BUFFER), są gubione
+ * - CFG-PRT (zmiana prędkości - potwierdzenie ginie przy przełączeniu),
+ *   CFG-MSG (zdania NMEA), CFG-RATE (okres krótszy niż Config::minRateMs -> NAK),
+ *   AID-INI (pozycja i czas), inne ramki CFG -> NAK
+ * - TTFF: Config::coldTtffMs; pozycja z AID-INI zgodna z rzeczywistą
+ *   w granicach podanej niepewności skraca go do posTtffMs, pozycja i czas
+ *   do aidedTtffMs; hotTtffMs przy starcie z podtrzymaniem bateryjnym
+ *   (backupStart() - moduł zachowuje konfigurację i efemerydy)
+ *
+ * Czasy TTFF są parametrami modelu (domyślnie zbliżone do kart katalogowych
+ * NEO-6M / M8), nie pomiarem. Trasa: jazda na wschód ze stałą prędkością.
+ *
+ * Moduł nie zależy od Arduino (tools/gps_bench.cpp).
+ */
+
+#ifndef GPS_EMULATOR_H
+#define GPS_EMULATOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "gps_setup.h"
+
+/**
+ * @class GpsEmulator
+ * @brief Odbiornik GPS z UART sterowany czasem wywołującego
+ */
+class GpsEmulator {
+public:
+    static constexpr size_t TX_BUFFER = 1024;       ///< Bufor nadawczy modułu [B]
+
+    /**
+     * @struct Config
+     * @brief Model odbiornika i trasy
+     */
+    struct Config {
+        bool ubx;                   ///< Odbiornik u-blox (false = tylko NMEA, komendy ignorowane)
+        uint32_t baud;              ///< Prędkość UART po włączeniu zasilania
+        uint16_t minRateMs;         ///< Najkrótszy okres epok (NEO-6M: 200, M8: 100)
+        uint32_t coldTtffMs;        ///< TTFF bez danych pomocniczych [ms]
+        uint32_t posTtffMs;         ///< TTFF ze zgodną pozycją AID-INI [ms]
+        uint32_t aidedTtffMs;       ///< TTFF ze zgodną pozycją i czasem AID-INI [ms]
+        uint32_t hotTtffMs;         ///< TTFF po backupStart() (efemerydy w module) [ms]
+        uint8_t jitterPct;          ///< Rozrzut TTFF (+/- %)
+        int32_t latE7;              ///< Pozycja w chwili 0 zegara wywołującego [1e-7 stopnia]
+        int32_t lngE7;
+        uint32_t speedMmS;          ///< Prędkość jazdy na wschód [mm/s]
+        uint32_t utc;               ///< Czas UTC w chwili 0 zegara wywołującego [s od 1970]
+        uint32_t seed;              ///< Ziarno generatora losowego
+    };
+
+    /**
+     * @struct Stats
+     * @brief Liczniki emulatora
+     */
+    struct Stats {
+        uint32_t commands;          ///< Odebrane ramki UBX
+        uint32_t acks;              ///< Wysłane ACK
+        uint32_t naks;              ///< Wysłane NAK
+        uint32_t garbledIn;         ///< Bajty odebrane przy złej prędkości
+        uint32_t garbledOut;        ///< Bajty nadane przy złej prędkości hosta
+        uint32_t epochs;            ///< Epoki pomiarowe
+        uint32_t droppedBytes;      ///< Bajty zdań zgubione (pełny bufor nadawczy)
+        uint32_t sentences;         ///< Nadane zdania NMEA
+    };
+
+    /**
+     * @brief Model domyślny: u-blox NEO-6M (9600 bd, maks. 5 Hz), cold start ~27 s
+     */
+    static Config defaultConfig();
+
+    explicit GpsEmulator(const Config& config);
+
+    /**
+     * @brief Włączenie zasilania modułu: ustawienia fabryczne, bez efemeryd
+     */
+    void powerOn(uint32_t tMs);
+
+    /**
+     * @brief Włączenie zasilania przy podtrzymaniu bateryjnym: ustawienia i efemerydy zachowane (hot start)
+     */
+    void backupStart(uint32_t tMs);
+
+    /**
+     * @brief Bajty od hosta nadane z prędkością hostBaud
+     */
+    void receive(uint32_t tMs, const uint8_t* data, size_t len, uint32_t hostBaud);
+
+    /**
+     * @brief Bajty nadane przez moduł do chwili tMs (odbierane z prędkością hostBaud)
+     * @return Liczba bajtów w out
+     */
+    size_t transmit(uint32_t tMs, uint32_t hostBaud, uint8_t* out, size_t maxLen);
+
+    /// @brief Bieżąca prędkość UART modułu
+    uint32_t baud() const { return uartBaud; }
+
+    /// @brief Bieżący okres epok [ms]
+    uint16_t rateMs() const { return measRateMs; }
+
+    /// @brief Chwila pierwszego fixu [ms] (czas wywołującego)
+    uint32_t fixAtMs() const { return fixMs; }
+
+    /// @brief Rzeczywista pozycja w chwili tMs
+    void truth(uint32_t tMs, int32_t& latE7, int32_t& lngE7) const;
+
+    /// @brief Liczniki
+    Stats stats() const { return st; }
+
+private:
+    void factoryReset();
+    void handle(uint32_t tMs);
+    void aid(uint32_t tMs);
+    void reply(uint8_t id, uint8_t cls, uint8_t msgId);
+    void produce(uint32_t tMs);
+    void epoch(uint32_t tMs);
+    void sentence(const char* body);
+    void enqueue(const uint8_t* data, size_t len);
+    uint32_t ttff(uint32_t baseMs);
+    uint32_t random();
+
+    Config cfg;
+    Stats st;
+    uint32_t rng;
+
+    uint32_t powerMs;           // Chwila włączenia zasilania
+    uint32_t uartBaud;
+    uint16_t measRateMs;
+    uint8_t nmeaRates[6];       // GpsSetup::NMEA_* -> co ile epok (0 = wyłączone)
+    uint32_t nextEpochMs;
+    uint32_t fixMs;
+
+    GpsSetup::UbxScanner scanner;
+
+    // Bufor nadawczy (pierścień) i nadawanie ograniczone prędkością
+    uint8_t tx[TX_BUFFER];
+    size_t txHead, txCount;
+    uint32_t txAtMs;
+    uint32_t txCreditMilli;     // Niewykorzystana część bajtu [1/1000 B]
+};
+
+#endif  // GPS_EMULATOR_H
@@ -0,0 +1,128 @@
+/**
+ * @file gps_odometer.h
+ * @brief Dystans z pozycji GPS - filtr jakości, postoju i skoków, O(1) na fix
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Sumuje odcinki między kolejnymi przyjętymi pozycjami (przybliżenie
+ * równoodległościowe w liczbach całkowitych: 1e-7 stopnia -> mm, cos
+ * szerokości z tablicy co 1 stopień z interpolacją, pierwiastek całkowity).
+ * Na odcinkach do kilku km błąd przybliżenia jest pomijalny wobec błędu GPS.
+ *
+ * Filtry (kolejno):
+ * - jakość: fix nieważny, HDOP > maxHdop lub satelitów < minSats - pomijany
+ * - skok: odcinek od poprzedniego fixu, który przeszedł test, dłuższy niż droga
+ *   przy maxSpeedMmS - a bez przerwy w odbiorze przy prędkości Dopplera (bez
+ *   niej: z poprzedniego odcinka) + jumpMarginMmS - jest odrzucany; po
+ *   maxOutliers odrzuceniach z rzędu kotwica przenosi się na nową pozycję bez
+ *   doliczania dystansu (błędna była poprzednia pozycja)
+ * - postój: dopóki prędkość Dopplera z RMC jest poniżej stationaryMmS lub
+ *   nieznana, pozycja musi odejść od kotwicy (ostatniej pozycji, od której
+ *   doliczono dystans) dalej niż promień szumu (driftMinMm, rośnie z HDOP) -
+ *   błądzenie pozycji na postoju nie nabija km
+ *
+ * Przerwa w fixach (tunel) daje cięciwę między ostatnią a nową pozycją -
+ * dolne oszacowanie, o ile spełnia test skoku.
+ *
+ * Klasa nie zależy od Arduino (walidacja na hoście: tools/gps_distance_replay.cpp).
+ */
+
+#ifndef GPS_ODOMETER_H
+#define GPS_ODOMETER_H
+
+#include <stdint.h>
+
+/**
+ * @class GpsOdometer
+ * @brief Niemalejący dystans [mm] z kolejnych fixów GPS
+ */
+class GpsOdometer {
+public:
+
+    /**
+     * @struct Config
+     * @brief Progi filtrów (wartości firmware: cabulator_settings.h, GPS::ODO_*)
+     */
+    struct Config {
+        uint16_t maxHdop = 300;             ///< Maks. HDOP x100
+        uint8_t minSats = 5;                ///< Min. liczba satelitów
+        uint32_t stationaryMmS = 700;       ///< Prędkość Dopplera poniżej = postój [mm/s]
+        uint32_t driftMinMm = 10000;        ///< Promień szumu przy HDOP <= 1 [mm]
+        uint32_t maxSpeedMmS = 70000;       ///< Maks. prędkość wynikająca z odcinka [mm/s]
+        uint32_t jumpMarginMmS = 5000;      ///< Margines ponad prędkość bieżącą [mm/s]
+        uint32_t dopplerWindowMs = 3000;    ///< Test prędkości bieżącej tylko dla przerwy w odbiorze do [ms]
+        uint8_t maxOutliers = 3;            ///< Odrzucenia z rzędu do przeniesienia kotwicy
+    };
+
+    /**
+     * @struct Stats
+     * @brief Liczniki filtrów
+     */
+    struct Stats {
+        uint32_t fixes;             ///< Wszystkie fixy
+        uint32_t accepted;          ///< Przyjęte (kotwica przesunięta)
+        uint32_t gated;             ///< Pominięte: nieważne, HDOP, satelity
+        uint32_t stationary;        ///< Pominięte: w promieniu szumu
+        uint32_t outliers;          ///< Odrzucone skoki
+        uint32_t reanchors;         ///< Przeniesienia kotwicy po serii odrzuceń
+    };
+
+    GpsOdometer();
+    explicit GpsOdometer(const Config& config);
+
+    /// @brief Zeruje dystans, kotwicę i liczniki
+    void reset();
+
+    /**
+     * @brief Nowy fix
+     * @param tMs Czas fixu [ms]
+     * @param valid Czy fix jest ważny
+     * @param latE7 Szerokość [1e-7 stopnia]
+     * @param lngE7 Długość [1e-7 stopnia]
+     * @param speedMmS Prędkość Dopplera [mm/s], < 0 = nieznana
+     * @param hdop HDOP x100
+     * @param sats Liczba satelitów
+     * @return Dystans doliczony przez ten fix [mm]
+     */
+    uint32_t addFix(uint32_t tMs, bool valid, int32_t latE7, int32_t lngE7,
+                    int32_t speedMmS, uint16_t hdop, uint8_t sats);
+
+    /**
+     * @brief Dystans od reset() [mm] - niemalejący, przekręca się po ~4295 km
+     *
+     * Odbiorcy liczą różnice (arytmetyka bez znaku).
+     */
+    uint32_t distanceMm() const { return total; }
+
+    /// @brief Liczniki filtrów
+    const Stats& stats() const { return st; }
+
+    /**
+     * @brief Długość odcinka [mm] (przybliżenie równoodległościowe)
+     * @return UINT32_MAX dla odcinków dłuższych niż ~1000 km
+     */
+    static uint32_t segmentMm(int32_t lat1E7, int32_t lng1E7, int32_t lat2E7, int32_t lng2E7);
+
+private:
+    void moveAnchor(uint32_t tMs, int32_t latE7, int32_t lngE7);
+
+    Config cfg;
+    Stats st;
+    uint32_t total;
+
+    bool anchored;
+    int32_t anchorLat;          // Ostatnia pozycja, od której doliczono dystans
+    int32_t anchorLng;
+    int32_t lastLat;            // Ostatni fix, który przeszedł test skoku
+    int32_t lastLng;
+    uint32_t lastMs;
+    uint32_t prevMs;            // Poprzedni fix po filtrze jakości (także odrzucony)
+    uint32_t estSpeedMmS;       // Prędkość z ostatniego odcinka, UINT32_MAX = nieznana
+    int32_t rejectLat;          // Ostatnia odrzucona pozycja
+    int32_t rejectLng;
+    uint32_t rejectMs;
+    uint8_t rejectRun;          // Odrzucone skoki z rzędu
+};
+
+#endif  // GPS_ODOMETER_H
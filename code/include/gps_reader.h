@@ -8,6 +8,38 @@
  * Pozwala na inicjalizację, pobieranie danych, sprawdzanie statusu
  * oraz debugowanie połączenia z GPS.
  *
+ * @details
+ * begin() konfiguruje moduł (gps_setup.h, UBX): prędkość GPS::CONFIG_BAUD,
+ * tylko RMC / GGA / GSA, okres epok GPS::FIX_RATE_MS; ostatnia zapisana
+ * pozycja (i czas UTC z Timebase, gdy znany) trafia do modułu jako
+ * dane pomocnicze. Odbiornik bez UBX zostaje przy 9600 bd i 1 Hz. Task
+ * zapisuje pozycję w magazynie ustawień po przesunięciu o
+ * GPS::AIDING_MIN_MOVE_M (nie częściej niż co GPS::AIDING_SAVE_MS) oraz na
+ * żądanie (requestAidingSave(), koniec trasy). Czas do pierwszego fixu
+ * i częstotliwość epok są w getStats().
+ *
+ * UART modułu czyta wyłącznie task GPS (GPS::task). Task śpi do zdarzenia
+ * odbioru UART (onReceive: próg FIFO lub przerwa w transmisji po końcu
+ * paczki zdań NMEA), opróżnia bufor, parsuje zdania na bieżąco
+ * (NmeaParser, nmea_parser.h - RMC, GGA, GSA do liczb całkowitych) i publikuje
+ * nowy Fix przez seqlock (seqlock.h). Ekrany, zapis trasy i inne taski
+ * czytają spójną kopię przez latest() - bez odpytywania UART i bez blokad.
+ * Taski zarejestrowane przez addListener() dostają powiadomienie
+ * (xTaskNotifyGive) po każdej publikacji.
+ *
+ * Każda nowa epoka pozycji trafia też do GpsOdometer (gps_odometer.h) -
+ * dystans z pozycji po filtrach jakości, postoju i skoków (Fix::odometerMm).
+ * Task OBD przekazuje każdą epokę (Fix::epochMs) do fuzji dystansu
+ * (distance_fusion.h) i porównuje dystans z pozycji z dystansem OBD.
+ *
+ * Czas UTC epok z RMC z szacowaną chwilą początku paczki zdań (pierwszy
+ * odczyt po przerwie TIMEBASE::BURST_GAP_MS, pomniejszony o czas nadania
+ * bajtów czekających w buforze) trafia do Timebase::addGpsEpoch()
+ * (timebase.h) - podstawa czasu UTC znaczników logów i zegara systemowego.
+ *
+ * Przepełnienia bufora / FIFO UART i błędne sumy kontrolne są liczone
+ * w getStats().
+ *
  * @see cabulator_settings.h Konfiguracja pinów i parametrów GPS
  */
 
@@ -16,6 +48,8 @@
 
 #include <Arduino.h>
 #include "../cabulator_settings.h"
+#include "gps_odometer.h"
+#include "gps_setup.h"
 
 /**
  * @namespace GPS
@@ -42,7 +76,14 @@ namespace GPS {
         uint16_t hdop;          ///< Precyzja pozioma HDOP (x100, np. 120 = 1.20)
         double lat;             ///< Szerokość geograficzna [stopnie]
         double lng;             ///< Długość geograficzna [stopnie]
-        
+        int32_t latE7;          ///< Szerokość [1e-7 stopnia] - wartość z parsera, bez zaokrągleń double
+        int32_t lngE7;          ///< Długość [1e-7 stopnia]
+        uint32_t speedMmS;      ///< Prędkość nad ziemią z RMC [mm/s]
+        uint16_t courseCdeg;    ///< Kurs z RMC [0.01 stopnia]
+        uint8_t fixType;        ///< Rodzaj fixu z GSA (1 = brak, 2 = 2D, 3 = 3D), 0 = nieznany
+        uint32_t odometerMm;    ///< Dystans z pozycji od startu [mm] (GpsOdometer, przekręca się - liczyć różnice)
+        uint32_t epochMs;       ///< Chwila ostatniej epoki pozycji przekazanej do GpsOdometer [ms od startu]
+
         uint16_t year;          ///< Rok (np. 2025)
         uint8_t month;          ///< Miesiąc (1-12)
         uint8_t day;            ///< Dzień (1-31)
@@ -52,24 +93,69 @@ namespace GPS {
         bool dateTimeValid;     ///< Czy data/czas są ważne
     };
 
+    /**
+     * @struct Stats
+     * @brief Liczniki odbioru NMEA
+     */
+    struct Stats {
+        uint32_t bytes;             ///< Odebrane bajty
+        uint32_t sentences;         ///< Zdania RMC / GGA / GSA z poprawną sumą kontrolną
+        uint32_t checksumErrors;    ///< Zdania RMC / GGA / GSA z błędną lub brakującą sumą kontrolną
+        uint32_t overruns;          ///< Przepełnienia bufora RX lub FIFO UART (utracone bajty)
+        uint32_t wakeups;           ///< Przebudzenia taska zdarzeniem UART
+        uint32_t fixes;             ///< Opublikowane próbki
+        GpsOdometer::Stats odometer;    ///< Liczniki filtrów dystansu z pozycji
+        GpsSetup::Result setup;         ///< Konfiguracja modułu przy starcie
+        uint32_t ttffMs;            ///< Czas do pierwszego fixu od startu ESP32 [ms], 0 = jeszcze brak
+        uint32_t fixRateMilliHz;    ///< Epoki pozycji w ostatnim oknie GPS::RATE_WINDOW_MS [mHz]
+        uint32_t aidingSaves;       ///< Zapisy ostatniej pozycji (start z danymi pomocniczymi)
+    };
+
     /**
      * @brief Inicjalizacja modułu GPS
      *
-     * Konfiguruje UART i rozpoczyna nasłuchiwanie danych NMEA.
-     * Należy wywołać raz w setup().
+     * Konfiguruje UART (bufor RX, próg FIFO, przerwa końca paczki), moduł
+     * (GpsSetup::configure - blokuje do ~1 s, gdy moduł nie odpowiada na UBX)
+     * i rejestruje callback zdarzeń odbioru. Należy wywołać raz w setup(),
+     * po Settings::begin() i przed uruchomieniem task().
      *
      * @note Piny i baudrate konfigurowane w cabulator_settings.h
      */
     void begin();
 
     /**
-     * @brief Pobiera najnowszą próbkę GPS
-     * @param[out] out Referencja do struktury Fix, która zostanie wypełniona danymi
-     * @return true jeśli udało się pobrać nowe dane, false jeśli brak nowych danych
+     * @brief Żądanie zapisu bieżącej pozycji jako danych pomocniczych przy następnym starcie
+     *
+     * Zapis wykonuje task GPS (z ważnym fixem i po przesunięciu o
+     * GPS::AIDING_MIN_MOVE_M od ostatniego zapisu), bez czekania na AIDING_SAVE_MS.
+     */
+    void requestAidingSave();
+
+    /**
+     * @brief Ostatnia opublikowana próbka GPS
      *
-     * @warning Sprawdź pole `out.valid` - może być false nawet przy return true
+     * Spójna kopia w stałym czasie (seqlock). Próbka starsza niż
+     * GPS::FIX_STALE_MS ma valid = false i dateTimeValid = false.
      */
-    bool poll(Fix& out);
+    Fix latest();
+
+    /**
+     * @brief Numer publikacji (zmienia się przy każdym nowym Fix)
+     */
+    uint32_t version();
+
+    /**
+     * @brief Rejestruje task powiadamiany (xTaskNotifyGive) o nowym Fix
+     * @return false gdy lista odbiorców jest pełna (GPS::MAX_LISTENERS)
+     *
+     * @note Powiadomienie może zbiec się z innymi - odbiorca porównuje version()
+     */
+    bool addListener(TaskHandle_t task);
+
+    /**
+     * @brief Zwraca kopię liczników odbioru
+     */
+    Stats getStats();
 
     /**
      * @brief Sprawdza, czy mamy aktualny fix GPS
@@ -86,40 +172,36 @@ namespace GPS {
      * - Statusie połączenia
      * - Liczbie satelitów
      * - Ostatniej pozycji
-     * - Wartości HDOP
+     * - Liczniki odbioru
      */
     void debugStatus();
 
     /**
-     * @brief Zwraca surowe linie NMEA z modułu GPS
-     * @return Wskaźnik do tablicy wskaźników na C-stringi z liniami NMEA
+     * @brief Kopiuje jedną z ostatnich surowych linii NMEA z modułu GPS
+     * @param age 0 = ostatnia linia, NmeaParser::HISTORY_LINES - 1 = najstarsza
+     * @param[out] out Bufor na linię (zakończoną zerem)
+     * @param outLen Rozmiar bufora
+     * @return Długość linii (0 gdy brak)
      *
      * Przydatne do debugowania i analizy surowych danych z GPS.
      *
-     * @note Dane są nadpisywane przy każdym wywołaniu poll()
+     * @note Historię nadpisuje task GPS bez blokady - kopia może być
+     *       niespójna, tylko do podglądu diagnostycznego
      */
-    /**
-     * @brief Ustaw systemowy zegar ESP32 na podstawie danych GPS
-     * @param fix Struktura Fix zawierająca dane daty/czasu z GPS
-     * @return true jeśli udało się ustawić zegar, false jeśli data/czas były nieważne
-     *
-     * Synchronizuje wewnętrzny zegar ESP32 z czasem z modułu GPS.
-     * Powinno być wywoływane gdy fix.dateTimeValid == true
-     */
-    bool setSystemTimeFromGPS(const Fix& fix);
-
-    const char* const* getLastRawLines();
+    size_t getRawLine(size_t age, char* out, size_t outLen);
 
     /**
-     * @brief Ostatnia pobrana próbka GPS
+     * @brief Task FreeRTOS - jedyny czytelnik UART modułu GPS
      *
-     * Globalna zmienna przechowująca ostatni odczyt.
-     * Aktualizowana automatycznie przez poll().
+     * Budzony zdarzeniem odbioru UART lub co GPS::IDLE_WAKE_MS. Parsuje
+     * zdania, publikuje Fix, co GPS::SAMPLE_MS przekazuje próbkę do zapisu
+     * trasy (SDManager::onGPSFix) i raz synchronizuje zegar systemowy.
+     * Powinien być uruchomiony przez xTaskCreate().
      *
-     * @see poll() do pobrania świeżych danych
+     * @param param Parametr przekazywany do tasku (nieużywany)
      */
-    extern Fix lastFix;
+    void task(void* param);
 
 }
 
-#endif // GPS_READER_H
\ No newline at end of file
+#endif // GPS_READER_H
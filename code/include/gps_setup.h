@@ -0,0 +1,197 @@
+/**
+ * @file gps_setup.h
+ * @brief Konfiguracja odbiornika GPS (UBX) i start z danymi pomocniczymi
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Moduł po włączeniu zasilania nadaje przy 9600 bd raz na sekundę sześć
+ * typów zdań (GGA, GLL, GSA, GSV, RMC, VTG) - ~500 B na epokę, więc łącze
+ * jest zajęte w połowie, a taksometr czyta tylko RMC, GGA i GSA. Przy starcie
+ * configure() ustawia odbiornik protokołem UBX (u-blox 6/7/8):
+ *
+ * - CFG-PRT - prędkość UART (wysyłana przy prędkości fabrycznej; gdy moduł
+ *   już pracuje z prędkością docelową, np. po restarcie samego ESP32,
+ *   ramka jest dla niego szumem i konfiguracja idzie dalej)
+ * - CFG-MSG - wyłączenie GLL, GSV, VTG, włączenie RMC, GGA, GSA
+ * - CFG-RATE - okres epok (5-10 Hz); odbiornik odrzucający okres (NAK,
+ *   np. NEO-6M powyżej 5 Hz) dostaje dwa razy dłuższy, a okres, którego
+ *   zdania nie mieszczą się w przepustowości łącza, jest wydłużany
+ * - AID-INI - ostatnia zapisana pozycja (bez wysokości) i czas systemowy,
+ *   gdy jest znany (restart ESP32 bez utraty zegara RTC); moduł z pozycją
+ *   i czasem wie, których satelitów szukać
+ *
+ * Każda ramka CFG czeka na UBX-ACK. Moduł, który nie potwierdza żadnej
+ * ramki (odbiornik tylko NMEA), zostaje przy prędkości fabrycznej i 1 Hz -
+ * parser NMEA pomija nieużywane zdania.
+ *
+ * Konfiguracja nie jest zapisywana w pamięci modułu (CFG-CFG) - po odłączeniu
+ * zasilania moduł wraca do ustawień fabrycznych, a kolejny start powtarza
+ * sekwencję.
+ *
+ * Moduł nie zależy od Arduino - bajty przesyła Port (firmware: Serial2
+ * w gps_reader.cpp, host: emulator odbiornika gps_emulator.h,
+ * tools/gps_bench.cpp).
+ */
+
+#ifndef GPS_SETUP_H
+#define GPS_SETUP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace GpsSetup {
+
+    constexpr uint32_t FACTORY_BAUD = 9600;     ///< Prędkość UART po włączeniu zasilania modułu
+    constexpr uint8_t AIDING_VERSION = 1;       ///< Wersja układu Aiding (zmiana = zapis pomijany)
+    constexpr uint16_t EPOCH_BYTES = 240;       ///< RMC + GGA + GSA jednej epoki [B] (z zapasem)
+    constexpr uint8_t LINK_UTIL_PCT = 60;       ///< Maks. zajętość łącza zdaniami NMEA [%]
+    constexpr size_t MAX_PAYLOAD = 48;          ///< Najdłuższa obsługiwana ramka UBX (AID-INI)
+    constexpr size_t MAX_FRAME = MAX_PAYLOAD + 8;
+
+    /// @name Klasy i identyfikatory komunikatów UBX
+    /// @{
+    constexpr uint8_t CLS_ACK = 0x05;
+    constexpr uint8_t CLS_CFG = 0x06;
+    constexpr uint8_t CLS_AID = 0x0B;
+    constexpr uint8_t CLS_NMEA = 0xF0;          ///< Zdania NMEA w CFG-MSG (identyfikator = NMEA_*)
+    constexpr uint8_t ID_ACK_NAK = 0x00;
+    constexpr uint8_t ID_ACK_ACK = 0x01;
+    constexpr uint8_t ID_CFG_PRT = 0x00;
+    constexpr uint8_t ID_CFG_MSG = 0x01;
+    constexpr uint8_t ID_CFG_RATE = 0x08;
+    constexpr uint8_t ID_AID_INI = 0x01;
+    /// @}
+
+    /// @name Identyfikatory zdań NMEA (CFG-MSG, klasa CLS_NMEA)
+    /// @{
+    constexpr uint8_t NMEA_GGA = 0x00;
+    constexpr uint8_t NMEA_GLL = 0x01;
+    constexpr uint8_t NMEA_GSA = 0x02;
+    constexpr uint8_t NMEA_GSV = 0x03;
+    constexpr uint8_t NMEA_RMC = 0x04;
+    constexpr uint8_t NMEA_VTG = 0x05;
+    /// @}
+
+    /// @name Flagi AID-INI (pole flags)
+    /// @{
+    constexpr uint32_t AID_POS_VALID = 1 << 0;
+    constexpr uint32_t AID_TIME_VALID = 1 << 1;
+    constexpr uint32_t AID_LLA = 1 << 5;        ///< Pozycja jako szerokość / długość / wysokość
+    constexpr uint32_t AID_ALT_INVALID = 1 << 6;
+    /// @}
+
+    /**
+     * @struct Aiding
+     * @brief Ostatnia pozycja zapisywana w pamięci flash (start z danymi pomocniczymi)
+     */
+    struct Aiding {
+        uint8_t version;        ///< AIDING_VERSION, 0 = brak danych
+        int32_t latE7;          ///< Szerokość [1e-7 stopnia]
+        int32_t lngE7;          ///< Długość [1e-7 stopnia]
+        uint32_t utc;           ///< Czas zapisu [s od 1970-01-01 UTC]
+    };
+
+    /**
+     * @struct Port
+     * @brief Łącze z modułem (wszystkie funkcje wymagane)
+     */
+    struct Port {
+        void (*setBaud)(uint32_t baud);                                 ///< Zmiana prędkości UART po stronie ESP32
+        void (*write)(const uint8_t* data, size_t len);                 ///< Wysłanie (powrót po nadaniu)
+        size_t (*read)(uint8_t* buf, size_t len, uint32_t timeoutMs);   ///< Odbiór, czeka na bajty do timeoutMs
+        uint32_t (*nowMs)();                                            ///< Źródło czasu
+    };
+
+    /**
+     * @struct Options
+     * @brief Żądana konfiguracja
+     */
+    struct Options {
+        uint32_t baud;              ///< Prędkość docelowa UART
+        uint16_t rateMs;            ///< Żądany okres epok [ms] (200 = 5 Hz)
+        uint32_t ackTimeoutMs;      ///< Oczekiwanie na UBX-ACK
+        const Aiding* aiding;       ///< Ostatnia pozycja, nullptr = brak
+        uint32_t posAccM;           ///< Niepewność zapisanej pozycji [m] (wysokość nieznana)
+        uint32_t utcNow;            ///< Bieżący czas UTC [s], 0 = nieznany
+        uint32_t timeAccMs;         ///< Niepewność utcNow [ms]
+    };
+
+    /**
+     * @struct Result
+     * @brief Wynik konfiguracji
+     */
+    struct Result {
+        bool ubx;                   ///< Moduł potwierdza ramki UBX
+        uint32_t baud;              ///< Prędkość UART po konfiguracji
+        uint16_t rateMs;            ///< Okres epok po konfiguracji [ms]
+        uint8_t acked;              ///< Potwierdzone ramki CFG
+        uint8_t nacked;             ///< Odrzucone ramki CFG
+        bool aidedPosition;         ///< Wysłana pozycja AID-INI
+        bool aidedTime;             ///< Wysłany czas AID-INI
+        uint32_t durationMs;        ///< Czas konfiguracji [ms]
+    };
+
+    /**
+     * @brief Konfiguracja modułu i wysłanie danych pomocniczych
+     *
+     * Zaczyna od prędkości FACTORY_BAUD; po powrocie Port pracuje z Result::baud.
+     *
+     * @return true gdy moduł potwierdza UBX (w przeciwnym razie Result::baud =
+     *         FACTORY_BAUD, rateMs = 1000)
+     */
+    bool configure(const Port& port, const Options& options, Result& result);
+
+    /**
+     * @brief Najkrótszy okres epok, którego zdania mieszczą się w łączu (EPOCH_BYTES, LINK_UTIL_PCT) [ms]
+     */
+    uint16_t minRateMs(uint32_t baud);
+
+    /// @name Ramki UBX (zwracają długość ramki, 0 gdy out jest za mały)
+    /// @{
+    size_t frame(uint8_t cls, uint8_t id, const uint8_t* payload, uint16_t len, uint8_t* out, size_t outLen);
+    size_t cfgPrt(uint32_t baud, uint8_t* out, size_t outLen);
+    size_t cfgMsg(uint8_t nmeaId, uint8_t rate, uint8_t* out, size_t outLen);
+    size_t cfgRate(uint16_t rateMs, uint8_t* out, size_t outLen);
+    size_t aidIni(const Aiding& aiding, uint32_t posAccM, uint32_t utcNow, uint32_t timeAccMs,
+                  uint8_t* out, size_t outLen);
+    /// @}
+
+    /**
+     * @brief Czas UTC [s od 1970-01-01] z daty i czasu doby (np. z RMC)
+     */
+    uint32_t unixTime(uint16_t year, uint8_t month, uint8_t day, uint32_t timeOfDayMs);
+
+    /**
+     * @class UbxScanner
+     * @brief Wyszukiwanie ramek UBX w strumieniu przeplatanym z NMEA
+     */
+    class UbxScanner {
+    public:
+        UbxScanner() { reset(); }
+
+        void reset();
+
+        /**
+         * @brief Przetwarza bajt
+         * @return true gdy bajt zakończył ramkę z poprawną sumą kontrolną
+         */
+        bool feed(uint8_t b);
+
+        uint8_t cls() const { return msgCls; }
+        uint8_t id() const { return msgId; }
+        uint16_t length() const { return len; }
+        const uint8_t* payload() const { return buf; }
+
+    private:
+        uint8_t state;
+        uint8_t msgCls, msgId;
+        uint16_t len, pos;
+        uint8_t ckA, ckB;
+        bool overflow;
+        uint8_t buf[MAX_PAYLOAD];
+    };
+
+}  // namespace GpsSetup
+
+#endif  // GPS_SETUP_H
@@ -0,0 +1,88 @@
+/**
+ * @file link_capture.h
+ * @brief Przechwytywanie surowego ruchu ELM327 i NMEA do pliku trasy
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Tryb diagnostyczny (SDCARD::CAPTURE_MODE): każdy bajt wysłany do ELM327,
+ * odebrany z ELM327 i odebrany z modułu GPS jest zapisywany ze znacznikiem
+ * czasu micros() do pliku link_capture.bin w folderze trasy. Nagranie
+ * z prawdziwego samochodu można potem odtworzyć na hoście
+ * (capture_replay.h, tools/capture_replay.cpp) przez ten sam kod parsowania
+ * OBD i GPS - bez samochodu i bez ESP32.
+ *
+ * Producenci (handler Bluetooth, task OBD, task GPS) wywołują record()
+ * z całym odebranym fragmentem. record() kopiuje bajty do bufora
+ * pierścieniowego w RAM (SDCARD::CAPTURE_BUFFER_BYTES) w krótkiej sekcji
+ * krytycznej i nigdy nie czeka na kartę SD. Przy przepełnieniu fragment
+ * jest odrzucany, a liczba utraconych bajtów trafia do pliku jako rekord
+ * CAPTURE_LOST - odtwarzanie wie, gdzie strumień ma lukę.
+ *
+ * Bufor opróżnia task zapisu TripLogger (pop()), kodując fragmenty do
+ * bloków formatu TripLogFormat (STREAM_CAPTURE) i zapisując je paczkami
+ * razem z pozostałymi plikami sesji. Task jest budzony, gdy bufor
+ * zapełni się do połowy.
+ *
+ * Przy wyłączonym przechwytywaniu record() to jeden odczyt flagi.
+ */
+
+#ifndef LINK_CAPTURE_H
+#define LINK_CAPTURE_H
+
+#include <Arduino.h>
+#include "trip_log_format.h"
+
+namespace LinkCapture {
+
+    /**
+     * @struct Stats
+     * @brief Liczniki diagnostyczne przechwytywania
+     */
+    struct Stats {
+        uint32_t bytes[TripLogFormat::CAPTURE_CHANNELS];   ///< Przyjęte bajty na kanał (CAPTURE_LOST: utracone)
+        uint32_t chunks;            ///< Przyjęte fragmenty
+        uint32_t maxUsed;           ///< Maksymalne zajęcie bufora [B]
+    };
+
+    /**
+     * @brief Włącza lub wyłącza przechwytywanie (włączenie czyści bufor i liczniki)
+     */
+    void setEnabled(bool on);
+
+    /**
+     * @brief Czy przechwytywanie jest włączone
+     */
+    bool enabled();
+
+    /**
+     * @brief Task budzony, gdy bufor zapełni się do połowy (nullptr = brak)
+     */
+    void setConsumer(TaskHandle_t task);
+
+    /**
+     * @brief Zapisuje bajty kanału do bufora (non-blocking)
+     * @param channel Kanał (CAPTURE_OBD_TX, CAPTURE_OBD_RX, CAPTURE_GPS_RX)
+     * @param data Bajty
+     * @param len Liczba bajtów (dzielona na fragmenty SDCARD::CAPTURE_CHUNK_MAX)
+     *
+     * @note Wywoływać z tasku lub callbacku transportu, nie z przerwania
+     */
+    void record(uint8_t channel, const uint8_t* data, size_t len);
+
+    /**
+     * @brief Pobiera najstarszy fragment z bufora (task zapisu)
+     * @param[out] chunk Fragment; data wskazuje na buf
+     * @param buf Bufor na bajty, co najmniej SDCARD::CAPTURE_CHUNK_MAX
+     * @return false gdy bufor jest pusty
+     */
+    bool pop(TripLogFormat::CaptureChunk& chunk, uint8_t* buf);
+
+    /**
+     * @brief Zwraca kopię liczników diagnostycznych
+     */
+    Stats getStats();
+
+}  // namespace LinkCapture
+
+#endif  // LINK_CAPTURE_H
@@ -0,0 +1,208 @@
+/**
+ * @file nmea_parser.h
+ * @brief Parser NMEA 0183 (RMC, GGA, GSA) do liczb stałoprzecinkowych, bez alokacji
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Zastępuje TinyGPSPlus w tasku GPS. Parser przyjmuje znaki w dowolnym
+ * podziale na fragmenty i dekoduje tylko pola używane przez taksometr:
+ * pozycję, prędkość, kurs, czas i datę, liczbę satelitów, HDOP i rodzaj
+ * fixu. Wartości są liczbami całkowitymi (1e-7 stopnia, mm/s, 0.01 stopnia,
+ * ms doby) - bez double i bez strtod.
+ *
+ * - Znak jest klasyfikowany jedną tablicą 256 B (cyfra, przecinek, '*', '$',
+ *   koniec linii); pole zdania wskazuje tablica rodzajów pól danego typu
+ *   zdania (RMC, GGA, GSA), więc każdy znak to jeden skok po stanie.
+ * - Suma kontrolna (XOR) jest liczona na bieżąco; wartości z pól trafiają do
+ *   bufora roboczego i są przepisywane do Data dopiero po zgodnej sumie.
+ * - Szybka ścieżka: zdanie innego typu (GSV, VTG, GLL, TXT...) jest po
+ *   rozpoznaniu adresu tylko przewijane do końca linii - bez sumy i pól.
+ * - Adres może mieć dowolny talker (GP, GN, GL, GA, BD).
+ *
+ * Historia surowych linii do podglądu diagnostycznego to pierścień bajtów
+ * z indeksami początków linii: znak jest zapisywany raz, bez kopiowania
+ * linii przy jej zakończeniu. Kopię linii robi dopiero czytelnik (rawLine()).
+ *
+ * Moduł nie zależy od Arduino (benchmark i fuzzing: tools/nmea_bench.cpp).
+ */
+
+#ifndef NMEA_PARSER_H
+#define NMEA_PARSER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @class NmeaParser
+ * @brief Strumieniowy parser zdań RMC / GGA / GSA
+ */
+class NmeaParser {
+public:
+    static constexpr size_t MAX_SENTENCE = 96;      ///< Dłuższa linia jest odrzucana (NMEA: 82)
+    static constexpr size_t HISTORY_BYTES = 512;    ///< Pierścień surowych linii (potęga 2)
+    static constexpr size_t HISTORY_LINES = 5;      ///< Pamiętane ostatnie linie
+
+    /**
+     * @enum Sentence
+     * @brief Typ zakończonego zdania
+     */
+    enum Sentence : uint8_t {
+        NONE = 0,           ///< Zdanie nie zakończone lub odrzucone
+        RMC,                ///< Pozycja, prędkość, kurs, data i czas
+        GGA,                ///< Pozycja, jakość fixu, satelity, HDOP
+        GSA,                ///< Rodzaj fixu (2D / 3D), HDOP
+        SENTENCE_TYPES
+    };
+
+    /// @name Flagi pól zaktualizowanych przez zdanie (Data::updated)
+    /// @{
+    static constexpr uint16_t UPD_POSITION = 1 << 0;
+    static constexpr uint16_t UPD_SPEED = 1 << 1;
+    static constexpr uint16_t UPD_COURSE = 1 << 2;
+    static constexpr uint16_t UPD_TIME = 1 << 3;
+    static constexpr uint16_t UPD_DATE = 1 << 4;
+    static constexpr uint16_t UPD_SATS = 1 << 5;
+    static constexpr uint16_t UPD_HDOP = 1 << 6;
+    static constexpr uint16_t UPD_STATUS = 1 << 7;      ///< Status RMC (A / V)
+    static constexpr uint16_t UPD_QUALITY = 1 << 8;     ///< Jakość fixu GGA
+    static constexpr uint16_t UPD_FIX_TYPE = 1 << 9;
+    /// @}
+
+    /**
+     * @struct Data
+     * @brief Ostatnie wartości ze zdań z poprawną sumą kontrolną
+     */
+    struct Data {
+        int32_t latE7;          ///< Szerokość [1e-7 stopnia]
+        int32_t lngE7;          ///< Długość [1e-7 stopnia]
+        uint32_t speedMmS;      ///< Prędkość nad ziemią [mm/s]
+        uint16_t courseCdeg;    ///< Kurs [0.01 stopnia], 0-35999
+        uint32_t timeMs;        ///< Czas UTC od północy [ms]
+        uint8_t day;            ///< Dzień (1-31), 0 = brak daty
+        uint8_t month;          ///< Miesiąc (1-12)
+        uint16_t year;          ///< Rok (np. 2025)
+        uint8_t sats;           ///< Satelity użyte do fixu
+        uint16_t hdop;          ///< HDOP x100
+        bool rmcValid;          ///< Status RMC 'A' (pozycja ważna)
+        uint8_t quality;        ///< Jakość GGA (0 = brak, 1 = GPS, 2 = DGPS, ...)
+        uint8_t fixType;        ///< Rodzaj fixu GSA (1 = brak, 2 = 2D, 3 = 3D), 0 = nieznany
+        uint16_t updated;       ///< Flagi UPD_* od ostatniego clearUpdated()
+    };
+
+    /**
+     * @struct Stats
+     * @brief Liczniki parsera
+     */
+    struct Stats {
+        uint32_t bytes;                     ///< Przetworzone znaki
+        uint32_t sentences[SENTENCE_TYPES]; ///< Zdania z poprawną sumą (indeks = Sentence, [NONE] = nieużywany)
+        uint32_t skipped;                   ///< Zdania innych typów (szybka ścieżka)
+        uint32_t checksumErrors;            ///< Zdania RMC/GGA/GSA z błędną lub brakującą sumą
+        uint32_t malformed;                 ///< Za długie linie, błędne pola
+    };
+
+    NmeaParser();
+
+    /**
+     * @brief Zeruje stan parsera, dane, historię i liczniki
+     */
+    void reset();
+
+    /**
+     * @brief Przetwarza jeden znak
+     * @return Typ zdania zakończonego tym znakiem (z poprawną sumą) lub NONE
+     */
+    Sentence encode(char c);
+
+    /**
+     * @brief Przetwarza fragment strumienia
+     * @return Liczba zdań RMC / GGA / GSA zakończonych w tym fragmencie
+     */
+    size_t feed(const uint8_t* data, size_t len);
+
+    /**
+     * @brief Ostatnie wartości (Data::updated - pola zmienione od clearUpdated())
+     */
+    const Data& data() const { return d; }
+
+    /**
+     * @brief Zeruje flagi Data::updated
+     */
+    void clearUpdated() { d.updated = 0; }
+
+    /**
+     * @brief Liczniki parsera
+     */
+    const Stats& stats() const { return st; }
+
+    /**
+     * @brief Kopia surowej linii z historii
+     * @param age 0 = ostatnia linia, HISTORY_LINES - 1 = najstarsza
+     * @param[out] out Bufor (linia zakończona zerem, przycięta do outLen - 1)
+     * @param outLen Rozmiar bufora
+     * @return Długość skopiowanej linii (0 gdy brak lub nadpisana w pierścieniu)
+     */
+    size_t rawLine(size_t age, char* out, size_t outLen) const;
+
+private:
+    // Stan automatu
+    enum State : uint8_t {
+        S_IDLE,             // Oczekiwanie na '$'
+        S_ADDRESS,          // Adres (talker + typ)
+        S_FIELDS,           // Pola zdania RMC / GGA / GSA
+        S_CHECKSUM,         // Dwie cyfry hex po '*'
+        S_SKIP              // Inny typ zdania - do końca linii
+    };
+
+    // Pola wczytane przez bieżące zdanie, poza flagami UPD_*
+    static constexpr uint16_t HAVE_LAT = 1 << 12;
+    static constexpr uint16_t HAVE_LNG = 1 << 13;
+    static constexpr uint16_t HAVE_NS = 1 << 14;
+    static constexpr uint16_t HAVE_EW = 1 << 15;
+
+    void startSentence();
+    void endAddress();
+    void endField();
+    Sentence endChecksum();
+    uint32_t fraction(uint8_t digits) const;
+    void commit();
+    void historyEnd();
+
+    // Pole w trakcie parsowania: część całkowita, ułamek i ewentualna litera
+    uint32_t intPart;
+    uint32_t fracPart;
+    uint8_t intDigits;
+    uint8_t fracDigits;
+    bool seenDot;
+    char letter;
+
+    State state;
+    uint8_t sentence;           // Sentence w trakcie parsowania
+    uint8_t field;              // Indeks pola (0 = adres)
+    uint8_t length;             // Znaki od '$'
+    uint8_t sum;                // XOR znaków między '$' a '*'
+    uint8_t given;              // Suma zapisana po '*'
+    uint8_t givenDigits;
+    bool bad;                   // Błędne pole - zdanie zostanie odrzucone
+    uint32_t address;           // Ostatnie 3 znaki adresu
+    const uint8_t* kinds;       // Rodzaje pól bieżącego typu zdania
+    uint8_t kindCount;
+
+    Data d;                     // Wartości zatwierdzone
+    Data pending;               // Wartości bieżącego zdania (do zgodnej sumy)
+    uint16_t have;              // Pola wczytane do pending (UPD_*, HAVE_*)
+    bool south;
+    bool west;
+    Stats st;
+
+    // Historia surowych linii
+    char history[HISTORY_BYTES];
+    uint32_t historyHead;                   // Zapisane znaki (licznik rosnący)
+    uint32_t lineStart;                     // Początek bieżącej linii
+    uint32_t lineStarts[HISTORY_LINES];     // Początki ostatnich linii
+    uint16_t lineLengths[HISTORY_LINES];
+    uint32_t lineCount;                     // Zakończone linie
+};
+
+#endif  // NMEA_PARSER_H
@@ -0,0 +1,127 @@
+/**
+ * @file obd_connection.h
+ * @brief Maszyna stanów połączenia z adapterem ELM327 (Bluetooth + ECU)
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Stan połączenia należy do taska OBD - setup() nie czeka na adapter,
+ * a zerwane połączenie jest odnawiane w tle:
+ *
+ * ```
+ *   DISCONNECTED --(termin)--> CONNECTING --ok--> ELM_INIT --ok--> READY
+ *        ^                         |                 |             |  ^
+ *        |<------ błąd, backoff ---+     błąd: ponowna            timeouty
+ *        |                                próba po backoff        v  | odpowiedź
+ *        |<------------- utrata transportu / lostAfter --------- DEGRADED
+ * ```
+ *
+ * - kolejne nieudane próby (połączenie lub inicjalizacja ELM) wydłużają
+ *   przerwę x2 od backoffMinMs do backoffMaxMs; sukces ją zeruje
+ * - DEGRADED: degradedAfter kolejnych zapytań bez odpowiedzi - odpytywanie
+ *   trwa (harmonogram sam zwalnia), pierwsza odpowiedź wraca do READY
+ * - lostAfter kolejnych zapytań bez odpowiedzi lub zerwany transport =
+ *   utrata łącza: rozłączenie i ponowne łączenie z backoffem
+ *
+ * Klasa nie wykonuje komunikacji - zwraca akcję do wykonania przez task
+ * (step) i przyjmuje wyniki (on...). Nie zależy od Arduino.
+ */
+
+#ifndef OBD_CONNECTION_H
+#define OBD_CONNECTION_H
+
+#include <stdint.h>
+
+/**
+ * @class ObdConnection
+ * @brief Stan połączenia, backoff i wykrywanie utraty łącza
+ */
+class ObdConnection {
+public:
+    /**
+     * @enum State
+     * @brief Stan połączenia
+     */
+    enum State : uint8_t {
+        DISCONNECTED,       ///< Brak połączenia - oczekiwanie na kolejną próbę
+        CONNECTING,         ///< Łączenie transportu (Bluetooth SPP)
+        ELM_INIT,           ///< Transport połączony, uruchamianie ELM327 / ECU
+        READY,              ///< ECU odpowiada
+        DEGRADED            ///< Kolejne zapytania bez odpowiedzi
+    };
+
+    /**
+     * @enum Action
+     * @brief Akcja do wykonania przez task
+     */
+    enum Action : uint8_t {
+        ACT_WAIT,           ///< Czekać (najwyżej waitMs)
+        ACT_CONNECT,        ///< Połączyć transport, wynik -> onConnectResult
+        ACT_INIT,           ///< Uruchomić ELM327, wynik -> onInitResult
+        ACT_POLL            ///< Odpytywać ECU, wynik zapytań -> onRequest
+    };
+
+    /**
+     * @struct Config
+     * @brief Progi i czasy
+     */
+    struct Config {
+        uint32_t backoffMinMs;      ///< Pierwsza przerwa po błędzie [ms]
+        uint32_t backoffMaxMs;      ///< Maksymalna przerwa [ms]
+        uint8_t degradedAfter;      ///< Zapytania bez odpowiedzi do DEGRADED
+        uint8_t lostAfter;          ///< Zapytania bez odpowiedzi do utraty łącza
+    };
+
+    /**
+     * @struct Stats
+     * @brief Liczniki połączenia
+     */
+    struct Stats {
+        uint32_t attempts;          ///< Próby połączenia transportu
+        uint32_t initFailures;      ///< Nieudane uruchomienia ELM327
+        uint32_t linkLosses;        ///< Utraty łącza w stanie READY / DEGRADED
+        uint32_t backoffMs;         ///< Bieżąca przerwa między próbami [ms]
+        uint32_t sinceMs;           ///< Chwila wejścia w bieżący stan [ms]
+        uint8_t timeoutStreak;      ///< Kolejne zapytania bez odpowiedzi
+    };
+
+    explicit ObdConnection(const Config& config);
+
+    /**
+     * @brief Akcja do wykonania teraz
+     * @param nowMs Bieżący czas [ms]
+     * @param[out] waitMs Dla ACT_WAIT: czas do kolejnej akcji [ms]
+     */
+    Action step(uint32_t nowMs, uint32_t& waitMs);
+
+    /// @name Wyniki akcji
+    /// @{
+    void onConnectResult(bool ok, uint32_t nowMs);
+    void onInitResult(bool ok, uint32_t nowMs);
+    void onRequest(bool answered, uint32_t nowMs);      ///< Zapytanie z odpowiedzią (także NO DATA) lub timeout
+    void onTransportLost(uint32_t nowMs);               ///< Transport zgłasza rozłączenie
+    /// @}
+
+    /// @brief Bieżący stan
+    State state() const { return current; }
+
+    /// @brief Czy ECU jest odpytywane (READY lub DEGRADED)
+    bool online() const { return current == READY || current == DEGRADED; }
+
+    /// @brief Liczniki
+    Stats stats() const { return st; }
+
+    /// @brief Krótka nazwa stanu (np. "READY")
+    static const char* label(State state);
+
+private:
+    void enter(State next, uint32_t nowMs);
+    void fail(State next, uint32_t nowMs);
+
+    Config cfg;
+    State current;
+    uint32_t nextAttemptMs;
+    Stats st;
+};
+
+#endif  // OBD_CONNECTION_H
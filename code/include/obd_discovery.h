@@ -0,0 +1,138 @@
+/**
+ * @file obd_discovery.h
+ * @brief Uruchomienie ELM327 z wykrywaniem obsługiwanych PID i pamięcią pojazdu
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Zastępuje stałą sekwencję ATZ / ATSP6 / 0100 z odstępami 500 ms:
+ *
+ * - każda komenda czeka tylko na znak zachęty '>' (bez stałych opóźnień)
+ * - pierwsze połączenie z pojazdem: protokół automatyczny (ATSP0), mapy
+ *   obsługiwanych PID Mode 01 (0100, 0120, 0140, 0160 - kolejna tylko gdy
+ *   poprzednia zgłasza jej istnienie), wykryty protokół (ATDPN), VIN (0902)
+ *   i próba odometru z profilu pojazdu (vehicle_profile.h); na koniec protokół jest ustawiany
+ *   na stałe, żeby ELM327 nie wyszukiwał go ponownie
+ * - źródło spalania: 015E (spalanie wprost), 0110 (MAF) albo MAP + RPM
+ *   (metoda speed-density)
+ * - wynik (Vehicle) zapisuje wywołujący w magazynie ustawień; przy kolejnym
+ *   uruchomieniu wystarcza ATSPx z zapamiętanym protokołem i odczyt VIN -
+ *   zgodny VIN pomija wykrywanie (inny pojazd lub inny profil pojazdu =
+ *   wykrywanie od nowa)
+ *
+ * Pojazd bez VIN (starsze ECU) jest rozpoznawany po mapie PID 01-20.
+ *
+ * Moduł nie zależy od Arduino - komendy wysyła funkcja Transact
+ * (firmware: ObdLink::transact, host: tools/obd_bench.cpp).
+ */
+
+#ifndef OBD_DISCOVERY_H
+#define OBD_DISCOVERY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "vehicle_profile.h"
+
+namespace ObdDiscovery {
+
+    constexpr uint8_t FORMAT_VERSION = 2;       ///< Wersja układu Vehicle (zmiana = ponowne wykrywanie)
+    constexpr size_t VIN_LEN = 17;              ///< Długość VIN
+    constexpr size_t PID_RANGES = 4;            ///< Mapy 0100..0160 (PID 01-80)
+
+    /// @name Czasy oczekiwania na odpowiedź [ms]
+    /// @{
+    constexpr uint32_t RESET_TIMEOUT_MS = 2500;     ///< ATZ (restart adaptera)
+    constexpr uint32_t AT_TIMEOUT_MS = 500;         ///< Pozostałe komendy AT
+    constexpr uint32_t SEARCH_TIMEOUT_MS = 10000;   ///< Pierwsze zapytanie z wyszukiwaniem protokołu
+    constexpr uint32_t ECU_TIMEOUT_MS = 1000;       ///< Zapytanie do ECU
+    constexpr uint32_t VIN_TIMEOUT_MS = 2000;       ///< 0902 (odpowiedź wieloramkowa)
+    /// @}
+
+    /**
+     * @enum FuelSource
+     * @brief Źródło chwilowego spalania
+     */
+    enum FuelSource : uint8_t {
+        FUEL_NONE,          ///< Brak - taryfa za litr niedostępna
+        FUEL_RATE,          ///< PID 015E - spalanie [L/h] wprost z ECU
+        FUEL_MAF,           ///< PID 0110 - przepływ powietrza
+        FUEL_MAP_RPM        ///< PID 010B + 010C (+ 010F) - speed-density
+    };
+
+    /**
+     * @enum Outcome
+     * @brief Wynik uruchomienia
+     */
+    enum Outcome : uint8_t {
+        FAILED,             ///< Adapter lub ECU nie odpowiada
+        CACHED,             ///< Pojazd rozpoznany, dane z pamięci
+        DISCOVERED          ///< Nowy pojazd - wykrywanie zakończone (do zapisu)
+    };
+
+    /**
+     * @struct Vehicle
+     * @brief Wynik wykrywania zapisywany w pamięci flash
+     */
+    struct Vehicle {
+        uint8_t version;                    ///< FORMAT_VERSION, 0 = brak danych
+        char vin[VIN_LEN + 1];              ///< VIN, "" gdy ECU go nie podaje
+        uint8_t protocol;                   ///< Protokół ELM327 (1-C), 0 = nieznany
+        uint32_t supported[PID_RANGES];     ///< Mapy PID Mode 01 (bit 31 = PID base+1)
+        uint8_t fuelSource;                 ///< FuelSource
+        bool odometer;                      ///< Czy ECU odpowiada na zapytanie odometru profilu
+        uint32_t profileId;                 ///< VehicleProfile::id profilu użytego przy wykrywaniu
+    };
+
+    /**
+     * @brief Wysłanie komendy i odbiór odpowiedzi (nullptr = brak odpowiedzi)
+     */
+    typedef const char* (*Transact)(const char* cmd, uint32_t timeoutMs);
+
+    /**
+     * @brief Restart adaptera i ustawienia formatu odpowiedzi (ATZ, ATE0, ATL0, ATS0, ATH0)
+     * @return false gdy adapter nie odpowiada
+     */
+    bool resetAdapter(Transact transact);
+
+    /**
+     * @brief Pełne uruchomienie: restart adaptera, rozpoznanie pojazdu lub wykrywanie
+     *
+     * @param transact Wysyłanie komend
+     * @param profile Profil pojazdu (zapytanie odometru)
+     * @param[in,out] vehicle Wejście: dane z pamięci (version 0 = brak);
+     *                wyjście: dane bieżącego pojazdu
+     * @return CACHED / DISCOVERED gdy ECU odpowiada, FAILED w przeciwnym razie
+     */
+    Outcome bringUp(Transact transact, const VehicleProfile& profile, Vehicle& vehicle);
+
+    /**
+     * @brief Wykrywanie pojazdu (protokół, mapy PID, VIN, odometr, źródło spalania)
+     * @return false gdy ECU nie odpowiada na 0100
+     */
+    bool discover(Transact transact, const VehicleProfile& profile, Vehicle& out);
+
+    /**
+     * @brief Czy PID Mode 01 jest obsługiwany wg map
+     */
+    bool isSupported(const Vehicle& vehicle, uint8_t pid);
+
+    /**
+     * @brief Najlepsze dostępne źródło spalania
+     */
+    FuelSource selectFuelSource(const Vehicle& vehicle);
+
+    /**
+     * @brief Krótka nazwa źródła spalania (np. "MAF")
+     */
+    const char* fuelSourceLabel(uint8_t source);
+
+    /// @name Parsery odpowiedzi
+    /// @{
+    bool parseBitmap(const char* response, uint8_t base, uint32_t& bits);
+    bool parseVin(const char* response, char* out);     ///< out: VIN_LEN + 1 znaków
+    int parseProtocol(const char* response);            ///< ATDPN -> 1-C, -1 gdy nieznany
+    /// @}
+
+}  // namespace ObdDiscovery
+
+#endif  // OBD_DISCOVERY_H
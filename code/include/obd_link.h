@@ -0,0 +1,119 @@
+/**
+ * @file obd_link.h
+ * @brief Warstwa transportowa ELM327 sterowana zdarzeniami Bluetooth SPP
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Zastępuje odpytywanie SerialBT znak po znaku z vTaskDelay(10):
+ *
+ * - handler transportu (ObdTransport - Bluetooth SPP lub emulator ELM327)
+ *   dopisuje odebrane bajty do bufora RX
+ * - po odebraniu znaku zachęty '>' task wysyłający komendę jest budzony
+ *   powiadomieniem (xTaskNotifyGive) - bez opóźnienia pollingu
+ * - komenda z "\r" jest wysyłana jednym zapisem
+ * - odpowiedź jest normalizowana w miejscu i zwracana jako wskaźnik do
+ *   bufora RX (bez kopiowania), ważny do następnej komendy
+ *
+ * ELM327 jest półdupleksowy (jedna komenda naraz), więc bufor RX zaczyna się
+ * od zera przy każdej komendzie i ramka odpowiedzi nigdy się nie zawija.
+ * Bajty odebrane poza komendą (np. po przekroczeniu czasu) są odrzucane.
+ *
+ * Opóźnienie każdej komendy (wysłanie -> '>') trafia do histogramu,
+ * z którego można odczytać medianę i p99.
+ *
+ * Komendy strumieniowe (nasłuch ATMA) nie mieszczą się w buforze RX -
+ * stream() przekazuje odebrane bajty wprost do handlera (np. CanMonitor)
+ * i po zadanym czasie przerywa nasłuch jednym znakiem.
+ *
+ * Przy SDCARD::CAPTURE_MODE wysłane komendy i wszystkie odebrane bajty
+ * (także odrzucone) trafiają do nagrania łącza (link_capture.h).
+ *
+ * @note Komendy wysyła jeden task naraz (task OBD).
+ */
+
+#ifndef OBD_LINK_H
+#define OBD_LINK_H
+
+#include <Arduino.h>
+#include "obd_transport.h"
+
+namespace ObdLink {
+
+    constexpr size_t RX_BUFFER_SIZE = 512;          ///< Rozmiar bufora odpowiedzi [B]
+    constexpr uint32_t HIST_BUCKET_MS = 4;          ///< Szerokość przedziału histogramu [ms]
+    constexpr size_t HIST_BUCKETS = 128;            ///< Liczba przedziałów (ostatni = przepełnienie)
+
+    /**
+     * @struct Stats
+     * @brief Statystyki komend ELM327
+     */
+    struct Stats {
+        uint32_t commands;          ///< Wysłane komendy
+        uint32_t timeouts;          ///< Komendy bez znaku '>' w czasie (także niewysłane - brak połączenia)
+        uint32_t overflows;         ///< Odpowiedzi przycięte do RX_BUFFER_SIZE
+        uint32_t discardedBytes;    ///< Bajty odebrane poza komendą
+        uint32_t lastUs;            ///< Opóźnienie ostatniej komendy [us]
+        uint32_t maxUs;             ///< Najdłuższe opóźnienie [us]
+    };
+
+    /**
+     * @brief Rejestruje handler odbioru danych w transporcie
+     * @param transport Transport do adaptera (Bluetooth przed connect() lub emulator)
+     */
+    void begin(ObdTransport& transport);
+
+    /**
+     * @brief Wysyła komendę i czeka na pełną odpowiedź (znak '>')
+     *
+     * Odpowiedź jest znormalizowana: linie rozdzielone pojedynczym '\\n',
+     * bez końcowych spacji i nowych linii.
+     *
+     * @param cmd Komenda bez "\\r" (np. "010D")
+     * @param timeoutMs Maksymalny czas oczekiwania [ms]
+     * @param[out] len Długość odpowiedzi (opcjonalnie)
+     * @return Wskaźnik do odpowiedzi w buforze RX (ważny do następnej komendy)
+     *         lub nullptr gdy odpowiedź jest pusta; transport bez połączenia
+     *         (write() nie przyjął komendy) zwraca nullptr od razu
+     */
+    const char* transact(const char* cmd, uint32_t timeoutMs, size_t* len = nullptr);
+
+    /// Odbiór bajtów komendy strumieniowej (kontekst handlera transportu)
+    typedef void (*StreamHandler)(const uint8_t* data, size_t size);
+
+    /**
+     * @brief Komenda strumieniowa (np. "ATMA") przez podany czas
+     *
+     * Bajty do znaku '>' trafiają do handlera zamiast bufora RX. Gdy adapter
+     * sam nie zakończy komendy (np. "?" lub "BUFFER FULL") w windowMs, nasłuch
+     * jest przerywany znakiem "\r" i funkcja czeka na '>' do stopTimeoutMs.
+     * Liczona jak jedna komenda, bez wpisu do histogramu opóźnień.
+     *
+     * @param cmd Komenda bez "\r"
+     * @param handler Odbiorca strumienia (wywoływany w sekcji krytycznej - krótko)
+     * @param windowMs Czas nasłuchu [ms]
+     * @param stopTimeoutMs Maksymalny czas oczekiwania na '>' po przerwaniu [ms]
+     * @return true gdy adapter wrócił do znaku zachęty (łącze działa)
+     */
+    bool stream(const char* cmd, StreamHandler handler, uint32_t windowMs, uint32_t stopTimeoutMs);
+
+    /**
+     * @brief Zwraca statystyki komend
+     */
+    Stats getStats();
+
+    /**
+     * @brief Percentyl opóźnienia komend z histogramu
+     * @param pct Percentyl 1-100 (50 = mediana, 99 = p99)
+     * @return Górna granica przedziału [ms], 0 gdy brak pomiarów
+     */
+    uint32_t latencyPercentileMs(uint8_t pct);
+
+    /**
+     * @brief Zeruje statystyki i histogram
+     */
+    void resetStats();
+
+}  // namespace ObdLink
+
+#endif  // OBD_LINK_H
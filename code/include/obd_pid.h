@@ -0,0 +1,153 @@
+/**
+ * @file obd_pid.h
+ * @brief Budowanie zapytań i parsowanie odpowiedzi Mode 01 z wieloma PID
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * ELM327 na magistrali CAN przyjmuje do 6 PID w jednym zapytaniu Mode 01
+ * (np. "010D10" = prędkość + MAF). ECU odpowiada jedną ramką lub ramką
+ * wieloczęściową ISO-TP:
+ * ```
+ * 410D3210 01F4               (jedna ramka, ATS0 -> bez spacji)
+ *
+ * 00A                         (liczba bajtów)
+ * 0:410D32100 1F4...          (kolejne ramki z indeksem "N:")
+ * 1:...
+ * ```
+ * Parser skleja ramki, usuwa indeksy i rozdziela odpowiedź na PID według
+ * znanych długości danych. Zapytania spoza Mode 01 (np. 22DD01) nie są
+ * łączone - wysyła się je pojedynczo.
+ *
+ * Moduł nie zależy od Arduino.
+ */
+
+#ifndef OBD_PID_H
+#define OBD_PID_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace ObdPid {
+
+    constexpr size_t MAX_BATCH = 6;         ///< Maksymalna liczba PID w jednym zapytaniu (ELM327, CAN)
+
+    /// @name Używane PID Mode 01
+    /// @{
+    constexpr uint8_t PID_SUPPORTED_01_20 = 0x00;
+    constexpr uint8_t PID_COOLANT_TEMP = 0x05;
+    constexpr uint8_t PID_MAP = 0x0B;
+    constexpr uint8_t PID_RPM = 0x0C;
+    constexpr uint8_t PID_SPEED = 0x0D;
+    constexpr uint8_t PID_INTAKE_TEMP = 0x0F;
+    constexpr uint8_t PID_MAF = 0x10;
+    constexpr uint8_t PID_FUEL_RATE = 0x5E;
+    /// @}
+
+    /**
+     * @struct Value
+     * @brief Surowe bajty danych jednego PID
+     */
+    struct Value {
+        uint8_t pid;            ///< Numer PID
+        bool valid;             ///< Czy PID był w odpowiedzi
+        uint8_t len;            ///< Liczba bajtów danych
+        uint8_t data[4];        ///< Bajty A, B, C, D
+    };
+
+    /**
+     * @brief Długość danych PID Mode 01
+     * @return Liczba bajtów (1-4) lub 0 gdy PID nie jest znany
+     */
+    uint8_t dataLength(uint8_t pid);
+
+    /**
+     * @brief Buduje zapytanie Mode 01 z listy PID (np. {0x0D, 0x10} -> "010D10")
+     * @param pids Lista PID (1..MAX_BATCH)
+     * @param count Liczba PID
+     * @param[out] out Bufor na komendę
+     * @param outLen Rozmiar bufora (>= 3 + 2 * count)
+     * @return false gdy lista jest pusta, za długa lub bufor za mały
+     */
+    bool buildRequest(const uint8_t* pids, size_t count, char* out, size_t outLen);
+
+    /**
+     * @brief Parsuje odpowiedź ELM327 na zapytanie Mode 01
+     *
+     * Obsługuje odpowiedzi jedno- i wieloramkowe (linie rozdzielone '\\n' lub '\\r',
+     * opcjonalne spacje). Wartości PID nieobecnych w odpowiedzi mają valid = false.
+     *
+     * @param response Tekst odpowiedzi (bez znaku zachęty '>')
+     * @param[in,out] values Tablica z wypełnionym polem pid dla każdego zapytanego PID
+     * @param count Liczba elementów values
+     * @return Liczba PID znalezionych w odpowiedzi
+     */
+    size_t parseResponse(const char* response, Value* values, size_t count);
+
+    /**
+     * @brief Skleja bajty odpowiedzi z wszystkich ramek (dowolny tryb)
+     *
+     * Pomija licznik bajtów i indeksy ramek ISO-TP oraz linie tekstowe
+     * (SEARCHING..., NO DATA).
+     *
+     * @param response Tekst odpowiedzi
+     * @param[out] bytes Bufor na bajty
+     * @param maxBytes Rozmiar bufora
+     * @return Liczba bajtów
+     */
+    size_t collectBytes(const char* response, uint8_t* bytes, size_t maxBytes);
+
+    /**
+     * @class BatchProbe
+     * @brief Rozpoznanie, czy ECU przyjmuje zapytania z wieloma PID
+     *
+     * Stan ustalają tylko odpowiedzi ECU. Pełna odpowiedź na zapytanie
+     * zbiorcze -> YES. Kilka kolejnych odpowiedzi bez żadnego PID (NO DATA)
+     * -> NO. Timeout, czyli utracona ramka Bluetooth, nie zmienia stanu,
+     * więc jedna zgubiona odpowiedź nie wyłącza zapytań zbiorczych
+     * do następnego uruchomienia ELM327.
+     */
+    class BatchProbe {
+    public:
+        enum State : uint8_t { UNKNOWN, YES, NO };
+
+        /// @param rejectsToDisable Kolejne puste odpowiedzi potrzebne do stanu NO
+        explicit BatchProbe(uint8_t rejectsToDisable) : limit(rejectsToDisable) {}
+
+        /// @brief Powrót do UNKNOWN (nowy pojazd / uruchomienie ELM327)
+        void reset() { current = UNKNOWN; rejects = 0; }
+
+        /// @brief Czy wysyłać zapytania zbiorcze
+        bool enabled() const { return current != NO; }
+
+        State state() const { return current; }
+
+        /**
+         * @brief Wynik zapytania zbiorczego
+         * @param answered Czy ECU odpowiedziało (odpowiedź zakończona '>', nie timeout)
+         * @param found Liczba PID w odpowiedzi
+         * @param count Liczba zapytanych PID
+         * @return true gdy ta odpowiedź zmieniła stan na NO
+         */
+        bool onReply(bool answered, size_t found, size_t count);
+
+    private:
+        State current = UNKNOWN;
+        uint8_t limit;
+        uint8_t rejects = 0;
+    };
+
+    /// @name Dekodowanie wartości
+    /// @{
+    inline int speedKmh(const Value& v) { return v.data[0]; }
+    inline float mafGs(const Value& v) { return ((v.data[0] << 8) | v.data[1]) / 100.0f; }
+    inline float rpm(const Value& v) { return ((v.data[0] << 8) | v.data[1]) / 4.0f; }
+    inline float fuelRateLph(const Value& v) { return ((v.data[0] << 8) | v.data[1]) / 20.0f; }
+    inline int coolantC(const Value& v) { return (int)v.data[0] - 40; }
+    inline int mapKpa(const Value& v) { return v.data[0]; }
+    inline int intakeTempC(const Value& v) { return (int)v.data[0] - 40; }
+    /// @}
+
+}  // namespace ObdPid
+
+#endif  // OBD_PID_H
@@ -5,7 +5,21 @@
  * @date 2025-01-20
  * 
  * Plik zawiera deklaracje funkcji i zmiennych do obsługi modułu OBDII.
- * Obsługuje inicjalizację, odczyt odometru i spalania oraz obliczanie kosztów.
+ * Obsługuje inicjalizację, odczyt odometru, prędkości i spalania oraz obliczanie kosztów.
+ * Dystans i prędkość przejazdu do rozliczenia liczy DistanceFusion
+ * (distance_fusion.h) z prędkości OBD, odometru i GPS (Doppler, pozycja).
+ * Z ELM327 komunikuje się wyłącznie task OBD - ekrany i zapis na SD czytają
+ * opublikowany snapshot, a prośby o odczyt wysyłają przez kolejkę żądań.
+ * Połączenie (Bluetooth, uruchomienie ELM327, ponowne łączenie po utracie
+ * łącza) prowadzi task w tle (obd_connection.h) - setup() nie czeka na adapter.
+ * Opcjonalnie prędkość i odometr pochodzą z nasłuchu ramek rozgłoszeniowych
+ * CAN (can_monitor.h) w wolnym czasie łącza zamiast z odpytywania.
+ * Zapytanie odometru, ramki CAN i stałe paliwa opisuje profil pojazdu
+ * (vehicle_profile.h) wczytywany z karty SD.
+ * W przerwach łącza fuzja liczy dystans z samego GPS, w tunelach z samego
+ * OBD. Niezależnie dystans OBD (DistanceEstimator - prędkość kotwiczona do
+ * odometru) i dystans z pozycji GPS (gps_odometer.h) są porównywane
+ * (TripDistance, rozbieżność w podsumowaniu trasy).
  * 
  * @see cabulator_settings.h Konfiguracja pinów i parametrów OBD
  * 
@@ -16,78 +30,241 @@
 #pragma once
 #include <Arduino.h>
 #include "../cabulator_settings.h"
+#include "obd_pid.h"
+#include "obd_scheduler.h"
+#include "obd_discovery.h"
+#include "obd_connection.h"
+#include "can_monitor.h"
 
 namespace OBD {
 
     /**
-     * @brief Status połączenia Bluetooth z modułem OBD
-     * 
-     * true jeśli połączenie Bluetooth jest aktywne
+     * @struct Stats
+     * @brief Liczniki zapytań OBD (przepustowość próbek)
      */
-    extern bool btConnected;
+    struct Stats {
+        uint32_t requests;          ///< Wysłane zapytania (round-tripy do ELM327)
+        uint32_t pidsRequested;     ///< Zapytane PID
+        uint32_t pidsRead;          ///< Odczytane PID
+        uint32_t fallbacks;         ///< Paczki powtórzone pojedynczymi zapytaniami
+    };
 
     /**
-     * @brief Status gotowości modułu ELM327
-     * 
-     * true jeśli moduł odpowiada na komendy AT i jest gotowy do pracy
+     * @enum Channel
+     * @brief Kanały harmonogramu odpytywania (obd_scheduler.h)
      */
-    extern bool elmReady;
+    enum Channel : uint8_t {
+        CH_MAF,             ///< Spalanie (PID 0110)
+        CH_SPEED,           ///< Prędkość (PID 010D)
+        CH_ODOMETER,        ///< Odometr (zapytanie z profilu pojazdu, pojedynczo)
+        CH_COUNT
+    };
 
     /**
-     * @brief Inicjalizuje i łączy się z modułem OBD przez Bluetooth
-     * 
-     * Konfiguruje połączenie Bluetooth, wysyła komendy inicjalizacyjne AT
-     * i sprawdza komunikację z pojazdem.
+     * @struct Latest
+     * @brief Ostatnie aktualne odczyty taska OBD
+     */
+    struct Latest {
+        long odometerKm;            ///< Odometr [km], -1 = brak / nieaktualny
+        float fuelLph;              ///< Spalanie [L/h], < 0 = brak / nieaktualne
+        int speedKmh;               ///< Prędkość [km/h], -1 = brak / nieaktualna
+    };
+
+    /**
+     * @enum Quality
+     * @brief Jakość próbki w snapshocie
+     */
+    enum Quality : uint8_t {
+        Q_NONE,             ///< Brak odczytu od startu odpytywania
+        Q_OK,               ///< Ostatni odczyt udany, w terminie
+        Q_FAILED,           ///< Ostatni odczyt nieudany - wartość z wcześniejszego, jeszcze w terminie
+        Q_STALE             ///< Wartość starsza niż termin nieaktualności kanału
+    };
+
+    /**
+     * @struct Sample
+     * @brief Ostatnia wartość kanału
+     */
+    struct Sample {
+        float value;                ///< Wartość w jednostkach kanału (km, L/h, km/h)
+        uint32_t timestampMs;       ///< Czas odczytu wartości [ms, millis()]
+        Quality quality;
+    };
+
+    /**
+     * @struct BringUp
+     * @brief Wynik ostatniego uruchomienia ELM327
+     */
+    struct BringUp {
+        ObdDiscovery::Vehicle vehicle;      ///< Wykryty lub zapamiętany pojazd
+        ObdDiscovery::Outcome outcome;      ///< CACHED / DISCOVERED / FAILED
+        uint32_t durationMs;                ///< Czas od połączenia Bluetooth do gotowości ELM [ms]
+        uint32_t readyAtMs;                 ///< Chwila gotowości od włączenia zasilania [ms, millis()]
+    };
+
+    /**
+     * @struct TripDistance
+     * @brief Dystans bieżącej trasy wg OBD i GPS
+     *
+     * Liczniki od początku trasy (tripActive), pauza ich nie zeruje.
+     */
+    struct TripDistance {
+        uint32_t obdMm;             ///< Dystans OBD w przedziałach z ważnym fixem GPS [mm]
+        uint32_t gpsMm;             ///< Dystans GPS w tych samych przedziałach [mm]
+        uint32_t fallbackMm;        ///< Dystans naliczony w przerwach łącza OBD (fuzja z samego GPS) [mm]
+        uint32_t outages;           ///< Przerwy łącza w trakcie naliczania
+    };
+
+    /**
+     * @struct Snapshot
+     * @brief Stan publikowany przez task OBD po każdym zapytaniu
+     */
+    struct Snapshot {
+        uint32_t version;                               ///< Numer publikacji
+        uint32_t publishedMs;                           ///< Czas publikacji [ms]
+        bool polling;                                   ///< Czy ECU jest odpytywane
+        ObdConnection::State connection;                ///< Stan połączenia z adapterem
+        ObdConnection::Stats connectionStats;           ///< Próby połączenia, utraty łącza
+        BringUp bringUp;                                ///< Ostatnie uruchomienie ELM327
+        Sample samples[CH_COUNT];                       ///< Wartości kanałów (indeks = Channel)
+        ObdScheduler::ChannelStats channels[CH_COUNT];  ///< Stan harmonogramu kanałów
+        ObdScheduler::LinkStats link;                   ///< Stan łącza
+        Stats counters;                                 ///< Liczniki zapytań
+        bool monitoring;                                ///< Prędkość / odometr z nasłuchu ramek CAN
+        CanMonitor::Stats monitor;                      ///< Liczniki nasłuchu (OBD_CONFIG::MONITOR_MODE)
+        TripDistance trip;                              ///< Dystans trasy OBD / GPS
+    };
+
+    /**
+     * @brief Przygotowuje moduł OBD (kolejka żądań, transport) - bez łączenia
      * 
-     * @return true jeśli inicjalizacja zakończyła się sukcesem, false w przypadku błędu
+     * Nie blokuje: połączenie Bluetooth i uruchomienie ELM327 (obd_discovery.h)
+     * wykonuje task OBD w tle. Znany pojazd (VIN zgodny z zapisanym w magazynie
+     * ustawień) od razu dostaje zapamiętany protokół i listę PID, nowy jest
+     * wykrywany i zapisywany. Czas uruchomienia jest logowany i dostępny
+     * w getBringUp().
+     *
+     * Profil pojazdu jest wczytywany z VEHICLE::FILE_PATH (karta SD musi być
+     * już zainicjalizowana); brak pliku lub błąd = profil wbudowany.
      * 
      * @note Wymaga wcześniejszej konfiguracji adresu MAC w cabulator_settings.h
      */
-    bool init();
+    void begin();
 
     /**
-     * @brief Odczytuje wartość odometru z pojazdu
-     * 
-     * Wysyła zapytanie PID do ECU i parsuje odpowiedź.
-     * 
-     * @return Wartość odometru w kilometrach, lub -1 przy błędzie odczytu
-     * 
-     * @warning Nie wszystkie pojazdy obsługują ten PID
+     * @brief Stan połączenia z adapterem (ze snapshotu)
      */
-    long readOdometer();
+    ObdConnection::State getConnectionState();
 
     /**
-     * @brief Odczytuje bieżące zużycie paliwa na podstawie MAF
-     * 
-     * Oblicza spalanie wykorzystując przepływ powietrza (MAF - Mass Air Flow).
-     * 
-     * @return Spalanie w litrach na godzinę [L/h], lub -1 przy błędzie
-     * 
-     * @note Dokładność zależy od kalibracji współczynnika AFR
+     * @brief Czy ECU odpowiada (READY lub DEGRADED) - warunek rozpoczęcia trasy
+     */
+    bool isReady();
+
+    /**
+     * @brief Wynik ostatniego uruchomienia ELM327 (pojazd, źródło spalania, czasy)
      */
-    float readFuelRate();
+    BringUp getBringUp();
 
     /**
-     * @brief Oblicza koszt przejazdu na podstawie spalania i taryfy
+     * @brief Zwraca liczniki zapytań OBD (z ostatniego snapshotu)
+     */
+    Stats getStats();
+
+    /**
+     * @brief Zwraca bieżącą należność za przejazd
      * 
-     * Wykorzystuje bieżące spalanie i aktywny tryb taryfy do wyliczenia
-     * kosztu na jednostkę czasu.
+     * Wartość pochodzi z licznika Fare - ta sama co na ekranie trasy
+     * i w zapisie na kartę SD (rozpoczęte km lub zużyte paliwo).
      * 
-     * @return Koszt w jednostce walutowej na godzinę
+     * @return Należność w ZL
      * 
-     * @see readFuelRate() dla źródła danych spalania
+     * @see fare_engine.h
      */
     float calculateCost();
 
+    /**
+     * @brief Spójna kopia stanu opublikowanego przez task OBD
+     *
+     * Odczyt w stałym czasie, bez komunikacji z ELM327 i bez blokad (seqlock).
+     * Jakość Q_OK/Q_FAILED zmienia się na Q_STALE, gdy próbka przekroczy
+     * termin nieaktualności kanału.
+     */
+    Snapshot getSnapshot();
+
+    /**
+     * @brief Ostatnie aktualne odczyty (ze snapshotu)
+     *
+     * Wartości starsze niż termin nieaktualności kanału są zwracane jako brak.
+     */
+    Latest getLatest();
+
+    /**
+     * @brief Stan kanału harmonogramu (osiągnięta częstotliwość, wiek próbki)
+     * @return false gdy kanał nie istnieje
+     */
+    bool getChannelStats(Channel channel, ObdScheduler::ChannelStats& out);
+
+    /**
+     * @brief Oszacowanie przepustowości łącza z harmonogramu
+     */
+    ObdScheduler::LinkStats getLinkStats();
+
+    /**
+     * @brief Dystans bieżącej trasy wg OBD i GPS (ze snapshotu)
+     */
+    TripDistance getTripDistance();
+
+    /**
+     * @brief Rozbieżność dystansu GPS względem OBD [%]
+     * @return (GPS - OBD) / OBD x 100; 0 gdy dystans OBD < GPS::ODO_CHECK_MIN_M
+     */
+    float divergencePct(const TripDistance& trip);
+
+    /**
+     * @brief Odpytywanie ECU przez podany czas także poza trasą
+     *
+     * Ekran, który potrzebuje danych (np. diagnostyka OBD), ponawia żądanie
+     * przy każdym odświeżeniu - po zamknięciu ekranu odpytywanie wygasa samo.
+     *
+     * @param durationMs Czas podtrzymania od chwili obsłużenia żądania [ms]
+     * @return false gdy kolejka żądań jest pełna lub task nie działa
+     */
+    bool requestWatch(uint32_t durationMs);
+
+    /**
+     * @brief Odczyt kanału przy najbliższej wolnej szczelinie łącza
+     * @return false gdy kolejka żądań jest pełna lub task nie działa
+     */
+    bool requestRefresh(Channel channel);
+
+    /**
+     * @brief Krótka nazwa kanału (np. "MAF")
+     */
+    const char* channelLabel(Channel channel);
+
     /**
      * @brief Task FreeRTOS obsługujący komunikację OBD w tle
      * 
-     * Cyklicznie odpytuje ECU o dane i aktualizuje zmienne globalne.
+     * Jedyny właściciel łącza ELM327. Łączy się z adapterem w tle i po
+     * utracie łącza ponawia próby z rosnącą przerwą (ObdConnection); trasa
+     * trwa dalej - w przerwie dystans i prędkość pochodzą z GPS przez ten sam
+     * filtr fuzji (paliwo nie jest naliczane), a odometr odczytany po powrocie
+     * łącza koryguje filtr bez podwójnego liczenia przerwy. Odpytuje ECU według
+     * harmonogramu (ObdScheduler): każdy kanał ma własny okres, priorytet
+     * i termin nieaktualności, a przerwy między zapytaniami wynikają
+     * z mierzonego czasu odpowiedzi łącza. Po każdym zapytaniu publikuje
+     * snapshot (getSnapshot) i przekazuje przyrosty trasy do licznika Fare.
+     * Z OBD_CONFIG::MONITOR_MODE przerwy między zapytaniami wypełnia nasłuch
+     * ramek CAN (ATMA) - kanały prędkości i odometru z aktualną próbką nie są
+     * wtedy odpytywane; adapter bez ATMA lub brak ramek = samo odpytywanie.
+     * Żądania innych tasków (requestWatch, requestRefresh) odbiera z kolejki,
+     * która jednocześnie budzi task w trakcie oczekiwania na termin.
      * Powinien być uruchomiony przez xTaskCreate().
      * 
      * @param param Parametr przekazywany do tasku (nieużywany)
      * 
-     * @note Task działa w nieskończonej pętli z delay
+     * @note ECU jest odpytywane tylko w trakcie trasy lub w czasie podtrzymanym przez requestWatch()
      */
     void task(void* param);
 
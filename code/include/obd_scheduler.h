@@ -0,0 +1,219 @@
+/**
+ * @file obd_scheduler.h
+ * @brief Harmonogram odpytywania PID z adaptacją do przepustowości łącza
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Zastępuje stały cykl 2 s (wszystkie PID naraz). Każdy kanał (PID) ma:
+ * - docelowy okres próbkowania (np. MAF 500 ms, odometr 10 s)
+ * - priorytet (waga 1-10)
+ * - termin nieaktualności - po nim wartość uznaje się za nieważną
+ *
+ * Wybór zapytania (next()):
+ * - pilność kanału = priorytet x (wiek próbki / okres); kanał po terminie
+ *   nieaktualności wyprzedza wszystkie aktualne
+ * - wybierany jest najpilniejszy kanał, którego okres już minął
+ * - do zapytania Mode 01 dołączane są inne kanały Mode 01, które osiągnęły
+ *   PIGGYBACK_PCT swojego okresu (dodatkowy PID w ramce jest prawie darmowy)
+ * - kanały spoza Mode 01 (np. odometr 22DD01) idą pojedynczo
+ *
+ * Przepustowość:
+ * - czas odpowiedzi łącza jest mierzony na bieżąco (średnia wykładnicza)
+ * - między zapytaniami utrzymywana jest przerwa, tak aby łącze było zajęte
+ *   najwyżej utilPct czasu - wolniejsze ECU => dłuższa przerwa
+ * - przy nasyceniu kolejność wynika z pilności, więc kanały o wysokim
+ *   priorytecie dostają większą część łącza, a niski priorytet nie głoduje
+ *   (pilność rośnie z wiekiem próbki)
+ * - nieudane odczyty kanału wydłużają jego okres (x2, do x2^MAX_BACKOFF_SHIFT),
+ *   a seria zapytań bez żadnej odpowiedzi dodaje przerwę globalną
+ *
+ * Osiągnięta częstotliwość kanału wynika ze średniego odstępu udanych próbek
+ * (bez stałego okna - działa także dla kanałów odpytywanych co kilkanaście s).
+ *
+ * Moduł nie zależy od Arduino (czas przekazywany jako argument).
+ */
+
+#ifndef OBD_SCHEDULER_H
+#define OBD_SCHEDULER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "obd_pid.h"
+
+/**
+ * @class ObdScheduler
+ * @brief Wybór kolejnego zapytania OBD wg pilności i przepustowości łącza
+ */
+class ObdScheduler {
+public:
+    static constexpr size_t MAX_CHANNELS = 8;           ///< Maksymalna liczba kanałów
+    static constexpr uint8_t NO_PID = 0xFF;             ///< Kanał spoza Mode 01 (osobna komenda)
+    static constexpr uint8_t PIGGYBACK_PCT = 75;        ///< Próg dołączenia do paczki [% okresu]
+    static constexpr uint8_t MAX_BACKOFF_SHIFT = 3;     ///< Maks. wydłużenie okresu po błędach (x8)
+    static constexpr uint32_t TIMEOUT_BACKOFF_MS = 250; ///< Przerwa po pierwszym zapytaniu bez odpowiedzi
+    static constexpr uint32_t MAX_BACKOFF_MS = 4000;    ///< Maksymalna przerwa globalna
+    static constexpr uint32_t LOAD_WINDOW_MS = 5000;    ///< Okno pomiaru zajętości łącza
+
+    /**
+     * @struct Channel
+     * @brief Konfiguracja kanału
+     */
+    struct Channel {
+        uint8_t pid;            ///< PID Mode 01 lub NO_PID
+        uint16_t periodMs;      ///< Docelowy okres próbkowania [ms]
+        uint16_t staleMs;       ///< Wiek, po którym wartość jest nieaktualna [ms]
+        uint8_t priority;       ///< Waga 1-10
+    };
+
+    /**
+     * @struct Request
+     * @brief Zapytanie do wykonania - indeksy kanałów
+     */
+    struct Request {
+        uint8_t count;                              ///< Liczba kanałów
+        uint8_t channels[ObdPid::MAX_BATCH];        ///< Indeksy kanałów (addChannel)
+    };
+
+    /**
+     * @struct ChannelStats
+     * @brief Stan kanału do diagnostyki
+     */
+    struct ChannelStats {
+        uint8_t pid;            ///< PID Mode 01 lub NO_PID
+        uint16_t periodMs;      ///< Docelowy okres [ms]
+        uint32_t samples;       ///< Udane odczyty
+        uint32_t failures;      ///< Nieudane odczyty
+        uint32_t rateMilliHz;   ///< Osiągnięta częstotliwość [mHz]
+        uint32_t ageMs;         ///< Wiek ostatniej próbki [ms] (UINT32_MAX = brak)
+        bool stale;             ///< Wiek przekroczył staleMs
+    };
+
+    /**
+     * @struct LinkStats
+     * @brief Oszacowanie przepustowości łącza
+     */
+    struct LinkStats {
+        uint32_t latencyMs;     ///< Średni czas zapytania [ms]
+        uint32_t gapMs;         ///< Bieżąca przerwa między zapytaniami [ms]
+        uint8_t loadPct;        ///< Zajętość łącza w ostatnim oknie [%]
+        uint32_t timeoutStreak; ///< Kolejne zapytania bez odpowiedzi
+    };
+
+    /**
+     * @param utilPct Docelowa maksymalna zajętość łącza [%] (10-100)
+     */
+    explicit ObdScheduler(uint8_t utilPct = 80);
+
+    /**
+     * @brief Dodaje kanał
+     * @return Indeks kanału lub -1 gdy brak miejsca
+     */
+    int addChannel(const Channel& channel);
+
+    /**
+     * @brief Zeruje wiek próbek i statystyki (np. po ponownym połączeniu)
+     */
+    void reset(uint32_t nowMs);
+
+    /**
+     * @brief Wybiera kolejne zapytanie
+     * @param nowMs Bieżący czas [ms]
+     * @param[out] req Zapytanie (gdy zwrócono 0)
+     * @return 0 gdy req jest gotowe do wykonania, inaczej czas do następnego
+     *         terminu [ms]
+     */
+    uint32_t next(uint32_t nowMs, Request& req);
+
+    /**
+     * @brief Rejestruje wynik wykonanego zapytania
+     * @param req Zapytanie z next()
+     * @param ok Wynik dla każdego kanału zapytania (ok[i] dla req.channels[i])
+     * @param nowMs Czas zakończenia [ms]
+     * @param durationMs Czas trwania zapytania [ms]
+     */
+    void complete(const Request& req, const bool* ok, uint32_t nowMs, uint32_t durationMs);
+
+    /**
+     * @brief Rejestruje próbkę kanału uzyskaną bez zapytania (np. nasłuch ramek CAN)
+     *
+     * Kanał z aktualną próbką nie jest odpytywany; gdy źródło zamilknie,
+     * termin minie i kanał wróci do odpytywania. Nie zmienia oszacowania łącza.
+     * @param index Indeks kanału
+     * @param sampleMs Czas próbki [ms]
+     * @return false gdy indeks jest poza zakresem
+     */
+    bool supply(size_t index, uint32_t sampleMs);
+
+    /**
+     * @brief Włącza / wyłącza kanał (np. PID nieobsługiwany przez pojazd)
+     *
+     * Wyłączony kanał nie jest odpytywany i pozostaje nieaktualny.
+     * @return false gdy indeks jest poza zakresem
+     */
+    bool setEnabled(size_t index, bool enabled);
+
+    /**
+     * @brief Odpytanie kanału przy najbliższej wolnej szczelinie łącza
+     *
+     * Kanał jest traktowany jak nieaktualny do czasu kolejnego zapytania
+     * (np. odświeżenie na żądanie z ekranu diagnostyki).
+     * @return false gdy indeks jest poza zakresem
+     */
+    bool expedite(size_t index);
+
+    /**
+     * @brief Czy wartość kanału jest nieaktualna (lub jeszcze nieodczytana)
+     */
+    bool isStale(size_t index, uint32_t nowMs) const;
+
+    /**
+     * @brief Stan kanału
+     * @return false gdy indeks jest poza zakresem
+     */
+    bool channelStats(size_t index, uint32_t nowMs, ChannelStats& out) const;
+
+    /**
+     * @brief Oszacowanie przepustowości łącza
+     */
+    LinkStats linkStats() const;
+
+    /**
+     * @brief Liczba kanałów
+     */
+    size_t channelCount() const { return count; }
+
+private:
+    struct State {
+        Channel cfg;
+        bool sampled;           ///< Czy był udany odczyt
+        uint32_t lastOkMs;      ///< Czas ostatniej próbki
+        uint32_t lastTryMs;     ///< Czas ostatniej próby
+        uint8_t failStreak;     ///< Kolejne nieudane odczyty
+        bool expedited;         ///< Odpytanie poza kolejnością (expedite)
+        bool disabled;          ///< Kanał wyłączony (setEnabled)
+        uint32_t samples;
+        uint32_t failures;
+        uint32_t intervalX4;    ///< Średni odstęp próbek x4 [ms]
+    };
+
+    void recordSample(State& s, uint32_t nowMs);
+    uint32_t effectivePeriod(const State& s) const;
+    uint32_t urgency(const State& s, uint32_t nowMs) const;
+    bool isDue(const State& s, uint32_t nowMs, uint8_t pct) const;
+
+    State channels[MAX_CHANNELS];
+    size_t count;
+    uint8_t utilPct;
+
+    uint32_t latencyX8;         ///< Średnia wykładnicza czasu zapytania x8 [ms]
+    uint32_t gapMs;
+    uint32_t nextSlotMs;
+    uint32_t timeoutStreak;
+
+    uint32_t windowStartMs;
+    uint32_t windowBusyMs;
+    uint8_t loadPct;
+};
+
+#endif  // OBD_SCHEDULER_H
@@ -0,0 +1,99 @@
+/**
+ * @file obd_transport.h
+ * @brief Interfejs transportu bajtów między ObdLink a adapterem ELM327
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * ObdLink nie zależy bezpośrednio od BluetoothSerial - wysyła komendy przez
+ * ObdTransport i odbiera bajty przez zarejestrowany handler. Implementacje:
+ * - BluetoothTransport - Bluetooth SPP (firmware)
+ * - Elm327Emulator - emulator ELM327 w procesie (elm327_emulator.h),
+ *   tryb symulacji firmware i narzędzia hosta
+ *
+ * Handler może być wywołany z dowolnego kontekstu (task stosu Bluetooth,
+ * wnętrze write() emulatora) i z dowolnie podzielonymi fragmentami odpowiedzi.
+ *
+ * connect() to jedna próba połączenia - ponawianie i przerwy między próbami
+ * należą do wywołującego (ObdConnection, obd_connection.h).
+ */
+
+#ifndef OBD_TRANSPORT_H
+#define OBD_TRANSPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @class ObdTransport
+ * @brief Dwukierunkowy strumień bajtów do ELM327
+ */
+class ObdTransport {
+public:
+    /// Odbiorca bajtów odebranych z adaptera
+    typedef void (*DataHandler)(const uint8_t* data, size_t size);
+
+    virtual ~ObdTransport() {}
+
+    /**
+     * @brief Rejestruje odbiorcę bajtów (jeden naraz)
+     */
+    virtual void setHandler(DataHandler handler) = 0;
+
+    /**
+     * @brief Wysyła bajty do adaptera
+     * @return Liczba przyjętych bajtów (0 gdy brak połączenia)
+     */
+    virtual size_t write(const uint8_t* data, size_t len) = 0;
+
+    /**
+     * @brief Czy połączenie z adapterem jest aktywne
+     */
+    virtual bool connected() = 0;
+
+    /**
+     * @brief Jedna próba połączenia z adapterem (może blokować wywołującego)
+     * @return true gdy połączenie jest aktywne
+     */
+    virtual bool connect() = 0;
+
+    /**
+     * @brief Zamknięcie połączenia (np. adapter przestał odpowiadać)
+     */
+    virtual void disconnect() = 0;
+};
+
+#ifdef ARDUINO
+
+class BluetoothSerial;
+
+/**
+ * @class BluetoothTransport
+ * @brief Transport przez Bluetooth SPP (odbiór callbackiem onData)
+ */
+class BluetoothTransport : public ObdTransport {
+public:
+    /**
+     * @param bt Port Bluetooth
+     * @param name Nazwa urządzenia lokalnego (tryb master)
+     * @param mac Adres adaptera "aa:bb:cc:dd:ee:ff"
+     */
+    BluetoothTransport(BluetoothSerial& bt, const char* name, const char* mac)
+        : bt(bt), name(name), mac(mac), started(false) {}
+
+    void setHandler(DataHandler handler) override;
+    size_t write(const uint8_t* data, size_t len) override;
+    bool connected() override;
+    bool connect() override;
+    void disconnect() override;
+
+private:
+    BluetoothSerial& bt;
+    const char* name;
+    const char* mac;
+    bool started;               ///< Czy stos Bluetooth został uruchomiony (begin)
+};
+
+#endif  // ARDUINO
+
+#endif  // OBD_TRANSPORT_H
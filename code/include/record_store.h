@@ -0,0 +1,172 @@
+/**
+ * @file record_store.h
+ * @brief Magazyn rekordów klucz/wartość w pamięci flash z równomiernym zużyciem
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Log-strukturalny magazyn rekordów działający na dwóch lub więcej sektorach
+ * pamięci flash (FlashDevice). Zastępuje bezpośrednie zapisy EEPROM pod
+ * stałymi adresami, które przy każdym commit() kasowały cały sektor.
+ *
+ * ## Układ sektora
+ * ```
+ * nagłówek sektora (16 B): magic, seq sektora, licznik kasowań, CRC
+ * rekord: magic, klucz, długość, flagi, seq rekordu, CRC + payload (wyrównany do 4 B)
+ * rekord ...
+ * 0xFF ... (wolne miejsce)
+ * ```
+ *
+ * - Zapis rekordu to tylko dopisanie na końcu aktywnego sektora (bez kasowania).
+ * - Aktywny sektor zawsze zawiera aktualne wartości wszystkich kluczy.
+ * - Gdy sektor się zapełni, kolejny sektor (po kolei, w kółko) jest kasowany,
+ *   kopiowane są do niego aktualne rekordy, a na końcu zapisywany jest nagłówek
+ *   z wyższym seq. Utrata zasilania w trakcie kopiowania zostawia poprzedni
+ *   sektor jako obowiązujący.
+ * - Każdy rekord ma CRC32 i numer sekwencyjny - uszkodzony rekord jest pomijany.
+ *
+ * Moduł nie zależy od Arduino. Na hoście działa na RamFlash (emulator pamięci
+ * NOR: kasowanie ustawia 0xFF, zapis może tylko zerować bity) - walidacja:
+ * tools/record_store_bench.cpp.
+ */
+
+#ifndef RECORD_STORE_H
+#define RECORD_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @class FlashDevice
+ * @brief Abstrakcja pamięci flash podzielonej na sektory
+ */
+class FlashDevice {
+public:
+    virtual ~FlashDevice() {}
+
+    /// @brief Rozmiar sektora kasowania [B]
+    virtual uint32_t sectorSize() const = 0;
+
+    /// @brief Liczba sektorów
+    virtual uint32_t sectorCount() const = 0;
+
+    /// @brief Odczyt danych spod adresu (względem początku urządzenia)
+    virtual bool read(uint32_t addr, void* buf, size_t len) = 0;
+
+    /// @brief Zapis danych (semantyka NOR - tylko zerowanie bitów)
+    virtual bool write(uint32_t addr, const void* buf, size_t len) = 0;
+
+    /// @brief Kasowanie sektora (wszystkie bajty = 0xFF)
+    virtual bool erase(uint32_t sector) = 0;
+};
+
+/**
+ * @class RamFlash
+ * @brief Emulator pamięci NOR w RAM (do testów na hoście)
+ */
+class RamFlash : public FlashDevice {
+public:
+    /**
+     * @param buffer Bufor o rozmiarze sectorSize * sectorCount
+     * @param sectorSize Rozmiar sektora [B]
+     * @param sectorCount Liczba sektorów
+     */
+    RamFlash(uint8_t* buffer, uint32_t sectorSize, uint32_t sectorCount);
+
+    uint32_t sectorSize() const override { return secSize; }
+    uint32_t sectorCount() const override { return secCount; }
+    bool read(uint32_t addr, void* buf, size_t len) override;
+    bool write(uint32_t addr, const void* buf, size_t len) override;
+    bool erase(uint32_t sector) override;
+
+private:
+    uint8_t* mem;
+    uint32_t secSize;
+    uint32_t secCount;
+};
+
+/**
+ * @class RecordStore
+ * @brief Log-strukturalny magazyn rekordów z odśmiecaniem między sektorami
+ */
+class RecordStore {
+public:
+    static constexpr uint8_t MAX_KEYS = 32;         ///< Klucze 1..MAX_KEYS-1
+    static constexpr uint8_t MAX_PAYLOAD = 96;      ///< Maksymalny rozmiar wartości [B]
+
+    /**
+     * @struct Stats
+     * @brief Metryki magazynu
+     */
+    struct Stats {
+        uint32_t eraseCount;        ///< Suma kasowań wszystkich sektorów (z nagłówków)
+        uint32_t erasesSinceBoot;   ///< Kasowania od uruchomienia
+        uint32_t recordsWritten;    ///< Zapisane rekordy od uruchomienia
+        uint32_t gcRuns;            ///< Liczba odśmieceń od uruchomienia
+        uint32_t corruptRecords;    ///< Rekordy z błędnym CRC znalezione przy montowaniu
+        uint32_t activeSector;      ///< Indeks aktywnego sektora
+        uint32_t freeBytes;         ///< Wolne miejsce w aktywnym sektorze [B]
+    };
+
+    explicit RecordStore(FlashDevice& flash);
+
+    /**
+     * @brief Montuje magazyn - wyszukuje aktywny sektor i buduje indeks kluczy w RAM
+     *
+     * Jeśli żaden sektor nie ma poprawnego nagłówka, magazyn jest formatowany.
+     * @return false przy błędzie urządzenia lub zbyt małej liczbie sektorów
+     */
+    bool mount();
+
+    /**
+     * @brief Odczytuje wartość klucza
+     * @param key Klucz (1..MAX_KEYS-1)
+     * @param[out] buf Bufor na wartość
+     * @param len Oczekiwany rozmiar wartości [B]
+     * @return true jeśli klucz istnieje i ma dokładnie len bajtów
+     */
+    bool get(uint8_t key, void* buf, size_t len);
+
+    /**
+     * @brief Zapisuje nową wartość klucza (dopisanie rekordu)
+     * @return false przy błędzie zapisu lub niepoprawnym kluczu/rozmiarze
+     */
+    bool put(uint8_t key, const void* buf, size_t len);
+
+    /**
+     * @brief Usuwa klucz (dopisuje rekord-nagrobek)
+     */
+    bool remove(uint8_t key);
+
+    /// @brief Czy klucz ma zapisaną wartość
+    bool contains(uint8_t key) const;
+
+    /// @brief Zwraca metryki magazynu
+    Stats stats() const;
+
+private:
+    struct Slot {
+        uint32_t addr;      // Adres rekordu (0 = brak)
+        uint8_t len;        // Długość wartości
+    };
+
+    FlashDevice& flash;
+    Slot slots[MAX_KEYS];
+    uint32_t active;        // Aktywny sektor
+    uint32_t sectorSeq;     // Numer sekwencyjny aktywnego sektora
+    uint32_t writePos;      // Przesunięcie zapisu w aktywnym sektorze
+    uint32_t recordSeq;     // Ostatni numer sekwencyjny rekordu
+    uint32_t eraseTotal;
+    Stats counters;
+    bool mounted;
+
+    bool format();
+    bool scanSector(uint32_t sector);
+    bool writeSectorHeader(uint32_t sector, uint32_t seq, uint32_t eraseCount);
+    bool readSectorHeader(uint32_t sector, uint32_t& seq, uint32_t& eraseCount);
+    bool eraseSector(uint32_t sector, uint32_t& eraseCount);
+    bool appendRecord(uint8_t key, const void* buf, uint8_t len, bool tombstone);
+    bool collect(uint32_t needBytes);
+};
+
+#endif  // RECORD_STORE_H
@@ -27,7 +27,7 @@ extern uint8_t brightnessLevel;
 /**
  * @brief Inicjalizuje moduł sterowania jasnością
  * 
- * Konfiguruje PWM do kontroli podświetlenia i wczytuje zapisaną wartość z EEPROM.
+ * Konfiguruje PWM do kontroli podświetlenia i wczytuje zapisaną wartość z magazynu ustawień.
  * Należy wywołać raz podczas startu aplikacji.
  */
 void initBrightnessModule();
@@ -15,7 +15,9 @@
 /**
  * @brief Inicjalizuje ekran debugowania OBD
  * 
- * Rysuje layout z polami na dane diagnostyczne pojazdu.
+ * Rysuje layout z polami na dane diagnostyczne pojazdu oraz wynik
+ * uruchomienia ELM327 (czas do gotowości, pojazd z pamięci / wykryty,
+ * źródło spalania).
  * 
  * @param tft Wskaźnik do obiektu wyświetlacza TFT
  */
@@ -24,7 +26,9 @@ void initObdDebugScreen(TFT_eSPI* tft);
 /**
  * @brief Aktualizuje dane na ekranie debugowania OBD
  * 
- * Odświeża wyświetlane parametry pojazdu (obroty, temperatura, przepływ powietrza).
+ * Odświeża snapshot taska OBD (odometr, spalanie, prędkość - kolor wg jakości
+ * próbki), osiągniętą częstotliwość odpytywania każdego PID oraz czas odpowiedzi
+ * i zajętość łącza. Każde odświeżenie podtrzymuje odpytywanie ECU (requestWatch).
  * 
  * @param tft Wskaźnik do obiektu wyświetlacza TFT
  * 
@@ -35,7 +39,8 @@ void updateObdDebugScreen(TFT_eSPI* tft);
 /**
  * @brief Obsługuje dotyk na ekranie debugowania OBD
  * 
- * Przetwarza interakcje, np. powrót do poprzedniego ekranu.
+ * Przetwarza interakcje: powrót do poprzedniego ekranu, dotknięcie wiersza
+ * kanału zleca jego odczyt poza kolejnością (requestRefresh).
  * 
  * @param x Współrzędna X punktu dotyku
  * @param y Współrzędna Y punktu dotyku
@@ -68,18 +68,29 @@ void handleTariffTouch(uint16_t x, uint16_t y);
 void drawTariffValue(TFT_eSPI* tft);
 
 /**
- * @brief Ładuje ustawienia taryfy z EEPROM
+ * @brief Ładuje ustawienia taryfy z magazynu ustawień
  * 
  * Odczytuje zapisaną wartość i tryb taryfy z pamięci nieulotnej.
  * Wywoływane przy starcie aplikacji.
  */
-void loadTariffFromEEPROM();
+void loadTariffSettings();
 
 /**
- * @brief Zapisuje ustawienia taryfy do EEPROM
+ * @brief Zapisuje ustawienia taryfy do magazynu ustawień
  * 
  * Zachowuje aktualną wartość i tryb taryfy w pamięci nieulotnej.
  */
-void saveTariffToEEPROM();
+void saveTariffSettings();
+
+/**
+ * @brief Wczytuje taryfę wieloskładnikową z pliku na karcie SD
+ * 
+ * Kompiluje TARIFF::FILE_PATH (format opisany w tariff_table.h) i przekazuje
+ * ją do licznika Fare. Wczytana taryfa ma pierwszeństwo przed prostą taryfą
+ * ustawianą na ekranie. Wywoływane po inicjalizacji karty SD.
+ * 
+ * @return true jeśli plik istnieje i został poprawnie skompilowany
+ */
+bool loadTariffTable();
 
 #endif // SCREEN_TARIFF_H
\ No newline at end of file
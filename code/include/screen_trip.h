@@ -16,20 +16,6 @@
 /// @name Zmienne stanu trasy
 /// @{
 
-/**
- * @brief Przejechany dystans w kilometrach
- * 
- * Wartość akumulowana od rozpoczęcia trasy.
- */
-extern float distanceTraveled;
-
-/**
- * @brief Zużyte paliwo w litrach
- * 
- * Suma spalania od rozpoczęcia trasy.
- */
-extern float fuelUsed;
-
 /**
  * @brief Czy trasa jest aktywna
  * 
@@ -97,26 +83,26 @@ void handleTripTouch(uint16_t x, uint16_t y);
 void resetTripData();
 
 /**
- * @brief Zapisuje dane trasy do EEPROM
+ * @brief Zapisuje checkpoint trasy do magazynu ustawień
  * 
  * Przechowuje dystans, zużycie paliwa i stan trasy.
  * Wywoływane co 30 sekund podczas aktywnej trasy.
  */
-void saveTripDataToEEPROM();
+void saveTripCheckpoint();
 
 /**
- * @brief Wczytuje dane trasy z EEPROM
+ * @brief Wczytuje checkpoint trasy z magazynu ustawień
  * 
  * Odtwarza poprzednią sesję w przypadku utraty zasilania.
- * @return true jeśli dane zostały pomyślnie wczytane, false jeśli EEPROM jest pusty
+ * @return true jeśli dane zostały pomyślnie wczytane, false jeśli brak zapisanego checkpointu
  */
-bool loadTripDataFromEEPROM();
+bool loadTripCheckpoint();
 
 /**
- * @brief Czyści zapisane dane trasy z EEPROM
+ * @brief Czyści zapisany checkpoint trasy
  * 
- * Usuwa dane z EEPROM gdy trasa zostanie prawidłowo zakończona.
+ * Usuwa checkpoint i ścieżkę trasy gdy trasa zostanie prawidłowo zakończona.
  */
-void clearTripDataFromEEPROM();
+void clearTripCheckpoint();
 
 #endif // SCREEN_TRIP_H
\ No newline at end of file
@@ -33,14 +33,31 @@
  * Każda trasa jest przechowywana w strukturze:
  * ```
  * /logs/trips/YYYY-MM-DD_HH-MM-SS/
- * gps_log.csv        (dane GPS, ~1 entry/sek)
- * trip_data.csv      (dane końcowe trasy)
+ * gps_log.csv        (ślad GPS: próbki co ~1 s po uproszczeniu, trip_logger.h)
+ * obd_log.csv        (dane tripu z OBD, co ~10 sek)
+ * trip_summary.csv   (dane końcowe trasy)
  * ```
+ *
+ * Przy SD_LOG_BINARY_FORMAT = 1 zamiast gps_log.csv i obd_log.csv zapisywane są
+ * gps_log.bin i obd_log.bin (trip_log_format.h). Narzędzie hosta
+ * tools/trip_log_to_csv.cpp odtwarza z nich pliki CSV w dotychczasowym układzie kolumn.
+ *
+ * Każdy wiersz kończą kolumny UtcMs (UTC zdarzenia [ms od 1970-01-01], 0 =
+ * nieznany) i TimeSource (none / system / holdover / nmea / pps) z podstawy
+ * czasu (timebase.h) - logi z różnych uruchomień i urządzeń można zestawić
+ * po czasie UTC. Nazwa folderu trasy też pochodzi z Timebase (UTC).
+ *
+ * Przy SDCARD::CAPTURE_MODE w folderze trasy powstaje też link_capture.bin -
+ * surowy ruch ELM327 i NMEA (link_capture.h), odtwarzany przez tools/capture_replay.cpp.
  * 
  * ## Przepływ danych
  * 
- * - GPS podaje nowy fix → SDManager::onGPSFix() zapisuje do gps_log.csv
- * - Użytkownik kończy trasę → SDManager::finalizeTrip() zapisuje trip_data.csv
+ * - GPS podaje nowy fix → SDManager::onGPSFix() dodaje rekord do bufora loggera
+ * - OBD co ~10 s → SDManager::onTripUpdate() dodaje rekord do bufora loggera
+ * - Użytkownik kończy trasę → SDManager::finalizeTrip() dodaje podsumowanie i zamyka sesję
+ *
+ * Fizyczny zapis do gps_log.csv / obd_log.csv / trip_summary.csv wykonuje
+ * task loggera (trip_logger.h) w paczkach o rozmiarze sektora.
  */
 
 #ifndef SD_MANAGER_H
@@ -49,44 +66,18 @@
 #include <Arduino.h>
 #include <SD.h>
 #include <FS.h>
+#include "trip_log_writer.h"
 
 namespace SDManager {
 
-    /**
-     * @struct TripData
-     * @brief Struktura danych trasy do zapisu
-     */
-    struct TripData {
-        float distanceKm;           ///< Przejechany dystans w km
-        float fuelUsedLiters;       ///< Zużyte paliwo w litrach
-        int tariffMode;             ///< Tryb taryfy (0=km, 1=paliwo)
-        float tariffValue;          ///< Wartość taryfy
-        float totalCost;            ///< Całkowity koszt
-    };
+    /// @brief Dane trasy do zapisu w trip_summary.csv (pola: trip_log_writer.h)
+    typedef TripLogWriter::TripSummary TripData;
 
-    /**
-     * @struct TripUpdateData
-     * @brief Struktura danych aktualizacji trasy do zapisu co 10 sekund
-     */
-    struct TripUpdateData {
-        float distanceKm;           ///< Przejechany dystans w km (bieżący)
-        float fuelUsedLiters;       ///< Zużyte paliwo w litrach (bieżące)
-        float totalCost;            ///< Całkowity koszt (bieżący)
-        unsigned long timestamp;    ///< Timestamp w ms od startu
-    };
+    /// @brief Dane aktualizacji trasy do zapisu co 10 sekund
+    typedef TripLogWriter::TripUpdate TripUpdateData;
 
-    /**
-     * @struct GPSData
-     * @brief Struktura danych GPS do zapisu
-     */
-    struct GPSData {
-        double latitude;            ///< Szerokość geograficzna
-        double longitude;           ///< Długość geograficzna
-        uint8_t satellites;         ///< Liczba satelitów
-        uint16_t hdop;              ///< Precyzja HDOP
-        bool valid;                 ///< Czy fix jest ważny
-        unsigned long timestamp;    ///< Timestamp w ms od startu
-    };
+    /// @brief Dane GPS do zapisu
+    typedef TripLogWriter::GpsFix GPSData;
 
     /**
      * @brief Inicjalizuje kartę SD na HSPI (Secondary SPI)
@@ -118,14 +109,14 @@ namespace SDManager {
     bool isReady();
 
     /**
-     * @brief Wczytuje ostatnią ścieżkę trasy z EEPROM
+     * @brief Wczytuje ostatnią ścieżkę trasy z magazynu ustawień
      *
-     * @return Ścieżka trasy zapisana w EEPROM, lub pusty string jeśli nic nie zapisane
+     * @return Zapisana ścieżka trasy, lub pusty string jeśli nic nie zapisane
      */
     String getLastTripPath();
 
     /**
-     * @brief Czyści ostatnią ścieżkę trasy z EEPROM
+     * @brief Czyści ostatnią ścieżkę trasy z magazynu ustawień
      */
     void clearLastTripPath();
 
@@ -138,22 +129,11 @@ namespace SDManager {
     String createTripSession();
 
     /**
-     * @brief Zapisuje dane trasy do pliku trip_data.csv
-     *
-     * @param tripPath Ścieżka folderu trasy (zwrócona z createTripSession)
-     * @param data Struktura z danymi trasy
-     * @return true jeśli zapis się powiódł, false w przypadku błędu
-     */
-    bool saveTripData(const String& tripPath, const TripData& data);
-
-    /**
-     * @brief Zapisuje wpis danych GPS do pliku gps_log.csv
+     * @brief Wznawia logowanie do istniejącego folderu trasy (np. po restarcie)
      *
-     * @param tripPath Ścieżka folderu trasy
-     * @param data Struktura z danymi GPS
-     * @return true jeśli zapis się powiódł, false w przypadku błędu
+     * @param tripPath Ścieżka folderu trasy wczytana z magazynu ustawień
      */
-    bool saveGPSData(const String& tripPath, const GPSData& data);
+    void resumeTripSession(const String& tripPath);
 
     /**
      * @brief Callback wywoływany przez GPS gdy pojawi się nowy fix
@@ -162,14 +142,12 @@ namespace SDManager {
      * Ta funkcja jest automatycznie wywoływana przez moduł GPS (z gps_reader.cpp)
      * każdorazowo gdy nowy fix jest dostępny (~co 1 sekundę podczas normalnej pracy).
      * 
-     * Jeśli trip jest aktywny (currentTripPath != ""), dane GPS są zapisywane 
-     * do pliku gps_log.csv w folderze bieżącej trasy.
-     * 
-     * Zapis odbywa się na HSPI bus, więc nie blokuje operacji na TFT/touch.
+     * Jeśli trip jest aktywny (currentTripPath != ""), rekord GPS trafia do
+     * bufora loggera, a task zapisu dopisuje go do gps_log.csv.
      *
      * @param data Struktura GPSData zawierająca: szerokość, długość, satelity, HDOP, valid, timestamp
      * 
-     * @note Ta funkcja jest non-blocking i powinna być szybka (wpis do CSV)
+     * @note Ta funkcja jest non-blocking - przy pełnym buforze rekord jest odrzucany
      * @see gps_reader.cpp - tam gdzie jest wywoływana
      * @see GPSData - struktura danych GPS
      */
@@ -180,13 +158,12 @@ namespace SDManager {
      *
      * @details
      * Ta funkcja jest wywoływana przez OBD::task() co ~10 sekund z bieżącymi danymi tripu.
-     * Zapisuje dystans, spalanie i koszt do pliku obd_log.csv w folderze bieżącej trasy.
-     * 
-     * Zapis odbywa się na HSPI bus, więc nie blokuje operacji na TFT/touch.
+     * Dystans, spalanie i koszt trafiają do bufora loggera, a task zapisu
+     * dopisuje je do pliku obd_log.csv w folderze bieżącej trasy.
      *
      * @param data Struktura TripUpdateData zawierająca: dystans, spalanie, koszt, timestamp
      * 
-     * @note Ta funkcja jest non-blocking i powinna być szybka (wpis do CSV)
+     * @note Ta funkcja jest non-blocking - przy pełnym buforze rekord jest odrzucany
      * @see obd_reader.cpp - tam gdzie jest wywoływana
      * @see TripUpdateData - struktura danych tripu
      */
@@ -199,8 +176,8 @@ namespace SDManager {
      * Ta funkcja powinna być wywoływana gdy użytkownik kończy trasę
      * (np. wciśnie przycisk "Stop" w screen_trip.cpp).
      * 
-     * Funkcja zapisuje dane końcowe trasy (distanceKm, fuelUsedLiters, cost, etc.)
-     * do pliku trip_summary.csv w folderze bieżącej trasy.
+     * Funkcja przekazuje dane końcowe trasy (distanceKm, fuelUsedLiters, cost, etc.)
+     * do loggera, który dopisuje je do trip_summary.csv i zamyka pliki sesji.
      * 
      * Po zapisaniu, zmienną globalną currentTripPath powinna być wyczyszczona.
      *
@@ -215,13 +192,16 @@ namespace SDManager {
     /**
      * @brief Listuje wszystkie dostępne logi tras
      *
-     * Wypisuje na Serial listę folderów z trasami.
+     * Wypisuje na Serial listę tras z indeksu (trip_index.h) - stronicowo,
+     * bez przeglądania katalogów na karcie.
      */
     void listTrips();
 
     /**
      * @brief Pobiera dane z ostatniej trasy
      *
+     * Ostatni wpis indeksu tras jest trzymany w RAM - O(1), bez dostępu do karty.
+     *
      * @param tripPath[out] Ścieżka do folderu ostatniej trasy
      * @return true jeśli znaleziono trasę, false jeśli brak tras
      */
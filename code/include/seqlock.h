@@ -0,0 +1,78 @@
+/**
+ * @file seqlock.h
+ * @brief Publikacja danych jednego zapisującego dla wielu czytelników bez blokad
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Zapisujący (jeden task) zwiększa licznik sekwencji do wartości nieparzystej,
+ * kopiuje dane i zwiększa licznik do parzystej. Czytelnik kopiuje dane
+ * i powtarza odczyt, jeśli licznik był nieparzysty lub zmienił się w trakcie.
+ *
+ * - zapis nigdy nie czeka na czytelników (task OBD nie jest blokowany przez UI)
+ * - odczyt to kopia stałego rozmiaru; powtórzenie tylko przy kolizji z zapisem
+ * - brak sekcji krytycznych - przerwania i drugi rdzeń nie są wstrzymywane
+ *
+ * T musi być typem trywialnie kopiowalnym (struktura bez wskaźników na dane
+ * zmieniane przez zapisującego).
+ */
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+
+// Moduł celowo nie używa Arduino.h - kompiluje się również na hoście
+
+/**
+ * @class Seqlock
+ * @brief Wartość typu T publikowana przez jednego zapisującego
+ */
+template <typename T>
+class Seqlock {
+    static_assert(std::is_trivially_copyable<T>::value, "Seqlock wymaga typu trywialnie kopiowalnego");
+
+public:
+    Seqlock() : seq(0), value() {}
+
+    /**
+     * @brief Publikuje nową wartość (wyłącznie z jednego tasku)
+     */
+    void write(const T& v) {
+        uint32_t s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(&value, &v, sizeof(T));
+        std::atomic_thread_fence(std::memory_order_release);
+        seq.store(s + 2, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Odczyt spójnej kopii (z dowolnego tasku)
+     */
+    T read() const {
+        T out;
+        uint32_t before, after;
+        do {
+            before = seq.load(std::memory_order_acquire);
+            memcpy(&out, &value, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = seq.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+        return out;
+    }
+
+    /**
+     * @brief Liczba publikacji (zmienia się przy każdym zapisie)
+     */
+    uint32_t version() const { return seq.load(std::memory_order_acquire) / 2; }
+
+private:
+    std::atomic<uint32_t> seq;
+    T value;
+};
+
+#endif  // SEQLOCK_H
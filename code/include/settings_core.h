@@ -0,0 +1,77 @@
+/**
+ * @file settings_core.h
+ * @brief Rdzeń magazynu ustawień - RecordStore z pomiarem czasu zapisów
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Część Settings (settings_store.h) bez zależności od Arduino, FreeRTOS
+ * i partycji ESP32: montowanie RecordStore na dowolnym FlashDevice, odczyt,
+ * zapis i usuwanie rekordów oraz metryki zapisów (liczba, czas ostatniego
+ * i najdłuższego zapisu mierzony zegarem clockUs).
+ *
+ * Klasa nie synchronizuje wątków - Settings osłania wywołania mutexem.
+ * Firmware podaje partycję flash i micros(), narzędzie hosta
+ * tools/record_store_bench.cpp RamFlash z zegarem wirtualnym.
+ */
+
+#ifndef SETTINGS_CORE_H
+#define SETTINGS_CORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "record_store.h"
+
+// Moduł celowo nie używa Arduino.h - kompiluje się również na hoście
+
+/**
+ * @class SettingsCore
+ * @brief Magazyn rekordów z metrykami zapisów
+ */
+class SettingsCore {
+public:
+    /**
+     * @struct Stats
+     * @brief Metryki magazynu ustawień
+     */
+    struct Stats {
+        RecordStore::Stats store;   ///< Metryki magazynu (kasowania, odśmiecanie)
+        uint32_t commits;           ///< Liczba zapisów od uruchomienia
+        uint32_t lastCommitUs;      ///< Czas ostatniego zapisu [us]
+        uint32_t maxCommitUs;       ///< Najdłuższy zapis [us]
+    };
+
+    /**
+     * @param flash Pamięć magazynu
+     * @param clockUs Zegar do pomiaru czasu zapisu [us] (nullptr = bez pomiaru)
+     */
+    SettingsCore(FlashDevice& flash, uint32_t (*clockUs)());
+
+    /// @brief Montuje magazyn (RecordStore::mount)
+    bool mount();
+
+    /// @brief Czy magazyn jest zamontowany
+    bool ready() const { return mounted; }
+
+    /// @brief Odczyt rekordu o dokładnie len bajtach
+    bool get(uint8_t key, void* buf, size_t len);
+
+    /// @brief Zapis rekordu z pomiarem czasu (także nieudany zapis jest liczony)
+    bool put(uint8_t key, const void* buf, size_t len);
+
+    /// @brief Usunięcie klucza
+    bool remove(uint8_t key);
+
+    /// @brief Zwraca metryki magazynu i zapisów
+    Stats stats() const;
+
+private:
+    RecordStore store;
+    uint32_t (*clock)();
+    bool mounted;
+    uint32_t commits;
+    uint32_t lastCommitUs;
+    uint32_t maxCommitUs;
+};
+
+#endif  // SETTINGS_CORE_H
@@ -0,0 +1,118 @@
+/**
+ * @file settings_store.h
+ * @brief Trwałe ustawienia i stan trasy w magazynie rekordów na flash
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Typowany interfejs nad SettingsCore (settings_core.h - RecordStore z pomiarem
+ * czasu zapisów, walidacja na hoście: tools/record_store_bench.cpp) działającym
+ * na dedykowanej partycji flash (STORAGE::PARTITION_LABEL w partitions.csv). Zastępuje
+ * dotychczasowe adresy EEPROM:
+ *
+ * | Dane                 | Stary adres EEPROM | Klucz               |
+ * |----------------------|--------------------|---------------------|
+ * | Jasność              | 0                  | KEY_BRIGHTNESS      |
+ * | Taryfa (wartość/tryb)| 10 / 14            | KEY_TARIFF          |
+ * | Checkpoint trasy     | 15-24              | KEY_TRIP_CHECKPOINT |
+ * | Ścieżka trasy        | 25-65              | KEY_TRIP_PATH       |
+ *
+ * Przy pierwszym uruchomieniu z pustym magazynem dane są jednorazowo
+ * przenoszone ze starego obszaru EEPROM.
+ *
+ * Wszystkie funkcje są bezpieczne wątkowo (mutex FreeRTOS).
+ */
+
+#ifndef SETTINGS_STORE_H
+#define SETTINGS_STORE_H
+
+#include <Arduino.h>
+#include "settings_core.h"
+
+namespace Settings {
+
+    /**
+     * @enum Key
+     * @brief Klucze rekordów w magazynie
+     */
+    enum Key : uint8_t {
+        KEY_BRIGHTNESS = 1,         ///< uint8_t - poziom jasności
+        KEY_TARIFF = 2,             ///< Tariff
+        KEY_TRIP_CHECKPOINT = 3,    ///< TripCheckpoint
+        KEY_TRIP_PATH = 4,          ///< char[TRIP_PATH_MAX_LEN + 1]
+        KEY_MIGRATED = 5,           ///< uint8_t - znacznik migracji z EEPROM
+        KEY_OBD_VEHICLE = 6,        ///< ObdDiscovery::Vehicle - wykryty pojazd (obd_reader.cpp)
+        KEY_GPS_AIDING = 7          ///< GpsSetup::Aiding - ostatnia pozycja GPS (gps_reader.cpp)
+    };
+
+    constexpr size_t TRIP_PATH_MAX_LEN = 40;    ///< Maksymalna długość ścieżki trasy
+
+    /**
+     * @struct Tariff
+     * @brief Zapisane ustawienia taryfy
+     */
+    struct Tariff {
+        float value;                ///< Stawka [ZL/km lub ZL/L]
+        uint8_t mode;               ///< TariffMode
+    };
+
+    /**
+     * @struct TripCheckpoint
+     * @brief Stan aktywnej trasy zapisywany cyklicznie
+     */
+    struct TripCheckpoint {
+        uint32_t distanceM;         ///< Przejechany dystans [m]
+        uint32_t fuelMl;            ///< Zużyte paliwo [ml]
+        uint32_t elapsedMs;         ///< Czas naliczania [ms]
+        uint32_t waitingMs;         ///< Czas postoju [ms]
+        uint32_t dueGr;             ///< Należność w chwili zapisu [gr]
+        uint8_t paused;             ///< 1 jeśli trasa jest zapauzowana
+        uint32_t waitingGr;         ///< W tym: postój [gr] (0 w rekordach sprzed tego pola)
+    };
+
+    /// @brief Metryki magazynu ustawień (SettingsCore::Stats)
+    typedef SettingsCore::Stats Stats;
+
+    /**
+     * @brief Montuje magazyn na partycji flash i w razie potrzeby migruje dane z EEPROM
+     * @return false jeśli partycja nie istnieje lub nie udało się jej zamontować
+     *
+     * @note Wywoływana raz w setup() przed wczytaniem jasności i taryfy
+     */
+    bool begin();
+
+    /// @name Typowane odczyty i zapisy
+    /// @{
+    bool getBrightness(uint8_t& level);
+    bool putBrightness(uint8_t level);
+
+    bool getTariff(Tariff& out);
+    bool putTariff(const Tariff& tariff);
+
+    bool getTripCheckpoint(TripCheckpoint& out);
+    bool putTripCheckpoint(const TripCheckpoint& cp);
+    bool clearTripCheckpoint();
+
+    bool getTripPath(char* out, size_t outLen);
+    bool putTripPath(const char* path);
+    bool clearTripPath();
+    /// @}
+
+    /**
+     * @brief Odczyt surowego rekordu (dla modułów z własnymi strukturami)
+     */
+    bool get(uint8_t key, void* buf, size_t len);
+
+    /**
+     * @brief Zapis surowego rekordu (dla modułów z własnymi strukturami)
+     */
+    bool put(uint8_t key, const void* buf, size_t len);
+
+    /**
+     * @brief Zwraca metryki magazynu
+     */
+    Stats getStats();
+
+}  // namespace Settings
+
+#endif  // SETTINGS_STORE_H
@@ -0,0 +1,110 @@
+/**
+ * @file tariff_table.h
+ * @brief Wieloskładnikowa taryfa skompilowana do tablicy
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Opis taryfy (plik tekstowy /tariff.txt na karcie SD) jest jednorazowo
+ * kompilowany do struktury TariffTable, którą FareEngine ewaluuje
+ * przyrostowo przy każdej próbce OBD - bez ponownego przechodzenia reguł:
+ *
+ * - stawka kilometrowa: wskaźnik na aktualny próg przesuwa się tylko do przodu
+ * - mnożnik pory dnia: jedna komórka tablicy 7 x 24 (+ lista świąt),
+ *   ustalana przy zmianie godziny
+ *
+ * ## Format pliku
+ * ```
+ * # komentarz
+ * mode km                  # km | litre
+ * flagfall 8.00            # opłata początkowa [ZL]
+ * band 0 3.00              # od 0 km: 3.00 ZL za każdy rozpoczęty km
+ * band 10 2.50             # od 10 km: 2.50 ZL/km
+ * rate 6.50                # tylko mode litre: ZL za litr
+ * waiting 1.20 10          # 1.20 ZL/min gdy prędkość < 10 km/h
+ * mult 1-5 22-6 150        # pon-pt (1-7), godz. 22:00-5:59, 150%
+ * mult 6-7 0-24 150        # weekend całą dobę
+ * holiday 12-25 200        # 25 grudnia (zawsze MM-DD), 200%
+ * ```
+ * Godzina końcowa przedziału nie jest objęta (22-6 = 22:00-5:59, 0-24 = cała
+ * doba, sama godzina 7 = 7:00-7:59); przedziały mogą przechodzić przez
+ * północ. Godziny są czasem lokalnym (TARIFF::TIME_ZONE). Kolejne reguły
+ * `mult` nadpisują wcześniejsze. Święto ma pierwszeństwo przed tablicą 7 x 24.
+ *
+ * Moduł nie zależy od Arduino (walidacja na hoście: tools/tariff_replay.cpp).
+ */
+
+#ifndef TARIFF_TABLE_H
+#define TARIFF_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @struct TariffTable
+ * @brief Skompilowana taryfa
+ */
+struct TariffTable {
+    static constexpr uint8_t MAX_BANDS = 8;         ///< Maksymalna liczba progów km
+    static constexpr uint8_t MAX_HOLIDAYS = 16;     ///< Maksymalna liczba świąt
+
+    /**
+     * @enum Mode
+     * @brief Podstawa naliczania (zgodna z TariffMode)
+     */
+    enum Mode : uint8_t {
+        MODE_KM = 0,            ///< Za rozpoczęty kilometr
+        MODE_LITRE = 1          ///< Za zużyty litr paliwa
+    };
+
+    struct Band {
+        uint32_t fromKm;        ///< Pierwszy km objęty stawką (liczony od 0)
+        uint32_t rateGr;        ///< Stawka [gr/km]
+    };
+
+    struct Holiday {
+        uint8_t month;          ///< 1-12
+        uint8_t day;            ///< 1-31
+        uint8_t pct;            ///< Mnożnik [%]
+    };
+
+    uint8_t mode;                       ///< Mode
+    uint32_t flagFallGr;                ///< Opłata początkowa [gr]
+    uint32_t litreRateGr;               ///< Stawka za litr [gr/l] (MODE_LITRE)
+    uint8_t bandCount;                  ///< Liczba progów (>= 1 w MODE_KM)
+    Band bands[MAX_BANDS];              ///< Progi posortowane rosnąco po fromKm
+    uint32_t waitRateGrPerMin;          ///< Opłata za postój [gr/min] (0 = brak)
+    uint8_t waitBelowKmh;               ///< Próg prędkości postoju [km/h]
+    uint8_t multPct[7][24];             ///< Mnożnik [%] dla [dzień tygodnia 0=pon][godzina]
+    uint8_t holidayCount;               ///< Liczba świąt
+    Holiday holidays[MAX_HOLIDAYS];     ///< Święta
+
+    /**
+     * @brief Taryfa prosta (jedna stawka, bez opłat dodatkowych)
+     * @param mode Mode
+     * @param rateGr Stawka [gr/km lub gr/l]
+     */
+    static TariffTable simple(uint8_t mode, uint32_t rateGr);
+
+    /**
+     * @brief Kompiluje opis tekstowy taryfy
+     * @param text Treść pliku (zakończona zerem)
+     * @param[out] out Skompilowana taryfa
+     * @param[out] err Bufor na opis błędu (np. "line 4: bad band")
+     * @param errLen Rozmiar bufora błędu
+     * @return false przy błędzie składni lub niespójnych regułach
+     */
+    static bool compile(const char* text, TariffTable& out, char* err, size_t errLen);
+
+    /**
+     * @brief Mnożnik dla chwili czasu
+     * @param weekday Dzień tygodnia 0=pon .. 6=nd (0xFF = czas nieznany)
+     * @param hour Godzina 0-23
+     * @param month Miesiąc 1-12
+     * @param day Dzień miesiąca 1-31
+     * @return Mnożnik [%] (100 gdy czas nieznany)
+     */
+    uint8_t multiplierPct(uint8_t weekday, uint8_t hour, uint8_t month, uint8_t day) const;
+};
+
+#endif  // TARIFF_TABLE_H
@@ -0,0 +1,112 @@
+/**
+ * @file timebase.h
+ * @brief Wspólna podstawa czasu UTC - zegar monotoniczny ESP32 zdyscyplinowany czasem GPS
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Rekordy logów mają znacznik millis() (od startu ESP32), a zegar systemowy
+ * był ustawiany czasem GPS tylko raz - logi z różnych uruchomień i urządzeń
+ * trudno zestawić. Timebase utrzymuje model UTC(zegar monotoniczny)
+ * (ClockDiscipline, clock_discipline.h) z przesunięciem i dryfem kwarcu:
+ *
+ * - task GPS przekazuje każdą epokę z ważnym fixem: UTC epoki ze zdań NMEA
+ *   i chwilę początku paczki zdań (szacunek z liczby bajtów w buforze UART)
+ *   pomniejszoną o TIMEBASE::NMEA_LATENCY_MS
+ * - przy podłączonym PPS (GPS::PIN_PPS) chwila impulsu z przerwania jest
+ *   odniesieniem epoki pełnej sekundy (dokładność kilkudziesięciu us);
+ *   różnica paczka NMEA - PPS (Stats::nmeaLagUs) to pomiar opóźnienia
+ *   NMEA dla TIMEBASE::NMEA_LATENCY_MS
+ * - po restarcie ESP32 bez utraty zasilania model startuje od zegara
+ *   systemowego (SOURCE_SYSTEM), zanim pojawi się fix
+ * - bez odniesień (tunel, parking) model liczy dalej z ostatnim dryfem
+ *   (SOURCE_HOLDOVER), a niepewność rośnie
+ *
+ * Zegar systemowy (time(), nazwy folderów tras) jest korygowany na bieżąco:
+ * adjtime() przy różnicy ponad TIMEBASE::CLOCK_SYNC_MS, settimeofday() przy
+ * skoku ponad TIMEBASE::STEP_MS.
+ *
+ * Model jest publikowany przez seqlock (seqlock.h): nowUtc() i utcAt() to
+ * kopia kilkudziesięciu bajtów i kilka działań całkowitych, bez blokad -
+ * logger przelicza znacznik każdego rekordu (trip_logger.cpp).
+ *
+ * @see cabulator_settings.h TIMEBASE::* - progi i niepewności
+ */
+
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include <Arduino.h>
+#include "clock_discipline.h"
+
+namespace Timebase {
+
+    /**
+     * @struct Stamp
+     * @brief Znacznik UTC rekordu
+     */
+    struct Stamp {
+        uint64_t utcMs;         ///< UTC [ms od 1970-01-01], 0 = nieznany
+        uint8_t source;         ///< ClockDiscipline::Source w chwili znacznika
+    };
+
+    /**
+     * @struct Stats
+     * @brief Stan modelu i liczniki
+     */
+    struct Stats {
+        ClockDiscipline::Model model;       ///< Opublikowany model
+        ClockDiscipline::Stats discipline;  ///< Liczniki odniesień
+        bool driftFitted;                   ///< Dryf z regresji (a nie przyjęty)
+        uint32_t epochs;                    ///< Epoki przekazane przez task GPS
+        uint32_t ppsPulses;                 ///< Impulsy PPS
+        uint32_t ppsUsed;                   ///< Impulsy użyte jako odniesienie
+        int32_t nmeaLagUs;                  ///< Średni początek paczki NMEA po PPS [us], 0 = brak PPS
+        uint32_t clockSlews;                ///< Korekty zegara systemowego adjtime()
+        uint32_t clockSteps;                ///< Ustawienia zegara systemowego settimeofday()
+    };
+
+    /**
+     * @brief Start modelu od zegara systemowego (gdy przetrwał restart) i przerwanie PPS
+     *
+     * Należy wywołać raz w setup(), przed GPS::begin() (dane pomocnicze
+     * modułu GPS biorą czas z nowUtc()).
+     */
+    void begin();
+
+    /**
+     * @brief Epoka GPS z ważnym fixem (wyłącznie task GPS)
+     * @param burstUs Szacowana chwila pierwszego bajtu paczki zdań epoki [us, esp_timer_get_time()]
+     * @param utcMs UTC epoki ze zdań NMEA [ms od 1970-01-01]
+     */
+    void addGpsEpoch(int64_t burstUs, uint64_t utcMs);
+
+    /**
+     * @brief Bieżący czas UTC (dowolny task, stały czas)
+     */
+    Stamp nowUtc();
+
+    /**
+     * @brief UTC chwili zapisanej jako millis() (dowolny task, stały czas)
+     * @param monoMs Wartość millis() w chwili zdarzenia (do ~24 dni wstecz)
+     */
+    Stamp utcAt(uint32_t monoMs);
+
+    /**
+     * @brief Niepewność bieżącego czasu UTC [ms] (UINT32_MAX gdy czas nieznany)
+     */
+    uint32_t accuracyMs();
+
+    /**
+     * @brief Zwraca kopię stanu modelu i liczników
+     */
+    Stats getStats();
+
+    /**
+     * @brief Wypisuje stan podstawy czasu na Serial (debug)
+     */
+    void debugStatus();
+
+}  // namespace Timebase
+
+#endif  // TIMEBASE_H
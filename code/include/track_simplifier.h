@@ -0,0 +1,134 @@
+/**
+ * @file track_simplifier.h
+ * @brief Strumieniowe upraszczanie śladu GPS przed zapisem - ograniczona pamięć i błąd
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * gps_log dostaje wiersz co sekundę - także na 40-minutowym postoju i na
+ * prostej drodze. Upraszczanie metodą otwieranego okna: od ostatniego
+ * zachowanego punktu (kotwicy) okno rośnie, dopóki odcinek kotwica - bieżący
+ * punkt odtwarza wszystkie punkty okna z błędem nie większym niż toleranceMm.
+ * Gdy nowy punkt nie mieści się w tolerancji, poprzedni punkt zostaje
+ * zachowany i staje się kotwicą.
+ *
+ * Błąd to odległość synchroniczna (SED): pozycja punktu wobec pozycji
+ * interpolowanej na odcinku w chwili punktu. Z zachowanych punktów można więc
+ * odtworzyć położenie w dowolnej chwili (nie tylko przebieg drogi) z błędem
+ * do toleranceMm - postój, jego początek i koniec zostają w logu.
+ *
+ * Zawsze zachowywane są (punkty potrzebne przy reklamacji kursu):
+ * - pierwszy i ostatni punkt sesji (finish() przy zamknięciu),
+ * - ostatni punkt przed zmianą ważności fixu i pierwszy po niej (tunel),
+ * - punkt co najmniej co maxGapMs (także przy przerwie w próbkach),
+ * - punkt wskazany przez wywołującego (add(..., force)).
+ *
+ * Pamięć: okno WINDOW_MAX punktów (12 B), pełne okno zamyka odcinek. Punkt
+ * okna to przesunięcie od kotwicy w mm (rzut równoodległościowy), więc
+ * sprawdzenie odcinka to kilka działań float na punkt okna. Decyzja dotyczy
+ * tylko poprzedniego lub bieżącego punktu - wywołujący przechowuje jeden
+ * wstrzymany rekord (trip_logger.cpp).
+ *
+ * Klasa nie zależy od Arduino (walidacja na hoście: tools/track_bench.cpp).
+ */
+
+#ifndef TRACK_SIMPLIFIER_H
+#define TRACK_SIMPLIFIER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Moduł celowo nie używa Arduino.h - kompiluje się również na hoście
+
+/**
+ * @class TrackSimplifier
+ * @brief Wybór punktów śladu do zapisu z gwarancją błędu odtworzenia
+ */
+class TrackSimplifier {
+public:
+
+    static constexpr size_t WINDOW_MAX = 128;       ///< Maks. punktów między zachowanymi
+
+    /// @brief Bity wyniku add()
+    static constexpr uint8_t KEEP_PREVIOUS = 1 << 0;    ///< Zapisz wstrzymany poprzedni punkt
+    static constexpr uint8_t KEEP_CURRENT = 1 << 1;     ///< Zapisz bieżący punkt (po poprzednim)
+
+    /**
+     * @struct Config
+     * @brief Tolerancja i odstęp (wartości firmware: cabulator_settings.h, SDCARD::TRACK_*)
+     */
+    struct Config {
+        uint32_t toleranceMm = 10000;   ///< Maks. błąd odtworzenia pozycji (SED) [mm]
+        uint32_t maxGapMs = 120000;     ///< Maks. odstęp między zachowanymi punktami [ms]
+    };
+
+    /**
+     * @struct Point
+     * @brief Punkt śladu
+     */
+    struct Point {
+        uint32_t timeMs;        ///< Czas [ms] (millis(), przepełnienie dozwolone)
+        int32_t latE7;          ///< Szerokość [1e-7 stopnia]
+        int32_t lngE7;          ///< Długość [1e-7 stopnia]
+        bool valid;             ///< Czy fix jest ważny (nieważne - pozycja bez znaczenia)
+    };
+
+    /**
+     * @struct Stats
+     * @brief Liczniki od reset()
+     */
+    struct Stats {
+        uint32_t points;        ///< Punkty wejściowe
+        uint32_t kept;          ///< Punkty zachowane
+        uint32_t forced;        ///< Zachowane bez względu na tolerancję (force, ważność, odstęp)
+        uint32_t windowFull;    ///< Odcinki zamknięte pełnym oknem
+    };
+
+    TrackSimplifier();
+    explicit TrackSimplifier(const Config& config);
+
+    /// @brief Nowy ślad (bez kotwicy) i zerowe liczniki
+    void reset();
+
+    /**
+     * @brief Kolejny punkt śladu
+     * @param p Punkt (czas niemalejący)
+     * @param force Zachowaj punkt bez względu na tolerancję
+     * @return Bity KEEP_PREVIOUS / KEEP_CURRENT (0 = bieżący punkt wstrzymany)
+     */
+    uint8_t add(const Point& p, bool force = false);
+
+    /**
+     * @brief Koniec śladu - kolejny add() zaczyna nowy
+     * @return true gdy wstrzymany ostatni punkt trzeba zapisać
+     */
+    bool finish();
+
+    /// @brief Liczniki
+    Stats stats() const { return st; }
+
+private:
+    // Punkt okna względem kotwicy
+    struct Offset {
+        uint32_t dtMs;
+        float xMm;
+        float yMm;
+    };
+
+    void anchorAt(const Point& p);
+    Offset offset(const Point& p) const;
+    bool fits(const Offset& end) const;
+
+    Config cfg;
+    Stats st;
+    Point anchor;
+    Point last;                 // Ostatni punkt (wstrzymany, gdy pending)
+    bool haveAnchor;
+    bool pending;
+    float mmPerLngE7;           // 1e-7 stopnia długości na szerokości kotwicy [mm]
+    float toleranceMm2;
+    Offset window[WINDOW_MAX];
+    size_t count;
+};
+
+#endif  // TRACK_SIMPLIFIER_H
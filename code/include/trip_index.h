@@ -0,0 +1,125 @@
+/**
+ * @file trip_index.h
+ * @brief Indeks tras na karcie SD (/logs/trips/index.bin)
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Zamiast przeglądać wszystkie foldery w /logs/trips przez openNextFile(),
+ * SDManager utrzymuje plik indeksu z wpisami o stałym rozmiarze:
+ *
+ * ```
+ * nagłówek (16 B): "CTIX", wersja, rozmiar wpisu
+ * wpis 0 (64 B)
+ * wpis 1 (64 B)
+ * ...
+ * ```
+ *
+ * Plik jest tylko dopisywany:
+ * - SDManager::createTripSession() dopisuje wpis OPEN,
+ * - SDManager::finalizeTrip() dopisuje wpis CLOSED z dystansem, paliwem i kosztem.
+ *
+ * Wpis, po którym bezpośrednio następuje wpis o tej samej nazwie, jest
+ * nieaktualny (zastąpiony) i jest pomijany przy listowaniu.
+ *
+ * Ostatni wpis jest trzymany w RAM, więc getLast() działa w O(1).
+ * Jeśli indeksu brakuje lub jest uszkodzony (nagłówek, rozmiar, CRC ostatniego
+ * wpisu), begin() odbudowuje go na podstawie katalogów tras.
+ */
+
+#ifndef TRIP_INDEX_H
+#define TRIP_INDEX_H
+
+#include <Arduino.h>
+
+namespace TripIndex {
+
+    /**
+     * @enum EntryState
+     * @brief Stan trasy zapisany we wpisie
+     */
+    enum EntryState : uint8_t {
+        ENTRY_OPEN = 1,         ///< Trasa rozpoczęta (brak podsumowania)
+        ENTRY_CLOSED = 2        ///< Trasa zakończona, dane podsumowania ważne
+    };
+
+    /**
+     * @struct Entry
+     * @brief Wpis indeksu (64 bajty na karcie SD)
+     */
+    struct Entry {
+        char name[24];          ///< Nazwa folderu trasy (YYYY-MM-DD_HH-MM-SS)
+        uint32_t startTime;     ///< Początek trasy [s od 1970], 0 jeśli nieznany
+        uint32_t endTime;       ///< Koniec trasy [s od 1970], 0 dla tras otwartych
+        uint32_t distanceM;     ///< Dystans [m]
+        uint32_t fuelMl;        ///< Paliwo [ml]
+        uint32_t costGr;        ///< Koszt [gr]
+        uint8_t state;          ///< EntryState
+        uint8_t reserved[15];   ///< Zarezerwowane (0)
+        uint32_t crc;           ///< CRC32 poprzednich 60 bajtów
+    };
+
+    /**
+     * @brief Otwiera indeks, w razie potrzeby odbudowuje go z katalogów
+     * @return true jeśli indeks jest gotowy do użycia
+     *
+     * @note Wywoływana przez SDManager::init() po zamontowaniu karty
+     */
+    bool begin();
+
+    /**
+     * @brief Odbudowuje indeks na podstawie folderów w /logs/trips
+     *
+     * Dla każdego folderu odczytuje ostatni wiersz trip_summary.csv - jeśli
+     * istnieje, wpis jest CLOSED z danymi podsumowania, w przeciwnym razie OPEN.
+     * Najnowsza trasa jest dopisywana jako ostatnia.
+     *
+     * @return true jeśli odbudowa się powiodła
+     */
+    bool rebuild();
+
+    /**
+     * @brief Dopisuje wpis OPEN dla nowej trasy
+     * @param tripPath Ścieżka folderu trasy
+     */
+    bool appendOpen(const String& tripPath);
+
+    /**
+     * @brief Dopisuje wpis CLOSED z danymi podsumowania
+     * @param tripPath Ścieżka folderu trasy
+     * @param distanceM Dystans [m]
+     * @param fuelMl Paliwo [ml]
+     * @param costGr Koszt [gr]
+     */
+    bool appendClose(const String& tripPath, uint32_t distanceM, uint32_t fuelMl, uint32_t costGr);
+
+    /**
+     * @brief Zwraca ostatni wpis indeksu (O(1), z RAM)
+     * @param[out] out Ostatni wpis
+     * @return false jeśli indeks jest pusty
+     */
+    bool getLast(Entry& out);
+
+    /**
+     * @brief Liczba wpisów w indeksie (łącznie z zastąpionymi)
+     */
+    uint32_t count();
+
+    /**
+     * @brief Odczytuje stronę wpisów zaczynając od podanego indeksu
+     *
+     * @param first Indeks pierwszego wpisu (0 = najstarszy)
+     * @param[out] out Tablica na wpisy
+     * @param maxEntries Rozmiar tablicy
+     * @return Liczba odczytanych wpisów (wpisy z błędnym CRC mają state = 0)
+     */
+    size_t readPage(uint32_t first, Entry* out, size_t maxEntries);
+
+    /**
+     * @brief Zwraca pełną ścieżkę folderu dla wpisu
+     */
+    String pathOf(const Entry& entry);
+
+}  // namespace TripIndex
+
+#endif  // TRIP_INDEX_H
@@ -0,0 +1,276 @@
+/**
+ * @file trip_log_format.h
+ * @brief Kompaktowy binarny format logów trasy (gps_log.bin / obd_log.bin)
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Alternatywa dla gps_log.csv i obd_log.csv wybierana przez SD_LOG_BINARY_FORMAT
+ * w cabulator_settings.h. Moduł nie zależy od Arduino - ten sam kod jest używany
+ * przez firmware (zapis) i przez narzędzie hosta tools/trip_log_to_csv.cpp (odczyt).
+ *
+ * ## Układ pliku
+ * ```
+ * FileHeader (16 B)
+ * BlockHeader (12 B) + payload (<= BLOCK_PAYLOAD_MAX B)
+ * BlockHeader (12 B) + payload
+ * ...
+ * ```
+ *
+ * Każdy blok jest samodzielny: pierwszy rekord bloku zawiera wartości
+ * bezwzględne, kolejne tylko różnice względem poprzedniego rekordu. Uszkodzenie
+ * bloku (błędne CRC32) powoduje utratę tylko tego bloku.
+ *
+ * ## Rekord GPS
+ * - varint: timestamp [ms] (różnica względem poprzedniego rekordu)
+ * - zigzag varint: szerokość [1e-7 stopnia] (różnica)
+ * - zigzag varint: długość [1e-7 stopnia] (różnica)
+ * - 1 bajt: bit 7 = valid, bity 0-6 = liczba satelitów
+ * - varint: HDOP x100
+ * - varint64: znacznik UTC (od wersji 2, niżej)
+ *
+ * ## Rekord OBD
+ * - varint: timestamp [ms] (różnica)
+ * - zigzag varint: dystans [m], paliwo [ml], koszt [gr] (różnice)
+ * - varint64: znacznik UTC (od wersji 2)
+ *
+ * ## Znacznik UTC (wersja 2, timebase.h)
+ * varint64: (zigzag(różnica przesunięcia) << 3) | źródło czasu, gdzie
+ * przesunięcie = UTC [ms] - timestamp [ms] (0 gdy źródło = brak). Przesunięcie
+ * zmienia się tylko o dryf zegara, więc poza pierwszym rekordem bloku
+ * znacznik zajmuje zwykle 1 bajt.
+ *
+ * Typowy rekord GPS zajmuje 8-10 bajtów zamiast ~70 bajtów w CSV.
+ * Pliki w wersji 1 (bez znacznika UTC) są nadal odczytywane - UTC = 0.
+ *
+ * ## Rekord przechwytywania łącza (link_capture.bin, link_capture.h)
+ * - 1 bajt: kanał (CaptureChannel)
+ * - varint: czas [us] (różnica; pierwszy rekord bloku - wartość bezwzględna)
+ * - varint: liczba bajtów (CAPTURE_LOST: liczba utraconych bajtów)
+ * - bajty danych (poza CAPTURE_LOST)
+ *
+ * Fragment dłuższy niż miejsce w bloku jest dzielony na kolejne rekordy
+ * z tym samym czasem.
+ */
+
+#ifndef TRIP_LOG_FORMAT_H
+#define TRIP_LOG_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace TripLogFormat {
+
+    constexpr uint32_t FILE_MAGIC = 0x4C424143;     ///< "CABL" (little-endian)
+    constexpr uint8_t FORMAT_VERSION = 2;           ///< Wersja formatu (zapis)
+    constexpr uint8_t FORMAT_VERSION_MIN = 1;       ///< Najstarsza odczytywana wersja
+    constexpr uint16_t BLOCK_MAGIC = 0xB10C;        ///< Znacznik początku bloku
+    constexpr size_t FILE_HEADER_SIZE = 16;         ///< Rozmiar nagłówka pliku [B]
+    constexpr size_t BLOCK_HEADER_SIZE = 12;        ///< Rozmiar nagłówka bloku [B]
+    constexpr size_t BLOCK_MAX = 512;               ///< Maksymalny rozmiar bloku z nagłówkiem [B]
+    constexpr size_t BLOCK_PAYLOAD_MAX = BLOCK_MAX - BLOCK_HEADER_SIZE;
+    constexpr size_t RECORD_MAX = 32;               ///< Górne ograniczenie rozmiaru rekordu [B]
+
+    /**
+     * @enum StreamType
+     * @brief Rodzaj danych zapisanych w pliku
+     */
+    enum StreamType : uint8_t {
+        STREAM_GPS = 1,     ///< gps_log.bin
+        STREAM_OBD = 2,     ///< obd_log.bin
+        STREAM_CAPTURE = 3  ///< link_capture.bin
+    };
+
+    /**
+     * @enum CaptureChannel
+     * @brief Źródło bajtów w pliku przechwytywania łącza
+     */
+    enum CaptureChannel : uint8_t {
+        CAPTURE_OBD_TX = 0,     ///< Komendy wysłane do ELM327
+        CAPTURE_OBD_RX = 1,     ///< Bajty odebrane z ELM327
+        CAPTURE_GPS_RX = 2,     ///< Bajty NMEA z modułu GPS
+        CAPTURE_LOST = 3,       ///< Bajty utracone (przepełniony bufor RAM)
+        CAPTURE_CHANNELS
+    };
+
+    /**
+     * @struct GpsSample
+     * @brief Próbka GPS w jednostkach całkowitych
+     */
+    struct GpsSample {
+        uint32_t timestampMs;   ///< Timestamp [ms od startu]
+        int32_t lat;            ///< Szerokość [1e-7 stopnia]
+        int32_t lng;            ///< Długość [1e-7 stopnia]
+        uint8_t sats;           ///< Liczba satelitów (0-127)
+        uint16_t hdop;          ///< HDOP x100
+        bool valid;             ///< Czy fix jest ważny
+        uint64_t utcMs;         ///< UTC [ms od 1970-01-01], 0 = nieznany
+        uint8_t timeSource;     ///< Źródło czasu UTC (ClockDiscipline::Source, 0-7)
+    };
+
+    /**
+     * @struct ObdSample
+     * @brief Próbka aktualizacji tripu w jednostkach całkowitych
+     */
+    struct ObdSample {
+        uint32_t timestampMs;   ///< Timestamp [ms od startu]
+        uint32_t distanceM;     ///< Dystans [m]
+        uint32_t fuelMl;        ///< Paliwo [ml]
+        uint32_t costGr;        ///< Koszt [gr]
+        uint64_t utcMs;         ///< UTC [ms od 1970-01-01], 0 = nieznany
+        uint8_t timeSource;     ///< Źródło czasu UTC (ClockDiscipline::Source, 0-7)
+    };
+
+    /**
+     * @struct CaptureChunk
+     * @brief Fragment strumienia bajtów jednego kanału
+     */
+    struct CaptureChunk {
+        uint32_t timeUs;        ///< Czas odbioru / wysłania [us, micros()]
+        uint8_t channel;        ///< CaptureChannel
+        uint16_t len;           ///< Liczba bajtów (CAPTURE_LOST: utracone bajty)
+        const uint8_t* data;    ///< Bajty (nullptr dla CAPTURE_LOST)
+    };
+
+    /**
+     * @struct BlockHeader
+     * @brief Nagłówek bloku (zapisywany jako 12 bajtów little-endian)
+     */
+    struct BlockHeader {
+        uint16_t magic;         ///< BLOCK_MAGIC
+        uint16_t count;         ///< Liczba rekordów w bloku
+        uint16_t length;        ///< Długość payloadu [B]
+        uint16_t reserved;      ///< Zarezerwowane (0)
+        uint32_t crc;           ///< CRC32 payloadu
+    };
+
+    /**
+     * @brief CRC32 (IEEE 802.3) z tablicą 16-elementową
+     * @param data Dane wejściowe
+     * @param len Długość danych [B]
+     * @param crc Wartość początkowa (do liczenia przyrostowego)
+     */
+    uint32_t crc32(const uint8_t* data, size_t len, uint32_t crc = 0);
+
+    /**
+     * @brief Zapisuje nagłówek pliku do bufora
+     * @param out Bufor o rozmiarze co najmniej FILE_HEADER_SIZE
+     * @param type Rodzaj danych w pliku
+     * @return Liczba zapisanych bajtów (FILE_HEADER_SIZE)
+     */
+    size_t writeFileHeader(uint8_t* out, StreamType type);
+
+    /**
+     * @brief Odczytuje i weryfikuje nagłówek pliku
+     * @param in Dane pliku (co najmniej FILE_HEADER_SIZE bajtów)
+     * @param[out] type Rodzaj danych w pliku
+     * @return true jeśli nagłówek jest poprawny
+     */
+    bool readFileHeader(const uint8_t* in, StreamType& type);
+
+    /**
+     * @brief Jak wyżej, dodatkowo zwraca wersję formatu (do BlockReader::begin)
+     * @param[out] version Wersja formatu (FORMAT_VERSION_MIN - FORMAT_VERSION)
+     */
+    bool readFileHeader(const uint8_t* in, StreamType& type, uint8_t& version);
+
+    /**
+     * @brief Odczytuje nagłówek bloku
+     * @param in Dane (co najmniej BLOCK_HEADER_SIZE bajtów)
+     * @param[out] hdr Nagłówek bloku
+     * @return true jeśli znacznik i długość są poprawne (CRC sprawdza BlockReader)
+     */
+    bool readBlockHeader(const uint8_t* in, BlockHeader& hdr);
+
+    /**
+     * @class BlockEncoder
+     * @brief Koduje rekordy jednego strumienia w bloki z CRC
+     *
+     * Koszt dodania rekordu to kilka operacji całkowitych - bez formatowania
+     * liczb zmiennoprzecinkowych i bez alokacji.
+     */
+    class BlockEncoder {
+    public:
+        explicit BlockEncoder(StreamType type);
+
+        /**
+         * @brief Dodaje próbkę GPS do bieżącego bloku
+         * @return false jeśli blok jest pełny - należy wywołać finish() i ponowić
+         */
+        bool add(const GpsSample& s);
+
+        /**
+         * @brief Dodaje próbkę OBD do bieżącego bloku
+         * @return false jeśli blok jest pełny - należy wywołać finish() i ponowić
+         */
+        bool add(const ObdSample& s);
+
+        /**
+         * @brief Dodaje fragment przechwytywania - tyle bajtów, ile zmieści blok
+         * @param[in,out] c Fragment; data i len są przesuwane o zapisane bajty
+         * @return true gdy fragment zapisano w całości, false gdy blok jest pełny
+         *         (finish() i ponowienie z resztą fragmentu)
+         */
+        bool add(CaptureChunk& c);
+
+        /**
+         * @brief Zamyka blok: zapisuje nagłówek z CRC i payload do bufora
+         * @param out Bufor o rozmiarze co najmniej BLOCK_MAX
+         * @return Liczba zapisanych bajtów (0 jeśli blok jest pusty)
+         */
+        size_t finish(uint8_t* out);
+
+        /// @brief Czy bieżący blok nie zawiera rekordów
+        bool empty() const { return count == 0; }
+
+    private:
+        StreamType type;
+        uint8_t payload[BLOCK_PAYLOAD_MAX];
+        size_t len;
+        uint16_t count;
+        uint32_t prev[4];       // Poprzednie wartości (timestamp + 3 pola)
+        int64_t prevUtc;        // Poprzednie przesunięcie UTC - timestamp [ms]
+
+        void reset();
+        size_t putUtc(uint8_t* p, uint32_t timestampMs, uint64_t utcMs, uint8_t source);
+    };
+
+    /**
+     * @class BlockReader
+     * @brief Dekoduje rekordy z jednego bloku
+     */
+    class BlockReader {
+    public:
+        /**
+         * @brief Weryfikuje CRC i przygotowuje odczyt bloku
+         * @param hdr Nagłówek bloku (z readBlockHeader)
+         * @param payload Dane payloadu (hdr.length bajtów)
+         * @param version Wersja formatu pliku (readFileHeader)
+         * @return false jeśli CRC się nie zgadza
+         */
+        bool begin(const BlockHeader& hdr, const uint8_t* payload, uint8_t version = FORMAT_VERSION);
+
+        /// @brief Odczytuje kolejną próbkę GPS, false na końcu bloku lub przy błędzie
+        bool next(GpsSample& s);
+
+        /// @brief Odczytuje kolejną próbkę OBD, false na końcu bloku lub przy błędzie
+        bool next(ObdSample& s);
+
+        /// @brief Odczytuje kolejny fragment przechwytywania (data wskazuje na payload bloku)
+        bool next(CaptureChunk& c);
+
+    private:
+        const uint8_t* data = nullptr;
+        size_t len = 0;
+        size_t pos = 0;
+        uint16_t remaining = 0;
+        uint32_t prev[4] = {0, 0, 0, 0};
+        int64_t prevUtc = 0;
+        uint8_t version = FORMAT_VERSION;
+
+        bool getUtc(uint32_t timestampMs, uint64_t& utcMs, uint8_t& source);
+    };
+
+}  // namespace TripLogFormat
+
+#endif  // TRIP_LOG_FORMAT_H
@@ -0,0 +1,288 @@
+/**
+ * @file trip_log_writer.h
+ * @brief Rdzeń loggera tras - bufor rekordów, paczkowanie i zapis przez Storage
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Cała logika TripLogger (trip_logger.h) bez zależności od Arduino, FreeRTOS
+ * i SD.h:
+ *
+ * - bufor pierścieniowy rekordów o pojemności Config::queueLen; próbki GPS
+ *   i OBD nie zajmują ostatnich Config::controlSlots miejsc - otwarcie,
+ *   podsumowanie i zamknięcie sesji mają na nie zawsze miejsce,
+ * - paczki o rozmiarze Config::batchBytes na strumień (plik) sesji, pliki
+ *   otwarte przez całą sesję, nagłówek CSV / binarny przy pustym pliku,
+ * - synchronizacja plików co Config::syncMs i przy zamknięciu sesji,
+ * - upraszczanie śladu GPS (TrackSimplifier) z jednym wstrzymanym rekordem,
+ * - bloki binarne gps_log.bin / obd_log.bin (Config::binary) i link_capture.bin
+ *   (TripLogFormat).
+ *
+ * Klasa nie synchronizuje wątków: push(), pop() i noteDropped() wywołujący
+ * osłania sekcją krytyczną (producenci i task zapisu), pozostałe metody woła
+ * wyłącznie task zapisu. Czekanie producenta na miejsce dla rekordu sesji
+ * i budzenie taska zostają w TripLogger.
+ *
+ * Pliki zapisywane są przez interfejs Storage - firmware podaje kartę SD,
+ * narzędzie hosta tools/logger_bench.cpp system plików w pamięci (pełny
+ * bufor, utrata zasilania przed synchronizacją).
+ */
+
+#ifndef TRIP_LOG_WRITER_H
+#define TRIP_LOG_WRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "trip_log_format.h"
+#include "track_simplifier.h"
+
+// Moduł celowo nie używa Arduino.h - kompiluje się również na hoście
+
+/**
+ * @class TripLogWriter
+ * @brief Bufor rekordów trasy i ich zapis paczkami do plików sesji
+ */
+class TripLogWriter {
+public:
+
+    static constexpr size_t QUEUE_MAX = 64;         ///< Maks. Config::queueLen
+    static constexpr size_t BATCH_MAX = 512;        ///< Maks. Config::batchBytes
+    static constexpr size_t PATH_MAX_LEN = 48;      ///< Maks. długość ścieżki folderu trasy (z '\0')
+
+    /**
+     * @enum Stream
+     * @brief Pliki logu obsługiwane w ramach jednej sesji
+     */
+    enum Stream : uint8_t {
+        STREAM_GPS = 0,         ///< gps_log.csv / gps_log.bin
+        STREAM_OBD,             ///< obd_log.csv / obd_log.bin
+        STREAM_SUMMARY,         ///< trip_summary.csv
+        STREAM_CAPTURE,         ///< link_capture.bin (SDCARD::CAPTURE_MODE, link_capture.h)
+        STREAM_COUNT
+    };
+
+    /**
+     * @class Storage
+     * @brief Abstrakcja systemu plików (firmware: karta SD, host: pamięć)
+     */
+    class Storage {
+    public:
+        virtual ~Storage() {}
+
+        /**
+         * @brief Otwiera plik strumienia w trybie dopisywania
+         * @param stream Strumień (plik) do otwarcia
+         * @param path Pełna ścieżka do pliku
+         * @return Aktualny rozmiar pliku w bajtach, lub -1 przy błędzie
+         */
+        virtual long open(Stream stream, const char* path) = 0;
+
+        /**
+         * @brief Dopisuje dane do otwartego pliku strumienia
+         * @return Liczba zapisanych bajtów
+         */
+        virtual size_t write(Stream stream, const uint8_t* data, size_t len) = 0;
+
+        /**
+         * @brief Wymusza zapis buforów systemu plików na nośnik
+         */
+        virtual void sync(Stream stream) = 0;
+
+        /**
+         * @brief Zamyka plik strumienia
+         */
+        virtual void close(Stream stream) = 0;
+    };
+
+    /**
+     * @struct GpsFix
+     * @brief Fix GPS do zapisu w gps_log (SDManager::GPSData)
+     */
+    struct GpsFix {
+        double latitude;            ///< Szerokość geograficzna
+        double longitude;           ///< Długość geograficzna
+        uint8_t satellites;         ///< Liczba satelitów
+        uint16_t hdop;              ///< Precyzja HDOP
+        bool valid;                 ///< Czy fix jest ważny
+        unsigned long timestamp;    ///< Timestamp w ms od startu
+    };
+
+    /**
+     * @struct TripUpdate
+     * @brief Aktualizacja trasy z OBD co ~10 s (SDManager::TripUpdateData)
+     */
+    struct TripUpdate {
+        float distanceKm;           ///< Przejechany dystans w km (bieżący)
+        float fuelUsedLiters;       ///< Zużyte paliwo w litrach (bieżące)
+        float totalCost;            ///< Całkowity koszt (bieżący)
+        unsigned long timestamp;    ///< Timestamp w ms od startu
+    };
+
+    /**
+     * @struct TripSummary
+     * @brief Podsumowanie trasy do trip_summary.csv (SDManager::TripData)
+     */
+    struct TripSummary {
+        float distanceKm;           ///< Przejechany dystans w km
+        float fuelUsedLiters;       ///< Zużyte paliwo w litrach
+        int tariffMode;             ///< Tryb taryfy (0=km, 1=paliwo)
+        float tariffValue;          ///< Wartość taryfy
+        float totalCost;            ///< Całkowity koszt
+        float gpsDistanceKm;        ///< Dystans GPS w przedziałach kontroli z OBD (OBD::TripDistance)
+        float gpsFallbackKm;        ///< Dystans z GPS w przerwach łącza OBD
+        float divergencePct;        ///< Rozbieżność GPS względem OBD [%]
+    };
+
+    /**
+     * @enum RecordType
+     * @brief Rodzaj rekordu w buforze
+     */
+    enum RecordType : uint8_t {
+        REC_OPEN = 0,           ///< Otwarcie sesji (path)
+        REC_GPS,                ///< Fix GPS
+        REC_UPDATE,             ///< Aktualizacja tripu z OBD
+        REC_SUMMARY,            ///< Podsumowanie trasy
+        REC_CLOSE               ///< Zamknięcie sesji
+    };
+
+    /**
+     * @struct Record
+     * @brief Rekord bufora z gotowym znacznikiem UTC (timebase.h)
+     */
+    struct Record {
+        RecordType type;
+        unsigned long timestamp;    ///< millis() w chwili dodania rekordu
+        uint64_t utcMs;             ///< UTC zdarzenia [ms], 0 = nieznany
+        uint8_t timeSource;         ///< ClockDiscipline::Source
+        union {
+            GpsFix gps;
+            TripUpdate update;
+            TripSummary summary;
+            char path[PATH_MAX_LEN];
+        };
+    };
+
+    /**
+     * @struct Config
+     * @brief Parametry (wartości firmware: cabulator_settings.h, SDCARD::LOG_* i TRACK_*)
+     */
+    struct Config {
+        uint16_t queueLen = 64;             ///< Pojemność bufora rekordów (<= QUEUE_MAX)
+        uint16_t controlSlots = 4;          ///< Miejsca tylko dla rekordów sesji
+        uint16_t batchBytes = 512;          ///< Rozmiar paczki zapisu (<= BATCH_MAX)
+        uint32_t syncMs = 5000;             ///< Co ile ms pliki są synchronizowane
+        bool binary = false;                ///< gps_log.bin / obd_log.bin zamiast CSV
+        bool simplifyTrack = true;          ///< Upraszczanie śladu GPS
+        TrackSimplifier::Config track;      ///< Tolerancja i odstęp śladu
+        uint32_t (*clockUs)() = nullptr;    ///< Zegar do pomiaru czasu zapisu paczki [us] (opcjonalny)
+    };
+
+    /**
+     * @struct Stats
+     * @brief Liczniki diagnostyczne
+     */
+    struct Stats {
+        uint16_t queueDepth;        ///< Bieżąca liczba rekordów w buforze
+        uint16_t maxQueueDepth;     ///< Maksymalna zaobserwowana liczba rekordów
+        uint32_t enqueued;          ///< Liczba przyjętych rekordów
+        uint32_t dropped;           ///< Liczba odrzuconych rekordów (pełny bufor)
+        uint32_t bytesWritten;      ///< Liczba bajtów zapisanych na nośnik
+        uint32_t flushes;           ///< Liczba wykonanych zapisów paczek
+        uint32_t lastFlushUs;       ///< Czas ostatniego zapisu paczki [us]
+        uint32_t maxFlushUs;        ///< Najdłuższy zapis paczki [us]
+        uint32_t gpsPoints;         ///< Punkty GPS zakończonych sesji (przed upraszczaniem)
+        uint32_t gpsKept;           ///< Punkty GPS zapisane po upraszczaniu śladu
+        uint32_t openErrors;        ///< Nieudane otwarcia plików
+        uint32_t shortWrites;       ///< Zapisy paczek krótsze niż paczka
+    };
+
+    TripLogWriter(const Config& config, Storage& storage);
+
+    /**
+     * @brief Dodaje rekord do bufora (producent, w sekcji krytycznej)
+     * @return false jeśli brak miejsca - próbki GPS/OBD nie zajmują Config::controlSlots
+     *
+     * @note Odrzucenie zlicza dopiero noteDropped() - rekord sesji można ponowić
+     */
+    bool push(const Record& rec);
+
+    /// @brief Zliczenie odrzuconego rekordu (w sekcji krytycznej)
+    void noteDropped() { st.dropped++; }
+
+    /// @brief Pobiera najstarszy rekord (task zapisu, w sekcji krytycznej)
+    bool pop(Record& out);
+
+    /// @brief Zapis rekordu do paczek strumieni sesji (task zapisu)
+    void process(const Record& rec);
+
+    /**
+     * @brief Fragment przechwytywania łącza do link_capture.bin (task zapisu)
+     *
+     * Fragmenty spoza sesji (lub po błędzie otwarcia pliku) są pomijane.
+     */
+    void appendCapture(TripLogFormat::CaptureChunk& chunk);
+
+    /**
+     * @brief Synchronizacja plików, gdy minęło Config::syncMs od poprzedniej
+     * @param nowMs Bieżący czas [ms] (przepełnienie dozwolone)
+     */
+    void sync(uint32_t nowMs);
+
+    /// @brief pop() i process() aż do pustego bufora, potem sync() (bez wątków)
+    void drain(uint32_t nowMs);
+
+    /// @brief Czy sesja jest otwarta
+    bool sessionOpen() const { return session; }
+
+    /// @brief Folder bieżącej (lub ostatnio zamkniętej) sesji
+    const char* sessionPath() const { return path; }
+
+    /// @brief Upraszczanie śladu ostatnio zakończonej sesji
+    TrackSimplifier::Stats lastTrack() const { return trackStats; }
+
+    /// @brief Liczniki
+    Stats stats() const;
+
+private:
+    void flushStream(Stream stream, bool doSync);
+    bool ensureOpen(Stream stream);
+    void append(Stream stream, const char* data, size_t len);
+    void finishBlock(Stream stream);
+    void appendGps(const Record& rec);
+    void appendUpdate(const Record& rec);
+    void appendSummary(const Record& rec);
+    void appendTrack(const Record& rec);
+    void finishTrack();
+    void closeAll();
+
+    Config cfg;
+    Storage& storage;
+    Stats st;
+
+    // Bufor pierścieniowy
+    Record ring[QUEUE_MAX];
+    uint16_t head;              // Indeks do zapisu (producenci)
+    uint16_t tail;              // Indeks do odczytu (task zapisu)
+    uint16_t count;
+
+    // Sesja i paczki strumieni
+    char path[PATH_MAX_LEN];
+    bool session;
+    bool streamOpen[STREAM_COUNT];
+    bool streamFailed[STREAM_COUNT];
+    uint8_t batch[STREAM_COUNT][BATCH_MAX];
+    size_t batchLen[STREAM_COUNT];
+    uint32_t lastSyncMs;
+
+    // Bloki binarne (gps/obd przy Config::binary, przechwytywanie zawsze)
+    TripLogFormat::BlockEncoder gpsEncoder;
+    TripLogFormat::BlockEncoder obdEncoder;
+    TripLogFormat::BlockEncoder captureEncoder;
+
+    // Upraszczanie śladu GPS - wstrzymany ostatni rekord czeka na decyzję
+    TrackSimplifier track;
+    TrackSimplifier::Stats trackStats;
+    Record trackPending;
+};
+
+#endif  // TRIP_LOG_WRITER_H
@@ -0,0 +1,122 @@
+/**
+ * @file trip_logger.h
+ * @brief Asynchroniczny logger tras - bufor rekordów w RAM i task zapisu na SD
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Producenci (GPS, OBD, finalizacja trasy) nie piszą już bezpośrednio na kartę SD.
+ * Każdy rekord trafia do bufora pierścieniowego o stałym rozmiarze
+ * (SDCARD::LOG_QUEUE_LEN) bez blokowania - jeśli bufor jest pełny, próbka GPS/OBD
+ * jest odrzucana i zliczana w statystykach.
+ *
+ * Rekordy sesji (otwarcie, podsumowanie, zamknięcie) nie są odrzucane razem
+ * z próbkami: próbki nie zajmują ostatnich SDCARD::LOG_CONTROL_SLOTS miejsc
+ * bufora, a gdy i te są zajęte (task zapisu stoi), producent czeka na miejsce
+ * do SDCARD::LOG_CONTROL_WAIT_MS. Zamknięcie trasy przy zapchanym buforze nie
+ * gubi więc podsumowania i nie zostawia trasy otwartej w indeksie.
+ *
+ * Task zapisu (niski priorytet) opróżnia bufor, formatuje rekordy do paczek
+ * o rozmiarze sektora (SDCARD::LOG_BATCH_BYTES) i dopisuje je do plików,
+ * które pozostają otwarte przez całą sesję. Pliki są synchronizowane co
+ * SDCARD::LOG_SYNC_MS oraz przy zamknięciu sesji.
+ *
+ * ## Przepływ danych
+ *
+ * - SDManager::createTripSession() → TripLogger::openSession()
+ * - SDManager::onGPSFix()          → TripLogger::logGPS()       → gps_log.csv
+ * - SDManager::onTripUpdate()      → TripLogger::logTripUpdate() → obd_log.csv
+ * - SDManager::finalizeTrip()      → TripLogger::logSummary() + closeSession()
+ * - LinkCapture::record()          → bufor bajtów LinkCapture   → link_capture.bin
+ *
+ * Rekordy GPS przechodzą przez TrackSimplifier (track_simplifier.h,
+ * SDCARD::TRACK_*): zapisywane są tylko punkty potrzebne do odtworzenia
+ * śladu z błędem do SDCARD::TRACK_TOLERANCE_MM, zawsze pierwszy i ostatni
+ * punkt sesji, zmiany ważności fixu i punkt co SDCARD::TRACK_MAX_GAP_MS.
+ * Ostatni punkt czeka w tasku zapisu na decyzję (najwyżej TRACK_MAX_GAP_MS).
+ *
+ * Producenci przeliczają znacznik danych (millis()) na UTC przez
+ * Timebase::utcAt() w chwili dodania rekordu - task zapisu tylko formatuje
+ * gotowy znacznik.
+ *
+ * Przy SDCARD::CAPTURE_MODE task włącza przechwytywanie łącza na czas sesji
+ * i po każdym opróżnieniu bufora rekordów przenosi fragmenty z bufora
+ * LinkCapture do bloków binarnych pliku link_capture.bin.
+ *
+ * Bufor, paczkowanie, formatowanie i upraszczanie śladu są w klasie
+ * TripLogWriter (trip_log_writer.h), która nie zależy od Arduino - narzędzie
+ * hosta tools/logger_bench.cpp uruchamia ją z systemem plików w pamięci.
+ * Tutaj zostają: karta SD jako TripLogWriter::Storage, sekcja krytyczna wokół
+ * bufora, znaczniki Timebase, czekanie na miejsce dla rekordu sesji, task
+ * zapisu i przechwytywanie łącza.
+ */
+
+#ifndef TRIP_LOGGER_H
+#define TRIP_LOGGER_H
+
+#include <Arduino.h>
+#include "sd_manager.h"
+#include "trip_log_writer.h"
+
+namespace TripLogger {
+
+    /// @brief Liczniki diagnostyczne loggera
+    typedef TripLogWriter::Stats Stats;
+
+    /**
+     * @brief Rozpoczyna sesję logowania w podanym folderze trasy
+     * @param tripPath Ścieżka folderu trasy (np. /logs/trips/2025-01-20_12-00-00)
+     * @return true jeśli rekord sesji trafił do bufora (czeka do SDCARD::LOG_CONTROL_WAIT_MS)
+     */
+    bool openSession(const String& tripPath);
+
+    /**
+     * @brief Kończy sesję - task zapisu opróżni paczki i zamknie pliki
+     * @return true jeśli rekord zamknięcia trafił do bufora (czeka do SDCARD::LOG_CONTROL_WAIT_MS)
+     */
+    bool closeSession();
+
+    /**
+     * @brief Dodaje fix GPS do bufora (non-blocking)
+     * @return false jeśli bufor był pełny i rekord odrzucono
+     */
+    bool logGPS(const SDManager::GPSData& data);
+
+    /**
+     * @brief Dodaje aktualizację tripu z OBD do bufora (non-blocking)
+     * @return false jeśli bufor był pełny i rekord odrzucono
+     */
+    bool logTripUpdate(const SDManager::TripUpdateData& data);
+
+    /**
+     * @brief Dodaje podsumowanie trasy do bufora (miejsce zarezerwowane, patrz wyżej)
+     * @return false jeśli task zapisu nie zwolnił miejsca w SDCARD::LOG_CONTROL_WAIT_MS
+     */
+    bool logSummary(const SDManager::TripData& data);
+
+    /**
+     * @brief Opróżnia bufor rekordów i wykonuje zaległe zapisy
+     *
+     * Wywoływana cyklicznie przez task().
+     *
+     * @param nowMs Bieżący czas [ms], używany do harmonogramu synchronizacji
+     */
+    void drain(unsigned long nowMs);
+
+    /**
+     * @brief Zwraca kopię liczników diagnostycznych
+     */
+    Stats getStats();
+
+    /**
+     * @brief Task FreeRTOS zapisujący rekordy na SD
+     *
+     * Budzi się po powiadomieniu od producenta lub co SDCARD::LOG_IDLE_WAKE_MS.
+     *
+     * @param param Parametr przekazywany do tasku (nieużywany)
+     */
+    void task(void* param);
+
+}  // namespace TripLogger
+
+#endif  // TRIP_LOGGER_H
@@ -0,0 +1,154 @@
+/**
+ * @file vehicle_profile.h
+ * @brief Profil pojazdu (plik /vehicle.txt) skompilowany do tablicy dekodowania
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Wszystko, co zależy od modelu samochodu, a nie wynika ze standardu OBD-II:
+ * zapytanie o odometr producenta, położenie sygnałów w ramkach
+ * rozgłoszeniowych CAN, rodzaj paliwa i dane silnika do metody
+ * speed-density. Inny model floty = inny plik na karcie SD, bez
+ * przebudowy firmware'u. PID Mode 01 (prędkość, MAF, 015E, MAP, RPM)
+ * są zdefiniowane w SAE J1979 i dekoduje je ObdPid.
+ *
+ * Opis tekstowy jest kompilowany raz przy starcie (jak taryfa,
+ * tariff_table.h). Pole odpowiedzi to bajty zapytania, położenie wartości
+ * i skala - dekodowanie w pętli OBD to porównanie nagłówka odpowiedzi
+ * (tryb + 0x40 i powtórzony identyfikator) na bajtach z ObdPid::collectBytes
+ * i złożenie wartości big-endian, bez szukania podciągów ani strtol.
+ * Paliwo jest zamieniane na współczynniki (L/h na g/s powietrza,
+ * g/s z MAP x RPM / T), więc przeliczenie to jedno mnożenie.
+ *
+ * ## Format pliku
+ * ```
+ * # komentarz
+ * name Volvo V40 2014+             # nazwa (do końca linii)
+ * fuel petrol                      # petrol | diesel | lpg | e85 - AFR i gęstość domyślne
+ * afr 14.7                         # opcjonalnie: stechiometryczny AFR
+ * density 0.755                    # opcjonalnie: gęstość paliwa [kg/L]
+ * engine 1596 85                   # pojemność [cm3], sprawność napełniania [%]
+ * odometer 22DD01 0 3 1            # zapytanie, bajt wartości, długość [B], skala [, przesunięcie]
+ * can speed 1A0 0 2 0.01 FFFF      # id ramki, bajt, długość, skala [, surowa "brak sygnału"]
+ * can odometer 3A0 1 3 1
+ * ```
+ * Bajt wartości jest liczony od pierwszego bajtu po nagłówku odpowiedzi
+ * (dla 22DD01: po 62 DD 01). Brak linii `odometer` / `can` = odczyt
+ * niedostępny w tym pojeździe.
+ *
+ * Moduł nie zależy od Arduino (benchmark dekodowania: tools/profile_bench.cpp).
+ */
+
+#ifndef VEHICLE_PROFILE_H
+#define VEHICLE_PROFILE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "can_monitor.h"
+
+/**
+ * @struct VehicleProfile
+ * @brief Skompilowany profil pojazdu
+ */
+struct VehicleProfile {
+    static constexpr size_t MAX_NAME = 32;          ///< Długość nazwy
+    static constexpr size_t MAX_REQUEST = 4;        ///< Bajty zapytania (tryb + identyfikator)
+    static constexpr size_t MAX_RESPONSE = 64;      ///< Bajty odpowiedzi analizowane przy dekodowaniu
+
+    /// Profil wbudowany (Volvo V40 2014+), gdy na karcie nie ma pliku
+    static const char* const BUILTIN;
+
+    /**
+     * @enum Fuel
+     * @brief Rodzaj paliwa (wartości domyślne AFR i gęstości)
+     */
+    enum Fuel : uint8_t {
+        FUEL_PETROL = 0,
+        FUEL_DIESEL = 1,
+        FUEL_LPG = 2,
+        FUEL_E85 = 3
+    };
+
+    /**
+     * @enum CanSignal
+     * @brief Sygnały ramek rozgłoszeniowych
+     */
+    enum CanSignal : uint8_t {
+        CAN_SPEED = 0,          ///< Prędkość [km/h]
+        CAN_ODOMETER = 1,       ///< Odometr [km]
+        CAN_COUNT
+    };
+
+    /**
+     * @struct Field
+     * @brief Wartość w odpowiedzi ECU na zapytanie spoza Mode 01
+     */
+    struct Field {
+        uint8_t requestLen;                     ///< Bajty zapytania, 0 = pole nieużywane
+        uint8_t request[MAX_REQUEST];           ///< Tryb + identyfikator (np. 22 DD 01)
+        char command[2 * MAX_REQUEST + 1];      ///< Zapytanie ELM327 (np. "22DD01")
+        uint8_t start;                          ///< Pierwszy bajt wartości po nagłówku
+        uint8_t length;                         ///< Długość wartości [B] (1-4, big-endian)
+        float scale;                            ///< Jednostka na wartość surową
+        float offset;                           ///< Przesunięcie po przeskalowaniu
+    };
+
+    char name[MAX_NAME + 1];            ///< Nazwa profilu
+    uint32_t id;                        ///< Skrót FNV-1a opisu (inny profil = ponowne wykrywanie pojazdu)
+    uint8_t fuel;                       ///< Fuel
+    float afr;                          ///< Stechiometryczny AFR
+    float densityKgL;                   ///< Gęstość paliwa [kg/L]
+    uint16_t displacementCc;            ///< Pojemność silnika [cm3]
+    uint8_t vePct;                      ///< Sprawność napełniania [%]
+    Field odometer;                     ///< Odometr producenta
+    bool hasCan[CAN_COUNT];             ///< Czy sygnał jest opisany
+    CanMonitor::Signal can[CAN_COUNT];  ///< Położenie sygnałów w ramkach
+
+    // Współczynniki wyliczane przy kompilacji
+    float lphPerGs;                     ///< Spalanie [L/h] na 1 g/s powietrza = 3.6 / (AFR x gęstość)
+    float airPerKpaRpmK;                ///< Powietrze [g/s] = MAP [kPa] x RPM / T [K] x współczynnik
+
+    /**
+     * @brief Kompiluje opis tekstowy profilu
+     * @param text Treść pliku (zakończona zerem)
+     * @param[out] out Skompilowany profil
+     * @param[out] err Bufor na opis błędu (np. "line 3: bad odometer")
+     * @param errLen Rozmiar bufora błędu
+     * @return false przy błędzie składni lub wartości spoza zakresu
+     */
+    static bool compile(const char* text, VehicleProfile& out, char* err, size_t errLen);
+
+    /**
+     * @brief Dekoduje pole z bajtów odpowiedzi
+     * @param field Pole (requestLen > 0)
+     * @param bytes Bajty odpowiedzi (ObdPid::collectBytes)
+     * @param n Liczba bajtów
+     * @param[out] value Wartość w jednostkach pola
+     * @return false gdy w odpowiedzi nie ma nagłówka pola lub jest za krótka
+     */
+    static bool decode(const Field& field, const uint8_t* bytes, size_t n, float& value);
+
+    /**
+     * @brief Dekoduje pole z tekstu odpowiedzi ELM327 (nullptr = brak odpowiedzi)
+     */
+    static bool decode(const Field& field, const char* response, float& value);
+
+    /**
+     * @brief Krótka nazwa paliwa (np. "petrol")
+     */
+    static const char* fuelLabel(uint8_t fuel);
+
+    /**
+     * @brief Spalanie [L/h] z masy powietrza [g/s]
+     */
+    float fuelLph(float airGs) const { return airGs * lphPerGs; }
+
+    /**
+     * @brief Masa powietrza [g/s] metodą speed-density
+     */
+    float airGs(int mapKpa, float rpm, int intakeC) const {
+        return mapKpa * rpm / (intakeC + 273.15f) * airPerKpaRpmK;
+    }
+};
+
+#endif  // VEHICLE_PROFILE_H
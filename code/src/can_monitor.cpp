@@ -0,0 +1,145 @@
+#include "can_monitor.h"
+
+// Moduł celowo nie używa Arduino.h - kompiluje się również na hoście
+
+static int hexValue(uint8_t c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+CanMonitor::CanMonitor() : count(0) {
+    reset();
+}
+
+int CanMonitor::addSignal(const Signal& signal) {
+
+    if (count >= MAX_SIGNALS || signal.id > 0x7FF || signal.length == 0 || signal.length > 4
+        || signal.start + signal.length > MAX_DATA) return -1;
+
+    signals[count] = signal;
+    readings[count] = { 0.0f, 0, false };
+    return (int)count++;
+}
+
+void CanMonitor::reset() {
+
+    for (size_t i = 0; i < count; i++) readings[i] = { 0.0f, 0, false };
+    st = Stats();
+
+    id = 0;
+    idDigits = 0;
+    dataLen = 0;
+    nibble = 0;
+    halfByte = false;
+    bad = false;
+    empty = true;
+    first = second = '\0';
+}
+
+void CanMonitor::feed(const uint8_t* bytes, size_t len, uint32_t nowMs) {
+
+    st.bytes += (uint32_t)len;
+
+    for (size_t i = 0; i < len; i++) {
+
+        uint8_t c = bytes[i];
+        if (c == '\r' || c == '\n') {
+            endLine(nowMs);
+            continue;
+        }
+        if (c == ' ' || c == '>' || c == '\0') {
+            if (c == ' ' && halfByte) bad = true;       // Spacja wewnątrz bajtu
+            continue;
+        }
+
+        if (empty) first = (char)c;
+        else if (second == '\0') second = (char)c;
+        empty = false;
+        if (bad) continue;
+
+        int v = hexValue(c);
+        if (v < 0) {
+            bad = true;
+        } else if (idDigits < ID_DIGITS) {
+            id = (uint16_t)(id << 4 | v);
+            idDigits++;
+        } else if (!halfByte) {
+            nibble = (uint8_t)v;
+            halfByte = true;
+        } else if (dataLen < MAX_DATA) {
+            data[dataLen++] = (uint8_t)(nibble << 4 | v);
+            halfByte = false;
+        } else {
+            bad = true;                                 // Więcej niż 8 bajtów - nie ramka 11 bit
+        }
+    }
+}
+
+void CanMonitor::endLine(uint32_t nowMs) {
+
+    if (!empty) {
+        if (bad || halfByte || idDigits < ID_DIGITS || dataLen == 0) {
+            if (first == 'B' && second == 'U') st.bufferFull++;
+            else if (first == '?' && second == '\0') st.rejected++;
+            else if (first == 'S' && second == 'T') {}          // STOPPED - przerwanie nasłuchu
+            else st.malformed++;
+        } else {
+            st.frames++;
+            dispatch(nowMs);
+        }
+    }
+
+    id = 0;
+    idDigits = 0;
+    dataLen = 0;
+    halfByte = false;
+    bad = false;
+    empty = true;
+    first = second = '\0';
+}
+
+void CanMonitor::dispatch(uint32_t nowMs) {
+
+    bool matched = false;
+    for (size_t i = 0; i < count; i++) {
+
+        const Signal& s = signals[i];
+        if (s.id != id || s.start + s.length > dataLen) continue;
+
+        uint32_t raw = 0;
+        for (uint8_t b = 0; b < s.length; b++) raw = raw << 8 | data[s.start + b];
+        if (s.invalidRaw && raw == s.invalidRaw) continue;
+
+        readings[i] = { raw * s.scale + s.offset, nowMs, true };
+        matched = true;
+    }
+    if (matched) st.matched++;
+}
+
+bool CanMonitor::take(size_t index, float& value, uint32_t& tMs) {
+
+    if (index >= count || !readings[index].fresh) return false;
+    value = readings[index].value;
+    tMs = readings[index].tMs;
+    readings[index].fresh = false;
+    return true;
+}
+
+bool CanMonitor::filterPattern(char* out, size_t size) const {
+
+    if (count == 0 || size < ID_DIGITS + 1) return false;
+
+    static const char HEX[] = "0123456789ABCDEF";
+    for (size_t d = 0; d < ID_DIGITS; d++) {
+        unsigned shift = 4 * (unsigned)(ID_DIGITS - 1 - d);
+        unsigned digit = (signals[0].id >> shift) & 0xF;
+        bool common = true;
+        for (size_t i = 1; i < count; i++)
+            if (((signals[i].id >> shift) & 0xF) != digit) common = false;
+        out[d] = common ? HEX[digit] : 'X';
+    }
+    out[ID_DIGITS] = '\0';
+    return true;
+}
@@ -0,0 +1,89 @@
+#include "capture_replay.h"
+#include <string.h>
+
+// Moduł celowo nie używa Arduino.h - kompiluje się również na hoście
+// (tools/capture_replay.cpp)
+
+using namespace TripLogFormat;
+
+bool CaptureReplay::load(const uint8_t* file, size_t len) {
+
+    data = nullptr;
+    size = 0;
+
+    StreamType type;
+    if (!file || len < FILE_HEADER_SIZE || !readFileHeader(file, type) || type != STREAM_CAPTURE)
+        return false;
+
+    data = file;
+    size = len;
+    return true;
+}
+
+bool CaptureReplay::run(Handler handler, void* ctx, double speed, ClockUs clock, SleepUs sleep) {
+
+    st = {};
+    if (!data || !handler) return false;
+    if (speed > 0.0 && (!clock || !sleep)) return false;
+
+    bool started = false;
+    uint32_t last = 0;              // Ostatni czas z pliku (32 bit, micros())
+    uint64_t elapsed = 0;           // Czas od pierwszego fragmentu, rozwinięty do 64 bit
+    uint64_t wallStart = 0;
+    bool resyncing = false;
+
+    size_t pos = FILE_HEADER_SIZE;
+    while (pos + BLOCK_HEADER_SIZE <= size) {
+
+        BlockHeader hdr;
+        if (!readBlockHeader(&data[pos], hdr) || pos + BLOCK_HEADER_SIZE + hdr.length > size) {
+            // Resynchronizacja: szukanie kolejnego znacznika bloku (uszkodzony obszar liczony raz)
+            if (!resyncing) st.badBlocks++;
+            resyncing = true;
+            pos++;
+            continue;
+        }
+        resyncing = false;
+
+        BlockReader reader;
+        if (!reader.begin(hdr, &data[pos + BLOCK_HEADER_SIZE])) {
+            st.badBlocks++;
+            pos += BLOCK_HEADER_SIZE + hdr.length;
+            continue;
+        }
+        st.blocks++;
+
+        CaptureChunk c;
+        while (reader.next(c)) {
+
+            if (!started) {
+                started = true;
+                last = c.timeUs;
+                if (speed > 0.0) wallStart = clock();
+            }
+            // Różnica ze znakiem: przepełnienie micros() to krok do przodu,
+            // drobne cofnięcie (kolejność producentów) nie cofa czasu odtwarzania
+            int32_t dt = (int32_t)(c.timeUs - last);
+            if (dt > 0) {
+                elapsed += (uint32_t)dt;
+                last = c.timeUs;
+            }
+
+            // Tempo nagrania: czekanie do chwili fragmentu przeskalowanej przez speed
+            if (speed > 0.0) {
+                uint64_t due = wallStart + (uint64_t)(elapsed / speed);
+                uint64_t now = clock();
+                if (now < due) sleep(due - now);
+                else if (now - due > st.maxLagUs) st.maxLagUs = now - due;
+            }
+
+            handler(ctx, elapsed, c.channel, c.data, c.len);
+            st.chunks++;
+            st.bytes[c.channel] += c.len;
+        }
+        pos += BLOCK_HEADER_SIZE + hdr.length;
+    }
+
+    st.durationUs = elapsed;
+    return true;
+}
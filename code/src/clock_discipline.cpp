@@ -0,0 +1,172 @@
+#include "clock_discipline.h"
+#include <math.h>
+
+// Moduł celowo nie używa Arduino.h - kompiluje się również na hoście
+
+// Niepewność dryfu = tyle odchyleń standardowych nachylenia regresji
+static constexpr double DRIFT_SIGMAS = 3.0;
+
+ClockDiscipline::ClockDiscipline() : cfg() {
+    reset();
+}
+
+ClockDiscipline::ClockDiscipline(const Config& config) : cfg(config) {
+    reset();
+}
+
+void ClockDiscipline::reset() {
+
+    st = Stats();
+    m = Model();
+    m.holdoverUs = cfg.holdoverMs * 1000;
+    sw = sx = sy = sxx = sxy = syy = 0.0;
+    offsetUs = 0;
+    fitted = false;
+    priorPpb = 0;
+    priorAccPpb = cfg.maxPpm * 1000;
+    rejects = 0;
+}
+
+// Model od odniesienia; dryf poprzedniego modelu jako wartość przyjęta
+void ClockDiscipline::restart(int64_t monoUs, int64_t utcUs, uint32_t accUs, Source source) {
+
+    if (m.source != SOURCE_NONE) {
+        priorPpb = m.ppb;
+        priorAccPpb = m.driftPpb;
+    }
+
+    m.monoUs = monoUs;
+    m.utcUs = utcUs;
+    m.ppb = priorPpb;
+    m.accUs = accUs;
+    m.driftPpb = priorAccPpb;
+    m.source = source;
+
+    offsetUs = utcUs - monoUs;
+    sw = 1.0;
+    sx = sy = sxx = sxy = syy = 0.0;
+    fitted = false;
+    rejects = 0;
+}
+
+bool ClockDiscipline::addReference(int64_t monoUs, int64_t utcUs, uint32_t accUs, Source source) {
+
+    if (source == SOURCE_NONE || source == SOURCE_HOLDOVER) return false;
+
+    if (m.source == SOURCE_NONE) {
+        restart(monoUs, utcUs, accUs, source);
+        st.steps++;
+        st.maxErrorUs = 0;
+        return true;
+    }
+
+    // Odniesienia w kolejności zegara monotonicznego
+    if (monoUs <= m.monoUs) {
+        st.rejected++;
+        return false;
+    }
+
+    // Gorsze źródło, dopóki lepsze nadaje
+    bool active = monoUs - m.monoUs <= (int64_t)m.holdoverUs;
+    if (source < m.source && active) {
+        st.ignored++;
+        return false;
+    }
+
+    int64_t err = utcUs - m.utcAt(monoUs);
+    int64_t absErr = err < 0 ? -err : err;
+    st.lastErrorUs = (int32_t)(err < INT32_MIN ? INT32_MIN : err > INT32_MAX ? INT32_MAX : err);
+
+    // Zmiana źródła - regresja od nowa z dotychczasowym dryfem
+    if (source != m.source && absErr <= (int64_t)cfg.stepUs) {
+        restart(monoUs, utcUs, accUs, source);
+        st.references++;
+        return true;
+    }
+
+    // Skok czasu lub odniesienie odstające
+    int64_t gate = 4 * ((int64_t)accUs + m.accuracyAt(monoUs));
+    if (gate < (int64_t)cfg.gateMinUs) gate = cfg.gateMinUs;
+    if (absErr > gate) {
+        if (absErr <= (int64_t)cfg.stepUs && ++rejects < cfg.rejectSteps) {
+            st.rejected++;
+            return false;
+        }
+        restart(monoUs, utcUs, accUs, source);
+        st.steps++;
+        st.maxErrorUs = 0;
+        return true;
+    }
+    rejects = 0;
+    if (absErr > st.maxErrorUs) st.maxErrorUs = (uint32_t)absErr;
+
+    // Zapominanie i przesunięcie sum do nowej chwili: x' = x - c [s]
+    double c = (double)(monoUs - m.monoUs) * 1e-6;
+    double l = exp(-c / (source == SOURCE_PPS ? cfg.ppsWindowS : cfg.windowS));
+    sw *= l;
+    sx *= l;
+    sy *= l;
+    sxx *= l;
+    sxy *= l;
+    syy *= l;
+    sxx += c * (c * sw - 2.0 * sx);
+    sxy -= c * sy;
+    sx -= c * sw;
+
+    // y' = y - d: odniesienie y względem przewidywania modelu (wartości bliskie 0)
+    int64_t d = m.utcAt(monoUs) - monoUs - offsetUs;
+    double dd = (double)d;
+    syy += dd * (dd * sw - 2.0 * sy);
+    sxy -= dd * sx;
+    sy -= dd * sw;
+    offsetUs += d;
+
+    double y = (double)err;
+    sw += 1.0;
+    sy += y;
+    syy += y * y;
+
+    m.monoUs = monoUs;
+    fit(accUs);
+    st.references++;
+    return true;
+}
+
+// Prosta regresji w chwili m.monoUs (x = 0): przesunięcie, dryf i ich niepewności
+void ClockDiscipline::fit(uint32_t accUs) {
+
+    double mx = sx / sw;
+    double my = sy / sw;
+    double vx = sxx / sw - mx * mx;                 // [s^2]
+    double span = sqrt(vx > 0.0 ? 12.0 * vx : 0.0); // Rozpiętość równomiernie rozłożonych odniesień
+
+    double b;                                       // [us/s = ppm]
+    fitted = span >= cfg.minSpanS;
+    if (fitted) {
+        b = (sxy / sw - mx * my) / vx;
+        double lim = (double)cfg.maxPpm;
+        if (b > lim) b = lim;
+        if (b < -lim) b = -lim;
+    } else {
+        b = priorPpb * 1e-3;
+    }
+    double a = my - b * mx;
+
+    // Średni kwadrat reszt
+    double res = syy / sw - 2.0 * a * my - 2.0 * b * sxy / sw + a * a + 2.0 * a * b * mx + b * b * sxx / sw;
+    if (res < 0.0) res = 0.0;
+    double acc = (double)accUs;
+    double sigma2 = res > acc * acc ? res : acc * acc;
+
+    m.utcUs = m.monoUs + offsetUs + llround(a);
+    m.ppb = (int32_t)lround(b * 1000.0);
+    m.accUs = (uint32_t)sqrt(sigma2);
+    if (fitted) {
+        double sb = sqrt(sigma2 / (sw * vx)) * 1000.0 * DRIFT_SIGMAS;
+        m.driftPpb = (uint32_t)(sb < 1e9 ? sb : 1e9) + cfg.driftFloorPpb;
+        priorPpb = m.ppb;                           // Po długiej przerwie (sumy wygasły) - ostatni dryf
+        priorAccPpb = m.driftPpb;
+    } else {
+        m.driftPpb = priorAccPpb;
+    }
+}
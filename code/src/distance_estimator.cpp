@@ -0,0 +1,145 @@
+#include "distance_estimator.h"
+
+// Moduł celowo nie używa Arduino.h - kompiluje się również na hoście
+
+DistanceEstimator::DistanceEstimator() {
+    reset();
+}
+
+void DistanceEstimator::reset() {
+
+    speedAcc = 0;
+    haveSpeed = false;
+    lastSpeedMs = 0;
+    lastSpeed = -1;
+
+    haveOdometer = false;
+    lastKm = 0;
+    lastOdoMs = 0;
+    integratedAtLastOdo = 0;
+
+    anchorMm = 0;
+    integratedAtAnchor = 0;
+    firstTickMm = 0;
+    firstTickKm = 0;
+
+    reportedMm = 0;
+    st = Stats();
+}
+
+// (v1 + v2) / 2 [km/h] x dt [ms] / 3.6 = mm  =>  suma x 10 / 72
+uint64_t DistanceEstimator::integratedMm() const {
+    return speedAcc * 10 / 72;
+}
+
+void DistanceEstimator::addSpeed(uint32_t tMs, int speedKmh) {
+
+    if (speedKmh < 0) {
+        haveSpeed = false;
+        return;
+    }
+
+    if (haveSpeed) {
+        uint32_t dt = tMs - lastSpeedMs;
+        if (dt <= MAX_GAP_MS) speedAcc += (uint64_t)(lastSpeed + speedKmh) * dt;
+        else st.gaps++;
+    }
+
+    haveSpeed = true;
+    lastSpeed = speedKmh;
+    lastSpeedMs = tMs;
+    publish();
+}
+
+void DistanceEstimator::addOdometer(uint32_t tMs, long km) {
+
+    uint64_t integrated = integratedMm();
+
+    if (!haveOdometer) {
+        // Pierwszy odczyt - start gdzieś wewnątrz kilometra km
+        haveOdometer = true;
+        lastKm = km;
+        lastOdoMs = tMs;
+        integratedAtLastOdo = integrated;
+        anchorMm = 0;
+        integratedAtAnchor = 0;
+        publish();
+        return;
+    }
+
+    if (km <= lastKm) {
+        // Bez zmiany (mniejsze wskazanie = błędny odczyt, pomijany)
+        if (km == lastKm) {
+            lastOdoMs = tMs;
+            integratedAtLastOdo = integrated;
+            publish();
+        }
+        return;
+    }
+
+    uint32_t crossed = (uint32_t)(km - lastKm);
+    uint64_t window = integrated - integratedAtLastOdo;     // Dystans między odczytami
+
+    // Szacunek przed korektą (do statystyki)
+    uint64_t atRead = integratedAtLastOdo - integratedAtAnchor;
+    if (atRead > MM_PER_KM - 1) atRead = MM_PER_KM - 1;
+    int64_t before = (int64_t)(anchorMm + atRead + window);
+
+    uint64_t residual;          // Dystans od granicy km do chwili odczytu
+    if (!st.anchored) {
+
+        if (integrated == 0) {
+            // Brak prędkości - jak sam odometr: zmiana wskazania = 1 km
+            residual = 0;
+            firstTickMm = MM_PER_KM;
+        } else {
+            // Granica gdzieś w oknie - środek okna; dystans do niej wyznacza start w km
+            residual = window / 2;
+            uint64_t toTick = atRead + (window - residual);
+            firstTickMm = toTick < MM_PER_KM ? toTick : MM_PER_KM - 1;
+        }
+        firstTickKm = lastKm + 1;
+        st.anchored = true;
+
+    } else {
+
+        // Całka od poprzedniej granicy minus przejechane pełne km, ograniczona do okna
+        int64_t over = (int64_t)(integrated - integratedAtAnchor) - (int64_t)crossed * MM_PER_KM;
+        if (over < 0) over = 0;
+        if ((uint64_t)over > window) over = (int64_t)window;
+        residual = (uint64_t)over;
+    }
+
+    anchorMm = firstTickMm + (uint64_t)(km - firstTickKm) * MM_PER_KM;
+    integratedAtAnchor = integrated - residual;
+
+    lastKm = km;
+    lastOdoMs = tMs;
+    integratedAtLastOdo = integrated;
+    st.ticks += crossed;
+
+    int64_t after = (int64_t)(anchorMm + residual);
+    st.lastCorrectionMm = (int32_t)(after - before);
+    uint32_t magnitude = (uint32_t)(after > before ? after - before : before - after);
+    if (magnitude > st.maxCorrectionMm) st.maxCorrectionMm = magnitude;
+
+    publish();
+}
+
+void DistanceEstimator::publish() {
+
+    uint64_t integrated = integratedMm();
+    uint64_t estimate;
+
+    if (!haveOdometer) {
+        estimate = integrated;
+    } else {
+        // Do ostatniego odczytu odometr się nie zmienił => najwyżej 1 km od kotwicy
+        uint64_t atRead = integratedAtLastOdo - integratedAtAnchor;
+        if (atRead > MM_PER_KM - 1) atRead = MM_PER_KM - 1;
+        estimate = anchorMm + atRead + (integrated - integratedAtLastOdo);
+    }
+
+    if (estimate > UINT32_MAX) estimate = UINT32_MAX;
+    if (estimate > reportedMm) reportedMm = (uint32_t)estimate;
+}
@@ -0,0 +1,327 @@
+#include "distance_fusion.h"
+#include <math.h>
+
+// Moduł celowo nie używa Arduino.h - kompiluje się również na hoście
+
+// Prędkość przyjmowana jako górna granica w przerwie bez pomiarów [m/s]
+static constexpr float BLIND_SPEED = 40.0f;
+
+// Dolne granice wariancji (zaokrąglenia float po wielu aktualizacjach)
+static constexpr float MIN_VAR_S = 1e-4f;
+static constexpr float MIN_VAR_V = 1e-4f;
+static constexpr float MIN_VAR_K = 1e-8f;
+
+// Dopuszczalny zakres skali prędkości OBD
+static constexpr float MIN_SCALE = 0.8f;
+static constexpr float MAX_SCALE = 1.25f;
+
+DistanceFusion::DistanceFusion() : cfg() {
+    reset();
+}
+
+DistanceFusion::DistanceFusion(const Config& config) : cfg(config) {
+    reset();
+}
+
+void DistanceFusion::reset() {
+
+    st = Stats();
+    s = 0.0f;
+    v = 0.0f;
+    k = 1.0f;
+    r = 0.0f;
+    pss = psv = psk = psr = pvk = pvr = pkr = prr = 0.0f;
+    pvv = BLIND_SPEED * BLIND_SPEED / 4;
+    pkk = cfg.scaleSigma * cfg.scaleSigma;
+    baseMm = 0;
+
+    started = false;
+    lastMs = 0;
+    aidMs = 0;
+    blind = false;
+    blindFromMs = 0;
+
+    gpsRef = false;
+    gpsRefOdoMm = 0;
+    gpsRefUpdates = 0;
+    gpsLastMs = 0;
+    gpsBlind = false;
+
+    haveOdometer = false;
+    lastKm = 0;
+    lastOdoMs = 0;
+    odoRef = false;
+    refKm = 0;
+    refMm = 0;
+
+    reportedMm = 0;
+}
+
+// =============================================================================
+// PREDYKCJA
+// =============================================================================
+
+// s += v x dt; P = F P F' + Q (szum przyspieszenia, dryf skali; kopia r stała)
+void DistanceFusion::propagate(float dt) {
+
+    float q = cfg.accelSigma * cfg.accelSigma;
+    float dt2 = dt * dt;
+
+    if (v > 0.0f) s += v * dt;
+    pss += dt * (2.0f * psv + dt * pvv) + q * dt2 * dt / 3.0f;
+    psv += dt * pvv + q * dt2 / 2.0f;
+    psk += dt * pvk;
+    psr += dt * pvr;
+    pvv += q * dt;
+    pkk += cfg.scaleDrift * cfg.scaleDrift * dt;
+}
+
+void DistanceFusion::predict(uint32_t tMs) {
+
+    if (!started) {
+        started = true;
+        lastMs = aidMs = tMs;
+        return;
+    }
+
+    // Pomiar sprzed chwili stanu (np. fix odczytany po próbce OBD) - stosowany teraz
+    int32_t dtMs = (int32_t)(tMs - lastMs);
+    if (dtMs <= 0) return;
+
+    // Koniec pomiarów: całkowanie tylko do blindMs po ostatnim
+    if (!blind && tMs - aidMs > cfg.blindMs) {
+        uint32_t until = aidMs + cfg.blindMs;
+        int32_t partMs = (int32_t)(until - lastMs);
+        if (partMs > 0) propagate(partMs / 1000.0f);
+        enterBlind();
+        blindFromMs = until;
+    }
+
+    if (!blind) propagate(dtMs / 1000.0f);
+    lastMs = tMs;
+}
+
+// Prędkość nieznana: stop całkowania, pozycja zostaje
+void DistanceFusion::enterBlind() {
+
+    v = 0.0f;
+    pvv = BLIND_SPEED * BLIND_SPEED / 4;
+    psv = pvk = pvr = 0.0f;
+    blind = true;
+    gpsBlind = true;
+    st.blind++;
+}
+
+// Pomiar prędkości lub pozycji; po przerwie dystans przerwy jest nieznany
+void DistanceFusion::aided(uint32_t tMs) {
+
+    if (blind) {
+        float gap = (int32_t)(tMs - blindFromMs) > 0 ? (tMs - blindFromMs) / 1000.0f : 0.0f;
+        pss += BLIND_SPEED * BLIND_SPEED * gap * gap / 3.0f;
+        blind = false;
+    }
+    aidMs = tMs;
+}
+
+// Odniesienie dystansu z pozycji: r = s razem z kowariancjami (pomiar s - r
+// nie zmniejsza niepewności samego s, tylko przyrostu od odniesienia)
+void DistanceFusion::clone() {
+
+    r = s;
+    prr = pss;
+    psr = pss;
+    pvr = psv;
+    pkr = psk;
+}
+
+// =============================================================================
+// KOREKTA
+// =============================================================================
+
+// Pomiar skalarny: y = z - h(x), H = [h0 h1 h2 h3], wariancja rv
+bool DistanceFusion::correct(float y, float h0, float h1, float h2, float h3, float rv, bool gate) {
+
+    float a = pss * h0 + psv * h1 + psk * h2 + psr * h3;  // P H'
+    float b = psv * h0 + pvv * h1 + pvk * h2 + pvr * h3;
+    float c = psk * h0 + pvk * h1 + pkk * h2 + pkr * h3;
+    float d = psr * h0 + pvr * h1 + pkr * h2 + prr * h3;
+    float sy = h0 * a + h1 * b + h2 * c + h3 * d + rv;  // Wariancja innowacji
+    if (!(sy > 0.0f)) return false;
+
+    if (gate && y * y > cfg.gateSigma * cfg.gateSigma * sy) {
+        st.rejected++;
+        return false;
+    }
+
+    float inv = 1.0f / sy;
+    float ka = a * inv, kb = b * inv, kc = c * inv, kd = d * inv;
+    s += ka * y;
+    v += kb * y;
+    k += kc * y;
+    r += kd * y;
+
+    pss -= ka * a;
+    psv -= ka * b;
+    psk -= ka * c;
+    psr -= ka * d;
+    pvv -= kb * b;
+    pvk -= kb * c;
+    pvr -= kb * d;
+    pkk -= kc * c;
+    pkr -= kc * d;
+    prr -= kd * d;
+
+    if (pss < MIN_VAR_S) pss = MIN_VAR_S;
+    if (pvv < MIN_VAR_V) pvv = MIN_VAR_V;
+    if (pkk < MIN_VAR_K) pkk = MIN_VAR_K;
+    if (v < 0.0f) v = 0.0f;
+    if (k < MIN_SCALE) k = MIN_SCALE;
+    else if (k > MAX_SCALE) k = MAX_SCALE;
+    return true;
+}
+
+// =============================================================================
+// POMIARY
+// =============================================================================
+
+void DistanceFusion::addObdSpeed(uint32_t tMs, int speedKmh) {
+
+    if (speedKmh < 0) return;
+    predict(tMs);
+    aided(tMs);
+
+    float rv = cfg.obdSpeedSigma * cfg.obdSpeedSigma;
+    correct(speedKmh / 3.6f - k * v, 0.0f, k, v, 0.0f, rv, false);
+    st.obdSpeed++;
+    publish();
+}
+
+void DistanceFusion::addGps(uint32_t tMs, bool valid, int32_t speedMmS, uint32_t odometerMm,
+                            uint16_t hdop, uint8_t sats) {
+
+    if (!valid || hdop > cfg.maxHdop || sats < cfg.minSats) return;
+    if (gpsRef && tMs == gpsLastMs) return;         // Ta sama epoka
+
+    predict(tMs);
+    aided(tMs);
+    float q = hdop > 100 ? hdop / 100.0f : 1.0f;
+
+    // Doppler: poniżej progu postoju = 0
+    if (speedMmS >= 0) {
+        float z = (uint32_t)speedMmS < cfg.stationaryMmS ? 0.0f : speedMmS / 1000.0f;
+        float sigma = cfg.gpsSpeedSigma * q;
+        if (correct(z - v, 0.0f, 1.0f, 0.0f, 0.0f, sigma * sigma, true)) st.gpsSpeed++;
+    }
+
+    // Dystans z pozycji: z Dopplerem tylko cięciwa po przerwie, w której filtr był ślepy
+    // (GpsOdometer opóźnia przyrost o promień szumu i serie odrzuceń - Doppler jest dokładniejszy);
+    // bez Dopplera przyrost od odniesienia, po przerwie w fixach nowe odniesienie (droga z OBD)
+    bool gap = tMs - gpsLastMs > cfg.gpsGapMs;
+    bool chord = gpsRef && gap && gpsBlind;
+    bool restart = true;
+    if (chord || (gpsRef && !gap && speedMmS < 0)) {
+        // h = s - r; kolejne pomiary od tego samego odniesienia mają wspólny błąd - waga jednego na okno
+        uint32_t inc = odometerMm - gpsRefOdoMm;
+        float sigma = cfg.gpsPositionSigma * q;
+        if (correct(inc / 1000.0f - (s - r), 1.0f, 0.0f, 0.0f, -1.0f, sigma * sigma * ++gpsRefUpdates, false))
+            st.gpsPosition++;
+        restart = chord || inc >= cfg.gpsWindowM * 1000.0f;
+    }
+    if (restart) {
+        gpsRef = true;
+        gpsRefOdoMm = odometerMm;
+        gpsRefUpdates = 0;
+        clone();
+    }
+    gpsLastMs = tMs;
+    gpsBlind = false;
+    publish();
+}
+
+void DistanceFusion::addOdometer(uint32_t tMs, long km) {
+
+    if (km < 0) return;
+    predict(tMs);
+
+    if (!haveOdometer || km < lastKm) {
+        // Pierwszy odczyt lub cofnięte wskazanie - start gdzieś wewnątrz kilometra km
+        haveOdometer = true;
+        odoRef = false;
+        lastKm = km;
+        lastOdoMs = tMs;
+        return;
+    }
+
+    float dt = (tMs - lastOdoMs) / 1000.0f;
+    lastOdoMs = tMs;
+    float rv = cfg.odoTickSigma * cfg.odoTickSigma;
+
+    if (km == lastKm) {
+        // Bez zmiany: do następnej granicy km nie dojechaliśmy
+        if (odoRef) {
+            int64_t bound = refMm + (int64_t)(km - refKm + 1) * 1000000;
+            int64_t est = estimateMm();
+            if (est > bound) correct((float)(bound - est) / 1000.0f, 1.0f, 0.0f, 0.0f, 0.0f, rv, false);
+            publish();
+        }
+        return;
+    }
+
+    // Zmiana gdzieś między odczytami - pomiar dotyczy s - v x dt / 2
+    float back = v * dt / 2.0f;
+    if (!odoRef) {
+        odoRef = true;
+        refKm = km;
+        refMm = estimateMm() - (int64_t)(back * 1000.0f);
+    } else {
+        int64_t z = refMm + (int64_t)(km - refKm) * 1000000;
+        float y = (float)(z - estimateMm()) / 1000.0f + back;
+        float window = v * dt;
+        correct(y, 1.0f, -dt / 2.0f, 0.0f, 0.0f, rv + window * window / 12.0f, false);
+
+        st.lastCorrectionMm = (int32_t)(y * 1000.0f);
+        uint32_t abs = (uint32_t)(st.lastCorrectionMm < 0 ? -st.lastCorrectionMm : st.lastCorrectionMm);
+        if (abs > st.maxCorrectionMm) st.maxCorrectionMm = abs;
+    }
+    st.odometerTicks += (uint32_t)(km - lastKm);
+    lastKm = km;
+    publish();
+}
+
+void DistanceFusion::advance(uint32_t tMs) {
+
+    predict(tMs);
+    publish();
+}
+
+// =============================================================================
+// WYJŚCIE
+// =============================================================================
+
+int64_t DistanceFusion::estimateMm() const {
+    return baseMm + (int64_t)floorf(s * 1000.0f + 0.5f);
+}
+
+// Pełne metry do bazy (precyzja float), wyjście niemalejące
+void DistanceFusion::publish() {
+
+    if (s >= 1.0f || s <= -1.0f) {
+        float whole = floorf(s);
+        baseMm += (int64_t)whole * 1000;
+        s -= whole;
+        r -= whole;
+    }
+
+    int64_t est = estimateMm();
+    if (est > (int64_t)reportedMm) reportedMm = (uint32_t)est;
+}
+
+float DistanceFusion::speedKmh() const {
+
+    if (!started || blind) return -1.0f;
+    return v * 3.6f;
+}
+
+float DistanceFusion::sigmaM() const {
+    return sqrtf(pss);
+}
@@ -0,0 +1,673 @@
+#include "elm327_emulator.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+// Moduł celowo nie używa Arduino.h - kompiluje się również na hoście
+
+static constexpr size_t SINGLE_FRAME_BYTES = 7;     // Dane w jednej ramce CAN (ISO-TP)
+static constexpr size_t FIRST_FRAME_BYTES = 6;
+static constexpr size_t NEXT_FRAME_BYTES = 7;
+static constexpr size_t MAX_BATCH = 6;              // Jak ObdPid::MAX_BATCH
+
+// Przejazd ~1 h: postój i rozgrzewanie, miasto 50 km/h do 10 min, trasa 100 km/h.
+// Spalanie: postój 0.8 L/h, miasto ~3.5 L/h, trasa ~6 L/h (MAF wg AFR 14.7, 0.755 kg/l)
+const char* const Elm327Emulator::DEFAULT_SCRIPT =
+    "# czas[ms] komenda dane\n"
+    "0        010D   00\n"
+    "30000    010D   00\n"
+    "60000    010D   32\n"
+    "600000   010D   32\n"
+    "660000   010D   64\n"
+    "3600000  010D   64\n"
+    "0        0110   00F7\n"
+    "30000    0110   00F7\n"
+    "60000    0110   0438\n"
+    "600000   0110   0438\n"
+    "660000   0110   073A\n"
+    "3600000  0110   073A\n"
+    "0        010C   0C80\n"
+    "30000    010C   0C80\n"
+    "60000    010C   1C20\n"
+    "600000   010C   1C20\n"
+    "660000   010C   2710\n"
+    "0        0105   3C\n"
+    "600000   0105   82\n"
+    "60000    22DD01 00C350\n"
+    "600000   22DD01 00C357\n"
+    "660000   22DD01 00C359\n"
+    "3600000  22DD01 00C3AB\n";
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+static bool isHex(const char* s, size_t len) {
+    for (size_t i = 0; i < len; i++)
+        if (hexValue(s[i]) < 0) return false;
+    return len > 0;
+}
+
+static uint8_t hexByte(const char* s) {
+    return (uint8_t)(hexValue(s[0]) << 4 | hexValue(s[1]));
+}
+
+// =============================================================================
+// KONFIGURACJA I SKRYPT
+// =============================================================================
+
+Elm327Emulator::Config Elm327Emulator::defaultConfig(uint32_t (*nowMs)(), void (*sleepMs)(uint32_t)) {
+
+    Config c = {};
+    c.latencyMs = 50;
+    c.jitterMs = 20;
+    c.perPidMs = 5;
+    c.searching = true;
+    c.searchMs = 1500;
+    c.resetMs = 800;
+    c.protocol = 6;
+    c.vin = "YV1MV7451D2000001";
+    c.multiPid = true;
+    c.monitor = true;
+    c.seed = 1;
+    c.nowMs = nowMs;
+    c.sleepMs = sleepMs;
+    return c;
+}
+
+Elm327Emulator::Elm327Emulator(const Config& config)
+    : handler(nullptr), stats(), keyframeCount(0), extraDelayMs(0), monitoring(false), monitorStartMs(0),
+      online(true), offlineUntilMs(0),
+      sinceDisconnect(0), inputLen(0), outLen(0) {
+    setConfig(config);
+    startMs = cfg.nowMs ? cfg.nowMs() : 0;
+    resetAdapter();
+}
+
+void Elm327Emulator::setConfig(const Config& config) {
+
+    cfg = config;
+    rng = cfg.seed ? cfg.seed : 1;
+}
+
+bool Elm327Emulator::loadScript(const char* text, int* errorLine) {
+
+    keyframeCount = 0;
+    startMs = cfg.nowMs ? cfg.nowMs() : 0;
+    int lineNo = 0;
+
+    while (*text) {
+
+        const char* eol = strchr(text, '\n');
+        size_t lineLen = eol ? (size_t)(eol - text) : strlen(text);
+        lineNo++;
+
+        char line[96];
+        size_t n = lineLen < sizeof(line) - 1 ? lineLen : sizeof(line) - 1;
+        memcpy(line, text, n);
+        line[n] = '\0';
+        text = eol ? eol + 1 : text + lineLen;
+
+        char* hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+
+        char cmd[32], data[32];
+        unsigned long t;
+        int fields = sscanf(line, "%lu %31s %31s", &t, cmd, data);
+        if (fields <= 0) continue;                              // Pusta linia / komentarz
+
+        size_t cmdLen = strlen(cmd);
+        size_t dataLen = fields == 3 ? strlen(data) : 0;
+        if (fields != 3 || cmdLen < 4 || cmdLen > MAX_COMMAND || cmdLen % 2 || !isHex(cmd, cmdLen)
+            || dataLen < 2 || dataLen > 8 || dataLen % 2 || !isHex(data, dataLen)
+            || keyframeCount >= MAX_KEYFRAMES) {
+            if (errorLine) *errorLine = lineNo;
+            keyframeCount = 0;
+            return false;
+        }
+
+        Keyframe& k = keyframes[keyframeCount];
+        k.tMs = (uint32_t)t;
+        for (size_t i = 0; i <= cmdLen; i++) k.cmd[i] = (char)toupper((unsigned char)cmd[i]);
+        k.len = (uint8_t)(dataLen / 2);
+        k.value = (uint32_t)strtoul(data, nullptr, 16);
+
+        // Punkty tej samej komendy: czas niemalejący, stała długość danych
+        for (size_t i = keyframeCount; i-- > 0;) {
+            if (strcmp(keyframes[i].cmd, k.cmd) != 0) continue;
+            if (keyframes[i].tMs > k.tMs || keyframes[i].len != k.len) {
+                if (errorLine) *errorLine = lineNo;
+                keyframeCount = 0;
+                return false;
+            }
+            break;
+        }
+        keyframeCount++;
+    }
+    return true;
+}
+
+bool Elm327Emulator::scriptValue(const char* cmd, uint32_t tMs, uint8_t* data, uint8_t* len) const {
+
+    const Keyframe* prev = nullptr;
+    const Keyframe* next = nullptr;
+
+    for (size_t i = 0; i < keyframeCount; i++) {
+        const Keyframe& k = keyframes[i];
+        if (strcmp(k.cmd, cmd) != 0) continue;
+        if (k.tMs <= tMs) prev = &k;
+        else if (!next) next = &k;
+    }
+    if (!prev && !next) return false;
+
+    uint32_t value;
+    if (prev && next) {
+        int64_t span = (int64_t)next->value - prev->value;
+        value = (uint32_t)(prev->value + span * (tMs - prev->tMs) / (next->tMs - prev->tMs));
+    } else {
+        value = prev ? prev->value : next->value;
+    }
+
+    *len = prev ? prev->len : next->len;
+    for (uint8_t i = 0; i < *len; i++)
+        data[i] = (uint8_t)(value >> (8 * (*len - 1 - i)));
+    return true;
+}
+
+// Mapa obsługiwanych PID (base+1 .. base+0x20) ze skryptu Mode 01
+bool Elm327Emulator::supportBitmap(uint8_t base, uint8_t* data) const {
+
+    uint32_t bits = 0;
+    for (size_t i = 0; i < keyframeCount; i++) {
+
+        const Keyframe& k = keyframes[i];
+        if (strlen(k.cmd) != 4 || k.cmd[0] != '0' || k.cmd[1] != '1') continue;
+
+        uint8_t pid = hexByte(k.cmd + 2);
+        if (pid > base && pid <= base + 0x20) bits |= 1u << (32 - (pid - base));
+        else if (pid > base + 0x20) bits |= 1u;             // Kolejny zakres istnieje
+    }
+
+    for (int i = 0; i < 4; i++) data[i] = (uint8_t)(bits >> (24 - 8 * i));
+    return base == 0 || bits != 0;
+}
+
+// =============================================================================
+// TRANSPORT
+// =============================================================================
+
+void Elm327Emulator::setHandler(DataHandler h) {
+    handler = h;
+}
+
+bool Elm327Emulator::connected() {
+
+    if (!online && cfg.nowMs && (int32_t)(cfg.nowMs() - offlineUntilMs) >= 0) online = true;
+    return online;
+}
+
+bool Elm327Emulator::connect() {
+    return connected();
+}
+
+void Elm327Emulator::disconnect() {
+
+    online = false;
+    offlineUntilMs = cfg.nowMs ? cfg.nowMs() : 0;
+    inputLen = 0;
+    monitoring = false;
+}
+
+size_t Elm327Emulator::write(const uint8_t* data, size_t len) {
+
+    if (!connected()) return 0;
+
+    // Dowolny znak przerywa nasłuch (i nie jest początkiem komendy)
+    if (monitoring && len > 0) {
+        stopMonitor();
+        return len;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        char c = (char)data[i];
+        if (c == '\r') {
+            input[inputLen] = '\0';
+            handleCommand(input);
+            inputLen = 0;
+        } else if (c != '\n' && c != ' ' && inputLen < sizeof(input) - 1) {
+            input[inputLen++] = (char)toupper((unsigned char)c);
+        }
+    }
+    return len;
+}
+
+// =============================================================================
+// ADAPTER
+// =============================================================================
+
+void Elm327Emulator::resetAdapter() {
+
+    echo = true;
+    linefeeds = true;
+    spaces = true;
+    headers = false;
+    protocol = 0;
+    autoProtocol = true;
+    connectedEcu = false;
+    searchPending = cfg.searching;
+    monitoring = false;
+    receiveFilter[0] = '\0';
+}
+
+uint32_t Elm327Emulator::random() {
+
+    // xorshift32 - powtarzalny przebieg dla danego ziarna
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+uint32_t Elm327Emulator::elapsedMs() const {
+    return cfg.nowMs ? cfg.nowMs() - startMs : 0;
+}
+
+void Elm327Emulator::appendLine(const char* text) {
+
+    size_t n = strlen(text);
+    const char* eol = linefeeds ? "\r\n" : "\r";
+    size_t eolLen = strlen(eol);
+    if (outLen + n + eolLen >= sizeof(out)) return;
+
+    memcpy(out + outLen, text, n);
+    outLen += n;
+    memcpy(out + outLen, eol, eolLen);
+    outLen += eolLen;
+}
+
+void Elm327Emulator::handleCommand(char* cmd) {
+
+    if (cmd[0] == '\0') return;
+    stats.commands++;
+
+    // Rozłączenie co disconnectAfter komend (komenda przepada)
+    if (cfg.disconnectAfter && ++sinceDisconnect >= cfg.disconnectAfter) {
+        sinceDisconnect = 0;
+        online = false;
+        offlineUntilMs = (cfg.nowMs ? cfg.nowMs() : 0) + cfg.disconnectMs;
+        inputLen = 0;
+        stats.disconnects++;
+        return;
+    }
+
+    if (cfg.dropPct && random() % 100 < cfg.dropPct) {
+        stats.dropped++;
+        return;
+    }
+
+    outLen = 0;
+    if (echo) appendLine(cmd);
+
+    uint32_t delay;
+    extraDelayMs = 0;
+    if (cmd[0] == 'A' && cmd[1] == 'T') {
+        handleAt(cmd + 2);
+        delay = cfg.latencyMs / 5;                          // Komendy AT nie idą do ECU
+    } else {
+        handleObd(cmd);
+        size_t pids = strlen(cmd) > 4 ? (strlen(cmd) - 2) / 2 : 1;
+        delay = cfg.latencyMs + (cfg.jitterMs ? random() % (cfg.jitterMs + 1) : 0)
+              + cfg.perPidMs * (uint32_t)(pids - 1);
+    }
+    delay += extraDelayMs;
+
+    // ATMA: bez znaku zachęty - ramki i '>' dopiero po przerwaniu
+    if (monitoring) {
+        deliver(delay);
+        return;
+    }
+
+    // Pusta linia i znak zachęty
+    appendLine("");
+    if (outLen < sizeof(out)) out[outLen++] = '>';
+    deliver(delay);
+}
+
+void Elm327Emulator::handleAt(const char* at) {
+
+    if (strcmp(at, "Z") == 0) {
+        resetAdapter();
+        extraDelayMs = cfg.resetMs;
+        appendLine("ELM327 v1.5");
+    } else if (strcmp(at, "I") == 0) {
+        appendLine("ELM327 v1.5");
+    } else if (strcmp(at, "@1") == 0) {
+        appendLine("OBDII to RS232 Interpreter");
+    } else if (strcmp(at, "RV") == 0) {
+        appendLine("12.6V");
+    } else if (strcmp(at, "DPN") == 0) {
+        // Protokół automatyczny: 'A' + wykryty (0 przed wyszukaniem)
+        char dpn[3];
+        uint8_t shown = autoProtocol ? (connectedEcu ? cfg.protocol : 0) : protocol;
+        snprintf(dpn, sizeof(dpn), autoProtocol ? "A%X" : "%X", shown);
+        appendLine(dpn);
+    } else if (strcmp(at, "D") == 0) {
+        resetAdapter();
+        appendLine("OK");
+    } else if ((at[0] == 'E' || at[0] == 'L' || at[0] == 'S' || at[0] == 'H')
+               && (at[1] == '0' || at[1] == '1') && at[2] == '\0') {
+        bool on = at[1] == '1';
+        if (at[0] == 'E') echo = on;
+        else if (at[0] == 'L') linefeeds = on;
+        else if (at[0] == 'S') spaces = on;
+        else headers = on;
+        appendLine("OK");
+    } else if (strcmp(at, "MA") == 0) {
+        if (!cfg.monitor) {
+            appendLine("?");
+            return;
+        }
+        monitoring = true;
+        monitorStartMs = cfg.nowMs ? cfg.nowMs() : 0;
+    } else if (strncmp(at, "CRA", 3) == 0) {
+        // ATCRA hhh (X = dowolna cyfra), ATCRA bez argumentu = wszystkie
+        const char* p = at + 3;
+        size_t n = strlen(p);
+        bool valid = n == 0 || n == 3;
+        for (size_t i = 0; i < n && valid; i++) valid = p[i] == 'X' || hexValue(p[i]) >= 0;
+        if (!valid) {
+            appendLine("?");
+            return;
+        }
+        memcpy(receiveFilter, p, n + 1);
+        appendLine("OK");
+    } else if ((at[0] == 'S' || at[0] == 'T') && at[1] == 'P' && at[2] != '\0') {
+        // ATSPx / ATSPAx (A = automatyczny, zaczynając od x); 0 = automatyczny
+        const char* num = at[2] == 'A' ? at + 3 : at + 2;
+        int value = hexValue(num[0]);
+        if (value < 0 || num[1] != '\0') {
+            appendLine("?");
+            return;
+        }
+        protocol = (uint8_t)value;
+        autoProtocol = protocol == 0 || at[2] == 'A';
+        connectedEcu = false;
+        searchPending = cfg.searching && autoProtocol;
+        appendLine("OK");
+    } else {
+        appendLine("?");
+    }
+}
+
+void Elm327Emulator::handleObd(const char* cmd) {
+
+    size_t len = strlen(cmd);
+    if (len < 2 || len % 2 || !isHex(cmd, len)) {
+        appendLine("?");
+        return;
+    }
+    stats.obdRequests++;
+
+    // Protokół ustawiony na stałe, inny niż ECU - brak odpowiedzi magistrali
+    if (!autoProtocol && protocol != cfg.protocol) {
+        appendLine("UNABLE TO CONNECT");
+        return;
+    }
+
+    if (searchPending) {
+        appendLine("SEARCHING...");
+        extraDelayMs = cfg.searchMs;
+        searchPending = false;
+    }
+    connectedEcu = true;
+
+    if (cfg.noDataPct && random() % 100 < cfg.noDataPct) {
+        stats.noData++;
+        appendLine("NO DATA");
+        return;
+    }
+
+    uint8_t mode = hexByte(cmd);
+    uint8_t payload[64];
+    size_t n = 0;
+    payload[n++] = (uint8_t)(mode + 0x40);
+
+    if (mode == 0x01) {
+
+        size_t count = (len - 2) / 2;
+        if (count == 0 || count > MAX_BATCH) {
+            appendLine("?");
+            return;
+        }
+
+        if (count == 1 || cfg.multiPid) {
+            for (size_t i = 0; i < count; i++) {
+
+                uint8_t pid = hexByte(cmd + 2 + 2 * i);
+                uint8_t data[4];
+                uint8_t dataLen = 0;
+                bool known;
+
+                if (pid % 0x20 == 0) {
+                    known = supportBitmap(pid, data);
+                    dataLen = 4;
+                } else {
+                    char key[5] = { '0', '1', cmd[2 + 2 * i], cmd[3 + 2 * i], '\0' };
+                    known = scriptValue(key, elapsedMs(), data, &dataLen);
+                    if (known && cfg.noisePct) {
+                        uint32_t v = 0;
+                        for (uint8_t b = 0; b < dataLen; b++) v = v << 8 | data[b];
+                        v = noisy(v, dataLen);
+                        for (uint8_t b = 0; b < dataLen; b++)
+                            data[b] = (uint8_t)(v >> (8 * (dataLen - 1 - b)));
+                    }
+                }
+                if (!known) continue;
+
+                payload[n++] = pid;
+                memcpy(payload + n, data, dataLen);
+                n += dataLen;
+            }
+        }
+    } else if (strcmp(cmd, "0902") == 0) {
+
+        // VIN: liczba elementów (1) + 17 znaków ASCII
+        if (cfg.vin && strlen(cfg.vin) == 17) {
+            payload[n++] = 0x02;
+            payload[n++] = 0x01;
+            memcpy(payload + n, cfg.vin, 17);
+            n += 17;
+        }
+    } else {
+
+        // Inne tryby: echo bajtów zapytania + dane ze skryptu
+        uint8_t data[4];
+        uint8_t dataLen = 0;
+        if (scriptValue(cmd, elapsedMs(), data, &dataLen)) {
+            for (size_t i = 2; i + 1 < len; i += 2) payload[n++] = hexByte(cmd + i);
+            memcpy(payload + n, data, dataLen);
+            n += dataLen;
+        }
+    }
+
+    if (n <= 1) {
+        stats.noData++;
+        appendLine("NO DATA");
+        return;
+    }
+    appendFrames(payload, n);
+}
+
+uint32_t Elm327Emulator::noisy(uint32_t value, uint8_t len) {
+
+    uint32_t range = (uint32_t)((uint64_t)value * cfg.noisePct / 100);
+    if (range == 0) return value;
+
+    int64_t v = (int64_t)value + (int64_t)(random() % (2 * range + 1)) - range;
+    int64_t max = len >= 4 ? 0xFFFFFFFFLL : (1LL << (8 * len)) - 1;
+    if (v < 0) v = 0;
+    if (v > max) v = max;
+    return (uint32_t)v;
+}
+
+// Formatowanie ramek CAN jak ELM327 (ATS, ATH), wieloramkowo gdy > 7 bajtów
+void Elm327Emulator::appendFrames(const uint8_t* payload, size_t len) {
+
+    char line[64];
+    const char* sep = spaces ? " " : "";
+
+    auto appendBytes = [&](size_t& pos, const uint8_t* bytes, size_t count) {
+        for (size_t i = 0; i < count && pos + 4 < sizeof(line); i++)
+            pos += snprintf(line + pos, sizeof(line) - pos, "%s%02X", (pos > 0 && line[pos - 1] != ':') ? sep : "", bytes[i]);
+    };
+
+    if (len <= SINGLE_FRAME_BYTES) {
+        size_t pos = 0;
+        if (headers) {
+            uint8_t pci = (uint8_t)len;
+            pos += snprintf(line, sizeof(line), "7E8");
+            appendBytes(pos, &pci, 1);
+        }
+        appendBytes(pos, payload, len);
+        line[pos] = '\0';
+        appendLine(line);
+        return;
+    }
+
+    // Pierwsza ramka: liczba bajtów + 6 bajtów, kolejne po 7 z indeksem
+    size_t done = 0;
+    int index = 0;
+    if (!headers) {
+        snprintf(line, sizeof(line), "%03X", (unsigned)len);
+        appendLine(line);
+    }
+
+    while (done < len) {
+
+        size_t chunk = done == 0 ? FIRST_FRAME_BYTES : NEXT_FRAME_BYTES;
+        if (chunk > len - done) chunk = len - done;
+
+        size_t pos = 0;
+        if (headers) {
+            uint8_t pci[2];
+            size_t pciLen;
+            if (done == 0) { pci[0] = (uint8_t)(0x10 | (len >> 8)); pci[1] = (uint8_t)len; pciLen = 2; }
+            else { pci[0] = (uint8_t)(0x20 | (index & 0x0F)); pciLen = 1; }
+            pos += snprintf(line, sizeof(line), "7E8");
+            appendBytes(pos, pci, pciLen);
+        } else {
+            pos += snprintf(line, sizeof(line), "%X:", index & 0x0F);
+        }
+        appendBytes(pos, payload + done, chunk);
+        line[pos] = '\0';
+        appendLine(line);
+
+        done += chunk;
+        index++;
+    }
+}
+
+void Elm327Emulator::deliver(uint32_t delayMs) {
+
+    if (cfg.sleepMs && delayMs) cfg.sleepMs(delayMs);
+    if (!handler) return;
+
+    size_t chunk = cfg.chunkBytes ? cfg.chunkBytes : outLen;
+    for (size_t pos = 0; pos < outLen; pos += chunk) {
+        size_t n = outLen - pos < chunk ? outLen - pos : chunk;
+        handler((const uint8_t*)out + pos, n);
+    }
+}
+
+// =============================================================================
+// NASŁUCH (ATMA)
+// =============================================================================
+
+bool Elm327Emulator::passesFilter(uint16_t id) const {
+
+    if (receiveFilter[0] == '\0') return true;
+    for (int d = 0; d < 3; d++) {
+        char f = receiveFilter[d];
+        if (f != 'X' && hexValue(f) != ((id >> (4 * (2 - d))) & 0xF)) return false;
+    }
+    return true;
+}
+
+// Linia + koniec linii od razu do handlera (ramek z okna nie mieści bufor odpowiedzi)
+void Elm327Emulator::emitLine(const char* text) {
+
+    if (!handler) return;
+    char line[48];
+    int n = snprintf(line, sizeof(line), "%s%s", text, linefeeds ? "\r\n" : "\r");
+    if (n > 0) handler((const uint8_t*)line, (size_t)n < sizeof(line) ? (size_t)n : sizeof(line) - 1);
+}
+
+// Format ATMA jak ELM327: identyfikator (ATH1) i bajty danych (ATS)
+void Elm327Emulator::emitFrame(uint16_t id, const uint8_t* data, size_t len) {
+
+    char line[40];
+    size_t pos = 0;
+    const char* sep = spaces ? " " : "";
+    if (headers) pos += snprintf(line, sizeof(line), "%03X", id & 0x7FF);
+    for (size_t i = 0; i < len && pos + 4 < sizeof(line); i++)
+        pos += snprintf(line + pos, sizeof(line) - pos, "%s%02X", pos > 0 ? sep : "", data[i]);
+    line[pos] = '\0';
+    emitLine(line);
+    stats.monitorFrames++;
+}
+
+// Ramki z całego okna nasłuchu (co 1 ms zegara), potem STOPPED / BUFFER FULL i '>'
+void Elm327Emulator::stopMonitor() {
+
+    static const uint16_t BUS_IDS[] = { 0x0C8, 0x130, 0x1F4, 0x2B0, 0x3E9, 0x4A0, 0x5C1, 0x7DF };
+
+    monitoring = false;
+    uint32_t endMs = cfg.nowMs ? cfg.nowMs() : monitorStartMs;
+    uint32_t frames = 0;
+    uint32_t busCount = 0;
+    bool full = false;
+
+    for (uint32_t t = monitorStartMs + 1; (int32_t)(t - endMs) <= 0 && !full; t++) {
+
+        uint32_t scriptMs = t - startMs;
+        for (uint8_t b = 0; b < cfg.broadcastCount && cfg.broadcasts; b++) {
+
+            const Broadcast& bc = cfg.broadcasts[b];
+            if (bc.periodMs == 0 || scriptMs % bc.periodMs != 0 || !passesFilter(bc.id)) continue;
+
+            uint8_t value[4], valueLen = 0;
+            if (!scriptValue(bc.cmd, scriptMs, value, &valueLen)) continue;
+            uint32_t v = 0;
+            for (uint8_t i = 0; i < valueLen; i++) v = v << 8 | value[i];
+
+            uint8_t frame[8] = { 0 };
+            uint32_t raw = (uint32_t)(v * bc.factor + 0.5f);
+            for (uint8_t i = 0; i < bc.length && bc.start + i < sizeof(frame); i++)
+                frame[bc.start + i] = (uint8_t)(raw >> (8 * (bc.length - 1 - i)));
+            emitFrame(bc.id, frame, sizeof(frame));
+            frames++;
+        }
+
+        // Ruch innych modułów: busFps ramek/s o losowej treści
+        uint32_t due = (uint32_t)((uint64_t)(t - monitorStartMs) * cfg.busFps / 1000);
+        while (busCount < due) {
+            uint16_t id = BUS_IDS[busCount++ % (sizeof(BUS_IDS) / sizeof(BUS_IDS[0]))];
+            if (!passesFilter(id)) continue;
+            uint8_t frame[8];
+            for (uint8_t& byte : frame) byte = (uint8_t)random();
+            emitFrame(id, frame, sizeof(frame));
+            frames++;
+        }
+
+        // Adapter nie nadąża z wysyłaniem - koniec nasłuchu
+        if (cfg.monitorMaxFps && frames > (uint64_t)(t - monitorStartMs) * cfg.monitorMaxFps / 1000 + 8) full = true;
+    }
+
+    emitLine(full ? "BUFFER FULL" : "STOPPED");
+    emitLine("");
+    if (handler) handler((const uint8_t*)">", 1);
+}
@@ -0,0 +1,265 @@
+#include "fare_engine.h"
+
+// Mianowniki akumulatorów (mnożnik w % => x100)
+static constexpr uint64_t KM_DIV = 100;                     // gr x %
+static constexpr uint64_t FUEL_DIV = 1000000ULL * 100;      // µl x gr x %
+static constexpr uint64_t WAIT_DIV = 60000ULL * 100;        // ms x gr/min x %
+
+static inline uint32_t roundDiv(uint64_t value, uint64_t div) {
+    return (uint32_t)((value + div / 2) / div);
+}
+
+// =============================================================================
+// FAREENGINE
+// =============================================================================
+
+FareEngine::FareEngine()
+    : tariff(TariffTable::simple(TariffTable::MODE_KM, 0)), pct(100), band(0), clockKey(0xFFFF),
+      clockMonth(0), clockDay(0) {
+    reset();
+}
+
+void FareEngine::reset() {
+
+    km = 0;
+    mmInKm = 0;
+    litres = 0;
+    ulInLitre = 0;
+    elapsed = 0;
+    waiting = 0;
+    samples = 0;
+
+    band = 0;
+    chargedKm = 0;
+    carriedGr = 0;
+    kmAcc = 0;
+    fuelAcc = 0;
+    waitAcc = 0;
+    chargeStartedKm();      // Pierwszy km jest naliczany od razu (minimum 1 km)
+}
+
+void FareEngine::setTariff(uint8_t newMode, uint32_t rateGr) {
+    setTable(TariffTable::simple(newMode, rateGr));
+}
+
+void FareEngine::setTable(const TariffTable& table) {
+
+    tariff = table;
+    band = 0;
+    loadMultiplier();
+
+    // Przed pierwszą próbką pierwszy km jest naliczany wg nowej taryfy
+    if (samples == 0 && carriedGr == 0) {
+        chargedKm = 0;
+        kmAcc = 0;
+        chargeStartedKm();
+    } else {
+        // Próg dla bieżącego km w nowej tablicy
+        kmRate(chargedKm > 0 ? chargedKm - 1 : 0);
+    }
+}
+
+void FareEngine::setClock(uint8_t weekday, uint8_t hour, uint8_t month, uint8_t day) {
+
+    uint16_t key = (uint16_t)(weekday << 8 | hour);
+    if (key == clockKey) return;
+
+    clockKey = key;
+    clockMonth = month;
+    clockDay = day;
+    loadMultiplier();
+
+    if (samples == 0 && carriedGr == 0) {
+        chargedKm = 0;
+        kmAcc = 0;
+        band = 0;
+        chargeStartedKm();
+    }
+}
+
+void FareEngine::loadMultiplier() {
+
+    if (clockKey == 0xFFFF) { pct = 100; return; }
+    pct = tariff.multiplierPct(clockKey >> 8, clockKey & 0xFF, clockMonth, clockDay);
+}
+
+// Stawka dla km o danym indeksie - indeks rośnie, więc próg przesuwa się tylko do przodu
+uint32_t FareEngine::kmRate(uint32_t kmIndex) {
+
+    while (band + 1 < tariff.bandCount && tariff.bands[band + 1].fromKm <= kmIndex) band++;
+    return tariff.bandCount ? tariff.bands[band].rateGr : 0;
+}
+
+void FareEngine::chargeStartedKm() {
+
+    if (tariff.mode != TariffTable::MODE_KM) {
+        chargedKm = km + 1;
+        return;
+    }
+    while (chargedKm < km + 1) {
+        kmAcc += (uint64_t)kmRate(chargedKm) * pct;
+        chargedKm++;
+    }
+}
+
+void FareEngine::restore(uint32_t distanceM, uint32_t fuelMl, uint32_t elapsedMs,
+                         uint32_t waitingMs, uint32_t dueGr, uint32_t waitingGr) {
+
+    reset();
+    km = distanceM / 1000;
+    mmInKm = (distanceM % 1000) * 1000;
+    litres = fuelMl / 1000;
+    ulInLitre = (fuelMl % 1000) * 1000;
+    elapsed = elapsedMs;
+    waiting = waitingMs;
+
+    if (dueGr > 0) {
+        // Kwota z checkpointu - kolejne km / próbki doliczane od tego miejsca;
+        // postój osobno, żeby Snapshot::waitingGr pokazywał go także po restarcie
+        uint32_t restGr = dueGr > tariff.flagFallGr ? dueGr - tariff.flagFallGr : 0;
+        if (waitingGr > restGr) waitingGr = restGr;
+        carriedGr = restGr - waitingGr;
+        waitAcc = (uint64_t)waitingGr * WAIT_DIV;
+        kmAcc = 0;
+        chargedKm = km + 1;
+        kmRate(km);
+        return;
+    }
+
+    // Brak kwoty (stary checkpoint) - przeliczenie wg bieżącej taryfy i mnożnika
+    chargeStartedKm();
+    if (tariff.mode == TariffTable::MODE_LITRE)
+        fuelAcc = (uint64_t)fuelMl * 1000 * tariff.litreRateGr * pct;
+    waitAcc = (uint64_t)waitingMs * tariff.waitRateGrPerMin * pct;
+}
+
+void FareEngine::addSample(uint32_t distanceMm, uint32_t fuelUl, uint32_t elapsedMs, int16_t speedKmh) {
+
+    // Dzielenie tylko przy przekroczeniu pełnego km / litra
+    mmInKm += distanceMm;
+    if (mmInKm >= MM_PER_KM) {
+        km += mmInKm / MM_PER_KM;
+        mmInKm %= MM_PER_KM;
+        chargeStartedKm();
+    }
+
+    ulInLitre += fuelUl;
+    if (ulInLitre >= UL_PER_LITRE) {
+        litres += ulInLitre / UL_PER_LITRE;
+        ulInLitre %= UL_PER_LITRE;
+    }
+
+    if (tariff.mode == TariffTable::MODE_LITRE)
+        fuelAcc += (uint64_t)fuelUl * tariff.litreRateGr * pct;
+
+    // Postój: prędkość < próg (bez prędkości chwilowej: mm/ms x 3.6 = km/h)
+    bool stopped = speedKmh >= 0
+        ? speedKmh < tariff.waitBelowKmh
+        : (uint64_t)distanceMm * 36 < (uint64_t)tariff.waitBelowKmh * elapsedMs * 10;
+    if (tariff.waitRateGrPerMin && elapsedMs > 0 && stopped) {
+        waiting += elapsedMs;
+        waitAcc += (uint64_t)elapsedMs * tariff.waitRateGrPerMin * pct;
+    }
+
+    elapsed += elapsedMs;
+    samples++;
+}
+
+FareEngine::Snapshot FareEngine::snapshot() const {
+
+    Snapshot s;
+    s.distanceM = km * 1000 + mmInKm / 1000;
+    s.fuelMl = litres * 1000 + ulInLitre / 1000;
+    s.elapsedMs = elapsed;
+    s.waitingMs = waiting;
+    s.startedKm = km + 1;               // Każdy rozpoczęty km, minimum 1
+    s.multiplierPct = pct;
+    s.mode = tariff.mode;
+    s.samples = samples;
+
+    uint32_t travelGr;
+    if (tariff.mode == TariffTable::MODE_KM) {
+        travelGr = roundDiv(kmAcc, KM_DIV);
+        s.rateGr = tariff.bandCount ? tariff.bands[band].rateGr : 0;
+    } else {
+        travelGr = roundDiv(fuelAcc, FUEL_DIV);
+        s.rateGr = tariff.litreRateGr;
+    }
+
+    s.flagFallGr = tariff.flagFallGr;
+    s.waitingGr = roundDiv(waitAcc, WAIT_DIV);
+    s.dueGr = s.flagFallGr + carriedGr + travelGr + s.waitingGr;
+    return s;
+}
+
+// =============================================================================
+// WSPÓŁDZIELONA INSTANCJA (FIRMWARE)
+// =============================================================================
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <time.h>
+
+namespace Fare {
+
+    static FareEngine engine;
+    static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+    void reset() {
+        portENTER_CRITICAL(&mux);
+        engine.reset();
+        portEXIT_CRITICAL(&mux);
+    }
+
+    void setTariff(uint8_t mode, uint32_t rateGr) {
+        TariffTable table = TariffTable::simple(mode, rateGr);
+        setTable(table);
+    }
+
+    void setTable(const TariffTable& table) {
+        portENTER_CRITICAL(&mux);
+        engine.setTable(table);
+        portEXIT_CRITICAL(&mux);
+    }
+
+    void updateClock() {
+
+        // Czas systemowy ustawiany z GPS - przed synchronizacją mnożnik 100%;
+        // czas lokalny wg TARIFF::TIME_ZONE (setenv + tzset w setup())
+        time_t now = time(nullptr);
+        struct tm t;
+        localtime_r(&now, &t);
+        bool valid = t.tm_year + 1900 >= 2020;
+
+        portENTER_CRITICAL(&mux);
+        if (valid)
+            engine.setClock((uint8_t)((t.tm_wday + 6) % 7), (uint8_t)t.tm_hour,
+                            (uint8_t)(t.tm_mon + 1), (uint8_t)t.tm_mday);
+        else
+            engine.setClock(0xFF, 0, 0, 0);
+        portEXIT_CRITICAL(&mux);
+    }
+
+    void restore(uint32_t distanceM, uint32_t fuelMl, uint32_t elapsedMs,
+                 uint32_t waitingMs, uint32_t dueGr, uint32_t waitingGr) {
+        portENTER_CRITICAL(&mux);
+        engine.restore(distanceM, fuelMl, elapsedMs, waitingMs, dueGr, waitingGr);
+        portEXIT_CRITICAL(&mux);
+    }
+
+    void addSample(uint32_t distanceMm, uint32_t fuelUl, uint32_t elapsedMs, int16_t speedKmh) {
+        portENTER_CRITICAL(&mux);
+        engine.addSample(distanceMm, fuelUl, elapsedMs, speedKmh);
+        portEXIT_CRITICAL(&mux);
+    }
+
+    FareEngine::Snapshot snapshot() {
+        portENTER_CRITICAL(&mux);
+        FareEngine::Snapshot s = engine.snapshot();
+        portEXIT_CRITICAL(&mux);
+        return s;
+    }
+
+}  // namespace Fare
+
+#endif  // ARDUINO
@@ -0,0 +1,57 @@
+#include "fuel_accumulator.h"
+
+// Moduł celowo nie używa Arduino.h - kompiluje się również na hoście
+
+FuelAccumulator::FuelAccumulator(uint32_t gapMs, uint32_t maxGapMs)
+    : gapMs(gapMs), maxGapMs(maxGapMs < gapMs ? gapMs : maxGapMs) {
+    reset();
+}
+
+void FuelAccumulator::reset() {
+
+    acc = 0;
+    haveSample = false;
+    lastMs = 0;
+    lastMlph = 0;
+    st = Stats();
+}
+
+// (q1 + q2) / 2 [mL/h] x dt [ms] = mL x ms / h  =>  µl = suma / 7200
+uint64_t FuelAccumulator::totalUl() const {
+    return acc / 7200;
+}
+
+bool FuelAccumulator::addSample(uint32_t tMs, float lph) {
+
+    if (lph < 0) {
+        st.failed++;
+        return true;
+    }
+
+    uint32_t mlph = (uint32_t)(lph * 1000.0f + 0.5f);
+    bool integrated = true;
+
+    if (haveSample) {
+
+        int32_t dt = (int32_t)(tMs - lastMs);
+        if (dt <= 0) return true;               // Próbka nie nowsza od poprzedniej
+
+        if ((uint32_t)dt > maxGapMs) {
+            st.dropped++;
+            st.droppedMs += dt;
+            integrated = false;
+        } else {
+            if ((uint32_t)dt > gapMs) {
+                st.bridged++;
+                st.bridgedMs += dt;
+            }
+            acc += (uint64_t)(lastMlph + mlph) * (uint32_t)dt;
+        }
+    }
+
+    haveSample = true;
+    lastMs = tMs;
+    lastMlph = mlph;
+    st.samples++;
+    return integrated;
+}
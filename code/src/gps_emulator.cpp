@@ -0,0 +1,325 @@
+#include "gps_emulator.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Moduł celowo nie używa Arduino.h - kompiluje się również na hoście
+
+static constexpr uint32_t GPS_EPOCH_UNIX = 315964800;
+static constexpr uint32_t LEAP_SECONDS = 18;
+static constexpr double M_PER_DEG = 111320.0;
+static constexpr size_t NMEA_TYPES = 6;
+
+static uint16_t get16(const uint8_t* p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return get16(p) | (uint32_t)get16(p + 2) << 16;
+}
+
+// Współrzędna NMEA: stopnie i minuty z 5 miejscami (ddmm.mmmmm / dddmm.mmmmm)
+static int coordinate(char* out, size_t len, int32_t e7, int degDigits, char pos, char neg) {
+
+    uint32_t a = (uint32_t)(e7 < 0 ? -(int64_t)e7 : e7);
+    uint32_t minutesE5 = (uint32_t)((uint64_t)(a % 10000000) * 60 / 100);
+    return snprintf(out, len, "%0*lu%02lu.%05lu,%c", degDigits, (unsigned long)(a / 10000000),
+                    (unsigned long)(minutesE5 / 100000), (unsigned long)(minutesE5 % 100000), e7 < 0 ? neg : pos);
+}
+
+// =============================================================================
+// KONFIGURACJA I ZASILANIE
+// =============================================================================
+
+GpsEmulator::Config GpsEmulator::defaultConfig() {
+
+    Config c = {};
+    c.ubx = true;
+    c.baud = GpsSetup::FACTORY_BAUD;
+    c.minRateMs = 200;
+    c.coldTtffMs = 27000;
+    c.posTtffMs = 26000;
+    c.aidedTtffMs = 24000;
+    c.hotTtffMs = 1000;
+    c.jitterPct = 10;
+    c.latE7 = 522297000;            // Warszawa
+    c.lngE7 = 210122000;
+    c.speedMmS = 13900;             // 50 km/h
+    c.utc = 1737331200;             // 2025-01-20 00:00:00 UTC
+    c.seed = 1;
+    return c;
+}
+
+GpsEmulator::GpsEmulator(const Config& config) : cfg(config), st(), rng(config.seed ? config.seed : 1) {
+    powerOn(0);
+}
+
+void GpsEmulator::factoryReset() {
+
+    uartBaud = cfg.baud;
+    measRateMs = 1000;
+    for (size_t i = 0; i < NMEA_TYPES; i++) nmeaRates[i] = 1;
+    scanner.reset();
+    txHead = txCount = 0;
+    txCreditMilli = 0;
+}
+
+void GpsEmulator::powerOn(uint32_t tMs) {
+
+    factoryReset();
+    powerMs = tMs;
+    fixMs = tMs + ttff(cfg.coldTtffMs);
+    nextEpochMs = tMs + measRateMs;
+    txAtMs = tMs;
+}
+
+void GpsEmulator::backupStart(uint32_t tMs) {
+
+    scanner.reset();
+    txHead = txCount = 0;
+    txCreditMilli = 0;
+    powerMs = tMs;
+    fixMs = tMs + ttff(cfg.hotTtffMs);
+    nextEpochMs = tMs + measRateMs;
+    txAtMs = tMs;
+}
+
+uint32_t GpsEmulator::random() {
+
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+uint32_t GpsEmulator::ttff(uint32_t baseMs) {
+
+    uint32_t spread = baseMs / 100 * cfg.jitterPct;
+    if (spread == 0) return baseMs;
+    return baseMs - spread + random() % (2 * spread + 1);
+}
+
+void GpsEmulator::truth(uint32_t tMs, int32_t& latE7, int32_t& lngE7) const {
+
+    double east = (double)cfg.speedMmS * tMs / 1e6;
+    double perDeg = M_PER_DEG * cos(cfg.latE7 / 1e7 * M_PI / 180.0);
+    latE7 = cfg.latE7;
+    lngE7 = cfg.lngE7 + (int32_t)llround(east / perDeg * 1e7);
+}
+
+// =============================================================================
+// KOMENDY UBX
+// =============================================================================
+
+void GpsEmulator::receive(uint32_t tMs, const uint8_t* data, size_t len, uint32_t hostBaud) {
+
+    produce(tMs);
+    if (!cfg.ubx) return;
+
+    if (hostBaud != uartBaud) {
+        st.garbledIn += (uint32_t)len;
+        scanner.reset();
+        return;
+    }
+    for (size_t i = 0; i < len; i++)
+        if (scanner.feed(data[i])) handle(tMs);
+}
+
+void GpsEmulator::reply(uint8_t id, uint8_t cls, uint8_t msgId) {
+
+    uint8_t p[2] = { cls, msgId };
+    uint8_t f[10];
+    enqueue(f, GpsSetup::frame(GpsSetup::CLS_ACK, id, p, sizeof(p), f, sizeof(f)));
+    (id == GpsSetup::ID_ACK_ACK ? st.acks : st.naks)++;
+}
+
+void GpsEmulator::handle(uint32_t tMs) {
+
+    using namespace GpsSetup;
+    st.commands++;
+    uint8_t cls = scanner.cls(), id = scanner.id();
+    const uint8_t* p = scanner.payload();
+    uint16_t len = scanner.length();
+
+    if (cls == CLS_AID && id == ID_AID_INI && len == 48) {
+        aid(tMs);
+        return;
+    }
+    if (cls != CLS_CFG) return;
+
+    bool ok = false;
+    if (id == ID_CFG_PRT && len == 20 && p[0] == 1) {
+        // Potwierdzenie wysłane przy starej prędkości ginie przy przełączeniu
+        uint32_t baud = get32(p + 8);
+        if (baud >= 4800 && baud <= 921600) {
+            txHead = txCount = 0;
+            txCreditMilli = 0;
+            uartBaud = baud;
+            st.acks++;
+            return;
+        }
+    } else if (id == ID_CFG_MSG && len == 3 && p[0] == CLS_NMEA && p[1] < NMEA_TYPES) {
+        nmeaRates[p[1]] = p[2];
+        ok = true;
+    } else if (id == ID_CFG_RATE && len == 6) {
+        uint16_t rate = get16(p);
+        if (rate >= cfg.minRateMs && rate <= 10000) {
+            measRateMs = rate;
+            nextEpochMs = tMs + rate;
+            ok = true;
+        }
+    }
+    reply(ok ? ID_ACK_ACK : ID_ACK_NAK, cls, id);
+}
+
+// AID-INI: zgodna pozycja (i czas) skraca poszukiwanie satelitów
+void GpsEmulator::aid(uint32_t tMs) {
+
+    using namespace GpsSetup;
+    const uint8_t* p = scanner.payload();
+    uint32_t flags = get32(p + 44);
+    if (tMs >= fixMs || !(flags & AID_POS_VALID) || !(flags & AID_LLA)) return;
+
+    int32_t lat, lng;
+    truth(tMs, lat, lng);
+    double dn = ((int32_t)get32(p) - lat) / 1e7 * M_PER_DEG;
+    double de = ((int32_t)get32(p + 4) - lng) / 1e7 * M_PER_DEG * cos(lat / 1e7 * M_PI / 180.0);
+    bool position = sqrt(dn * dn + de * de) * 100.0 <= get32(p + 12);
+
+    bool time = false;
+    if (flags & AID_TIME_VALID) {
+        double gps = get16(p + 18) * 604800.0 + get32(p + 20) / 1000.0;
+        double utc = gps + GPS_EPOCH_UNIX - LEAP_SECONDS;
+        double actual = cfg.utc + tMs / 1000.0;
+        time = fabs(utc - actual) * 1000.0 <= get32(p + 28) + 1000.0;
+    }
+    if (!position) return;
+
+    uint32_t at = powerMs + ttff(time ? cfg.aidedTtffMs : cfg.posTtffMs);
+    if (at < tMs) at = tMs;
+    if (at < fixMs) fixMs = at;
+}
+
+// =============================================================================
+// NADAWANIE
+// =============================================================================
+
+void GpsEmulator::enqueue(const uint8_t* data, size_t len) {
+
+    if (TX_BUFFER - txCount < len) {
+        st.droppedBytes += (uint32_t)len;
+        return;
+    }
+    for (size_t i = 0; i < len; i++) tx[(txHead + txCount + i) % TX_BUFFER] = data[i];
+    txCount += len;
+}
+
+void GpsEmulator::sentence(const char* body) {
+
+    uint8_t sum = 0;
+    for (const char* c = body; *c; c++) sum ^= (uint8_t)*c;
+    char out[100];
+    int n = snprintf(out, sizeof(out), "$%s*%02X\r\n", body, sum);
+    if (n <= 0 || (size_t)n >= sizeof(out)) return;
+    enqueue((const uint8_t*)out, (size_t)n);
+    st.sentences++;
+}
+
+void GpsEmulator::epoch(uint32_t tMs) {
+
+    using namespace GpsSetup;
+    st.epochs++;
+    bool fix = tMs >= fixMs;
+
+    // Czas i data UTC
+    uint64_t utcMs = (uint64_t)cfg.utc * 1000 + tMs;
+    uint32_t dayMs = (uint32_t)(utcMs % 86400000);
+    int32_t z = (int32_t)(utcMs / 86400000) + 719468;
+    int32_t era = z / 146097;
+    uint32_t doe = (uint32_t)(z - era * 146097);
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    uint32_t day = doy - (153 * mp + 2) / 5 + 1;
+    uint32_t month = mp < 10 ? mp + 3 : mp - 9;
+    uint32_t year = (uint32_t)(yoe + era * 400) + (month <= 2);
+
+    char hms[16], date[24];
+    snprintf(hms, sizeof(hms), "%02lu%02lu%02lu.%02lu", (unsigned long)(dayMs / 3600000),
+             (unsigned long)(dayMs / 60000 % 60), (unsigned long)(dayMs / 1000 % 60), (unsigned long)(dayMs % 1000 / 10));
+    snprintf(date, sizeof(date), "%02lu%02lu%02lu", (unsigned long)day, (unsigned long)month, (unsigned long)(year % 100));
+
+    int32_t lat, lng;
+    truth(tMs, lat, lng);
+    char pos[48] = ",,,";
+    if (fix) {
+        int n = coordinate(pos, sizeof(pos), lat, 2, 'N', 'S');
+        pos[n++] = ',';
+        coordinate(pos + n, sizeof(pos) - n, lng, 3, 'E', 'W');
+    }
+    double knots = cfg.speedMmS / 514.444;
+    double kmh = cfg.speedMmS * 0.0036;
+
+    char body[96];
+    if (nmeaRates[NMEA_RMC]) {
+        if (fix) snprintf(body, sizeof(body), "GPRMC,%s,A,%s,%.3f,90.00,%s,,,A", hms, pos, knots, date);
+        else snprintf(body, sizeof(body), "GPRMC,%s,V,,,,,,,%s,,,N", hms, date);
+        sentence(body);
+    }
+    if (nmeaRates[NMEA_VTG]) {
+        if (fix) snprintf(body, sizeof(body), "GPVTG,90.00,T,,M,%.3f,N,%.3f,K,A", knots, kmh);
+        else snprintf(body, sizeof(body), "GPVTG,,,,,,,,,N");
+        sentence(body);
+    }
+    if (nmeaRates[NMEA_GGA]) {
+        if (fix) snprintf(body, sizeof(body), "GPGGA,%s,%s,1,09,0.90,112.0,M,34.5,M,,", hms, pos);
+        else snprintf(body, sizeof(body), "GPGGA,%s,,,,,0,00,99.99,,,,,,", hms);
+        sentence(body);
+    }
+    if (nmeaRates[NMEA_GSA]) {
+        if (fix) sentence("GPGSA,A,3,02,05,07,09,13,15,20,26,30,,,,1.60,0.90,1.32");
+        else sentence("GPGSA,A,1,,,,,,,,,,,,,99.99,99.99,99.99");
+    }
+    if (nmeaRates[NMEA_GSV]) {
+        sentence("GPGSV,3,1,12,02,45,130,38,05,62,270,41,07,20,045,33,09,15,310,30");
+        sentence("GPGSV,3,2,12,13,55,190,40,15,30,080,35,20,10,220,28,26,40,350,37");
+        sentence("GPGSV,3,3,12,29,05,160,,30,70,010,42,31,08,300,,32,12,120,");
+    }
+    if (nmeaRates[NMEA_GLL]) {
+        if (fix) snprintf(body, sizeof(body), "GPGLL,%s,%s,A,A", pos, hms);
+        else snprintf(body, sizeof(body), "GPGLL,,,,,%s,V,N", hms);
+        sentence(body);
+    }
+}
+
+void GpsEmulator::produce(uint32_t tMs) {
+
+    while ((int32_t)(tMs - nextEpochMs) >= 0) {
+        epoch(nextEpochMs);
+        nextEpochMs += measRateMs;
+    }
+}
+
+size_t GpsEmulator::transmit(uint32_t tMs, uint32_t hostBaud, uint8_t* out, size_t maxLen) {
+
+    produce(tMs);
+
+    // Przepustowość UART: baud / 10 B/s = baud / 10 tysięcznych bajtu na ms
+    txCreditMilli += (tMs - txAtMs) * (uartBaud / 10);
+    txAtMs = tMs;
+    size_t n = txCreditMilli / 1000;
+    if (n > txCount) n = txCount;
+    if (n > maxLen) n = maxLen;
+    txCreditMilli = txCount > n ? txCreditMilli - (uint32_t)n * 1000 : 0;
+
+    for (size_t i = 0; i < n; i++) {
+        uint8_t b = tx[txHead];
+        txHead = (txHead + 1) % TX_BUFFER;
+        // Odbiór przy złej prędkości: błędy ramkowania, losowe bajty
+        out[i] = hostBaud == uartBaud ? b : (uint8_t)(random() | 0x80);
+    }
+    txCount -= n;
+    if (hostBaud != uartBaud) st.garbledOut += (uint32_t)n;
+    return n;
+}
@@ -0,0 +1,180 @@
+#include "gps_odometer.h"
+
+// Moduł celowo nie używa Arduino.h - kompiluje się również na hoście
+
+// Długość 1e-7 stopnia łuku (R = 6371008.8 m) [mm x 2^16]
+static constexpr int64_t MM_PER_E7_Q16 = 728728;
+
+// cos(0..90 stopni) x 2^15
+static const uint16_t COS_Q15[91] = {
+    32768, 32763, 32748, 32723, 32688, 32643, 32588, 32524, 32449, 32365,
+    32270, 32166, 32052, 31928, 31795, 31651, 31499, 31336, 31164, 30983,
+    30792, 30592, 30382, 30163, 29935, 29698, 29452, 29197, 28932, 28660,
+    28378, 28088, 27789, 27482, 27166, 26842, 26510, 26170, 25822, 25466,
+    25102, 24730, 24351, 23965, 23571, 23170, 22763, 22348, 21926, 21498,
+    21063, 20622, 20174, 19720, 19261, 18795, 18324, 17847, 17364, 16877,
+    16384, 15886, 15384, 14876, 14365, 13848, 13328, 12803, 12275, 11743,
+    11207, 10668, 10126, 9580, 9032, 8481, 7927, 7371, 6813, 6252,
+    5690, 5126, 4560, 3993, 3425, 2856, 2286, 1715, 1144, 572,
+    0
+};
+
+static uint32_t isqrt64(uint64_t v) {
+
+    uint64_t res = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+    while (bit > v) bit >>= 2;
+    while (bit) {
+        if (v >= res + bit) {
+            v -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)res;
+}
+
+static inline int64_t abs64(int64_t v) {
+    return v < 0 ? -v : v;
+}
+
+// =============================================================================
+// API
+// =============================================================================
+
+GpsOdometer::GpsOdometer() : cfg() {
+    reset();
+}
+
+GpsOdometer::GpsOdometer(const Config& config) : cfg(config) {
+    reset();
+}
+
+void GpsOdometer::reset() {
+
+    st = Stats();
+    total = 0;
+    anchored = false;
+    anchorLat = anchorLng = 0;
+    lastLat = lastLng = 0;
+    lastMs = 0;
+    prevMs = 0;
+    estSpeedMmS = 0;
+    rejectLat = rejectLng = 0;
+    rejectMs = 0;
+    rejectRun = 0;
+}
+
+uint32_t GpsOdometer::segmentMm(int32_t lat1E7, int32_t lng1E7, int32_t lat2E7, int32_t lng2E7) {
+
+    int64_t dLat = (int64_t)lat2E7 - lat1E7;
+    int64_t dLng = (int64_t)lng2E7 - lng1E7;
+    if (dLng > 1800000000) dLng -= 3600000000LL;            // Przez południk 180
+    else if (dLng < -1800000000) dLng += 3600000000LL;
+
+    // cos szerokości środka odcinka, interpolacja liniowa między pełnymi stopniami
+    uint64_t mid = (uint64_t)abs64(((int64_t)lat1E7 + lat2E7) / 2);
+    if (mid > 900000000) mid = 900000000;
+    uint32_t deg = (uint32_t)(mid / 10000000);
+    int64_t cosQ15 = COS_Q15[deg];
+    if (deg < 90)
+        cosQ15 += ((int64_t)COS_Q15[deg + 1] - COS_Q15[deg]) * (int64_t)(mid % 10000000) / 10000000;
+
+    int64_t dy = dLat * MM_PER_E7_Q16 / 65536;
+    int64_t dx = dLng * MM_PER_E7_Q16 / 65536 * cosQ15 / 32768;
+    if (abs64(dx) > 1000000000 || abs64(dy) > 1000000000) return UINT32_MAX;
+
+    return isqrt64((uint64_t)(dx * dx) + (uint64_t)(dy * dy));
+}
+
+uint32_t GpsOdometer::addFix(uint32_t tMs, bool valid, int32_t latE7, int32_t lngE7,
+                             int32_t speedMmS, uint16_t hdop, uint8_t sats) {
+
+    st.fixes++;
+
+    if (!valid || hdop > cfg.maxHdop || sats < cfg.minSats) {
+        st.gated++;
+        return 0;
+    }
+
+    if (!anchored) {
+        anchored = true;
+        moveAnchor(tMs, latE7, lngE7);
+        estSpeedMmS = 0;
+        st.accepted++;
+        return 0;
+    }
+
+    uint32_t dtFix = tMs - lastMs;
+    if (dtFix == 0 || tMs == prevMs) return 0;  // Ta sama epoka (RMC i GGA)
+
+    // Przerwa w odbiorze (tunel), a nie seria odrzuconych skoków
+    uint32_t gapMs = tMs - prevMs;
+    prevMs = tMs;
+
+    // Promień szumu rośnie z HDOP
+    uint32_t radius = hdop <= 100 ? cfg.driftMinMm : (uint32_t)((uint64_t)cfg.driftMinMm * hdop / 100);
+
+    // Skok: odcinek od poprzedniego fixu, który przeszedł test, nie może przekroczyć
+    // drogi przy prędkości maksymalnej, a bez przerwy w odbiorze - przy prędkości
+    // Dopplera (bez niej: z poprzedniego odcinka) + margines
+    uint32_t step = segmentMm(lastLat, lastLng, latE7, lngE7);
+    uint64_t allowed = (uint64_t)cfg.maxSpeedMmS * dtFix / 1000 + radius;
+    if (gapMs <= cfg.dopplerWindowMs && (speedMmS >= 0 || estSpeedMmS != UINT32_MAX)) {
+        uint64_t v = speedMmS >= 0 ? (uint64_t)speedMmS : estSpeedMmS;
+        uint64_t tight = (v + cfg.jumpMarginMmS) * dtFix / 1000 + radius;
+        if (tight < allowed) allowed = tight;
+    }
+    if (step == UINT32_MAX || step > allowed) {
+        st.outliers++;
+
+        // Prędkość wynikająca z kolejnych odrzuconych pozycji - po przeniesieniu
+        // kotwicy ogranicza następny odcinek (powrót po krótkim odbiciu sygnału)
+        uint32_t rejectSpeed = UINT32_MAX;
+        if (rejectRun > 0 && tMs != rejectMs) {
+            uint32_t rd = segmentMm(rejectLat, rejectLng, latE7, lngE7);
+            if (rd != UINT32_MAX) rejectSpeed = (uint32_t)((uint64_t)rd * 1000 / (tMs - rejectMs));
+        }
+        rejectLat = latE7;
+        rejectLng = lngE7;
+        rejectMs = tMs;
+
+        if (++rejectRun >= cfg.maxOutliers) {
+            // Kolejne pozycje zgodne ze sobą, a nie z poprzednimi - błędna była kotwica
+            moveAnchor(tMs, latE7, lngE7);
+            estSpeedMmS = rejectSpeed;
+            st.reanchors++;
+        }
+        return 0;
+    }
+    rejectRun = 0;
+    lastLat = latE7;
+    lastLng = lngE7;
+    lastMs = tMs;
+    estSpeedMmS = (uint32_t)((uint64_t)step * 1000 / dtFix);
+
+    // Postój (lub prędkość nieznana): pozycja w promieniu szumu od kotwicy nie
+    // przesuwa jej, odcinek zostanie doliczony dopiero po wyjściu z promienia
+    uint32_t d = segmentMm(anchorLat, anchorLng, latE7, lngE7);
+    bool moving = speedMmS >= 0 && (uint32_t)speedMmS >= cfg.stationaryMmS;
+    if (!moving && d < radius) {
+        st.stationary++;
+        return 0;
+    }
+
+    anchorLat = latE7;
+    anchorLng = lngE7;
+    total += d;
+    st.accepted++;
+    return d;
+}
+
+void GpsOdometer::moveAnchor(uint32_t tMs, int32_t latE7, int32_t lngE7) {
+
+    anchorLat = lastLat = latE7;
+    anchorLng = lastLng = lngE7;
+    lastMs = prevMs = tMs;
+    rejectRun = 0;
+}
@@ -1,8 +1,13 @@
 #include "gps_reader.h"
 #include "sd_manager.h"
-#include <TinyGPSPlus.h>
-#include <sys/time.h>
-#include <time.h>
+#include "link_capture.h"
+#include "seqlock.h"
+#include "nmea_parser.h"
+#include "gps_setup.h"
+#include "settings_store.h"
+#include "timebase.h"
+#include <esp_timer.h>
+#include <math.h>
 
 #ifndef GPS_DEBUG_RAW
 #define GPS_DEBUG_RAW 0
@@ -10,19 +15,128 @@
 
 namespace GPS {
 
-static TinyGPSPlus gps;                     // Obiekt TinyGPSPlus do parsowania NMEA
+// Progi filtrów dystansu z pozycji (cabulator_settings.h)
+static GpsOdometer::Config odometerConfig() {
+
+    GpsOdometer::Config c;
+    c.maxHdop = ODO_MAX_HDOP;
+    c.minSats = ODO_MIN_SATS;
+    c.stationaryMmS = ODO_STATIONARY_MMS;
+    c.driftMinMm = ODO_DRIFT_MIN_MM;
+    c.maxSpeedMmS = ODO_MAX_SPEED_MMS;
+    c.jumpMarginMmS = ODO_JUMP_MARGIN_MMS;
+    c.dopplerWindowMs = ODO_DOPPLER_WINDOW_MS;
+    c.maxOutliers = ODO_MAX_OUTLIERS;
+    return c;
+}
+
+// Stan parsera - wyłącznie task GPS
+static NmeaParser parser;                    // Parser NMEA (RMC, GGA, GSA) i historia surowych linii
 static HardwareSerial* port = &Serial2;     // Używamy Serial2 dla ESP32
-static uint32_t lastSample = 0;             // Timestamp ostatniej próbki
-Fix lastFix;                                // Ostatni fix GPS  
+static uint32_t lastSample = 0;             // Timestamp ostatniej próbki do zapisu trasy
+static uint32_t lastStatus = 0;             // Timestamp ostatniego statusu na Serial
+static Fix current = {};                    // Fix budowany przez task
+static uint32_t positionAtMs = 0;           // Czas ostatniej pozycji z fixem
+static bool havePosition = false;
+static GpsOdometer odometer(odometerConfig());
+static uint32_t odometerEpoch = UINT32_MAX; // Czas UTC epoki ostatnio przekazanej do odometru
+static uint32_t rateEpochs = 0;             // Epoki pozycji w bieżącym oknie RATE_WINDOW_MS
+static uint32_t rateFrom = 0;               // Początek okna
+
+// Chwila epoki dla podstawy czasu (timebase.h)
+static int64_t burstUs = 0;                 // Szacowany pierwszy bajt bieżącej paczki zdań [us]
+static int64_t lastReadUs = INT64_MIN / 2;  // Ostatni odczyt z UART [us]
+static uint32_t timeEpoch = UINT32_MAX;     // Czas UTC epoki ostatnio przekazanej do Timebase
+
+// Ostatnia pozycja jako dane pomocnicze przy następnym starcie
+static GpsSetup::Aiding aiding = {};        // Ostatnio zapisana (version 0 = brak)
+static uint32_t aidingSavedAt = 0;
+static volatile bool aidingRequested = false;
+
+// Publikacja dla pozostałych tasków
+static Seqlock<Fix> published;
+static TaskHandle_t gpsTask = nullptr;
+static TaskHandle_t listeners[MAX_LISTENERS] = {nullptr};
+static Stats stats = {};
+static portMUX_TYPE statsMux = portMUX_INITIALIZER_UNLOCKED;
+
+static inline uint32_t msSince(uint32_t t0) {
+    return millis() - t0;
+}
+
+// =============================================================================
+// ZDARZENIA UART (task zdarzeń sterownika UART)
+// =============================================================================
+
+// Dane w FIFO (próg GPS::RX_FIFO_FULL) lub przerwa po paczce zdań
+static void onUartReceive() {
+
+    if (gpsTask) xTaskNotifyGive(gpsTask);
+}
+
+static void onUartError(hardwareSerial_error_t err) {
+
+    if (err != UART_BUFFER_FULL_ERROR && err != UART_FIFO_OVF_ERROR) return;
+    portENTER_CRITICAL(&statsMux);
+    stats.overruns++;
+    portEXIT_CRITICAL(&statsMux);
+}
+
+// =============================================================================
+// KONFIGURACJA MODUŁU (przed startem taska - UART czytany bezpośrednio)
+// =============================================================================
+
+static void setupBaud(uint32_t baud) {
+    port->flush();
+    port->updateBaudRate(baud);
+}
+
+// Powrót po nadaniu całej ramki - zmiana prędkości nie utnie jej końca
+static void setupWrite(const uint8_t* data, size_t len) {
+    port->write(data, len);
+    port->flush();
+}
+
+static size_t setupRead(uint8_t* buf, size_t len, uint32_t timeoutMs) {
+
+    uint32_t t0 = millis();
+    while (port->available() <= 0 && millis() - t0 < timeoutMs) vTaskDelay(1);
+    int avail = port->available();
+    if (avail <= 0) return 0;
+    return port->read(buf, (size_t)avail < len ? (size_t)avail : len);
+}
+
+static uint32_t setupNow() {
+    return millis();
+}
+
+static GpsSetup::Result configureModule() {
+
+    static const GpsSetup::Port setupPort = { setupBaud, setupWrite, setupRead, setupNow };
 
-// Bufor na ostatnią linię NMEA
-static char rawLogLines[5][128] = {{0}};    // 5 ostatnich linii NMEA
-static uint8_t rawLinePos = 0;              // Pozycja w buforze
-static char currentRawLine[128] = {0};      // Bieżąca linia NMEA
-static uint8_t currentRawLinePos = 0;       // Pozycja w bieżącej linii
+    if (!Settings::get(Settings::KEY_GPS_AIDING, &aiding, sizeof(aiding)) || aiding.version != GpsSetup::AIDING_VERSION)
+        aiding = {};
 
-static inline uint32_t msSince(uint32_t t0) { 
-    return millis() - t0; 
+    Timebase::Stamp clock = Timebase::nowUtc();
+    GpsSetup::Options o = {};
+    o.baud = CONFIG_BAUD;
+    o.rateMs = FIX_RATE_MS;
+    o.ackTimeoutMs = CONFIG_ACK_MS;
+    o.aiding = aiding.version ? &aiding : nullptr;
+    o.posAccM = AIDING_POS_ACC_M;
+    o.utcNow = (uint32_t)(clock.utcMs / 1000);
+    o.timeAccMs = Timebase::accuracyMs();
+
+    GpsSetup::Result r;
+    if (GpsSetup::configure(setupPort, o, r)) {
+        Serial.printf("[GPS] Module configured in %lu ms: %lu bd, %u ms epochs, %u acked, %u rejected, aiding: %s\n",
+            (unsigned long)r.durationMs, (unsigned long)r.baud, r.rateMs, r.acked, r.nacked,
+            r.aidedTime ? "position + time" : r.aidedPosition ? "position" : "none");
+    } else {
+        Serial.printf("[GPS] Module does not answer UBX (%lu ms) - NMEA at %lu bd, 1 Hz\n",
+            (unsigned long)r.durationMs, (unsigned long)r.baud);
+    }
+    return r;
 }
 
 // Inicjalizacja GPS
@@ -30,169 +144,322 @@ void begin() {
 
     Serial.println("\n[GPS] Initializing GPS Module...");
 
+    // Bufor RX przed begin() - sterownik UART alokuje go przy starcie
+    port->setRxBufferSize(RX_BUFFER_BYTES);
     port->begin(BAUD_RATE, SERIAL_8N1, PIN_RX, PIN_TX);
+    stats.setup = configureModule();
+    port->setRxFIFOFull(RX_FIFO_FULL);
+    port->setRxTimeout(RX_TIMEOUT_SYMBOLS);
+    port->onReceiveError(onUartError);
+    port->onReceive(onUartReceive, false);
     lastSample = millis();
-    lastFix = Fix{};
+    rateFrom = millis();
+    current = Fix{};
 
     Serial.println("[GPS] ========================");
     Serial.printf("[GPS] Port: Serial2\n");
-    Serial.printf("[GPS] Baud: %d\n", BAUD_RATE);
+    Serial.printf("[GPS] Baud: %lu\n", (unsigned long)stats.setup.baud);
     Serial.printf("[GPS] RX Pin: %d\n", PIN_RX);
     Serial.printf("[GPS] TX Pin: %d\n", PIN_TX);
+    Serial.printf("[GPS] RX buffer: %d B, wake every %d B or %d idle symbols\n",
+        RX_BUFFER_BYTES, RX_FIFO_FULL, RX_TIMEOUT_SYMBOLS);
     Serial.println("[GPS] ========================");
 
     Serial.println("[GPS] GPS Module initialized");
 }
 
-// Polling GPS - zwraca true jeśli jest nowy fix
-bool poll(Fix& out) {
-
-    if (!port) return false;
+// =============================================================================
+// TASK GPS - odbiór, parsowanie, publikacja
+// =============================================================================
+
+// Opróżnienie bufora RX - cały fragment trafia naraz do przechwytywania łącza
+static uint32_t drain() {
+
+    uint8_t chunk[64];
+    uint32_t total = 0;
+    int avail;
+    while ((avail = port->available()) > 0) {
+
+        // Pierwszy odczyt po przerwie w nadawaniu = nowa paczka zdań; bajty czekające
+        // w buforze przyszły wcześniej o czas ich nadania (10 bitów na bajt)
+        int64_t nowUs = esp_timer_get_time();
+        if (nowUs - lastReadUs > (int64_t)TIMEBASE::BURST_GAP_MS * 1000)
+            burstUs = nowUs - (int64_t)avail * 10000000 / stats.setup.baud;
+        lastReadUs = nowUs;
+
+        size_t got = port->read(chunk, (size_t)avail < sizeof(chunk) ? (size_t)avail : sizeof(chunk));
+        if (got == 0) break;
+        LinkCapture::record(TripLogFormat::CAPTURE_GPS_RX, chunk, got);
+#if GPS_DEBUG_RAW
+        for (size_t k = 0; k < got; k++) {
+            parser.encode(static_cast<char>(chunk[k]));
+            char line[128];
+            if (chunk[k] == '\n' && parser.rawLine(0, line, sizeof(line)))
+                Serial.printf("[GPS] %s\n", line);
+        }
+#else
+        parser.feed(chunk, got);
+#endif
+        total += got;
+    }
+    return total;
+}
 
-    while (port->available() > 0) {
+// Nowe dane pozycji, czasu lub jakości od ostatniej publikacji
+static bool updateFix() {
+
+    const NmeaParser::Data& d = parser.data();
+    uint16_t upd = d.updated;
+    if (!upd) return false;
+    parser.clearUpdated();
+
+    uint32_t now = millis();
+    current.takenAtMs = now;
+    if (upd & NmeaParser::UPD_SATS) current.sats = d.sats;
+    if (upd & NmeaParser::UPD_HDOP) current.hdop = d.hdop;
+    if (upd & NmeaParser::UPD_FIX_TYPE) current.fixType = d.fixType;
+    if (upd & NmeaParser::UPD_SPEED) current.speedMmS = d.speedMmS;
+    if (upd & NmeaParser::UPD_COURSE) current.courseCdeg = d.courseCdeg;
+
+    if (upd & NmeaParser::UPD_POSITION) {
+        current.latE7 = d.latE7;
+        current.lngE7 = d.lngE7;
+        current.lat = d.latE7 / 1e7;
+        current.lng = d.lngE7 / 1e7;
+        positionAtMs = now;
+        havePosition = true;
+    }
 
-        char c = static_cast<char>(port->read());
-        // Zebranie surowej linii NMEA dla debugu
-        if (c == '\n' || c == '\r') {
+    // Utrata fixu zgłoszona przez moduł (RMC 'V', GGA jakość 0) - od razu, bez czekania na FIX_STALE_MS
+    bool lost = ((upd & NmeaParser::UPD_STATUS) && !d.rmcValid) || ((upd & NmeaParser::UPD_QUALITY) && d.quality == 0);
+    if (lost) havePosition = false;
+    current.valid = havePosition && now - positionAtMs < FIX_STALE_MS;
 
-            if (currentRawLinePos > 0) {
+    if (current.valid && stats.ttffMs == 0) {
+        portENTER_CRITICAL(&statsMux);
+        stats.ttffMs = now;
+        portEXIT_CRITICAL(&statsMux);
+        Serial.printf("[GPS] First fix after %lu.%lu s\n", (unsigned long)(now / 1000), (unsigned long)(now % 1000 / 100));
+    }
 
-                // Zapisz linię do bufora ostatnich 5 linii
-                currentRawLine[currentRawLinePos] = '\0';
-                for (int i = 0; i < 4; ++i) {
-                    strcpy(rawLogLines[i], rawLogLines[i+1]);
-                }
+    // Dystans z pozycji - raz na epokę (RMC i GGA tej samej sekundy niosą tę samą pozycję)
+    if ((upd & NmeaParser::UPD_POSITION) && d.timeMs != odometerEpoch) {
+        odometerEpoch = d.timeMs;
+        odometer.addFix(now, current.valid, current.latE7, current.lngE7,
+                        d.rmcValid ? (int32_t)current.speedMmS : -1, current.hdop, current.sats);
+        current.odometerMm = odometer.distanceMm();
+        current.epochMs = now;
+        if (current.valid) rateEpochs++;
+    }
 
-                strncpy(rawLogLines[4], currentRawLine, sizeof(rawLogLines[4])-1);
-                rawLogLines[4][sizeof(rawLogLines[4])-1] = '\0';
-                currentRawLinePos = 0;
-            }
+    if (d.day != 0 && (upd & (NmeaParser::UPD_TIME | NmeaParser::UPD_DATE))) {
 
-        } else { // Normalny znak
+        current.year = d.year;
+        current.month = d.month;
+        current.day = d.day;
+        current.hour = (uint8_t)(d.timeMs / 3600000);
+        current.minute = (uint8_t)(d.timeMs / 60000 % 60);
+        current.second = (uint8_t)(d.timeMs / 1000 % 60);
+        current.dateTimeValid = true;
+    }
 
-            if (currentRawLinePos < sizeof(currentRawLine) - 2) 
-                currentRawLine[currentRawLinePos++] = c;
+    // Czas epoki z RMC (data i czas z jednego zdania) - raz na epokę, tylko gdy paczka
+    // jest przetwarzana w okresie epoki od jej początku (inaczej chwila paczki nieznana)
+    if ((upd & NmeaParser::UPD_DATE) && d.rmcValid && d.day != 0 && d.timeMs != timeEpoch) {
+        timeEpoch = d.timeMs;
+        if (esp_timer_get_time() - burstUs < (int64_t)stats.setup.rateMs * 1000) {
+            uint64_t utcMs = (uint64_t)GpsSetup::unixTime(d.year, d.month, d.day, d.timeMs) * 1000 + d.timeMs % 1000;
+            Timebase::addGpsEpoch(burstUs, utcMs);
         }
-        gps.encode(c);
     }
 
-    // Sprawdzenie czy minął czas próbkowania
-    if (msSince(lastSample) >= SAMPLE_MS) {
+    return true;
+}
 
-        lastSample = millis();
-        bool locValid = gps.location.isValid() && gps.location.age() < 2000;    // Valid jeśli <2s
-        lastFix.valid = locValid;                                               // Ustaw valid
-        lastFix.takenAtMs = lastSample;                                         // Timestamp próbki     
-        lastFix.sats = gps.satellites.value();                                  // Liczba satelitów 
-        uint32_t hd = gps.hdop.value();                                         // HDOP x100
-        lastFix.hdop = (hd <= 0xFFFF) ? (uint16_t)hd : (uint16_t)65535;         // HDOP x100 z klipowaniem
+// Częstotliwość epok z fixem w oknie RATE_WINDOW_MS
+static void measureRate() {
 
-        // Parsuj pozycję
-        if (locValid) {
+    uint32_t elapsed = msSince(rateFrom);
+    if (elapsed < (uint32_t)RATE_WINDOW_MS) return;
+    portENTER_CRITICAL(&statsMux);
+    stats.fixRateMilliHz = (uint32_t)((uint64_t)rateEpochs * 1000000 / elapsed);
+    portEXIT_CRITICAL(&statsMux);
+    rateEpochs = 0;
+    rateFrom = millis();
+}
 
-            lastFix.lat = gps.location.lat();   // Szerokość
-            lastFix.lng = gps.location.lng();   // Długość
-        }
-        
-        // Parsuj datę i czas z GPS
-        if (gps.date.isValid() && gps.time.isValid()) {
-            
-            lastFix.year = gps.date.year();
-            lastFix.month = gps.date.month();
-            lastFix.day = gps.date.day();
-            lastFix.hour = gps.time.hour();
-            lastFix.minute = gps.time.minute();
-            lastFix.second = gps.time.second();
-            lastFix.dateTimeValid = true;
-            
-        } else 
-            lastFix.dateTimeValid = false;
-        
-        // Przekaż dane wyjściowe
-        out = lastFix;
-        
-        // Parsowanie danych na zapis do SD
-        SDManager::GPSData gpsData;
-        gpsData.latitude = lastFix.lat;
-        gpsData.longitude = lastFix.lng;
-        gpsData.satellites = lastFix.sats;
-        gpsData.hdop = lastFix.hdop;
-        gpsData.valid = lastFix.valid;
-        gpsData.timestamp = lastFix.takenAtMs;
-        SDManager::onGPSFix(gpsData);
-        
-        return true; 
+// Ostatnia pozycja do startu z danymi pomocniczymi: po przesunięciu o AIDING_MIN_MOVE_M,
+// nie częściej niż co AIDING_SAVE_MS (na żądanie bez czekania)
+static void saveAiding() {
+
+    if (!current.valid || !current.dateTimeValid || current.hdop > ODO_MAX_HDOP) return;
+    bool requested = aidingRequested;
+    if (aiding.version && !requested && msSince(aidingSavedAt) < (uint32_t)AIDING_SAVE_MS) return;
+    aidingRequested = false;
+
+    if (aiding.version) {
+        float dn = (current.latE7 - aiding.latE7) * 0.011132f;     // [m]
+        float de = (current.lngE7 - aiding.lngE7) * 0.011132f * cosf(current.latE7 * 1.745329e-9f);
+        if (dn * dn + de * de < (float)AIDING_MIN_MOVE_M * AIDING_MIN_MOVE_M) return;
     }
-    return false; 
+
+    GpsSetup::Aiding next = {};
+    next.version = GpsSetup::AIDING_VERSION;
+    next.latE7 = current.latE7;
+    next.lngE7 = current.lngE7;
+    next.utc = GpsSetup::unixTime(current.year, current.month, current.day,
+        ((current.hour * 60u + current.minute) * 60u + current.second) * 1000u);
+    aidingSavedAt = millis();
+    if (!Settings::put(Settings::KEY_GPS_AIDING, &next, sizeof(next))) return;
+
+    aiding = next;
+    portENTER_CRITICAL(&statsMux);
+    stats.aidingSaves++;
+    portEXIT_CRITICAL(&statsMux);
 }
 
-// Funkcja zwracająca wskaźnik do tablicy 5 ostatnich linii NMEA
-const char* const* getLastRawLines() {
+static void publish() {
+
+    published.write(current);
+
+    portENTER_CRITICAL(&statsMux);
+    stats.fixes++;
+    portEXIT_CRITICAL(&statsMux);
 
-    static const char* ptrs[5];
-    for (int i = 0; i < 5; ++i) ptrs[i] = rawLogLines[i];
-    return ptrs;
+    for (TaskHandle_t t : listeners)
+        if (t) xTaskNotifyGive(t);
 }
 
-// Synchronizacja czasu systemowego z GPS
-bool setSystemTimeFromGPS(const Fix& fix) {
+// Próbka do zapisu trasy co SAMPLE_MS
+static void logSample() {
+
+    SDManager::GPSData gpsData;
+    gpsData.latitude = current.lat;
+    gpsData.longitude = current.lng;
+    gpsData.satellites = current.sats;
+    gpsData.hdop = current.hdop;
+    gpsData.valid = current.valid;
+    gpsData.timestamp = current.takenAtMs;
+    SDManager::onGPSFix(gpsData);
+}
+
+void task(void* param) {
+
+    gpsTask = xTaskGetCurrentTaskHandle();
+    Serial.println("[GPS] GPS task started");
+
+    while (true) {
+
+        bool woken = ulTaskNotifyTake(pdTRUE, IDLE_WAKE_MS / portTICK_PERIOD_MS) > 0;
+        uint32_t bytes = drain();
 
-    if (!fix.dateTimeValid) {
-        return false;
+        portENTER_CRITICAL(&statsMux);
+        if (woken) stats.wakeups++;
+        stats.bytes += bytes;
+        const NmeaParser::Stats& ps = parser.stats();
+        stats.sentences = ps.sentences[NmeaParser::RMC] + ps.sentences[NmeaParser::GGA] + ps.sentences[NmeaParser::GSA];
+        stats.checksumErrors = ps.checksumErrors;
+        stats.odometer = odometer.stats();
+        portEXIT_CRITICAL(&statsMux);
+
+        if (updateFix()) publish();
+        measureRate();
+        saveAiding();
+
+        // Utrata fixu też trafia do zapisu (valid = false po FIX_STALE_MS)
+        if (msSince(lastSample) >= SAMPLE_MS) {
+
+            lastSample = millis();
+            if (current.valid && millis() - positionAtMs >= FIX_STALE_MS) {
+                current.valid = false;
+                publish();
+            }
+            logSample();
+        }
+
+        if (msSince(lastStatus) >= STATUS_LOG_MS) {
+            lastStatus = millis();
+            debugStatus();
+        }
     }
-    
-    // Konwertowanie daty/czasu z GPS na structure timeval
-    struct tm timeinfo = {};
-    timeinfo.tm_year = fix.year - 1900;      // tm_year to lata od 1900
-    timeinfo.tm_mon = fix.month - 1;         // tm_mon to 0-11
-    timeinfo.tm_mday = fix.day;
-    timeinfo.tm_hour = fix.hour;
-    timeinfo.tm_min = fix.minute;
-    timeinfo.tm_sec = fix.second;
-    timeinfo.tm_isdst = -1;                  // Nieznane informacje o DST
-    
-    // Konwersja na timestamp
-    time_t timestamp = mktime(&timeinfo);
-    if (timestamp == -1) {
-
-        Serial.println("[GPS] ERROR: Failed to convert GPS time to timestamp");
-        return false;
+}
+
+// =============================================================================
+// ODCZYT (dowolny task)
+// =============================================================================
+
+Fix latest() {
+
+    Fix fix = published.read();
+    if (millis() - fix.takenAtMs >= FIX_STALE_MS) {
+        fix.valid = false;
+        fix.dateTimeValid = false;
     }
-    
-    // Ustawienie czasu systemowego
-    struct timeval tv = {};
-    tv.tv_sec = timestamp;
-    tv.tv_usec = 0;
-    
-    if (settimeofday(&tv, nullptr) == 0) {
-
-        Serial.printf("[GPS] System time synchronized: %04d-%02d-%02d %02d:%02d:%02d\n",
-            fix.year, fix.month, fix.day, fix.hour, fix.minute, fix.second);
-        return true;
-        
-    } else {
+    return fix;
+}
+
+uint32_t version() {
+    return published.version();
+}
+
+void requestAidingSave() {
+    aidingRequested = true;
+}
+
+bool addListener(TaskHandle_t task) {
 
-        Serial.println("[GPS] ERROR: Failed to set system time");
-        return false;
+    for (TaskHandle_t& t : listeners) {
+        if (t == task) return true;
+        if (!t) {
+            t = task;
+            return true;
+        }
     }
+    return false;
+}
+
+Stats getStats() {
+
+    portENTER_CRITICAL(&statsMux);
+    Stats copy = stats;
+    portEXIT_CRITICAL(&statsMux);
+    return copy;
+}
+
+// Kopia linii z historii parsera (odczyt bez blokady - tylko do podglądu)
+size_t getRawLine(size_t age, char* out, size_t outLen) {
+    return parser.rawLine(age, out, outLen);
 }
 
     // Sprawdzenie czy jest aktualny fix GPS
     bool hasLiveFix() {
-        return gps.location.isValid() && gps.location.age() < 2000;
+        return latest().valid;
     }
 
     // Debugowanie statusu GPS
     void debugStatus() {
 
-        Fix fix;
-        if (poll(fix)) {
-            
-            if (fix.valid) {
+        Fix fix = latest();
+        Stats st = getStats();
 
-                Serial.printf("[GPS] Lat: %.6f, Lng: %.6f, Sats: %d\n", 
-                    fix.lat, fix.lng, fix.sats);
-            }
+        if (fix.valid) {
+
+            Serial.printf("[GPS] Lat: %.6f, Lng: %.6f, Sats: %d\n",
+                fix.lat, fix.lng, fix.sats);
+        } else {
+            Serial.println("[GPS] No fix");
         }
+        Serial.printf("[GPS] %lu B, %lu sentences, %lu checksum errors, %lu overruns, %lu fixes\n",
+            (unsigned long)st.bytes, (unsigned long)st.sentences, (unsigned long)st.checksumErrors,
+            (unsigned long)st.overruns, (unsigned long)st.fixes);
+        Serial.printf("[GPS] TTFF %lu ms, %lu.%02lu Hz fixes (%u ms epochs, %lu bd), %lu position saves\n",
+            (unsigned long)st.ttffMs, (unsigned long)(st.fixRateMilliHz / 1000),
+            (unsigned long)(st.fixRateMilliHz % 1000 / 10), st.setup.rateMs, (unsigned long)st.setup.baud,
+            (unsigned long)st.aidingSaves);
+        const GpsOdometer::Stats& os = st.odometer;
+        Serial.printf("[GPS] Odometer %lu m: %lu accepted, %lu gated, %lu stationary, %lu outliers, %lu reanchors\n",
+            (unsigned long)(fix.odometerMm / 1000), (unsigned long)os.accepted, (unsigned long)os.gated,
+            (unsigned long)os.stationary, (unsigned long)os.outliers, (unsigned long)os.reanchors);
+        Timebase::debugStatus();
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,272 @@
+#include "gps_setup.h"
+
+#include <string.h>
+
+// Moduł celowo nie używa Arduino.h - kompiluje się również na hoście
+
+namespace GpsSetup {
+
+    // Czas GPS = UTC + sekundy przestępne od 1980-01-06 (stan od 2017)
+    static constexpr uint32_t GPS_EPOCH_UNIX = 315964800;
+    static constexpr uint32_t LEAP_SECONDS = 18;
+    static constexpr uint32_t SECONDS_PER_WEEK = 604800;
+
+    // Stany UbxScanner
+    enum : uint8_t { SYNC1, SYNC2, CLASS, ID, LEN1, LEN2, PAYLOAD, CK_A, CK_B };
+
+    static void put16(uint8_t* p, uint16_t v) {
+        p[0] = (uint8_t)v;
+        p[1] = (uint8_t)(v >> 8);
+    }
+
+    static void put32(uint8_t* p, uint32_t v) {
+        put16(p, (uint16_t)v);
+        put16(p + 2, (uint16_t)(v >> 16));
+    }
+
+    // =============================================================================
+    // RAMKI UBX
+    // =============================================================================
+
+    size_t frame(uint8_t cls, uint8_t id, const uint8_t* payload, uint16_t len, uint8_t* out, size_t outLen) {
+
+        if (outLen < (size_t)len + 8) return 0;
+        out[0] = 0xB5;
+        out[1] = 0x62;
+        out[2] = cls;
+        out[3] = id;
+        put16(out + 4, len);
+        if (len) memcpy(out + 6, payload, len);
+
+        // Suma Fletchera od klasy do końca danych
+        uint8_t a = 0, b = 0;
+        for (size_t i = 2; i < (size_t)len + 6; i++) {
+            a += out[i];
+            b += a;
+        }
+        out[len + 6] = a;
+        out[len + 7] = b;
+        return (size_t)len + 8;
+    }
+
+    size_t cfgPrt(uint32_t baud, uint8_t* out, size_t outLen) {
+
+        uint8_t p[20] = {};
+        p[0] = 1;                       // UART1
+        put32(p + 4, 0x000008D0);       // 8N1
+        put32(p + 8, baud);
+        put16(p + 12, 0x0003);          // Wejście UBX + NMEA
+        put16(p + 14, 0x0003);          // Wyjście UBX (ACK) + NMEA
+        return frame(CLS_CFG, ID_CFG_PRT, p, sizeof(p), out, outLen);
+    }
+
+    size_t cfgMsg(uint8_t nmeaId, uint8_t rate, uint8_t* out, size_t outLen) {
+
+        uint8_t p[3] = { CLS_NMEA, nmeaId, rate };     // Częstość na bieżącym porcie (co ile epok)
+        return frame(CLS_CFG, ID_CFG_MSG, p, sizeof(p), out, outLen);
+    }
+
+    size_t cfgRate(uint16_t rateMs, uint8_t* out, size_t outLen) {
+
+        uint8_t p[6];
+        put16(p, rateMs);               // Okres pomiarów
+        put16(p + 2, 1);                // Epoka nawigacyjna co pomiar
+        put16(p + 4, 1);                // Czas odniesienia GPS
+        return frame(CLS_CFG, ID_CFG_RATE, p, sizeof(p), out, outLen);
+    }
+
+    size_t aidIni(const Aiding& aiding, uint32_t posAccM, uint32_t utcNow, uint32_t timeAccMs,
+                  uint8_t* out, size_t outLen) {
+
+        uint8_t p[48] = {};
+        uint32_t flags = AID_POS_VALID | AID_LLA | AID_ALT_INVALID;
+        put32(p, (uint32_t)aiding.latE7);
+        put32(p + 4, (uint32_t)aiding.lngE7);
+        put32(p + 12, posAccM < 40000000 ? posAccM * 100 : 0xFFFFFFFF);    // [cm]
+
+        if (utcNow > GPS_EPOCH_UNIX) {
+            uint32_t gps = utcNow - GPS_EPOCH_UNIX + LEAP_SECONDS;
+            put16(p + 18, (uint16_t)(gps / SECONDS_PER_WEEK));         // Tydzień GPS
+            put32(p + 20, gps % SECONDS_PER_WEEK * 1000);               // Czas tygodnia [ms]
+            put32(p + 28, timeAccMs);
+            flags |= AID_TIME_VALID;
+        }
+        put32(p + 44, flags);
+        return frame(CLS_AID, ID_AID_INI, p, sizeof(p), out, outLen);
+    }
+
+    uint32_t unixTime(uint16_t year, uint8_t month, uint8_t day, uint32_t timeOfDayMs) {
+
+        // Dni od 1970-01-01 (kalendarz gregoriański, rok od marca)
+        int32_t y = (int32_t)year - (month <= 2);
+        int32_t era = y / 400;
+        uint32_t yoe = (uint32_t)(y - era * 400);
+        uint32_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+        uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        int32_t days = era * 146097 + (int32_t)doe - 719468;
+        return (uint32_t)days * 86400 + timeOfDayMs / 1000;
+    }
+
+    uint16_t minRateMs(uint32_t baud) {
+
+        uint32_t bytesPerS = baud / 10 * LINK_UTIL_PCT / 100;
+        if (bytesPerS == 0) return 1000;
+        uint32_t ms = (EPOCH_BYTES * 1000 + bytesPerS - 1) / bytesPerS;
+        ms = (ms + 99) / 100 * 100;                 // Okresy odbiornika: wielokrotność 100 ms
+        return (uint16_t)(ms < 1000 ? ms : 1000);
+    }
+
+    // =============================================================================
+    // WYSZUKIWANIE RAMEK
+    // =============================================================================
+
+    void UbxScanner::reset() {
+        state = SYNC1;
+        msgCls = msgId = 0;
+        len = pos = 0;
+        ckA = ckB = 0;
+        overflow = false;
+    }
+
+    bool UbxScanner::feed(uint8_t b) {
+
+        if (state >= CLASS && state <= PAYLOAD) {
+            ckA += b;
+            ckB += ckA;
+        }
+
+        switch (state) {
+        case SYNC1:
+            if (b == 0xB5) state = SYNC2;
+            return false;
+        case SYNC2:
+            state = b == 0x62 ? CLASS : (b == 0xB5 ? SYNC2 : SYNC1);
+            ckA = ckB = 0;
+            return false;
+        case CLASS:
+            msgCls = b;
+            state = ID;
+            return false;
+        case ID:
+            msgId = b;
+            state = LEN1;
+            return false;
+        case LEN1:
+            len = b;
+            state = LEN2;
+            return false;
+        case LEN2:
+            len |= (uint16_t)b << 8;
+            pos = 0;
+            overflow = len > MAX_PAYLOAD;
+            state = len ? PAYLOAD : CK_A;
+            return false;
+        case PAYLOAD:
+            if (pos < MAX_PAYLOAD) buf[pos] = b;
+            if (++pos >= len) state = CK_A;
+            return false;
+        case CK_A:
+            state = b == ckA ? CK_B : SYNC1;
+            return false;
+        default:
+            state = SYNC1;
+            return b == ckB && !overflow;
+        }
+    }
+
+    // =============================================================================
+    // KONFIGURACJA
+    // =============================================================================
+
+    // Ramka CFG i oczekiwanie na potwierdzenie: 1 = ACK, -1 = NAK, 0 = brak odpowiedzi
+    static int command(const Port& port, uint32_t timeoutMs, const uint8_t* f, size_t n, Result& result) {
+
+        if (n == 0) return 0;
+        port.write(f, n);
+
+        UbxScanner scanner;
+        uint8_t rx[64];
+        uint32_t t0 = port.nowMs();
+        uint32_t waited;
+        while ((waited = port.nowMs() - t0) < timeoutMs) {
+
+            size_t got = port.read(rx, sizeof(rx), timeoutMs - waited);
+            for (size_t i = 0; i < got; i++) {
+                if (!scanner.feed(rx[i]) || scanner.cls() != CLS_ACK || scanner.length() != 2) continue;
+                if (scanner.payload()[0] != f[2] || scanner.payload()[1] != f[3]) continue;
+                if (scanner.id() == ID_ACK_ACK) {
+                    result.acked++;
+                    return 1;
+                }
+                result.nacked++;
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    bool configure(const Port& port, const Options& options, Result& result) {
+
+        uint32_t t0 = port.nowMs();
+        result = {};
+        result.baud = FACTORY_BAUD;
+        result.rateMs = 1000;
+
+        uint8_t f[MAX_FRAME];
+        bool switching = options.baud != FACTORY_BAUD;
+
+        // Prędkość: CFG-PRT przy prędkości fabrycznej, dalej przy docelowej; odpowiedź
+        // (ACK lub NAK) na pierwszą ramkę CFG-MSG = moduł UBX słyszy nas przy tej prędkości
+        bool heard = false;
+        for (int attempt = 0; attempt < 2 && !heard; attempt++) {
+            port.setBaud(FACTORY_BAUD);
+            if (switching) {
+                port.write(f, cfgPrt(options.baud, f, sizeof(f)));
+                port.setBaud(options.baud);
+            }
+            heard = command(port, options.ackTimeoutMs, f, cfgMsg(NMEA_GLL, 0, f, sizeof(f)), result) != 0;
+        }
+        if (heard) {
+            result.baud = options.baud;
+        } else if (switching) {
+            // Moduł UBX bez zmiany prędkości lub odbiornik tylko NMEA
+            port.setBaud(FACTORY_BAUD);
+            heard = command(port, options.ackTimeoutMs, f, cfgMsg(NMEA_GLL, 0, f, sizeof(f)), result) != 0;
+        }
+        if (!heard) {
+            result.durationMs = port.nowMs() - t0;
+            return false;
+        }
+        result.ubx = true;
+
+        // Zdania: tylko te, które czyta parser
+        static const uint8_t rates[][2] = {
+            { NMEA_GSV, 0 }, { NMEA_VTG, 0 }, { NMEA_RMC, 1 }, { NMEA_GGA, 1 }, { NMEA_GSA, 1 }
+        };
+        for (const auto& r : rates)
+            command(port, options.ackTimeoutMs, f, cfgMsg(r[0], r[1], f, sizeof(f)), result);
+
+        // Okres epok: żądany, ale nie krótszy niż mieści łącze; odrzucony -> dwa razy dłuższy
+        uint16_t rateMs = options.rateMs;
+        uint16_t linkMs = minRateMs(result.baud);
+        if (rateMs < linkMs) rateMs = linkMs;
+        while (rateMs < 1000) {
+            if (command(port, options.ackTimeoutMs, f, cfgRate(rateMs, f, sizeof(f)), result) > 0) {
+                result.rateMs = rateMs;
+                break;
+            }
+            rateMs = rateMs * 2 < 1000 ? rateMs * 2 : 1000;
+        }
+
+        // Dane pomocnicze (AID-INI nie jest potwierdzane)
+        if (options.aiding && options.aiding->version == AIDING_VERSION) {
+            port.write(f, aidIni(*options.aiding, options.posAccM, options.utcNow, options.timeAccMs, f, sizeof(f)));
+            result.aidedPosition = true;
+            result.aidedTime = options.utcNow > GPS_EPOCH_UNIX;
+        }
+
+        result.durationMs = port.nowMs() - t0;
+        return true;
+    }
+
+}  // namespace GpsSetup
@@ -0,0 +1,178 @@
+#include "link_capture.h"
+#include "../cabulator_settings.h"
+
+using namespace SDCARD;
+using TripLogFormat::CaptureChunk;
+
+namespace LinkCapture {
+
+    // Wpis w buforze: kanał, 0, długość (LE16), czas [us] (LE32), bajty danych
+    static constexpr uint32_t ENTRY_HEADER = 8;
+    static constexpr uint32_t RING_MASK = CAPTURE_BUFFER_BYTES - 1;
+
+    static_assert((CAPTURE_BUFFER_BYTES & RING_MASK) == 0, "CAPTURE_BUFFER_BYTES must be a power of two");
+    static_assert(CAPTURE_CHUNK_MAX <= 0xFFFF && ENTRY_HEADER + CAPTURE_CHUNK_MAX <= CAPTURE_BUFFER_BYTES / 2,
+        "CAPTURE_CHUNK_MAX too large");
+
+    static uint8_t ring[CAPTURE_BUFFER_BYTES];
+    static uint32_t head = 0;                   // Licznik zapisanych bajtów (producenci)
+    static uint32_t tail = 0;                   // Licznik odczytanych bajtów (task zapisu)
+    static uint32_t lost = 0;                   // Utracone bajty jeszcze nie zapisane jako CAPTURE_LOST
+    static uint32_t lostTimeUs = 0;             // Czas pierwszej utraty
+    static volatile bool active = false;
+    static TaskHandle_t consumer = nullptr;
+    static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+    static Stats stats = {};
+
+    // =============================================================================
+    // BUFOR PIERŚCIENIOWY (wywoływane w sekcji krytycznej)
+    // =============================================================================
+
+    static inline uint32_t freeSpace() {
+        return CAPTURE_BUFFER_BYTES - (head - tail);
+    }
+
+    static void putBytes(const uint8_t* data, uint32_t len) {
+
+        uint32_t at = head & RING_MASK;
+        uint32_t first = CAPTURE_BUFFER_BYTES - at;
+        if (first > len) first = len;
+        memcpy(ring + at, data, first);
+        memcpy(ring, data + first, len - first);
+        head += len;
+    }
+
+    static void getBytes(uint8_t* out, uint32_t len) {
+
+        uint32_t at = tail & RING_MASK;
+        uint32_t first = CAPTURE_BUFFER_BYTES - at;
+        if (first > len) first = len;
+        memcpy(out, ring + at, first);
+        memcpy(out + first, ring, len - first);
+        tail += len;
+    }
+
+    static void putEntry(uint8_t channel, uint32_t timeUs, const uint8_t* data, uint16_t len) {
+
+        uint8_t hdr[ENTRY_HEADER] = {
+            channel, 0, (uint8_t)len, (uint8_t)(len >> 8),
+            (uint8_t)timeUs, (uint8_t)(timeUs >> 8), (uint8_t)(timeUs >> 16), (uint8_t)(timeUs >> 24)
+        };
+        putBytes(hdr, ENTRY_HEADER);
+        if (data) putBytes(data, len);
+    }
+
+    // Zaległa luka trafia do bufora przed kolejnymi danymi - zachowuje kolejność w pliku
+    static void putLost() {
+
+        while (lost > 0 && freeSpace() >= ENTRY_HEADER) {
+            uint16_t n = lost > 0xFFFF ? 0xFFFF : (uint16_t)lost;
+            putEntry(TripLogFormat::CAPTURE_LOST, lostTimeUs, nullptr, n);
+            lost -= n;
+        }
+    }
+
+    // =============================================================================
+    // API
+    // =============================================================================
+
+    void setEnabled(bool on) {
+
+        portENTER_CRITICAL(&mux);
+        if (on && !active) {
+            head = tail = 0;
+            lost = 0;
+            stats = {};
+        }
+        active = on;
+        portEXIT_CRITICAL(&mux);
+    }
+
+    bool enabled() {
+        return active;
+    }
+
+    void setConsumer(TaskHandle_t task) {
+        consumer = task;
+    }
+
+    void record(uint8_t channel, const uint8_t* data, size_t len) {
+
+        if (!active || !data || channel >= TripLogFormat::CAPTURE_LOST) return;
+
+        bool wake = false;
+
+        while (len > 0) {
+
+            uint16_t n = len > (size_t)CAPTURE_CHUNK_MAX ? (uint16_t)CAPTURE_CHUNK_MAX : (uint16_t)len;
+
+            // Czas pobierany w sekcji krytycznej - rosnący w kolejności bufora
+            portENTER_CRITICAL(&mux);
+            uint32_t now = micros();
+            putLost();
+            if (lost == 0 && freeSpace() >= ENTRY_HEADER + n) {
+                putEntry(channel, now, data, n);
+                stats.bytes[channel] += n;
+                stats.chunks++;
+            } else {
+                if (lost == 0) lostTimeUs = now;
+                lost += n;
+                stats.bytes[TripLogFormat::CAPTURE_LOST] += n;
+            }
+            uint32_t used = head - tail;
+            if (used > stats.maxUsed) stats.maxUsed = used;
+            wake = used >= CAPTURE_BUFFER_BYTES / 2;
+            portEXIT_CRITICAL(&mux);
+
+            data += n;
+            len -= n;
+        }
+
+        // Budzenie taska zapisu tylko przy zapełnionym buforze - w pozostałych
+        // przypadkach task i tak obudzi się co LOG_IDLE_WAKE_MS
+        if (wake && consumer) xTaskNotifyGive(consumer);
+    }
+
+    bool pop(CaptureChunk& chunk, uint8_t* buf) {
+
+        bool ok = false;
+
+        portENTER_CRITICAL(&mux);
+        if (head != tail) {
+
+            uint8_t hdr[ENTRY_HEADER];
+            getBytes(hdr, ENTRY_HEADER);
+            chunk.channel = hdr[0];
+            chunk.len = (uint16_t)(hdr[2] | hdr[3] << 8);
+            chunk.timeUs = (uint32_t)hdr[4] | (uint32_t)hdr[5] << 8 | (uint32_t)hdr[6] << 16 | (uint32_t)hdr[7] << 24;
+            chunk.data = nullptr;
+            if (chunk.channel != TripLogFormat::CAPTURE_LOST) {
+                getBytes(buf, chunk.len);
+                chunk.data = buf;
+            }
+            ok = true;
+
+        } else if (lost > 0) {
+
+            // Luka na końcu nagrania (bufor pusty, nie było kolejnego record())
+            chunk.channel = TripLogFormat::CAPTURE_LOST;
+            chunk.len = lost > 0xFFFF ? 0xFFFF : (uint16_t)lost;
+            chunk.timeUs = lostTimeUs;
+            chunk.data = nullptr;
+            lost -= chunk.len;
+            ok = true;
+        }
+        portEXIT_CRITICAL(&mux);
+        return ok;
+    }
+
+    Stats getStats() {
+
+        portENTER_CRITICAL(&mux);
+        Stats copy = stats;
+        portEXIT_CRITICAL(&mux);
+        return copy;
+    }
+
+}  // namespace LinkCapture
@@ -1,15 +1,18 @@
 #include <Arduino.h>
 #include <TFT_eSPI.h>
-#include <EEPROM.h>
 #include "esp_task_wdt.h"
+#include <time.h>
 
 #include "tft_display.h"
 #include "gui_elements.h"
 #include "gps_reader.h"
+#include "timebase.h"
 #include "obd_reader.h"
 #include "background.h"
 #include "screen_manager.h"
 #include "sd_manager.h"
+#include "trip_logger.h"
+#include "settings_store.h"
 
 #include "screen_home.h"
 #include "screen_settings.h"
@@ -36,35 +39,19 @@ String currentTripPath = "";  // Ścieżka do folderu obecnej trasy
 // TASKI RTOS - Wielowątkowe wykonanie
 // =============================================================================
 
-// Task OBD - czytanie danych z modułu OBD co 2 sekundy
+// Task OBD - łączenie z adapterem w tle i odpytywanie ECU wg harmonogramu
 void taskOBD(void* param) {
   OBD::task(param);
 }
 
-// Task GPS - odczyt i debug GPS co 10 sekund
-void taskGPS(void* param) {
-  static bool timeSync = false;     // Flaga synchronizacji czasu systemowego z GPS
-
-  while (true) {
-
-      GPS::Fix fix;
-
-      if (GPS::poll(fix)) {
-
-          GPS::debugStatus();
-          // Synchronizacja czasu systemowego z GPS
-          if (!timeSync && fix.dateTimeValid) {
-
-              if (GPS::setSystemTimeFromGPS(fix)) {
-
-                  timeSync = true;
-                  Serial.println("[GPS] System time synchronized from GPS");
-              }
-          }
+// Task LOG - zapis rekordów trasy na SD w paczkach (niski priorytet)
+void taskLogger(void* param) {
+  TripLogger::task(param);
+}
 
-      }
-      vTaskDelay(10000 / portTICK_PERIOD_MS); // Opóźnienie 10 sekund
-  }
+// Task GPS - jedyny czytelnik UART GPS, budzony zdarzeniami odbioru
+void taskGPS(void* param) {
+  GPS::task(param);
 }
 
 // =============================================================================
@@ -95,14 +82,18 @@ void setup() {
   bg.draw(tft, png, true);
   currentScreen = SCREEN_WELCOME;
 
-  // ========== EEPROM & JASNOŚĆ & TARYFA ==========
-  EEPROM.begin(100);            // Zarezerowanie 100 bajtów w EEPROM
+  // ========== USTAWIENIA & JASNOŚĆ & TARYFA ==========
+  if (!Settings::begin()) {     // Magazyn rekordów na partycji flash (migracja z EEPROM)
+      Serial.println("[WARNING] Settings store unavailable, using defaults\n");
+  }
   initBrightnessModule();
-  loadTariffFromEEPROM();
+  loadTariffSettings();
 
   // ========== INICJALIZACJA KARTY SD ==========
   if (!SDManager::init()) {
       Serial.println("[WARNING] SD Card initialization failed, continuing anyway\n");
+  } else {
+      loadTariffTable();
   }
   
   // Rekalibracja dotyku po inicjalizacji SD
@@ -111,11 +102,12 @@ void setup() {
   Serial.println("[TOUCH] Re-calibrated after SD init");
 
   // ========== INICJALIZACJA GPS I OBD ==========
+  Timebase::begin();  // Czas UTC z zegara systemowego (jeśli przetrwał restart) i PPS - przed danymi pomocniczymi GPS
+  setenv("TZ", TARIFF::TIME_ZONE, 1);   // Zegar systemowy w UTC, taryfa (localtime_r) w czasie polskim
+  tzset();
   GPS::begin();
 
-  if (!OBD::init()) {
-      Serial.println("[WARNING] OBD initialization failed, continuing anyway\n");
-  }
+  OBD::begin();      // Połączenie z adapterem w tle (task OBD) - UI startuje od razu
 
   Serial.println("[SYSTEM] ========== INIT COMPLETE ==========\n");
 
@@ -125,7 +117,8 @@ void setup() {
 
   // ========== FREERTOS TASKS ==========
   xTaskCreate(taskOBD, "OBD", 8192, (void*)&tft, 2, NULL);
-  xTaskCreate(taskGPS, "GPS", 4096, (void*)&tft, 1, NULL);
+  xTaskCreate(taskGPS, "GPS", 4096, (void*)&tft, GPS::TASK_PRIORITY, NULL);
+  xTaskCreate(taskLogger, "LOG", 4096, NULL, SDCARD::LOG_TASK_PRIORITY, NULL);
 }
 
 
@@ -214,11 +207,11 @@ void loop() {
       lastScreenUpdate = millis();
   }
 
-  // ========== ZAPIS DANYCH TRASY DO EEPROM CO 30 SEKUND ==========
+  // ========== ZAPIS CHECKPOINTU TRASY CO 30 SEKUND ==========
   static unsigned long lastTripSave = 0;
   if (tripActive && millis() - lastTripSave > 30000) {
 
-      saveTripDataToEEPROM();
+      saveTripCheckpoint();
       lastTripSave = millis();
   }
 }
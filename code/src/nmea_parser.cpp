@@ -0,0 +1,532 @@
+#include "nmea_parser.h"
+
+// Moduł celowo nie używa Arduino.h - kompiluje się również na hoście
+
+static_assert((NmeaParser::HISTORY_BYTES & (NmeaParser::HISTORY_BYTES - 1)) == 0,
+    "HISTORY_BYTES must be a power of two");
+static_assert(NmeaParser::MAX_SENTENCE < 255, "MAX_SENTENCE must fit the uint8_t length counter");
+
+// =============================================================================
+// TABLICE
+// =============================================================================
+
+// Klasy znaków
+enum : uint8_t {
+    C_OTHER = 0,
+    C_DIGIT,
+    C_DOT,
+    C_COMMA,
+    C_STAR,
+    C_DOLLAR,
+    C_EOL,
+    C_LETTER
+};
+
+// Rodzaje pól
+enum : uint8_t {
+    F_SKIP = 0,
+    F_TIME,         // hhmmss.sss
+    F_STATUS,       // A / V
+    F_LAT,          // ddmm.mmmm
+    F_NS,           // N / S
+    F_LNG,          // dddmm.mmmm
+    F_EW,           // E / W
+    F_SPEED,        // Węzły
+    F_COURSE,       // Stopnie
+    F_DATE,         // ddmmyy
+    F_QUALITY,      // 0-8
+    F_SATS,         // 0-99
+    F_HDOP,         // x.xx
+    F_FIX_TYPE      // 1-3
+};
+
+// Indeks = numer pola po adresie (0 = adres)
+static const uint8_t RMC_FIELDS[] = {
+    F_SKIP, F_TIME, F_STATUS, F_LAT, F_NS, F_LNG, F_EW, F_SPEED, F_COURSE, F_DATE
+};
+static const uint8_t GGA_FIELDS[] = {
+    F_SKIP, F_TIME, F_LAT, F_NS, F_LNG, F_EW, F_QUALITY, F_SATS, F_HDOP
+};
+static const uint8_t GSA_FIELDS[] = {
+    F_SKIP, F_SKIP, F_FIX_TYPE,
+    F_SKIP, F_SKIP, F_SKIP, F_SKIP, F_SKIP, F_SKIP,     // PRN 1-12
+    F_SKIP, F_SKIP, F_SKIP, F_SKIP, F_SKIP, F_SKIP,
+    F_SKIP, F_HDOP                                      // PDOP, HDOP
+};
+
+// Ostatnie 3 znaki adresu
+static constexpr uint32_t ADDR_RMC = (uint32_t)'R' << 16 | (uint32_t)'M' << 8 | 'C';
+static constexpr uint32_t ADDR_GGA = (uint32_t)'G' << 16 | (uint32_t)'G' << 8 | 'A';
+static constexpr uint32_t ADDR_GSA = (uint32_t)'G' << 16 | (uint32_t)'S' << 8 | 'A';
+
+static constexpr uint32_t HISTORY_MASK = NmeaParser::HISTORY_BYTES - 1;
+
+// Tablica klas wypełniana raz, przy starcie programu
+struct CharClasses {
+    uint8_t cls[256];
+
+    CharClasses() : cls() {
+        for (int c = '0'; c <= '9'; c++) cls[c] = C_DIGIT;
+        for (int c = 'A'; c <= 'Z'; c++) cls[c] = C_LETTER;
+        for (int c = 'a'; c <= 'z'; c++) cls[c] = C_LETTER;
+        cls['.'] = C_DOT;
+        cls[','] = C_COMMA;
+        cls['*'] = C_STAR;
+        cls['$'] = C_DOLLAR;
+        cls['\r'] = C_EOL;
+        cls['\n'] = C_EOL;
+    }
+};
+
+static const CharClasses classes;
+
+static int hexValue(uint8_t c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// =============================================================================
+// API
+// =============================================================================
+
+NmeaParser::NmeaParser() {
+    reset();
+}
+
+void NmeaParser::reset() {
+
+    state = S_IDLE;
+    sentence = NONE;
+    kinds = nullptr;
+    kindCount = 0;
+    d = Data();
+    pending = Data();
+    have = 0;
+    st = Stats();
+
+    historyHead = 0;
+    lineStart = 0;
+    lineCount = 0;
+    for (size_t i = 0; i < HISTORY_LINES; i++) {
+        lineStarts[i] = 0;
+        lineLengths[i] = 0;
+    }
+}
+
+size_t NmeaParser::feed(const uint8_t* data, size_t len) {
+
+    size_t done = 0;
+    for (size_t i = 0; i < len; i++)
+        if (encode((char)data[i]) != NONE) done++;
+    return done;
+}
+
+NmeaParser::Sentence NmeaParser::encode(char ch) {
+
+    uint8_t c = (uint8_t)ch;
+    uint8_t cls = classes.cls[c];
+    st.bytes++;
+
+    // Historia: jeden zapis na znak, koniec linii to tylko zapis indeksów
+    if (cls == C_EOL) historyEnd();
+    else history[historyHead++ & HISTORY_MASK] = ch;
+
+    // '$' zawsze zaczyna nowe zdanie - resynchronizacja po zgubionych bajtach
+    if (cls == C_DOLLAR) {
+        if (state == S_FIELDS || state == S_CHECKSUM) st.checksumErrors++;     // Zdanie urwane
+        startSentence();
+        return NONE;
+    }
+
+    switch (state) {
+        case S_IDLE:
+            return NONE;
+        case S_SKIP:                // Szybka ścieżka - zdanie nieużywane
+            if (cls == C_EOL) state = S_IDLE;
+            return NONE;
+        default:
+            break;
+    }
+
+    if (cls == C_EOL) {
+        if (state == S_ADDRESS) st.malformed++;
+        else st.checksumErrors++;           // Koniec linii przed sumą kontrolną
+        state = S_IDLE;
+        return NONE;
+    }
+
+    if (++length > MAX_SENTENCE) {
+        st.malformed++;
+        state = S_IDLE;
+        return NONE;
+    }
+
+    if (state == S_CHECKSUM) {
+
+        int v = hexValue(c);
+        if (v < 0) {
+            st.checksumErrors++;
+            state = S_IDLE;
+            return NONE;
+        }
+        given = (uint8_t)(given << 4 | v);
+        return ++givenDigits == 2 ? endChecksum() : NONE;
+    }
+
+    if (cls == C_STAR) {
+        if (state == S_ADDRESS) {
+            st.malformed++;
+            state = S_IDLE;
+            return NONE;
+        }
+        endField();
+        state = S_CHECKSUM;
+        given = 0;
+        givenDigits = 0;
+        return NONE;
+    }
+
+    sum ^= c;
+
+    if (state == S_ADDRESS) {
+        if (cls == C_COMMA) endAddress();
+        else {
+            if (length == 1) letter = ch;
+            address = (address << 8 | c) & 0xFFFFFF;
+        }
+        return NONE;
+    }
+
+    // S_FIELDS - pola spoza tablicy rodzajów lub F_SKIP są tylko sumowane
+    if (cls == C_COMMA) {
+        endField();
+        if (field < 0xFF) field++;
+        intPart = fracPart = 0;
+        intDigits = fracDigits = 0;
+        seenDot = false;
+        letter = '\0';
+        return NONE;
+    }
+    if (field >= kindCount || kinds[field] == F_SKIP) return NONE;
+
+    switch (cls) {
+        case C_DIGIT:
+            if (letter) bad = true;
+            else if (!seenDot) {
+                if (intDigits >= 9) bad = true;
+                else {
+                    intPart = intPart * 10 + (uint32_t)(c - '0');
+                    intDigits++;
+                }
+            } else if (fracDigits < 7) {        // Dalsze cyfry ułamka są obcinane
+                fracPart = fracPart * 10 + (uint32_t)(c - '0');
+                fracDigits++;
+            }
+            break;
+        case C_DOT:
+            if (seenDot || letter) bad = true;
+            seenDot = true;
+            break;
+        case C_LETTER:
+            if (letter || intDigits || seenDot) bad = true;
+            letter = ch;
+            break;
+        default:                                // Znak, spacja, znak sterujący
+            bad = true;
+            break;
+    }
+    return NONE;
+}
+
+size_t NmeaParser::rawLine(size_t age, char* out, size_t outLen) const {
+
+    if (!out || outLen == 0) return 0;
+    out[0] = '\0';
+    if (age >= HISTORY_LINES || age >= lineCount) return 0;
+
+    size_t slot = (size_t)((lineCount - 1 - age) % HISTORY_LINES);
+    uint32_t start = lineStarts[slot];
+    uint32_t len = lineLengths[slot];
+    if (historyHead - start > HISTORY_BYTES) return 0;     // Nadpisana przez nowsze znaki
+
+    if (len > outLen - 1) len = (uint32_t)(outLen - 1);
+    for (uint32_t i = 0; i < len; i++) out[i] = history[(start + i) & HISTORY_MASK];
+    out[len] = '\0';
+    return len;
+}
+
+// =============================================================================
+// ZDANIE
+// =============================================================================
+
+void NmeaParser::startSentence() {
+
+    state = S_ADDRESS;
+    sentence = NONE;
+    length = 0;
+    sum = 0;
+    address = 0;
+    letter = '\0';
+}
+
+void NmeaParser::endAddress() {
+
+    // Adres standardowy: talker (2 znaki) + typ (3), bez zdań firmowych ($P...)
+    if (length == 6 && letter != 'P') {
+        switch (address) {
+            case ADDR_RMC:
+                sentence = RMC;
+                kinds = RMC_FIELDS;
+                kindCount = sizeof(RMC_FIELDS);
+                break;
+            case ADDR_GGA:
+                sentence = GGA;
+                kinds = GGA_FIELDS;
+                kindCount = sizeof(GGA_FIELDS);
+                break;
+            case ADDR_GSA:
+                sentence = GSA;
+                kinds = GSA_FIELDS;
+                kindCount = sizeof(GSA_FIELDS);
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (sentence == NONE) {
+        st.skipped++;
+        state = S_SKIP;
+        return;
+    }
+
+    state = S_FIELDS;
+    field = 1;
+    have = 0;
+    bad = false;
+    intPart = fracPart = 0;
+    intDigits = fracDigits = 0;
+    seenDot = false;
+    letter = '\0';
+}
+
+// Ułamek pola przeskalowany do podanej liczby cyfr (nadmiarowe cyfry obcięte)
+uint32_t NmeaParser::fraction(uint8_t digits) const {
+
+    uint32_t v = fracPart;
+    uint8_t n = fracDigits;
+    for (; n < digits; n++) v *= 10;
+    for (; n > digits; n--) v /= 10;
+    return v;
+}
+
+void NmeaParser::endField() {
+
+    if (field >= kindCount) return;
+    uint8_t kind = kinds[field];
+    if (kind == F_SKIP) return;
+
+    // Puste pole - wartość nieznana, poprzednia zostaje
+    if (!intDigits && !seenDot && !letter) return;
+
+    bool number = !letter;
+
+    switch (kind) {
+
+        case F_TIME: {
+            uint32_t hh = intPart / 10000, mm = intPart / 100 % 100, ss = intPart % 100;
+            if (!number || intDigits != 6 || hh > 23 || mm > 59 || ss > 60) {
+                bad = true;
+                break;
+            }
+            pending.timeMs = ((hh * 60 + mm) * 60 + ss) * 1000 + fraction(3);
+            have |= UPD_TIME;
+            break;
+        }
+
+        case F_STATUS:
+            if (letter != 'A' && letter != 'V') {
+                bad = true;
+                break;
+            }
+            pending.rmcValid = letter == 'A';
+            have |= UPD_STATUS;
+            break;
+
+        case F_LAT:
+        case F_LNG: {
+            uint32_t maxDeg = kind == F_LAT ? 90 : 180;
+            uint32_t deg = intPart / 100, min = intPart % 100;
+            if (!number || intDigits < 3 || deg > maxDeg || min > 59) {
+                bad = true;
+                break;
+            }
+            // Minuty w 1e-7, podzielone przez 60 z zaokrągleniem
+            uint32_t e7 = deg * 10000000u + (min * 10000000u + fraction(7) + 30) / 60;
+            if (e7 > maxDeg * 10000000u) {
+                bad = true;
+                break;
+            }
+            if (kind == F_LAT) {
+                pending.latE7 = (int32_t)e7;
+                have |= HAVE_LAT;
+            } else {
+                pending.lngE7 = (int32_t)e7;
+                have |= HAVE_LNG;
+            }
+            break;
+        }
+
+        case F_NS:
+            if (letter != 'N' && letter != 'S') bad = true;
+            south = letter == 'S';
+            have |= HAVE_NS;
+            break;
+
+        case F_EW:
+            if (letter != 'E' && letter != 'W') bad = true;
+            west = letter == 'W';
+            have |= HAVE_EW;
+            break;
+
+        case F_SPEED: {
+            if (!number || intPart > 99999) {
+                bad = true;
+                break;
+            }
+            // Węzły -> mm/s: 1 węzeł = 1852 m/h
+            uint64_t milliknots = (uint64_t)intPart * 1000 + fraction(3);
+            pending.speedMmS = (uint32_t)((milliknots * 1852 + 1800) / 3600);
+            have |= UPD_SPEED;
+            break;
+        }
+
+        case F_COURSE:
+            if (!number || intPart > 360) {
+                bad = true;
+                break;
+            }
+            pending.courseCdeg = (uint16_t)((intPart * 100 + fraction(2)) % 36000);
+            have |= UPD_COURSE;
+            break;
+
+        case F_DATE: {
+            uint32_t dd = intPart / 10000, mo = intPart / 100 % 100, yy = intPart % 100;
+            if (!number || seenDot || intDigits != 6 || dd < 1 || dd > 31 || mo < 1 || mo > 12) {
+                bad = true;
+                break;
+            }
+            pending.day = (uint8_t)dd;
+            pending.month = (uint8_t)mo;
+            pending.year = (uint16_t)(2000 + yy);
+            have |= UPD_DATE;
+            break;
+        }
+
+        case F_QUALITY:
+            if (!number || seenDot || intPart > 9) {
+                bad = true;
+                break;
+            }
+            pending.quality = (uint8_t)intPart;
+            have |= UPD_QUALITY;
+            break;
+
+        case F_SATS:
+            if (!number || seenDot || intPart > 99) {
+                bad = true;
+                break;
+            }
+            pending.sats = (uint8_t)intPart;
+            have |= UPD_SATS;
+            break;
+
+        case F_HDOP:
+            if (!number) {
+                bad = true;
+                break;
+            }
+            pending.hdop = intPart > 654 ? (uint16_t)65535 : (uint16_t)(intPart * 100 + fraction(2));
+            have |= UPD_HDOP;
+            break;
+
+        case F_FIX_TYPE:
+            if (!number || seenDot || intPart < 1 || intPart > 3) {
+                bad = true;
+                break;
+            }
+            pending.fixType = (uint8_t)intPart;
+            have |= UPD_FIX_TYPE;
+            break;
+
+        default:
+            break;
+    }
+}
+
+NmeaParser::Sentence NmeaParser::endChecksum() {
+
+    state = S_IDLE;
+    if (given != sum) {
+        st.checksumErrors++;
+        return NONE;
+    }
+    if (bad) {
+        st.malformed++;
+        return NONE;
+    }
+
+    commit();
+    st.sentences[sentence]++;
+    return (Sentence)sentence;
+}
+
+// Przepisanie pól zdania z poprawną sumą do Data
+void NmeaParser::commit() {
+
+    uint16_t upd = have & (uint16_t)~(HAVE_LAT | HAVE_LNG | HAVE_NS | HAVE_EW);
+
+    // Pozycja tylko z fixem: status RMC 'A' lub jakość GGA > 0
+    bool fix = sentence == RMC ? (have & UPD_STATUS) && pending.rmcValid
+             : sentence == GGA ? (have & UPD_QUALITY) && pending.quality > 0
+             : false;
+    uint16_t position = HAVE_LAT | HAVE_LNG | HAVE_NS | HAVE_EW;
+    if (fix && (have & position) == position) {
+        d.latE7 = south ? -pending.latE7 : pending.latE7;
+        d.lngE7 = west ? -pending.lngE7 : pending.lngE7;
+        upd |= UPD_POSITION;
+    }
+
+    if (upd & UPD_SPEED) d.speedMmS = pending.speedMmS;
+    if (upd & UPD_COURSE) d.courseCdeg = pending.courseCdeg;
+    if (upd & UPD_TIME) d.timeMs = pending.timeMs;
+    if (upd & UPD_DATE) {
+        d.day = pending.day;
+        d.month = pending.month;
+        d.year = pending.year;
+    }
+    if (upd & UPD_SATS) d.sats = pending.sats;
+    if (upd & UPD_HDOP) d.hdop = pending.hdop;
+    if (upd & UPD_STATUS) d.rmcValid = pending.rmcValid;
+    if (upd & UPD_QUALITY) d.quality = pending.quality;
+    if (upd & UPD_FIX_TYPE) d.fixType = pending.fixType;
+    d.updated |= upd;
+}
+
+// =============================================================================
+// HISTORIA
+// =============================================================================
+
+void NmeaParser::historyEnd() {
+
+    uint32_t len = historyHead - lineStart;
+    if (len > 0) {
+        size_t slot = (size_t)(lineCount % HISTORY_LINES);
+        lineStarts[slot] = lineStart;
+        lineLengths[slot] = len > 0xFFFF ? (uint16_t)0xFFFF : (uint16_t)len;
+        lineCount++;
+    }
+    lineStart = historyHead;
+}
@@ -0,0 +1,119 @@
+#include "obd_connection.h"
+
+// Moduł celowo nie używa Arduino.h - kompiluje się również na hoście
+
+ObdConnection::ObdConnection(const Config& config)
+    : cfg(config), current(DISCONNECTED), nextAttemptMs(0), st() {
+
+    if (cfg.backoffMinMs == 0) cfg.backoffMinMs = 1;
+    if (cfg.backoffMaxMs < cfg.backoffMinMs) cfg.backoffMaxMs = cfg.backoffMinMs;
+    if (cfg.lostAfter < cfg.degradedAfter) cfg.lostAfter = cfg.degradedAfter;
+}
+
+const char* ObdConnection::label(State state) {
+
+    switch (state) {
+        case DISCONNECTED: return "NO LINK";
+        case CONNECTING: return "CONNECTING";
+        case ELM_INIT: return "ELM INIT";
+        case READY: return "READY";
+        case DEGRADED: return "DEGRADED";
+        default: return "?";
+    }
+}
+
+void ObdConnection::enter(State next, uint32_t nowMs) {
+
+    current = next;
+    st.sinceMs = nowMs;
+    st.timeoutStreak = 0;
+}
+
+// Nieudana próba - kolejna po przerwie wydłużanej x2
+void ObdConnection::fail(State next, uint32_t nowMs) {
+
+    st.backoffMs = st.backoffMs == 0 ? cfg.backoffMinMs : st.backoffMs * 2;
+    if (st.backoffMs > cfg.backoffMaxMs) st.backoffMs = cfg.backoffMaxMs;
+    nextAttemptMs = nowMs + st.backoffMs;
+    enter(next, nowMs);
+}
+
+ObdConnection::Action ObdConnection::step(uint32_t nowMs, uint32_t& waitMs) {
+
+    waitMs = 0;
+    switch (current) {
+
+        case DISCONNECTED:
+        case ELM_INIT: {
+            int32_t left = (int32_t)(nextAttemptMs - nowMs);
+            if (left > 0) {
+                waitMs = (uint32_t)left;
+                return ACT_WAIT;
+            }
+            if (current == ELM_INIT) return ACT_INIT;
+            st.attempts++;
+            enter(CONNECTING, nowMs);
+            return ACT_CONNECT;
+        }
+
+        case CONNECTING:
+            return ACT_CONNECT;
+
+        default:
+            return ACT_POLL;
+    }
+}
+
+void ObdConnection::onConnectResult(bool ok, uint32_t nowMs) {
+
+    if (current != CONNECTING) return;
+    if (!ok) {
+        fail(DISCONNECTED, nowMs);
+        return;
+    }
+    nextAttemptMs = nowMs;                  // Inicjalizacja ELM od razu
+    enter(ELM_INIT, nowMs);
+}
+
+void ObdConnection::onInitResult(bool ok, uint32_t nowMs) {
+
+    if (current != ELM_INIT) return;
+    if (!ok) {
+        // Adapter połączony, ECU milczy (np. wyłączony zapłon) - ponowna próba bez rozłączania
+        st.initFailures++;
+        fail(ELM_INIT, nowMs);
+        return;
+    }
+    st.backoffMs = 0;
+    enter(READY, nowMs);
+}
+
+void ObdConnection::onRequest(bool answered, uint32_t nowMs) {
+
+    if (!online()) return;
+
+    if (answered) {
+        if (current == DEGRADED) enter(READY, nowMs);
+        st.timeoutStreak = 0;
+        return;
+    }
+
+    if (st.timeoutStreak < 255) st.timeoutStreak++;
+    if (st.timeoutStreak >= cfg.lostAfter) {
+        st.linkLosses++;
+        st.backoffMs = 0;
+        fail(DISCONNECTED, nowMs);
+    } else if (st.timeoutStreak >= cfg.degradedAfter && current == READY) {
+        uint8_t streak = st.timeoutStreak;
+        enter(DEGRADED, nowMs);
+        st.timeoutStreak = streak;
+    }
+}
+
+void ObdConnection::onTransportLost(uint32_t nowMs) {
+
+    if (current == DISCONNECTED || current == CONNECTING) return;
+    if (online()) st.linkLosses++;
+    st.backoffMs = 0;
+    fail(DISCONNECTED, nowMs);
+}
@@ -0,0 +1,180 @@
+#include "obd_discovery.h"
+#include "obd_pid.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Moduł celowo nie używa Arduino.h - kompiluje się również na hoście
+
+namespace ObdDiscovery {
+
+    static int hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    }
+
+    // Znak dozwolony w VIN (bez I, O, Q)
+    static bool isVinChar(uint8_t c) {
+        if (c >= '0' && c <= '9') return true;
+        return c >= 'A' && c <= 'Z' && c != 'I' && c != 'O' && c != 'Q';
+    }
+
+    bool parseBitmap(const char* response, uint8_t base, uint32_t& bits) {
+
+        ObdPid::Value v = { base, false, 0, {} };
+        if (!response || ObdPid::parseResponse(response, &v, 1) != 1 || v.len != 4) return false;
+        bits = (uint32_t)v.data[0] << 24 | (uint32_t)v.data[1] << 16 | (uint32_t)v.data[2] << 8 | v.data[3];
+        return true;
+    }
+
+    bool parseVin(const char* response, char* out) {
+
+        out[0] = '\0';
+        if (!response) return false;
+
+        uint8_t bytes[64];
+        size_t n = ObdPid::collectBytes(response, bytes, sizeof(bytes));
+
+        // CAN: 49 02 01 + 17 znaków; starsze protokoły: 49 02 0N + 4 bajty w każdej linii
+        char vin[VIN_LEN * 2 + 1];
+        size_t len = 0;
+        bool inResponse = false;
+        for (size_t i = 0; i < n; i++) {
+
+            if (i + 2 < n && bytes[i] == 0x49 && bytes[i + 1] == 0x02) {
+                inResponse = true;
+                i += 2;                             // Numer elementu / linii
+                continue;
+            }
+            if (inResponse && isVinChar(bytes[i]) && len < sizeof(vin) - 1) vin[len++] = (char)bytes[i];
+        }
+
+        // Dopełnienie zerami pominięte - ostatnie 17 znaków
+        if (len < VIN_LEN) return false;
+        memcpy(out, vin + len - VIN_LEN, VIN_LEN);
+        out[VIN_LEN] = '\0';
+        return true;
+    }
+
+    int parseProtocol(const char* response) {
+
+        if (!response) return -1;
+
+        // "A6" (automatyczny, wykryty 6) lub "6"
+        const char* p = response;
+        if (*p == 'A') p++;
+        int value = hexValue(*p);
+        if (value <= 0 || (p[1] != '\0' && p[1] != '\n')) return -1;
+        return value;
+    }
+
+    bool isSupported(const Vehicle& vehicle, uint8_t pid) {
+
+        if (pid == 0) return true;
+        size_t range = (pid - 1) / 32;
+        if (range >= PID_RANGES) return false;
+        return (vehicle.supported[range] >> (31 - (pid - 1) % 32)) & 1;
+    }
+
+    FuelSource selectFuelSource(const Vehicle& vehicle) {
+
+        if (isSupported(vehicle, ObdPid::PID_FUEL_RATE)) return FUEL_RATE;
+        if (isSupported(vehicle, ObdPid::PID_MAF)) return FUEL_MAF;
+        if (isSupported(vehicle, ObdPid::PID_MAP) && isSupported(vehicle, ObdPid::PID_RPM)) return FUEL_MAP_RPM;
+        return FUEL_NONE;
+    }
+
+    const char* fuelSourceLabel(uint8_t source) {
+
+        switch (source) {
+            case FUEL_RATE: return "015E";
+            case FUEL_MAF: return "MAF";
+            case FUEL_MAP_RPM: return "MAP/RPM";
+            default: return "NONE";
+        }
+    }
+
+    bool resetAdapter(Transact transact) {
+
+        // Po włączeniu adapter może zgubić pierwszą komendę - jedna powtórka
+        if (!transact("ATZ", RESET_TIMEOUT_MS) && !transact("ATZ", RESET_TIMEOUT_MS)) return false;
+
+        const char* setup[] = { "ATE0", "ATL0", "ATS0", "ATH0" };
+        bool ok = true;
+        for (const char* cmd : setup) {
+            const char* resp = transact(cmd, AT_TIMEOUT_MS);
+            ok = ok && resp && strstr(resp, "OK");
+        }
+        return ok;
+    }
+
+    static void setProtocol(Transact transact, uint8_t protocol) {
+
+        char cmd[8];
+        snprintf(cmd, sizeof(cmd), "ATSP%X", protocol);
+        transact(cmd, AT_TIMEOUT_MS);
+    }
+
+    // Zapamiętany pojazd: ten sam VIN (lub mapa 01-20 przy braku VIN)
+    static bool verifyCached(Transact transact, const Vehicle& cached) {
+
+        setProtocol(transact, cached.protocol);
+
+        if (cached.vin[0] != '\0') {
+            char vin[VIN_LEN + 1];
+            return parseVin(transact("0902", VIN_TIMEOUT_MS), vin) && strcmp(vin, cached.vin) == 0;
+        }
+
+        uint32_t bits = 0;
+        return parseBitmap(transact("0100", ECU_TIMEOUT_MS), 0x00, bits) && bits == cached.supported[0];
+    }
+
+    bool discover(Transact transact, const VehicleProfile& profile, Vehicle& out) {
+
+        memset(&out, 0, sizeof(out));
+        out.version = FORMAT_VERSION;
+
+        // Protokół automatyczny - pierwsze zapytanie wyszukuje magistralę
+        transact("ATSP0", AT_TIMEOUT_MS);
+        if (!parseBitmap(transact("0100", SEARCH_TIMEOUT_MS), 0x00, out.supported[0])) return false;
+
+        // Kolejne mapy tylko gdy poprzednia zgłasza ich istnienie (bit PID base+0x20)
+        for (size_t r = 1; r < PID_RANGES && (out.supported[r - 1] & 1); r++) {
+            char cmd[5];
+            uint8_t base = (uint8_t)(r * 0x20);
+            snprintf(cmd, sizeof(cmd), "01%02X", base);
+            if (!parseBitmap(transact(cmd, ECU_TIMEOUT_MS), base, out.supported[r])) break;
+        }
+
+        int protocol = parseProtocol(transact("ATDPN", AT_TIMEOUT_MS));
+        out.protocol = protocol > 0 ? (uint8_t)protocol : 0;
+
+        parseVin(transact("0902", VIN_TIMEOUT_MS), out.vin);
+        float km;
+        out.odometer = profile.odometer.requestLen
+                       && VehicleProfile::decode(profile.odometer, transact(profile.odometer.command, ECU_TIMEOUT_MS), km);
+        out.profileId = profile.id;
+        out.fuelSource = selectFuelSource(out);
+
+        // Protokół na stałe - bez ponownego wyszukiwania po uśpieniu ECU
+        if (out.protocol) setProtocol(transact, out.protocol);
+        return true;
+    }
+
+    Outcome bringUp(Transact transact, const VehicleProfile& profile, Vehicle& vehicle) {
+
+        if (!resetAdapter(transact)) return FAILED;
+
+        if (vehicle.version == FORMAT_VERSION && vehicle.protocol != 0 && vehicle.profileId == profile.id
+            && verifyCached(transact, vehicle))
+            return CACHED;
+
+        Vehicle found;
+        if (!discover(transact, profile, found)) return FAILED;
+        vehicle = found;
+        return DISCOVERED;
+    }
+
+}  // namespace ObdDiscovery
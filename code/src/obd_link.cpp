@@ -0,0 +1,231 @@
+#include "obd_link.h"
+#include "link_capture.h"
+
+namespace ObdLink {
+
+    static ObdTransport* port = nullptr;
+
+    // Bufor RX - zapisywany przez handler transportu, czytany przez task OBD
+    static char rx[RX_BUFFER_SIZE + 1];
+    static size_t rxLen = 0;
+    static bool rxComplete = false;
+    static bool rxArmed = false;                    // true = trwa komenda, bajty są przyjmowane
+    static TaskHandle_t waiter = nullptr;
+    static StreamHandler streamHandler = nullptr;   // != nullptr = komenda strumieniowa (stream())
+    static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+    static Stats stats = {};
+    static uint32_t histogram[HIST_BUCKETS] = {0};
+
+    // =============================================================================
+    // CALLBACK ODBIORU (kontekst taska Bluetooth lub write() emulatora)
+    // =============================================================================
+
+    static void onData(const uint8_t* data, size_t size) {
+
+        TaskHandle_t notify = nullptr;
+        LinkCapture::record(TripLogFormat::CAPTURE_OBD_RX, data, size);
+
+        portENTER_CRITICAL(&mux);
+        if (!rxArmed || rxComplete) {
+            stats.discardedBytes += size;
+        } else if (streamHandler) {
+            // Strumień: bajty do '>' wprost do handlera
+            size_t n = 0;
+            while (n < size && data[n] != '>') n++;
+            if (n > 0) streamHandler(data, n);
+            if (n < size) {
+                rxComplete = true;
+                notify = waiter;
+            }
+        } else {
+            for (size_t i = 0; i < size; i++) {
+                if (data[i] == '>') {
+                    rxComplete = true;
+                    notify = waiter;
+                    break;
+                }
+                if (rxLen < RX_BUFFER_SIZE) rx[rxLen++] = (char)data[i];
+                else stats.overflows++;
+            }
+        }
+        portEXIT_CRITICAL(&mux);
+
+        if (notify) xTaskNotifyGive(notify);
+    }
+
+    // =============================================================================
+    // FUNKCJE POMOCNICZE
+    // =============================================================================
+
+    // Uzbrojenie odbioru przed wysłaniem (odpowiedź może przyjść natychmiast)
+    static void arm(StreamHandler handler) {
+
+        ulTaskNotifyTake(pdTRUE, 0);
+        portENTER_CRITICAL(&mux);
+        rxLen = 0;
+        rxComplete = false;
+        rxArmed = true;
+        streamHandler = handler;
+        waiter = xTaskGetCurrentTaskHandle();
+        portEXIT_CRITICAL(&mux);
+    }
+
+    static void disarm() {
+
+        portENTER_CRITICAL(&mux);
+        rxArmed = false;
+        streamHandler = nullptr;
+        waiter = nullptr;
+        portEXIT_CRITICAL(&mux);
+    }
+
+    // Oczekiwanie na '>' bez pollingu
+    static bool waitComplete(uint32_t timeoutMs) {
+
+        TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(timeoutMs);
+        while (true) {
+            portENTER_CRITICAL(&mux);
+            bool complete = rxComplete;
+            portEXIT_CRITICAL(&mux);
+            if (complete) return true;
+
+            TickType_t now = xTaskGetTickCount();
+            if ((int32_t)(deadline - now) <= 0) return false;
+            ulTaskNotifyTake(pdTRUE, deadline - now);
+        }
+    }
+
+    // Normalizacja w miejscu: \r i \n -> pojedyncze \n, bez pustych linii i końcowych spacji
+    static size_t normalize(char* buf, size_t len) {
+
+        size_t out = 0;
+        for (size_t i = 0; i < len; i++) {
+            char c = buf[i];
+            if (c == '\r' || c == '\n') {
+                if (out > 0 && buf[out - 1] != '\n') buf[out++] = '\n';
+            } else if (c != '\0') {
+                buf[out++] = c;
+            }
+        }
+        while (out > 0 && (buf[out - 1] == ' ' || buf[out - 1] == '\n')) out--;
+        buf[out] = '\0';
+        return out;
+    }
+
+    static void recordLatency(uint32_t us) {
+
+        size_t bucket = us / 1000 / HIST_BUCKET_MS;
+        if (bucket >= HIST_BUCKETS) bucket = HIST_BUCKETS - 1;
+        histogram[bucket]++;
+
+        stats.lastUs = us;
+        if (us > stats.maxUs) stats.maxUs = us;
+    }
+
+    // =============================================================================
+    // API
+    // =============================================================================
+
+    void begin(ObdTransport& transport) {
+
+        port = &transport;
+        port->setHandler(onData);
+    }
+
+    const char* transact(const char* cmd, uint32_t timeoutMs, size_t* len) {
+
+        if (len) *len = 0;
+        if (!port) return nullptr;
+
+        // Komenda + \r w jednym zapisie
+        char out[48];
+        size_t cmdLen = strlen(cmd);
+        if (cmdLen > sizeof(out) - 2) return nullptr;
+        memcpy(out, cmd, cmdLen);
+        out[cmdLen++] = '\r';
+
+        arm(nullptr);
+        LinkCapture::record(TripLogFormat::CAPTURE_OBD_TX, (const uint8_t*)out, cmdLen);
+
+        uint32_t t0 = micros();
+        size_t written = port->write((const uint8_t*)out, cmdLen);
+        stats.commands++;
+
+        // Zerwane połączenie - bez czekania na odpowiedź, liczone jak timeout
+        if (written != cmdLen) {
+            disarm();
+            stats.timeouts++;
+            return nullptr;
+        }
+
+        bool complete = waitComplete(timeoutMs);
+        uint32_t elapsed = micros() - t0;
+
+        portENTER_CRITICAL(&mux);
+        size_t n = rxLen;
+        portEXIT_CRITICAL(&mux);
+        disarm();
+
+        if (complete) recordLatency(elapsed);
+        else stats.timeouts++;
+
+        // Ramka gotowa - normalizacja w buforze RX, zwracany wskaźnik bez kopii
+        n = normalize(rx, n);
+        if (len) *len = n;
+        return n > 0 ? rx : nullptr;
+    }
+
+    bool stream(const char* cmd, StreamHandler handler, uint32_t windowMs, uint32_t stopTimeoutMs) {
+
+        if (!port || !handler) return false;
+
+        char out[48];
+        size_t cmdLen = strlen(cmd);
+        if (cmdLen > sizeof(out) - 2) return false;
+        memcpy(out, cmd, cmdLen);
+        out[cmdLen++] = '\r';
+
+        arm(handler);
+        LinkCapture::record(TripLogFormat::CAPTURE_OBD_TX, (const uint8_t*)out, cmdLen);
+        size_t written = port->write((const uint8_t*)out, cmdLen);
+        stats.commands++;
+
+        // Adapter kończy sam ('?', BUFFER FULL) albo nasłuch przerywa dowolny znak
+        bool complete = written == cmdLen && waitComplete(windowMs);
+        if (written == cmdLen && !complete) {
+            const uint8_t stop = '\r';
+            LinkCapture::record(TripLogFormat::CAPTURE_OBD_TX, &stop, 1);
+            if (port->write(&stop, 1) == 1) complete = waitComplete(stopTimeoutMs);
+        }
+        disarm();
+
+        if (!complete) stats.timeouts++;
+        return complete;
+    }
+
+    Stats getStats() {
+        return stats;
+    }
+
+    uint32_t latencyPercentileMs(uint8_t pct) {
+
+        uint32_t total = 0;
+        for (size_t i = 0; i < HIST_BUCKETS; i++) total += histogram[i];
+        if (total == 0) return 0;
+
+        uint32_t target = (total * pct + 99) / 100;
+        uint32_t seen = 0;
+        for (size_t i = 0; i < HIST_BUCKETS; i++) {
+            seen += histogram[i];
+            if (seen >= target) return (uint32_t)(i + 1) * HIST_BUCKET_MS;
+        }
+        return HIST_BUCKETS * HIST_BUCKET_MS;
+    }
+
+    void resetStats() {
+        stats = {};
+        memset(histogram, 0, sizeof(histogram));
+    }
+
+}  // namespace ObdLink
@@ -0,0 +1,192 @@
+#include "obd_pid.h"
+#include <string.h>
+
+// Moduł celowo nie używa Arduino.h - kompiluje się również na hoście
+
+namespace ObdPid {
+
+    static constexpr size_t MAX_RESPONSE_BYTES = 64;
+
+    // Dwa porównania bez znaku zamiast trzech zakresów (wywoływane dla każdego znaku odpowiedzi)
+    static int hexValue(char c) {
+        unsigned digit = (unsigned)(c - '0');
+        if (digit < 10) return (int)digit;
+        unsigned letter = (unsigned)((c | 0x20) - 'a');
+        return letter < 6 ? (int)letter + 10 : -1;
+    }
+
+    uint8_t dataLength(uint8_t pid) {
+
+        switch (pid) {
+            case 0x00: case 0x20: case 0x40: case 0x60:
+            case 0x80: case 0xA0: case 0xC0:
+            case 0x01: case 0x41: case 0x4F: case 0x50:
+            case 0x24: case 0x25: case 0x26: case 0x27:
+            case 0x28: case 0x29: case 0x2A: case 0x2B:
+            case 0x34: case 0x35: case 0x36: case 0x37:
+            case 0x38: case 0x39: case 0x3A: case 0x3B:
+            case 0xA6:
+                return 4;
+            case 0x02: case 0x03: case 0x0C: case 0x10:
+            case 0x14: case 0x15: case 0x16: case 0x17:
+            case 0x18: case 0x19: case 0x1A: case 0x1B:
+            case 0x1F: case 0x21: case 0x22: case 0x23:
+            case 0x31: case 0x32: case 0x3C: case 0x3D:
+            case 0x3E: case 0x3F: case 0x42: case 0x43:
+            case 0x44: case 0x4D: case 0x4E: case 0x54:
+            case 0x55: case 0x56: case 0x57: case 0x58:
+            case 0x59: case 0x5D: case 0x5E:
+                return 2;
+            case 0x04: case 0x05: case 0x06: case 0x07:
+            case 0x08: case 0x09: case 0x0A: case 0x0B:
+            case 0x0D: case 0x0E: case 0x0F: case 0x11:
+            case 0x12: case 0x13: case 0x1C: case 0x1D:
+            case 0x1E: case 0x2C: case 0x2D: case 0x2E:
+            case 0x2F: case 0x30: case 0x33: case 0x45:
+            case 0x46: case 0x47: case 0x48: case 0x49:
+            case 0x4A: case 0x4B: case 0x4C: case 0x51:
+            case 0x52: case 0x5A: case 0x5B: case 0x5C:
+                return 1;
+            default:
+                return 0;
+        }
+    }
+
+    bool buildRequest(const uint8_t* pids, size_t count, char* out, size_t outLen) {
+
+        static const char HEX[] = "0123456789ABCDEF";
+        if (count == 0 || count > MAX_BATCH || outLen < 3 + 2 * count) return false;
+
+        size_t pos = 0;
+        out[pos++] = '0';
+        out[pos++] = '1';
+        for (size_t i = 0; i < count; i++) {
+            out[pos++] = HEX[pids[i] >> 4];
+            out[pos++] = HEX[pids[i] & 0x0F];
+        }
+        out[pos] = '\0';
+        return true;
+    }
+
+    // Sklejenie ramek do tablicy bajtów (pominięcie licznika bajtów i indeksów "N:")
+    size_t collectBytes(const char* response, uint8_t* bytes, size_t maxBytes) {
+
+        size_t n = 0;
+        const char* p = response;
+
+        while (*p) {
+
+            // Linia w jednym przejściu: bajty są zapisywane od razu i wycofywane,
+            // gdy linia nie okazuje się danymi (bez kopiowania linii)
+            size_t lineStart = n;
+            size_t chars = 0;                       // Znaki bez spacji
+            bool colon = false;
+            bool hex = true;
+            bool half = false;
+            int high = 0;
+
+            for (; *p && *p != '\n' && *p != '\r'; p++) {
+
+                char c = *p;
+                if (c == ' ') continue;
+                chars++;
+
+                if (c == ':' && !colon) {           // "0:410D..." -> "410D..."
+                    colon = true;
+                    hex = true;
+                    half = false;
+                    n = lineStart;
+                    continue;
+                }
+
+                int v = hexValue(c);
+                if (v < 0) {
+                    hex = false;
+                } else if (!half) {
+                    high = v;
+                    half = true;
+                } else {
+                    half = false;
+                    if (n < maxBytes) bytes[n++] = (uint8_t)(high << 4 | v);
+                }
+            }
+
+            // Linie tekstowe (SEARCHING..., NO DATA) i licznik bajtów ISO-TP ("00A") - pomijane
+            if (!hex || (!colon && chars == 3)) n = lineStart;
+
+            if (*p) p++;
+        }
+        return n;
+    }
+
+    static Value* findRequested(Value* values, size_t count, uint8_t pid) {
+        for (size_t i = 0; i < count; i++)
+            if (values[i].pid == pid) return &values[i];
+        return nullptr;
+    }
+
+    size_t parseResponse(const char* response, Value* values, size_t count) {
+
+        for (size_t i = 0; i < count; i++) {
+            values[i].valid = false;
+            values[i].len = 0;
+        }
+
+        uint8_t bytes[MAX_RESPONSE_BYTES];
+        size_t n = collectBytes(response, bytes, sizeof(bytes));
+        size_t found = 0;
+        size_t pos = 0;
+        bool inResponse = false;
+
+        while (pos < n) {
+
+            uint8_t b = bytes[pos];
+
+            // Oczekiwany PID z listy zapytania
+            Value* v = inResponse ? findRequested(values, count, b) : nullptr;
+            if (v) {
+                uint8_t len = dataLength(b);
+                if (len == 0 || pos + 1 + len > n) break;
+                if (!v->valid) {
+                    v->valid = true;
+                    v->len = len;
+                    memcpy(v->data, &bytes[pos + 1], len);
+                    found++;
+                }
+                pos += 1 + len;
+                continue;
+            }
+
+            // 0x41 = początek odpowiedzi (kolejne ECU zaczynają od nowa)
+            if (b == 0x41) {
+                inResponse = true;
+                pos++;
+                continue;
+            }
+
+            // Nieoczekiwany bajt (np. 7F 01 12 - odmowa) - koniec parsowania
+            break;
+        }
+        return found;
+    }
+
+    bool BatchProbe::onReply(bool answered, size_t found, size_t count) {
+
+        // Utracona odpowiedź nic nie mówi o ECU
+        if (!answered || current != UNKNOWN) return false;
+
+        if (found == count) {
+            current = YES;
+            return false;
+        }
+        if (found > 0) {
+            rejects = 0;
+            return false;
+        }
+        if (++rejects < limit) return false;
+
+        current = NO;
+        return true;
+    }
+
+}  // namespace ObdPid
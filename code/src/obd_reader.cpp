@@ -1,9 +1,26 @@
 #include <BluetoothSerial.h>
+#include <SD.h>
 
 #include "obd_reader.h"
+#include "gps_reader.h"
 #include "screen_trip.h"
 #include "screen_tariff.h"
 #include "sd_manager.h"
+#include "fare_engine.h"
+#include "obd_pid.h"
+#include "obd_link.h"
+#include "obd_transport.h"
+#include "elm327_emulator.h"
+#include "obd_scheduler.h"
+#include "distance_estimator.h"
+#include "distance_fusion.h"
+#include "fuel_accumulator.h"
+#include "obd_discovery.h"
+#include "obd_connection.h"
+#include "can_monitor.h"
+#include "vehicle_profile.h"
+#include "settings_store.h"
+#include "seqlock.h"
 #include "../cabulator_settings.h"
 
 // Zewnętrzne zmienne globalne z main.cpp i screen_tariff.cpp
@@ -17,298 +34,1069 @@ namespace OBD {
 
 BluetoothSerial SerialBT;
 
-// Status połączenia OBD
-bool btConnected = false;
-bool elmReady = false;
+// Transport do ELM327: Bluetooth SPP lub emulator (cały stos OBD bez pojazdu)
+#if OBD_SIMULATION_MODE
+static uint32_t emulatorNow() { return millis(); }
+static void emulatorSleep(uint32_t ms) { vTaskDelay(pdMS_TO_TICKS(ms)); }
+static Elm327Emulator transport(Elm327Emulator::defaultConfig(emulatorNow, emulatorSleep));
+#else
+static BluetoothTransport transport(SerialBT, OBD_CONFIG::DEVICE_NAME, OBD_CONFIG::DEVICE_MAC_STR);
+#endif
 
-// Wysyłanie komendy do OBD - zwraca odpowiedź w buforze
-bool sendCmd(const char* cmd, char* response, int maxLen, int timeout = 1000) {
+// Stan połączenia: łączenie, uruchomienie ELM327, utrata łącza (tylko task OBD)
+static ObdConnection conn({ OBD_CONFIG::RECONNECT_MIN_MS, OBD_CONFIG::RECONNECT_MAX_MS,
+                            OBD_CONFIG::DEGRADED_TIMEOUTS, OBD_CONFIG::LINK_LOST_TIMEOUTS });
 
-    while (SerialBT.available()) SerialBT.read();
-    SerialBT.print(cmd);
-    SerialBT.print("\r");
-    
-    int idx = 0;
-    unsigned long start = millis();
-    
-    while (millis() - start < timeout && idx < maxLen - 1) {
-
-        if (SerialBT.available()) {
-            
-            char c = SerialBT.read();
-            if (c == '>') break;
-            if (c != '\r' && c != '\n') {  // Ignoruj znaki nowej linii i powrotu 
-                response[idx++] = c;
-            }
-        }
-        vTaskDelay(10 / portTICK_PERIOD_MS);
+// Profil pojazdu (odometr, ramki CAN, paliwo) - ustalany w begin(), potem tylko odczyt
+static VehicleProfile profile;
+
+// Obsługa zapytań z wieloma PID przez ECU (ustalana z odpowiedzi, timeouty pomijane)
+static ObdPid::BatchProbe batchProbe(OBD_CONFIG::BATCH_REJECTS);
+
+// Kopia robocza stanu taska OBD (liczniki, próbki) - publikowana przez seqlock
+static Snapshot state = {};
+static Seqlock<Snapshot> published;
+
+// Żądania innych tasków do taska OBD
+enum RequestType : uint8_t { REQ_WATCH, REQ_REFRESH };
+struct TaskRequest {
+    RequestType type;
+    uint8_t channel;            ///< REQ_REFRESH
+    uint32_t durationMs;        ///< REQ_WATCH
+};
+static QueueHandle_t requests = nullptr;
+
+// Wysyłanie komendy do OBD - zwraca odpowiedź w buforze RX (ObdLink) lub nullptr
+static const char* sendCmd(const char* cmd, uint32_t timeout = 1000) {
+    return ObdLink::transact(cmd, timeout);
+}
+
+// Profil pojazdu z karty SD, przy braku pliku lub błędzie - wbudowany
+static void loadProfile() {
+
+    char err[48];
+    VehicleProfile::compile(VehicleProfile::BUILTIN, profile, err, sizeof(err));
+
+    File f = SD.open(VEHICLE::FILE_PATH, FILE_READ);
+    if (!f) {
+        Serial.printf("[OBD] No vehicle profile file, using built-in %s\n", profile.name);
+        return;
     }
-    
-    response[idx] = '\0';  // Eliminacja pustych znaków na końcu
-    
-    // Usunięcie trailing spaces (spacji na końcu odpowiedzi)
-    while (idx > 0 && response[idx-1] == ' ') {
-        response[--idx] = '\0';
+
+    size_t size = f.size();
+    if (size == 0 || size > (size_t)VEHICLE::FILE_MAX_BYTES) {
+        Serial.printf("[OBD] ERROR: Vehicle profile size %u out of range\n", (unsigned)size);
+        f.close();
+        return;
     }
-    
-    return (idx > 0);
-}
 
-// Inicjalizacja połączenia OBD
-bool init() {
+    char* text = (char*)malloc(size + 1);
+    if (!text) { f.close(); return; }
+    size_t n = f.read((uint8_t*)text, size);
+    f.close();
+    text[n] = '\0';
+
+    VehicleProfile loaded;
+    bool ok = VehicleProfile::compile(text, loaded, err, sizeof(err));
+    free(text);
+
+    if (!ok) {
+        Serial.printf("[OBD] ERROR: %s: %s, using built-in profile\n", VEHICLE::FILE_PATH, err);
+        return;
+    }
+    profile = loaded;
+}
 
 #if OBD_SIMULATION_MODE
+// Ramki rozgłoszeniowe emulatora wg sygnałów profilu (wartości ze skryptu)
+static Elm327Emulator::Broadcast simBroadcasts[VehicleProfile::CAN_COUNT];
+
+// Konfiguracja emulatora ELM327 ze skryptem domyślnym
+static void configureEmulator() {
+
+    uint8_t broadcasts = 0;
+    if (profile.hasCan[VehicleProfile::CAN_SPEED]) {
+        const CanMonitor::Signal& c = profile.can[VehicleProfile::CAN_SPEED];
+        simBroadcasts[broadcasts++] = { c.id, OBD_CONFIG::SIM_CAN_SPEED_MS, "010D", c.start, c.length, 1.0f / c.scale };
+    }
+    if (profile.hasCan[VehicleProfile::CAN_ODOMETER] && profile.odometer.requestLen) {
+        const CanMonitor::Signal& c = profile.can[VehicleProfile::CAN_ODOMETER];
+        simBroadcasts[broadcasts++] = { c.id, OBD_CONFIG::SIM_CAN_ODO_MS, profile.odometer.command,
+                                        c.start, c.length, 1.0f / c.scale };
+    }
+
+    Elm327Emulator::Config cfg = Elm327Emulator::defaultConfig(emulatorNow, emulatorSleep);
+    cfg.latencyMs = OBD_CONFIG::SIM_LATENCY_MS;
+    cfg.jitterMs = OBD_CONFIG::SIM_JITTER_MS;
+    cfg.noisePct = OBD_CONFIG::SIM_NOISE_PCT;
+    cfg.noDataPct = OBD_CONFIG::SIM_NO_DATA_PCT;
+    cfg.dropPct = OBD_CONFIG::SIM_DROP_PCT;
+    cfg.broadcasts = simBroadcasts;
+    cfg.broadcastCount = broadcasts;
+    cfg.busFps = 200;
+    cfg.seed = esp_random();
+    transport.setConfig(cfg);
+    transport.loadScript(Elm327Emulator::DEFAULT_SCRIPT);
+
     Serial.println("\n[OBD] ===== SIMULATION MODE ENABLED =====");
-    Serial.println("[OBD] Module status: SIMULATED");
-    Serial.println("[OBD] Simulating: 100 km/h, 0.8 - 10 L/H");
+    Serial.println("[OBD] Module status: ELM327 EMULATOR");
+    Serial.printf("[OBD] Latency %d+%d ms, noise %d%%, NO DATA %d%%\n",
+                  OBD_CONFIG::SIM_LATENCY_MS, OBD_CONFIG::SIM_JITTER_MS,
+                  OBD_CONFIG::SIM_NOISE_PCT, OBD_CONFIG::SIM_NO_DATA_PCT);
     Serial.println("[OBD] ===================================\n");
-    btConnected = true;
-    elmReady = true;
+}
+#endif
+
+// Przygotowanie modułu - łączenie prowadzi task OBD
+void begin() {
+
+    if (!requests) requests = xQueueCreate(OBD_CONFIG::REQUEST_QUEUE_LEN, sizeof(TaskRequest));
+    ObdLink::begin(transport);     // Odbiór przez handler transportu zamiast pollingu
+    loadProfile();
+    Serial.printf("[OBD] Vehicle profile %s: fuel %s (AFR %.1f, %.3f kg/L), engine %u cm3, odometer %s, CAN signals %d\n",
+                  profile.name, VehicleProfile::fuelLabel(profile.fuel), profile.afr, profile.densityKgL,
+                  profile.displacementCc, profile.odometer.requestLen ? profile.odometer.command : "none",
+                  profile.hasCan[VehicleProfile::CAN_SPEED] + profile.hasCan[VehicleProfile::CAN_ODOMETER]);
+
+#if OBD_SIMULATION_MODE
+    configureEmulator();
+#endif
+
+    state.connection = conn.state();
+    published.write(state);
+}
+
+// Uruchomienie ELM327 sterowane znakiem zachęty; znany pojazd bez wykrywania PID
+static bool startElm() {
+
+    BringUp& bringUp = state.bringUp;
+    ObdDiscovery::Vehicle& vehicle = bringUp.vehicle;
+    if (!Settings::get(Settings::KEY_OBD_VEHICLE, &vehicle, sizeof(vehicle))) memset(&vehicle, 0, sizeof(vehicle));
+
+    uint32_t t0 = millis();
+    bringUp.outcome = ObdDiscovery::bringUp(sendCmd, profile, vehicle);
+    bringUp.durationMs = millis() - t0;
+    bringUp.readyAtMs = millis();
+
+    if (bringUp.outcome == ObdDiscovery::FAILED) {
+        Serial.printf("[OBD] Module CONNECTED ONLY BLUETOOTH (%lu ms)\n", (unsigned long)bringUp.durationMs);
+        return false;
+    }
+
+    if (bringUp.outcome == ObdDiscovery::DISCOVERED && !Settings::put(Settings::KEY_OBD_VEHICLE, &vehicle, sizeof(vehicle)))
+        Serial.println("[OBD] WARNING: Vehicle profile not saved");
+
+    Serial.println("[OBD] Module CONNECTED BLUETOOTH + ELM");
+    Serial.printf("[OBD] Vehicle %s (%s): protocol %X, PIDs %08lX %08lX %08lX, fuel %s, odometer %s\n",
+                  vehicle.vin[0] ? vehicle.vin : "no VIN",
+                  bringUp.outcome == ObdDiscovery::CACHED ? "cached" : "discovered", vehicle.protocol,
+                  (unsigned long)vehicle.supported[0], (unsigned long)vehicle.supported[1],
+                  (unsigned long)vehicle.supported[2], ObdDiscovery::fuelSourceLabel(vehicle.fuelSource),
+                  vehicle.odometer ? "yes" : "no");
+    Serial.printf("[OBD] ELM ready in %lu ms, %lu ms after power-on\n",
+                  (unsigned long)bringUp.durationMs, (unsigned long)bringUp.readyAtMs);
     return true;
+}
 
-#else
-    // Połączenie Bluetooth
-    SerialBT.begin(OBD_CONFIG::DEVICE_NAME, true);
-    uint8_t addr[6];
-    sscanf(OBD_CONFIG::DEVICE_MAC_STR, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx",
-           &addr[0], &addr[1], &addr[2], &addr[3], &addr[4], &addr[5]);
-    
-    bool connected = false;
-    for (int i = 1; i <= 3; i++) {
+BringUp getBringUp() {
+    return published.read().bringUp;
+}
 
-        Serial.printf("[OBD] Module CONNECTING (TRY %d/3)\n", i);
-        if (SerialBT.connect(addr)) {
+ObdConnection::State getConnectionState() {
+    return published.read().connection;
+}
 
-            connected = true;
-            break;
+bool isReady() {
+    ObdConnection::State c = getConnectionState();
+    return c == ObdConnection::READY || c == ObdConnection::DEGRADED;
+}
+
+// Odczyt odometru wg profilu pojazdu - zwraca KM
+static long readOdometer() {
+
+    float km;
+    if (!VehicleProfile::decode(profile.odometer, sendCmd(profile.odometer.command), km) || km < 0.0f)
+        return -1;
+
+    Serial.printf("[ODO] Odometer read: %ld KM\n", (long)km);
+    return (long)km;
+}
+
+static const ObdPid::Value* findPid(const ObdPid::Value* values, size_t count, uint8_t pid) {
+    for (size_t i = 0; i < count; i++)
+        if (values[i].pid == pid && values[i].valid) return &values[i];
+    return nullptr;
+}
+
+// Spalanie [L/h] ze źródła wykrytego dla pojazdu (< 0 = brak danych)
+static float fuelRate(const ObdPid::Value* values, size_t count) {
+
+    const ObdPid::Value* v;
+    switch (state.bringUp.vehicle.fuelSource) {
+
+        case ObdDiscovery::FUEL_RATE:
+            v = findPid(values, count, ObdPid::PID_FUEL_RATE);
+            return v ? ObdPid::fuelRateLph(*v) : -1.0f;
+
+        case ObdDiscovery::FUEL_MAP_RPM: {
+            const ObdPid::Value* map = findPid(values, count, ObdPid::PID_MAP);
+            const ObdPid::Value* rpm = findPid(values, count, ObdPid::PID_RPM);
+            const ObdPid::Value* iat = findPid(values, count, ObdPid::PID_INTAKE_TEMP);
+            if (!map || !rpm) return -1.0f;
+            int intakeC = iat ? ObdPid::intakeTempC(*iat) : 25;     // Bez 010F - temperatura typowa
+            return profile.fuelLph(profile.airGs(ObdPid::mapKpa(*map), ObdPid::rpm(*rpm), intakeC));
         }
 
-        vTaskDelay(1000 / portTICK_PERIOD_MS);
+        default:
+            v = findPid(values, count, ObdPid::PID_MAF);
+            return v ? profile.fuelLph(ObdPid::mafGs(*v)) : -1.0f;
     }
-    
-    if (!connected) {
+}
 
-        Serial.println("[OBD] Module NOT CONNECTED");
-        btConnected = false;
-        elmReady = false;
-        return false;
+// Pojedyncze zapytanie Mode 01 (jeden lub kilka PID); arrivedMs[i] = nadejście odpowiedzi z PID,
+// answered = odpowiedź zakończona znakiem zachęty (nie timeout)
+static size_t requestPids(ObdPid::Value* values, uint32_t* arrivedMs, size_t count, bool* answered = nullptr) {
+
+    uint8_t pids[ObdPid::MAX_BATCH];
+    for (size_t i = 0; i < count; i++) pids[i] = values[i].pid;
+
+    char cmd[3 + 2 * ObdPid::MAX_BATCH + 1];
+    if (!ObdPid::buildRequest(pids, count, cmd, sizeof(cmd))) return 0;
+
+    state.counters.requests++;
+    uint32_t timeoutsBefore = ObdLink::getStats().timeouts;
+    const char* resp = sendCmd(cmd);
+    uint32_t arrived = millis();
+    if (answered) *answered = resp && ObdLink::getStats().timeouts == timeoutsBefore;
+
+    // Wywoływane tylko dla PID jeszcze nieodczytanych - każdy ważny pochodzi z tej odpowiedzi
+    size_t found = ObdPid::parseResponse(resp ? resp : "", values, count);
+    for (size_t i = 0; i < count; i++)
+        if (values[i].valid) arrivedMs[i] = arrived;
+    return found;
+}
+
+// Odczyt kilku PID Mode 01: paczki po MAX_BATCH, brakujące pojedynczo
+static bool readPids(ObdPid::Value* values, uint32_t* arrivedMs, size_t count) {
+
+    size_t found = 0;
+    state.counters.pidsRequested += count;
+
+    for (size_t first = 0; first < count; first += ObdPid::MAX_BATCH) {
+
+        ObdPid::Value* chunk = values + first;
+        uint32_t* chunkMs = arrivedMs + first;
+        size_t n = min(count - first, ObdPid::MAX_BATCH);
+        size_t got = 0;
+
+        // Zapytanie zbiorcze, o ile ECU go nie odrzuciło wcześniej
+        if (n > 1 && batchProbe.enabled()) {
+
+            bool answered;
+            got = requestPids(chunk, chunkMs, n, &answered);
+            if (batchProbe.onReply(answered, got, n))
+                Serial.println("[OBD] Multi-PID requests not supported, using single requests");
+        }
+
+        // Fallback: brakujące PID pojedynczo
+        if (got < n) {
+            if (n > 1) state.counters.fallbacks++;
+            for (size_t i = 0; i < n; i++) {
+                if (chunk[i].valid) continue;
+                got += requestPids(&chunk[i], &chunkMs[i], 1);
+            }
+        }
+        found += got;
     }
-    
-    // Inicjalizacja ELM327
-    char resp[128];
-    vTaskDelay(500 / portTICK_PERIOD_MS);
-    sendCmd("ATZ", resp, sizeof(resp), 2000);
-    vTaskDelay(500 / portTICK_PERIOD_MS);
-    sendCmd("ATE0", resp, sizeof(resp), 500);
-    sendCmd("ATL0", resp, sizeof(resp), 500);
-    sendCmd("ATS0", resp, sizeof(resp), 500);
-    sendCmd("ATH0", resp, sizeof(resp), 500);
-    sendCmd("ATSP6", resp, sizeof(resp), 1000);
-    sendCmd("0100", resp, sizeof(resp), 3000);
-    
-    if (strstr(resp, "41") != NULL) {
 
-        Serial.println("[OBD] Module CONNECTED BLUETOOTH + ELM");
-        btConnected = true;
-        elmReady = true;
-        return true;
+    state.counters.pidsRead += found;
+    return found == count;
+}
 
-    } else {
+// Obliczenie kosztu przejazdu
+float calculateCost() {
 
-        Serial.println("[OBD] Module CONNECTED ONLY BLUETOOTH");
-        btConnected = true;
-        elmReady = false;
-        return false;
+    return Fare::snapshot().dueGr / 100.0f;
+}
+
+// =============================================================================
+// HARMONOGRAM ODPYTYWANIA
+// =============================================================================
+
+// Kanały w kolejności enum Channel (indeks kanału == wartość enum)
+static ObdScheduler scheduler(OBD_CONFIG::LINK_UTIL_PCT);
+static uint8_t channelPid[CH_COUNT] = { ObdPid::PID_MAF, ObdPid::PID_SPEED, ObdScheduler::NO_PID };
+static const char* const channelName[CH_COUNT] = { "MAF", "SPEED", "ODO" };
+
+static const uint16_t channelStaleMs[CH_COUNT] = {
+    OBD_CONFIG::MAF_STALE_MS, OBD_CONFIG::SPEED_STALE_MS, OBD_CONFIG::ODO_STALE_MS
+};
+
+// PID kanału paliwa dla wykrytego źródła (MAP/RPM: MAP, pozostałe PID dołączane w execute)
+static uint8_t fuelPid() {
+
+    switch (state.bringUp.vehicle.fuelSource) {
+        case ObdDiscovery::FUEL_RATE: return ObdPid::PID_FUEL_RATE;
+        case ObdDiscovery::FUEL_MAP_RPM: return ObdPid::PID_MAP;
+        default: return ObdPid::PID_MAF;
     }
+}
 
-#endif
+static void setupScheduler() {
+
+    scheduler.addChannel({ channelPid[CH_MAF], OBD_CONFIG::MAF_PERIOD_MS,
+                           OBD_CONFIG::MAF_STALE_MS, OBD_CONFIG::MAF_PRIORITY });
+    scheduler.addChannel({ ObdPid::PID_SPEED, OBD_CONFIG::SPEED_PERIOD_MS,
+                           OBD_CONFIG::SPEED_STALE_MS, OBD_CONFIG::SPEED_PRIORITY });
+    scheduler.addChannel({ ObdScheduler::NO_PID, OBD_CONFIG::ODO_PERIOD_MS,
+                           OBD_CONFIG::ODO_STALE_MS, OBD_CONFIG::ODO_PRIORITY });
 }
 
-// Odczyt odometru - zwraca KM
-long readOdometer() {
+// =============================================================================
+// NASŁUCH RAMEK CAN
+// =============================================================================
 
-#if OBD_SIMULATION_MODE
-    // Symulacja opóźnienia (jak rzeczywisty ELM327)
-    vTaskDelay(600 / portTICK_PERIOD_MS);
-    // Symulacja: prędkość 50 km/h = 28 metrów co 2 sekundy
-        static long simulatedOdoKiloMeters = 50000; // 50tys przebiegu startowego
-        static unsigned long lastIncMs = 0;
-        unsigned long now = millis();
-        if (lastIncMs == 0) lastIncMs = now;
-        if (now - lastIncMs >= 36000) {
-            simulatedOdoKiloMeters += 1; // +1 km co 36 sekundy (100 km/h)
-            lastIncMs += 36000;
+// Stan nasłuchu - ustalany od nowa po każdym uruchomieniu ELM327
+enum MonitorState : uint8_t { MON_OFF, MON_PROBE, MON_ACTIVE, MON_UNSUPPORTED };
+static const char* const monitorLabel[] = { "off", "probing", "active", "unsupported" };
+
+static CanMonitor monitor;
+static int monitorSignal[CH_COUNT] = { -1, -1, -1 };   // Indeks sygnału CanMonitor dla kanału
+static MonitorState monitorState = MON_OFF;
+static uint32_t monitorSilentMs = 0;                    // Czas nasłuchu bez ramek sygnałów
+static char monitorFilter[12] = "ATCRA";                // ATCRA + wzorzec identyfikatorów sygnałów
+
+// Odbiór strumienia ATMA (kontekst handlera transportu)
+static void onMonitorData(const uint8_t* data, size_t size) {
+    monitor.feed(data, size, millis());
+}
+
+static void setupMonitor() {
+
+    if (profile.hasCan[VehicleProfile::CAN_SPEED])
+        monitorSignal[CH_SPEED] = monitor.addSignal(profile.can[VehicleProfile::CAN_SPEED]);
+    if (profile.hasCan[VehicleProfile::CAN_ODOMETER])
+        monitorSignal[CH_ODOMETER] = monitor.addSignal(profile.can[VehicleProfile::CAN_ODOMETER]);
+    monitor.filterPattern(monitorFilter + 5, sizeof(monitorFilter) - 5);
+}
+
+// Kanały wg pojazdu po każdym uruchomieniu ELM327 (po ponownym łączeniu może to być inny pojazd)
+static void applyVehicle() {
+
+    channelPid[CH_MAF] = fuelPid();
+
+    // Kanały, których pojazd nie obsługuje, nie zajmują łącza
+    const ObdDiscovery::Vehicle& vehicle = state.bringUp.vehicle;
+    batchProbe.reset();
+    if (vehicle.version == ObdDiscovery::FORMAT_VERSION) {
+        scheduler.setEnabled(CH_MAF, vehicle.fuelSource != ObdDiscovery::FUEL_NONE);
+        scheduler.setEnabled(CH_SPEED, ObdDiscovery::isSupported(vehicle, ObdPid::PID_SPEED));
+        scheduler.setEnabled(CH_ODOMETER, vehicle.odometer);
+    }
+
+    // Nasłuch tylko na CAN 11 bit (ATSP 6 / 8)
+    monitorSilentMs = 0;
+    if (!OBD_CONFIG::MONITOR_MODE || monitor.signalCount() == 0) monitorState = MON_OFF;
+    else if (vehicle.protocol == 6 || vehicle.protocol == 8) monitorState = MON_PROBE;
+    else {
+        monitorState = MON_UNSUPPORTED;
+        Serial.printf("[CAN] Protocol %X is not CAN 11-bit, monitor mode disabled\n", vehicle.protocol);
+    }
+}
+
+// PID zapytania dla kanału (paliwo metodą MAP/RPM = kilka PID)
+static size_t channelPids(uint8_t channel, uint8_t* out) {
+
+    size_t n = 0;
+    out[n++] = channelPid[channel];
+    const ObdDiscovery::Vehicle& vehicle = state.bringUp.vehicle;
+    if (channel == CH_MAF && vehicle.fuelSource == ObdDiscovery::FUEL_MAP_RPM) {
+        out[n++] = ObdPid::PID_RPM;
+        if (ObdDiscovery::isSupported(vehicle, ObdPid::PID_INTAKE_TEMP)) out[n++] = ObdPid::PID_INTAKE_TEMP;
+    }
+    return n;
+}
+
+// Zapis wyniku odczytu kanału (nieudany odczyt zachowuje poprzednią wartość)
+static void storeSample(uint8_t channel, bool ok, float value, uint32_t now) {
+
+    Sample& s = state.samples[channel];
+    if (ok) {
+        s.value = value;
+        s.timestampMs = now;
+        s.quality = Q_OK;
+    } else if (s.quality != Q_NONE) {
+        s.quality = Q_FAILED;
+    }
+}
+
+// Publikacja kopii roboczej dla pozostałych tasków
+static void publish(uint32_t now) {
+
+    for (uint8_t ch = 0; ch < CH_COUNT; ch++)
+        scheduler.channelStats(ch, now, state.channels[ch]);
+    state.link = scheduler.linkStats();
+    state.connection = conn.state();
+    state.connectionStats = conn.stats();
+    state.monitoring = monitorState == MON_ACTIVE;
+    state.monitor = monitor.stats();
+    state.publishedMs = now;
+    state.version++;
+    published.write(state);
+}
+
+// Okno nasłuchu w wolnym czasie łącza; req/ok = kanały z nowymi próbkami. Zwraca false bez odpowiedzi adaptera
+static bool listen(uint32_t windowMs, ObdScheduler::Request& req, bool* ok) {
+
+    req.count = 0;
+
+    // Nagłówki (identyfikator ramki) i filtr tylko na czas nasłuchu - odpowiedzi ECU bez zmian
+    if (!sendCmd("ATH1") || !sendCmd(monitorFilter)) return false;
+    CanMonitor::Stats before = monitor.stats();
+    bool answered = ObdLink::stream("ATMA", onMonitorData, windowMs, 1000);
+    answered = sendCmd("ATCRA") && answered;
+    answered = sendCmd("ATH0") && answered;
+    CanMonitor::Stats after = monitor.stats();
+
+    if (after.rejected > before.rejected) {
+        monitorState = MON_UNSUPPORTED;
+        Serial.println("[CAN] Adapter does not support ATMA, polling speed and odometer");
+        return answered;
+    }
+
+    for (uint8_t ch = 0; ch < CH_COUNT; ch++) {
+        float value;
+        uint32_t sampleMs;
+        if (monitorSignal[ch] < 0 || !monitor.take(monitorSignal[ch], value, sampleMs)) continue;
+        storeSample(ch, true, value, sampleMs);
+        scheduler.supply(ch, sampleMs);
+        req.channels[req.count] = ch;
+        ok[req.count++] = true;
+    }
+
+    if (req.count > 0) {
+        monitorSilentMs = 0;
+        if (monitorState == MON_PROBE) {
+            monitorState = MON_ACTIVE;
+            Serial.printf("[CAN] Monitor mode active (%s)\n", monitorFilter);
         }
-        return simulatedOdoKiloMeters;
-#else
-    char resp[64];
-    if (!sendCmd(CarPID::ODOMETER, resp, sizeof(resp))) {
-        return -1;
+    } else if ((monitorSilentMs += windowMs) >= (uint32_t)OBD_CONFIG::MONITOR_PROBE_MS) {
+        monitorState = MON_UNSUPPORTED;
+        Serial.printf("[CAN] No broadcast frames in %lu ms (%lu frames seen), polling speed and odometer\n",
+                      (unsigned long)monitorSilentMs, (unsigned long)after.frames);
+    }
+    return answered;
+}
+
+// Wykonanie zapytania wybranego przez harmonogram (ok[i] dla req.channels[i])
+static void execute(const ObdScheduler::Request& req, bool* ok) {
+
+    if (req.channels[0] == CH_ODOMETER) {
+        long km = readOdometer();
+        ok[0] = km >= 0;
+        storeSample(CH_ODOMETER, ok[0], (float)km, millis());
+        return;
     }
-        
-    // Wyszukanie prefiksu odpowiedzi
-    char* p = strstr(resp, CarPID::ODOMETER_RESP_PREFIX);
-    if (p != NULL && strlen(p) >= 12) {
-
-        // Wyciągnięcie 6 bajtów hex odpowiedzi
-        char hexStr[7];
-        strncpy(hexStr, p + 6, 6);
-        hexStr[6] = '\0';
-        
-        long kilometers = strtol(hexStr, NULL, 16);
-        
-        if (kilometers >= 1000 && kilometers < 999999999) {
-
-            Serial.printf("[ODO] Odometer read: %ld KM\n", kilometers);
-            return kilometers;
+
+    // PID wszystkich kanałów zapytania (owner = indeks kanału w req)
+    ObdPid::Value values[ObdPid::MAX_BATCH];
+    uint8_t owner[ObdPid::MAX_BATCH];
+    size_t n = 0;
+    for (size_t i = 0; i < req.count; i++) {
+        uint8_t pids[3];
+        size_t k = channelPids(req.channels[i], pids);
+        for (size_t j = 0; j < k && n < ObdPid::MAX_BATCH; j++) {
+            values[n] = { pids[j], false, 0, {} };
+            owner[n++] = (uint8_t)i;
         }
     }
-    return -1; // Błąd odczytu
+    uint32_t arrivedMs[ObdPid::MAX_BATCH] = { 0 };
+    readPids(values, arrivedMs, n);
 
-#endif
+    uint32_t now = millis();
+    for (size_t i = 0; i < req.count; i++) {
+
+        // Wartość z PID tego kanału; czas próbki = nadejście ostatniej odpowiedzi z jej PID
+        ObdPid::Value own[3];
+        size_t k = 0;
+        uint32_t sampledMs = 0;
+        bool stamped = false;
+        for (size_t j = 0; j < n; j++) {
+            if (owner[j] != i || k >= 3) continue;
+            own[k++] = values[j];
+            if (values[j].valid && (!stamped || (int32_t)(arrivedMs[j] - sampledMs) > 0)) {
+                sampledMs = arrivedMs[j];
+                stamped = true;
+            }
+        }
+
+        float value = -1.0f;
+        if (req.channels[i] == CH_MAF) value = fuelRate(own, k);
+        else if (req.channels[i] == CH_SPEED && k && own[0].valid) value = ObdPid::speedKmh(own[0]);
+
+        ok[i] = value >= 0;
+        storeSample(req.channels[i], ok[i], value, ok[i] && stamped ? sampledMs : now);
+    }
 }
 
-// Odczyt spalania przez MAF - zwraca L/h
-float readFuelRate() {
+Snapshot getSnapshot() {
 
-#if OBD_SIMULATION_MODE
-    // Symulacja opóźnienia (jak rzeczywisty ELM327)
-    vTaskDelay(500 / portTICK_PERIOD_MS);
-    // Symulacja spalania: losowo od 0.8 do 10 L/h
-    float minL = 0.8f, maxL = 10.0f;
-    float rand01 = (float)rand() / (float)RAND_MAX;
-    float fuel = minL + (maxL - minL) * rand01;
-    return fuel;
+    Snapshot snap = published.read();
 
-#else
-    char resp[64];
-    if (!sendCmd(CarPID::MAF, resp, sizeof(resp))) {
-        return -1.0f;
+    // Wiek próbek rośnie także między publikacjami
+    uint32_t now = millis();
+    uint32_t since = now - snap.publishedMs;
+    for (uint8_t ch = 0; ch < CH_COUNT; ch++) {
+
+        Sample& s = snap.samples[ch];
+        if (s.quality != Q_NONE && now - s.timestampMs > channelStaleMs[ch]) s.quality = Q_STALE;
+
+        ObdScheduler::ChannelStats& cs = snap.channels[ch];
+        if (cs.ageMs != UINT32_MAX) {
+            cs.ageMs += since;
+            cs.stale = cs.ageMs > channelStaleMs[ch];
+        }
     }
-        
-    // Szukanie prefiksu odpowiedzi
-    char* p = strstr(resp, CarPID::MAF_RESP_PREFIX);
-    if (p != NULL && strlen(p) >= 8) {
-        // Wyciągnij 2 bajty hex
-        char byteA[3], byteB[3];
-        strncpy(byteA, p + 4, 2); byteA[2] = '\0';
-        strncpy(byteB, p + 6, 2); byteB[2] = '\0';
-        
-        int a = strtol(byteA, NULL, 16);
-        int b = strtol(byteB, NULL, 16);
-        float maf = ((a * 256) + b) / 100.0f;
-        
-        float afr = 14.7f;
-        float dens = 0.755f;
-        float fuelRate = (maf / afr / dens) * 3.6f;
-        Serial.printf("[FUEL] Fuel rate: %.2f L/H\n", fuelRate);
-        return fuelRate;
+    return snap;
+}
+
+// Wartość w terminie (także gdy ostatnia próba się nie udała)
+static bool usable(const Sample& s) {
+    return s.quality == Q_OK || s.quality == Q_FAILED;
+}
+
+Latest getLatest() {
+
+    Snapshot snap = getSnapshot();
+    const Sample& odo = snap.samples[CH_ODOMETER];
+    const Sample& maf = snap.samples[CH_MAF];
+    const Sample& speed = snap.samples[CH_SPEED];
+
+    Latest l;
+    l.odometerKm = usable(odo) ? lroundf(odo.value) : -1;
+    l.fuelLph = usable(maf) ? maf.value : -1.0f;
+    l.speedKmh = usable(speed) ? (int)speed.value : -1;
+    return l;
+}
+
+Stats getStats() {
+    return published.read().counters;
+}
+
+bool getChannelStats(Channel channel, ObdScheduler::ChannelStats& out) {
+
+    if (channel >= CH_COUNT) return false;
+    out = getSnapshot().channels[channel];
+    return true;
+}
+
+ObdScheduler::LinkStats getLinkStats() {
+    return published.read().link;
+}
+
+TripDistance getTripDistance() {
+    return published.read().trip;
+}
+
+float divergencePct(const TripDistance& trip) {
+
+    if (trip.obdMm < (uint32_t)GPS::ODO_CHECK_MIN_M * 1000) return 0.0f;
+    return ((float)trip.gpsMm - (float)trip.obdMm) * 100.0f / (float)trip.obdMm;
+}
+
+// Wysłanie żądania do taska OBD (bez czekania na miejsce w kolejce)
+static bool post(const TaskRequest& r) {
+    return requests && xQueueSend(requests, &r, 0) == pdTRUE;
+}
+
+bool requestWatch(uint32_t durationMs) {
+    return post({ REQ_WATCH, 0, durationMs });
+}
+
+bool requestRefresh(Channel channel) {
+    return channel < CH_COUNT && post({ REQ_REFRESH, (uint8_t)channel, 0 });
+}
+
+// Oczekiwanie do waitMs na żądania; obsługuje wszystkie oczekujące
+static void serveRequests(uint32_t waitMs, uint32_t& watchUntil) {
+
+    if (!requests) {
+        vTaskDelay(pdMS_TO_TICKS(waitMs));
+        return;
     }
-    return -1.0f; // Błąd odczytu
 
-#endif
+    TaskRequest r;
+    TickType_t ticks = pdMS_TO_TICKS(waitMs);
+    while (xQueueReceive(requests, &r, ticks) == pdTRUE) {
+
+        ticks = 0;      // Po pierwszym żądaniu tylko opróżnienie kolejki
+        if (r.type == REQ_WATCH) {
+            uint32_t until = millis() + r.durationMs;
+            if ((int32_t)(until - watchUntil) > 0) watchUntil = until;
+        } else if (r.type == REQ_REFRESH) {
+            scheduler.expedite(r.channel);
+        }
+    }
 }
 
-// Obliczenie kosztu przejazdu
-float calculateCost() {
+const char* channelLabel(Channel channel) {
+    return channel < CH_COUNT ? channelName[channel] : "?";
+}
 
-    if (tariffMode == TARIFF_PER_KM) 
-        return distanceTraveled * tariffValue;
-    else 
-        return fuelUsed * tariffValue;
-    
+// Wykonanie akcji połączenia (łączenie, uruchomienie ELM327) - false gdy ECU nie jest odpytywane
+static bool serveConnection(uint32_t& watchUntil) {
+
+    uint32_t waitMs;
+    switch (conn.step(millis(), waitMs)) {
+
+        case ObdConnection::ACT_WAIT:
+            serveRequests(min(waitMs, (uint32_t)OBD_CONFIG::IDLE_POLL_MS), watchUntil);
+            return false;
+
+        case ObdConnection::ACT_CONNECT: {
+            Serial.printf("[OBD] Module CONNECTING (attempt %lu)\n", (unsigned long)conn.stats().attempts);
+            bool ok = transport.connect();
+            conn.onConnectResult(ok, millis());
+            if (!ok) Serial.printf("[OBD] Module NOT CONNECTED, retry in %lu ms\n", (unsigned long)conn.stats().backoffMs);
+            return false;
+        }
+
+        case ObdConnection::ACT_INIT: {
+            bool ok = startElm();
+            if (ok) applyVehicle();
+            conn.onInitResult(ok, millis());
+            if (!ok) Serial.printf("[OBD] ELM init retry in %lu ms\n", (unsigned long)conn.stats().backoffMs);
+            return false;
+        }
+
+        default:
+            // Zerwane Bluetooth wykrywane od razu, bez czekania na timeouty zapytań
+            if (!transport.connected()) {
+                conn.onTransportLost(millis());
+                return false;
+            }
+            return true;
+    }
+}
+
+// =============================================================================
+// DYSTANS DO ROZLICZENIA - FUZJA OBD / GPS, KONTROLA DYSTANSU OBD
+// =============================================================================
+
+static DistanceFusion::Config fusionConfig() {
+
+    DistanceFusion::Config c;
+    c.accelSigma = OBD_CONFIG::FUSION_ACCEL_MMS2 / 1000.0f;
+    c.obdSpeedSigma = OBD_CONFIG::FUSION_OBD_SPEED_MMS / 1000.0f;
+    c.gpsSpeedSigma = OBD_CONFIG::FUSION_GPS_SPEED_MMS / 1000.0f;
+    c.gpsPositionSigma = OBD_CONFIG::FUSION_GPS_POSITION_MM / 1000.0f;
+    c.gpsWindowM = OBD_CONFIG::FUSION_GPS_WINDOW_M;
+    c.odoTickSigma = OBD_CONFIG::FUSION_ODO_TICK_MM / 1000.0f;
+    c.scaleSigma = OBD_CONFIG::FUSION_SCALE_SIGMA_PPM / 1e6f;
+    c.scaleDrift = OBD_CONFIG::FUSION_SCALE_DRIFT_PPM / 1e6f;
+    c.gateSigma = OBD_CONFIG::FUSION_GATE_SIGMA;
+    c.stationaryMmS = GPS::ODO_STATIONARY_MMS;
+    c.blindMs = OBD_CONFIG::FUSION_BLIND_MS;
+    c.gpsGapMs = GPS::ODO_DOPPLER_WINDOW_MS;
+    c.maxHdop = GPS::ODO_MAX_HDOP;
+    c.minSats = GPS::ODO_MIN_SATS;
+    return c;
+}
+
+// Stan tylko taska OBD; liczniki trasy w state.trip
+static DistanceFusion fusion(fusionConfig());
+static uint32_t fusionVersion = 0;      // GPS::version() ostatnio przeczytanej próbki
+static uint32_t fusionEpochMs = 0;      // Fix::epochMs ostatnio przekazanej epoki
+static uint32_t fusionLastMm = 0;       // fusion.distanceMm() przy poprzedniej próbce
+static uint32_t fusionStartCycles = 0;
+static uint32_t fusionMaxCycles = 0;    // Najdłuższa aktualizacja filtru [cykle CPU]
+static uint32_t fusionOverBudget = 0;   // Aktualizacje dłuższe niż FUSION_BUDGET_CYCLES
+static uint32_t gpsLastMm = 0;          // GPS::Fix::odometerMm przy poprzedniej próbce
+static bool gpsLastLive = false;        // Czy poprzednia próbka miała ważny fix
+static uint32_t gpsOutageMm = 0;        // Dystans naliczony w bieżącej przerwie łącza (log)
+
+// Pomiar kosztu aktualizacji filtru (koszt ma być stały - przekroczenia w logu [FUSION])
+static inline void fusionBegin() {
+    fusionStartCycles = ESP.getCycleCount();
+}
+
+static void fusionEnd() {
+
+    uint32_t cycles = ESP.getCycleCount() - fusionStartCycles;
+    if (cycles > fusionMaxCycles) fusionMaxCycles = cycles;
+    if (cycles > (uint32_t)OBD_CONFIG::FUSION_BUDGET_CYCLES) fusionOverBudget++;
+}
+
+// Nowa epoka pozycji GPS do filtru (raz na epokę - Fix publikowany jest po każdym zdaniu)
+static void fuseGps() {
+
+    uint32_t version = GPS::version();
+    if (version == fusionVersion) return;
+    fusionVersion = version;
+
+    GPS::Fix fix = GPS::latest();
+    if (fix.epochMs == fusionEpochMs) return;
+    fusionEpochMs = fix.epochMs;
+
+    fusionBegin();
+    fusion.addGps(fix.epochMs, fix.valid, fix.valid ? (int32_t)fix.speedMmS : -1,
+                  fix.odometerMm, fix.hdop, fix.sats);
+    fusionEnd();
+}
+
+// Przyrost dystansu do rozliczenia od poprzedniej próbki (filtr przewidziany do chwili now)
+static uint32_t fusionStep(uint32_t now) {
+
+    fuseGps();
+    fusionBegin();
+    fusion.advance(now);
+    fusionEnd();
+
+    uint32_t step = fusion.distanceMm() - fusionLastMm;
+    fusionLastMm = fusion.distanceMm();
+    return step;
+}
+
+// Prędkość do rozliczenia postoju, -1 gdy filtr nie ma pomiarów
+static int16_t fusionSpeedKmh() {
+
+    float kmh = fusion.speedKmh();
+    return kmh < 0.0f ? -1 : (int16_t)(kmh + 0.5f);
+}
+
+// Przyrost dystansu GPS od poprzedniej próbki; live = ważny fix na obu końcach
+static uint32_t gpsStep(bool& live) {
+
+    GPS::Fix fix = GPS::latest();
+    uint32_t step = fix.odometerMm - gpsLastMm;     // Licznik przekręca się - różnica bez znaku
+    gpsLastMm = fix.odometerMm;
+    live = fix.valid && gpsLastLive;
+    gpsLastLive = fix.valid;
+    return step;
+}
+
+// Start naliczania (także po pauzie) - filtr od nowa, pierwsze pomiary OBD z bieżącej próbki
+static void fusionRestart(uint32_t odoMs, long odometerKm, uint32_t speedMs, int speedKmh) {
+
+    fusion.reset();
+    fusionVersion = 0;
+    fusionEpochMs = 0;
+    fusionLastMm = 0;
+    fusionBegin();
+    fusion.addOdometer(odoMs, odometerKm);
+    fusion.addObdSpeed(speedMs, speedKmh);
+    fusionEnd();
+
+    bool live;
+    gpsStep(live);
+}
+
+// Kontrola zgodności: przyrost DistanceEstimator (sam OBD) i dystansu z pozycji, gdy oba są znane
+static void gpsCheck(uint32_t obdMm) {
+
+    bool live;
+    uint32_t gpsMm = gpsStep(live);
+    if (live) {
+        state.trip.obdMm += obdMm;
+        state.trip.gpsMm += gpsMm;
+    }
+}
+
+// Próbka w przerwie łącza: filtr z samego GPS (Doppler, pozycja), speedKmh = -1 bez fixu
+static uint32_t gpsFallback(uint32_t now, int16_t& speedKmh) {
+
+    uint32_t mm = fusionStep(now);
+    speedKmh = fusionSpeedKmh();
+
+    // Licznik GPS dalej, żeby przerwa nie weszła do kontroli zgodności po powrocie łącza
+    bool live;
+    gpsStep(live);
+
+    gpsOutageMm += mm;
+    state.trip.fallbackMm += mm;
+    return mm;
+}
+
+static void logTripDistance() {
+
+    const TripDistance& t = state.trip;
+    Serial.printf("[DIST] Trip: OBD %lu m, GPS %lu m (divergence %+.1f%%), %lu m from GPS in %lu link outages\n",
+                  (unsigned long)(t.obdMm / 1000), (unsigned long)(t.gpsMm / 1000), divergencePct(t),
+                  (unsigned long)(t.fallbackMm / 1000), (unsigned long)t.outages);
 }
 
 // Task OBD uruchomiony w tle (FreeRTOS)
 void task(void* param) {
 
-    static float lastOdo = -1.0f;
-    static unsigned long lastMillis = 0;
-    static unsigned long lastSDUpdate = 0;  // Timer dla zapisu na SD co 10 sekund
+    setupScheduler();
+    setupMonitor();
+    bool polling = false;
+    uint32_t watchUntil = millis();
+    ObdConnection::State lastConnection = conn.state();
+
+    // Stan naliczania przejazdu
+    bool fareRunning = false;
+    bool fareResumed = false;       // Pierwsza próbka po powrocie łącza - bez przyrostu za przerwę
+    static DistanceEstimator distance;
+    static FuelAccumulator fuel(OBD_CONFIG::FUEL_GAP_MS, OBD_CONFIG::FUEL_MAX_GAP_MS);
+    uint32_t lastDistanceMm = 0;
+    uint64_t lastFuelUl = 0;
+    uint32_t lastFareMs = 0;
+    uint32_t lastSDUpdate = 0;
+    bool tripSeen = false;
     
     while (true) {
-        if (tripActive) {
-
-            // Odczyt odometru
-            long odoRaw = readOdometer();
-            float dist = (odoRaw >= 0) ? (float)odoRaw : -1.0f;
-            Serial.printf("[OBD_TASK] odoRaw=%ld, dist=%.2f\n", odoRaw, dist);
-            
-            // Odczyt paliwa
-            float fuel = readFuelRate();
-            Serial.printf("[OBD_TASK] fuel=%.2f\n", fuel);
-            
-            // LICZENIE tylko gdy nie zapauzowany
-            if (!tripPaused) {
-
-                unsigned long now = millis();
-                
-                // Inicjalizacja przy pierwszym odczycie
-                if (lastMillis == 0 && dist >= 0 && fuel >= 0) {
-
-                    lastMillis = now;
-                    lastOdo = dist;
-                    lastSDUpdate = now;
-                }
 
-                // Obliczanie przyrostów
-                else if (lastMillis > 0 && dist >= 0) {
-                    
-                    float hours = (now - lastMillis) / 3600000.0f;
-                    
-                    // Dystans
-                    float deltaDist = max(0.0f, dist - lastOdo);
-                    if (deltaDist > 0.0001f) {
-                        distanceTraveled += deltaDist;
-                    }
-                    lastOdo = dist;
-                    
-                    // Paliwo
-                    if (fuel >= 0 && hours > 0) {
-                        float fuelDelta = fuel * hours;
-                        fuelUsed += fuelDelta;
-                    }
-                    
-                    lastMillis = now;
-
-                    // ========== ZAPIS NA SD CO 10 SEKUND ==========
-                    if (now - lastSDUpdate >= 10000) {
-
-                        if (SDManager::isReady() && !currentTripPath.isEmpty()) {
-                            SDManager::TripUpdateData updateData;
-                            updateData.distanceKm = distanceTraveled;
-                            updateData.fuelUsedLiters = fuelUsed;
-                            updateData.timestamp = now;
-
-                            // Obliczenie całkowitego kosztu
-                            int startedKm = (int)distanceTraveled + 1;
-                            if (tariffMode == TARIFF_PER_KM)
-                                updateData.totalCost = startedKm * tariffValue;
-                            else
-                                updateData.totalCost = fuelUsed * tariffValue;
-
-                            SDManager::onTripUpdate(updateData);
-                        }
-                        lastSDUpdate = now;
-                    }
+        // Granice trasy: liczniki dystansu OBD / GPS od nowa, na końcu podsumowanie na Serial
+        if (tripActive != tripSeen) {
+            tripSeen = tripActive;
+            if (tripActive) state.trip = {};
+            else logTripDistance();
+        }
+
+        bool online = serveConnection(watchUntil);
+
+        // Zmiana stanu połączenia: publikacja dla UI, po utracie łącza odpytywanie od nowa
+        if (conn.state() != lastConnection) {
+
+            ObdConnection::Stats cs = conn.stats();
+            Serial.printf("[OBD] Link %s -> %s (%lu losses)\n", ObdConnection::label(lastConnection),
+                          ObdConnection::label(conn.state()), (unsigned long)cs.linkLosses);
+            lastConnection = conn.state();
+
+            if (!conn.online() && polling) {
+                polling = false;
+                state.polling = false;
+                if (fareRunning) {
+                    fareResumed = true;                 // Trasa trwa - dystans z GPS do powrotu łącza
+                    state.trip.outages++;
+                    gpsOutageMm = 0;
+                    Serial.println("[DIST] OBD link lost, trip distance from GPS");
                 }
+            }
+            publish(millis());
+        }
 
-            } else {
+        if (!online) {
+            // Trasa zakończona lub zapauzowana bez łącza - po powrocie start od nowa
+            if (!tripActive || tripPaused) {
+                fareRunning = fareResumed = false;
+            } else if (fareRunning) {
+                // Przerwa łącza w trakcie trasy: dystans i postój z GPS, paliwo nieznane
+                uint32_t now = millis();
+                int16_t speedKmh;
+                uint32_t distanceMm = gpsFallback(now, speedKmh);
+                Fare::updateClock();
+                Fare::addSample(distanceMm, 0, now - lastFareMs, speedKmh);
+                lastFareMs = now;
+                publish(now);
+            }
+            continue;
+        }
 
-                // Gdy zapauzowany - reset timera żeby po wznowieniu nie było skoku
-                lastMillis = 0;
-                lastSDUpdate = 0;
+        // Odpytywanie tylko gdy dane są potrzebne (trasa lub żądanie ekranu)
+        bool watched = (int32_t)(watchUntil - millis()) > 0;
+        if (!tripActive && !watched) {
+            if (polling) {
+                polling = false;
+                state.polling = false;
+                publish(millis());
             }
-            
+            fareRunning = false;
+            fareResumed = false;
+            serveRequests(OBD_CONFIG::IDLE_POLL_MS, watchUntil);
+            continue;
+        }
+
+        if (!polling) {
+            uint32_t now = millis();
+            scheduler.reset(now);
+            for (uint8_t ch = 0; ch < CH_COUNT; ch++) state.samples[ch] = { 0.0f, now, Q_NONE };
+            state.polling = true;
+            publish(now);
+            polling = true;
+        }
+
+        // Najpilniejsze zapytanie lub czas do najbliższego terminu (żądanie budzi wcześniej)
+        ObdScheduler::Request req;
+        uint32_t waitMs = scheduler.next(millis(), req);
+        bool listening = waitMs >= (uint32_t)OBD_CONFIG::MONITOR_MIN_WINDOW_MS
+                         && (monitorState == MON_PROBE || monitorState == MON_ACTIVE);
+
+        if (waitMs > 0 && !listening) {
+            serveRequests(min(waitMs, (uint32_t)OBD_CONFIG::IDLE_POLL_MS), watchUntil);
+            continue;
+        }
+
+        bool ok[ObdPid::MAX_BATCH] = { false };
+        uint32_t now;
+
+        if (listening) {
+
+            // Wolny czas łącza: nasłuch ramek do najbliższego terminu zamiast uśpienia
+            bool answered = listen(min(waitMs, (uint32_t)OBD_CONFIG::MONITOR_MAX_WINDOW_MS), req, ok);
+            now = millis();
+            conn.onRequest(answered, now);
+            serveRequests(0, watchUntil);
+
+        } else {
+
+            ObdLink::Stats linkBefore = ObdLink::getStats();
+            uint32_t t0 = millis();
+            execute(req, ok);
+            now = millis();
+
+            // Odpowiedź na którąkolwiek komendę (także NO DATA) = łącze działa
+            ObdLink::Stats linkAfter = ObdLink::getStats();
+            conn.onRequest(linkAfter.commands - linkBefore.commands > linkAfter.timeouts - linkBefore.timeouts, now);
+            scheduler.complete(req, ok, now, now - t0);
+        }
+        publish(now);
+
+        Latest after = getLatest();
+
+        // Nowe próbki z tego zapytania (czas próbki = nadejście odpowiedzi ECU)
+        bool speedSampled = false, speedFailed = false, odoSampled = false, fuelSampled = false, fuelFailed = false;
+        for (size_t i = 0; i < req.count; i++) {
+            if (req.channels[i] == CH_SPEED) (ok[i] ? speedSampled : speedFailed) = true;
+            if (req.channels[i] == CH_MAF) (ok[i] ? fuelSampled : fuelFailed) = true;
+            if (req.channels[i] == CH_ODOMETER && ok[i]) odoSampled = true;
+        }
+        const Sample& speedSample = state.samples[CH_SPEED];
+        const Sample& fuelSample = state.samples[CH_MAF];
+        const Sample& odoSample = state.samples[CH_ODOMETER];
+
+        // LICZENIE tylko w trakcie trasy i gdy nie zapauzowany
+        if (!tripActive || tripPaused) {
+
+            // Reset żeby po wznowieniu nie było skoku
+            fareRunning = false;
+            fareResumed = false;
+
+        } else if (!fareRunning) {
+
+            // Start po pierwszym odczycie dystansu i spalania (których pojazd nie podaje - pomijane)
+            const ObdDiscovery::Vehicle& vehicle = state.bringUp.vehicle;
+            bool distanceReady = after.odometerKm >= 0 || (!vehicle.odometer && after.speedKmh >= 0);
+            bool fuelReady = after.fuelLph >= 0 || vehicle.fuelSource == ObdDiscovery::FUEL_NONE;
+            if (distanceReady && fuelReady) {
+                fareRunning = true;
+                distance.reset();
+                distance.addOdometer(odoSample.timestampMs, after.odometerKm);
+                distance.addSpeed(speedSample.timestampMs, after.speedKmh);
+                fuel.reset();
+                fuel.addSample(fuelSample.timestampMs, after.fuelLph);
+                fusionRestart(odoSample.timestampMs, after.odometerKm, speedSample.timestampMs, after.speedKmh);
+                lastDistanceMm = 0;
+                lastFuelUl = 0;
+                lastFareMs = now;
+                lastSDUpdate = now;
+            }
+
         } else {
 
-            // Reset przy nieaktywnym tripie
-            lastOdo = -1.0f;
-            lastMillis = 0;
-            lastSDUpdate = 0;
+            // Powrót łącza w trakcie trasy: dystans przerwy naliczył filtr z GPS, a odometr
+            // tylko go koryguje; estymator kontrolny od nowa, żeby przyrost odometru za przerwę
+            // nie wszedł do kontroli zgodności; spalanie przerwy > FUEL_MAX_GAP_MS jest pomijane
+            if (fareResumed) {
+                fareResumed = false;
+                distance.reset();
+                lastDistanceMm = 0;
+                lastFareMs = now;
+                Serial.printf("[OBD] Link restored, trip sampling resumed (%lu m from GPS)\n",
+                              (unsigned long)(gpsOutageMm / 1000));
+            }
+
+            uint32_t elapsedMs = now - lastFareMs;
+
+            // Dystans [mm] i prędkość do rozliczenia: fuzja OBD / GPS
+            fusionBegin();
+            if (speedSampled) fusion.addObdSpeed(speedSample.timestampMs, after.speedKmh);
+            if (odoSampled) fusion.addOdometer(odoSample.timestampMs, after.odometerKm);
+            fusionEnd();
+            uint32_t distanceMm = fusionStep(now);
+
+            // Kontrola: całkowana prędkość OBD kotwiczona do odometru wobec dystansu z pozycji
+            if (speedSampled) distance.addSpeed(speedSample.timestampMs, after.speedKmh);
+            else if (speedFailed) distance.addSpeed(now, -1);
+            if (odoSampled) distance.addOdometer(odoSample.timestampMs, after.odometerKm);
+            gpsCheck(distance.distanceMm() - lastDistanceMm);
+            lastDistanceMm = distance.distanceMm();
+
+            // Paliwo [µl]: trapezy między próbkami spalania (nieudany odczyt wydłuża przedział)
+            if (fuelSampled && !fuel.addSample(fuelSample.timestampMs, fuelSample.value)) {
+                FuelAccumulator::Stats fs = fuel.stats();
+                Serial.printf("[FUEL] Sample gap over %d ms not integrated (%lu gaps, %lu ms total)\n",
+                              OBD_CONFIG::FUEL_MAX_GAP_MS, (unsigned long)fs.dropped, (unsigned long)fs.droppedMs);
+            } else if (fuelFailed) {
+                fuel.addSample(now, -1.0f);
+            }
+
+            uint32_t fuelUl = (uint32_t)(fuel.totalUl() - lastFuelUl);
+            lastFuelUl = fuel.totalUl();
+
+            Fare::updateClock();
+            Fare::addSample(distanceMm, fuelUl, elapsedMs, fusionSpeedKmh());
+            lastFareMs = now;
+
+            // ========== ZAPIS NA SD CO 10 SEKUND ==========
+            if (now - lastSDUpdate >= 10000) {
+
+                if (SDManager::isReady() && !currentTripPath.isEmpty()) {
+                    FareEngine::Snapshot fare = Fare::snapshot();
+                    SDManager::TripUpdateData updateData;
+                    updateData.distanceKm = fare.distanceM / 1000.0f;
+                    updateData.fuelUsedLiters = fare.fuelMl / 1000.0f;
+                    updateData.totalCost = fare.dueGr / 100.0f;
+                    updateData.timestamp = now;
+
+                    SDManager::onTripUpdate(updateData);
+                }
+                lastSDUpdate = now;
+            }
+        }
+
+        // Statystyki łącza i osiągnięte częstotliwości co minutę
+        static unsigned long lastLinkLog = 0;
+        if (millis() - lastLinkLog >= 60000) {
+            ObdLink::Stats link = ObdLink::getStats();
+            ObdScheduler::LinkStats sched = getLinkStats();
+            Serial.printf("[OBD] Link: %lu cmds, %lu timeouts, p50=%lu ms, p99=%lu ms, max=%lu us, load=%u%%, gap=%lu ms\n",
+                (unsigned long)link.commands, (unsigned long)link.timeouts,
+                (unsigned long)ObdLink::latencyPercentileMs(50), (unsigned long)ObdLink::latencyPercentileMs(99),
+                (unsigned long)link.maxUs, sched.loadPct, (unsigned long)sched.gapMs);
+
+            for (uint8_t ch = 0; ch < CH_COUNT; ch++) {
+                ObdScheduler::ChannelStats cs;
+                if (!getChannelStats((Channel)ch, cs)) continue;
+                Serial.printf("[OBD] %s: %lu.%02lu Hz (target %lu ms), %lu ok, %lu failed\n", channelName[ch],
+                    (unsigned long)(cs.rateMilliHz / 1000), (unsigned long)(cs.rateMilliHz % 1000 / 10),
+                    (unsigned long)cs.periodMs, (unsigned long)cs.samples, (unsigned long)cs.failures);
+            }
+            if (monitorState != MON_OFF) {
+                CanMonitor::Stats ms = monitor.stats();
+                Serial.printf("[CAN] Monitor %s: %lu frames, %lu matched, %lu malformed, %lu buffer full\n",
+                    monitorLabel[monitorState], (unsigned long)ms.frames, (unsigned long)ms.matched,
+                    (unsigned long)ms.malformed, (unsigned long)ms.bufferFull);
+            }
+            if (fareRunning) {
+                FuelAccumulator::Stats fs = fuel.stats();
+                Serial.printf("[FUEL] %lu samples, %lu failed, %lu bridged (%lu ms), %lu dropped (%lu ms)\n",
+                    (unsigned long)fs.samples, (unsigned long)fs.failed, (unsigned long)fs.bridged,
+                    (unsigned long)fs.bridgedMs, (unsigned long)fs.dropped, (unsigned long)fs.droppedMs);
+
+                DistanceFusion::Stats ds = fusion.stats();
+                Serial.printf("[FUSION] %lu m, %.1f km/h, OBD scale %.4f, sigma %.1f m, max correction %lu m\n",
+                    (unsigned long)(fusion.distanceMm() / 1000), fusion.speedKmh(), fusion.obdScale(),
+                    fusion.sigmaM(), (unsigned long)(ds.maxCorrectionMm / 1000));
+                Serial.printf("[FUSION] %lu OBD speed, %lu Doppler, %lu position, %lu km ticks, %lu rejected, %lu blind, "
+                    "max %lu cycles (budget %d, %lu over)\n",
+                    (unsigned long)ds.obdSpeed, (unsigned long)ds.gpsSpeed, (unsigned long)ds.gpsPosition,
+                    (unsigned long)ds.odometerTicks, (unsigned long)ds.rejected, (unsigned long)ds.blind,
+                    (unsigned long)fusionMaxCycles, OBD_CONFIG::FUSION_BUDGET_CYCLES, (unsigned long)fusionOverBudget);
+            }
+            lastLinkLog = millis();
         }
-        
-        vTaskDelay(2000 / portTICK_PERIOD_MS);  // Opóźnienie 2 sekundy
     }
 }
 
@@ -0,0 +1,249 @@
+#include "obd_scheduler.h"
+
+// Moduł celowo nie używa Arduino.h - kompiluje się również na hoście
+
+// Premia pilności dla wartości nieaktualnych (większa niż każda pilność "w terminie")
+static constexpr uint64_t STALE_BOOST = 1ULL << 40;
+
+ObdScheduler::ObdScheduler(uint8_t util)
+    : count(0), utilPct(util < 10 ? 10 : (util > 100 ? 100 : util)) {
+    reset(0);
+}
+
+int ObdScheduler::addChannel(const Channel& channel) {
+
+    if (count >= MAX_CHANNELS || channel.periodMs == 0) return -1;
+
+    State& s = channels[count];
+    s = State();
+    s.cfg = channel;
+    if (s.cfg.priority == 0) s.cfg.priority = 1;
+    return (int)count++;
+}
+
+void ObdScheduler::reset(uint32_t nowMs) {
+
+    for (size_t i = 0; i < count; i++) {
+        Channel cfg = channels[i].cfg;
+        bool disabled = channels[i].disabled;
+        channels[i] = State();
+        channels[i].cfg = cfg;
+        channels[i].disabled = disabled;
+    }
+
+    latencyX8 = 0;
+    gapMs = 0;
+    nextSlotMs = nowMs;
+    timeoutStreak = 0;
+    windowStartMs = nowMs;
+    windowBusyMs = 0;
+    loadPct = 0;
+}
+
+// Okres wydłużony po kolejnych błędach kanału (x2 za każdy, do x2^MAX_BACKOFF_SHIFT)
+uint32_t ObdScheduler::effectivePeriod(const State& s) const {
+
+    uint8_t shift = s.failStreak < MAX_BACKOFF_SHIFT ? s.failStreak : MAX_BACKOFF_SHIFT;
+    return (uint32_t)s.cfg.periodMs << shift;
+}
+
+bool ObdScheduler::isDue(const State& s, uint32_t nowMs, uint8_t pct) const {
+
+    if (s.expedited) return true;
+    if (!s.sampled && s.failStreak == 0) return true;      // Jeszcze nieodpytany
+    return (uint64_t)(nowMs - s.lastTryMs) * 100 >= (uint64_t)effectivePeriod(s) * pct;
+}
+
+// Pilność = priorytet x wiek / okres (x256); nieaktualne przed aktualnymi
+uint32_t ObdScheduler::urgency(const State& s, uint32_t nowMs) const {
+
+    uint32_t age = s.sampled ? nowMs - s.lastOkMs : s.cfg.staleMs + 1u;
+    uint64_t u = (uint64_t)s.cfg.priority * age * 256 / s.cfg.periodMs;
+    if (!s.sampled || s.expedited || age > s.cfg.staleMs) u += STALE_BOOST;
+
+    // Kompresja do 32 bitów z zachowaniem kolejności obu zakresów
+    if (u >= STALE_BOOST) {
+        uint64_t over = u - STALE_BOOST;
+        return 0x80000000u | (uint32_t)(over > 0x7FFFFFFFu ? 0x7FFFFFFFu : over);
+    }
+    return (uint32_t)(u > 0x7FFFFFFFu ? 0x7FFFFFFFu : u);
+}
+
+uint32_t ObdScheduler::next(uint32_t nowMs, Request& req) {
+
+    req.count = 0;
+    if (count == 0) return LOAD_WINDOW_MS;
+
+    // Przerwa wynikająca z przepustowości łącza
+    if ((int32_t)(nextSlotMs - nowMs) > 0) return nextSlotMs - nowMs;
+
+    int best = -1;
+    uint32_t bestUrgency = 0;
+    uint32_t wait = UINT32_MAX;
+
+    for (size_t i = 0; i < count; i++) {
+        const State& s = channels[i];
+        if (s.disabled) continue;
+        if (isDue(s, nowMs, 100)) {
+            uint32_t u = urgency(s, nowMs);
+            if (best < 0 || u > bestUrgency) {
+                best = (int)i;
+                bestUrgency = u;
+            }
+        } else {
+            uint32_t left = effectivePeriod(s) - (nowMs - s.lastTryMs);
+            if (left < wait) wait = left;
+        }
+    }
+
+    if (best < 0) return wait > 0 ? wait : 1;
+
+    req.channels[req.count++] = (uint8_t)best;
+    if (channels[best].cfg.pid == NO_PID) return 0;
+
+    // Dołączenie kanałów Mode 01 bliskich terminu - od najpilniejszego
+    uint32_t urgencies[ObdPid::MAX_BATCH];
+    urgencies[0] = UINT32_MAX;
+
+    for (size_t i = 0; i < count; i++) {
+
+        const State& s = channels[i];
+        if ((int)i == best || s.disabled || s.cfg.pid == NO_PID || !isDue(s, nowMs, PIGGYBACK_PCT)) continue;
+
+        uint32_t u = urgency(s, nowMs);
+        size_t pos = req.count;
+        while (pos > 1 && urgencies[pos - 1] < u) pos--;
+        if (pos >= ObdPid::MAX_BATCH) continue;
+
+        size_t last = req.count < ObdPid::MAX_BATCH ? req.count : ObdPid::MAX_BATCH - 1;
+        for (size_t j = last; j > pos; j--) {
+            req.channels[j] = req.channels[j - 1];
+            urgencies[j] = urgencies[j - 1];
+        }
+        req.channels[pos] = (uint8_t)i;
+        urgencies[pos] = u;
+        if (req.count < ObdPid::MAX_BATCH) req.count++;
+    }
+    return 0;
+}
+
+void ObdScheduler::recordSample(State& s, uint32_t nowMs) {
+
+    // Średni odstęp próbek (waga 1/4) - częstotliwość także dla wolnych kanałów
+    if (s.sampled) {
+        uint32_t interval = nowMs - s.lastOkMs;
+        if (s.intervalX4 == 0) s.intervalX4 = interval * 4;
+        else s.intervalX4 = s.intervalX4 - s.intervalX4 / 4 + interval;
+    }
+    s.sampled = true;
+    s.lastOkMs = nowMs;
+    s.failStreak = 0;
+    s.samples++;
+}
+
+void ObdScheduler::complete(const Request& req, const bool* ok, uint32_t nowMs, uint32_t durationMs) {
+
+    // Średnia wykładnicza czasu zapytania (waga 1/8)
+    if (latencyX8 == 0) latencyX8 = durationMs * 8;
+    else latencyX8 = latencyX8 - latencyX8 / 8 + durationMs;
+
+    bool anyOk = false;
+    for (size_t i = 0; i < req.count; i++) {
+
+        if (req.channels[i] >= count) continue;
+        State& s = channels[req.channels[i]];
+        s.lastTryMs = nowMs - durationMs;       // Okres liczony od początku zapytania
+        s.expedited = false;
+
+        if (ok[i]) {
+            recordSample(s, nowMs);
+            anyOk = true;
+        } else {
+            s.failures++;
+            if (s.failStreak < 255) s.failStreak++;
+        }
+    }
+
+    // Przerwa: zajętość łącza najwyżej utilPct; brak odpowiedzi => przerwa rosnąca x2
+    timeoutStreak = anyOk ? 0 : timeoutStreak + 1;
+    uint32_t latency = latencyX8 / 8;
+    gapMs = latency * (100 - utilPct) / utilPct;
+    if (timeoutStreak > 0) {
+        uint32_t shift = timeoutStreak - 1 < 4 ? timeoutStreak - 1 : 4;
+        uint32_t backoff = TIMEOUT_BACKOFF_MS << shift;
+        gapMs += backoff < MAX_BACKOFF_MS ? backoff : MAX_BACKOFF_MS;
+    }
+    nextSlotMs = nowMs + gapMs;
+
+    // Okno pomiaru zajętości łącza
+    windowBusyMs += durationMs;
+    uint32_t window = nowMs - windowStartMs;
+    if (window >= LOAD_WINDOW_MS) {
+        uint32_t load = (uint32_t)((uint64_t)windowBusyMs * 100 / window);
+        loadPct = (uint8_t)(load > 100 ? 100 : load);
+        windowBusyMs = 0;
+        windowStartMs = nowMs;
+    }
+}
+
+bool ObdScheduler::supply(size_t index, uint32_t sampleMs) {
+
+    if (index >= count) return false;
+    State& s = channels[index];
+    if (s.sampled && (int32_t)(sampleMs - s.lastOkMs) <= 0) return true;   // Nie nowsza od ostatniej
+
+    recordSample(s, sampleMs);
+    s.lastTryMs = sampleMs;
+    s.expedited = false;
+    return true;
+}
+
+bool ObdScheduler::setEnabled(size_t index, bool enabled) {
+
+    if (index >= count) return false;
+    channels[index].disabled = !enabled;
+    return true;
+}
+
+bool ObdScheduler::expedite(size_t index) {
+
+    if (index >= count || channels[index].disabled) return false;
+    channels[index].expedited = true;
+    return true;
+}
+
+bool ObdScheduler::isStale(size_t index, uint32_t nowMs) const {
+
+    if (index >= count) return true;
+    const State& s = channels[index];
+    return !s.sampled || nowMs - s.lastOkMs > s.cfg.staleMs;
+}
+
+bool ObdScheduler::channelStats(size_t index, uint32_t nowMs, ChannelStats& out) const {
+
+    if (index >= count) return false;
+
+    const State& s = channels[index];
+    out.pid = s.cfg.pid;
+    out.periodMs = s.cfg.periodMs;
+    out.samples = s.samples;
+    out.failures = s.failures;
+    out.ageMs = s.sampled ? nowMs - s.lastOkMs : UINT32_MAX;
+
+    // Bez nowych próbek częstotliwość maleje razem z wiekiem ostatniej
+    uint32_t interval = s.intervalX4 / 4;
+    if (out.ageMs > interval) interval = out.ageMs;
+    out.rateMilliHz = (s.intervalX4 > 0 && interval > 0) ? 1000000u / interval : 0;
+    out.stale = isStale(index, nowMs);
+    return true;
+}
+
+ObdScheduler::LinkStats ObdScheduler::linkStats() const {
+
+    LinkStats l;
+    l.latencyMs = latencyX8 / 8;
+    l.gapMs = gapMs;
+    l.loadPct = loadPct;
+    l.timeoutStreak = timeoutStreak;
+    return l;
+}
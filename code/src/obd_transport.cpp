@@ -0,0 +1,35 @@
+#include "obd_transport.h"
+
+#ifdef ARDUINO
+#include <BluetoothSerial.h>
+#include <stdio.h>
+
+void BluetoothTransport::setHandler(DataHandler handler) {
+    bt.onData(handler);
+}
+
+size_t BluetoothTransport::write(const uint8_t* data, size_t len) {
+    return bt.write(data, len);
+}
+
+bool BluetoothTransport::connected() {
+    return bt.connected();
+}
+
+bool BluetoothTransport::connect() {
+
+    // Stos Bluetooth uruchamiany raz - kolejne próby tylko łączą z adapterem
+    if (!started) started = bt.begin(name, true);
+    if (!started) return false;
+
+    uint8_t addr[6];
+    if (sscanf(mac, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx",
+               &addr[0], &addr[1], &addr[2], &addr[3], &addr[4], &addr[5]) != 6) return false;
+    return bt.connect(addr);
+}
+
+void BluetoothTransport::disconnect() {
+    bt.disconnect();
+}
+
+#endif  // ARDUINO
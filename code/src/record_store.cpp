@@ -0,0 +1,335 @@
+#include "record_store.h"
+#include "trip_log_format.h"
+#include <string.h>
+
+// Moduł celowo nie używa Arduino.h - kompiluje się również na hoście (RamFlash)
+
+using TripLogFormat::crc32;
+
+// =============================================================================
+// FORMAT NA NOŚNIKU
+// =============================================================================
+
+static constexpr uint32_t SECTOR_MAGIC = 0x31535243;   // "CRS1"
+static constexpr uint32_t SECTOR_HEADER_SIZE = 16;
+static constexpr uint8_t RECORD_MAGIC = 0xA5;
+static constexpr uint32_t RECORD_HEADER_SIZE = 12;
+static constexpr uint8_t FLAG_TOMBSTONE = 0x01;         // Bit wyzerowany = rekord usuwający
+
+static inline uint32_t alignedSize(uint8_t len) {
+    return RECORD_HEADER_SIZE + (((uint32_t)len + 3) & ~3u);
+}
+
+static inline void putU32(uint8_t* p, uint32_t v) {
+    memcpy(p, &v, 4);
+}
+
+static inline uint32_t getU32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+// =============================================================================
+// RAMFLASH - emulator NOR na hoście
+// =============================================================================
+
+RamFlash::RamFlash(uint8_t* buffer, uint32_t sectorSize, uint32_t sectorCount)
+    : mem(buffer), secSize(sectorSize), secCount(sectorCount) {
+}
+
+bool RamFlash::read(uint32_t addr, void* buf, size_t len) {
+
+    if (addr + len > secSize * secCount) return false;
+    memcpy(buf, mem + addr, len);
+    return true;
+}
+
+bool RamFlash::write(uint32_t addr, const void* buf, size_t len) {
+
+    if (addr + len > secSize * secCount) return false;
+    const uint8_t* src = (const uint8_t*)buf;
+    for (size_t i = 0; i < len; i++)
+        mem[addr + i] &= src[i];        // NOR: zapis może tylko zerować bity
+    return true;
+}
+
+bool RamFlash::erase(uint32_t sector) {
+
+    if (sector >= secCount) return false;
+    memset(mem + sector * secSize, 0xFF, secSize);
+    return true;
+}
+
+// =============================================================================
+// RECORDSTORE
+// =============================================================================
+
+RecordStore::RecordStore(FlashDevice& f)
+    : flash(f), active(0), sectorSeq(0), writePos(0), recordSeq(0),
+      eraseTotal(0), counters(), mounted(false) {
+    memset(slots, 0, sizeof(slots));
+}
+
+bool RecordStore::readSectorHeader(uint32_t sector, uint32_t& seq, uint32_t& eraseCount) {
+
+    uint8_t hdr[SECTOR_HEADER_SIZE];
+    if (!flash.read(sector * flash.sectorSize(), hdr, sizeof(hdr))) return false;
+    if (getU32(hdr) != SECTOR_MAGIC || getU32(hdr + 12) != crc32(hdr, 12)) return false;
+
+    seq = getU32(hdr + 4);
+    eraseCount = getU32(hdr + 8);
+    return true;
+}
+
+bool RecordStore::writeSectorHeader(uint32_t sector, uint32_t seq, uint32_t eraseCount) {
+
+    uint8_t hdr[SECTOR_HEADER_SIZE];
+    putU32(hdr, SECTOR_MAGIC);
+    putU32(hdr + 4, seq);
+    putU32(hdr + 8, eraseCount);
+    putU32(hdr + 12, crc32(hdr, 12));
+    return flash.write(sector * flash.sectorSize(), hdr, sizeof(hdr));
+}
+
+bool RecordStore::eraseSector(uint32_t sector, uint32_t& eraseCount) {
+
+    uint32_t seq;
+    if (!readSectorHeader(sector, seq, eraseCount)) eraseCount = 0;
+    if (!flash.erase(sector)) return false;
+
+    eraseCount++;
+    eraseTotal++;
+    counters.erasesSinceBoot++;
+    return true;
+}
+
+bool RecordStore::format() {
+
+    uint32_t eraseCount;
+    if (!eraseSector(0, eraseCount)) return false;
+    if (!writeSectorHeader(0, 1, eraseCount)) return false;
+
+    active = 0;
+    sectorSeq = 1;
+    writePos = SECTOR_HEADER_SIZE;
+    recordSeq = 0;
+    memset(slots, 0, sizeof(slots));
+    return true;
+}
+
+bool RecordStore::scanSector(uint32_t sector) {
+
+    const uint32_t base = sector * flash.sectorSize();
+    uint32_t pos = SECTOR_HEADER_SIZE;
+    uint8_t rec[RECORD_HEADER_SIZE + MAX_PAYLOAD];
+
+    memset(slots, 0, sizeof(slots));
+    writePos = flash.sectorSize();
+
+    while (pos + RECORD_HEADER_SIZE <= flash.sectorSize()) {
+
+        if (!flash.read(base + pos, rec, RECORD_HEADER_SIZE)) return false;
+
+        // Początek wolnego miejsca
+        if (rec[0] == 0xFF && rec[1] == 0xFF && rec[2] == 0xFF) {
+            writePos = pos;
+            break;
+        }
+
+        uint8_t key = rec[1];
+        uint8_t len = rec[2];
+        uint32_t size = alignedSize(len);
+
+        // Uszkodzony nagłówek - nie da się ustalić długości, reszta sektora
+        // jest traktowana jako zajęta (kolejny zapis wymusi odśmiecanie)
+        if (rec[0] != RECORD_MAGIC || len > MAX_PAYLOAD || key == 0 || key >= MAX_KEYS
+                || pos + size > flash.sectorSize()) {
+            counters.corruptRecords++;
+            break;
+        }
+
+        if (!flash.read(base + pos + RECORD_HEADER_SIZE, rec + RECORD_HEADER_SIZE, len)) return false;
+
+        uint32_t crc = crc32(rec, 8);
+        crc = crc32(rec + RECORD_HEADER_SIZE, len, crc);
+        if (crc != getU32(rec + 8)) {
+            counters.corruptRecords++;
+            pos += size;
+            continue;
+        }
+
+        uint32_t seq = getU32(rec + 4);
+        if (seq > recordSeq) recordSeq = seq;
+
+        if (!(rec[3] & FLAG_TOMBSTONE)) {
+            slots[key].addr = 0;
+            slots[key].len = 0;
+        } else {
+            slots[key].addr = base + pos;
+            slots[key].len = len;
+        }
+        pos += size;
+    }
+    return true;
+}
+
+bool RecordStore::mount() {
+
+    mounted = false;
+    eraseTotal = 0;
+    if (flash.sectorCount() < 2 || flash.sectorSize() < 256) return false;
+
+    // Aktywny sektor = poprawny nagłówek z najwyższym seq
+    bool found = false;
+    for (uint32_t s = 0; s < flash.sectorCount(); s++) {
+
+        uint32_t seq, eraseCount;
+        if (!readSectorHeader(s, seq, eraseCount)) continue;
+
+        eraseTotal += eraseCount;
+        if (!found || seq > sectorSeq) {
+            found = true;
+            active = s;
+            sectorSeq = seq;
+        }
+    }
+
+    if (!found) {
+        if (!format()) return false;
+    } else if (!scanSector(active)) {
+        return false;
+    }
+
+    mounted = true;
+    return true;
+}
+
+bool RecordStore::collect(uint32_t needBytes) {
+
+    const uint32_t next = (active + 1) % flash.sectorCount();
+    const uint32_t base = next * flash.sectorSize();
+
+    // Sprawdzenie czy aktualne rekordy + nowy rekord zmieszczą się w sektorze
+    uint32_t live = SECTOR_HEADER_SIZE + needBytes;
+    for (uint8_t k = 1; k < MAX_KEYS; k++)
+        if (slots[k].addr) live += alignedSize(slots[k].len);
+    if (live > flash.sectorSize()) return false;
+
+    uint32_t eraseCount;
+    if (!eraseSector(next, eraseCount)) return false;
+
+    // Kopiowanie aktualnych rekordów bez zmian (CRC i seq pozostają ważne)
+    Slot moved[MAX_KEYS];
+    memset(moved, 0, sizeof(moved));
+    uint32_t pos = SECTOR_HEADER_SIZE;
+    uint8_t rec[RECORD_HEADER_SIZE + MAX_PAYLOAD + 3];
+
+    for (uint8_t k = 1; k < MAX_KEYS; k++) {
+
+        if (!slots[k].addr) continue;
+
+        uint32_t size = alignedSize(slots[k].len);
+        if (!flash.read(slots[k].addr, rec, size)) return false;
+        if (!flash.write(base + pos, rec, size)) return false;
+
+        moved[k].addr = base + pos;
+        moved[k].len = slots[k].len;
+        pos += size;
+    }
+
+    // Nagłówek zapisywany na końcu - dopiero teraz nowy sektor staje się aktywny
+    if (!writeSectorHeader(next, sectorSeq + 1, eraseCount)) return false;
+
+    memcpy(slots, moved, sizeof(slots));
+    active = next;
+    sectorSeq++;
+    writePos = pos;
+    counters.gcRuns++;
+    return true;
+}
+
+bool RecordStore::appendRecord(uint8_t key, const void* buf, uint8_t len, bool tombstone) {
+
+    if (!mounted || key == 0 || key >= MAX_KEYS || len > MAX_PAYLOAD) return false;
+
+    const uint32_t size = alignedSize(len);
+    if (writePos + size > flash.sectorSize()) {
+
+        if (tombstone) {
+            // Usuwany klucz nie jest kopiowany - nagrobek nie jest potrzebny
+            Slot saved = slots[key];
+            slots[key].addr = 0;
+            slots[key].len = 0;
+            if (collect(0)) return true;
+            slots[key] = saved;
+            return false;
+        }
+        if (!collect(size)) return false;
+    }
+
+    uint8_t rec[RECORD_HEADER_SIZE + MAX_PAYLOAD + 3];
+    memset(rec, 0xFF, sizeof(rec));
+    rec[0] = RECORD_MAGIC;
+    rec[1] = key;
+    rec[2] = len;
+    rec[3] = tombstone ? (uint8_t)~FLAG_TOMBSTONE : 0xFF;
+    putU32(rec + 4, recordSeq + 1);
+    if (len) memcpy(rec + RECORD_HEADER_SIZE, buf, len);
+
+    uint32_t crc = crc32(rec, 8);
+    crc = crc32(rec + RECORD_HEADER_SIZE, len, crc);
+    putU32(rec + 8, crc);
+
+    const uint32_t addr = active * flash.sectorSize() + writePos;
+    if (!flash.write(addr, rec, size)) {
+        // Miejsce mogło zostać częściowo zapisane - nie używamy go ponownie
+        writePos = flash.sectorSize();
+        return false;
+    }
+
+    recordSeq++;
+    writePos += size;
+    counters.recordsWritten++;
+
+    if (tombstone) {
+        slots[key].addr = 0;
+        slots[key].len = 0;
+    } else {
+        slots[key].addr = addr;
+        slots[key].len = len;
+    }
+    return true;
+}
+
+bool RecordStore::get(uint8_t key, void* buf, size_t len) {
+
+    if (!mounted || key == 0 || key >= MAX_KEYS) return false;
+    if (!slots[key].addr || slots[key].len != len) return false;
+    return flash.read(slots[key].addr + RECORD_HEADER_SIZE, buf, len);
+}
+
+bool RecordStore::put(uint8_t key, const void* buf, size_t len) {
+
+    if (len > MAX_PAYLOAD) return false;
+    return appendRecord(key, buf, (uint8_t)len, false);
+}
+
+bool RecordStore::remove(uint8_t key) {
+
+    if (key == 0 || key >= MAX_KEYS || !slots[key].addr) return true;
+    return appendRecord(key, nullptr, 0, true);
+}
+
+bool RecordStore::contains(uint8_t key) const {
+    return key > 0 && key < MAX_KEYS && slots[key].addr != 0;
+}
+
+RecordStore::Stats RecordStore::stats() const {
+
+    Stats s = counters;
+    s.eraseCount = eraseTotal;
+    s.activeSector = active;
+    s.freeBytes = writePos < flash.sectorSize() ? flash.sectorSize() - writePos : 0;
+    return s;
+}
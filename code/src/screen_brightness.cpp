@@ -6,9 +6,7 @@
 #include "screen_home.h"
 #include "background.h"
 #include <Arduino.h>
-#include <EEPROM.h>
-
-#define BRIGHTNESS_ADDR 0 // Adres w EEPROM do przechowywania poziomu jasności
+#include "settings_store.h"
 
 static TFT_eSPI* tftPtr = nullptr;
 static Background* bgBrightness = nullptr;
@@ -19,7 +17,8 @@ uint8_t brightnessLevel = 250;
 // Funkcja ustawiająca jasność podświetlenia ekranu
 void initBrightnessModule() {
 
-    uint8_t saved = EEPROM.read(BRIGHTNESS_ADDR);
+    uint8_t saved = 255;
+    Settings::getBrightness(saved);
     brightnessLevel = saved;
 
     if (brightnessLevel < 5) brightnessLevel = 255;
@@ -89,9 +88,8 @@ void handleBrightnessTouch(TFT_eSPI* tft, uint16_t x, uint16_t y, uint8_t* level
     // Powrót do ekranu głównego (górny prawy róg)
     if (x >= 260 && x < 310 && y >= 10 && y < 50) {
 
-        EEPROM.write(BRIGHTNESS_ADDR, brightnessLevel);
-        EEPROM.commit();
-        Serial.print("[BRIGHTNESS] Brightness saved to EEPROM: ");
+        Settings::putBrightness(brightnessLevel);
+        Serial.print("[BRIGHTNESS] Brightness saved: ");
         Serial.println(brightnessLevel);
         initHomeScreen(tftPtr);
         currentScreen = SCREEN_HOME;
@@ -11,6 +11,8 @@ static TFT_eSPI* tftPtr = nullptr;
 static char lastLatText[32] = "";
 static char lastLonText[32] = "";
 static char lastSatText[32] = "";
+static char lastTtffText[32] = "";
+static char lastRateText[32] = "";
 
 // Inicjalizacja ekranu diagnostyki GPS
 void initGpsDebugScreen(TFT_eSPI* tft) {
@@ -20,15 +22,19 @@ void initGpsDebugScreen(TFT_eSPI* tft) {
     // Tytuł
     drawText(tft, "GPS DIAGNOSTICS", 160, 10, TC_DATUM, 4, TFT_GREEN);
     // Opisy pól
-    drawText(tft, "Latitude:", 10, 60, TL_DATUM, 2, TFT_GREEN);
-    drawText(tft, "Longitude:", 10, 100, TL_DATUM, 2, TFT_GREEN);
-    drawText(tft, "Satellites:", 10, 140, TL_DATUM, 2, TFT_GREEN);
+    drawText(tft, "Latitude:", 10, 50, TL_DATUM, 2, TFT_GREEN);
+    drawText(tft, "Longitude:", 10, 78, TL_DATUM, 2, TFT_GREEN);
+    drawText(tft, "Satellites:", 10, 106, TL_DATUM, 2, TFT_GREEN);
+    drawText(tft, "TTFF:", 10, 134, TL_DATUM, 2, TFT_GREEN);
+    drawText(tft, "Fix rate:", 10, 162, TL_DATUM, 2, TFT_GREEN);
     // Przycisk powrotu
     tft->fillRect(10, 200, 300, 40, TFT_DARKGREY);
     drawTextWithBackground(tft, "BACK", 160, 220, MC_DATUM, 2, TFT_WHITE, TFT_DARKGREY, 0);
     strcpy(lastLatText, "");
     strcpy(lastLonText, "");
     strcpy(lastSatText, "");
+    strcpy(lastTtffText, "");
+    strcpy(lastRateText, "");
     Serial.println("[SYSTEM] GPS-DEBUG screen initialized");
 }
 
@@ -37,9 +43,8 @@ void updateGpsDebugScreen(TFT_eSPI* tft) {
 
     if (!tft) return;
 
-    // Aktualizacja danych GPS
-    GPS::Fix fix;
-    GPS::poll(fix);
+    // Ostatni Fix opublikowany przez task GPS
+    GPS::Fix fix = GPS::latest();
     char latText[32];
     char lonText[32];
     char satText[32];
@@ -56,18 +61,41 @@ void updateGpsDebugScreen(TFT_eSPI* tft) {
         strcpy(satText, "N/A");
     }
 
+    // Czas do pierwszego fixu (z danymi pomocniczymi lub bez) i osiągnięta częstotliwość epok
+    GPS::Stats st = GPS::getStats();
+    char ttffText[32];
+    char rateText[32];
+    const char* start = st.setup.aidedTime ? "aided" : st.setup.aidedPosition ? "pos aided" : "cold";
+    if (st.ttffMs) {
+        snprintf(ttffText, sizeof(ttffText), "%lu.%lu s (%s)", (unsigned long)(st.ttffMs / 1000),
+                 (unsigned long)(st.ttffMs % 1000 / 100), start);
+    } else {
+        snprintf(ttffText, sizeof(ttffText), "waiting %lu s (%s)", (unsigned long)(millis() / 1000), start);
+    }
+    snprintf(rateText, sizeof(rateText), "%lu.%lu Hz / %lu Hz, %s %lu",
+             (unsigned long)(st.fixRateMilliHz / 1000), (unsigned long)(st.fixRateMilliHz % 1000 / 100),
+             (unsigned long)(1000 / st.setup.rateMs), st.setup.ubx ? "UBX" : "NMEA", (unsigned long)st.setup.baud);
+
     if (strcmp(latText, lastLatText) != 0) {
-        drawTextWithBackground(tft, latText, 80, 60, TL_DATUM, 2, TFT_WHITE, TFT_BLACK, 200);
+        drawTextWithBackground(tft, latText, 80, 50, TL_DATUM, 2, TFT_WHITE, TFT_BLACK, 200);
         strcpy(lastLatText, latText);
     }
     if (strcmp(lonText, lastLonText) != 0) {
-        drawTextWithBackground(tft, lonText, 80, 100, TL_DATUM, 2, TFT_WHITE, TFT_BLACK, 200);
+        drawTextWithBackground(tft, lonText, 80, 78, TL_DATUM, 2, TFT_WHITE, TFT_BLACK, 200);
         strcpy(lastLonText, lonText);
     }
     if (strcmp(satText, lastSatText) != 0) {
-        drawTextWithBackground(tft, satText, 80, 140, TL_DATUM, 2, TFT_WHITE, TFT_BLACK, 200);
+        drawTextWithBackground(tft, satText, 80, 106, TL_DATUM, 2, TFT_WHITE, TFT_BLACK, 200);
         strcpy(lastSatText, satText);
     }
+    if (strcmp(ttffText, lastTtffText) != 0) {
+        drawTextWithBackground(tft, ttffText, 80, 134, TL_DATUM, 2, TFT_WHITE, TFT_BLACK, 230);
+        strcpy(lastTtffText, ttffText);
+    }
+    if (strcmp(rateText, lastRateText) != 0) {
+        drawTextWithBackground(tft, rateText, 80, 162, TL_DATUM, 2, TFT_WHITE, TFT_BLACK, 230);
+        strcpy(lastRateText, rateText);
+    }
 }
 
 // Obsługa dotyku na ekranie diagnostyki GPS
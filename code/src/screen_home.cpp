@@ -40,7 +40,7 @@ void initHomeScreen(TFT_eSPI* tft) {
 
     if(tripActive)
         bgHome = new Background("/home_resume.png");
-    else if(OBD::btConnected && OBD::elmReady)
+    else if(OBD::isReady())
         bgHome = new Background("/home_active.png");
     else
         bgHome = new Background("/home.png");
@@ -72,17 +72,17 @@ void initHomeScreen(TFT_eSPI* tft) {
 void updateGPSStatus(TFT_eSPI* tft) {
   
     if (!tft) return;
-    GPS::poll(GPS::lastFix); // Pobierz najnowszą próbkę GPS
+    GPS::Fix fix = GPS::latest(); // Ostatni Fix opublikowany przez task GPS
 
     // Wyświetlanie uproszczonego statusu GPS
     char gpsBuf[16];
     uint16_t gpsColor = TFT_RED;
-    if (!GPS::lastFix.valid) {
+    if (!fix.valid) {
 
         strcpy(gpsBuf, "NO FIX");
         gpsColor = TFT_RED;
 
-    } else if (GPS::lastFix.sats < 5) {
+    } else if (fix.sats < 5) {
 
         strcpy(gpsBuf, "WEAK");
         gpsColor = TFT_ORANGE;
@@ -93,20 +93,35 @@ void updateGPSStatus(TFT_eSPI* tft) {
         gpsColor = TFT_GREEN;
     }
 
-    // Wyświetlanie statusu OBD
+    // Wyświetlanie statusu OBD (stan połączenia prowadzonego w tle przez task OBD)
     char obdBuf[32];
+    uint16_t obdColor = TFT_RED;
     bool forceRedraw = false;
-    
-    if (OBD::btConnected && OBD::elmReady)
-        strcpy(obdBuf, "CONNECTED");
-    else if (OBD::btConnected) 
-        strcpy(obdBuf, "BT ONLY");
-    else
-        strcpy(obdBuf, "NO LINK");
+    ObdConnection::State obdState = OBD::getConnectionState();
+
+    switch (obdState) {
+        case ObdConnection::READY:
+            strcpy(obdBuf, "CONNECTED");
+            obdColor = TFT_GREEN;
+            break;
+        case ObdConnection::DEGRADED:
+            strcpy(obdBuf, "DEGRADED");
+            obdColor = TFT_ORANGE;
+            break;
+        case ObdConnection::CONNECTING:
+        case ObdConnection::ELM_INIT:
+            strcpy(obdBuf, ObdConnection::label(obdState));
+            obdColor = TFT_YELLOW;
+            break;
+        default:
+            strcpy(obdBuf, "NO LINK");
+            obdColor = TFT_RED;
+            break;
+    }
 
     // Mechanizm podmiany tła przy zmianie statusu OBD
     static bool lastObdWasConnected = false;
-    bool nowConnected = (OBD::btConnected && OBD::elmReady);
+    bool nowConnected = obdState == ObdConnection::READY || obdState == ObdConnection::DEGRADED;
     static String lastBgPath = "";
     const char* desiredBg = nowConnected ? "/home_active.png" : "/home.png";
 
@@ -130,7 +145,7 @@ void updateGPSStatus(TFT_eSPI* tft) {
     // Rysowanie napisów tylko jeśli się zmieniły lub wymuszone OBD
     if (strcmp(obdBuf, lastObdText) != 0 || forceRedraw) {
 
-        drawTextWithBackground(tft, obdBuf, 300, 130, TR_DATUM, 2, OBD::btConnected ? TFT_GREEN : TFT_RED, TFT_BLACK, 140);
+        drawTextWithBackground(tft, obdBuf, 300, 130, TR_DATUM, 2, obdColor, TFT_BLACK, 140);
         strcpy(lastObdText, obdBuf);
     }
 }
@@ -149,7 +164,7 @@ void handleHomeTouch(uint16_t x, uint16_t y) {
   // Rozpoczęcie jazdy (dolny prostokąt) tylko jeśli OBD połączone
   if (x >= 20 && x < 220 && y >= 200 && y < 240) {
 
-    if (OBD::btConnected && OBD::elmReady) {
+    if (OBD::isReady()) {
 
         initTripScreen(tftPtr);
         currentScreen = SCREEN_TRIP;
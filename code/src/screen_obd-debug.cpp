@@ -7,8 +7,14 @@
 #include <Arduino.h>
 
 static TFT_eSPI* tftPtr = nullptr;
-static char lastOdoText[32] = "";
-static char lastFuelText[32] = "";
+
+// Wiersze kanałów: wartość i osiągnięta częstotliwość (kolejność jak OBD::Channel)
+static const int ROW_Y[OBD::CH_COUNT] = { 80, 110, 50 };
+static char lastValueText[OBD::CH_COUNT][32];
+static uint16_t lastValueColor[OBD::CH_COUNT];
+static char lastRateText[OBD::CH_COUNT][32];
+static char lastLinkText[48] = "";
+static char lastInitText[48] = "";
 
 void initObdDebugScreen(TFT_eSPI* tft) {
 
@@ -19,15 +25,25 @@ void initObdDebugScreen(TFT_eSPI* tft) {
     drawText(tft, "OBD DIAGNOSTICS", 160, 10, TC_DATUM, 4, TFT_SKYBLUE);
     
     // Opisy pól
-    drawText(tft, "Odometer:", 10, 60, TL_DATUM, 2, TFT_SKYBLUE);
-    drawText(tft, "Fuel Rate:", 10, 120, TL_DATUM, 2, TFT_SKYBLUE);
+    drawText(tft, "Odometer:", 10, ROW_Y[OBD::CH_ODOMETER], TL_DATUM, 2, TFT_SKYBLUE);
+    drawText(tft, "Fuel Rate:", 10, ROW_Y[OBD::CH_MAF], TL_DATUM, 2, TFT_SKYBLUE);
+    drawText(tft, "Speed:", 10, ROW_Y[OBD::CH_SPEED], TL_DATUM, 2, TFT_SKYBLUE);
+    drawText(tft, "Link:", 10, 150, TL_DATUM, 2, TFT_SKYBLUE);
+    drawText(tft, "Init:", 10, 175, TL_DATUM, 2, TFT_SKYBLUE);
+
     
     // Przycisk powrotu
     tft->fillRect(10, 200, 300, 40, TFT_DARKGREY);
     drawTextWithBackground(tft, "BACK", 160, 220, MC_DATUM, 2, TFT_WHITE, TFT_DARKGREY, 0);
     
-    strcpy(lastOdoText, "");
-    strcpy(lastFuelText, "");
+    for (int ch = 0; ch < OBD::CH_COUNT; ch++) {
+        strcpy(lastValueText[ch], "");
+        strcpy(lastRateText[ch], "");
+    }
+    strcpy(lastLinkText, "");
+    strcpy(lastInitText, "");
+
+    OBD::requestWatch(OBD_CONFIG::WATCH_MS);        // Start odpytywania bez czekania na odświeżenie
     
     Serial.println("[SYSTEM] OBD-DEBUG screen initialized");
 }
@@ -36,32 +52,83 @@ void updateObdDebugScreen(TFT_eSPI* tft) {
 
     if (!tft) return;
     
-    // Odczyt danych
-    long odo = OBD::readOdometer();
-    float fuel = OBD::readFuelRate();
-    
-    char odoText[32];
-    char fuelText[32];
-    
-    if (odo > 0)
-        sprintf(odoText, "%ld KM", odo);
-    else
-        sprintf(odoText, "N/A");
+    // Podtrzymanie odpytywania, dopóki ekran jest otwarty
+    OBD::requestWatch(OBD_CONFIG::WATCH_MS);
+
+    // Odczyt snapshotu taska OBD (ekran nie wysyła komend do ELM327)
+    OBD::Snapshot snap = OBD::getSnapshot();
     
-    if (fuel >= 0)
-        sprintf(fuelText, "%.2f L/H", fuel);
-    else
-        sprintf(fuelText, "N/A");
+    char valueText[OBD::CH_COUNT][32];
+    uint16_t valueColor[OBD::CH_COUNT];
+    static const char* const VALUE_FORMAT[OBD::CH_COUNT] = { "%.2f L/H", "%.0f KM/H", "%.0f KM" };
+
+    for (int ch = 0; ch < OBD::CH_COUNT; ch++) {
+
+        // Jakość próbki: ostatnia próba nieudana - żółty, nieaktualna - pomarańczowy
+        const OBD::Sample& sample = snap.samples[ch];
+        if (sample.quality == OBD::Q_NONE)
+            strcpy(valueText[ch], "N/A");
+        else
+            snprintf(valueText[ch], sizeof(valueText[ch]), VALUE_FORMAT[ch], sample.value);
+
+        valueColor[ch] = sample.quality == OBD::Q_FAILED ? TFT_YELLOW :
+                         sample.quality == OBD::Q_STALE ? TFT_ORANGE : TFT_WHITE;
+    }
     
     // Update tylko przy zmianie
-    if (strcmp(odoText, lastOdoText) != 0) {
-        drawTextWithBackground(tft, odoText, 10, 80, TL_DATUM, 4, TFT_WHITE, TFT_BLACK, 300);
-        strcpy(lastOdoText, odoText);
+    for (int ch = 0; ch < OBD::CH_COUNT; ch++) {
+
+        if (strcmp(valueText[ch], lastValueText[ch]) != 0 || valueColor[ch] != lastValueColor[ch]) {
+            drawTextWithBackground(tft, valueText[ch], 100, ROW_Y[ch], TL_DATUM, 2, valueColor[ch], TFT_BLACK, 110);
+            strcpy(lastValueText[ch], valueText[ch]);
+            lastValueColor[ch] = valueColor[ch];
+        }
+
+        // Osiągnięta / docelowa częstotliwość [Hz]
+        const ObdScheduler::ChannelStats& cs = snap.channels[ch];
+        char rateText[32];
+        if (snap.polling && cs.periodMs > 0)
+            snprintf(rateText, sizeof(rateText), "%.2f/%.1f Hz", cs.rateMilliHz / 1000.0f, 1000.0f / cs.periodMs);
+        else
+            strcpy(rateText, "N/A");
+
+        if (strcmp(rateText, lastRateText[ch]) != 0) {
+            drawTextWithBackground(tft, rateText, 310, ROW_Y[ch], TR_DATUM, 2,
+                                   cs.stale ? TFT_ORANGE : TFT_WHITE, TFT_BLACK, 100);
+            strcpy(lastRateText[ch], rateText);
+        }
     }
-    
-    if (strcmp(fuelText, lastFuelText) != 0) {
-        drawTextWithBackground(tft, fuelText, 10, 140, TL_DATUM, 4, TFT_WHITE, TFT_BLACK, 300);
-        strcpy(lastFuelText, fuelText);
+
+    // Czas odpowiedzi i zajętość łącza (bez połączenia - stan i liczba utrat łącza)
+    const ObdScheduler::LinkStats& link = snap.link;
+    char linkText[48];
+    if (snap.connection != ObdConnection::READY) {
+        snprintf(linkText, sizeof(linkText), "%s, %lu losses", ObdConnection::label(snap.connection),
+                 (unsigned long)snap.connectionStats.linkLosses);
+    } else {
+        snprintf(linkText, sizeof(linkText), "%lu ms, load %u%%, gap %lu ms",
+                 (unsigned long)link.latencyMs, link.loadPct, (unsigned long)link.gapMs);
+    }
+
+    if (strcmp(linkText, lastLinkText) != 0) {
+        drawTextWithBackground(tft, linkText, 100, 150, TL_DATUM, 2,
+                               snap.connection == ObdConnection::READY ? TFT_WHITE : TFT_ORANGE, TFT_BLACK, 210);
+        strcpy(lastLinkText, linkText);
+    }
+
+    // Uruchomienie ELM327: czas do gotowości, pamięć pojazdu, źródło spalania (po każdym połączeniu)
+    const OBD::BringUp& bringUp = snap.bringUp;
+    char initText[48];
+    if (bringUp.vehicle.version == 0 || bringUp.outcome == ObdDiscovery::FAILED)
+        strcpy(initText, "N/A");
+    else
+        snprintf(initText, sizeof(initText), "%lu ms, %s, fuel %s", (unsigned long)bringUp.durationMs,
+                 bringUp.outcome == ObdDiscovery::CACHED ? "cached" : "discovered",
+                 ObdDiscovery::fuelSourceLabel(bringUp.vehicle.fuelSource));
+
+    if (strcmp(initText, lastInitText) != 0) {
+        drawTextWithBackground(tft, initText, 100, 175, TL_DATUM, 2, TFT_WHITE, TFT_BLACK, 210);
+        strcpy(lastInitText, initText);
     }
 }
 
@@ -74,4 +141,12 @@ void handleObdDebugTouch(uint16_t x, uint16_t y) {
         currentScreen = SCREEN_OBD;
         return;
     }
+
+    // Dotknięcie wiersza - odczyt kanału poza kolejnością
+    for (int ch = 0; ch < OBD::CH_COUNT; ch++) {
+        if (y >= ROW_Y[ch] - 5 && y < ROW_Y[ch] + 25) {
+            OBD::requestRefresh((OBD::Channel)ch);
+            return;
+        }
+    }
 }
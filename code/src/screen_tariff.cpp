@@ -3,24 +3,78 @@
 #include "gui_elements.h"
 #include "screen_manager.h"
 #include "screen_home.h"
-#include <EEPROM.h>
+#include "settings_store.h"
+#include "fare_engine.h"
+#include "../cabulator_settings.h"
 #include <Arduino.h>
+#include <SD.h>
 
 static TFT_eSPI* tftPtr = nullptr;
 static Background* bgTariff = nullptr;
 
-// Adresy w EEPROM
-#define EEPROM_TARIFF_VALUE_ADDR 10
-#define EEPROM_TARIFF_MODE_ADDR 14
-
 // Globalne zmienne taryfy
 float tariffValue = 3.00f;
 TariffMode tariffMode = TARIFF_PER_KM;
 
-void loadTariffFromEEPROM() {
+// Taryfa wieloskładnikowa z karty SD (ma pierwszeństwo przed prostą taryfą)
+static TariffTable fileTariff;
+static bool fileTariffLoaded = false;
+
+// Przekazanie taryfy do licznika przejazdu (stawka w groszach)
+static void applyTariffToFare() {
+    if (fileTariffLoaded)
+        Fare::setTable(fileTariff);
+    else
+        Fare::setTariff((uint8_t)tariffMode, (uint32_t)lroundf(tariffValue * 100.0f));
+}
+
+bool loadTariffTable() {
+
+    File f = SD.open(TARIFF::FILE_PATH, FILE_READ);
+    if (!f) {
+        Serial.println("[TARIFF] No tariff file, using simple tariff");
+        return false;
+    }
+
+    size_t size = f.size();
+    if (size == 0 || size > (size_t)TARIFF::FILE_MAX_BYTES) {
+        Serial.printf("[TARIFF] ERROR: Tariff file size %u out of range\n", (unsigned)size);
+        f.close();
+        return false;
+    }
+
+    char* text = (char*)malloc(size + 1);
+    if (!text) { f.close(); return false; }
+    size_t n = f.read((uint8_t*)text, size);
+    f.close();
+    text[n] = '\0';
+
+    char err[48];
+    TariffTable table;
+    bool ok = TariffTable::compile(text, table, err, sizeof(err));
+    free(text);
+
+    if (!ok) {
+        Serial.printf("[TARIFF] ERROR: %s: %s\n", TARIFF::FILE_PATH, err);
+        return false;
+    }
+
+    fileTariff = table;
+    fileTariffLoaded = true;
+    applyTariffToFare();
+    Serial.printf("[TARIFF] Tariff file loaded: mode=%u, flagfall=%lu gr, bands=%u, waiting=%lu gr/min, holidays=%u\n",
+        table.mode, (unsigned long)table.flagFallGr, table.bandCount,
+        (unsigned long)table.waitRateGrPerMin, table.holidayCount);
+    return true;
+}
+
+void loadTariffSettings() {
+
+    Settings::Tariff saved = { tariffValue, (uint8_t)tariffMode };
+    if (!Settings::getTariff(saved))
+        Serial.println("[TARIFF] No saved tariff, using defaults");
 
-    Serial.print("[TARIFF] tariff loaded from EEPROM: \n");
-    EEPROM.get(EEPROM_TARIFF_VALUE_ADDR, tariffValue);
+    tariffValue = saved.value;
     Serial.print("[TARIFF] Loaded value: ");
     Serial.println(tariffValue, 4);
 
@@ -30,19 +84,20 @@ void loadTariffFromEEPROM() {
         tariffValue = 3.00f; // default
     }
 
-    uint8_t mode = EEPROM.read(EEPROM_TARIFF_MODE_ADDR);
+    uint8_t mode = saved.mode;
     Serial.print("[TARIFF] Loaded mode: ");
     Serial.println(mode);
     if (mode > 1) mode = 0;
     tariffMode = (TariffMode)mode;
+    applyTariffToFare();
 }
 
-void saveTariffToEEPROM() {
+void saveTariffSettings() {
 
-    EEPROM.put(EEPROM_TARIFF_VALUE_ADDR, tariffValue);
-    EEPROM.write(EEPROM_TARIFF_MODE_ADDR, (uint8_t)tariffMode);
-    EEPROM.commit();
-    Serial.print("[TARIFF] Tariff saved to EEPROM: \n");
+    Settings::Tariff tariff = { tariffValue, (uint8_t)tariffMode };
+    Settings::putTariff(tariff);
+    applyTariffToFare();
+    Serial.print("[TARIFF] Tariff saved: \n");
     Serial.print("[TARIFF] Saved value: ");
     Serial.println(tariffValue, 4);
     Serial.print("[TARIFF] Saved mode: ");
@@ -120,7 +175,7 @@ void handleTariffTouch(uint16_t x, uint16_t y) {
     // Back
     if (x >= 260 && x < 310 && y >= 10 && y < 50) {
         
-        saveTariffToEEPROM();
+        saveTariffSettings();
         initHomeScreen(tftPtr);
         currentScreen = SCREEN_HOME;
         return;
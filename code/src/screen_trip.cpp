@@ -9,17 +9,12 @@
 #include "screen_manager.h"
 #include "screen_home.h"
 #include "sd_manager.h"
+#include "fare_engine.h"
 
 #include <Arduino.h>
-#include <EEPROM.h>
+#include "settings_store.h"
 #include "esp_task_wdt.h"
 
-// EEPROM adresy dla danych trasy (po tariff: bajt 15+)
-#define TRIP_EEPROM_VALID_FLAG 15    // 1 bajt - flaga ważności danych
-#define TRIP_EEPROM_DISTANCE 16      // 4 bajty - dystans (float)
-#define TRIP_EEPROM_FUEL 20          // 4 bajty - paliwo (float)
-#define TRIP_EEPROM_PAUSED 24        // 1 bajt - flaga pauzowania
-
 // Bufory tekstów do aktualizacji tylko przy zmianie
 bool tripActive = false;
 bool tripPaused = false;
@@ -29,73 +24,63 @@ static char lastFuelText[32] = "";
 static TFT_eSPI* tftPtr = nullptr;
 static Background* bgTrip = nullptr;
 
-// Dane trasy (globalne, liczone w tle)
-float distanceTraveled = 0.0f; // w km
-float fuelUsed = 0.0f;         // w litrach
+// Dane trasy liczone w tle przez Fare (fare_engine.h)
 bool obdErrorPending = false;  // Flaga błędu OBD do obsługi w pętli głównej
 bool resetTripLogicFlag = false;  // Flaga resetu logiki tripa
 
-// Zapisanie danych trasy do EEPROM
-void saveTripDataToEEPROM() {
-
-    // Flaga ważności - 0xAB oznacza że dane są ważne
-    EEPROM.write(TRIP_EEPROM_VALID_FLAG, 0xAB);
-    
-    // Zapisz dystans (float = 4 bajty)
-    EEPROM.writeFloat(TRIP_EEPROM_DISTANCE, distanceTraveled);
-    
-    // Zapisz zużycie paliwa (float = 4 bajty)
-    EEPROM.writeFloat(TRIP_EEPROM_FUEL, fuelUsed);
-    
-    // Zapisz stan pauzy (1 bajt)
-    EEPROM.write(TRIP_EEPROM_PAUSED, tripPaused ? 1 : 0);
-    
-    // Zatwierdź zapisy
-    EEPROM.commit();
-    
-    Serial.printf("[TRIP] Saved to EEPROM: dist=%.2f km, fuel=%.2f L, paused=%d\n", distanceTraveled, fuelUsed, tripPaused);
+// Zapisanie checkpointu trasy (jeden rekord w magazynie ustawień)
+void saveTripCheckpoint() {
+
+    FareEngine::Snapshot fare = Fare::snapshot();
+    Settings::TripCheckpoint cp;
+    cp.distanceM = fare.distanceM;
+    cp.fuelMl = fare.fuelMl;
+    cp.elapsedMs = fare.elapsedMs;
+    cp.waitingMs = fare.waitingMs;
+    cp.dueGr = fare.dueGr;
+    cp.waitingGr = fare.waitingGr;
+    cp.paused = tripPaused ? 1 : 0;
+    Settings::putTripCheckpoint(cp);
+
+    Serial.printf("[TRIP] Checkpoint saved: dist=%lu m, fuel=%lu ml, paused=%d\n",
+        (unsigned long)cp.distanceM, (unsigned long)cp.fuelMl, tripPaused);
 }
 
-// Wczytanie danych trasy z EEPROM
-bool loadTripDataFromEEPROM() {
-
-    // Sprawdź flagę ważności
-    uint8_t validFlag = EEPROM.read(TRIP_EEPROM_VALID_FLAG);
+// Wczytanie checkpointu trasy
+bool loadTripCheckpoint() {
 
-    if (validFlag != 0xAB) {
+    Settings::TripCheckpoint cp;
+    if (!Settings::getTripCheckpoint(cp)) {
 
-        Serial.println("[TRIP] No valid trip data in EEPROM");
+        Serial.println("[TRIP] No saved trip checkpoint");
         return false;
     }
     
-    // Wczytaj dane
-    distanceTraveled = EEPROM.readFloat(TRIP_EEPROM_DISTANCE);
-    fuelUsed = EEPROM.readFloat(TRIP_EEPROM_FUEL);
-    tripPaused = (EEPROM.read(TRIP_EEPROM_PAUSED) == 1);
+    Fare::restore(cp.distanceM, cp.fuelMl, cp.elapsedMs, cp.waitingMs, cp.dueGr, cp.waitingGr);
+    tripPaused = (cp.paused == 1);
     
-    // Wczytaj ścieżkę SD z EEPROM
+    // Wczytaj ścieżkę SD
     extern String currentTripPath;
     currentTripPath = SDManager::getLastTripPath();
     
-    Serial.printf("[TRIP] Loaded from EEPROM: dist=%.2f km, fuel=%.2f L, paused=%d\n", distanceTraveled, fuelUsed, tripPaused);
+    Serial.printf("[TRIP] Checkpoint loaded: dist=%lu m, fuel=%lu ml, paused=%d\n",
+        (unsigned long)cp.distanceM, (unsigned long)cp.fuelMl, tripPaused);
     
     return true;
 }
 
-// Czyszczenie danych trasy z EEPROM
-void clearTripDataFromEEPROM() {
+// Czyszczenie checkpointu trasy
+void clearTripCheckpoint() {
 
-    EEPROM.write(TRIP_EEPROM_VALID_FLAG, 0xFF); // Flaga nieważności
+    Settings::clearTripCheckpoint();
     SDManager::clearLastTripPath(); // Wyczyść ścieżkę SD
-    EEPROM.commit();
-    Serial.println("[TRIP] Trip data cleared from EEPROM");
+    Serial.println("[TRIP] Trip checkpoint cleared");
 }
 
 // Reset danych trasy
 void resetTripData() {
 
-    distanceTraveled = 0.0f;
-    fuelUsed = 0.0f;
+    Fare::reset();
     tripPaused = false;
     tripActive = false;
     resetTripLogicFlag = true;  // Zresetuj także logikę liczenia
@@ -110,12 +95,11 @@ void initTripScreen(TFT_eSPI* tft) {
     tftPtr = tft;
     if (bgTrip) { delete bgTrip; bgTrip = nullptr; }
     
-    // Próba wczytania poprzedniej sesji z EEPROM
-    if (!loadTripDataFromEEPROM()) {
+    // Próba wczytania poprzedniej sesji z checkpointu
+    if (!loadTripCheckpoint()) {
         
-        // Jeśli nie ma danych w EEPROM, RESET
-        distanceTraveled = 0.0f;
-        fuelUsed = 0.0f;
+        // Jeśli nie ma checkpointu, RESET
+        Fare::reset();
         tripPaused = false;
     }
     
@@ -129,7 +113,7 @@ void initTripScreen(TFT_eSPI* tft) {
     bgTrip->draw(*tft, *bgTrip->s_png, true);
     tripActive = true;
     Serial.println("[TRIP] Trip screen initialized - STARTING TRIP");
-    Serial.printf("[TRIP] OBD::btConnected=%d, OBD::elmReady=%d\n", OBD::btConnected, OBD::elmReady);
+    Serial.printf("[TRIP] OBD link: %s\n", ObdConnection::label(OBD::getConnectionState()));
     
 
     // ========== Tworzenie nowej sesji SD ==========
@@ -151,6 +135,7 @@ void initTripScreen(TFT_eSPI* tft) {
 
             // Trip już był aktywny, wznowienie istniejącej sesji
             Serial.printf("[TRIP] Resuming existing SD session: %s\n", currentTripPath.c_str());
+            SDManager::resumeTripSession(currentTripPath);
         }
     }
     
@@ -165,20 +150,14 @@ void initTripScreen(TFT_eSPI* tft) {
 void updateTripStatus(TFT_eSPI* tft) {
 
     if (!tft) return;
-    // Obliczenie należności
-    float currentDue = 0.0f;
-    int startedKm = (int)distanceTraveled + 1; // Każdy rozpoczęty km, minimum 1
-
-    if (tariffMode == TARIFF_PER_KM)
-        currentDue = startedKm * tariffValue;
-    else
-        currentDue = fuelUsed * tariffValue;
+    // Należność, rozpoczęte km i paliwo z jednego snapshotu
+    FareEngine::Snapshot fare = Fare::snapshot();
         
     // Bufory tekstów
     char dueBuf[32], distBuf[32], fuelBuf[32];
-    sprintf(dueBuf, "%.2f ZL", currentDue);
-    sprintf(distBuf, "%d km", startedKm);
-    sprintf(fuelBuf, "%.2f L", fuelUsed);
+    sprintf(dueBuf, "%lu.%02lu ZL", (unsigned long)(fare.dueGr / 100), (unsigned long)(fare.dueGr % 100));
+    sprintf(distBuf, "%lu km", (unsigned long)fare.startedKm);
+    sprintf(fuelBuf, "%lu.%02lu L", (unsigned long)(fare.fuelMl / 1000), (unsigned long)(fare.fuelMl % 1000 / 10));
     
     // Rysowanie tekstu tylko jeśli zmienne zmieniły wartość od ostatniego rysowania
     if (strcmp(dueBuf, lastDueText) != 0) {
@@ -245,25 +224,28 @@ void handleTripTouch(uint16_t x, uint16_t y) {
             extern String currentTripPath;
             if (SDManager::isReady() && !currentTripPath.isEmpty()) {
 
+                // Podsumowanie z tego samego snapshotu co ekran i zapis co 10 s
+                FareEngine::Snapshot fare = Fare::snapshot();
                 SDManager::TripData finalData;
-                finalData.distanceKm = distanceTraveled;
-                finalData.fuelUsedLiters = fuelUsed;
-                finalData.tariffMode = tariffMode;
-                finalData.tariffValue = tariffValue;
-                
-                // Wiliczenie całkowietego kosztu
-                int startedKm = (int)distanceTraveled + 1;
-                if (tariffMode == TARIFF_PER_KM)
-                    finalData.totalCost = startedKm * tariffValue;
-                else
-                    finalData.totalCost = fuelUsed * tariffValue;
+                finalData.distanceKm = fare.distanceM / 1000.0f;
+                finalData.fuelUsedLiters = fare.fuelMl / 1000.0f;
+                finalData.tariffMode = fare.mode;
+                finalData.tariffValue = fare.rateGr / 100.0f;
+                finalData.totalCost = fare.dueGr / 100.0f;
+
+                // Kontrola dystansu OBD z GPS i dystans przerw łącza
+                OBD::TripDistance dist = OBD::getTripDistance();
+                finalData.gpsDistanceKm = dist.gpsMm / 1000000.0f;
+                finalData.gpsFallbackKm = dist.fallbackMm / 1000000.0f;
+                finalData.divergencePct = OBD::divergencePct(dist);
                 
                 SDManager::finalizeTrip(finalData);
                 currentTripPath = "";  // Wyczyszczenie ścieżki bieżącej trasy
             }
             
             resetTripData();
-            clearTripDataFromEEPROM();
+            clearTripCheckpoint();
+            GPS::requestAidingSave();   // Miejsce końca kursu - start z danymi pomocniczymi po wyłączeniu zapłonu
             Serial.println("[TRIP] Trip ended and reset (exit from pause)");
         } else {
             // Trip nie jest wznowiony (nadal aktywny) - wracamy do home bez finalizacji
@@ -1,7 +1,10 @@
 #include "sd_manager.h"
 #include "gps_reader.h"
+#include "trip_logger.h"
+#include "trip_index.h"
+#include "timebase.h"
 #include "../cabulator_settings.h"
-#include <EEPROM.h>
+#include "settings_store.h"
 #include <time.h>
 #include <SPI.h>
 #include <SD.h>
@@ -17,9 +20,6 @@ static SPIClass sdSPI(HSPI);
 extern bool tripActive;
 extern String currentTripPath;
 
-// EEPROM adresy
-#define TRIP_PATH_EEPROM_ADDR 25    // 41 bajtów (25-65) - max 40 znaków + null terminator
-#define TRIP_PATH_EEPROM_MAX_LEN 40
 
 namespace SDManager {
 
@@ -29,43 +29,60 @@ namespace SDManager {
 
     // Funkcja pomocnicza: zwraca aktualną datę i czas w formacie YYYY-MM-DD_HH-MM-SS
     static String getTimestamp() {
-        // Najpierw spróbuj użyć czasu z GPS
-        if (GPS::lastFix.dateTimeValid) {
+        // Najpierw spróbuj użyć czasu UTC z podstawy czasu (GPS / PPS / holdover)
+        Timebase::Stamp utc = Timebase::nowUtc();
+        if (utc.source != ClockDiscipline::SOURCE_NONE) {
+            time_t t = (time_t)(utc.utcMs / 1000);
+            struct tm tm;
+            gmtime_r(&t, &tm);
             char buffer[20];
-            snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d_%02d-%02d-%02d",
-                GPS::lastFix.year, GPS::lastFix.month, GPS::lastFix.day,
-                GPS::lastFix.hour, GPS::lastFix.minute, GPS::lastFix.second);
+            strftime(buffer, sizeof(buffer), "%Y-%m-%d_%H-%M-%S", &tm);
             return String(buffer);
         }
         
-        // Fallback: użyj czasu systemowego
+        // Fallback: użyj czasu systemowego (UTC, jak nazwy z Timebase)
         time_t now = time(nullptr);
-        struct tm* timeinfo = localtime(&now);
-        
+        struct tm timeinfo;
+        gmtime_r(&now, &timeinfo);
+
         char buffer[20];
-        strftime(buffer, sizeof(buffer), "%Y-%m-%d_%H-%M-%S", timeinfo);
+        strftime(buffer, sizeof(buffer), "%Y-%m-%d_%H-%M-%S", &timeinfo);
         return String(buffer);
     }
 
     // Funkcja pomocnicza: zwraca aktualną datę w formacie YYYY-MM-DD
     static String getDateOnly() {
-        // Najpierw spróbuj użyć daty z GPS
-        if (GPS::lastFix.dateTimeValid) {
+        // Najpierw spróbuj użyć daty UTC z podstawy czasu
+        Timebase::Stamp utc = Timebase::nowUtc();
+        if (utc.source != ClockDiscipline::SOURCE_NONE) {
+            time_t t = (time_t)(utc.utcMs / 1000);
+            struct tm tm;
+            gmtime_r(&t, &tm);
             char buffer[11];
-            snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d",
-                GPS::lastFix.year, GPS::lastFix.month, GPS::lastFix.day);
+            strftime(buffer, sizeof(buffer), "%Y-%m-%d", &tm);
             return String(buffer);
         }
         
-        // Fallback: użyj czasu systemowego
+        // Fallback: użyj czasu systemowego (UTC, jak nazwy z Timebase)
         time_t now = time(nullptr);
-        struct tm* timeinfo = localtime(&now);
-        
+        struct tm timeinfo;
+        gmtime_r(&now, &timeinfo);
+
         char buffer[11];
-        strftime(buffer, sizeof(buffer), "%Y-%m-%d", timeinfo);
+        strftime(buffer, sizeof(buffer), "%Y-%m-%d", &timeinfo);
         return String(buffer);
     }
 
+    // Funkcja pomocnicza: wypisuje wpis indeksu tras na Serial
+    static void printTripEntry(const TripIndex::Entry& e) {
+
+        if (e.state == TripIndex::ENTRY_CLOSED)
+            Serial.printf("  -> %s (%.2f km, %.3f L, %.2f ZL)\n", e.name,
+                e.distanceM / 1000.0f, e.fuelMl / 1000.0f, e.costGr / 100.0f);
+        else
+            Serial.printf("  -> %s (open)\n", e.name);
+    }
+
     bool init() {
         Serial.println("[SD] SD card initializing...");
         
@@ -88,6 +105,10 @@ namespace SDManager {
         SD.mkdir("/logs");
         SD.mkdir("/logs/trips");
 
+        // Indeks tras - odbudowa z katalogów jeśli brakuje pliku lub jest uszkodzony
+        if (!TripIndex::begin())
+            Serial.println("[SD] WARNING: Trip index unavailable!");
+
         return true;
     }
 
@@ -96,23 +117,18 @@ namespace SDManager {
     }
 
     String getLastTripPath() {
-        char pathBuffer[TRIP_PATH_EEPROM_MAX_LEN + 1] = {0};
-        for (int i = 0; i < TRIP_PATH_EEPROM_MAX_LEN; i++) {
-            char c = EEPROM.read(TRIP_PATH_EEPROM_ADDR + i);
-            if (c == 0) break;
-            pathBuffer[i] = c;
-        }
+        char pathBuffer[Settings::TRIP_PATH_MAX_LEN + 1] = {0};
+        Settings::getTripPath(pathBuffer, sizeof(pathBuffer));
         String path(pathBuffer);
         if (path.length() > 0) {
-            Serial.printf("[SD] Loaded trip path from EEPROM: %s\n", path.c_str());
+            Serial.printf("[SD] Loaded trip path: %s\n", path.c_str());
         }
         return path;
     }
 
     void clearLastTripPath() {
-        EEPROM.write(TRIP_PATH_EEPROM_ADDR, 0);
-        EEPROM.commit();
-        Serial.println("[SD] Trip path cleared from EEPROM");
+        Settings::clearTripPath();
+        Serial.println("[SD] Trip path cleared");
     }
 
     String createTripSession() {
@@ -126,10 +142,11 @@ namespace SDManager {
         String tripPath = "/logs/trips/" + timestamp;
         
         // Debug: sprawdź źródło timestampu
-        if (GPS::lastFix.dateTimeValid) {
+        GPS::Fix fix = GPS::latest();
+        if (fix.dateTimeValid) {
             Serial.printf("[SD] Using GPS time: %04d-%02d-%02d %02d:%02d:%02d\n", 
-                GPS::lastFix.year, GPS::lastFix.month, GPS::lastFix.day,
-                GPS::lastFix.hour, GPS::lastFix.minute, GPS::lastFix.second);
+                fix.year, fix.month, fix.day,
+                fix.hour, fix.minute, fix.second);
         } else {
             Serial.println("[SD] WARNING: GPS time not valid, using system time!");
         }
@@ -143,19 +160,15 @@ namespace SDManager {
 
         currentTripPath = tripPath;
 
-        // Zapis ścieżki do EEPROM
-        for (int i = 0; i < (int)tripPath.length() && i < TRIP_PATH_EEPROM_MAX_LEN; i++) {
-            EEPROM.write(TRIP_PATH_EEPROM_ADDR + i, tripPath[i]);
-        }
-        // Null terminator
-        EEPROM.write(TRIP_PATH_EEPROM_ADDR + (int)min((int)tripPath.length(), TRIP_PATH_EEPROM_MAX_LEN), 0);
-        EEPROM.commit();
-        Serial.printf("[SD] Trip path saved to EEPROM: %s\n", tripPath.c_str());
+        // Zapis ścieżki do magazynu ustawień (wznowienie po restarcie)
+        Settings::putTripPath(tripPath.c_str());
+        Serial.printf("[SD] Trip path saved: %s\n", tripPath.c_str());
 
+#if !SD_LOG_BINARY_FORMAT
         // Tworzenie nagłówka pliku gps_log.csv
         File gpsFile = SD.open(tripPath + "/gps_log.csv", FILE_WRITE);
         if (gpsFile) {
-            gpsFile.println("Timestamp,Latitude,Longitude,Satellites,HDOP,Valid");
+            gpsFile.println("Timestamp,Latitude,Longitude,Satellites,HDOP,Valid,UtcMs,TimeSource");
             gpsFile.close();
             Serial.println("[SD] File gps_log.csv created");
         }
@@ -163,80 +176,37 @@ namespace SDManager {
         // Tworzenie nagłówka pliku obd_log.csv (dane tripu co 10 sekund)
         File obdFile = SD.open(tripPath + "/obd_log.csv", FILE_WRITE);
         if (obdFile) {
-            obdFile.println("Timestamp,DistanceKm,FuelLiters,TotalCost");
+            obdFile.println("Timestamp,DistanceKm,FuelLiters,TotalCost,UtcMs,TimeSource");
             obdFile.close();
             Serial.println("[SD] File obd_log.csv created");
         }
+#endif
+        // W formacie binarnym nagłówki gps_log.bin/obd_log.bin zapisuje task loggera
 
         // Tworzenie nagłówka pliku trip_summary.csv (podsumowanie na koniec)
         File summaryFile = SD.open(tripPath + "/trip_summary.csv", FILE_WRITE);
         if (summaryFile) {
-            summaryFile.println("Timestamp,DistanceKm,FuelLiters,TariffMode,TariffValue,TotalCost");
+            summaryFile.println("Timestamp,DistanceKm,FuelLiters,TariffMode,TariffValue,TotalCost,GpsDistanceKm,GpsFallbackKm,ObdGpsDivergencePct,UtcMs,TimeSource");
             summaryFile.close();
             Serial.println("[SD] File trip_summary.csv created");
         }
 
-        return tripPath;
-    }
-
-    bool saveTripData(const String& tripPath, const TripData& data) {
-
-        if (!sdReady) {
-
-            Serial.println("[SD] ERROR: SD card is not ready!");
-            return false;
-        }
-
-        File tripFile = SD.open(tripPath + "/trip_data.csv", FILE_APPEND);
-        if (!tripFile) {
-
-            Serial.println("[SD] ERROR: Failed to open trip_data.csv file!");
-            return false;
-        }
-
-        // FORMAT DANYCH TRIPU
-        // Format: Timestamp,DistanceKm,FuelLiters,TariffMode,TariffValue,TotalCost
-        String line = String(millis()) + ",";
-        line += String(data.distanceKm, 2) + ",";
-        line += String(data.fuelUsedLiters, 3) + ",";
-        line += String(data.tariffMode) + ",";
-        line += String(data.tariffValue, 2) + ",";
-        line += String(data.totalCost, 2);
+        // Wpis OPEN w indeksie tras
+        if (!TripIndex::appendOpen(tripPath))
+            Serial.println("[SD] WARNING: Failed to add trip to index!");
 
-        tripFile.println(line);
-        tripFile.close();
+        // Od tego momentu rekordy trasy idą przez bufor loggera
+        TripLogger::openSession(tripPath);
 
-        return true;
+        return tripPath;
     }
 
-    bool saveGPSData(const String& tripPath, const GPSData& data) {
-
-        if (!sdReady) {
-
-            Serial.println("[SD] ERROR: SD card is not ready!");
-            return false;
-        }
-
-        File gpsFile = SD.open(tripPath + "/gps_log.csv", FILE_APPEND);
-        if (!gpsFile) {
-
-            Serial.println("[SD] ERROR: Failed to open gps_log.csv file!");
-            return false;
-        }
-
-        // FORMAT DANYCH GPS    
-        // Format: Timestamp,Latitude,Longitude,Satellites,HDOP,Valid
-        String line = String(data.timestamp) + ",";
-        line += String(data.latitude, 6) + ",";
-        line += String(data.longitude, 6) + ",";
-        line += String(data.satellites) + ",";
-        line += String(data.hdop) + ",";
-        line += (data.valid ? "1" : "0");
+    void resumeTripSession(const String& tripPath) {
 
-        gpsFile.println(line);
-        gpsFile.close();
+        if (!sdReady || tripPath.isEmpty()) return;
 
-        return true;
+        Serial.printf("[SD] Resuming trip session: %s\n", tripPath.c_str());
+        TripLogger::openSession(tripPath);
     }
 
     void listTrips() {
@@ -248,29 +218,39 @@ namespace SDManager {
         }
 
         Serial.println("[SD] === AVAILABLE TRIPS ===");
-        File root = SD.open("/logs/trips");
-
-        if (!root || !root.isDirectory()) {
-
-            Serial.println("[SD] Trips folder is missing or is a file!");
-            return;
-        }
 
-        File file = root.openNextFile();
+        // Stronicowany odczyt indeksu - wpis zastąpiony przez kolejny wpis
+        // o tej samej nazwie (OPEN -> CLOSED) nie jest wypisywany
+        TripIndex::Entry page[8];
+        TripIndex::Entry prev;
+        bool havePrev = false;
         int tripCount = 0;
+        uint32_t total = TripIndex::count();
 
-        while (file) {
+        for (uint32_t first = 0; first < total; ) {
 
-            if (file.isDirectory()) {
+            size_t n = TripIndex::readPage(first, page, 8);
+            if (n == 0) break;
 
-                Serial.println("  -> " + String(file.name()));
-                tripCount++;
+            for (size_t i = 0; i < n; i++) {
+
+                if (page[i].state == 0) continue;  // Błędne CRC
+                if (havePrev && strcmp(prev.name, page[i].name) != 0) {
+                    printTripEntry(prev);
+                    tripCount++;
+                }
+                prev = page[i];
+                havePrev = true;
             }
-            file = root.openNextFile();
+            first += n;
+        }
+
+        if (havePrev) {
+            printTripEntry(prev);
+            tripCount++;
         }
 
         Serial.println("[SD] Total trips: " + String(tripCount));
-        root.close();
     }
 
     bool getLastTrip(String& tripPath) {
@@ -281,38 +261,21 @@ namespace SDManager {
             return false;
         }
 
-        File root = SD.open("/logs/trips");
-        if (!root || !root.isDirectory())
-            return false;
-
-        String lastTripName = "";
-        File file = root.openNextFile();
-
-        while (file) {
-
-            if (file.isDirectory()) {
-
-                String fileName = String(file.name());
-                if (fileName > lastTripName)
-                    lastTripName = fileName;
-            }
-            file = root.openNextFile();
-        }
-        root.close();
-
-        if (lastTripName.isEmpty())
+        // O(1) - ostatni wpis indeksu jest trzymany w RAM
+        TripIndex::Entry last;
+        if (!TripIndex::getLast(last))
             return false;
 
-        tripPath = "/logs/trips/" + lastTripName;
+        tripPath = TripIndex::pathOf(last);
         return true;
     }
 
     void onGPSFix(const GPSData& data) {
 
         // Callback wywoływany przez GPS gdy pojawi się nowy fix
-        // Sprawdzenie czy sesja tripu jest aktywna
+        // Sprawdzenie czy sesja tripu jest aktywna - zapis idzie przez bufor loggera
         if (tripActive && isReady() && !currentTripPath.isEmpty())
-            saveGPSData(currentTripPath, data);
+            TripLogger::logGPS(data);
     }
 
     void onTripUpdate(const TripUpdateData& data) {
@@ -321,65 +284,39 @@ namespace SDManager {
         // Sprawdzenie czy sesja tripu jest aktywna
         if (tripActive && isReady() && !currentTripPath.isEmpty()) {
 
-            File obdFile = SD.open(currentTripPath + "/obd_log.csv", FILE_APPEND);
-            if (!obdFile) {
-                Serial.println("[SD] ERROR: Failed to open obd_log.csv file!");
+            if (!TripLogger::logTripUpdate(data)) {
+                Serial.println("[SD] WARNING: Trip update dropped - logger queue full!");
                 return;
             }
 
-            // FORMAT: Timestamp,DistanceKm,FuelLiters,TotalCost
-            String line = String(data.timestamp) + ",";
-            line += String(data.distanceKm, 2) + ",";
-            line += String(data.fuelUsedLiters, 3) + ",";
-            line += String(data.totalCost, 2);
-
-            obdFile.println(line);
-            obdFile.close();
-
-            Serial.printf("[SD] Trip update logged: dist=%.2f km, fuel=%.2f L, cost=%.2f\n",
+            Serial.printf("[SD] Trip update queued: dist=%.2f km, fuel=%.2f L, cost=%.2f\n",
                 data.distanceKm, data.fuelUsedLiters, data.totalCost);
         }
     }
 
     void finalizeTrip(const TripData& data) {
-        // Finalizacja sesji tripu - zapisanie podsumowania do trip_summary.csv
+        // Finalizacja sesji tripu - podsumowanie trafia do trip_summary.csv przez logger
         if (!isReady() || currentTripPath.isEmpty()) {
             Serial.println("[SD] ERROR: Cannot finalize - SD path is missing!");
             return;
         }
 
         Serial.println("[SD] Finalizing trip session...");
-        
-        String summaryPath = currentTripPath + "/trip_summary.csv";
-        
-        // Sprawdź czy plik istnieje, jeśli nie - utwórz z nagłówkiem
-        if (!SD.exists(summaryPath)) {
-            Serial.println("[SD] trip_summary.csv doesn't exist, creating with header...");
-            File summaryFile = SD.open(summaryPath, FILE_WRITE);
-            if (summaryFile) {
-                summaryFile.println("Timestamp,DistanceKm,FuelLiters,TariffMode,TariffValue,TotalCost");
-                summaryFile.close();
-            }
-        }
-        
-        File summaryFile = SD.open(summaryPath, FILE_APPEND);
-        if (!summaryFile) {
-            Serial.println("[SD] ERROR: Failed to open trip_summary.csv file!");
-            return;
-        }
 
-        // FORMAT: Timestamp,DistanceKm,FuelLiters,TariffMode,TariffValue,TotalCost
-        String line = String(millis()) + ",";
-        line += String(data.distanceKm, 2) + ",";
-        line += String(data.fuelUsedLiters, 3) + ",";
-        line += String(data.tariffMode) + ",";
-        line += String(data.tariffValue, 2) + ",";
-        line += String(data.totalCost, 2);
+        // Wpis CLOSED w indeksie tras
+        TripIndex::appendClose(currentTripPath,
+            (uint32_t)lroundf(data.distanceKm * 1000.0f),
+            (uint32_t)lroundf(data.fuelUsedLiters * 1000.0f),
+            (uint32_t)lroundf(data.totalCost * 100.0f));
 
-        summaryFile.println(line);
-        summaryFile.close();
+        // Task zapisu dopisze nagłówek jeśli plik jest pusty, zapisze podsumowanie
+        // i zamknie wszystkie pliki sesji
+        if (!TripLogger::logSummary(data))
+            Serial.println("[SD] ERROR: Trip summary dropped - logger queue full!");
+        if (!TripLogger::closeSession())
+            Serial.println("[SD] ERROR: Trip close dropped - logger queue full!");
 
-        Serial.println("[SD] Trip summary saved");
+        Serial.println("[SD] Trip summary queued");
     }
 
 }  // namespace SDManager
@@ -0,0 +1,50 @@
+#include "settings_core.h"
+
+// Moduł celowo nie używa Arduino.h - kompiluje się również na hoście (RamFlash)
+
+SettingsCore::SettingsCore(FlashDevice& flash, uint32_t (*clockUs)())
+    : store(flash), clock(clockUs), mounted(false),
+      commits(0), lastCommitUs(0), maxCommitUs(0) {
+}
+
+bool SettingsCore::mount() {
+
+    mounted = store.mount();
+    return mounted;
+}
+
+bool SettingsCore::get(uint8_t key, void* buf, size_t len) {
+
+    if (!mounted) return false;
+    return store.get(key, buf, len);
+}
+
+bool SettingsCore::put(uint8_t key, const void* buf, size_t len) {
+
+    if (!mounted) return false;
+
+    uint32_t t0 = clock ? clock() : 0;
+    bool ok = store.put(key, buf, len);
+    uint32_t elapsed = clock ? clock() - t0 : 0;
+
+    commits++;
+    lastCommitUs = elapsed;
+    if (elapsed > maxCommitUs) maxCommitUs = elapsed;
+    return ok;
+}
+
+bool SettingsCore::remove(uint8_t key) {
+
+    if (!mounted) return false;
+    return store.remove(key);
+}
+
+SettingsCore::Stats SettingsCore::stats() const {
+
+    Stats s;
+    s.store = store.stats();
+    s.commits = commits;
+    s.lastCommitUs = lastCommitUs;
+    s.maxCommitUs = maxCommitUs;
+    return s;
+}
@@ -0,0 +1,230 @@
+#include "settings_store.h"
+#include "../cabulator_settings.h"
+#include <EEPROM.h>
+#include <esp_partition.h>
+
+namespace Settings {
+
+    // =============================================================================
+    // PARTYCJA FLASH JAKO FlashDevice
+    // =============================================================================
+
+    class PartitionFlash : public FlashDevice {
+    public:
+        static constexpr uint32_t SECTOR_SIZE = 4096;
+
+        bool attach(const char* label) {
+            part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+            return part != nullptr;
+        }
+
+        uint32_t sectorSize() const override { return SECTOR_SIZE; }
+        uint32_t sectorCount() const override { return part ? part->size / SECTOR_SIZE : 0; }
+
+        bool read(uint32_t addr, void* buf, size_t len) override {
+            return esp_partition_read(part, addr, buf, len) == ESP_OK;
+        }
+
+        bool write(uint32_t addr, const void* buf, size_t len) override {
+            return esp_partition_write(part, addr, buf, len) == ESP_OK;
+        }
+
+        bool erase(uint32_t sector) override {
+            return esp_partition_erase_range(part, sector * SECTOR_SIZE, SECTOR_SIZE) == ESP_OK;
+        }
+
+    private:
+        const esp_partition_t* part = nullptr;
+    };
+
+    static uint32_t clockUs() {
+        return micros();
+    }
+
+    static PartitionFlash flash;
+    static SettingsCore core(flash, clockUs);
+    static bool ready = false;
+    static SemaphoreHandle_t lock = nullptr;
+
+    // Stare adresy EEPROM (tylko do migracji)
+    static constexpr int LEGACY_BRIGHTNESS_ADDR = 0;
+    static constexpr int LEGACY_TARIFF_VALUE_ADDR = 10;
+    static constexpr int LEGACY_TARIFF_MODE_ADDR = 14;
+    static constexpr int LEGACY_TRIP_VALID_ADDR = 15;
+    static constexpr int LEGACY_TRIP_DISTANCE_ADDR = 16;
+    static constexpr int LEGACY_TRIP_FUEL_ADDR = 20;
+    static constexpr int LEGACY_TRIP_PAUSED_ADDR = 24;
+    static constexpr int LEGACY_TRIP_PATH_ADDR = 25;
+
+    // =============================================================================
+    // FUNKCJE POMOCNICZE
+    // =============================================================================
+
+    bool get(uint8_t key, void* buf, size_t len) {
+
+        if (!ready) return false;
+        xSemaphoreTake(lock, portMAX_DELAY);
+        bool ok = core.get(key, buf, len);
+        xSemaphoreGive(lock);
+        return ok;
+    }
+
+    bool put(uint8_t key, const void* buf, size_t len) {
+
+        if (!ready) return false;
+        xSemaphoreTake(lock, portMAX_DELAY);
+        bool ok = core.put(key, buf, len);
+        xSemaphoreGive(lock);
+
+        if (!ok) Serial.printf("[STORE] ERROR: Failed to write key %u\n", key);
+        return ok;
+    }
+
+    static bool remove(uint8_t key) {
+
+        if (!ready) return false;
+        xSemaphoreTake(lock, portMAX_DELAY);
+        bool ok = core.remove(key);
+        xSemaphoreGive(lock);
+        return ok;
+    }
+
+    // Jednorazowe przeniesienie danych ze starego układu EEPROM
+    static void migrateFromEEPROM() {
+
+        uint8_t migrated = 0;
+        if (get(KEY_MIGRATED, &migrated, sizeof(migrated))) return;
+
+        Serial.println("[STORE] Migrating legacy EEPROM settings...");
+        EEPROM.begin(STORAGE::LEGACY_EEPROM_SIZE);
+
+        uint8_t brightness = EEPROM.read(LEGACY_BRIGHTNESS_ADDR);
+        if (brightness >= 5 && brightness != 0xFF) putBrightness(brightness);
+
+        Tariff tariff;
+        EEPROM.get(LEGACY_TARIFF_VALUE_ADDR, tariff.value);
+        tariff.mode = EEPROM.read(LEGACY_TARIFF_MODE_ADDR);
+        if (!isnan(tariff.value) && tariff.value >= 0.01f && tariff.value <= 100.0f && tariff.mode <= 1)
+            putTariff(tariff);
+
+        if (EEPROM.read(LEGACY_TRIP_VALID_ADDR) == 0xAB) {
+
+            TripCheckpoint cp = {};
+            float distanceKm = EEPROM.readFloat(LEGACY_TRIP_DISTANCE_ADDR);
+            float fuelLiters = EEPROM.readFloat(LEGACY_TRIP_FUEL_ADDR);
+            if (!isnan(distanceKm) && distanceKm > 0) cp.distanceM = (uint32_t)lroundf(distanceKm * 1000.0f);
+            if (!isnan(fuelLiters) && fuelLiters > 0) cp.fuelMl = (uint32_t)lroundf(fuelLiters * 1000.0f);
+            cp.paused = EEPROM.read(LEGACY_TRIP_PAUSED_ADDR) == 1 ? 1 : 0;
+            putTripCheckpoint(cp);
+
+            char path[TRIP_PATH_MAX_LEN + 1] = {0};
+            for (size_t i = 0; i < TRIP_PATH_MAX_LEN; i++) {
+                char c = EEPROM.read(LEGACY_TRIP_PATH_ADDR + i);
+                if (c == 0 || (uint8_t)c == 0xFF) break;
+                path[i] = c;
+            }
+            if (path[0] == '/') putTripPath(path);
+        }
+
+        EEPROM.end();
+
+        migrated = 1;
+        put(KEY_MIGRATED, &migrated, sizeof(migrated));
+    }
+
+    // =============================================================================
+    // API
+    // =============================================================================
+
+    bool begin() {
+
+        if (!lock) lock = xSemaphoreCreateMutex();
+
+        if (!flash.attach(STORAGE::PARTITION_LABEL)) {
+            Serial.printf("[STORE] ERROR: Partition '%s' not found!\n", STORAGE::PARTITION_LABEL);
+            return false;
+        }
+
+        unsigned long t0 = micros();
+        if (!core.mount()) {
+            Serial.println("[STORE] ERROR: Failed to mount record store!");
+            return false;
+        }
+        ready = true;
+
+        RecordStore::Stats s = core.stats().store;
+        Serial.printf("[STORE] Mounted in %lu us: sector %u, free %u B, erases %u, corrupt %u\n",
+            micros() - t0, (unsigned)s.activeSector, (unsigned)s.freeBytes,
+            (unsigned)s.eraseCount, (unsigned)s.corruptRecords);
+
+        migrateFromEEPROM();
+        return true;
+    }
+
+    bool getBrightness(uint8_t& level) {
+        return get(KEY_BRIGHTNESS, &level, sizeof(level));
+    }
+
+    bool putBrightness(uint8_t level) {
+        return put(KEY_BRIGHTNESS, &level, sizeof(level));
+    }
+
+    bool getTariff(Tariff& out) {
+        return get(KEY_TARIFF, &out, sizeof(out));
+    }
+
+    bool putTariff(const Tariff& tariff) {
+        return put(KEY_TARIFF, &tariff, sizeof(tariff));
+    }
+
+    static_assert(offsetof(TripCheckpoint, waitingGr) == 24, "TripCheckpoint prefix must match the old record");
+
+    bool getTripCheckpoint(TripCheckpoint& out) {
+
+        if (get(KEY_TRIP_CHECKPOINT, &out, sizeof(out))) return true;
+
+        // Rekord zapisany przed dodaniem waitingGr - postój w należności przeniesionej
+        out.waitingGr = 0;
+        return get(KEY_TRIP_CHECKPOINT, &out, offsetof(TripCheckpoint, waitingGr));
+    }
+
+    bool putTripCheckpoint(const TripCheckpoint& cp) {
+        return put(KEY_TRIP_CHECKPOINT, &cp, sizeof(cp));
+    }
+
+    bool clearTripCheckpoint() {
+        return remove(KEY_TRIP_CHECKPOINT);
+    }
+
+    bool getTripPath(char* out, size_t outLen) {
+
+        char buf[TRIP_PATH_MAX_LEN + 1];
+        if (!get(KEY_TRIP_PATH, buf, sizeof(buf))) return false;
+        buf[TRIP_PATH_MAX_LEN] = '\0';
+        strncpy(out, buf, outLen - 1);
+        out[outLen - 1] = '\0';
+        return true;
+    }
+
+    bool putTripPath(const char* path) {
+
+        char buf[TRIP_PATH_MAX_LEN + 1] = {0};
+        strncpy(buf, path, TRIP_PATH_MAX_LEN);
+        return put(KEY_TRIP_PATH, buf, sizeof(buf));
+    }
+
+    bool clearTripPath() {
+        return remove(KEY_TRIP_PATH);
+    }
+
+    Stats getStats() {
+
+        Stats s = {};
+        if (!lock) return s;
+        xSemaphoreTake(lock, portMAX_DELAY);
+        s = core.stats();
+        xSemaphoreGive(lock);
+        return s;
+    }
+
+}  // namespace Settings
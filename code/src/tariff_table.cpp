@@ -0,0 +1,215 @@
+#include "tariff_table.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Moduł celowo nie używa Arduino.h - kompiluje się również na hoście
+
+// =============================================================================
+// FUNKCJE POMOCNICZE
+// =============================================================================
+
+static void setError(char* err, size_t errLen, int line, const char* msg) {
+    if (err && errLen) snprintf(err, errLen, "line %d: %s", line, msg);
+}
+
+// Maksymalna kwota w pliku taryfy [ZL] - większa to literówka (i przepełnienie uint32 w groszach)
+static constexpr uint32_t MONEY_MAX_ZL = 1000000;
+
+// Kwota "12.34" / "12,34" / "12" -> grosze (bez float)
+static bool parseMoney(const char* s, uint32_t& gr) {
+
+    if (!s || !*s) return false;
+    uint32_t whole = 0, frac = 0;
+    int fracDigits = 0;
+    const char* p = s;
+
+    if (*p < '0' || *p > '9') return false;
+    while (*p >= '0' && *p <= '9') {
+        whole = whole * 10 + (*p++ - '0');
+        if (whole > MONEY_MAX_ZL) return false;
+    }
+    if (*p == '.' || *p == ',') {
+        p++;
+        while (*p >= '0' && *p <= '9') {
+            if (fracDigits < 2) { frac = frac * 10 + (*p - '0'); fracDigits++; }
+            p++;
+        }
+    }
+    if (*p != '\0') return false;
+    if (fracDigits == 1) frac *= 10;
+    gr = whole * 100 + frac;
+    return true;
+}
+
+// Liczba całkowita z zakresu [lo, hi]
+static bool parseUint(const char* s, uint32_t lo, uint32_t hi, uint32_t& out) {
+
+    if (!s || !*s) return false;
+    char* end;
+    unsigned long v = strtoul(s, &end, 10);
+    if (*end != '\0' || v < lo || v > hi) return false;
+    out = (uint32_t)v;
+    return true;
+}
+
+// Liczba dni miesiąca dla świąt o stałej dacie (luty z 29 dniem)
+static const uint8_t DAYS_IN_MONTH[12] = { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+// Przedział "a-b" lub pojedyncza wartość "a"
+static bool parseRange(const char* s, uint32_t lo, uint32_t hi, uint32_t& a, uint32_t& b) {
+
+    char buf[16];
+    strncpy(buf, s, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    char* dash = strchr(buf, '-');
+    if (!dash) {
+        if (!parseUint(buf, lo, hi, a)) return false;
+        b = a;
+        return true;
+    }
+    *dash = '\0';
+    return parseUint(buf, lo, hi, a) && parseUint(dash + 1, lo, hi, b);
+}
+
+// =============================================================================
+// TARIFFTABLE
+// =============================================================================
+
+TariffTable TariffTable::simple(uint8_t mode, uint32_t rateGr) {
+
+    TariffTable t;
+    memset(&t, 0, sizeof(t));
+    memset(t.multPct, 100, sizeof(t.multPct));
+    t.mode = mode == MODE_LITRE ? MODE_LITRE : MODE_KM;
+    t.litreRateGr = rateGr;
+    t.bandCount = 1;
+    t.bands[0].fromKm = 0;
+    t.bands[0].rateGr = rateGr;
+    return t;
+}
+
+bool TariffTable::compile(const char* text, TariffTable& out, char* err, size_t errLen) {
+
+    TariffTable t = simple(MODE_KM, 0);
+    t.bandCount = 0;
+
+    char line[96];
+    int lineNo = 0;
+    const char* p = text;
+
+    while (p && *p) {
+
+        // Wydzielenie linii
+        const char* eol = strchr(p, '\n');
+        size_t len = eol ? (size_t)(eol - p) : strlen(p);
+        lineNo++;
+        if (len >= sizeof(line)) { setError(err, errLen, lineNo, "line too long"); return false; }
+        memcpy(line, p, len);
+        line[len] = '\0';
+        p = eol ? eol + 1 : nullptr;
+
+        char* hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+
+        // Podział na słowa
+        char* tok[5] = {nullptr};
+        char* save = nullptr;
+        int n = 0;
+        for (char* s = strtok_r(line, " \t\r", &save); s && n < 5; s = strtok_r(nullptr, " \t\r", &save))
+            tok[n++] = s;
+        if (n == 0) continue;
+
+        if (strcmp(tok[0], "mode") == 0 && n == 2) {
+
+            if (strcmp(tok[1], "km") == 0) t.mode = MODE_KM;
+            else if (strcmp(tok[1], "litre") == 0) t.mode = MODE_LITRE;
+            else { setError(err, errLen, lineNo, "mode must be km or litre"); return false; }
+
+        } else if (strcmp(tok[0], "flagfall") == 0 && n == 2) {
+
+            if (!parseMoney(tok[1], t.flagFallGr)) { setError(err, errLen, lineNo, "bad amount"); return false; }
+
+        } else if (strcmp(tok[0], "rate") == 0 && n == 2) {
+
+            if (!parseMoney(tok[1], t.litreRateGr)) { setError(err, errLen, lineNo, "bad amount"); return false; }
+
+        } else if (strcmp(tok[0], "band") == 0 && n == 3) {
+
+            Band b;
+            if (t.bandCount >= MAX_BANDS) { setError(err, errLen, lineNo, "too many bands"); return false; }
+            if (!parseUint(tok[1], 0, 100000, b.fromKm) || !parseMoney(tok[2], b.rateGr)) {
+                setError(err, errLen, lineNo, "bad band"); return false;
+            }
+            if (t.bandCount > 0 && b.fromKm <= t.bands[t.bandCount - 1].fromKm) {
+                setError(err, errLen, lineNo, "bands must be ascending"); return false;
+            }
+            t.bands[t.bandCount++] = b;
+
+        } else if (strcmp(tok[0], "waiting") == 0 && n == 3) {
+
+            uint32_t kmh;
+            if (!parseMoney(tok[1], t.waitRateGrPerMin) || !parseUint(tok[2], 1, 100, kmh)) {
+                setError(err, errLen, lineNo, "bad waiting"); return false;
+            }
+            t.waitBelowKmh = (uint8_t)kmh;
+
+        } else if (strcmp(tok[0], "mult") == 0 && n == 4) {
+
+            // Godzina końcowa nie jest objęta: 22-6 = 22:00-5:59, 0-24 = cała doba, 7 = 7:00-7:59
+            uint32_t d0, d1, h0, h1, pct;
+            if (!parseRange(tok[1], 1, 7, d0, d1) || !parseRange(tok[2], 0, 24, h0, h1)
+                    || !parseUint(tok[3], 1, 255, pct) || d1 < d0) {
+                setError(err, errLen, lineNo, "bad mult"); return false;
+            }
+            if (!strchr(tok[2], '-')) h1 = h0 + 1;
+            if (h0 > 23 || h0 == h1) { setError(err, errLen, lineNo, "bad mult"); return false; }
+            for (uint32_t d = d0; d <= d1; d++) {
+                // Przedział godzin może przechodzić przez północ (22-6)
+                uint32_t h = h0;
+                do {
+                    t.multPct[d - 1][h] = (uint8_t)pct;
+                    h = (h + 1) % 24;
+                } while (h != h1 % 24);
+            }
+
+        } else if (strcmp(tok[0], "holiday") == 0 && n == 3) {
+
+            uint32_t month, day, pct;
+            if (t.holidayCount >= MAX_HOLIDAYS) { setError(err, errLen, lineNo, "too many holidays"); return false; }
+            // Tylko postać MM-DD - sama liczba byłaby odczytana jako MM-MM
+            if (!strchr(tok[1], '-') || !parseRange(tok[1], 1, 31, month, day) || month > 12
+                    || day > DAYS_IN_MONTH[month - 1] || !parseUint(tok[2], 1, 255, pct)) {
+                setError(err, errLen, lineNo, "bad holiday"); return false;
+            }
+            t.holidays[t.holidayCount++] = { (uint8_t)month, (uint8_t)day, (uint8_t)pct };
+
+        } else {
+            setError(err, errLen, lineNo, "unknown rule");
+            return false;
+        }
+    }
+
+    if (t.mode == MODE_KM && (t.bandCount == 0 || t.bands[0].fromKm != 0)) {
+        setError(err, errLen, lineNo, "first band must start at 0 km");
+        return false;
+    }
+    if (t.mode == MODE_LITRE && t.litreRateGr == 0) {
+        setError(err, errLen, lineNo, "litre mode needs rate");
+        return false;
+    }
+
+    out = t;
+    return true;
+}
+
+uint8_t TariffTable::multiplierPct(uint8_t weekday, uint8_t hour, uint8_t month, uint8_t day) const {
+
+    if (weekday > 6 || hour > 23) return 100;
+
+    for (uint8_t i = 0; i < holidayCount; i++)
+        if (holidays[i].month == month && holidays[i].day == day) return holidays[i].pct;
+
+    return multPct[weekday][hour];
+}
@@ -0,0 +1,215 @@
+#include "timebase.h"
+#include "seqlock.h"
+#include "../cabulator_settings.h"
+#include <esp_timer.h>
+#include <sys/time.h>
+#include <time.h>
+
+namespace Timebase {
+
+// Zegar systemowy sprzed 2024 = nieustawiony (po włączeniu zasilania)
+static constexpr time_t CLOCK_VALID_UTC = 1704067200;
+
+static ClockDiscipline::Config disciplineConfig() {
+
+    ClockDiscipline::Config c;
+    c.windowS = TIMEBASE::WINDOW_S;
+    c.ppsWindowS = TIMEBASE::PPS_WINDOW_S;
+    c.minSpanS = TIMEBASE::MIN_SPAN_S;
+    c.maxPpm = TIMEBASE::MAX_PPM;
+    c.stepUs = TIMEBASE::STEP_MS * 1000;
+    c.holdoverMs = TIMEBASE::HOLDOVER_MS;
+    return c;
+}
+
+// Model - zapis wyłącznie z begin() (przed taskami) i z taska GPS
+static ClockDiscipline discipline(disciplineConfig());
+static Seqlock<ClockDiscipline::Model> published;
+static Stats stats = {};
+static portMUX_TYPE statsMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Ostatni impuls PPS (przerwanie)
+static int64_t ppsUs = 0;
+static uint32_t ppsCount = 0;
+static uint32_t ppsSeen = 0;                // ppsCount przy ostatniej epoce (task GPS)
+static portMUX_TYPE ppsMux = portMUX_INITIALIZER_UNLOCKED;
+
+static void IRAM_ATTR onPps() {
+
+    int64_t t = esp_timer_get_time();
+    portENTER_CRITICAL_ISR(&ppsMux);
+    ppsUs = t;
+    ppsCount++;
+    portEXIT_CRITICAL_ISR(&ppsMux);
+}
+
+static void publish() {
+
+    published.write(discipline.model());
+
+    portENTER_CRITICAL(&statsMux);
+    stats.discipline = discipline.stats();
+    stats.driftFitted = discipline.driftFitted();
+    portEXIT_CRITICAL(&statsMux);
+}
+
+static Stamp stampAt(const ClockDiscipline::Model& m, int64_t monoUs) {
+
+    Stamp s;
+    s.source = m.sourceAt(monoUs);
+    s.utcMs = s.source != ClockDiscipline::SOURCE_NONE ? (uint64_t)(m.utcAt(monoUs) / 1000) : 0;
+    return s;
+}
+
+// Zegar systemowy za modelem: płynna korekta lub skok
+static void syncSystemClock() {
+
+    const ClockDiscipline::Model& m = discipline.model();
+    if (m.source < ClockDiscipline::SOURCE_NMEA) return;
+
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    int64_t sys = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+    int64_t diff = m.utcAt(esp_timer_get_time()) - sys;
+    int64_t absDiff = diff < 0 ? -diff : diff;
+    if (absDiff <= (int64_t)TIMEBASE::CLOCK_SYNC_MS * 1000) return;
+
+    if (absDiff <= (int64_t)TIMEBASE::STEP_MS * 1000) {
+        struct timeval delta;
+        delta.tv_sec = (time_t)(diff / 1000000);
+        delta.tv_usec = (suseconds_t)(diff % 1000000);
+        if (adjtime(&delta, nullptr) == 0) {
+            portENTER_CRITICAL(&statsMux);
+            stats.clockSlews++;
+            portEXIT_CRITICAL(&statsMux);
+        }
+        return;
+    }
+
+    int64_t utc = m.utcAt(esp_timer_get_time());
+    tv.tv_sec = (time_t)(utc / 1000000);
+    tv.tv_usec = (suseconds_t)(utc % 1000000);
+    if (settimeofday(&tv, nullptr) != 0) {
+        Serial.println("[TIME] ERROR: Failed to set system time");
+        return;
+    }
+
+    portENTER_CRITICAL(&statsMux);
+    stats.clockSteps++;
+    portEXIT_CRITICAL(&statsMux);
+
+    struct tm t;
+    gmtime_r(&tv.tv_sec, &t);
+    Serial.printf("[TIME] System time set: %04d-%02d-%02d %02d:%02d:%02d UTC (was off by %lld ms)\n",
+        t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec, (long long)(diff / 1000));
+}
+
+void begin() {
+
+    // Zegar systemowy przetrwał restart ESP32 (brak utraty zasilania) - start modelu
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    if (tv.tv_sec > CLOCK_VALID_UTC) {
+        discipline.addReference(esp_timer_get_time(), (int64_t)tv.tv_sec * 1000000 + tv.tv_usec,
+                                TIMEBASE::SYSTEM_ACC_MS * 1000, ClockDiscipline::SOURCE_SYSTEM);
+        publish();
+        Serial.printf("[TIME] Starting from system clock (+/- %d ms)\n", TIMEBASE::SYSTEM_ACC_MS);
+    } else {
+        Serial.println("[TIME] UTC unknown until first GPS fix");
+    }
+
+    if (GPS::PIN_PPS >= 0) {
+        pinMode(GPS::PIN_PPS, INPUT);
+        attachInterrupt(digitalPinToInterrupt(GPS::PIN_PPS), onPps, RISING);
+        Serial.printf("[TIME] PPS input on GPIO%d\n", GPS::PIN_PPS);
+    }
+}
+
+void addGpsEpoch(int64_t burstUs, uint64_t utcMs) {
+
+    portENTER_CRITICAL(&ppsMux);
+    int64_t pulseUs = ppsUs;
+    uint32_t pulses = ppsCount;
+    portEXIT_CRITICAL(&ppsMux);
+
+    // Impuls PPS oznacza początek sekundy, której czas niesie następna paczka zdań
+    bool pps = false;
+    int32_t lagUs = 0;
+    if (pulses != ppsSeen && utcMs % 1000 == 0) {
+        int64_t lag = burstUs - pulseUs;
+        if (lag >= 0 && lag < 1000000) {
+            discipline.addReference(pulseUs, (int64_t)utcMs * 1000, TIMEBASE::PPS_ACC_US,
+                                    ClockDiscipline::SOURCE_PPS);
+            lagUs = (int32_t)lag;
+            pps = true;
+        }
+    }
+    ppsSeen = pulses;
+
+    if (!pps)
+        discipline.addReference(burstUs - TIMEBASE::NMEA_LATENCY_MS * 1000, (int64_t)utcMs * 1000,
+                                TIMEBASE::NMEA_ACC_MS * 1000, ClockDiscipline::SOURCE_NMEA);
+    publish();
+
+    portENTER_CRITICAL(&statsMux);
+    stats.epochs++;
+    stats.ppsPulses = pulses;
+    if (pps) {
+        stats.nmeaLagUs = stats.ppsUsed ? stats.nmeaLagUs + (lagUs - stats.nmeaLagUs) / 8 : lagUs;
+        stats.ppsUsed++;
+    }
+    portEXIT_CRITICAL(&statsMux);
+
+    syncSystemClock();
+}
+
+// =============================================================================
+// ODCZYT (dowolny task)
+// =============================================================================
+
+Stamp nowUtc() {
+    return stampAt(published.read(), esp_timer_get_time());
+}
+
+Stamp utcAt(uint32_t monoMs) {
+
+    // millis() = esp_timer_get_time() / 1000 obcięte do 32 bitów
+    int64_t now = esp_timer_get_time();
+    int32_t ageMs = (int32_t)((uint32_t)(now / 1000) - monoMs);
+    return stampAt(published.read(), now - (int64_t)ageMs * 1000);
+}
+
+uint32_t accuracyMs() {
+
+    ClockDiscipline::Model m = published.read();
+    if (m.source == ClockDiscipline::SOURCE_NONE) return UINT32_MAX;
+    return m.accuracyAt(esp_timer_get_time()) / 1000;
+}
+
+Stats getStats() {
+
+    portENTER_CRITICAL(&statsMux);
+    Stats copy = stats;
+    portEXIT_CRITICAL(&statsMux);
+    copy.model = published.read();
+    return copy;
+}
+
+void debugStatus() {
+
+    Stats st = getStats();
+    int64_t now = esp_timer_get_time();
+    Stamp s = stampAt(st.model, now);
+    const ClockDiscipline::Stats& ds = st.discipline;
+
+    Serial.printf("[TIME] UTC %llu ms (%s, +/- %lu ms), drift %+ld ppb%s, %lu refs, %lu rejected, %lu steps\n",
+        (unsigned long long)s.utcMs, ClockDiscipline::sourceName(s.source),
+        (unsigned long)(s.source ? st.model.accuracyAt(now) / 1000 : 0), (long)st.model.ppb,
+        st.driftFitted ? "" : " (assumed)", (unsigned long)ds.references, (unsigned long)ds.rejected,
+        (unsigned long)ds.steps);
+    if (GPS::PIN_PPS >= 0)
+        Serial.printf("[TIME] PPS %lu pulses, %lu used, NMEA %ld us after PPS\n",
+            (unsigned long)st.ppsPulses, (unsigned long)st.ppsUsed, (long)st.nmeaLagUs);
+}
+
+}  // namespace Timebase
@@ -0,0 +1,117 @@
+#include "track_simplifier.h"
+#include <math.h>
+
+// Moduł celowo nie używa Arduino.h - kompiluje się również na hoście
+
+// 1e-7 stopnia szerokości [mm]
+static constexpr float MM_PER_LAT_E7 = 11.1319f;
+
+TrackSimplifier::TrackSimplifier() : cfg() {
+    reset();
+}
+
+TrackSimplifier::TrackSimplifier(const Config& config) : cfg(config) {
+    reset();
+}
+
+void TrackSimplifier::reset() {
+
+    st = Stats();
+    anchor = Point();
+    last = Point();
+    haveAnchor = false;
+    pending = false;
+    mmPerLngE7 = MM_PER_LAT_E7;
+    toleranceMm2 = (float)cfg.toleranceMm * (float)cfg.toleranceMm;
+    count = 0;
+}
+
+void TrackSimplifier::anchorAt(const Point& p) {
+
+    anchor = p;
+    last = p;
+    haveAnchor = true;
+    pending = false;
+    count = 0;
+    mmPerLngE7 = MM_PER_LAT_E7 * cosf(p.latE7 * 1.745329e-9f);
+}
+
+TrackSimplifier::Offset TrackSimplifier::offset(const Point& p) const {
+
+    Offset o;
+    o.dtMs = p.timeMs - anchor.timeMs;
+    o.xMm = (float)(int32_t)((uint32_t)p.lngE7 - (uint32_t)anchor.lngE7) * mmPerLngE7;
+    o.yMm = (float)(int32_t)((uint32_t)p.latE7 - (uint32_t)anchor.latE7) * MM_PER_LAT_E7;
+    return o;
+}
+
+// Czy odcinek kotwica - end odtwarza każdy punkt okna w tolerancji (SED)
+bool TrackSimplifier::fits(const Offset& end) const {
+
+    float inv = end.dtMs ? 1.0f / (float)end.dtMs : 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        float f = (float)window[i].dtMs * inv;
+        float ex = window[i].xMm - f * end.xMm;
+        float ey = window[i].yMm - f * end.yMm;
+        if (ex * ex + ey * ey > toleranceMm2) return false;
+    }
+    return true;
+}
+
+uint8_t TrackSimplifier::add(const Point& p, bool force) {
+
+    st.points++;
+    if (!haveAnchor) {
+        anchorAt(p);
+        st.kept++;
+        return KEEP_CURRENT;
+    }
+
+    uint8_t keep = 0;
+    if (!force && p.valid == last.valid) {
+
+        // Przedłużenie odcinka (pozycja nieważnego fixu bez znaczenia - tylko odstęp)
+        Offset o = offset(p);
+        if (o.dtMs <= cfg.maxGapMs && count < WINDOW_MAX && (!p.valid || fits(o))) {
+            window[count++] = o;
+            last = p;
+            pending = true;
+            return 0;
+        }
+        if (count == WINDOW_MAX) st.windowFull++;
+
+        // Poprzedni punkt kończy odcinek i zostaje kotwicą
+        if (pending) {
+            keep |= KEEP_PREVIOUS;
+            st.kept++;
+            anchorAt(last);
+            o = offset(p);
+            if (o.dtMs <= cfg.maxGapMs) {
+                window[count++] = o;
+                last = p;
+                pending = true;
+                return keep;
+            }
+        }
+    }
+
+    // Punkt zachowany bez względu na tolerancję (wraz z poprzednim)
+    if (pending) {
+        keep |= KEEP_PREVIOUS;
+        st.kept++;
+    }
+    anchorAt(p);
+    st.kept++;
+    st.forced++;
+    return keep | KEEP_CURRENT;
+}
+
+bool TrackSimplifier::finish() {
+
+    bool keep = pending;
+    if (keep) st.kept++;
+    haveAnchor = false;
+    pending = false;
+    count = 0;
+    return keep;
+}
@@ -0,0 +1,298 @@
+#include "trip_index.h"
+#include "trip_log_format.h"
+#include <SD.h>
+#include <time.h>
+
+namespace TripIndex {
+
+    static const char* INDEX_PATH = "/logs/trips/index.bin";
+    static const char* TRIPS_DIR = "/logs/trips";
+    static constexpr uint32_t INDEX_MAGIC = 0x58495443;     // "CTIX"
+    static constexpr uint8_t INDEX_VERSION = 1;
+    static constexpr size_t HEADER_SIZE = 16;
+    static constexpr size_t ENTRY_SIZE = sizeof(Entry);
+    static_assert(sizeof(Entry) == 64, "TripIndex::Entry must be 64 bytes");
+
+    static bool ready = false;
+    static uint32_t entryCount = 0;
+    static Entry lastEntry = {};
+    static bool hasLast = false;
+
+    // =============================================================================
+    // FUNKCJE POMOCNICZE
+    // =============================================================================
+
+    static uint32_t entryCrc(const Entry& e) {
+        return TripLogFormat::crc32((const uint8_t*)&e, offsetof(Entry, crc));
+    }
+
+    // Nazwa folderu z pełnej ścieżki (/logs/trips/NAME -> NAME)
+    static void nameFromPath(const String& tripPath, char* out, size_t outLen) {
+
+        const char* p = tripPath.c_str();
+        const char* slash = strrchr(p, '/');
+        strncpy(out, slash ? slash + 1 : p, outLen - 1);
+        out[outLen - 1] = '\0';
+    }
+
+    // Czas rozpoczęcia z nazwy folderu YYYY-MM-DD_HH-MM-SS (UTC, Timebase) - bez mktime(),
+    // które liczy w strefie lokalnej (TZ)
+    static uint32_t timeFromName(const char* name) {
+
+        int year, month, day, hour, minute, second;
+        if (sscanf(name, "%4d-%2d-%2d_%2d-%2d-%2d", &year, &month, &day, &hour, &minute, &second) != 6)
+            return 0;
+        if (year < 1970 || month < 1 || month > 12 || day < 1 || day > 31) return 0;
+
+        // Dni od 1970-01-01 (kalendarz gregoriański, rok od marca)
+        int32_t y = year - (month <= 2);
+        int32_t era = y / 400;
+        uint32_t yoe = (uint32_t)(y - era * 400);
+        uint32_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+        uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        int32_t days = era * 146097 + (int32_t)doe - 719468;
+        return (uint32_t)days * 86400 + (uint32_t)((hour * 60 + minute) * 60 + second);
+    }
+
+    static uint32_t nowEpoch() {
+        time_t now = time(nullptr);
+        return now > 0 ? (uint32_t)now : 0;
+    }
+
+    static bool writeHeader(File& f) {
+
+        uint8_t hdr[HEADER_SIZE] = {0};
+        memcpy(hdr, &INDEX_MAGIC, 4);
+        hdr[4] = INDEX_VERSION;
+        hdr[5] = (uint8_t)ENTRY_SIZE;
+        return f.write(hdr, HEADER_SIZE) == HEADER_SIZE;
+    }
+
+    static bool append(Entry& e) {
+
+        e.crc = entryCrc(e);
+
+        File f = SD.open(INDEX_PATH, FILE_APPEND);
+        if (!f) {
+            Serial.println("[INDEX] ERROR: Failed to open index for append!");
+            return false;
+        }
+        bool ok = f.write((const uint8_t*)&e, ENTRY_SIZE) == ENTRY_SIZE;
+        f.close();
+
+        if (ok) {
+            entryCount++;
+            lastEntry = e;
+            hasLast = true;
+        }
+        return ok;
+    }
+
+    // Odczyt ostatniego wiersza trip_summary.csv do wpisu (dla odbudowy)
+    static void fillFromSummary(const String& dirPath, Entry& e) {
+
+        e.state = ENTRY_OPEN;
+
+        File f = SD.open(dirPath + "/trip_summary.csv", FILE_READ);
+        if (!f) return;
+
+        char buf[160];
+        size_t size = f.size();
+        size_t from = size > sizeof(buf) - 1 ? size - (sizeof(buf) - 1) : 0;
+        f.seek(from);
+        size_t n = f.read((uint8_t*)buf, sizeof(buf) - 1);
+        f.close();
+        buf[n] = '\0';
+
+        // Usunięcie końcowych znaków nowej linii i wybranie ostatniego wiersza
+        while (n > 0 && (buf[n - 1] == '\n' || buf[n - 1] == '\r')) buf[--n] = '\0';
+        char* line = strrchr(buf, '\n');
+        line = line ? line + 1 : buf;
+
+        // Format: Timestamp,DistanceKm,FuelLiters,TariffMode,TariffValue,TotalCost[,kolumny GPS]
+        unsigned long ts;
+        float dist, fuel, tariff, cost;
+        int mode;
+        if (sscanf(line, "%lu,%f,%f,%d,%f,%f", &ts, &dist, &fuel, &mode, &tariff, &cost) == 6) {
+
+            e.state = ENTRY_CLOSED;
+            e.distanceM = (uint32_t)lroundf(dist * 1000.0f);
+            e.fuelMl = (uint32_t)lroundf(fuel * 1000.0f);
+            e.costGr = (uint32_t)lroundf(cost * 100.0f);
+        }
+    }
+
+    static void makeEntry(const char* name, Entry& e) {
+
+        memset(&e, 0, sizeof(e));
+        strncpy(e.name, name, sizeof(e.name) - 1);
+        e.startTime = timeFromName(e.name);
+    }
+
+    // =============================================================================
+    // API
+    // =============================================================================
+
+    bool begin() {
+
+        ready = false;
+        entryCount = 0;
+        hasLast = false;
+
+        File f = SD.open(INDEX_PATH, FILE_READ);
+        if (!f) {
+            Serial.println("[INDEX] Index missing, rebuilding...");
+            return rebuild();
+        }
+
+        uint8_t hdr[HEADER_SIZE];
+        size_t size = f.size();
+        bool valid = size >= HEADER_SIZE && f.read(hdr, HEADER_SIZE) == HEADER_SIZE
+            && memcmp(hdr, &INDEX_MAGIC, 4) == 0 && hdr[4] == INDEX_VERSION
+            && hdr[5] == ENTRY_SIZE && (size - HEADER_SIZE) % ENTRY_SIZE == 0;
+
+        if (valid && size > HEADER_SIZE) {
+
+            // Weryfikacja tylko ostatniego wpisu - O(1) przy starcie
+            f.seek(size - ENTRY_SIZE);
+            valid = f.read((uint8_t*)&lastEntry, ENTRY_SIZE) == ENTRY_SIZE
+                && lastEntry.crc == entryCrc(lastEntry);
+            hasLast = valid;
+        }
+        f.close();
+
+        if (!valid) {
+            Serial.println("[INDEX] Index corrupt, rebuilding...");
+            return rebuild();
+        }
+
+        entryCount = (size - HEADER_SIZE) / ENTRY_SIZE;
+        ready = true;
+        Serial.printf("[INDEX] Trip index loaded: %u entries\n", (unsigned)entryCount);
+        return true;
+    }
+
+    bool rebuild() {
+
+        ready = false;
+        entryCount = 0;
+        hasLast = false;
+
+        SD.remove(INDEX_PATH);
+        File f = SD.open(INDEX_PATH, FILE_WRITE);
+        if (!f || !writeHeader(f)) {
+            Serial.println("[INDEX] ERROR: Cannot create index file!");
+            return false;
+        }
+        f.close();
+        ready = true;
+
+        File root = SD.open(TRIPS_DIR);
+        if (!root || !root.isDirectory()) {
+            Serial.println("[INDEX] Trips folder is missing, index is empty");
+            return true;
+        }
+
+        // Pierwsze przejście: nazwa najnowszej trasy (musi być ostatnim wpisem)
+        char newest[24] = "";
+        File file = root.openNextFile();
+        while (file) {
+            if (file.isDirectory() && strcmp(file.name(), newest) > 0) {
+                strncpy(newest, file.name(), sizeof(newest) - 1);
+                newest[sizeof(newest) - 1] = '\0';
+            }
+            file = root.openNextFile();
+        }
+
+        // Drugie przejście: wszystkie trasy poza najnowszą
+        root.rewindDirectory();
+        file = root.openNextFile();
+        Entry e;
+        while (file) {
+            if (file.isDirectory() && strcmp(file.name(), newest) != 0) {
+                makeEntry(file.name(), e);
+                fillFromSummary(String(TRIPS_DIR) + "/" + file.name(), e);
+                append(e);
+            }
+            file = root.openNextFile();
+        }
+        root.close();
+
+        if (newest[0] != '\0') {
+            makeEntry(newest, e);
+            fillFromSummary(String(TRIPS_DIR) + "/" + newest, e);
+            append(e);
+        }
+
+        Serial.printf("[INDEX] Trip index rebuilt: %u entries\n", (unsigned)entryCount);
+        return true;
+    }
+
+    bool appendOpen(const String& tripPath) {
+
+        if (!ready) return false;
+
+        Entry e;
+        char name[sizeof(e.name)];
+        nameFromPath(tripPath, name, sizeof(name));
+        makeEntry(name, e);
+        if (e.startTime == 0) e.startTime = nowEpoch();
+        e.state = ENTRY_OPEN;
+        return append(e);
+    }
+
+    bool appendClose(const String& tripPath, uint32_t distanceM, uint32_t fuelMl, uint32_t costGr) {
+
+        if (!ready) return false;
+
+        Entry e;
+        char name[sizeof(e.name)];
+        nameFromPath(tripPath, name, sizeof(name));
+        makeEntry(name, e);
+
+        // Zachowanie czasu startu z wpisu OPEN jeśli to ta sama trasa
+        if (hasLast && strcmp(lastEntry.name, e.name) == 0 && lastEntry.startTime != 0)
+            e.startTime = lastEntry.startTime;
+
+        e.endTime = nowEpoch();
+        e.distanceM = distanceM;
+        e.fuelMl = fuelMl;
+        e.costGr = costGr;
+        e.state = ENTRY_CLOSED;
+        return append(e);
+    }
+
+    bool getLast(Entry& out) {
+
+        if (!ready || !hasLast) return false;
+        out = lastEntry;
+        return true;
+    }
+
+    uint32_t count() {
+        return entryCount;
+    }
+
+    size_t readPage(uint32_t first, Entry* out, size_t maxEntries) {
+
+        if (!ready || first >= entryCount || maxEntries == 0) return 0;
+
+        File f = SD.open(INDEX_PATH, FILE_READ);
+        if (!f) return 0;
+
+        size_t n = min((size_t)(entryCount - first), maxEntries);
+        f.seek(HEADER_SIZE + (size_t)first * ENTRY_SIZE);
+        size_t got = f.read((uint8_t*)out, n * ENTRY_SIZE) / ENTRY_SIZE;
+        f.close();
+
+        for (size_t i = 0; i < got; i++) {
+            if (out[i].crc != entryCrc(out[i])) out[i].state = 0;
+        }
+        return got;
+    }
+
+    String pathOf(const Entry& entry) {
+        return String(TRIPS_DIR) + "/" + entry.name;
+    }
+
+}  // namespace TripIndex
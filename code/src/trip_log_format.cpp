@@ -0,0 +1,383 @@
+#include "trip_log_format.h"
+#include <string.h>
+
+// Moduł celowo nie używa Arduino.h - kompiluje się również na hoście
+// (tools/trip_log_to_csv.cpp)
+
+namespace TripLogFormat {
+
+    // =============================================================================
+    // FUNKCJE POMOCNICZE - little-endian, varint, zigzag
+    // =============================================================================
+
+    static inline void putU16(uint8_t* p, uint16_t v) {
+        p[0] = (uint8_t)v;
+        p[1] = (uint8_t)(v >> 8);
+    }
+
+    static inline void putU32(uint8_t* p, uint32_t v) {
+        p[0] = (uint8_t)v;
+        p[1] = (uint8_t)(v >> 8);
+        p[2] = (uint8_t)(v >> 16);
+        p[3] = (uint8_t)(v >> 24);
+    }
+
+    static inline uint16_t getU16(const uint8_t* p) {
+        return (uint16_t)(p[0] | (p[1] << 8));
+    }
+
+    static inline uint32_t getU32(const uint8_t* p) {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    static inline uint32_t zigzag(int32_t v) {
+        return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+    }
+
+    static inline int32_t unzigzag(uint32_t v) {
+        return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+    }
+
+    static inline uint64_t zigzag64(int64_t v) {
+        return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+    }
+
+    static inline int64_t unzigzag64(uint64_t v) {
+        return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+    }
+
+    // Zapis varint (LEB128), zwraca liczbę bajtów (1-5)
+    static inline size_t putVarint(uint8_t* p, uint32_t v) {
+        size_t n = 0;
+        while (v >= 0x80) {
+            p[n++] = (uint8_t)(v | 0x80);
+            v >>= 7;
+        }
+        p[n++] = (uint8_t)v;
+        return n;
+    }
+
+    // Odczyt varint, false przy przekroczeniu bufora lub zbyt długim zapisie
+    static inline bool getVarint(const uint8_t* p, size_t len, size_t& pos, uint32_t& out) {
+        uint32_t v = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            if (pos >= len) return false;
+            uint8_t b = p[pos++];
+            v |= (uint32_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) {
+                out = v;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Zapis varint 64-bit, zwraca liczbę bajtów (1-10)
+    static inline size_t putVarint64(uint8_t* p, uint64_t v) {
+        size_t n = 0;
+        while (v >= 0x80) {
+            p[n++] = (uint8_t)(v | 0x80);
+            v >>= 7;
+        }
+        p[n++] = (uint8_t)v;
+        return n;
+    }
+
+    static inline bool getVarint64(const uint8_t* p, size_t len, size_t& pos, uint64_t& out) {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 70; shift += 7) {
+            if (pos >= len) return false;
+            uint8_t b = p[pos++];
+            v |= (uint64_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) {
+                out = v;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // =============================================================================
+    // CRC32
+    // =============================================================================
+
+    uint32_t crc32(const uint8_t* data, size_t len, uint32_t crc) {
+
+        static const uint32_t table[16] = {
+            0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+            0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+            0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+            0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+        };
+
+        crc = ~crc;
+        for (size_t i = 0; i < len; i++) {
+            crc = table[(crc ^ data[i]) & 0x0F] ^ (crc >> 4);
+            crc = table[(crc ^ (data[i] >> 4)) & 0x0F] ^ (crc >> 4);
+        }
+        return ~crc;
+    }
+
+    // =============================================================================
+    // NAGŁÓWKI
+    // =============================================================================
+
+    size_t writeFileHeader(uint8_t* out, StreamType type) {
+
+        memset(out, 0, FILE_HEADER_SIZE);
+        putU32(out, FILE_MAGIC);
+        out[4] = FORMAT_VERSION;
+        out[5] = (uint8_t)type;
+        putU16(out + 6, (uint16_t)BLOCK_MAX);
+        return FILE_HEADER_SIZE;
+    }
+
+    bool readFileHeader(const uint8_t* in, StreamType& type) {
+
+        uint8_t version;
+        return readFileHeader(in, type, version);
+    }
+
+    bool readFileHeader(const uint8_t* in, StreamType& type, uint8_t& version) {
+
+        if (getU32(in) != FILE_MAGIC || in[4] < FORMAT_VERSION_MIN || in[4] > FORMAT_VERSION) return false;
+        if (in[5] != STREAM_GPS && in[5] != STREAM_OBD && in[5] != STREAM_CAPTURE) return false;
+        type = (StreamType)in[5];
+        version = in[4];
+        return true;
+    }
+
+    bool readBlockHeader(const uint8_t* in, BlockHeader& hdr) {
+
+        hdr.magic = getU16(in);
+        hdr.count = getU16(in + 2);
+        hdr.length = getU16(in + 4);
+        hdr.reserved = getU16(in + 6);
+        hdr.crc = getU32(in + 8);
+        return hdr.magic == BLOCK_MAGIC && hdr.length <= BLOCK_PAYLOAD_MAX;
+    }
+
+    // =============================================================================
+    // ENKODER
+    // =============================================================================
+
+    BlockEncoder::BlockEncoder(StreamType t) : type(t) {
+        reset();
+    }
+
+    void BlockEncoder::reset() {
+        len = 0;
+        count = 0;
+        memset(prev, 0, sizeof(prev));
+        prevUtc = 0;
+    }
+
+    // Znacznik UTC: różnica przesunięcia względem timestampu i 3 bity źródła
+    size_t BlockEncoder::putUtc(uint8_t* p, uint32_t timestampMs, uint64_t utcMs, uint8_t source) {
+
+        int64_t offset = source ? (int64_t)utcMs - timestampMs : 0;
+        size_t n = putVarint64(p, zigzag64(offset - prevUtc) << 3 | (source & 0x07));
+        prevUtc = offset;
+        return n;
+    }
+
+    bool BlockEncoder::add(const GpsSample& s) {
+
+        if (type != STREAM_GPS || len + RECORD_MAX > BLOCK_PAYLOAD_MAX) return false;
+
+        uint8_t* p = payload + len;
+        size_t n = 0;
+        n += putVarint(p + n, s.timestampMs - prev[0]);
+        n += putVarint(p + n, zigzag((int32_t)((uint32_t)s.lat - prev[1])));
+        n += putVarint(p + n, zigzag((int32_t)((uint32_t)s.lng - prev[2])));
+        p[n++] = (uint8_t)((s.valid ? 0x80 : 0x00) | (s.sats & 0x7F));
+        n += putVarint(p + n, s.hdop);
+        n += putUtc(p + n, s.timestampMs, s.utcMs, s.timeSource);
+
+        prev[0] = s.timestampMs;
+        prev[1] = (uint32_t)s.lat;
+        prev[2] = (uint32_t)s.lng;
+        len += n;
+        count++;
+        return true;
+    }
+
+    bool BlockEncoder::add(const ObdSample& s) {
+
+        if (type != STREAM_OBD || len + RECORD_MAX > BLOCK_PAYLOAD_MAX) return false;
+
+        uint8_t* p = payload + len;
+        size_t n = 0;
+        n += putVarint(p + n, s.timestampMs - prev[0]);
+        n += putVarint(p + n, zigzag((int32_t)(s.distanceM - prev[1])));
+        n += putVarint(p + n, zigzag((int32_t)(s.fuelMl - prev[2])));
+        n += putVarint(p + n, zigzag((int32_t)(s.costGr - prev[3])));
+        n += putUtc(p + n, s.timestampMs, s.utcMs, s.timeSource);
+
+        prev[0] = s.timestampMs;
+        prev[1] = s.distanceM;
+        prev[2] = s.fuelMl;
+        prev[3] = s.costGr;
+        len += n;
+        count++;
+        return true;
+    }
+
+    bool BlockEncoder::add(CaptureChunk& c) {
+
+        // Kanał, czas i długość - co najmniej 1 + 5 + 3 B, dane choćby po 1 B
+        constexpr size_t HEADER_MAX = 9;
+        if (type != STREAM_CAPTURE || c.channel >= CAPTURE_CHANNELS) return false;
+        if (len + HEADER_MAX + (c.channel == CAPTURE_LOST ? 0 : 1) > BLOCK_PAYLOAD_MAX) return false;
+
+        uint8_t* p = payload + len;
+        size_t n = 0;
+        p[n++] = c.channel;
+        n += putVarint(p + n, c.timeUs - prev[0]);
+
+        uint16_t take = c.len;
+        if (c.channel != CAPTURE_LOST && len + HEADER_MAX + take > BLOCK_PAYLOAD_MAX)
+            take = (uint16_t)(BLOCK_PAYLOAD_MAX - len - HEADER_MAX);
+        n += putVarint(p + n, take);
+        if (c.channel != CAPTURE_LOST) {
+            memcpy(p + n, c.data, take);
+            n += take;
+            c.data += take;
+        }
+
+        prev[0] = c.timeUs;
+        len += n;
+        count++;
+        c.len = (uint16_t)(c.len - (c.channel == CAPTURE_LOST ? c.len : take));
+        return c.len == 0;
+    }
+
+    size_t BlockEncoder::finish(uint8_t* out) {
+
+        if (count == 0) return 0;
+
+        putU16(out, BLOCK_MAGIC);
+        putU16(out + 2, count);
+        putU16(out + 4, (uint16_t)len);
+        putU16(out + 6, 0);
+        putU32(out + 8, crc32(payload, len));
+        memcpy(out + BLOCK_HEADER_SIZE, payload, len);
+
+        size_t total = BLOCK_HEADER_SIZE + len;
+        reset();
+        return total;
+    }
+
+    // =============================================================================
+    // DEKODER
+    // =============================================================================
+
+    bool BlockReader::begin(const BlockHeader& hdr, const uint8_t* payload, uint8_t formatVersion) {
+
+        data = payload;
+        len = hdr.length;
+        pos = 0;
+        remaining = 0;
+        memset(prev, 0, sizeof(prev));
+        prevUtc = 0;
+        version = formatVersion;
+
+        if (crc32(payload, hdr.length) != hdr.crc) return false;
+        remaining = hdr.count;
+        return true;
+    }
+
+    // Znacznik UTC rekordu (wersja 1 - brak, UTC nieznany)
+    bool BlockReader::getUtc(uint32_t timestampMs, uint64_t& utcMs, uint8_t& source) {
+
+        utcMs = 0;
+        source = 0;
+        if (version < 2) return true;
+
+        uint64_t v;
+        if (!getVarint64(data, len, pos, v)) return false;
+        prevUtc += unzigzag64(v >> 3);
+        source = (uint8_t)(v & 0x07);
+        if (source) utcMs = (uint64_t)((int64_t)timestampMs + prevUtc);
+        return true;
+    }
+
+    bool BlockReader::next(GpsSample& s) {
+
+        if (remaining == 0) return false;
+
+        uint32_t dt, dLat, dLng, hdop;
+        if (!getVarint(data, len, pos, dt)) return false;
+        if (!getVarint(data, len, pos, dLat)) return false;
+        if (!getVarint(data, len, pos, dLng)) return false;
+        if (pos >= len) return false;
+        uint8_t flags = data[pos++];
+        if (!getVarint(data, len, pos, hdop)) return false;
+        uint32_t t = prev[0] + dt;
+        if (!getUtc(t, s.utcMs, s.timeSource)) return false;
+
+        prev[0] += dt;
+        prev[1] += (uint32_t)unzigzag(dLat);
+        prev[2] += (uint32_t)unzigzag(dLng);
+
+        s.timestampMs = prev[0];
+        s.lat = (int32_t)prev[1];
+        s.lng = (int32_t)prev[2];
+        s.valid = (flags & 0x80) != 0;
+        s.sats = flags & 0x7F;
+        s.hdop = (uint16_t)hdop;
+        remaining--;
+        return true;
+    }
+
+    bool BlockReader::next(ObdSample& s) {
+
+        if (remaining == 0) return false;
+
+        uint32_t dt, dDist, dFuel, dCost;
+        if (!getVarint(data, len, pos, dt)) return false;
+        if (!getVarint(data, len, pos, dDist)) return false;
+        if (!getVarint(data, len, pos, dFuel)) return false;
+        if (!getVarint(data, len, pos, dCost)) return false;
+        uint32_t t = prev[0] + dt;
+        if (!getUtc(t, s.utcMs, s.timeSource)) return false;
+
+        prev[0] += dt;
+        prev[1] += (uint32_t)unzigzag(dDist);
+        prev[2] += (uint32_t)unzigzag(dFuel);
+        prev[3] += (uint32_t)unzigzag(dCost);
+
+        s.timestampMs = prev[0];
+        s.distanceM = prev[1];
+        s.fuelMl = prev[2];
+        s.costGr = prev[3];
+        remaining--;
+        return true;
+    }
+
+    bool BlockReader::next(CaptureChunk& c) {
+
+        if (remaining == 0 || pos >= len) return false;
+
+        uint8_t channel = data[pos++];
+        uint32_t dt, n;
+        if (channel >= CAPTURE_CHANNELS) return false;
+        if (!getVarint(data, len, pos, dt)) return false;
+        if (!getVarint(data, len, pos, n) || n > 0xFFFF) return false;
+
+        c.data = nullptr;
+        if (channel != CAPTURE_LOST) {
+            if (n > len - pos) return false;
+            c.data = data + pos;
+            pos += n;
+        }
+
+        prev[0] += dt;
+        c.timeUs = prev[0];
+        c.channel = channel;
+        c.len = (uint16_t)n;
+        remaining--;
+        return true;
+    }
+
+}  // namespace TripLogFormat
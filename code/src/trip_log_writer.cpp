@@ -0,0 +1,356 @@
+#include "trip_log_writer.h"
+#include "clock_discipline.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Moduł celowo nie używa Arduino.h - kompiluje się również na hoście
+
+static const char* const FILE_NAMES_CSV[TripLogWriter::STREAM_COUNT] = {
+    "/gps_log.csv",
+    "/obd_log.csv",
+    "/trip_summary.csv",
+    "/link_capture.bin"
+};
+
+static const char* const FILE_NAMES_BIN[TripLogWriter::STREAM_COUNT] = {
+    "/gps_log.bin",
+    "/obd_log.bin",
+    "/trip_summary.csv",
+    "/link_capture.bin"
+};
+
+static const char* const FILE_HEADERS[TripLogWriter::STREAM_COUNT] = {
+    "Timestamp,Latitude,Longitude,Satellites,HDOP,Valid,UtcMs,TimeSource\n",
+    "Timestamp,DistanceKm,FuelLiters,TotalCost,UtcMs,TimeSource\n",
+    "Timestamp,DistanceKm,FuelLiters,TariffMode,TariffValue,TotalCost,GpsDistanceKm,GpsFallbackKm,ObdGpsDivergencePct,UtcMs,TimeSource\n",
+    ""                                                          // binarny (TripLogFormat)
+};
+
+TripLogWriter::TripLogWriter(const Config& config, Storage& storage)
+    : cfg(config), storage(storage), st(), head(0), tail(0), count(0), session(false), lastSyncMs(0),
+      gpsEncoder(TripLogFormat::STREAM_GPS), obdEncoder(TripLogFormat::STREAM_OBD),
+      captureEncoder(TripLogFormat::STREAM_CAPTURE), track(config.track), trackStats() {
+
+    if (cfg.queueLen > QUEUE_MAX) cfg.queueLen = QUEUE_MAX;
+    if (cfg.controlSlots >= cfg.queueLen) cfg.controlSlots = cfg.queueLen - 1;
+    if (cfg.batchBytes > BATCH_MAX || cfg.batchBytes == 0) cfg.batchBytes = BATCH_MAX;
+
+    path[0] = '\0';
+    for (int s = 0; s < STREAM_COUNT; s++) {
+        streamOpen[s] = false;
+        streamFailed[s] = false;
+        batchLen[s] = 0;
+    }
+}
+
+// =============================================================================
+// BUFOR PIERŚCIENIOWY
+// =============================================================================
+
+bool TripLogWriter::push(const Record& rec) {
+
+    // Próbki nie zajmują miejsc zarezerwowanych dla rekordów sesji
+    bool control = rec.type != REC_GPS && rec.type != REC_UPDATE;
+    uint16_t limit = control ? cfg.queueLen : cfg.queueLen - cfg.controlSlots;
+    if (count >= limit) return false;
+
+    ring[head] = rec;
+    head = (head + 1) % cfg.queueLen;
+    count++;
+    st.enqueued++;
+    if (count > st.maxQueueDepth) st.maxQueueDepth = count;
+    return true;
+}
+
+bool TripLogWriter::pop(Record& out) {
+
+    if (count == 0) return false;
+    out = ring[tail];
+    tail = (tail + 1) % cfg.queueLen;
+    count--;
+    return true;
+}
+
+TripLogWriter::Stats TripLogWriter::stats() const {
+
+    Stats copy = st;
+    copy.queueDepth = count;
+    return copy;
+}
+
+// =============================================================================
+// PACZKOWANIE I ZAPIS
+// =============================================================================
+
+// Zapis paczki strumienia (opcjonalnie z synchronizacją pliku)
+void TripLogWriter::flushStream(Stream stream, bool doSync) {
+
+    if (!streamOpen[stream]) return;
+    if (batchLen[stream] == 0 && !doSync) return;
+
+    uint32_t t0 = cfg.clockUs ? cfg.clockUs() : 0;
+    if (batchLen[stream] > 0) {
+
+        size_t written = storage.write(stream, batch[stream], batchLen[stream]);
+        if (written != batchLen[stream]) st.shortWrites++;
+        st.bytesWritten += written;
+        batchLen[stream] = 0;
+    }
+    if (doSync) storage.sync(stream);
+    uint32_t elapsed = cfg.clockUs ? cfg.clockUs() - t0 : 0;
+
+    st.flushes++;
+    st.lastFlushUs = elapsed;
+    if (elapsed > st.maxFlushUs) st.maxFlushUs = elapsed;
+}
+
+// Leniwe otwarcie pliku strumienia przy pierwszym rekordzie
+bool TripLogWriter::ensureOpen(Stream stream) {
+
+    if (streamOpen[stream]) return true;
+    if (!session || streamFailed[stream]) return false;
+
+    char file[PATH_MAX_LEN + 24];
+    snprintf(file, sizeof(file), "%s%s", path, (cfg.binary ? FILE_NAMES_BIN : FILE_NAMES_CSV)[stream]);
+
+    long size = storage.open(stream, file);
+    if (size < 0) {
+        st.openErrors++;
+        streamFailed[stream] = true;
+        return false;
+    }
+
+    streamOpen[stream] = true;
+    batchLen[stream] = 0;
+
+    // Plik utworzony na nowo (lub nagłówek nie został zapisany w createTripSession)
+    if (size == 0) {
+
+        if (stream == STREAM_CAPTURE) {
+            batchLen[stream] = TripLogFormat::writeFileHeader(batch[stream], TripLogFormat::STREAM_CAPTURE);
+            return true;
+        }
+        if (cfg.binary && (stream == STREAM_GPS || stream == STREAM_OBD)) {
+            batchLen[stream] = TripLogFormat::writeFileHeader(batch[stream],
+                stream == STREAM_GPS ? TripLogFormat::STREAM_GPS : TripLogFormat::STREAM_OBD);
+            return true;
+        }
+        size_t len = strlen(FILE_HEADERS[stream]);
+        memcpy(batch[stream], FILE_HEADERS[stream], len);
+        batchLen[stream] = len;
+    }
+    return true;
+}
+
+// Dopisanie sformatowanych danych do paczki strumienia
+void TripLogWriter::append(Stream stream, const char* data, size_t len) {
+
+    if (len == 0 || !ensureOpen(stream)) return;
+    if (len > cfg.batchBytes) len = cfg.batchBytes;
+
+    if (batchLen[stream] + len > cfg.batchBytes)
+        flushStream(stream, false);
+
+    memcpy(batch[stream] + batchLen[stream], data, len);
+    batchLen[stream] += len;
+}
+
+// Zamknięcie bieżącego bloku binarnego i dopisanie go do paczki strumienia
+void TripLogWriter::finishBlock(Stream stream) {
+
+    TripLogFormat::BlockEncoder* enc = nullptr;
+    if (cfg.binary && stream == STREAM_GPS) enc = &gpsEncoder;
+    else if (cfg.binary && stream == STREAM_OBD) enc = &obdEncoder;
+    else if (stream == STREAM_CAPTURE) enc = &captureEncoder;
+    if (!enc || enc->empty()) return;
+
+    uint8_t block[TripLogFormat::BLOCK_MAX];
+    size_t len = enc->finish(block);
+    append(stream, (const char*)block, len);
+}
+
+void TripLogWriter::appendCapture(TripLogFormat::CaptureChunk& chunk) {
+
+    if (!ensureOpen(STREAM_CAPTURE)) return;
+    while (!captureEncoder.add(chunk) && !captureEncoder.empty())
+        finishBlock(STREAM_CAPTURE);
+}
+
+void TripLogWriter::appendGps(const Record& rec) {
+
+    const GpsFix& data = rec.gps;
+
+    if (cfg.binary) {
+
+        if (!ensureOpen(STREAM_GPS)) return;
+
+        TripLogFormat::GpsSample s;
+        s.timestampMs = (uint32_t)data.timestamp;
+        s.lat = (int32_t)lround(data.latitude * 1e7);
+        s.lng = (int32_t)lround(data.longitude * 1e7);
+        s.sats = data.satellites;
+        s.hdop = data.hdop;
+        s.valid = data.valid;
+        s.utcMs = rec.utcMs;
+        s.timeSource = rec.timeSource;
+
+        if (!gpsEncoder.add(s)) {
+            finishBlock(STREAM_GPS);
+            gpsEncoder.add(s);
+        }
+        return;
+    }
+
+    // Format: Timestamp,Latitude,Longitude,Satellites,HDOP,Valid,UtcMs,TimeSource
+    char line[128];
+    int len = snprintf(line, sizeof(line), "%lu,%.6f,%.6f,%u,%u,%d,%llu,%s\n",
+        data.timestamp, data.latitude, data.longitude,
+        (unsigned)data.satellites, (unsigned)data.hdop, data.valid ? 1 : 0,
+        (unsigned long long)rec.utcMs, ClockDiscipline::sourceName(rec.timeSource));
+    if (len > 0) append(STREAM_GPS, line, (size_t)len);
+}
+
+void TripLogWriter::appendUpdate(const Record& rec) {
+
+    const TripUpdate& data = rec.update;
+
+    if (cfg.binary) {
+
+        if (!ensureOpen(STREAM_OBD)) return;
+
+        TripLogFormat::ObdSample s;
+        s.timestampMs = (uint32_t)data.timestamp;
+        s.distanceM = (uint32_t)lroundf(data.distanceKm * 1000.0f);
+        s.fuelMl = (uint32_t)lroundf(data.fuelUsedLiters * 1000.0f);
+        s.costGr = (uint32_t)lroundf(data.totalCost * 100.0f);
+        s.utcMs = rec.utcMs;
+        s.timeSource = rec.timeSource;
+
+        if (!obdEncoder.add(s)) {
+            finishBlock(STREAM_OBD);
+            obdEncoder.add(s);
+        }
+        return;
+    }
+
+    // Format: Timestamp,DistanceKm,FuelLiters,TotalCost,UtcMs,TimeSource
+    char line[128];
+    int len = snprintf(line, sizeof(line), "%lu,%.3f,%.3f,%.2f,%llu,%s\n",
+        data.timestamp, data.distanceKm, data.fuelUsedLiters, data.totalCost,
+        (unsigned long long)rec.utcMs, ClockDiscipline::sourceName(rec.timeSource));
+    if (len > 0) append(STREAM_OBD, line, (size_t)len);
+}
+
+void TripLogWriter::appendSummary(const Record& rec) {
+
+    const TripSummary& data = rec.summary;
+
+    // Format: Timestamp,DistanceKm,FuelLiters,TariffMode,TariffValue,TotalCost,
+    //         GpsDistanceKm,GpsFallbackKm,ObdGpsDivergencePct,UtcMs,TimeSource
+    char line[160];
+    int len = snprintf(line, sizeof(line), "%lu,%.3f,%.3f,%d,%.2f,%.2f,%.3f,%.3f,%.2f,%llu,%s\n",
+        rec.timestamp, data.distanceKm, data.fuelUsedLiters,
+        data.tariffMode, data.tariffValue, data.totalCost,
+        data.gpsDistanceKm, data.gpsFallbackKm, data.divergencePct,
+        (unsigned long long)rec.utcMs, ClockDiscipline::sourceName(rec.timeSource));
+    if (len > 0) append(STREAM_SUMMARY, line, (size_t)len);
+}
+
+// Rekord GPS przez upraszczanie śladu: zapis wstrzymanego poprzedniego i/lub bieżącego
+void TripLogWriter::appendTrack(const Record& rec) {
+
+    if (!cfg.simplifyTrack || !session) {
+        appendGps(rec);
+        return;
+    }
+
+    TrackSimplifier::Point p;
+    p.timeMs = (uint32_t)rec.gps.timestamp;
+    p.latE7 = (int32_t)lround(rec.gps.latitude * 1e7);
+    p.lngE7 = (int32_t)lround(rec.gps.longitude * 1e7);
+    p.valid = rec.gps.valid;
+
+    uint8_t keep = track.add(p);
+    if (keep & TrackSimplifier::KEEP_PREVIOUS) appendGps(trackPending);
+    if (keep & TrackSimplifier::KEEP_CURRENT) appendGps(rec);
+    else trackPending = rec;
+}
+
+// Koniec śladu sesji - ostatni punkt zawsze w logu
+void TripLogWriter::finishTrack() {
+
+    if (!cfg.simplifyTrack) return;
+
+    if (track.finish()) appendGps(trackPending);
+    trackStats = track.stats();
+    track.reset();
+    st.gpsPoints += trackStats.points;
+    st.gpsKept += trackStats.kept;
+}
+
+void TripLogWriter::closeAll() {
+
+    for (int s = 0; s < STREAM_COUNT; s++) {
+
+        if (streamOpen[s]) {
+            finishBlock((Stream)s);
+            flushStream((Stream)s, true);
+            storage.close((Stream)s);
+        }
+        streamOpen[s] = false;
+        streamFailed[s] = false;
+        batchLen[s] = 0;
+    }
+    session = false;
+}
+
+void TripLogWriter::process(const Record& rec) {
+
+    switch (rec.type) {
+
+        case REC_OPEN:
+            if (session) finishTrack();
+            closeAll();
+            strncpy(path, rec.path, PATH_MAX_LEN - 1);
+            path[PATH_MAX_LEN - 1] = '\0';
+            session = true;
+            break;
+
+        case REC_GPS:
+            appendTrack(rec);
+            break;
+
+        case REC_UPDATE:
+            appendUpdate(rec);
+            break;
+
+        case REC_SUMMARY:
+            appendSummary(rec);
+            break;
+
+        case REC_CLOSE:
+            if (session) finishTrack();
+            closeAll();
+            break;
+    }
+}
+
+void TripLogWriter::sync(uint32_t nowMs) {
+
+    if (nowMs - lastSyncMs < cfg.syncMs) return;
+
+    for (int s = 0; s < STREAM_COUNT; s++) {
+        finishBlock((Stream)s);
+        flushStream((Stream)s, true);
+    }
+    lastSyncMs = nowMs;
+}
+
+void TripLogWriter::drain(uint32_t nowMs) {
+
+    Record rec;
+    while (pop(rec))
+        process(rec);
+    sync(nowMs);
+}
@@ -0,0 +1,262 @@
+#include "trip_logger.h"
+#include "link_capture.h"
+#include "timebase.h"
+#include "../cabulator_settings.h"
+#include <SD.h>
+
+using namespace SDCARD;
+
+namespace TripLogger {
+
+    typedef TripLogWriter::Record Record;
+    typedef TripLogWriter::Stream Stream;
+
+    static_assert(LOG_QUEUE_LEN <= (int)TripLogWriter::QUEUE_MAX, "SDCARD::LOG_QUEUE_LEN too large");
+    static_assert(LOG_BATCH_BYTES <= (int)TripLogWriter::BATCH_MAX, "SDCARD::LOG_BATCH_BYTES too large");
+    static_assert(LOG_CONTROL_SLOTS >= 3 && LOG_CONTROL_SLOTS < LOG_QUEUE_LEN,
+                  "SDCARD::LOG_CONTROL_SLOTS must fit summary, close and the next open");
+
+    // =============================================================================
+    // WARSTWA PLIKÓW - KARTA SD
+    // =============================================================================
+
+    class SdStorage : public TripLogWriter::Storage {
+    public:
+        long open(Stream stream, const char* path) override {
+            files[stream] = SD.open(path, FILE_APPEND);
+            if (!files[stream]) return -1;
+            return (long)files[stream].size();
+        }
+
+        size_t write(Stream stream, const uint8_t* data, size_t len) override {
+            return files[stream].write(data, len);
+        }
+
+        void sync(Stream stream) override {
+            files[stream].flush();
+        }
+
+        void close(Stream stream) override {
+            files[stream].close();
+        }
+
+    private:
+        File files[TripLogWriter::STREAM_COUNT];
+    };
+
+    static uint32_t clockUs() {
+        return micros();
+    }
+
+    static TripLogWriter::Config writerConfig() {
+
+        TripLogWriter::Config c;
+        c.queueLen = LOG_QUEUE_LEN;
+        c.controlSlots = LOG_CONTROL_SLOTS;
+        c.batchBytes = LOG_BATCH_BYTES;
+        c.syncMs = LOG_SYNC_MS;
+        c.binary = SD_LOG_BINARY_FORMAT;
+        c.simplifyTrack = TRACK_SIMPLIFY;
+        c.track.toleranceMm = TRACK_TOLERANCE_MM;
+        c.track.maxGapMs = TRACK_MAX_GAP_MS;
+        c.clockUs = clockUs;
+        return c;
+    }
+
+    static SdStorage sdStorage;
+    static TripLogWriter writer(writerConfig(), sdStorage);
+
+    // Osłania bufor writer (push/pop/noteDropped) i odczyt liczników
+    static portMUX_TYPE ringMux = portMUX_INITIALIZER_UNLOCKED;
+    static TaskHandle_t writerTask = nullptr;
+
+    // =============================================================================
+    // PRODUCENCI - dodawanie rekordów (próbki bez blokowania)
+    // =============================================================================
+
+    // Próbki (GPS, OBD) są odrzucane przy pełnym buforze. Rekordy sesji (control)
+    // mają zarezerwowane miejsca, a gdy task zapisu nie nadąża, producent czeka
+    // na miejsce do LOG_CONTROL_WAIT_MS
+    static bool push(const Record& rec, bool control) {
+
+        unsigned long t0 = millis();
+        bool accepted;
+        uint16_t depth;
+
+        while (true) {
+
+            bool timedOut = millis() - t0 >= (unsigned long)LOG_CONTROL_WAIT_MS;
+            portENTER_CRITICAL(&ringMux);
+            accepted = writer.push(rec);
+            if (!accepted && (!control || timedOut)) writer.noteDropped();
+            depth = writer.stats().queueDepth;
+            portEXIT_CRITICAL(&ringMux);
+
+            if (accepted || !control || timedOut) break;
+
+            // Rekord sesji przy pełnym buforze - task zapisu musi zwolnić miejsce
+            if (writerTask) xTaskNotifyGive(writerTask);
+            vTaskDelay(1);
+        }
+
+        // Budzenie taska tylko gdy jest po co - w pozostałych przypadkach
+        // task i tak obudzi się co LOG_IDLE_WAKE_MS
+        if (writerTask && (control || depth >= LOG_QUEUE_LEN / 2))
+            xTaskNotifyGive(writerTask);
+
+        return accepted;
+    }
+
+    static void stamp(Record& rec, const Timebase::Stamp& utc) {
+        rec.utcMs = utc.utcMs;
+        rec.timeSource = utc.source;
+    }
+
+    bool openSession(const String& tripPath) {
+
+        Record rec;
+        rec.type = TripLogWriter::REC_OPEN;
+        rec.timestamp = millis();
+        stamp(rec, Timebase::nowUtc());
+        strncpy(rec.path, tripPath.c_str(), TripLogWriter::PATH_MAX_LEN - 1);
+        rec.path[TripLogWriter::PATH_MAX_LEN - 1] = '\0';
+        return push(rec, true);
+    }
+
+    bool closeSession() {
+
+        Record rec;
+        rec.type = TripLogWriter::REC_CLOSE;
+        rec.timestamp = millis();
+        stamp(rec, Timebase::nowUtc());
+        return push(rec, true);
+    }
+
+    bool logGPS(const SDManager::GPSData& data) {
+
+        Record rec;
+        rec.type = TripLogWriter::REC_GPS;
+        rec.timestamp = millis();
+        stamp(rec, Timebase::utcAt((uint32_t)data.timestamp));
+        rec.gps = data;
+        return push(rec, false);
+    }
+
+    bool logTripUpdate(const SDManager::TripUpdateData& data) {
+
+        Record rec;
+        rec.type = TripLogWriter::REC_UPDATE;
+        rec.timestamp = millis();
+        stamp(rec, Timebase::utcAt((uint32_t)data.timestamp));
+        rec.update = data;
+        return push(rec, false);
+    }
+
+    bool logSummary(const SDManager::TripData& data) {
+
+        Record rec;
+        rec.type = TripLogWriter::REC_SUMMARY;
+        rec.timestamp = millis();
+        stamp(rec, Timebase::nowUtc());
+        rec.summary = data;
+        return push(rec, true);
+    }
+
+    Stats getStats() {
+
+        portENTER_CRITICAL(&ringMux);
+        Stats copy = writer.stats();
+        portEXIT_CRITICAL(&ringMux);
+        return copy;
+    }
+
+    // =============================================================================
+    // TASK ZAPISU
+    // =============================================================================
+
+    static bool pop(Record& out) {
+
+        portENTER_CRITICAL(&ringMux);
+        bool ok = writer.pop(out);
+        portEXIT_CRITICAL(&ringMux);
+        return ok;
+    }
+
+    // Przeniesienie fragmentów z bufora LinkCapture do bloków link_capture.bin
+    static void drainCapture() {
+
+        TripLogFormat::CaptureChunk chunk;
+        uint8_t buf[CAPTURE_CHUNK_MAX];
+
+        while (LinkCapture::pop(chunk, buf))
+            writer.appendCapture(chunk);
+    }
+
+    static void process(const Record& rec) {
+
+        bool wasOpen = writer.sessionOpen();
+        Stats before = writer.stats();
+
+        // Ostatnie fragmenty przechwytywania trafiają do pliku przed jego zamknięciem
+        if (rec.type == TripLogWriter::REC_CLOSE && LinkCapture::enabled()) {
+
+            LinkCapture::setEnabled(false);
+            drainCapture();
+            LinkCapture::Stats cs = LinkCapture::getStats();
+            Serial.printf("[LOG] Capture: OBD tx %lu B, rx %lu B, GPS %lu B, lost %lu B\n",
+                (unsigned long)cs.bytes[TripLogFormat::CAPTURE_OBD_TX],
+                (unsigned long)cs.bytes[TripLogFormat::CAPTURE_OBD_RX],
+                (unsigned long)cs.bytes[TripLogFormat::CAPTURE_GPS_RX],
+                (unsigned long)cs.bytes[TripLogFormat::CAPTURE_LOST]);
+        }
+
+        writer.process(rec);
+
+        // Koniec sesji (zamknięcie lub otwarcie kolejnej)
+        if (wasOpen && (rec.type == TripLogWriter::REC_OPEN || rec.type == TripLogWriter::REC_CLOSE)) {
+
+            TrackSimplifier::Stats ts = writer.lastTrack();
+            if (TRACK_SIMPLIFY && ts.points)
+                Serial.printf("[LOG] GPS track: %lu of %lu points kept (%lu forced)\n",
+                    (unsigned long)ts.kept, (unsigned long)ts.points, (unsigned long)ts.forced);
+            if (rec.type == TripLogWriter::REC_CLOSE)
+                Serial.printf("[LOG] Session closed: %s\n", writer.sessionPath());
+        }
+        if (rec.type == TripLogWriter::REC_OPEN) {
+
+            Serial.printf("[LOG] Session opened: %s\n", writer.sessionPath());
+            if (CAPTURE_MODE) LinkCapture::setEnabled(true);
+        }
+
+        Stats after = writer.stats();
+        if (after.openErrors != before.openErrors)
+            Serial.printf("[LOG] ERROR: Failed to open a log file in %s\n", writer.sessionPath());
+        if (after.shortWrites != before.shortWrites)
+            Serial.println("[LOG] ERROR: Short write to a log file");
+    }
+
+    void drain(unsigned long nowMs) {
+
+        Record rec;
+        while (pop(rec))
+            process(rec);
+        drainCapture();
+
+        // Okresowa synchronizacja otwartych plików
+        writer.sync((uint32_t)nowMs);
+    }
+
+    void task(void* param) {
+
+        writerTask = xTaskGetCurrentTaskHandle();
+        LinkCapture::setConsumer(writerTask);
+        Serial.println("[LOG] Trip logger task started");
+
+        while (true) {
+
+            ulTaskNotifyTake(pdTRUE, LOG_IDLE_WAKE_MS / portTICK_PERIOD_MS);
+            drain(millis());
+        }
+    }
+
+}  // namespace TripLogger
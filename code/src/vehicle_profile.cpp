@@ -0,0 +1,262 @@
+#include "vehicle_profile.h"
+#include "obd_pid.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Moduł celowo nie używa Arduino.h - kompiluje się również na hoście
+
+const char* const VehicleProfile::BUILTIN =
+    "name Volvo V40 2014+\n"
+    "fuel petrol\n"
+    "engine 1596 85\n"
+    "odometer 22DD01 0 3 1\n"
+    "can speed 1A0 0 2 0.01 FFFF\n"     // Ramki do potwierdzenia zrzutem ATMA (tools/can_replay.cpp --ids)
+    "can odometer 3A0 1 3 1\n";
+
+// AFR i gęstość [kg/L] wg rodzaju paliwa
+struct FuelDefaults {
+    const char* name;
+    float afr;
+    float densityKgL;
+};
+
+static const FuelDefaults FUELS[] = {
+    { "petrol", 14.7f, 0.755f },
+    { "diesel", 14.5f, 0.832f },
+    { "lpg", 15.5f, 0.540f },
+    { "e85", 9.8f, 0.785f },
+};
+static constexpr size_t FUEL_COUNT = sizeof(FUELS) / sizeof(FUELS[0]);
+
+// =============================================================================
+// FUNKCJE POMOCNICZE
+// =============================================================================
+
+static void setError(char* err, size_t errLen, int line, const char* msg) {
+    if (err && errLen) snprintf(err, errLen, "line %d: %s", line, msg);
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// Liczba całkowita z zakresu [lo, hi] (base 10 lub 16)
+static bool parseUint(const char* s, int base, uint32_t lo, uint32_t hi, uint32_t& out) {
+
+    if (!s || !*s) return false;
+    char* end;
+    unsigned long v = strtoul(s, &end, base);
+    if (*end != '\0' || v < lo || v > hi) return false;
+    out = (uint32_t)v;
+    return true;
+}
+
+// Liczba rzeczywista z zakresu [lo, hi]
+static bool parseFloat(const char* s, float lo, float hi, float& out) {
+
+    if (!s || !*s) return false;
+    char* end;
+    float v = strtof(s, &end);
+    if (*end != '\0' || !(v >= lo && v <= hi)) return false;
+    out = v;
+    return true;
+}
+
+// Zapytanie hex "22DD01" -> bajty (tryb < 0x40, odpowiedź = tryb + 0x40)
+static bool parseRequest(const char* s, VehicleProfile::Field& f) {
+
+    size_t len = strlen(s);
+    if (len < 4 || len % 2 || len > 2 * VehicleProfile::MAX_REQUEST) return false;
+    for (size_t i = 0; i < len; i += 2) {
+        int hi = hexValue(s[i]), lo = hexValue(s[i + 1]);
+        if (hi < 0 || lo < 0) return false;
+        f.request[i / 2] = (uint8_t)(hi << 4 | lo);
+    }
+    if (f.request[0] == 0 || f.request[0] >= 0x40) return false;
+
+    f.requestLen = (uint8_t)(len / 2);
+    for (size_t i = 0; i <= len; i++)
+        f.command[i] = (s[i] >= 'a' && s[i] <= 'f') ? (char)(s[i] - 'a' + 'A') : s[i];
+    return true;
+}
+
+// Położenie wartości: bajt, długość (1-4), skala
+static bool parsePlacement(char* const* tok, size_t maxStart, uint8_t& start, uint8_t& length, float& scale) {
+
+    uint32_t s, l;
+    if (!parseUint(tok[0], 10, 0, (uint32_t)maxStart, s) || !parseUint(tok[1], 10, 1, 4, l)
+        || !parseFloat(tok[2], -1e6f, 1e6f, scale) || scale == 0.0f) return false;
+    start = (uint8_t)s;
+    length = (uint8_t)l;
+    return true;
+}
+
+// Skrót FNV-1a 32 bit
+static uint32_t fnv1a(const char* text) {
+    uint32_t h = 2166136261u;
+    for (const char* p = text; *p; p++) h = (h ^ (uint8_t)*p) * 16777619u;
+    return h;
+}
+
+// =============================================================================
+// VEHICLEPROFILE
+// =============================================================================
+
+bool VehicleProfile::compile(const char* text, VehicleProfile& out, char* err, size_t errLen) {
+
+    VehicleProfile v;
+    memset(&v, 0, sizeof(v));
+    v.fuel = FUEL_PETROL;
+    v.displacementCc = 1600;
+    v.vePct = 85;
+    float afr = 0.0f, density = 0.0f;         // 0 = wartość domyślna paliwa
+
+    char line[96];
+    int lineNo = 0;
+    const char* p = text;
+
+    while (p && *p) {
+
+        // Wydzielenie linii
+        const char* eol = strchr(p, '\n');
+        size_t len = eol ? (size_t)(eol - p) : strlen(p);
+        lineNo++;
+        if (len >= sizeof(line)) { setError(err, errLen, lineNo, "line too long"); return false; }
+        memcpy(line, p, len);
+        line[len] = '\0';
+        p = eol ? eol + 1 : nullptr;
+
+        char* hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+
+        // Nazwa - reszta linii ze spacjami
+        char* s = line;
+        while (*s == ' ' || *s == '\t') s++;
+        if (strncmp(s, "name", 4) == 0 && (s[4] == ' ' || s[4] == '\t')) {
+            s += 5;
+            while (*s == ' ' || *s == '\t') s++;
+            size_t n = strlen(s);
+            while (n && (s[n - 1] == ' ' || s[n - 1] == '\t' || s[n - 1] == '\r')) n--;
+            if (n == 0 || n > MAX_NAME) { setError(err, errLen, lineNo, "bad name"); return false; }
+            memcpy(v.name, s, n);
+            v.name[n] = '\0';
+            continue;
+        }
+
+        // Podział na słowa
+        char* tok[7] = {nullptr};
+        char* save = nullptr;
+        int n = 0;
+        for (char* t = strtok_r(line, " \t\r", &save); t && n < 7; t = strtok_r(nullptr, " \t\r", &save))
+            tok[n++] = t;
+        if (n == 0) continue;
+
+        if (strcmp(tok[0], "fuel") == 0 && n == 2) {
+
+            size_t f = 0;
+            while (f < FUEL_COUNT && strcmp(tok[1], FUELS[f].name) != 0) f++;
+            if (f == FUEL_COUNT) { setError(err, errLen, lineNo, "fuel must be petrol, diesel, lpg or e85"); return false; }
+            v.fuel = (uint8_t)f;
+
+        } else if (strcmp(tok[0], "afr") == 0 && n == 2) {
+
+            if (!parseFloat(tok[1], 5.0f, 30.0f, afr)) { setError(err, errLen, lineNo, "bad afr"); return false; }
+
+        } else if (strcmp(tok[0], "density") == 0 && n == 2) {
+
+            if (!parseFloat(tok[1], 0.3f, 1.2f, density)) { setError(err, errLen, lineNo, "bad density"); return false; }
+
+        } else if (strcmp(tok[0], "engine") == 0 && n == 3) {
+
+            uint32_t cc, ve;
+            if (!parseUint(tok[1], 10, 50, 10000, cc) || !parseUint(tok[2], 10, 30, 120, ve)) {
+                setError(err, errLen, lineNo, "bad engine"); return false;
+            }
+            v.displacementCc = (uint16_t)cc;
+            v.vePct = (uint8_t)ve;
+
+        } else if (strcmp(tok[0], "odometer") == 0 && (n == 5 || n == 6)) {
+
+            Field& f = v.odometer;
+            if (!parseRequest(tok[1], f) || !parsePlacement(&tok[2], MAX_RESPONSE - 4, f.start, f.length, f.scale)
+                || (n == 6 && !parseFloat(tok[5], -1e6f, 1e6f, f.offset))) {
+                f.requestLen = 0;
+                setError(err, errLen, lineNo, "bad odometer"); return false;
+            }
+
+        } else if (strcmp(tok[0], "can") == 0 && (n == 6 || n == 7)) {
+
+            uint8_t sig;
+            if (strcmp(tok[1], "speed") == 0) sig = CAN_SPEED;
+            else if (strcmp(tok[1], "odometer") == 0) sig = CAN_ODOMETER;
+            else { setError(err, errLen, lineNo, "can signal must be speed or odometer"); return false; }
+
+            CanMonitor::Signal& c = v.can[sig];
+            uint32_t id, invalid = 0;
+            c.offset = 0.0f;
+            if (!parseUint(tok[2], 16, 1, 0x7FF, id)
+                || !parsePlacement(&tok[3], CanMonitor::MAX_DATA - 1, c.start, c.length, c.scale)
+                || c.start + c.length > CanMonitor::MAX_DATA
+                || (n == 7 && !parseUint(tok[6], 16, 1, 0xFFFFFFFFu, invalid))) {
+                setError(err, errLen, lineNo, "bad can signal"); return false;
+            }
+            c.id = (uint16_t)id;
+            c.invalidRaw = invalid;
+            v.hasCan[sig] = true;
+
+        } else {
+            setError(err, errLen, lineNo, "unknown rule");
+            return false;
+        }
+    }
+
+    if (v.name[0] == '\0') strcpy(v.name, "unnamed");
+
+    v.afr = afr > 0.0f ? afr : FUELS[v.fuel].afr;
+    v.densityKgL = density > 0.0f ? density : FUELS[v.fuel].densityKgL;
+    v.lphPerGs = 3.6f / (v.afr * v.densityKgL);
+
+    // m = p x V / (R x T) na cykl (2 obroty), R powietrza = 0.287 J/(g K)
+    v.airPerKpaRpmK = v.displacementCc / 1000.0f / 0.287f / 120.0f * v.vePct / 100.0f;
+    v.id = fnv1a(text);
+
+    out = v;
+    return true;
+}
+
+bool VehicleProfile::decode(const Field& field, const uint8_t* bytes, size_t n, float& value) {
+
+    size_t header = field.requestLen;
+    if (header == 0 || n < header + field.start + field.length) return false;
+
+    // Nagłówek: tryb + 0x40, identyfikator powtórzony z zapytania
+    uint8_t mode = (uint8_t)(field.request[0] + 0x40);
+    size_t last = n - header - field.start - field.length;
+    for (size_t pos = 0; pos <= last; pos++) {
+
+        if (bytes[pos] != mode || memcmp(&bytes[pos + 1], &field.request[1], header - 1) != 0) continue;
+
+        const uint8_t* d = &bytes[pos + header + field.start];
+        uint32_t raw = 0;
+        for (uint8_t b = 0; b < field.length; b++) raw = raw << 8 | d[b];
+        value = raw * field.scale + field.offset;
+        return true;
+    }
+    return false;
+}
+
+bool VehicleProfile::decode(const Field& field, const char* response, float& value) {
+
+    if (!response || field.requestLen == 0) return false;
+    uint8_t bytes[MAX_RESPONSE];
+    size_t n = ObdPid::collectBytes(response, bytes, sizeof(bytes));
+    return decode(field, bytes, n, value);
+}
+
+const char* VehicleProfile::fuelLabel(uint8_t fuel) {
+    return fuel < FUEL_COUNT ? FUELS[fuel].name : "?";
+}
@@ -0,0 +1,360 @@
+/**
+ * @file can_replay.cpp
+ * @brief Narzędzie hosta - CanMonitor na zapisanym lub syntetycznym strumieniu ATMA
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Tryb pliku - zrzut nasłuchu z pojazdu: tekst wysłany przez ELM327 po
+ * ATH1 i ATMA (np. zapis terminala Bluetooth, bez edycji). Wypisuje:
+ * - liczniki parsera i zdekodowane sygnały profilu pojazdu (linie "can"
+ *   w vehicle_profile.h; liczba, min, max, ostatnia)
+ * - z --ids: identyfikatory ramek z liczbą i zmiennością bajtów - pomoc
+ *   w ustaleniu identyfikatorów ramek dla profilu nowego pojazdu
+ *
+ * Tryb syntetyczny (--synthetic s) - zrzut generuje emulator ELM327
+ * (elm327_emulator.h): ramki sygnałów profilu z wartościami skryptu domyślnego
+ * (rozpędzanie 50 -> 100 km/h) i --bus ramek/s innych modułów; z --filter
+ * adapter dostaje wzorzec ATCRA. Ostatnie wartości są porównywane ze
+ * skryptem, --emit zapisuje zrzut do pliku.
+ *
+ * W obu trybach ten sam strumień jest przetwarzany w całości, znak po
+ * znaku i w losowych fragmentach 1-64 B (jak z handlera Bluetooth) - wyniki
+ * muszą być identyczne. Przepustowość parsera jest mierzona na hoście
+ * (ramki/s przy pełnym obciążeniu jednego rdzenia).
+ *
+ * Kompilacja (z katalogu code/):
+ * ```
+ * g++ -std=c++17 -O2 -Iinclude tools/can_replay.cpp src/can_monitor.cpp src/elm327_emulator.cpp \
+ *     src/vehicle_profile.cpp src/obd_pid.cpp -o can_replay
+ * ```
+ *
+ * Użycie:
+ * ```
+ * can_replay dump.txt [--ids] [--profile vehicle.txt]
+ * can_replay --synthetic s [--bus fps] [--filter] [--emit dump.txt] [--profile vehicle.txt]
+ * ```
+ * Bez --profile sygnały pochodzą z profilu wbudowanego (VehicleProfile::BUILTIN).
+ * Kod wyjścia 1 oznacza różne wyniki zależnie od podziału strumienia lub
+ * (tryb syntetyczny) wartości niezgodne ze skryptem.
+ */
+
+#include "can_monitor.h"
+#include "elm327_emulator.h"
+#include "vehicle_profile.h"
+#include "../cabulator_settings.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <string>
+
+// Kolejność sygnałów jak w tasku OBD
+enum { SIG_SPEED, SIG_ODOMETER, SIG_COUNT };
+static const char* const SIGNAL_NAME[SIG_COUNT] = { "speed", "odometer" };
+
+struct Decoded {
+    uint32_t count;
+    float min, max, last;
+};
+
+struct Replay {
+    CanMonitor::Stats stats;
+    Decoded signals[SIG_COUNT];
+};
+
+// Profil pojazdu (domyślnie wbudowany, --profile plik) - wymagane oba sygnały CAN
+static VehicleProfile profile;
+
+static void setupSignals(CanMonitor& m) {
+
+    m.addSignal(profile.can[VehicleProfile::CAN_SPEED]);
+    m.addSignal(profile.can[VehicleProfile::CAN_ODOMETER]);
+}
+
+static uint32_t rng = 12345;
+static uint32_t random32() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+// Przetworzenie strumienia we fragmentach (chunk 0 = losowe 1-64 B); odczyt sygnałów po każdym fragmencie
+static Replay replay(const std::string& dump, size_t chunk) {
+
+    CanMonitor m;
+    setupSignals(m);
+    Replay r = {};
+
+    size_t pos = 0;
+    while (pos < dump.size()) {
+
+        size_t n = chunk ? chunk : 1 + random32() % 64;
+        if (n > dump.size() - pos) n = dump.size() - pos;
+        m.feed((const uint8_t*)dump.data() + pos, n, 0);
+        pos += n;
+
+        for (size_t i = 0; i < SIG_COUNT; i++) {
+            float v;
+            uint32_t t;
+            if (!m.take(i, v, t)) continue;
+            Decoded& d = r.signals[i];
+            if (d.count == 0 || v < d.min) d.min = v;
+            if (d.count == 0 || v > d.max) d.max = v;
+            d.last = v;
+            d.count++;
+        }
+    }
+    r.stats = m.stats();
+    return r;
+}
+
+// Liczniki i ostatnia wartość zależą tylko od treści (liczba odczytów, min, max - od podziału na fragmenty)
+static bool sameResult(const Replay& a, const Replay& b) {
+
+    if (memcmp(&a.stats, &b.stats, sizeof(a.stats)) != 0) return false;
+    for (size_t i = 0; i < SIG_COUNT; i++) {
+        if ((a.signals[i].count == 0) != (b.signals[i].count == 0)) return false;
+        if (a.signals[i].count && a.signals[i].last != b.signals[i].last) return false;
+    }
+    return true;
+}
+
+// Ramki/s parsera na hoście (cały zrzut wielokrotnie, kawałkami po 64 B)
+static double throughputFps(const std::string& dump, uint32_t frames) {
+
+    if (frames == 0) return 0;
+    CanMonitor m;
+    setupSignals(m);
+
+    int passes = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    double elapsed = 0;
+    while (elapsed < 0.5) {
+        for (size_t pos = 0; pos < dump.size(); pos += 64)
+            m.feed((const uint8_t*)dump.data() + pos, dump.size() - pos < 64 ? dump.size() - pos : 64, 0);
+        passes++;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    }
+    return (double)frames * passes / elapsed;
+}
+
+static int report(const std::string& dump) {
+
+    Replay whole = replay(dump, dump.size() ? dump.size() : 1);
+    Replay random = replay(dump, 0);
+    Replay bytewise = replay(dump, 1);
+
+    const CanMonitor::Stats& st = whole.stats;
+    printf("[can] %zu bytes: %u frames, %u matched, %u malformed, %u buffer full, %u rejected\n",
+           dump.size(), st.frames, st.matched, st.malformed, st.bufferFull, st.rejected);
+    for (size_t i = 0; i < SIG_COUNT; i++) {
+        const Decoded& d = bytewise.signals[i];
+        if (d.count) printf("[can] %-8s %u readings, min %.2f, max %.2f, last %.2f\n", SIGNAL_NAME[i], d.count, d.min, d.max, d.last);
+        else printf("[can] %-8s no frames\n", SIGNAL_NAME[i]);
+    }
+
+    double fps = throughputFps(dump, st.frames);
+    if (fps > 0) printf("[can] parser throughput %.0f frames/s on host\n", fps);
+
+    bool same = sameResult(whole, bytewise) && sameResult(whole, random);
+    printf("[can] chunking (whole, 1 B, random 1-64 B): %s\n", same ? "identical" : "DIFFERENT");
+    return same ? 0 : 1;
+}
+
+// =============================================================================
+// TRYB PLIKU
+// =============================================================================
+
+// Identyfikatory w zrzucie: liczba ramek i maska bajtów, które się zmieniają
+static void listIds(const std::string& dump) {
+
+    static uint32_t counts[0x800];
+    static uint8_t first[0x800][8], changed[0x800];
+
+    size_t pos = 0;
+    while (pos < dump.size()) {
+
+        size_t eol = dump.find_first_of("\r\n", pos);
+        if (eol == std::string::npos) eol = dump.size();
+        std::string line;
+        for (size_t i = pos; i < eol; i++) if (dump[i] != ' ' && dump[i] != '>') line += dump[i];
+        pos = eol + 1;
+
+        if (line.size() < 5 || line.size() % 2 == 0 || line.find_first_not_of("0123456789ABCDEFabcdef") != std::string::npos) continue;
+        unsigned id = (unsigned)strtoul(line.substr(0, 3).c_str(), nullptr, 16);
+        size_t n = (line.size() - 3) / 2;
+        if (id >= 0x800 || n > 8) continue;
+
+        for (size_t b = 0; b < n; b++) {
+            uint8_t v = (uint8_t)strtoul(line.substr(3 + 2 * b, 2).c_str(), nullptr, 16);
+            if (counts[id] == 0) first[id][b] = v;
+            else if (first[id][b] != v) changed[id] |= (uint8_t)(1u << b);
+        }
+        counts[id]++;
+    }
+
+    printf("[can] id   frames  changing bytes\n");
+    for (unsigned id = 0; id < 0x800; id++) {
+        if (!counts[id]) continue;
+        char bytes[9] = "........";
+        for (int b = 0; b < 8; b++) if (changed[id] & (1u << b)) bytes[b] = (char)('0' + b);
+        printf("[can] %03X %7u  %s\n", id, counts[id], bytes);
+    }
+}
+
+static bool readFile(const char* path, std::string& out) {
+
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return false;
+    }
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+    fclose(f);
+    return true;
+}
+
+static int replayFile(const char* path, bool ids) {
+
+    std::string dump;
+    if (!readFile(path, dump)) return 2;
+
+    if (ids) listIds(dump);
+    return report(dump);
+}
+
+// =============================================================================
+// TRYB SYNTETYCZNY
+// =============================================================================
+
+static uint32_t clockMs = 0;
+static uint32_t virtualNow() { return clockMs; }
+
+static std::string captured;
+static void capture(const uint8_t* data, size_t len) {
+    captured.append((const char*)data, len);
+}
+
+static void send(Elm327Emulator& elm, const char* cmd) {
+    elm.write((const uint8_t*)cmd, strlen(cmd));
+    elm.write((const uint8_t*)"\r", 1);
+}
+
+static int synthetic(uint32_t seconds, uint16_t busFps, bool filter, const char* emitPath) {
+
+    const CanMonitor::Signal& sp = profile.can[VehicleProfile::CAN_SPEED];
+    const CanMonitor::Signal& od = profile.can[VehicleProfile::CAN_ODOMETER];
+    const char* odoCmd = profile.odometer.requestLen ? profile.odometer.command : "22DD01";
+    const Elm327Emulator::Broadcast BROADCASTS[] = {
+        { sp.id, OBD_CONFIG::SIM_CAN_SPEED_MS, "010D", sp.start, sp.length, 1.0f / sp.scale },
+        { od.id, OBD_CONFIG::SIM_CAN_ODO_MS, odoCmd, od.start, od.length, 1.0f / od.scale },
+    };
+
+    Elm327Emulator::Config cfg = Elm327Emulator::defaultConfig(virtualNow, nullptr);
+    cfg.broadcasts = BROADCASTS;
+    cfg.broadcastCount = 2;
+    cfg.busFps = busFps;
+    Elm327Emulator elm(cfg);
+    elm.loadScript(Elm327Emulator::DEFAULT_SCRIPT);
+    elm.setHandler(capture);
+
+    CanMonitor m;
+    setupSignals(m);
+    char pattern[8] = "";
+    if (filter) m.filterPattern(pattern, sizeof(pattern));
+
+    send(elm, "ATE0");
+    send(elm, "ATH1");
+    if (filter) send(elm, (std::string("ATCRA") + pattern).c_str());
+
+    // Rozpędzanie 50 -> 100 km/h w skrypcie domyślnym (600-660 s)
+    clockMs = 630000 - seconds * 500;
+    captured.clear();
+    send(elm, "ATMA");
+    clockMs += seconds * 1000;
+    elm.write((const uint8_t*)"\r", 1);
+    std::string dump = captured;
+
+    printf("[can] synthetic %u s, bus %u frames/s, filter %s: %u frames from adapter\n",
+           seconds, busFps, filter ? pattern : "none", elm.getStats().monitorFrames);
+
+    if (emitPath) {
+        FILE* f = fopen(emitPath, "wb");
+        if (!f || fwrite(dump.data(), 1, dump.size(), f) != dump.size()) fprintf(stderr, "%s: write failed\n", emitPath);
+        if (f) fclose(f);
+    }
+
+    int rc = report(dump);
+
+    // Ostatnie wartości zgodne ze skryptem (prędkość z ostatniej ramki, odometr z ostatniej sekundy)
+    Replay r = replay(dump, 0);
+    uint8_t data[4], len;
+    uint32_t scriptEnd = clockMs;
+    uint32_t lastSpeedMs = scriptEnd - scriptEnd % OBD_CONFIG::SIM_CAN_SPEED_MS;
+    uint32_t lastOdoMs = scriptEnd - scriptEnd % OBD_CONFIG::SIM_CAN_ODO_MS;
+    elm.scriptValue("010D", lastSpeedMs, data, &len);
+    float speed = data[0];
+    uint32_t raw = 0;
+    if (elm.scriptValue(odoCmd, lastOdoMs, data, &len))
+        for (uint8_t b = 0; b < len; b++) raw = raw << 8 | data[b];
+    float km = (float)raw;
+
+    bool ok = r.signals[SIG_SPEED].count && fabsf(r.signals[SIG_SPEED].last - speed) < 0.02f
+              && r.signals[SIG_ODOMETER].count && fabsf(r.signals[SIG_ODOMETER].last - km) < 0.5f;
+    printf("[can] script: speed %.2f km/h, odometer %.0f km -> %s\n", speed, km, ok ? "match" : "MISMATCH");
+    return ok ? rc : 1;
+}
+
+int main(int argc, char** argv) {
+
+    const char* path = nullptr;
+    const char* emitPath = nullptr;
+    const char* profilePath = nullptr;
+    bool ids = false, filter = false;
+    uint32_t seconds = 0;
+    uint16_t busFps = 1500;
+
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (a == "--ids") ids = true;
+        else if (a == "--filter") filter = true;
+        else if (a == "--synthetic" && hasValue) seconds = (uint32_t)atoi(argv[++i]);
+        else if (a == "--bus" && hasValue) busFps = (uint16_t)atoi(argv[++i]);
+        else if (a == "--emit" && hasValue) emitPath = argv[++i];
+        else if (a == "--profile" && hasValue) profilePath = argv[++i];
+        else if (a[0] != '-' && !path) path = argv[i];
+        else {
+            path = nullptr;
+            seconds = 0;
+            break;
+        }
+    }
+
+    std::string text;
+    if (!profilePath) text = VehicleProfile::BUILTIN;
+    else if (!readFile(profilePath, text)) return 2;
+    char err[48];
+    if (!VehicleProfile::compile(text.c_str(), profile, err, sizeof(err))) {
+        fprintf(stderr, "profile error: %s\n", err);
+        return 2;
+    }
+    if (!profile.hasCan[VehicleProfile::CAN_SPEED] || !profile.hasCan[VehicleProfile::CAN_ODOMETER]) {
+        fprintf(stderr, "profile %s has no CAN speed and odometer signals\n", profile.name);
+        return 2;
+    }
+
+    if (path) return replayFile(path, ids);
+    if (seconds > 0) return synthetic(seconds, busFps, filter, emitPath);
+
+    fprintf(stderr, "usage: %s dump.txt [--ids] [--profile file]\n"
+                    "       %s --synthetic s [--bus fps] [--filter] [--emit dump.txt] [--profile file]\n",
+            argv[0], argv[0]);
+    return 2;
+}
@@ -0,0 +1,624 @@
+/**
+ * @file capture_replay.cpp
+ * @brief Narzędzie hosta - odtwarzanie nagrania link_capture.bin przez kod parsowania OBD i NMEA
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Tryb pliku - nagranie z pojazdu (SDCARD::CAPTURE_MODE, link_capture.h).
+ * Komendy wysłane do ELM327 są łączone z odpowiedziami do znaku '>'
+ * i dekodowane tym samym kodem co w firmware:
+ * - Mode 01 - ObdPid::parseResponse
+ * - 0100/0120/... , 0902, ATDPN - ObdDiscovery::parseBitmap / parseVin / parseProtocol
+ * - odometr producenta - VehicleProfile::decode (profil jak w firmware)
+ * - nasłuch ATMA - CanMonitor z sygnałami profilu
+ * Bajty NMEA dekoduje NmeaParser jak w tasku GPS (prędkość RMC, liczba
+ * satelitów GGA). Wypisywane są liczniki, ostatnie wartości i przepustowość.
+ *
+ * Tryb syntetyczny (--synthetic s) - nagranie powstaje z emulatora ELM327
+ * (skrypt domyślny, rozruch, zapytania cykliczne, okno ATMA) i z wygenerowanych
+ * zdań NMEA, kodowane tak jak w TripLogger (BlockEncoder STREAM_CAPTURE).
+ * Zegar startuje tuż przed przepełnieniem micros(). Sprawdzane jest, że
+ * odtworzenie z pliku (najszybsze i w tempie --speed) daje te same
+ * zdarzenia co dekodowanie na żywo, a plik z uszkodzonym blokiem traci
+ * tylko ten blok. --emit zapisuje nagranie do pliku.
+ *
+ * Kompilacja (z katalogu code/):
+ * ```
+ * g++ -std=c++17 -O2 -Iinclude tools/capture_replay.cpp src/capture_replay.cpp src/trip_log_format.cpp \
+ *     src/obd_pid.cpp src/obd_discovery.cpp src/vehicle_profile.cpp src/can_monitor.cpp \
+ *     src/elm327_emulator.cpp src/nmea_parser.cpp -o capture_replay
+ * ```
+ *
+ * Użycie:
+ * ```
+ * capture_replay link_capture.bin [--speed x] [--profile vehicle.txt] [--events]
+ * capture_replay --synthetic s [--speed x] [--emit link_capture.bin] [--profile vehicle.txt]
+ * ```
+ * --speed 0 (domyślnie) - bez czekania, 1 - czas rzeczywisty, N - N razy szybciej.
+ * Kod wyjścia 1 oznacza (tryb syntetyczny) różne zdarzenia na żywo i z pliku.
+ */
+
+#include "capture_replay.h"
+#include "trip_log_format.h"
+#include "obd_pid.h"
+#include "obd_discovery.h"
+#include "vehicle_profile.h"
+#include "can_monitor.h"
+#include "elm327_emulator.h"
+#include "nmea_parser.h"
+#include "../cabulator_settings.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace TripLogFormat;
+
+static VehicleProfile profile;
+
+// =============================================================================
+// DEKODER RUCHU ŁĄCZA
+// =============================================================================
+
+struct Event {
+    uint64_t tUs;
+    std::string name;
+    double value;
+
+    bool operator==(const Event& o) const { return tUs == o.tUs && name == o.name && value == o.value; }
+};
+
+class LinkDecoder {
+public:
+    std::vector<Event> events;
+    uint32_t commands = 0, responses = 0, unanswered = 0, noData = 0, discarded = 0;
+    uint32_t sentences = 0, badChecksum = 0, gaps = 0;     // NMEA: zdania RMC/GGA/GSA przyjęte, odrzucone
+    uint64_t lostBytes = 0;
+    char vin[ObdDiscovery::VIN_LEN + 1] = "";
+
+    LinkDecoder() {
+        if (profile.hasCan[VehicleProfile::CAN_SPEED]) can.addSignal(profile.can[VehicleProfile::CAN_SPEED]);
+        if (profile.hasCan[VehicleProfile::CAN_ODOMETER]) can.addSignal(profile.can[VehicleProfile::CAN_ODOMETER]);
+    }
+
+    CanMonitor::Stats canStats() const { return can.stats(); }
+
+    void feed(uint64_t tUs, uint8_t channel, const uint8_t* data, size_t len) {
+
+        switch (channel) {
+            case CAPTURE_OBD_TX: obdTx(tUs, data, len); break;
+            case CAPTURE_OBD_RX: obdRx(tUs, data, len); break;
+            case CAPTURE_GPS_RX: gpsRx(tUs, data, len); break;
+            case CAPTURE_LOST:
+                // Luka - niedokończone odpowiedź i zdanie są niepewne
+                gaps++;
+                lostBytes += len;
+                pending = false;
+                response.clear();
+                break;
+        }
+    }
+
+private:
+    std::string txLine, command, response;
+    bool pending = false;                   // Komenda czeka na '>'
+    bool monitoring = false;                // Trwa nasłuch ATMA
+    CanMonitor can;
+    NmeaParser gps;
+
+    void add(uint64_t tUs, const std::string& name, double value) {
+        events.push_back(Event{tUs, name, value});
+    }
+
+    void obdTx(uint64_t tUs, const uint8_t* data, size_t len) {
+
+        for (size_t i = 0; i < len; i++) {
+
+            char c = (char)data[i];
+            if (c != '\r') {
+                if (c != ' ') txLine += (char)toupper((unsigned char)c);
+                continue;
+            }
+
+            // Sam '\r' w trakcie nasłuchu przerywa ATMA - odpowiedź kończy '>'
+            if (txLine.empty() && monitoring) continue;
+
+            if (pending) unanswered++;
+            command = txLine;
+            txLine.clear();
+            response.clear();
+            pending = true;
+            monitoring = command == "ATMA";
+            commands++;
+        }
+        (void)tUs;
+    }
+
+    void obdRx(uint64_t tUs, const uint8_t* data, size_t len) {
+
+        if (!pending) {
+            discarded += (uint32_t)len;
+            return;
+        }
+
+        size_t n = 0;
+        while (n < len && data[n] != '>') n++;
+
+        if (monitoring) {
+            can.feed(data, n, (uint32_t)(tUs / 1000));
+            takeCan(tUs);
+        } else {
+            response.append((const char*)data, n);
+        }
+
+        if (n < len) {
+            pending = false;
+            monitoring = false;
+            responses++;
+            complete(tUs);
+        }
+    }
+
+    void takeCan(uint64_t tUs) {
+
+        static const char* const NAMES[] = { "can_speed", "can_odometer" };
+        for (size_t i = 0; i < can.signalCount(); i++) {
+            float v;
+            uint32_t tMs;
+            if (can.take(i, v, tMs)) add(tUs, NAMES[i], v);
+        }
+    }
+
+    // Normalizacja jak w ObdLink: \r i \n -> pojedyncze \n, bez pustych linii i końcowych spacji
+    static std::string normalize(const std::string& in) {
+
+        std::string out;
+        for (char c : in) {
+            if (c == '\r' || c == '\n') {
+                if (!out.empty() && out.back() != '\n') out += '\n';
+            } else if (c != '\0') {
+                out += c;
+            }
+        }
+        while (!out.empty() && (out.back() == ' ' || out.back() == '\n')) out.pop_back();
+        return out;
+    }
+
+    // Para komenda - odpowiedź przez parsery firmware'u
+    void complete(uint64_t tUs) {
+
+        response = normalize(response);
+        const char* r = response.c_str();
+        if (response.find("NO DATA") != std::string::npos) noData++;
+
+        if (command == "ATDPN") {
+            int p = ObdDiscovery::parseProtocol(r);
+            if (p > 0) add(tUs, "protocol", p);
+            return;
+        }
+        if (command == "0902") {
+            if (ObdDiscovery::parseVin(r, vin)) add(tUs, "vin", 1);
+            return;
+        }
+        if (profile.odometer.requestLen && command == profile.odometer.command) {
+            float km;
+            if (VehicleProfile::decode(profile.odometer, r, km)) add(tUs, "odometer", km);
+            return;
+        }
+        if (command.size() < 4 || command.size() % 2 || command.compare(0, 2, "01") != 0) return;
+
+        // Mapa obsługiwanych PID (0100, 0120, ...)
+        uint8_t first = (uint8_t)strtoul(command.substr(2, 2).c_str(), nullptr, 16);
+        if (command.size() == 4 && first % 0x20 == 0) {
+            uint32_t bits;
+            char name[12];
+            snprintf(name, sizeof(name), "pids_%02X", first);
+            if (ObdDiscovery::parseBitmap(r, first, bits)) add(tUs, name, bits);
+            return;
+        }
+
+        ObdPid::Value values[ObdPid::MAX_BATCH];
+        size_t count = 0;
+        for (size_t i = 2; i + 1 < command.size() && count < ObdPid::MAX_BATCH; i += 2)
+            values[count++].pid = (uint8_t)strtoul(command.substr(i, 2).c_str(), nullptr, 16);
+        ObdPid::parseResponse(r, values, count);
+
+        for (size_t i = 0; i < count; i++) {
+
+            const ObdPid::Value& v = values[i];
+            if (!v.valid) continue;
+            char name[12];
+            snprintf(name, sizeof(name), "pid_%02X", v.pid);
+            switch (v.pid) {
+                case ObdPid::PID_SPEED: add(tUs, name, ObdPid::speedKmh(v)); break;
+                case ObdPid::PID_RPM: add(tUs, name, ObdPid::rpm(v)); break;
+                case ObdPid::PID_MAF: add(tUs, name, ObdPid::mafGs(v)); break;
+                case ObdPid::PID_FUEL_RATE: add(tUs, name, ObdPid::fuelRateLph(v)); break;
+                case ObdPid::PID_INTAKE_TEMP: add(tUs, name, ObdPid::intakeTempC(v)); break;
+                default: {
+                    uint32_t raw = 0;
+                    for (uint8_t b = 0; b < v.len; b++) raw = raw << 8 | v.data[b];
+                    add(tUs, name, raw);
+                }
+            }
+        }
+    }
+
+    // Zdania NMEA tym samym parserem co task GPS: prędkość z RMC, satelity z GGA
+    void gpsRx(uint64_t tUs, const uint8_t* data, size_t len) {
+
+        for (size_t i = 0; i < len; i++) {
+
+            NmeaParser::Sentence type = gps.encode((char)data[i]);
+            if (type == NmeaParser::NONE) continue;
+
+            const NmeaParser::Data& g = gps.data();
+            if (type == NmeaParser::RMC && g.rmcValid && (g.updated & NmeaParser::UPD_SPEED))
+                add(tUs, "rmc_speed_mms", g.speedMmS);
+            else if (type == NmeaParser::GGA && (g.updated & NmeaParser::UPD_SATS))
+                add(tUs, "gga_sats", g.sats);
+            gps.clearUpdated();
+        }
+        const NmeaParser::Stats& st = gps.stats();
+        sentences = st.sentences[NmeaParser::RMC] + st.sentences[NmeaParser::GGA] + st.sentences[NmeaParser::GSA];
+        badChecksum = st.checksumErrors + st.malformed;
+    }
+};
+
+static void onChunk(void* ctx, uint64_t tUs, uint8_t channel, const uint8_t* data, size_t len) {
+    static_cast<LinkDecoder*>(ctx)->feed(tUs, channel, data, len);
+}
+
+static uint64_t hostUs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void hostSleep(uint64_t us) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+// Ostatnia wartość i liczba zdarzeń każdej nazwy
+static void printEvents(const std::vector<Event>& events) {
+
+    std::vector<std::string> names;
+    for (const Event& e : events)
+        if (std::find(names.begin(), names.end(), e.name) == names.end()) names.push_back(e.name);
+
+    for (const std::string& n : names) {
+        uint32_t count = 0;
+        double last = 0;
+        for (const Event& e : events)
+            if (e.name == n) { count++; last = e.value; }
+        printf("[cap]   %-14s %6u  last %.2f\n", n.c_str(), count, last);
+    }
+}
+
+static void report(const CaptureReplay& player, const LinkDecoder& d, double seconds) {
+
+    const CaptureReplay::Stats& st = player.stats();
+    printf("[cap] %u blocks (%u bad), %u chunks, %.1f s recorded\n",
+           st.blocks, st.badBlocks, st.chunks, st.durationUs / 1e6);
+    printf("[cap] OBD tx %llu B, rx %llu B, GPS %llu B, lost %llu B in %u gaps\n",
+           (unsigned long long)st.bytes[CAPTURE_OBD_TX], (unsigned long long)st.bytes[CAPTURE_OBD_RX],
+           (unsigned long long)st.bytes[CAPTURE_GPS_RX], (unsigned long long)st.bytes[CAPTURE_LOST], d.gaps);
+    printf("[cap] OBD: %u commands, %u responses, %u without prompt, %u NO DATA, %u bytes outside commands\n",
+           d.commands, d.responses, d.unanswered, d.noData, d.discarded);
+    CanMonitor::Stats cs = d.canStats();
+    if (cs.bytes) printf("[cap] ATMA: %u frames, %u matched, %u malformed\n", cs.frames, cs.matched, cs.malformed);
+    printf("[cap] NMEA: %u sentences, %u rejected\n", d.sentences, d.badChecksum);
+    if (d.vin[0]) printf("[cap] VIN %s\n", d.vin);
+    printEvents(d.events);
+
+    uint64_t total = 0;
+    for (size_t c = 0; c < CAPTURE_CHANNELS - 1; c++) total += st.bytes[c];
+    if (seconds > 0) printf("[cap] replay %.3f s (%.1f MB/s)", seconds, total / seconds / 1e6);
+    if (st.maxLagUs) printf(", max lag %.1f ms", st.maxLagUs / 1000.0);
+    printf("\n");
+}
+
+// Odtworzenie pliku, zwraca czas [s]
+static double play(CaptureReplay& player, LinkDecoder& d, double speed) {
+
+    uint64_t t0 = hostUs();
+    player.run(onChunk, &d, speed, hostUs, hostSleep);
+    return (hostUs() - t0) / 1e6;
+}
+
+static bool readFile(const char* path, std::vector<uint8_t>& out) {
+
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return false;
+    }
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+    fclose(f);
+    return true;
+}
+
+// =============================================================================
+// TRYB PLIKU
+// =============================================================================
+
+static int replayFile(const char* path, double speed, bool listEvents) {
+
+    std::vector<uint8_t> file;
+    if (!readFile(path, file)) return 2;
+
+    CaptureReplay player;
+    if (!player.load(file.data(), file.size())) {
+        fprintf(stderr, "%s: not a link capture file\n", path);
+        return 2;
+    }
+
+    LinkDecoder d;
+    double seconds = play(player, d, speed);
+    if (listEvents)
+        for (const Event& e : d.events) printf("%.6f %s %.3f\n", e.tUs / 1e6, e.name.c_str(), e.value);
+    report(player, d, seconds);
+    return 0;
+}
+
+// =============================================================================
+// TRYB SYNTETYCZNY
+// =============================================================================
+
+// Plik nagrania w pamięci - zapis jak w TripLogger (fragmenty jak w LinkCapture)
+struct CaptureWriter {
+    std::vector<uint8_t> file;
+    BlockEncoder enc{STREAM_CAPTURE};
+
+    CaptureWriter() {
+        file.resize(FILE_HEADER_SIZE);
+        writeFileHeader(file.data(), STREAM_CAPTURE);
+    }
+
+    void record(uint8_t channel, uint32_t tUs, const uint8_t* data, size_t len) {
+
+        while (len > 0) {
+            uint16_t n = len > (size_t)SDCARD::CAPTURE_CHUNK_MAX ? (uint16_t)SDCARD::CAPTURE_CHUNK_MAX : (uint16_t)len;
+            CaptureChunk c = { tUs, channel, n, data };
+            while (!enc.add(c) && !enc.empty()) finish();
+            data += n;
+            len -= n;
+        }
+    }
+
+    void finish() {
+        uint8_t block[BLOCK_MAX];
+        size_t n = enc.finish(block);
+        file.insert(file.end(), block, block + n);
+    }
+};
+
+static uint64_t clockUs = 0;
+static uint64_t startUs = 0;
+static CaptureWriter* writer = nullptr;
+static LinkDecoder* live = nullptr;
+
+static uint32_t virtualNowMs() { return (uint32_t)(clockUs / 1000); }
+static void virtualSleepMs(uint32_t ms) { clockUs += (uint64_t)ms * 1000; }
+
+// Nagranie fragmentu i dekodowanie na żywo z tym samym czasem
+static void rec(uint8_t channel, const uint8_t* data, size_t len) {
+    writer->record(channel, (uint32_t)clockUs, data, len);
+    for (size_t pos = 0; pos < len; pos += SDCARD::CAPTURE_CHUNK_MAX) {
+        size_t n = len - pos < (size_t)SDCARD::CAPTURE_CHUNK_MAX ? len - pos : (size_t)SDCARD::CAPTURE_CHUNK_MAX;
+        live->feed(clockUs - startUs, channel, data + pos, n);
+    }
+}
+
+static void onRx(const uint8_t* data, size_t len) {
+    rec(CAPTURE_OBD_RX, data, len);
+}
+
+static void send(Elm327Emulator& elm, const char* cmd) {
+    std::string out = std::string(cmd) + "\r";
+    rec(CAPTURE_OBD_TX, (const uint8_t*)out.data(), out.size());
+    elm.write((const uint8_t*)out.data(), out.size());
+}
+
+static uint32_t rng = 12345;
+static uint32_t random32() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+// Zdania RMC i GGA dla sekundy s (prędkość ze skryptu, w węzłach)
+static std::string nmeaSecond(uint32_t s, float kmh) {
+
+    char body[2][96];
+    snprintf(body[0], sizeof(body[0]), "GPRMC,%02u%02u%02u.00,A,5213.%04u,N,02100.5678,E,%.2f,87.5,200125,,,A",
+             (s / 3600) % 24, (s / 60) % 60, s % 60, (s * 7) % 10000, kmh / 1.852f);
+    snprintf(body[1], sizeof(body[1]), "GPGGA,%02u%02u%02u.00,5213.%04u,N,02100.5678,E,1,%02u,0.9,110.0,M,34.0,M,,",
+             (s / 3600) % 24, (s / 60) % 60, s % 60, (s * 7) % 10000, 7 + s % 5);
+
+    std::string out;
+    for (const char* b : body) {
+        uint8_t sum = 0;
+        for (const char* p = b; *p; p++) sum ^= (uint8_t)*p;
+        char tail[8];
+        snprintf(tail, sizeof(tail), "*%02X\r\n", sum);
+        out += std::string("$") + b + tail;
+    }
+    return out;
+}
+
+static bool sameEvents(const std::vector<Event>& a, const std::vector<Event>& b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+static int synthetic(uint32_t seconds, double speed, const char* emitPath) {
+
+    const char* odoCmd = profile.odometer.requestLen ? profile.odometer.command : nullptr;
+    Elm327Emulator::Broadcast broadcasts[VehicleProfile::CAN_COUNT];
+    uint8_t broadcastCount = 0;
+    for (uint8_t s = 0; s < VehicleProfile::CAN_COUNT; s++) {
+        if (!profile.hasCan[s] || (s == VehicleProfile::CAN_ODOMETER && !odoCmd)) continue;
+        const CanMonitor::Signal& sig = profile.can[s];
+        broadcasts[broadcastCount++] = { sig.id,
+            (uint16_t)(s == VehicleProfile::CAN_SPEED ? OBD_CONFIG::SIM_CAN_SPEED_MS : OBD_CONFIG::SIM_CAN_ODO_MS),
+            s == VehicleProfile::CAN_SPEED ? "010D" : odoCmd, sig.start, sig.length, 1.0f / sig.scale };
+    }
+
+    // Zegar tuż przed przepełnieniem 32-bitowego micros() - plik musi to przenieść
+    clockUs = startUs = 0xFFFFFFFFull - 20000000ull;
+    CaptureWriter w;
+    LinkDecoder d;
+    writer = &w;
+    live = &d;
+
+    Elm327Emulator::Config cfg = Elm327Emulator::defaultConfig(virtualNowMs, virtualSleepMs);
+    cfg.chunkBytes = 20;                    // Fragmenty jak z Bluetooth SPP
+    cfg.broadcasts = broadcasts;
+    cfg.broadcastCount = broadcastCount;
+    cfg.busFps = 300;
+    Elm327Emulator elm(cfg);
+    elm.loadScript(Elm327Emulator::DEFAULT_SCRIPT);
+    elm.setHandler(onRx);
+
+    // Rozruch jak w ObdDiscovery
+    const char* const BRING_UP[] = { "ATZ", "ATE0", "ATL0", "ATS0", "ATH0", "ATSP0", "0100", "0120", "ATDPN", "0902" };
+    for (const char* c : BRING_UP) send(elm, c);
+
+    uint64_t endUs = startUs + (uint64_t)seconds * 1000000;
+    uint64_t nextGpsUs = startUs;
+    uint32_t gpsSecond = 0;
+    std::string gpsPending;
+    bool monitored = false;
+
+    for (uint32_t cycle = 0; clockUs < endUs; cycle++) {
+
+        // NMEA z 9600 bd - kilka fragmentów w każdym odstępie między komendami
+        if (clockUs >= nextGpsUs) {
+            uint8_t data[4], len;
+            float kmh = elm.scriptValue("010D", (uint32_t)((clockUs - startUs) / 1000), data, &len) ? data[0] : 0;
+            gpsPending += nmeaSecond(gpsSecond++, kmh);
+            nextGpsUs += 1000000;
+        }
+        if (!gpsPending.empty()) {
+            size_t n = 1 + random32() % 64;
+            if (n > gpsPending.size()) n = gpsPending.size();
+            rec(CAPTURE_GPS_RX, (const uint8_t*)gpsPending.data(), n);
+            gpsPending.erase(0, n);
+        }
+
+        if (!monitored && clockUs - startUs >= (uint64_t)seconds * 500000 && broadcastCount) {
+            // Okno nasłuchu w połowie nagrania
+            send(elm, "ATH1");
+            send(elm, "ATMA");
+            clockUs += 1000000;
+            const uint8_t stop = '\r';
+            rec(CAPTURE_OBD_TX, &stop, 1);
+            elm.write(&stop, 1);
+            send(elm, "ATH0");
+            monitored = true;
+        } else if (odoCmd && cycle % 50 == 0) {
+            send(elm, odoCmd);
+        } else if (cycle % 10 == 0) {
+            send(elm, "0105");
+        } else {
+            send(elm, "010D0C10");
+        }
+        clockUs += 5000 + random32() % 5000;
+    }
+    w.finish();
+
+    printf("[cap] synthetic %u s: %zu bytes, %zu live events\n", seconds, w.file.size(), d.events.size());
+
+    if (emitPath) {
+        FILE* f = fopen(emitPath, "wb");
+        if (!f || fwrite(w.file.data(), 1, w.file.size(), f) != w.file.size()) fprintf(stderr, "%s: write failed\n", emitPath);
+        if (f) fclose(f);
+    }
+
+    CaptureReplay player;
+    if (!player.load(w.file.data(), w.file.size())) {
+        fprintf(stderr, "synthetic capture rejected\n");
+        return 1;
+    }
+
+    LinkDecoder fast;
+    double seconds0 = play(player, fast, 0.0);
+    report(player, fast, seconds0);
+    bool ok = sameEvents(d.events, fast.events) && fast.badChecksum == 0 && fast.unanswered == 0;
+    printf("[cap] max speed vs live: %s\n", ok ? "identical" : "DIFFERENT");
+
+    if (speed > 0) {
+        LinkDecoder paced;
+        double s = play(player, paced, speed);
+        bool same = sameEvents(d.events, paced.events);
+        printf("[cap] %.0fx (%.2f s, max lag %.1f ms) vs live: %s\n",
+               speed, s, player.stats().maxLagUs / 1000.0, same ? "identical" : "DIFFERENT");
+        ok = ok && same;
+    }
+
+    // Uszkodzony blok w środku pliku - tylko jego zdarzenia mogą zniknąć
+    std::vector<uint8_t> broken = w.file;
+    broken[broken.size() / 2] ^= 0x5A;
+    CaptureReplay brokenPlayer;
+    brokenPlayer.load(broken.data(), broken.size());
+    LinkDecoder partial;
+    brokenPlayer.run(onChunk, &partial);
+    bool contained = brokenPlayer.stats().badBlocks == 1 && partial.events.size() < d.events.size()
+                     && partial.events.size() + 200 > d.events.size()
+                     && partial.events.back() == d.events.back();
+    printf("[cap] corrupt block: %u bad, %zu/%zu events kept: %s\n", brokenPlayer.stats().badBlocks,
+           partial.events.size(), d.events.size(), contained ? "contained" : "NOT CONTAINED");
+
+    return ok && contained ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+
+    const char* path = nullptr;
+    const char* emitPath = nullptr;
+    const char* profilePath = nullptr;
+    bool listEvents = false;
+    uint32_t seconds = 0;
+    double speed = -1.0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (a == "--events") listEvents = true;
+        else if (a == "--synthetic" && hasValue) seconds = (uint32_t)atoi(argv[++i]);
+        else if (a == "--speed" && hasValue) speed = atof(argv[++i]);
+        else if (a == "--emit" && hasValue) emitPath = argv[++i];
+        else if (a == "--profile" && hasValue) profilePath = argv[++i];
+        else if (a[0] != '-' && !path) path = argv[i];
+        else {
+            path = nullptr;
+            seconds = 0;
+            break;
+        }
+    }
+
+    std::vector<uint8_t> text;
+    if (profilePath && !readFile(profilePath, text)) return 2;
+    text.push_back('\0');
+    char err[48];
+    if (!VehicleProfile::compile(profilePath ? (const char*)text.data() : VehicleProfile::BUILTIN, profile, err, sizeof(err))) {
+        fprintf(stderr, "profile error: %s\n", err);
+        return 2;
+    }
+
+    if (path) return replayFile(path, speed > 0 ? speed : 0.0, listEvents);
+    if (seconds > 0) return synthetic(seconds, speed >= 0 ? speed : 20.0, emitPath);
+
+    fprintf(stderr, "usage: %s link_capture.bin [--speed x] [--profile file] [--events]\n"
+                    "       %s --synthetic s [--speed x] [--emit link_capture.bin] [--profile file]\n",
+            argv[0], argv[0]);
+    return 2;
+}
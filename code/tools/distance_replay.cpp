@@ -0,0 +1,213 @@
+/**
+ * @file distance_replay.cpp
+ * @brief Narzędzie hosta - walidacja DistanceEstimator na zapisanych lub syntetycznych przejazdach
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Tryb CSV - odtworzenie zapisanego przejazdu:
+ * ```
+ * t_ms,speed_kmh,odometer_km[,true_m]
+ * 0,0,50000,
+ * 500,12,,
+ * ```
+ * Puste pole = brak próbki w tej chwili. Gdy podano true_m (np. dystans
+ * z GPS), wypisywany jest błąd estymatora i samego odometru.
+ *
+ * Tryb syntetyczny (bez pliku) - profil prędkości ze skryptu emulatora
+ * ELM327 (elm327_emulator.h). Dystans prawdziwy to całka z kroku 10 ms,
+ * odometr prawdziwy wynika z niego (losowe położenie startu w km).
+ * Estymator dostaje prędkość co 500 ms z błędem skali i szumem oraz
+ * odometr co 10 s - jak task OBD.
+ *
+ * Kompilacja (z katalogu code/):
+ * ```
+ * g++ -std=c++17 -O2 -Iinclude tools/distance_replay.cpp src/distance_estimator.cpp \
+ *     src/elm327_emulator.cpp -o distance_replay
+ * ```
+ *
+ * Użycie:
+ * ```
+ * distance_replay [drive.csv] [--scale %] [--noise kmh] [--speed-ms ms] [--odo-ms ms] [--runs n]
+ * ```
+ */
+
+#include "distance_estimator.h"
+#include "elm327_emulator.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+struct Result {
+    double trueM;
+    double estimateM;
+    double maxErrM;         ///< Estymator: największy błąd bezwzględny
+    double maxOdoErrM;      ///< Sam odometr: największy błąd bezwzględny
+};
+
+// =============================================================================
+// TRYB CSV
+// =============================================================================
+
+static int replayCsv(const char* path) {
+
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return 2;
+    }
+
+    DistanceEstimator est;
+    Result r = {};
+    long startKm = -1, lastKm = -1;
+    char line[256];
+    long rows = 0;
+
+    while (fgets(line, sizeof(line), f)) {
+
+        if (!isdigit((unsigned char)line[0])) continue;            // Nagłówek / komentarz
+
+        // Pola mogą być puste - ręczny podział po przecinkach
+        char* fields[4] = { nullptr, nullptr, nullptr, nullptr };
+        char* p = line;
+        for (int i = 0; i < 4 && p; i++) {
+            fields[i] = p;
+            p = strchr(p, ',');
+            if (p) *p++ = '\0';
+        }
+
+        uint32_t t = (uint32_t)strtoul(fields[0], nullptr, 10);
+        if (fields[1] && *fields[1] && *fields[1] != '\n') est.addSpeed(t, atoi(fields[1]));
+        if (fields[2] && *fields[2] && *fields[2] != '\n') {
+            long km = atol(fields[2]);
+            if (startKm < 0) startKm = km;
+            lastKm = km;
+            est.addOdometer(t, km);
+        }
+
+        if (fields[3] && *fields[3] && *fields[3] != '\n') {
+            r.trueM = atof(fields[3]);
+            double err = fabs(est.distanceMm() / 1000.0 - r.trueM);
+            double odoErr = fabs((lastKm - startKm) * 1000.0 - r.trueM);
+            if (err > r.maxErrM) r.maxErrM = err;
+            if (odoErr > r.maxOdoErrM) r.maxOdoErrM = odoErr;
+        }
+        rows++;
+    }
+    fclose(f);
+
+    DistanceEstimator::Stats s = est.stats();
+    printf("[replay] %s: %ld rows, estimate %.3f km, odometer %ld km, %u ticks, max correction %u m, %u speed gaps\n",
+           path, rows, est.distanceMm() / 1e6, lastKm - startKm, s.ticks, s.maxCorrectionMm / 1000, s.gaps);
+    if (r.trueM > 0)
+        printf("[replay] reference %.3f km: estimator max |err| %.0f m, odometer only max |err| %.0f m\n",
+               r.trueM / 1000.0, r.maxErrM, r.maxOdoErrM);
+    return 0;
+}
+
+// =============================================================================
+// TRYB SYNTETYCZNY
+// =============================================================================
+
+static uint32_t rng = 12345;
+static double uniform() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return (rng & 0xFFFFFF) / (double)0x1000000;
+}
+
+static uint32_t zeroClock() { return 0; }
+
+static Result simulate(const Elm327Emulator& script, uint32_t durationMs, double scalePct,
+                       double noiseKmh, uint32_t speedMs, uint32_t odoMs) {
+
+    DistanceEstimator est;
+    Result r = {};
+
+    const long startKm = 50000;
+    double startFraction = uniform();                   // Położenie startu wewnątrz km
+    double trueM = 0;
+    uint32_t nextSpeed = 0, nextOdo = 0;
+
+    for (uint32_t t = 0; t <= durationMs; t += 10) {
+
+        uint8_t data[4], len;
+        double v = script.scriptValue("010D", t, data, &len) ? data[0] : 0;
+        trueM += v / 3.6 * 0.010;                       // 10 ms kroku
+
+        long trueKm = startKm + (long)floor(startFraction + trueM / 1000.0);
+
+        if (t >= nextSpeed) {
+            double measured = v * (1.0 + scalePct / 100.0) + (uniform() * 2 - 1) * noiseKmh;
+            est.addSpeed(t, measured < 0 ? 0 : (int)lround(measured));
+            nextSpeed += speedMs;
+        }
+        if (t >= nextOdo) {
+            est.addOdometer(t, trueKm);
+            nextOdo += odoMs;
+        }
+
+        double err = fabs(est.distanceMm() / 1000.0 - trueM);
+        double odoErr = fabs((trueKm - startKm) * 1000.0 - trueM);
+        if (err > r.maxErrM) r.maxErrM = err;
+        if (odoErr > r.maxOdoErrM) r.maxOdoErrM = odoErr;
+    }
+
+    r.trueM = trueM;
+    r.estimateM = est.distanceMm() / 1000.0;
+    return r;
+}
+
+int main(int argc, char** argv) {
+
+    const char* csv = nullptr;
+    double scalePct = 2.0, noiseKmh = 1.0;
+    uint32_t speedMs = 500, odoMs = 10000;
+    int runs = 20;
+
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (a == "--scale" && hasValue) scalePct = atof(argv[++i]);
+        else if (a == "--noise" && hasValue) noiseKmh = atof(argv[++i]);
+        else if (a == "--speed-ms" && hasValue) speedMs = (uint32_t)atoi(argv[++i]);
+        else if (a == "--odo-ms" && hasValue) odoMs = (uint32_t)atoi(argv[++i]);
+        else if (a == "--runs" && hasValue) runs = atoi(argv[++i]);
+        else if (a[0] != '-' && !csv) csv = argv[i];
+        else {
+            fprintf(stderr, "usage: %s [drive.csv] [--scale %%] [--noise kmh] [--speed-ms ms] [--odo-ms ms] [--runs n]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (csv) return replayCsv(csv);
+
+    Elm327Emulator script(Elm327Emulator::defaultConfig(zeroClock, nullptr));
+    script.loadScript(Elm327Emulator::DEFAULT_SCRIPT);
+
+    // Krótkie i długie przejazdy z tego samego profilu
+    const uint32_t durations[] = { 3 * 60000, 10 * 60000, 60 * 60000 };
+    printf("[replay] speed every %u ms (scale %+.1f%%, noise %.1f km/h), odometer every %u ms, %d runs each\n",
+           speedMs, scalePct, noiseKmh, odoMs, runs);
+
+    for (uint32_t duration : durations) {
+
+        double worst = 0, worstOdo = 0, sumFinal = 0;
+        double trueM = 0;
+        for (int run = 0; run < runs; run++) {
+            Result r = simulate(script, duration, scalePct, noiseKmh, speedMs, odoMs);
+            if (r.maxErrM > worst) worst = r.maxErrM;
+            if (r.maxOdoErrM > worstOdo) worstOdo = r.maxOdoErrM;
+            sumFinal += fabs(r.estimateM - r.trueM);
+            trueM = r.trueM;
+        }
+        printf("[replay] %2u min, %.3f km: estimator max |err| %.0f m (final avg %.0f m), odometer only max |err| %.0f m\n",
+               duration / 60000, trueM / 1000.0, worst, sumFinal / runs, worstOdo);
+    }
+    return 0;
+}
@@ -0,0 +1,391 @@
+/**
+ * @file fare_bench.cpp
+ * @brief Narzędzie hosta - dokładność i przepustowość FareEngine wobec dokładnego odniesienia
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * 1. replay - losowe długie kursy (do całej zmiany): próbki OBD co 100 ms -
+ *    30 s (także przerwy łącza z wieloma km w jednej próbce), postoje, zmiana
+ *    godziny i dnia (mnożniki nocne, weekend, święta), taryfa za km z progami
+ *    i taryfa za litr, z opłatą za postój. Po każdej próbce snapshot()
+ *    porównywany jest z odniesieniem liczonym od zera z sum całkowitych
+ *    (ułamki wymierne, 128 bit): dystans, paliwo, czas, postój, rozpoczęte km
+ *    i każdy składnik należności. Dowolna różnica (choćby 1 gr) = dryf.
+ *    Dla porównania podawany jest błąd dawnego liczenia na float
+ *    (dystans sumowany w km x stawka).
+ * 2. bench - przepustowość addSample() i snapshot() na milionach próbek.
+ *
+ * Odniesienie nie powiela akumulatorów silnika: sumuje paliwo i postój
+ * osobno dla każdego mnożnika, rozpoczęte km liczy z sumy dystansu w mm,
+ * a zaokrągla raz na końcu.
+ *
+ * Kompilacja (z katalogu code/):
+ * ```
+ * g++ -std=c++17 -O2 -Iinclude tools/fare_bench.cpp src/fare_engine.cpp src/tariff_table.cpp -o fare_bench
+ * ```
+ *
+ * Użycie:
+ * ```
+ * fare_bench [--seed n] [--trips n] [--hours h] [--samples n]
+ * ```
+ * Kod wyjścia 1 oznacza dryf należności lub liczników wobec odniesienia.
+ */
+
+#include "fare_engine.h"
+#include "tariff_table.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <map>
+
+typedef unsigned __int128 u128;
+
+static const char* TARIFF_KM =
+    "mode km\n"
+    "flagfall 8.00\n"
+    "band 0 3.00\n"
+    "band 10 2.60\n"
+    "band 50 2.15\n"
+    "waiting 0.67 10\n"
+    "mult 1-5 22-6 150\n"
+    "mult 6-7 0-24 150\n"
+    "mult 5 15-19 120\n"
+    "holiday 12-25 200\n"
+    "holiday 1-1 200\n";
+
+static const char* TARIFF_LITRE =
+    "mode litre\n"
+    "flagfall 9.00\n"
+    "rate 6.49\n"
+    "waiting 0.83 12\n"
+    "mult 1-7 22-6 130\n"
+    "holiday 11-11 175\n";
+
+static uint32_t rng = 12345;
+static uint32_t random32() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+static uint32_t randomRange(uint32_t lo, uint32_t hi) {
+    return lo + random32() % (hi - lo + 1);
+}
+
+// =============================================================================
+// KALENDARZ SYMULACJI (czas lokalny)
+// =============================================================================
+
+struct Clock {
+    uint32_t year, month, day, weekday, hour;   // weekday: 0 = pon
+    uint32_t msInHour;
+};
+
+static uint32_t daysInMonth(uint32_t year, uint32_t month) {
+    static const uint8_t days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return month == 2 && leap ? 29 : days[month - 1];
+}
+
+static void advance(Clock& c, uint32_t ms) {
+
+    c.msInHour += ms;
+    while (c.msInHour >= 3600000) {
+        c.msInHour -= 3600000;
+        if (++c.hour < 24) continue;
+        c.hour = 0;
+        c.weekday = (c.weekday + 1) % 7;
+        if (++c.day <= daysInMonth(c.year, c.month)) continue;
+        c.day = 1;
+        if (++c.month <= 12) continue;
+        c.month = 1;
+        c.year++;
+    }
+}
+
+// =============================================================================
+// ODNIESIENIE - sumy całkowite, zaokrąglenie na końcu
+// =============================================================================
+
+struct Reference {
+
+    const TariffTable& t;
+    uint64_t mm = 0, ul = 0, elapsedMs = 0, waitingMs = 0, samples = 0;
+    uint64_t chargedKm = 0;                     // Rozpoczęte km już wycenione
+    u128 kmGrPct = 0;                           // Σ stawka progu x mnożnik w chwili rozpoczęcia km
+    std::map<uint8_t, uint64_t> fuelUlAtPct;    // Paliwo [µl] przy danym mnożniku
+    std::map<uint8_t, uint64_t> waitMsAtPct;    // Postój [ms] przy danym mnożniku
+    uint8_t pct = 100;
+
+    explicit Reference(const TariffTable& table) : t(table) {}
+
+    uint32_t rateForKm(uint64_t k) const {
+        uint32_t rate = 0;
+        for (uint8_t i = 0; i < t.bandCount; i++)
+            if (t.bands[i].fromKm <= k) rate = t.bands[i].rateGr;
+        return rate;
+    }
+
+    void chargeKm() {
+        // Km o indeksie k rozpoczyna się po przejechaniu k x 1 000 000 mm (km 0 od razu)
+        if (t.mode != TariffTable::MODE_KM) return;
+        for (; chargedKm <= mm / 1000000; chargedKm++)
+            kmGrPct += (u128)rateForKm(chargedKm) * pct;
+    }
+
+    void setPct(uint8_t p) {
+        pct = p;
+        // Przed pierwszą próbką pierwszy km jest wyceniany wg bieżącego mnożnika
+        if (samples == 0) { chargedKm = 0; kmGrPct = 0; chargeKm(); }
+    }
+
+    void add(uint32_t dMm, uint32_t dUl, uint32_t dMs, int16_t speedKmh) {
+
+        mm += dMm;
+        ul += dUl;
+        chargeKm();
+        fuelUlAtPct[pct] += dUl;
+
+        // Postój - definicja z fare_engine.h (prędkość chwilowa lub średnia próbki)
+        bool stopped = speedKmh >= 0 ? speedKmh < t.waitBelowKmh
+                                     : (u128)dMm * 3600 < (u128)t.waitBelowKmh * 1000 * dMs;
+        if (t.waitRateGrPerMin && dMs > 0 && stopped) {
+            waitingMs += dMs;
+            waitMsAtPct[pct] += dMs;
+        }
+        elapsedMs += dMs;
+        samples++;
+    }
+
+    // Zaokrąglenie ułamka n / d do najbliższej liczby całkowitej, połówki w górę
+    static uint64_t nearest(u128 n, u128 d) {
+        u128 q = n / d, r = n % d;
+        return (uint64_t)(2 * r >= d ? q + 1 : q);
+    }
+
+    uint64_t travelGr() const {
+        if (t.mode == TariffTable::MODE_KM) return nearest(kmGrPct, 100);
+        u128 n = 0;
+        for (const auto& kv : fuelUlAtPct) n += (u128)kv.second * t.litreRateGr * kv.first;
+        return nearest(n, (u128)1000000 * 100);
+    }
+
+    uint64_t waitingGr() const {
+        u128 n = 0;
+        for (const auto& kv : waitMsAtPct) n += (u128)kv.second * t.waitRateGrPerMin * kv.first;
+        return nearest(n, (u128)60000 * 100);
+    }
+};
+
+// =============================================================================
+// KURS
+// =============================================================================
+
+struct TripResult {
+    uint64_t samples = 0;
+    uint64_t mismatches = 0;
+    uint64_t distanceM = 0;
+    uint32_t dueGr = 0;
+    double floatErrGr = 0;
+};
+
+static bool compare(const FareEngine::Snapshot& s, const Reference& r, uint64_t sampleNo, bool report) {
+
+    uint64_t travel = r.travelGr(), waiting = r.waitingGr();
+    uint64_t due = r.t.flagFallGr + travel + waiting;
+    bool ok = s.distanceM == r.mm / 1000 && s.fuelMl == r.ul / 1000 && s.elapsedMs == r.elapsedMs
+           && s.waitingMs == r.waitingMs && s.startedKm == r.mm / 1000000 + 1 && s.samples == r.samples
+           && s.waitingGr == waiting && s.dueGr == due && s.multiplierPct == r.pct;
+
+    if (!ok && report)
+        printf("[fare]   drift at sample %llu: engine %u m %u ml %u km %u ms wait, %u gr (wait %u gr) / "
+               "reference %llu m %llu ml %llu km %llu ms wait, %llu gr (wait %llu gr)\n",
+               (unsigned long long)sampleNo, s.distanceM, s.fuelMl, s.startedKm, s.waitingMs, s.dueGr, s.waitingGr,
+               (unsigned long long)(r.mm / 1000), (unsigned long long)(r.ul / 1000),
+               (unsigned long long)(r.mm / 1000000 + 1), (unsigned long long)r.waitingMs,
+               (unsigned long long)due, (unsigned long long)waiting);
+    return ok;
+}
+
+static TripResult replayTrip(const TariffTable& table, uint32_t durationMs) {
+
+    TripResult res;
+    FareEngine engine;
+    engine.setTable(table);
+    Reference ref(table);
+
+    Clock clk;
+    clk.year = 2025;
+    clk.month = randomRange(1, 12);
+    clk.day = randomRange(1, daysInMonth(clk.year, clk.month));
+    clk.weekday = randomRange(0, 6);
+    clk.hour = randomRange(0, 23);
+    clk.msInHour = randomRange(0, 3599999);
+
+    // Dawne liczenie (float): dystans w km sumowany próbka po próbce
+    float floatKm = 0;
+
+    uint32_t speedKmh = 0, stopLeftMs = 0, t = 0;
+    bool first = true;
+    while (t < durationMs) {
+
+        engine.setClock((uint8_t)clk.weekday, (uint8_t)clk.hour, (uint8_t)clk.month, (uint8_t)clk.day);
+        ref.setPct(table.multiplierPct((uint8_t)clk.weekday, (uint8_t)clk.hour, (uint8_t)clk.month,
+                                       (uint8_t)clk.day));
+        if (first) {
+            first = false;
+            if (!compare(engine.snapshot(), ref, 0, true)) res.mismatches++;
+        }
+
+        // Odstęp próbek: zwykle 100 ms - 2 s, czasem przerwa łącza do 30 s
+        uint32_t dt = random32() % 50 == 0 ? randomRange(5000, 30000) : randomRange(100, 2000);
+
+        if (stopLeftMs > 0) {
+            speedKmh = 0;
+            stopLeftMs = stopLeftMs > dt ? stopLeftMs - dt : 0;
+        } else {
+            int32_t v = (int32_t)speedKmh + (int32_t)randomRange(0, 12) - 5;
+            speedKmh = v < 0 ? 0 : v > 140 ? 140 : (uint32_t)v;
+            if (random32() % 400 == 0) stopLeftMs = randomRange(10000, 600000);
+        }
+
+        uint32_t dMm = (uint32_t)((uint64_t)speedKmh * dt * 10 / 36);
+        dMm += speedKmh ? randomRange(0, 999) : 0;                   // Reszty poniżej mm z OBD
+        uint32_t dUl = (uint32_t)((uint64_t)dt * 250 / 1000) + dMm / 13;   // Bieg jałowy + jazda
+        int16_t speed = random32() % 10 == 0 ? -1 : (int16_t)speedKmh;     // Czasem bez prędkości chwilowej
+
+        engine.addSample(dMm, dUl, dt, speed);
+        ref.add(dMm, dUl, dt, speed);
+        floatKm += dMm / 1000000.0f;
+        res.samples++;
+
+        if (!compare(engine.snapshot(), ref, res.samples, res.mismatches == 0)) res.mismatches++;
+
+        t += dt;
+        advance(clk, dt);
+    }
+
+    FareEngine::Snapshot s = engine.snapshot();
+    res.distanceM = s.distanceM;
+    res.dueGr = s.dueGr;
+
+    // Dawna formuła bez mnożników i progów - tylko dla porównania dokładności sumowania
+    if (table.mode == TariffTable::MODE_KM) {
+        double exactKm = ref.mm / 1e6;
+        res.floatErrGr = (floatKm - exactKm) * table.bands[0].rateGr;
+    }
+    return res;
+}
+
+// =============================================================================
+// PRZEPUSTOWOŚĆ
+// =============================================================================
+
+static volatile uint32_t benchSink;     // Wynik snapshot() nie może zostać pominięty przez kompilator
+
+static void bench(const TariffTable& table, const char* name, uint64_t count) {
+
+    FareEngine engine;
+    engine.setTable(table);
+    engine.setClock(2, 14, 6, 11);
+
+    // Próbki przygotowane z góry - pomiar obejmuje tylko silnik
+    static uint32_t mm[4096], ul[4096], ms[4096];
+    static int16_t kmh[4096];
+    for (int i = 0; i < 4096; i++) {
+        ms[i] = randomRange(100, 1000);
+        kmh[i] = (int16_t)randomRange(0, 120);
+        mm[i] = (uint32_t)((uint64_t)kmh[i] * ms[i] * 10 / 36);
+        ul[i] = ms[i] / 4 + mm[i] / 13;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < count; i++) {
+        size_t k = i & 4095;
+        engine.addSample(mm[k], ul[k], ms[k], kmh[k]);
+        if ((i & 0xFFFFF) == 0) engine.reset();         // Kurs co ~1 M próbek (bez przepełnienia liczników)
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    for (uint64_t i = 0; i < count / 10; i++) {
+        benchSink = engine.snapshot().dueGr;
+        engine.addSample(mm[i & 4095], 0, 0, 0);
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    double addNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / count;
+    double snapNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / (count / 10);
+    printf("[fare] bench %-5s: %llu samples, addSample %.1f ns (%.0f M samples/s), snapshot+addSample %.1f ns\n",
+           name, (unsigned long long)count, addNs, 1000.0 / addNs, snapNs);
+}
+
+int main(int argc, char** argv) {
+
+    int trips = 50;
+    uint32_t hours = 12;
+    uint64_t samples = 20000000;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            rng = (uint32_t)strtoul(argv[++i], nullptr, 0);
+            if (rng == 0) rng = 12345;          // xorshift nie wychodzi z zera
+        }
+        else if (!strcmp(argv[i], "--trips") && i + 1 < argc) trips = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--hours") && i + 1 < argc) hours = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--samples") && i + 1 < argc) samples = strtoull(argv[++i], nullptr, 10);
+        else {
+            fprintf(stderr, "usage: fare_bench [--seed n] [--trips n] [--hours h] [--samples n]\n");
+            return 2;
+        }
+    }
+    if (hours < 1) hours = 1;
+    if (samples < 10) samples = 10;
+
+    struct { const char* name; const char* text; TariffTable table; } tariffs[] = {
+        { "km", TARIFF_KM, {} },
+        { "litre", TARIFF_LITRE, {} },
+    };
+
+    bool ok = true;
+    for (auto& tr : tariffs) {
+
+        char err[64];
+        if (!TariffTable::compile(tr.text, tr.table, err, sizeof(err))) {
+            printf("[fare] %s tariff: %s\n", tr.name, err);
+            return 2;
+        }
+
+        uint64_t total = 0, bad = 0, longestM = 0;
+        uint32_t maxDue = 0;
+        double floatMax = 0;
+        for (int i = 0; i < trips; i++) {
+
+            // Co piąty kurs - cała zmiana, pozostałe od kilku minut do kilku godzin
+            uint32_t durationMs = i % 5 == 0 ? hours * 3600000 : randomRange(120000, hours * 3600000 / 2);
+            TripResult r = replayTrip(tr.table, durationMs);
+            total += r.samples;
+            bad += r.mismatches;
+            if (r.distanceM > longestM) longestM = r.distanceM;
+            if (r.dueGr > maxDue) maxDue = r.dueGr;
+            double fe = r.floatErrGr < 0 ? -r.floatErrGr : r.floatErrGr;
+            if (fe > floatMax) floatMax = fe;
+        }
+
+        printf("[fare] replay %-5s: %d trips, %llu samples, longest %.1f km, max fare %.2f PLN, "
+               "%llu snapshots differ from exact reference%s\n",
+               tr.name, trips, (unsigned long long)total, longestM / 1000.0, maxDue / 100.0,
+               (unsigned long long)bad, bad ? "  <-- FAILED" : "");
+        if (tr.table.mode == TariffTable::MODE_KM)
+            printf("[fare]   float km accumulation (old code) off by up to %.2f gr per trip\n", floatMax);
+        ok = ok && bad == 0;
+    }
+
+    for (auto& tr : tariffs) bench(tr.table, tr.name, samples);
+
+    printf("[fare] %s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
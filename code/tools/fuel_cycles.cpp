@@ -0,0 +1,230 @@
+/**
+ * @file fuel_cycles.cpp
+ * @brief Narzędzie hosta - walidacja FuelAccumulator na syntetycznych cyklach jazdy
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Cykle ze spalaniem zadanym funkcją czasu - zużycie prawdziwe to całka
+ * z kroku 1 ms od pierwszej do ostatniej udanej próbki (poza tym oknem
+ * spalania nie zna żadna z metod):
+ *
+ * - idle    - postój, stałe 0.8 L/h
+ * - urban   - cykle: postój, przyspieszenie, jazda, hamowanie silnikiem
+ *             (odcięcie wtrysku), odcinki liniowe
+ * - highway - jazda ze zmiennym obciążeniem 6 +/- 2 L/h (sinusoida 20 s)
+ *
+ * Odpytywanie jak w tasku OBD: spalanie i prędkość zbiorczo co --period ms,
+ * odometr osobno co 10 s; każda odpowiedź przychodzi po opóźnieniu łącza
+ * (--latency + losowo do --jitter), ECU mierzy wartość w połowie tego czasu,
+ * część odpowiedzi to NO DATA (--nodata). Z --gap s w połowie cyklu łącze
+ * znika na podany czas.
+ *
+ * Porównanie:
+ * - legacy - reguła prostokątów taska sprzed zmiany: spalanie sprzed
+ *   zapytania x czas od poprzedniej iteracji (dowolnego zapytania)
+ * - trapez - FuelAccumulator z czasem nadejścia odpowiedzi
+ *
+ * Kompilacja (z katalogu code/):
+ * ```
+ * g++ -std=c++17 -O2 -Iinclude tools/fuel_cycles.cpp src/fuel_accumulator.cpp -o fuel_cycles
+ * ```
+ *
+ * Użycie:
+ * ```
+ * fuel_cycles [--period ms] [--latency ms] [--jitter ms] [--nodata %] [--gap s] [--runs n]
+ * ```
+ * Kod wyjścia 1 oznacza błąd całkowania trapezami powyżej 1% w cyklu bez przerwy łącza.
+ */
+
+#include "fuel_accumulator.h"
+#include "../cabulator_settings.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string>
+
+// =============================================================================
+// CYKLE JAZDY
+// =============================================================================
+
+static const double PI = 3.14159265358979;
+
+// Odcinki liniowe: czas [s] i spalanie na końcu odcinka [L/h]
+struct Segment {
+    double durationS;
+    double endLph;
+};
+
+static const Segment URBAN[] = {
+    { 0.0, 0.8 },       // Postój
+    { 15.0, 0.8 },
+    { 6.0, 7.5 },       // Przyspieszenie
+    { 2.0, 4.0 },
+    { 25.0, 3.2 },      // Jazda 50 km/h
+    { 1.0, 0.0 },       // Hamowanie silnikiem - odcięcie wtrysku
+    { 8.0, 0.0 },
+    { 1.0, 0.8 },
+};
+
+static double urbanLph(double tS) {
+
+    double cycle = 0;
+    for (const Segment& s : URBAN) cycle += s.durationS;
+    tS = fmod(tS, cycle);
+
+    double start = 0, startLph = URBAN[0].endLph;
+    for (const Segment& s : URBAN) {
+        if (s.durationS > 0 && tS <= start + s.durationS)
+            return startLph + (s.endLph - startLph) * (tS - start) / s.durationS;
+        start += s.durationS;
+        startLph = s.endLph;
+    }
+    return startLph;
+}
+
+static double idleLph(double) { return 0.8; }
+static double highwayLph(double tS) { return 6.0 + 2.0 * sin(2 * PI * tS / 20.0); }
+
+struct Cycle {
+    const char* name;
+    double (*lph)(double tS);
+    uint32_t durationMs;
+};
+
+static const Cycle CYCLES[] = {
+    { "idle", idleLph, 10 * 60000 },
+    { "urban", urbanLph, 30 * 60000 },
+    { "highway", highwayLph, 30 * 60000 },
+};
+
+// =============================================================================
+// SYMULACJA ODPYTYWANIA
+// =============================================================================
+
+static uint32_t rng = 12345;
+static double uniform() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return (rng & 0xFFFFFF) / (double)0x1000000;
+}
+
+struct Options {
+    uint32_t periodMs = OBD_CONFIG::MAF_PERIOD_MS;
+    uint32_t latencyMs = 60;
+    uint32_t jitterMs = 80;
+    int noDataPct = 2;
+    uint32_t gapS = 0;
+    int runs = 10;
+};
+
+struct Result {
+    double trueL;
+    double legacyL;
+    double trapezL;
+    FuelAccumulator::Stats stats;
+};
+
+static Result simulate(const Cycle& cycle, const Options& o) {
+
+    Result r = {};
+    FuelAccumulator fuel(OBD_CONFIG::FUEL_GAP_MS, OBD_CONFIG::FUEL_MAX_GAP_MS);
+    double legacyUl = 0;
+    double lastLph = -1;
+    uint32_t lastOkMs = 0, lastIterMs = 0;
+    uint32_t firstOkMs = 0;
+    bool sampled = false;
+
+    uint32_t gapStart = cycle.durationMs / 2, gapEnd = gapStart + o.gapS * 1000;
+    uint32_t nextFuel = 0, nextOdo = 5000;
+    uint32_t t = 0;
+
+    while (t < cycle.durationMs) {
+
+        // Kolejne zapytanie: paliwo + prędkość lub odometr (który termin pierwszy)
+        bool odometer = nextOdo <= nextFuel;
+        uint32_t due = odometer ? nextOdo : nextFuel;
+        if (t < due) t = due;
+        if (t >= gapStart && t < gapEnd) t = gapEnd;          // Brak łącza
+        if (t >= cycle.durationMs) break;
+
+        uint32_t latency = o.latencyMs + (uint32_t)(uniform() * o.jitterMs) + (odometer ? 40 : 0);
+        double measured = cycle.lph((t + latency / 2.0) / 1000.0);
+        uint32_t arrived = t + latency;
+        bool ok = !odometer && uniform() * 100 >= o.noDataPct;
+
+        // Legacy: spalanie sprzed zapytania (o ile aktualne) x czas od poprzedniej iteracji
+        double before = lastLph >= 0 && t - lastOkMs <= (uint32_t)OBD_CONFIG::MAF_STALE_MS ? lastLph : -1;
+        if (lastIterMs && before >= 0) legacyUl += before * (arrived - lastIterMs) / 3.6;
+        lastIterMs = arrived;
+
+        if (!odometer) {
+            fuel.addSample(arrived, ok ? (float)measured : -1.0f);
+            if (ok) {
+                lastLph = measured;
+                lastOkMs = arrived;
+                if (!sampled) firstOkMs = arrived;
+                sampled = true;
+            }
+            nextFuel = t + o.periodMs;
+        } else {
+            nextOdo = t + 10000;
+        }
+        t = arrived;
+    }
+
+    // Zużycie prawdziwe w oknie próbek - krok 1 ms
+    for (uint32_t ms = firstOkMs; sampled && ms < lastOkMs; ms++) r.trueL += cycle.lph((ms + 0.5) / 1000.0) / 3600000.0;
+
+    r.legacyL = legacyUl / 1e6;
+    r.trapezL = fuel.totalUl() / 1e6;
+    r.stats = fuel.stats();
+    return r;
+}
+
+int main(int argc, char** argv) {
+
+    Options o;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (a == "--period" && hasValue) o.periodMs = (uint32_t)atoi(argv[++i]);
+        else if (a == "--latency" && hasValue) o.latencyMs = (uint32_t)atoi(argv[++i]);
+        else if (a == "--jitter" && hasValue) o.jitterMs = (uint32_t)atoi(argv[++i]);
+        else if (a == "--nodata" && hasValue) o.noDataPct = atoi(argv[++i]);
+        else if (a == "--gap" && hasValue) o.gapS = (uint32_t)atoi(argv[++i]);
+        else if (a == "--runs" && hasValue) o.runs = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [--period ms] [--latency ms] [--jitter ms] [--nodata %%] [--gap s] [--runs n]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    printf("[fuel] samples every %u ms, latency %u+%u ms, NO DATA %d%%, link gap %u s, %d runs each\n",
+           o.periodMs, o.latencyMs, o.jitterMs, o.noDataPct, o.gapS, o.runs);
+
+    int failures = 0;
+    for (const Cycle& cycle : CYCLES) {
+
+        double worstLegacy = 0, worstTrapez = 0, trueL = 0;
+        FuelAccumulator::Stats st = {};
+        for (int run = 0; run < o.runs; run++) {
+            Result r = simulate(cycle, o);
+            double legacyErr = 100.0 * (r.legacyL - r.trueL) / r.trueL;
+            double trapezErr = 100.0 * (r.trapezL - r.trueL) / r.trueL;
+            if (fabs(legacyErr) > fabs(worstLegacy)) worstLegacy = legacyErr;
+            if (fabs(trapezErr) > fabs(worstTrapez)) worstTrapez = trapezErr;
+            trueL = r.trueL;
+            st = r.stats;
+        }
+        printf("[fuel] %-7s %2u min, %.4f L: legacy worst %+.2f%%, trapezoid worst %+.3f%% "
+               "(%u samples, %u failed, %u bridged, %u dropped / %u ms)\n",
+               cycle.name, cycle.durationMs / 60000, trueL, worstLegacy, worstTrapez,
+               st.samples, st.failed, st.bridged, st.dropped, st.droppedMs);
+
+        if (o.gapS == 0 && fabs(worstTrapez) > 1.0) failures++;
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,681 @@
+/**
+ * @file fusion_replay.cpp
+ * @brief Narzędzie hosta - dokładność i koszt DistanceFusion na nagranych i syntetycznych przejazdach
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Tryb nagrania - link_capture.bin z karty SD (SDCARD::CAPTURE_MODE).
+ * Odpowiedzi ELM327 dekoduje ObdPid (prędkość 010D, także w zapytaniach
+ * łączonych) i VehicleProfile (odometr producenta), zdania NMEA - NmeaParser
+ * i GpsOdometer raz na epokę, jak w tasku GPS. Wypisywany jest dystans
+ * fuzji, samego OBD (DistanceEstimator) i samego GPS (GpsOdometer) oraz
+ * wyuczona skala prędkości OBD. Nagranie nie ma dystansu prawdziwego -
+ * porównanie dotyczy zgodności źródeł.
+ *
+ * Tryb syntetyczny (bez pliku) - przejazd z dystansem prawdziwym: jazda
+ * miejska z postojami i odcinki szybkie, prędkość OBD co 500 ms (obcięta
+ * do km/h, zawyżona o losową skalę 0-5%, 2% odczytów bez danych), odometr
+ * co 10 s, fixy GPS co 1 s (błądzenie pozycji, odbicia, wysoki HDOP,
+ * szum Dopplera), tunele, przerwy łącza OBD i okres bez obu źródeł.
+ * Porównywane są:
+ * - fuzja (DistanceFusion - rozliczenie w firmware),
+ * - samo OBD (DistanceEstimator),
+ * - sam GPS (GpsOdometer z Dopplerem),
+ * - poprzednie rozliczenie: OBD, a w przerwach łącza GPS z odliczeniem
+ *   przyrostu odometru po powrocie.
+ * Miarą jest błąd dystansu na końcu i największa różnica od prawdy w trakcie
+ * przejazdu (opóźnienie naliczania w przerwach). --runs n powtarza przejazd
+ * dla kolejnych ziaren i podaje najgorsze wyniki, --no-doppler usuwa prędkość
+ * z RMC (filtr korzysta wtedy z przyrostów pozycji).
+ *
+ * Koszt: wszystkie wejścia przejazdu są odtwarzane przez sam filtr
+ * wielokrotnie (ns na aktualizację) oraz pojedynczo z licznikiem cykli
+ * (x86: rdtsc) - średnia i p99 na rodzaj pomiaru. Filtr nie ma pętli
+ * zależnych od danych, więc p99 niewiele odbiega od średniej; na ESP32
+ * task OBD mierzy cykle tak samo (ESP.getCycleCount) i porównuje z budżetem
+ * OBD_CONFIG::FUSION_BUDGET_CYCLES.
+ *
+ * Kompilacja (z katalogu code/):
+ * ```
+ * g++ -std=c++17 -O2 -Iinclude tools/fusion_replay.cpp src/distance_fusion.cpp src/distance_estimator.cpp \
+ *     src/gps_odometer.cpp src/capture_replay.cpp src/trip_log_format.cpp src/obd_pid.cpp \
+ *     src/vehicle_profile.cpp src/nmea_parser.cpp -o fusion_replay
+ * ```
+ *
+ * Użycie:
+ * ```
+ * fusion_replay link_capture.bin [--profile vehicle.txt]
+ * fusion_replay [--minutes n] [--seed n] [--runs n] [--no-doppler]
+ * ```
+ * Kod wyjścia 1 (tryb syntetyczny) oznacza błąd fuzji ponad 1% lub dystans
+ * nabity na postojach.
+ */
+
+#include "distance_fusion.h"
+#include "distance_estimator.h"
+#include "gps_odometer.h"
+#include "capture_replay.h"
+#include "trip_log_format.h"
+#include "obd_pid.h"
+#include "vehicle_profile.h"
+#include "nmea_parser.h"
+#include "../cabulator_settings.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_RDTSC 1
+#endif
+
+using namespace TripLogFormat;
+
+static const double EARTH_R = 6371008.8;
+
+static uint32_t rng = 12345;
+static uint32_t random32() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+static double uniform() {
+    return (random32() >> 8) / 16777216.0;
+}
+
+static double gauss() {
+    double u = uniform() + 1e-12, v = uniform();
+    return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+// Konfiguracja jak w firmware (obd_reader.cpp, gps_reader.cpp)
+static DistanceFusion::Config fusionConfig() {
+
+    DistanceFusion::Config c;
+    c.accelSigma = OBD_CONFIG::FUSION_ACCEL_MMS2 / 1000.0f;
+    c.obdSpeedSigma = OBD_CONFIG::FUSION_OBD_SPEED_MMS / 1000.0f;
+    c.gpsSpeedSigma = OBD_CONFIG::FUSION_GPS_SPEED_MMS / 1000.0f;
+    c.gpsPositionSigma = OBD_CONFIG::FUSION_GPS_POSITION_MM / 1000.0f;
+    c.gpsWindowM = OBD_CONFIG::FUSION_GPS_WINDOW_M;
+    c.odoTickSigma = OBD_CONFIG::FUSION_ODO_TICK_MM / 1000.0f;
+    c.scaleSigma = OBD_CONFIG::FUSION_SCALE_SIGMA_PPM / 1e6f;
+    c.scaleDrift = OBD_CONFIG::FUSION_SCALE_DRIFT_PPM / 1e6f;
+    c.gateSigma = OBD_CONFIG::FUSION_GATE_SIGMA;
+    c.stationaryMmS = GPS::ODO_STATIONARY_MMS;
+    c.blindMs = OBD_CONFIG::FUSION_BLIND_MS;
+    c.gpsGapMs = GPS::ODO_DOPPLER_WINDOW_MS;
+    c.maxHdop = GPS::ODO_MAX_HDOP;
+    c.minSats = GPS::ODO_MIN_SATS;
+    return c;
+}
+
+static GpsOdometer::Config odometerConfig() {
+
+    GpsOdometer::Config c;
+    c.maxHdop = GPS::ODO_MAX_HDOP;
+    c.minSats = GPS::ODO_MIN_SATS;
+    c.stationaryMmS = GPS::ODO_STATIONARY_MMS;
+    c.driftMinMm = GPS::ODO_DRIFT_MIN_MM;
+    c.maxSpeedMmS = GPS::ODO_MAX_SPEED_MMS;
+    c.jumpMarginMmS = GPS::ODO_JUMP_MARGIN_MMS;
+    c.dopplerWindowMs = GPS::ODO_DOPPLER_WINDOW_MS;
+    c.maxOutliers = GPS::ODO_MAX_OUTLIERS;
+    return c;
+}
+
+// =============================================================================
+// WEJŚCIA PRZEJAZDU
+// =============================================================================
+
+enum InputType : uint8_t { IN_SPEED, IN_ODOMETER, IN_GPS, IN_LINK, IN_TRUTH, IN_TYPES };
+static const char* const INPUT_NAMES[IN_TYPES] = { "OBD speed", "odometer", "GPS epoch", "link", "truth" };
+
+struct Input {
+    uint32_t tMs;
+    InputType type;
+    int32_t value = 0;          // SPEED: km/h (-1 = NO DATA), ODOMETER: km, GPS: Doppler mm/s (-1), LINK: 1/0
+    uint32_t odometerMm = 0;    // GPS: GpsOdometer::distanceMm()
+    uint16_t hdop = 0;
+    uint8_t sats = 0;
+    bool valid = false;         // GPS: fix ważny, TRUTH: pojazd stoi
+    double trueM = 0;           // TRUTH: dystans prawdziwy
+    double trueKmh = 0;         // TRUTH: prędkość prawdziwa
+};
+
+struct Result {
+    double fusedM, obdM, gpsM, previousM;
+    double maxLagM[4];      // Największa różnica od prawdy w trakcie przejazdu: fuzja, OBD, GPS, poprzednie
+    double parkedM;         // Fuzja: dystans nabity na postojach
+    double speedRmseKmh;
+    float scale;
+    DistanceFusion::Stats stats;
+    DistanceEstimator::Stats obdStats;
+};
+
+// Wszystkie estymatory na tych samych wejściach (kolejność jak w firmware)
+static Result run(const std::vector<Input>& in) {
+
+    DistanceFusion fusion(fusionConfig());
+    DistanceEstimator obd;
+    uint32_t gpsFirst = 0, gpsLast = 0;
+    bool gpsSeen = false;
+
+    // Poprzednie rozliczenie: przyrost OBD, w przerwach łącza przyrost GPS z długiem
+    bool online = true;
+    double previousM = 0;
+    uint32_t obdLastMm = 0, debtMm = 0;
+
+    Result r = {};
+    double lastTrueM = 0, lastFusedM = 0, sqErr = 0;
+    uint32_t speedSamples = 0;
+
+    for (const Input& e : in) {
+        switch (e.type) {
+            case IN_SPEED:
+                fusion.addObdSpeed(e.tMs, e.value);
+                obd.addSpeed(e.tMs, e.value);
+                break;
+            case IN_ODOMETER:
+                fusion.addOdometer(e.tMs, e.value);
+                obd.addOdometer(e.tMs, e.value);
+                break;
+            case IN_GPS: {
+                fusion.addGps(e.tMs, e.valid, e.value, e.odometerMm, e.hdop, e.sats);
+                if (!gpsSeen) gpsFirst = gpsLast = e.odometerMm;
+                gpsSeen = true;
+                uint32_t step = e.odometerMm - gpsLast;
+                gpsLast = e.odometerMm;
+                if (!online) {
+                    previousM += step / 1000.0;
+                    debtMm += step;
+                }
+                break;
+            }
+            case IN_LINK:
+                online = e.value != 0;
+                break;
+            case IN_TRUTH: {
+                fusion.advance(e.tMs);
+                double fused = fusion.distanceMm() / 1000.0;
+                double now[4] = { fused, obd.distanceMm() / 1000.0, (gpsLast - gpsFirst) / 1000.0, previousM };
+                for (int m = 0; m < 4; m++) r.maxLagM[m] = std::max(r.maxLagM[m], fabs(now[m] - e.trueM));
+                if (e.valid) r.parkedM += (fused - lastFusedM) - (e.trueM - lastTrueM);
+                float kmh = fusion.speedKmh();
+                if (kmh >= 0) {
+                    sqErr += (kmh - e.trueKmh) * (kmh - e.trueKmh);
+                    speedSamples++;
+                }
+                lastTrueM = e.trueM;
+                lastFusedM = fused;
+                break;
+            }
+            default:
+                break;
+        }
+
+        // Przyrost OBD po odliczeniu długu z przerw
+        uint32_t d = obd.distanceMm() - obdLastMm;
+        obdLastMm = obd.distanceMm();
+        uint32_t repaid = std::min(d, debtMm);
+        debtMm -= repaid;
+        previousM += (d - repaid) / 1000.0;
+    }
+
+    r.fusedM = fusion.distanceMm() / 1000.0;
+    r.obdM = obd.distanceMm() / 1000.0;
+    r.gpsM = (gpsLast - gpsFirst) / 1000.0;
+    r.previousM = previousM;
+    r.speedRmseKmh = speedSamples ? sqrt(sqErr / speedSamples) : 0;
+    r.scale = fusion.obdScale();
+    r.stats = fusion.stats();
+    r.obdStats = obd.stats();
+    return r;
+}
+
+static void printFusionStats(const Result& r) {
+
+    const DistanceFusion::Stats& s = r.stats;
+    printf("[fus]   updates: %u OBD speed, %u Doppler, %u position, %u km ticks, %u rejected, %u blind\n",
+           s.obdSpeed, s.gpsSpeed, s.gpsPosition, s.odometerTicks, s.rejected, s.blind);
+    printf("[fus]   OBD speed scale %.4f, odometer correction last %+.1f m, max %.1f m\n",
+           r.scale, s.lastCorrectionMm / 1000.0, s.maxCorrectionMm / 1000.0);
+}
+
+// =============================================================================
+// KOSZT
+// =============================================================================
+
+static uint64_t hostNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Jedna aktualizacja filtru (wejścia porównawcze i prawda - advance jak co pętlę taska OBD)
+static inline void feed(DistanceFusion& f, const Input& e) {
+
+    switch (e.type) {
+        case IN_SPEED: f.addObdSpeed(e.tMs, e.value); break;
+        case IN_ODOMETER: f.addOdometer(e.tMs, e.value); break;
+        case IN_GPS: f.addGps(e.tMs, e.valid, e.value, e.odometerMm, e.hdop, e.sats); break;
+        case IN_TRUTH: f.advance(e.tMs); break;
+        default: break;
+    }
+}
+
+static void benchmark(const std::vector<Input>& in) {
+
+    // Przepustowość: cały przejazd wielokrotnie
+    size_t updates = 0;
+    for (const Input& e : in) updates += e.type != IN_LINK;
+    uint32_t repeats = (uint32_t)std::max<size_t>(1, 2000000 / std::max<size_t>(1, updates));
+
+    uint32_t sink = 0;
+    uint64_t t0 = hostNs();
+    for (uint32_t i = 0; i < repeats; i++) {
+        DistanceFusion f(fusionConfig());
+        for (const Input& e : in) feed(f, e);
+        sink += f.distanceMm();
+    }
+    double ns = (double)(hostNs() - t0) / ((double)updates * repeats);
+    printf("[fus] cost: %.1f ns per update (%zu updates x %u, sizeof(DistanceFusion) = %zu B)%s\n",
+           ns, updates, repeats, sizeof(DistanceFusion), sink == 1 ? " " : "");
+
+#ifdef HAVE_RDTSC
+    // Cykle pojedynczej aktualizacji per rodzaj pomiaru (TSC, z narzutem odczytu licznika)
+    std::vector<uint32_t> cycles[IN_TYPES];
+    DistanceFusion f(fusionConfig());
+    for (const Input& e : in) {
+        if (e.type == IN_LINK) continue;
+        uint64_t c0 = __rdtsc();
+        feed(f, e);
+        uint64_t c1 = __rdtsc();
+        cycles[e.type].push_back((uint32_t)(c1 - c0));
+    }
+    for (int t = 0; t < IN_TYPES; t++) {
+        std::vector<uint32_t>& c = cycles[t];
+        if (c.empty()) continue;
+        std::sort(c.begin(), c.end());
+        double mean = 0;
+        for (uint32_t x : c) mean += x;
+        mean /= c.size();
+        printf("[fus]   %-10s %8zu calls, TSC mean %6.0f, p50 %5u, p99 %5u\n", t == IN_TRUTH ? "advance" : INPUT_NAMES[t],
+               c.size(), mean, c[c.size() / 2], c[c.size() * 99 / 100]);
+    }
+#endif
+    printf("[fus] ESP32 budget: %d cycles per update (firmware logs [FUSION] max cycles)\n",
+           OBD_CONFIG::FUSION_BUDGET_CYCLES);
+}
+
+// =============================================================================
+// TRYB NAGRANIA
+// =============================================================================
+
+static VehicleProfile profile;
+
+// Komendy OBD z odpowiedziami i zdania NMEA -> wejścia filtru
+class CaptureDecoder {
+public:
+    std::vector<Input> inputs;
+
+    CaptureDecoder() : odometer(odometerConfig()) {}
+
+    void feed(uint64_t tUs, uint8_t channel, const uint8_t* data, size_t len) {
+
+        uint32_t tMs = (uint32_t)(tUs / 1000);
+        switch (channel) {
+            case CAPTURE_OBD_TX: obdTx(data, len); break;
+            case CAPTURE_OBD_RX: obdRx(tMs, data, len); break;
+            case CAPTURE_GPS_RX: gpsRx(tMs, data, len); break;
+            case CAPTURE_LOST:
+                pending = false;
+                response.clear();
+                break;
+        }
+    }
+
+private:
+    std::string txLine, command, response;
+    bool pending = false;
+    NmeaParser gps;
+    GpsOdometer odometer;
+    uint32_t epoch = UINT32_MAX;
+    bool positionValid = false;
+
+    void obdTx(const uint8_t* data, size_t len) {
+
+        for (size_t i = 0; i < len; i++) {
+            char c = (char)data[i];
+            if (c != '\r') {
+                if (c != ' ') txLine += (char)toupper((unsigned char)c);
+                continue;
+            }
+            command = txLine;
+            txLine.clear();
+            response.clear();
+            pending = true;
+        }
+    }
+
+    void obdRx(uint32_t tMs, const uint8_t* data, size_t len) {
+
+        if (!pending) return;
+        size_t n = 0;
+        while (n < len && data[n] != '>') n++;
+        response.append((const char*)data, n);
+        if (n < len) {
+            pending = false;
+            complete(tMs);
+        }
+    }
+
+    void complete(uint32_t tMs) {
+
+        for (char& c : response)
+            if (c == '\r') c = '\n';
+
+        if (profile.odometer.requestLen && command == profile.odometer.command) {
+            float km;
+            if (VehicleProfile::decode(profile.odometer, response.c_str(), km))
+                inputs.push_back(Input{ tMs, IN_ODOMETER, (int32_t)lroundf(km) });
+            return;
+        }
+        if (command.size() < 4 || command.size() % 2 || command.compare(0, 2, "01") != 0) return;
+
+        ObdPid::Value values[ObdPid::MAX_BATCH];
+        size_t count = 0;
+        for (size_t i = 2; i + 1 < command.size() && count < ObdPid::MAX_BATCH; i += 2)
+            values[count++].pid = (uint8_t)strtoul(command.substr(i, 2).c_str(), nullptr, 16);
+        ObdPid::parseResponse(response.c_str(), values, count);
+
+        for (size_t i = 0; i < count; i++) {
+            if (values[i].pid != ObdPid::PID_SPEED) continue;
+            int kmh = values[i].valid ? ObdPid::speedKmh(values[i]) : -1;
+            inputs.push_back(Input{ tMs, IN_SPEED, kmh });
+        }
+    }
+
+    // Jak GPS::updateFix: utrata fixu z RMC 'V' / GGA 0, odometr raz na epokę
+    void gpsRx(uint32_t tMs, const uint8_t* data, size_t len) {
+
+        for (size_t i = 0; i < len; i++) {
+
+            if (gps.encode((char)data[i]) == NmeaParser::NONE) continue;
+            const NmeaParser::Data& d = gps.data();
+            if (d.updated & NmeaParser::UPD_STATUS) positionValid = d.rmcValid;
+            if (d.updated & NmeaParser::UPD_QUALITY) positionValid = d.quality != 0;
+
+            if ((d.updated & NmeaParser::UPD_POSITION) && d.timeMs != epoch) {
+                epoch = d.timeMs;
+                int32_t speed = d.rmcValid ? (int32_t)d.speedMmS : -1;
+                odometer.addFix(tMs, positionValid, d.latE7, d.lngE7, speed, d.hdop, d.sats);
+                Input e = { tMs, IN_GPS, speed, odometer.distanceMm(), d.hdop, d.sats, positionValid };
+                inputs.push_back(e);
+            }
+            gps.clearUpdated();
+        }
+    }
+};
+
+static void onChunk(void* ctx, uint64_t tUs, uint8_t channel, const uint8_t* data, size_t len) {
+    static_cast<CaptureDecoder*>(ctx)->feed(tUs, channel, data, len);
+}
+
+static bool readFile(const char* path, std::vector<uint8_t>& out) {
+
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return false;
+    }
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+    fclose(f);
+    return true;
+}
+
+static int replayCapture(const char* path) {
+
+    std::vector<uint8_t> file;
+    if (!readFile(path, file)) return 2;
+
+    CaptureReplay player;
+    if (!player.load(file.data(), file.size())) {
+        fprintf(stderr, "%s: not a link capture file\n", path);
+        return 2;
+    }
+    CaptureDecoder d;
+    player.run(onChunk, &d);
+
+    // Odczyt wyjścia co sekundę, jak pętla taska OBD
+    std::vector<Input>& in = d.inputs;
+    if (in.empty()) {
+        fprintf(stderr, "%s: no speed, odometer or GPS data\n", path);
+        return 2;
+    }
+    uint32_t endMs = in.back().tMs;
+    for (uint32_t t = in.front().tMs; t <= endMs; t += 1000) in.push_back(Input{ t, IN_TRUTH });
+    std::stable_sort(in.begin(), in.end(), [](const Input& a, const Input& b) { return (int32_t)(a.tMs - b.tMs) < 0; });
+
+    uint32_t counts[IN_TYPES] = {};
+    for (const Input& e : in) counts[e.type]++;
+    printf("[fus] %s: %.1f min, %u speed samples, %u odometer reads, %u GPS epochs\n", path,
+           player.stats().durationUs / 6e7, counts[IN_SPEED], counts[IN_ODOMETER], counts[IN_GPS]);
+
+    Result r = run(in);
+    printf("[fus]   fused %10.1f m\n", r.fusedM);
+    printf("[fus]   OBD   %10.1f m (%+.2f%% vs fused, %u gaps)\n", r.obdM,
+           r.fusedM > 0 ? (r.obdM - r.fusedM) / r.fusedM * 100 : 0.0, r.obdStats.gaps);
+    printf("[fus]   GPS   %10.1f m (%+.2f%% vs fused)\n", r.gpsM,
+           r.fusedM > 0 ? (r.gpsM - r.fusedM) / r.fusedM * 100 : 0.0);
+    printFusionStats(r);
+    benchmark(in);
+    return 0;
+}
+
+// =============================================================================
+// TRYB SYNTETYCZNY
+// =============================================================================
+
+struct Synthetic {
+    std::vector<Input> inputs;
+    double trueM;
+    double scale;           // Zawyżenie prędkości OBD
+    double obdOutM;         // Dystans w przerwach łącza OBD
+    double gpsOutM;         // Dystans w tunelach
+    double blindM;          // Dystans bez obu źródeł
+};
+
+static Synthetic synthetic(uint32_t minutes, bool doppler) {
+
+    Synthetic s = {};
+    s.scale = 1.0 + 0.05 * uniform();
+    double odoStartM = 50000 + uniform() * 1e6;
+
+    GpsOdometer gpsOdo(odometerConfig());
+    double lat = 52.2297, lng = 21.0122, heading = 30, v = 0;
+    double walkN = 0, walkE = 0;
+    int outlierLeft = 0;
+    double outN = 0, outE = 0;
+    bool lastOnline = true;
+    uint32_t nextObdMs = 0, nextOdoMs = 0;
+
+    uint32_t seconds = minutes * 60;
+    for (uint32_t t = 0; t < seconds; t++) {
+
+        // Cykl 5 min: 4 min jazdy, 1 min postoju; co trzeci cykl szybki (~100 km/h)
+        uint32_t phase = t % 300;
+        bool parked = phase >= 240;
+        bool fast = (t / 300) % 3 == 2;
+        double target = parked ? 0 : fast ? 27 + 3 * sin(t / 41.0) : 8 + 6 * sin(t / 37.0) + (phase < 120 ? 4 : 0);
+
+        // Tunele co 10 min (40 s), przerwy łącza OBD co 15 min (90 s), co 30 min 30 s bez obu
+        bool blind = t % 1800 >= 1560 && t % 1800 < 1590;
+        bool tunnel = (!parked && t % 600 >= 100 && t % 600 < 140) || blind;
+        bool online = !(t % 900 >= 300 && t % 900 < 390) && !blind;
+        if (online != lastOnline) s.inputs.push_back(Input{ 1000 * t, IN_LINK, online ? 1 : 0 });
+        lastOnline = online;
+
+        for (int k = 0; k < 100; k++) {
+            uint32_t tMs = 1000 * t + 10 * k;
+            v += (target - v) * 0.002;
+            if (parked && v < 0.3) v = 0;
+            heading += parked ? 0 : 0.02 * sin(t / 23.0);
+            double d = v * 0.01;
+            lat += d * cos(heading * M_PI / 180) / EARTH_R * 180 / M_PI;
+            lng += d * sin(heading * M_PI / 180) / (EARTH_R * cos(lat * M_PI / 180)) * 180 / M_PI;
+            s.trueM += d;
+            if (!online) s.obdOutM += d;
+            if (tunnel) s.gpsOutM += d;
+            if (blind) s.blindM += d;
+
+            // OBD: prędkość co 500 ms (+ czas odpowiedzi), odometr co 10 s
+            if (online && tMs >= nextObdMs) {
+                int kmh = random32() % 50 == 0 ? -1 : (int)(v * 3.6 * s.scale);
+                s.inputs.push_back(Input{ tMs, IN_SPEED, kmh });
+                nextObdMs = tMs + 500 + random32() % 80;
+            }
+            if (online && tMs >= nextOdoMs) {
+                s.inputs.push_back(Input{ tMs, IN_ODOMETER, (int32_t)((odoStartM + s.trueM) / 1000) });
+                nextOdoMs = tMs + 10000;
+            }
+        }
+
+        Input truth = { 1000 * t + 999, IN_TRUTH, 0, 0, 0, 0, v == 0 };
+        truth.trueM = s.trueM;
+        truth.trueKmh = v * 3.6;
+
+        // GPS jak w gps_distance_replay: Gauss-Markow x HDOP, szum biały, odbicia 30-150 m
+        bool poor = t % 900 >= 400 && t % 900 < 430;
+        uint16_t hdop = poor ? (uint16_t)(350 + random32() % 300) : (uint16_t)(80 + random32() % 60);
+        uint8_t sats = poor ? (uint8_t)(4 + random32() % 2) : (uint8_t)(8 + random32() % 5);
+        double sigma = 1.5 * hdop / 100.0, a = exp(-1.0 / 30);
+        walkN = a * walkN + sqrt(1 - a * a) * sigma * gauss();
+        walkE = a * walkE + sqrt(1 - a * a) * sigma * gauss();
+        double errN = walkN + 0.5 * gauss(), errE = walkE + 0.5 * gauss();
+        if (outlierLeft == 0 && random32() % 240 == 0) {
+            outlierLeft = 1 + random32() % 3;
+            double mag = 30 + uniform() * 120, dir = uniform() * 2 * M_PI;
+            outN = mag * cos(dir);
+            outE = mag * sin(dir);
+        }
+        if (outlierLeft > 0) {
+            errN += outN;
+            errE += outE;
+            outlierLeft--;
+        }
+
+        uint32_t fixMs = 1000 * t + 120 + random32() % 40;
+        int32_t latE7 = (int32_t)llround((lat + errN / EARTH_R * 180 / M_PI) * 1e7);
+        int32_t lngE7 = (int32_t)llround((lng + errE / (EARTH_R * cos(lat * M_PI / 180)) * 180 / M_PI) * 1e7);
+        double measured = v == 0 ? fabs(0.05 * gauss()) : v + 0.1 * gauss();
+        int32_t speedMmS = (int32_t)llround((measured < 0 ? 0 : measured) * 1000);
+        gpsOdo.addFix(fixMs, !tunnel, latE7, lngE7, doppler ? speedMmS : -1, hdop, sats);
+        if (!tunnel) s.inputs.push_back(Input{ fixMs, IN_GPS, doppler ? speedMmS : -1, gpsOdo.distanceMm(), hdop, sats, true });
+
+        s.inputs.push_back(truth);
+    }
+
+    std::stable_sort(s.inputs.begin(), s.inputs.end(), [](const Input& a, const Input& b) { return a.tMs < b.tMs; });
+    return s;
+}
+
+static double pct(double m, double trueM) {
+    return (m - trueM) / trueM * 100;
+}
+
+static const char* const METHODS[4] = { "fused", "OBD only", "GPS only", "previous" };
+
+static int runSynthetic(uint32_t minutes, uint32_t runs, bool singleSeed, bool doppler) {
+
+    double worst[4] = {}, worstLag[4] = {}, worstParked = 0, worstRmse = 0;
+    bool ok = true;
+    Synthetic last;
+
+    for (uint32_t i = 0; i < runs; i++) {
+
+        if (!singleSeed) rng = (i + 1) * 2654435761u;     // Nieparzysty mnożnik - nigdy zero
+        Synthetic s = synthetic(minutes, doppler);
+        Result r = run(s.inputs);
+        double err[4] = { pct(r.fusedM, s.trueM), pct(r.obdM, s.trueM), pct(r.gpsM, s.trueM), pct(r.previousM, s.trueM) };
+        for (int m = 0; m < 4; m++) {
+            worst[m] = std::max(worst[m], fabs(err[m]));
+            worstLag[m] = std::max(worstLag[m], r.maxLagM[m]);
+        }
+        worstParked = std::max(worstParked, r.parkedM);
+        worstRmse = std::max(worstRmse, r.speedRmseKmh);
+        bool runOk = fabs(err[0]) < 1.0 && r.parkedM < 1.0 * minutes;
+        ok = ok && runOk;
+
+        if (runs == 1) {
+            printf("[fus] synthetic %u min: true %.1f m (OBD link out %.0f m, GPS out %.0f m, both out %.0f m), OBD scale %.4f\n",
+                   minutes, s.trueM, s.obdOutM, s.gpsOutM, s.blindM, s.scale);
+            for (int m = 0; m < 4; m++) {
+                double got[4] = { r.fusedM, r.obdM, r.gpsM, r.previousM };
+                printf("[fus]   %-9s %10.1f m  %+6.2f%%  max lag %6.1f m\n", METHODS[m], got[m], err[m], r.maxLagM[m]);
+            }
+            printf("[fus]   fused: parked %+.1f m, speed RMSE %.2f km/h; OBD only: %u gaps, max anchor correction %.1f m\n",
+                   r.parkedM, r.speedRmseKmh, r.obdStats.gaps, r.obdStats.maxCorrectionMm / 1000.0);
+            printFusionStats(r);
+        } else {
+            printf("[fus] run %2u: fused %+6.2f%%  OBD %+6.2f%%  GPS %+6.2f%%  previous %+6.2f%%  lag %5.1f / %5.1f m  scale %.4f/%.4f%s\n",
+                   i + 1, err[0], err[1], err[2], err[3], r.maxLagM[0], r.maxLagM[3], r.scale, s.scale, runOk ? "" : "  FAILED");
+        }
+        last = s;
+    }
+
+    if (runs > 1) {
+        printf("[fus] worst of %u runs (error, max lag):\n", runs);
+        for (int m = 0; m < 4; m++) printf("[fus]   %-9s %5.2f%%  %6.1f m\n", METHODS[m], worst[m], worstLag[m]);
+        printf("[fus]   fused: parked %+.1f m, speed RMSE %.2f km/h\n", worstParked, worstRmse);
+    }
+    benchmark(last.inputs);
+    printf("[fus] %s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+
+    const char* path = nullptr;
+    const char* profilePath = nullptr;
+    uint32_t minutes = 60, runs = 1;
+    bool singleSeed = false, doppler = true;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--minutes") && i + 1 < argc) minutes = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--runs") && i + 1 < argc) runs = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--profile") && i + 1 < argc) profilePath = argv[++i];
+        else if (!strcmp(argv[i], "--no-doppler")) doppler = false;
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            rng = (uint32_t)strtoul(argv[++i], nullptr, 0);
+            if (rng == 0) rng = 12345;          // xorshift nie wychodzi z zera
+            singleSeed = true;
+        }
+        else if (argv[i][0] != '-') path = argv[i];
+        else {
+            fprintf(stderr, "usage: fusion_replay [link_capture.bin] [--profile vehicle.txt] [--minutes n] [--seed n] [--runs n] [--no-doppler]\n");
+            return 2;
+        }
+    }
+
+    if (path) {
+        std::vector<uint8_t> text;
+        if (profilePath && !readFile(profilePath, text)) return 2;
+        text.push_back('\0');
+        char err[48];
+        if (!VehicleProfile::compile(profilePath ? (const char*)text.data() : VehicleProfile::BUILTIN, profile, err, sizeof(err))) {
+            fprintf(stderr, "profile error: %s\n", err);
+            return 2;
+        }
+        return replayCapture(path);
+    }
+    return runSynthetic(minutes ? minutes : 1, singleSeed ? 1 : (runs ? runs : 1), singleSeed, doppler);
+}
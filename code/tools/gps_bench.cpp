@@ -0,0 +1,301 @@
+/**
+ * @file gps_bench.cpp
+ * @brief Narzędzie hosta - konfiguracja modułu GPS, TTFF i częstotliwość fixów na emulatorze
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Uruchamia emulator odbiornika u-blox (gps_emulator.h) na zegarze
+ * wirtualnym i przechodzi przez to samo co firmware przy starcie: konfigurację
+ * GpsSetup (gps_setup.h) z ustawieniami z cabulator_settings.h, a potem
+ * odbiór zdań parserem NmeaParser. Scenariusze:
+ *
+ * - legacy   - dotychczasowy start: 9600 bd, 1 Hz, wszystkie zdania fabryczne
+ * - cold     - konfiguracja bez danych pomocniczych
+ * - warm     - ostatnia pozycja z poprzedniego startu i znany czas (restart ESP32)
+ * - warm-pos - sama pozycja (zasilanie odłączone, zegar nieznany)
+ * - far      - pozycja zapisana daleko od rzeczywistej (bez korzyści, bez szkody)
+ * - backup   - moduł z podtrzymaniem bateryjnym: już skonfigurowany, efemerydy zachowane
+ * - 10hz     - żądane 10 Hz na NEO-6M (NAK -> 5 Hz)
+ * - m8-10hz  - żądane 10 Hz na module M8
+ * - nmea     - odbiornik tylko NMEA (bez UBX) - zostaje 9600 bd i 1 Hz
+ *
+ * Dla każdego: wynik konfiguracji (prędkość, okres, ACK / NAK, czas), TTFF
+ * od włączenia zasilania, osiągnięta częstotliwość fixów (epoki z pozycją),
+ * zajętość łącza i bajty zgubione przez moduł.
+ *
+ * TTFF pochodzi z modelu emulatora (GpsEmulator::Config), nie z pomiaru -
+ * narzędzie sprawdza, że dane pomocnicze docierają do modułu i są
+ * poprawne (pozycja, czas GPS), a nie zysk konkretnego odbiornika.
+ *
+ * Kompilacja (z katalogu code/):
+ * ```
+ * g++ -std=c++17 -O2 -Iinclude tools/gps_bench.cpp src/gps_setup.cpp src/gps_emulator.cpp \
+ *     src/nmea_parser.cpp -o gps_bench
+ * ```
+ *
+ * Użycie:
+ * ```
+ * gps_bench [--seconds s] [--seed n] [-v]
+ * ```
+ * Kod wyjścia 1 oznacza konfigurację, częstotliwość lub TTFF niezgodne
+ * z oczekiwaniem scenariusza.
+ */
+
+#include "gps_setup.h"
+#include "gps_emulator.h"
+#include "nmea_parser.h"
+#include "../cabulator_settings.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// =============================================================================
+// ZEGAR WIRTUALNY I ŁĄCZE
+// =============================================================================
+
+static uint32_t clockMs = 0;
+static uint32_t hostBaud = GpsSetup::FACTORY_BAUD;
+static GpsEmulator* module = nullptr;
+static bool verbose = false;
+
+// Bajty odebrane przez "UART" ESP32, jeszcze nie przeczytane
+static uint8_t rxFifo[8192];
+static size_t rxHead = 0, rxCount = 0;
+
+static void tick() {
+
+    clockMs++;
+    uint8_t buf[256];
+    size_t n = module->transmit(clockMs, hostBaud, buf, sizeof(buf));
+    for (size_t i = 0; i < n && rxCount < sizeof(rxFifo); i++)
+        rxFifo[(rxHead + rxCount++) % sizeof(rxFifo)] = buf[i];
+}
+
+static uint32_t portNow() {
+    return clockMs;
+}
+
+static void portSetBaud(uint32_t baud) {
+    if (verbose) printf("[gps]   %7.3f s  baud %lu\n", clockMs / 1000.0, (unsigned long)baud);
+    hostBaud = baud;
+}
+
+// Nadanie trwa tyle, ile wynika z prędkości (moduł odbiera ramkę po jej końcu)
+static void portWrite(const uint8_t* data, size_t len) {
+
+    uint32_t ms = (uint32_t)((len * 10 * 1000 + hostBaud - 1) / hostBaud);
+    for (uint32_t i = 0; i < ms; i++) tick();
+    module->receive(clockMs, data, len, hostBaud);
+    if (verbose) printf("[gps]   %7.3f s  tx UBX %02X-%02X, %u B\n", clockMs / 1000.0, data[2], data[3], (unsigned)len);
+}
+
+static size_t portRead(uint8_t* buf, size_t len, uint32_t timeoutMs) {
+
+    uint32_t t0 = clockMs;
+    while (rxCount == 0 && clockMs - t0 < timeoutMs) tick();
+    size_t n = 0;
+    while (n < len && rxCount) {
+        buf[n++] = rxFifo[rxHead];
+        rxHead = (rxHead + 1) % sizeof(rxFifo);
+        rxCount--;
+    }
+    return n;
+}
+
+static const GpsSetup::Port port = { portSetBaud, portWrite, portRead, portNow };
+
+// =============================================================================
+// SCENARIUSZE
+// =============================================================================
+
+enum Start : uint8_t { POWER_ON, BACKUP };
+
+struct Scenario {
+    const char* name;
+    bool configure;
+    Start start;
+    bool ubx;                   // Model odbiornika
+    uint16_t minRateMs;
+    uint16_t rateMs;            // Żądany okres (0 = GPS::FIX_RATE_MS)
+    int aiding;                 // 0 = brak, 1 = pozycja z poprzedniego startu, 2 = daleko
+    bool timeKnown;
+    // Oczekiwania
+    uint32_t expectBaud;
+    uint16_t expectRateMs;
+    char ttff;                  // Model TTFF: 'c' cold, 'a' pozycja + czas, 'p' pozycja, 'h' hot
+};
+
+struct Outcome {
+    GpsSetup::Result setup;
+    uint32_t ttffMs;            // 0 = brak fixu
+    double fixHz;
+    double linkPct;
+    uint32_t dropped;
+    uint32_t checksumErrors;
+    int32_t lastLatE7, lastLngE7;
+    uint32_t lastUtc;
+};
+
+static Outcome run(const Scenario& sc, GpsEmulator& emu, const GpsEmulator::Config& base, uint32_t seconds,
+                   const GpsSetup::Aiding* aiding) {
+
+    clockMs = 0;
+    rxHead = rxCount = 0;
+    hostBaud = GpsSetup::FACTORY_BAUD;
+    if (sc.start == BACKUP) emu.backupStart(0);
+    else emu.powerOn(0);
+    module = &emu;
+    GpsEmulator::Stats before = emu.stats();
+
+    Outcome out = {};
+    out.setup.baud = GpsSetup::FACTORY_BAUD;
+    out.setup.rateMs = 1000;
+
+    if (sc.configure) {
+        GpsSetup::Options o = {};
+        o.baud = GPS::CONFIG_BAUD;
+        o.rateMs = sc.rateMs ? sc.rateMs : GPS::FIX_RATE_MS;
+        o.ackTimeoutMs = GPS::CONFIG_ACK_MS;
+        o.aiding = aiding;
+        o.posAccM = GPS::AIDING_POS_ACC_M;
+        o.utcNow = sc.timeKnown ? base.utc + clockMs / 1000 : 0;
+        o.timeAccMs = TIMEBASE::SYSTEM_ACC_MS;    // Czas z zegara systemowego (Timebase, SOURCE_SYSTEM)
+        GpsSetup::configure(port, o, out.setup);
+    }
+
+    // Odbiór jak task GPS: parser, epoki pozycji po czasie UTC (jak GpsOdometer)
+    NmeaParser parser;
+    uint32_t endMs = seconds * 1000;
+    uint32_t windowStart = endMs > 30000 ? endMs - 30000 : 0;
+    uint32_t lastEpoch = UINT32_MAX, epochs = 0;
+    uint64_t rxBytes = 0;
+    uint8_t buf[256];
+    while (clockMs < endMs) {
+
+        tick();
+        size_t n = portRead(buf, sizeof(buf), 0);
+        rxBytes += n;
+        parser.feed(buf, n);
+
+        const NmeaParser::Data& d = parser.data();
+        if (!(d.updated & NmeaParser::UPD_POSITION)) {
+            parser.clearUpdated();
+            continue;
+        }
+        parser.clearUpdated();
+        if (!d.rmcValid && d.quality == 0) continue;
+        if (!out.ttffMs) out.ttffMs = clockMs;
+        if (d.timeMs != lastEpoch) {
+            lastEpoch = d.timeMs;
+            if (clockMs >= windowStart) epochs++;
+        }
+        out.lastLatE7 = d.latE7;
+        out.lastLngE7 = d.lngE7;
+        if (d.day) out.lastUtc = GpsSetup::unixTime(d.year, d.month, d.day, d.timeMs);
+    }
+
+    uint32_t windowMs = endMs - (out.ttffMs > windowStart ? out.ttffMs : windowStart);
+    out.fixHz = out.ttffMs && windowMs ? epochs * 1000.0 / windowMs : 0.0;
+    out.linkPct = rxBytes * 10.0 * 100.0 / ((double)hostBaud * seconds);
+    GpsEmulator::Stats after = emu.stats();
+    out.dropped = after.droppedBytes - before.droppedBytes;
+    out.checksumErrors = parser.stats().checksumErrors;
+    return out;
+}
+
+// =============================================================================
+// MAIN
+// =============================================================================
+
+int main(int argc, char** argv) {
+
+    uint32_t seconds = 90;
+    uint32_t seed = 1;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) seed = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-v")) verbose = true;
+        else {
+            fprintf(stderr, "usage: gps_bench [--seconds s] [--seed n] [-v]\n");
+            return 2;
+        }
+    }
+    if (seconds < 45) seconds = 45;
+
+    GpsEmulator::Config base = GpsEmulator::defaultConfig();
+    base.seed = seed;
+
+    const uint16_t fiveHz = GpsSetup::minRateMs(GPS::CONFIG_BAUD) > GPS::FIX_RATE_MS
+                          ? GpsSetup::minRateMs(GPS::CONFIG_BAUD) : GPS::FIX_RATE_MS;
+    const Scenario scenarios[] = {
+        // name        cfg    start     ubx    min  rate aid time  baud                rate    ttff
+        { "legacy",    false, POWER_ON, true,  200, 0,   0,  false, 9600,              1000,   'c' },
+        { "cold",      true,  POWER_ON, true,  200, 0,   0,  false, GPS::CONFIG_BAUD,  fiveHz, 'c' },
+        { "warm",      true,  POWER_ON, true,  200, 0,   1,  true,  GPS::CONFIG_BAUD,  fiveHz, 'a' },
+        { "warm-pos",  true,  POWER_ON, true,  200, 0,   1,  false, GPS::CONFIG_BAUD,  fiveHz, 'p' },
+        { "far",       true,  POWER_ON, true,  200, 0,   2,  true,  GPS::CONFIG_BAUD,  fiveHz, 'c' },
+        { "backup",    true,  BACKUP,   true,  200, 0,   1,  true,  GPS::CONFIG_BAUD,  fiveHz, 'h' },
+        { "10hz",      true,  POWER_ON, true,  200, 100, 0,  false, GPS::CONFIG_BAUD,  200,    'c' },
+        { "m8-10hz",   true,  POWER_ON, true,  100, 100, 0,  false, GPS::CONFIG_BAUD,  100,    'c' },
+        { "nmea",      true,  POWER_ON, false, 200, 0,   0,  false, 9600,              1000,   'c' },
+    };
+
+    printf("[gps] %lu s per scenario, requested %d bd, %d ms; model TTFF cold %.1f s, aided %.1f s, position %.1f s, hot %.1f s\n",
+           (unsigned long)seconds, GPS::CONFIG_BAUD, GPS::FIX_RATE_MS, base.coldTtffMs / 1000.0,
+           base.aidedTtffMs / 1000.0, base.posTtffMs / 1000.0, base.hotTtffMs / 1000.0);
+
+    GpsSetup::Aiding saved = {};
+    int failures = 0;
+
+    for (const Scenario& sc : scenarios) {
+
+        // Pozycja zapisana przy poprzednim starcie (ostatni fix scenariusza cold)
+        GpsSetup::Aiding aid = saved;
+        if (sc.aiding == 2) aid.latE7 += 9000000;               // ~100 km na północ
+        const GpsSetup::Aiding* aiding = sc.aiding && saved.version ? &aid : nullptr;
+
+        GpsEmulator::Config ec = base;
+        ec.ubx = sc.ubx;
+        ec.minRateMs = sc.minRateMs;
+        GpsEmulator emu(ec);
+
+        // Moduł z podtrzymaniem: skonfigurowany przy poprzednim starcie
+        if (sc.start == BACKUP) {
+            Scenario previous = sc;
+            previous.start = POWER_ON;
+            run(previous, emu, base, 45, nullptr);
+        }
+        Outcome o = run(sc, emu, base, seconds, aiding);
+
+        // TTFF w granicach rozrzutu modelu, fix widoczny od najbliższej epoki
+        uint32_t modelMs = sc.ttff == 'a' ? base.aidedTtffMs : sc.ttff == 'p' ? base.posTtffMs
+                         : sc.ttff == 'h' ? base.hotTtffMs : base.coldTtffMs;
+        double ttffTol = modelMs * base.jitterPct / 100.0 + sc.expectRateMs + 100;
+
+        bool ok = o.setup.baud == sc.expectBaud && o.setup.rateMs == sc.expectRateMs && o.ttffMs > 0;
+        double expectHz = 1000.0 / sc.expectRateMs;
+        if (fabs(o.fixHz - expectHz) > expectHz * 0.05) ok = false;
+        if (o.checksumErrors || o.dropped) ok = false;
+        if (fabs((double)o.ttffMs - modelMs) > ttffTol) ok = false;
+
+        printf("[gps] %-9s %s %6lu bd %4u ms, setup %4lu ms (%u ack, %u nak)%s, TTFF %5.1f s, fixes %5.2f Hz, link %4.1f%%, dropped %lu B%s\n",
+               sc.name, o.setup.ubx ? "UBX " : "NMEA", (unsigned long)o.setup.baud, o.setup.rateMs,
+               (unsigned long)o.setup.durationMs, o.setup.acked, o.setup.nacked,
+               o.setup.aidedTime ? ", aid pos+time" : o.setup.aidedPosition ? ", aid pos     " : "              ",
+               o.ttffMs / 1000.0, o.fixHz, o.linkPct, (unsigned long)o.dropped, ok ? "" : "  <-- FAIL");
+        if (!ok) failures++;
+
+        if (!strcmp(sc.name, "cold")) {
+            saved.version = GpsSetup::AIDING_VERSION;
+            saved.latE7 = o.lastLatE7;
+            saved.lngE7 = o.lastLngE7;
+            saved.utc = o.lastUtc;
+        }
+    }
+
+    printf("[gps] %s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
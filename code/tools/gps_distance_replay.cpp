@@ -0,0 +1,372 @@
+/**
+ * @file gps_distance_replay.cpp
+ * @brief Narzędzie hosta - walidacja GpsOdometer na zapisanych lub syntetycznych trasach
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Tryb trasy - folder trasy z karty SD (gps_log.csv, opcjonalnie obd_log.csv;
+ * logi binarne najpierw przez trip_log_to_csv) albo sam plik gps_log.csv:
+ * ```
+ * Timestamp,Latitude,Longitude,Satellites,HDOP,Valid
+ * ```
+ * Wypisywany jest dystans GPS po filtrach, suma surowych odcinków (bez
+ * filtrów), liczniki filtrów i - z obd_log.csv - dystans OBD z ostatniego
+ * wpisu oraz rozbieżność. Log nie zawiera prędkości Dopplera, więc filtr
+ * postoju działa na samym promieniu szumu (jak w firmware bez RMC).
+ *
+ * Tryb syntetyczny (bez argumentu) - trasa z jazdą, zakrętami i postojami,
+ * fixy co 1 s z błądzeniem pozycji (proces Gaussa-Markowa, skala z HDOP),
+ * szumem białym, skokami wielodrogowymi, tunelem i okresami wysokiego
+ * HDOP. Porównywany jest dystans prawdziwy z dystansem GpsOdometer
+ * z prędkością Dopplera i bez niej oraz z sumą surowych odcinków; osobno
+ * dystans nabity na postojach. Sprawdzany jest też błąd segmentMm() wobec
+ * wzoru haversine. --emit zapisuje przebieg w formacie gps_log.csv.
+ *
+ * Kompilacja (z katalogu code/):
+ * ```
+ * g++ -std=c++17 -O2 -Iinclude tools/gps_distance_replay.cpp src/gps_odometer.cpp -o gps_distance_replay
+ * ```
+ *
+ * Użycie:
+ * ```
+ * gps_distance_replay [folder_trasy | gps_log.csv] [--minutes n] [--seed n] [--emit gps_log.csv]
+ * ```
+ * Kod wyjścia 1 (tryb syntetyczny) oznacza błąd dystansu lub dryf na postoju
+ * ponad progi.
+ */
+
+#include "gps_odometer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+static const double EARTH_R = 6371008.8;
+
+static uint32_t rng = 12345;
+static uint32_t random32() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+static double uniform() {
+    return (random32() >> 8) / 16777216.0;
+}
+
+static double gauss() {
+    double u = uniform() + 1e-12, v = uniform();
+    return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+static double haversineM(double lat1, double lng1, double lat2, double lng2) {
+
+    double p1 = lat1 * M_PI / 180, p2 = lat2 * M_PI / 180;
+    double dp = p2 - p1, dl = (lng2 - lng1) * M_PI / 180;
+    double a = sin(dp / 2) * sin(dp / 2) + cos(p1) * cos(p2) * sin(dl / 2) * sin(dl / 2);
+    return 2 * EARTH_R * asin(sqrt(a));
+}
+
+struct Fix {
+    uint32_t tMs;
+    bool valid;
+    int32_t latE7, lngE7;
+    int32_t speedMmS;       // < 0 = nieznana
+    uint16_t hdop;
+    uint8_t sats;
+    bool parked;            // Tryb syntetyczny: pojazd stoi
+};
+
+struct Run {
+    double filteredM;
+    double parkedM;         // Dystans doliczony na postojach
+    GpsOdometer::Stats stats;
+};
+
+static Run replay(const std::vector<Fix>& fixes, bool doppler) {
+
+    GpsOdometer odo;
+    Run r = {};
+    for (const Fix& f : fixes) {
+        uint32_t add = odo.addFix(f.tMs, f.valid, f.latE7, f.lngE7, doppler ? f.speedMmS : -1, f.hdop, f.sats);
+        if (f.parked) r.parkedM += add / 1000.0;
+    }
+    r.filteredM = odo.distanceMm() / 1000.0;
+    r.stats = odo.stats();
+    return r;
+}
+
+// Suma odcinków między wszystkimi ważnymi fixami - bez filtrów
+static double rawSumM(const std::vector<Fix>& fixes) {
+
+    double sum = 0;
+    const Fix* prev = nullptr;
+    for (const Fix& f : fixes) {
+        if (!f.valid) continue;
+        if (prev) sum += haversineM(prev->latE7 / 1e7, prev->lngE7 / 1e7, f.latE7 / 1e7, f.lngE7 / 1e7);
+        prev = &f;
+    }
+    return sum;
+}
+
+static void printStats(const char* name, const Run& r) {
+
+    const GpsOdometer::Stats& s = r.stats;
+    printf("[gps]   %-14s %10.1f m  (%u fixes: %u accepted, %u gated, %u stationary, %u outliers, %u reanchors)\n",
+           name, r.filteredM, s.fixes, s.accepted, s.gated, s.stationary, s.outliers, s.reanchors);
+}
+
+// =============================================================================
+// TRYB TRASY
+// =============================================================================
+
+static bool readGpsCsv(const std::string& path, std::vector<Fix>& out) {
+
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f) {
+        fprintf(stderr, "%s: cannot open\n", path.c_str());
+        return false;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        // Format: Timestamp,Latitude,Longitude,Satellites,HDOP,Valid
+        unsigned long ts;
+        double lat, lng;
+        unsigned sats, hdop;
+        int valid;
+        if (sscanf(line, "%lu,%lf,%lf,%u,%u,%d", &ts, &lat, &lng, &sats, &hdop, &valid) != 6) continue;
+        Fix x = {};
+        x.tMs = (uint32_t)ts;
+        x.valid = valid != 0;
+        x.latE7 = (int32_t)llround(lat * 1e7);
+        x.lngE7 = (int32_t)llround(lng * 1e7);
+        x.speedMmS = -1;
+        x.hdop = (uint16_t)(hdop > 65535 ? 65535 : hdop);
+        x.sats = (uint8_t)(sats > 255 ? 255 : sats);
+        out.push_back(x);
+    }
+    fclose(f);
+    return true;
+}
+
+// Dystans z ostatniego wpisu obd_log.csv [m], < 0 = brak
+static double readObdDistanceM(const std::string& path) {
+
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f) return -1;
+    char line[256];
+    double last = -1;
+    while (fgets(line, sizeof(line), f)) {
+        // Format: Timestamp,DistanceKm,FuelLiters,TotalCost
+        unsigned long ts;
+        double km;
+        if (sscanf(line, "%lu,%lf", &ts, &km) == 2) last = km * 1000;
+    }
+    fclose(f);
+    return last;
+}
+
+static int replayTrip(const char* arg) {
+
+    struct stat sb;
+    std::string gpsPath = arg, obdPath;
+    if (stat(arg, &sb) == 0 && S_ISDIR(sb.st_mode)) {
+        gpsPath = std::string(arg) + "/gps_log.csv";
+        obdPath = std::string(arg) + "/obd_log.csv";
+    }
+
+    std::vector<Fix> fixes;
+    if (!readGpsCsv(gpsPath, fixes)) return 2;
+    if (fixes.empty()) {
+        fprintf(stderr, "%s: no GPS records\n", gpsPath.c_str());
+        return 2;
+    }
+
+    Run r = replay(fixes, false);
+    double raw = rawSumM(fixes);
+    double minutes = (fixes.back().tMs - fixes.front().tMs) / 60000.0;
+    printf("[gps] %s: %zu fixes over %.1f min\n", gpsPath.c_str(), fixes.size(), minutes);
+    printStats("GpsOdometer", r);
+    printf("[gps]   %-14s %10.1f m\n", "raw segments", raw);
+
+    double obd = obdPath.empty() ? -1 : readObdDistanceM(obdPath);
+    if (obd >= 0) {
+        printf("[gps]   %-14s %10.1f m\n", "OBD (last)", obd);
+        if (obd > 0) printf("[gps] GPS vs OBD divergence: %+.2f%%\n", (r.filteredM - obd) / obd * 100);
+    }
+    return 0;
+}
+
+// =============================================================================
+// TRYB SYNTETYCZNY
+// =============================================================================
+
+struct Synthetic {
+    std::vector<Fix> fixes;
+    double trueM;
+};
+
+// Trasa: odcinki jazdy (prędkość docelowa, skręty) przeplatane postojami
+static Synthetic synthetic(uint32_t minutes) {
+
+    Synthetic s;
+    s.trueM = 0;
+
+    double lat = 52.2297, lng = 21.0122, heading = 30, v = 0;
+    double walkN = 0, walkE = 0;                // Błądzenie pozycji [m]
+    int outlierLeft = 0;
+    double outN = 0, outE = 0;
+
+    uint32_t seconds = minutes * 60;
+    for (uint32_t t = 0; t < seconds; t++) {
+
+        // Profil: 4 min jazdy, 1 min postoju; co 10 min 40 s tunelu w trakcie jazdy
+        uint32_t phase = t % 300;
+        bool parked = phase >= 240;
+        double target = parked ? 0 : 8 + 6 * sin(t / 37.0) + (phase < 120 ? 4 : 0);
+        double step = 10;                       // [ms]
+        for (int k = 0; k < 100; k++) {
+            v += (target - v) * 0.002;
+            if (parked && v < 0.3) v = 0;
+            heading += (parked ? 0 : 0.02 * sin(t / 23.0));
+            double d = v * step / 1000;
+            lat += d * cos(heading * M_PI / 180) / EARTH_R * 180 / M_PI;
+            lng += d * sin(heading * M_PI / 180) / (EARTH_R * cos(lat * M_PI / 180)) * 180 / M_PI;
+            s.trueM += d;
+        }
+        bool stopped = v == 0;
+
+        bool tunnel = !parked && t % 600 >= 100 && t % 600 < 140;
+        bool poor = t % 900 >= 400 && t % 900 < 430;       // Wysoki HDOP (zabudowa)
+        uint16_t hdop = poor ? (uint16_t)(350 + random32() % 300) : (uint16_t)(80 + random32() % 60);
+        uint8_t sats = poor ? (uint8_t)(4 + random32() % 2) : (uint8_t)(8 + random32() % 5);
+
+        // Błąd pozycji: Gauss-Markow (tau 30 s, sigma 1.5 m x HDOP) + szum biały 0.5 m
+        double sigma = 1.5 * hdop / 100.0, a = exp(-1.0 / 30);
+        walkN = a * walkN + sqrt(1 - a * a) * sigma * gauss();
+        walkE = a * walkE + sqrt(1 - a * a) * sigma * gauss();
+        double errN = walkN + 0.5 * gauss(), errE = walkE + 0.5 * gauss();
+
+        // Wielodrogowość: skok 30-150 m przez 1-3 fixy, ok. 1 na 4 minuty
+        if (outlierLeft == 0 && random32() % 240 == 0) {
+            outlierLeft = 1 + random32() % 3;
+            double mag = 30 + uniform() * 120, dir = uniform() * 2 * M_PI;
+            outN = mag * cos(dir);
+            outE = mag * sin(dir);
+        }
+        if (outlierLeft > 0) {
+            errN += outN;
+            errE += outE;
+            outlierLeft--;
+        }
+
+        Fix f = {};
+        f.tMs = 1000 * t + 120 + random32() % 40;         // Opóźnienie odbioru zdań
+        f.valid = !tunnel;
+        f.latE7 = (int32_t)llround((lat + errN / EARTH_R * 180 / M_PI) * 1e7);
+        f.lngE7 = (int32_t)llround((lng + errE / (EARTH_R * cos(lat * M_PI / 180)) * 180 / M_PI) * 1e7);
+        double doppler = stopped ? fabs(0.05 * gauss()) : v + 0.1 * gauss();
+        f.speedMmS = (int32_t)llround((doppler < 0 ? 0 : doppler) * 1000);
+        f.hdop = hdop;
+        f.sats = sats;
+        f.parked = stopped;
+        s.fixes.push_back(f);
+    }
+    return s;
+}
+
+// Największy błąd względny segmentMm wobec haversine na losowych odcinkach 1 m - 5 km
+static double segmentError() {
+
+    double worst = 0;
+    for (int i = 0; i < 100000; i++) {
+        double lat = (uniform() * 2 - 1) * 80, lng = (uniform() * 2 - 1) * 180;
+        double len = exp(log(1.0) + uniform() * log(5000.0)), dir = uniform() * 2 * M_PI;
+        double lat2 = lat + len * cos(dir) / EARTH_R * 180 / M_PI;
+        double lng2 = lng + len * sin(dir) / (EARTH_R * cos(lat * M_PI / 180)) * 180 / M_PI;
+        if (lng2 > 180) lng2 -= 360;
+        if (lng2 < -180) lng2 += 360;
+        int32_t a = (int32_t)llround(lat * 1e7), b = (int32_t)llround(lng * 1e7);
+        int32_t c = (int32_t)llround(lat2 * 1e7), d = (int32_t)llround(lng2 * 1e7);
+        double ref = haversineM(a / 1e7, b / 1e7, c / 1e7, d / 1e7);
+        double got = GpsOdometer::segmentMm(a, b, c, d) / 1000.0;
+        // Rozdzielczość 1e-7 stopnia i 1 mm - błąd bezwzględny do 2 cm pomijany
+        double err = fabs(got - ref) > 0.02 ? fabs(got - ref) / ref : 0;
+        if (err > worst) worst = err;
+    }
+    return worst;
+}
+
+static void emitCsv(const char* path, const std::vector<Fix>& fixes) {
+
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "%s: cannot open for writing\n", path);
+        return;
+    }
+    fprintf(f, "Timestamp,Latitude,Longitude,Satellites,HDOP,Valid\n");
+    for (const Fix& x : fixes)
+        fprintf(f, "%u,%.6f,%.6f,%u,%u,%d\n", x.tMs, x.latE7 / 1e7, x.lngE7 / 1e7,
+                (unsigned)x.sats, (unsigned)x.hdop, x.valid ? 1 : 0);
+    fclose(f);
+    printf("[gps] %zu fixes written to %s\n", fixes.size(), path);
+}
+
+static int runSynthetic(uint32_t minutes, const char* emitPath) {
+
+    double segErr = segmentError();
+    printf("[gps] segmentMm vs haversine (1 m - 5 km, |lat| < 80): max error %.4f%%\n", segErr * 100);
+
+    Synthetic s = synthetic(minutes);
+    Run withDoppler = replay(s.fixes, true);
+    Run noDoppler = replay(s.fixes, false);
+    double raw = rawSumM(s.fixes);
+
+    printf("[gps] synthetic %u min: true %.1f m\n", minutes, s.trueM);
+    printStats("Doppler", withDoppler);
+    printStats("position only", noDoppler);
+    printf("[gps]   %-14s %10.1f m\n", "raw segments", raw);
+
+    double errD = (withDoppler.filteredM - s.trueM) / s.trueM * 100;
+    double errP = (noDoppler.filteredM - s.trueM) / s.trueM * 100;
+    double errR = (raw - s.trueM) / s.trueM * 100;
+    printf("[gps] error: Doppler %+.2f%%, position only %+.2f%%, raw %+.2f%%\n", errD, errP, errR);
+    printf("[gps] added while parked: Doppler %.1f m, position only %.1f m\n", withDoppler.parkedM, noDoppler.parkedM);
+
+    if (emitPath) emitCsv(emitPath, s.fixes);
+
+    bool ok = segErr < 0.001 && fabs(errD) < 2.0 && fabs(errP) < 3.0
+           && withDoppler.parkedM < 1.0 * minutes && noDoppler.parkedM < 2.0 * minutes;
+    printf("[gps] %s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+
+    const char* path = nullptr;
+    const char* emitPath = nullptr;
+    uint32_t minutes = 60;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--minutes") && i + 1 < argc) minutes = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            rng = (uint32_t)strtoul(argv[++i], nullptr, 0);
+            if (rng == 0) rng = 12345;          // xorshift nie wychodzi z zera
+        }
+        else if (!strcmp(argv[i], "--emit") && i + 1 < argc) emitPath = argv[++i];
+        else if (argv[i][0] != '-') path = argv[i];
+        else {
+            fprintf(stderr, "usage: gps_distance_replay [trip_folder | gps_log.csv] [--minutes n] [--seed n] [--emit gps_log.csv]\n");
+            return 2;
+        }
+    }
+
+    if (path) return replayTrip(path);
+    return runSynthetic(minutes ? minutes : 1, emitPath);
+}
@@ -0,0 +1,512 @@
+/**
+ * @file logger_bench.cpp
+ * @brief Narzędzie hosta - rdzeń loggera tras (TripLogWriter) na systemie plików w pamięci
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Symulowana zmiana: fix GPS co 1 s (jazda, światła, postoje), aktualizacja
+ * OBD co 10 s, task zapisu co --drain-ms. Parametry loggera jak w firmware
+ * (SDCARD::LOG_*, TRACK_*), pliki w pamięci z osobno liczonymi bajtami
+ * zsynchronizowanymi (sync()/close()). Każdy scenariusz w trybie CSV
+ * i binarnym (SD_LOG_BINARY_FORMAT):
+ *
+ * - steady - cała trasa: jeden nagłówek na plik, liczba rekordów GPS = punkty
+ *   zachowane przez TrackSimplifier, każda aktualizacja OBD i podsumowanie
+ *   w pliku, zero odrzuceń, zapisy nie większe niż LOG_BATCH_BYTES, pliki
+ *   zsynchronizowane po zamknięciu,
+ * - full - task zapisu stoi (karta SD zajęta) do zapchania bufora: odrzucone
+ *   są tylko próbki ponad LOG_QUEUE_LEN - LOG_CONTROL_SLOTS, podsumowanie
+ *   i zamknięcie wchodzą do bufora i trafiają do plików,
+ * - powercut - utrata zasilania w losowych chwilach: pliki obcięte do bajtów
+ *   zsynchronizowanych muszą być prefiksem pełnego przebiegu, kończyć się na
+ *   granicy wiersza / bloku (bloki z poprawnym CRC), a utracone dane nie mogą
+ *   obejmować więcej niż LOG_SYNC_MS + odstęp OBD + --drain-ms; po wznowieniu
+ *   sesji w tym samym folderze plik ma nadal jeden nagłówek i czytelne bloki.
+ *
+ * Kompilacja (z katalogu code/):
+ * ```
+ * g++ -std=c++17 -O2 -Iinclude tools/logger_bench.cpp src/trip_log_writer.cpp src/trip_log_format.cpp \
+ *     src/track_simplifier.cpp -o logger_bench
+ * ```
+ *
+ * Użycie:
+ * ```
+ * logger_bench [--seed n] [--minutes n] [--drain-ms n] [--cuts n]
+ * ```
+ * Kod wyjścia 1 oznacza naruszenie któregoś z powyższych warunków.
+ */
+
+#include "trip_log_writer.h"
+#include "trip_log_format.h"
+#include "../cabulator_settings.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+typedef TripLogWriter::Record Record;
+
+static const char* TRIP_PATH = "/logs/trips/2025-01-20_12-00-00";
+static const uint32_t OBD_INTERVAL_MS = 10000;
+
+static uint32_t rng = 12345;
+static uint32_t random32() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+static double uniform() {
+    return (random32() >> 8) / 16777216.0;
+}
+
+// =============================================================================
+// SYSTEM PLIKÓW W PAMIĘCI
+// =============================================================================
+
+struct MemFile {
+    std::string data;
+    size_t synced = 0;          // Bajty, które przetrwają utratę zasilania
+};
+
+class MemStorage : public TripLogWriter::Storage {
+public:
+    std::map<std::string, MemFile> files;
+    MemFile* open_[TripLogWriter::STREAM_COUNT] = {};
+    uint32_t writes = 0;
+    size_t maxWrite = 0;
+
+    long open(TripLogWriter::Stream stream, const char* path) override {
+        open_[stream] = &files[path];
+        return (long)open_[stream]->data.size();
+    }
+
+    size_t write(TripLogWriter::Stream stream, const uint8_t* data, size_t len) override {
+        open_[stream]->data.append((const char*)data, len);
+        writes++;
+        if (len > maxWrite) maxWrite = len;
+        return len;
+    }
+
+    void sync(TripLogWriter::Stream stream) override {
+        open_[stream]->synced = open_[stream]->data.size();
+    }
+
+    void close(TripLogWriter::Stream stream) override {
+        sync(stream);
+        open_[stream] = nullptr;
+    }
+
+    bool anyOpen() const {
+        for (MemFile* f : open_) if (f) return true;
+        return false;
+    }
+
+    // Stan plików po utracie zasilania - tylko dane zsynchronizowane
+    MemStorage powerCut() const {
+        MemStorage s;
+        for (const auto& kv : files) {
+            MemFile f;
+            f.data = kv.second.data.substr(0, kv.second.synced);
+            f.synced = f.data.size();
+            s.files[kv.first] = f;
+        }
+        return s;
+    }
+
+    const std::string& file(const char* name) {
+        return files[std::string(TRIP_PATH) + name].data;
+    }
+};
+
+// =============================================================================
+// SYMULACJA
+// =============================================================================
+
+static TripLogWriter::Config writerConfig(bool binary) {
+
+    TripLogWriter::Config c;
+    c.queueLen = SDCARD::LOG_QUEUE_LEN;
+    c.controlSlots = SDCARD::LOG_CONTROL_SLOTS;
+    c.batchBytes = SDCARD::LOG_BATCH_BYTES;
+    c.syncMs = SDCARD::LOG_SYNC_MS;
+    c.binary = binary;
+    c.simplifyTrack = SDCARD::TRACK_SIMPLIFY;
+    c.track.toleranceMm = SDCARD::TRACK_TOLERANCE_MM;
+    c.track.maxGapMs = SDCARD::TRACK_MAX_GAP_MS;
+    return c;
+}
+
+// Fix GPS w chwili tMs: jazda miejska z postojami (deterministyczna dla ziarna)
+struct Route {
+    std::vector<Record> gps;
+    std::vector<Record> obd;
+};
+
+static Route makeRoute(uint32_t durationMs) {
+
+    Route r;
+    double lat = 52.2297, lng = 21.0122, heading = uniform() * 2 * M_PI, speed = 0;
+    double distanceKm = 0;
+    uint32_t stopUntil = 60000;
+
+    for (uint32_t t = 0; t < durationMs; t += 1000) {
+
+        if (t < stopUntil) speed = 0;
+        else {
+            speed += (uniform() - 0.45) * 2.0;
+            if (speed < 0) speed = 0;
+            if (speed > 16) speed = 16;
+            if (uniform() < 0.01) stopUntil = t + 20000 + (uint32_t)(uniform() * 60000);
+            if (uniform() < 0.03) heading += (uniform() - 0.5) * M_PI;
+        }
+        lat += speed * cos(heading) / 111320.0;
+        lng += speed * sin(heading) / (111320.0 * cos(lat * M_PI / 180));
+        distanceKm += speed / 1000.0;
+
+        Record g;
+        memset(&g, 0, sizeof(g));
+        g.type = TripLogWriter::REC_GPS;
+        g.timestamp = t;
+        g.utcMs = 1737374400000ULL + t;
+        g.timeSource = 4;
+        g.gps.latitude = lat + (uniform() - 0.5) * 4e-5;
+        g.gps.longitude = lng + (uniform() - 0.5) * 4e-5;
+        g.gps.satellites = 9;
+        g.gps.hdop = 90;
+        g.gps.valid = true;
+        g.gps.timestamp = t;
+        r.gps.push_back(g);
+
+        if (t % OBD_INTERVAL_MS == 0) {
+            Record o;
+            memset(&o, 0, sizeof(o));
+            o.type = TripLogWriter::REC_UPDATE;
+            o.timestamp = t;
+            o.utcMs = 1737374400000ULL + t;
+            o.timeSource = 4;
+            o.update.distanceKm = (float)distanceKm;
+            o.update.fuelUsedLiters = (float)(distanceKm * 0.07);
+            o.update.totalCost = (float)(8.0 + distanceKm * 3.2);
+            o.update.timestamp = t;
+            r.obd.push_back(o);
+        }
+    }
+    return r;
+}
+
+static Record control(TripLogWriter::RecordType type, uint32_t t) {
+
+    Record rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.type = type;
+    rec.timestamp = t;
+    rec.utcMs = 1737374400000ULL + t;
+    rec.timeSource = 4;
+    if (type == TripLogWriter::REC_OPEN) strcpy(rec.path, TRIP_PATH);
+    if (type == TripLogWriter::REC_SUMMARY) {
+        rec.summary.distanceKm = 12.5f;
+        rec.summary.totalCost = 48.0f;
+    }
+    return rec;
+}
+
+// Próbki trasy z [fromMs, toMs) do bufora, task zapisu co drainMs (poza przestojem)
+struct Counters {
+    uint32_t pushed = 0;
+    uint32_t rejected = 0;
+};
+
+static void replay(TripLogWriter& w, const Route& route, uint32_t fromMs, uint32_t toMs, uint32_t drainMs,
+                   uint32_t stallFromMs, uint32_t stallToMs, Counters& c) {
+
+    size_t gi = 0, oi = 0;
+    while (gi < route.gps.size() && route.gps[gi].timestamp < fromMs) gi++;
+    while (oi < route.obd.size() && route.obd[oi].timestamp < fromMs) oi++;
+
+    for (uint32_t t = fromMs; t < toMs; t += 100) {
+        while (gi < route.gps.size() && route.gps[gi].timestamp <= t) {
+            c.pushed++;
+            if (!w.push(route.gps[gi])) { w.noteDropped(); c.rejected++; }
+            gi++;
+        }
+        while (oi < route.obd.size() && route.obd[oi].timestamp <= t) {
+            c.pushed++;
+            if (!w.push(route.obd[oi])) { w.noteDropped(); c.rejected++; }
+            oi++;
+        }
+        bool stalled = t >= stallFromMs && t < stallToMs;
+        if (!stalled && t % drainMs == 0) w.drain(t);
+    }
+}
+
+// =============================================================================
+// ODCZYT PLIKÓW
+// =============================================================================
+
+static size_t countLines(const std::string& s) {
+    size_t n = 0;
+    for (char ch : s) n += ch == '\n';
+    return n;
+}
+
+static size_t countOccurrences(const std::string& s, const std::string& what) {
+    size_t n = 0;
+    for (size_t p = s.find(what); p != std::string::npos; p = s.find(what, p + 1)) n++;
+    return n;
+}
+
+// Rekordy pliku: CSV - wiersze bez nagłówka, binarny - próbki z bloków (-1 = uszkodzony)
+static long countRecords(const std::string& s, bool binary, uint32_t& lastTimestamp) {
+
+    lastTimestamp = 0;
+    if (!binary) {
+        if (s.empty()) return 0;
+        if (s.back() != '\n') return -1;
+        long n = -1;
+        size_t start = 0;
+        for (size_t p = s.find('\n'); p != std::string::npos; start = p + 1, p = s.find('\n', start)) {
+            if (n >= 0) lastTimestamp = (uint32_t)strtoul(s.c_str() + start, nullptr, 10);
+            n++;
+        }
+        return n;
+    }
+
+    if (s.empty()) return 0;
+    const uint8_t* d = (const uint8_t*)s.data();
+    TripLogFormat::StreamType type;
+    uint8_t version;
+    if (s.size() < TripLogFormat::FILE_HEADER_SIZE || !TripLogFormat::readFileHeader(d, type, version))
+        return -1;
+
+    long n = 0;
+    size_t pos = TripLogFormat::FILE_HEADER_SIZE;
+    while (pos < s.size()) {
+        TripLogFormat::BlockHeader hdr;
+        if (pos + TripLogFormat::BLOCK_HEADER_SIZE > s.size() || !TripLogFormat::readBlockHeader(d + pos, hdr)
+                || pos + TripLogFormat::BLOCK_HEADER_SIZE + hdr.length > s.size())
+            return -1;
+        TripLogFormat::BlockReader reader;
+        if (!reader.begin(hdr, d + pos + TripLogFormat::BLOCK_HEADER_SIZE, version)) return -1;
+        if (type == TripLogFormat::STREAM_GPS) {
+            TripLogFormat::GpsSample g;
+            while (reader.next(g)) { n++; lastTimestamp = g.timestampMs; }
+        } else {
+            TripLogFormat::ObdSample o;
+            while (reader.next(o)) { n++; lastTimestamp = o.timestampMs; }
+        }
+        pos += TripLogFormat::BLOCK_HEADER_SIZE + hdr.length;
+    }
+    return n;
+}
+
+static bool check(bool cond, const char* mode, const char* scenario, const char* what) {
+    if (!cond) printf("[logger]   %s %s: %s  <-- FAILED\n", mode, scenario, what);
+    return cond;
+}
+
+// =============================================================================
+// SCENARIUSZE
+// =============================================================================
+
+static bool steady(bool binary, const Route& route, uint32_t durationMs, uint32_t drainMs) {
+
+    const char* mode = binary ? "bin" : "csv";
+    const char* gpsName = binary ? "/gps_log.bin" : "/gps_log.csv";
+    const char* obdName = binary ? "/obd_log.bin" : "/obd_log.csv";
+    MemStorage fs;
+    std::unique_ptr<TripLogWriter> w(new TripLogWriter(writerConfig(binary), fs));
+    Counters c;
+
+    w->push(control(TripLogWriter::REC_OPEN, 0));
+    replay(*w, route, 0, durationMs, drainMs, 0, 0, c);
+    w->push(control(TripLogWriter::REC_SUMMARY, durationMs));
+    w->push(control(TripLogWriter::REC_CLOSE, durationMs));
+    w->drain(durationMs);
+
+    TripLogWriter::Stats st = w->stats();
+    uint32_t last;
+    long gps = countRecords(fs.file(gpsName), binary, last);
+    long obd = countRecords(fs.file(obdName), binary, last);
+    const std::string& summary = fs.file("/trip_summary.csv");
+    size_t total = 0;
+    bool synced = true;
+    for (const auto& kv : fs.files) {
+        total += kv.second.data.size();
+        synced = synced && kv.second.synced == kv.second.data.size();
+    }
+
+    printf("[logger] %s steady: %zu GPS -> %ld kept, %ld OBD, %u writes (avg %.0f B, max %zu B), "
+           "%.1f kB, %u records/write, max queue %u\n",
+           mode, route.gps.size(), gps, obd, fs.writes, (double)total / fs.writes, fs.maxWrite,
+           total / 1024.0, fs.writes ? (unsigned)(c.pushed / fs.writes) : 0, (unsigned)st.maxQueueDepth);
+
+    bool ok = true;
+    ok &= check(st.dropped == 0 && c.rejected == 0, mode, "steady", "records dropped");
+    ok &= check(gps >= 0 && (uint32_t)gps == st.gpsKept && st.gpsPoints == route.gps.size(), mode, "steady",
+                "GPS records in file != points kept by the simplifier");
+    ok &= check(obd >= 0 && (size_t)obd == route.obd.size(), mode, "steady", "OBD updates missing");
+    ok &= check(countLines(summary) == 2 && countOccurrences(summary, "Timestamp,") == 1, mode, "steady",
+                "trip_summary.csv should hold the header and one summary");
+    ok &= check(binary || countOccurrences(fs.file(gpsName), "Timestamp,") == 1, mode, "steady",
+                "gps_log.csv header count");
+    ok &= check(fs.maxWrite <= (size_t)SDCARD::LOG_BATCH_BYTES, mode, "steady", "write larger than batch");
+    ok &= check(!fs.anyOpen() && synced && !w->sessionOpen(), mode, "steady", "files left open or unsynced");
+    return ok;
+}
+
+static bool fullQueue(bool binary, const Route& route, uint32_t drainMs) {
+
+    const char* mode = binary ? "bin" : "csv";
+    const uint32_t stallMs = 600000;    // 10 min bez zapisu - dużo więcej niż bufor
+    MemStorage fs;
+    std::unique_ptr<TripLogWriter> w(new TripLogWriter(writerConfig(binary), fs));
+    Counters c;
+
+    // Sesja otwarta i zapisana, potem karta SD przestaje odpowiadać
+    w->push(control(TripLogWriter::REC_OPEN, 0));
+    w->drain(0);
+    replay(*w, route, 0, stallMs, drainMs, 0, stallMs, c);
+
+    // Finalizacja przy pełnym buforze próbek
+    bool summaryIn = w->push(control(TripLogWriter::REC_SUMMARY, stallMs));
+    bool closeIn = w->push(control(TripLogWriter::REC_CLOSE, stallMs));
+    bool openIn = w->push(control(TripLogWriter::REC_OPEN, stallMs));
+    TripLogWriter::Stats stalled = w->stats();
+
+    // Karta odpowiada - task zapisu opróżnia bufor
+    w->drain(stallMs);
+    w->push(control(TripLogWriter::REC_CLOSE, stallMs));
+    w->drain(stallMs + 1);
+
+    uint32_t expectedKept = SDCARD::LOG_QUEUE_LEN - SDCARD::LOG_CONTROL_SLOTS;
+    const std::string& summary = fs.file("/trip_summary.csv");
+    printf("[logger] %s full: %u samples during a %u s stall, %u queued, %u dropped, "
+           "summary %s, close %s, next open %s\n",
+           mode, c.pushed, stallMs / 1000, c.pushed - c.rejected, stalled.dropped,
+           summaryIn ? "queued" : "LOST", closeIn ? "queued" : "LOST", openIn ? "queued" : "LOST");
+
+    bool ok = true;
+    ok &= check(c.pushed - c.rejected == expectedKept && stalled.dropped == c.rejected, mode, "full",
+                "samples should fill exactly LOG_QUEUE_LEN - LOG_CONTROL_SLOTS");
+    ok &= check(summaryIn && closeIn && openIn, mode, "full", "session record rejected");
+    ok &= check(countLines(summary) == 2, mode, "full", "summary missing from trip_summary.csv");
+    ok &= check(!fs.anyOpen() && !w->sessionOpen(), mode, "full", "trip left open");
+    return ok;
+}
+
+static bool powerCut(bool binary, const Route& route, uint32_t durationMs, uint32_t drainMs, int cuts) {
+
+    const char* mode = binary ? "bin" : "csv";
+    const char* names[] = { binary ? "/gps_log.bin" : "/gps_log.csv", binary ? "/obd_log.bin" : "/obd_log.csv" };
+    bool ok = true;
+    uint32_t maxLostMs = 0;
+    const uint32_t allowedMs = SDCARD::LOG_SYNC_MS + OBD_INTERVAL_MS + drainMs;
+
+    // Pełny przebieg - odniesienie dla prefiksów
+    MemStorage ref;
+    {
+        std::unique_ptr<TripLogWriter> w(new TripLogWriter(writerConfig(binary), ref));
+        Counters c;
+        w->push(control(TripLogWriter::REC_OPEN, 0));
+        replay(*w, route, 0, durationMs, drainMs, 0, 0, c);
+    }
+
+    for (int i = 0; i < cuts; i++) {
+
+        uint32_t cutMs = 20000 + (uint32_t)(uniform() * (durationMs - 40000)) / 100 * 100;
+        MemStorage live;
+        std::unique_ptr<TripLogWriter> w(new TripLogWriter(writerConfig(binary), live));
+        Counters c;
+        w->push(control(TripLogWriter::REC_OPEN, 0));
+        replay(*w, route, 0, cutMs, drainMs, 0, 0, c);
+
+        MemStorage after = live.powerCut();
+        for (const char* name : names) {
+
+            const std::string& got = after.file(name);
+            const std::string& full = ref.file(name);
+            uint32_t last;
+            long n = countRecords(got, binary, last);
+            ok &= check(full.compare(0, got.size(), got) == 0, mode, "powercut", "file is not a prefix of the full run");
+            ok &= check(n >= 0, mode, "powercut", "torn line or block after power cut");
+
+            // Utracone dane OBD (co OBD_INTERVAL_MS) - ograniczone okresem synchronizacji
+            if (name == names[1]) {
+                uint32_t lost = n > 0 ? cutMs - last : cutMs;
+                if (lost > maxLostMs) maxLostMs = lost;
+                ok &= check(lost <= allowedMs, mode, "powercut", "more than one sync period of OBD data lost");
+            }
+        }
+
+        // Restart: wznowienie sesji w tym samym folderze i koniec trasy
+        std::unique_ptr<TripLogWriter> w2(new TripLogWriter(writerConfig(binary), after));
+        Counters c2;
+        w2->push(control(TripLogWriter::REC_OPEN, cutMs));
+        replay(*w2, route, cutMs, durationMs, drainMs, 0, 0, c2);
+        w2->push(control(TripLogWriter::REC_SUMMARY, durationMs));
+        w2->push(control(TripLogWriter::REC_CLOSE, durationMs));
+        w2->drain(durationMs);
+
+        for (const char* name : names) {
+            uint32_t last;
+            long n = countRecords(after.file(name), binary, last);
+            ok &= check(n > 0 && last + 1000 >= durationMs - OBD_INTERVAL_MS, mode, "powercut",
+                        "resumed file unreadable or incomplete");
+            ok &= check(binary || countOccurrences(after.file(name), "Timestamp,") == 1, mode, "powercut",
+                        "header repeated after resume");
+        }
+        ok &= check(countLines(after.file("/trip_summary.csv")) == 2, mode, "powercut", "summary missing after resume");
+    }
+
+    printf("[logger] %s powercut: %d cuts, max OBD data lost %.1f s (limit %.1f s), resume after each cut\n",
+           mode, cuts, maxLostMs / 1000.0, allowedMs / 1000.0);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+
+    uint32_t minutes = 120;
+    uint32_t drainMs = 200;
+    int cuts = 20;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            rng = (uint32_t)strtoul(argv[++i], nullptr, 0);
+            if (rng == 0) rng = 12345;          // xorshift nie wychodzi z zera
+        }
+        else if (!strcmp(argv[i], "--minutes") && i + 1 < argc) minutes = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--drain-ms") && i + 1 < argc) drainMs = (uint32_t)atoi(argv[++i]) / 100 * 100;
+        else if (!strcmp(argv[i], "--cuts") && i + 1 < argc) cuts = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: logger_bench [--seed n] [--minutes n] [--drain-ms n] [--cuts n]\n");
+            return 2;
+        }
+    }
+    if (minutes < 15) minutes = 15;
+    if (drainMs == 0) drainMs = 100;
+
+    uint32_t durationMs = minutes * 60000;
+    Route route = makeRoute(durationMs);
+    printf("[logger] %u min trip, %zu GPS fixes, %zu OBD updates, queue %d (%d reserved), batch %d B, "
+           "sync %d ms, drain every %u ms\n",
+           minutes, route.gps.size(), route.obd.size(), SDCARD::LOG_QUEUE_LEN, SDCARD::LOG_CONTROL_SLOTS,
+           SDCARD::LOG_BATCH_BYTES, SDCARD::LOG_SYNC_MS, drainMs);
+
+    bool ok = true;
+    for (bool binary : { false, true }) {
+        ok &= steady(binary, route, durationMs, drainMs);
+        ok &= fullQueue(binary, route, drainMs);
+        ok &= powerCut(binary, route, durationMs, drainMs, cuts);
+    }
+
+    printf("[logger] %s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,710 @@
+/**
+ * @file nmea_bench.cpp
+ * @brief Narzędzie hosta - poprawność, wydajność i fuzzing parsera NMEA
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Sprawdza NmeaParser (nmea_parser.h) na strumieniu NMEA:
+ * - wygenerowanym (domyślnie): trasa z RMC, GGA, GSA, GSV, VTG, GLL i TXT
+ *   co sekundę, z okresami utraty fixu (RMC 'V', GGA jakość 0),
+ * - z pliku z surowym zapisem NMEA,
+ * - z kanału GPS nagrania link_capture.bin (--capture, capture_replay.h).
+ *
+ * 1. ref   - każde zdanie porównane z parserem odniesienia (podział na pola,
+ *            strtod, liczby zmiennoprzecinkowe): przyjęcie / odrzucenie,
+ *            flagi zaktualizowanych pól i wartości (tolerancja 1 jednostki -
+ *            parser obcina cyfry ułamka, odniesienie zaokrągla)
+ * 2. chunk - wynik niezależny od podziału strumienia (całość, 1 B, 1-64 B)
+ * 3. bench - B/s, ns i cykle TSC (x86) na zdanie; z -DWITH_TINYGPS także
+ *            TinyGPSPlus na tym samym strumieniu
+ * 4. fuzz  - fragmenty strumienia z losowymi zmianami (zamiana bitu i bajtu,
+ *            usunięcie, wstawienie, ucięcie, powtórzenie, długie linie,
+ *            śmieci), połowa z przeliczoną sumą kontrolną - żeby błędne pola
+ *            docierały do walidacji; każde zdanie sprawdzane parserem
+ *            odniesienia, do tego zakresy wartości i historia linii
+ *
+ * Kompilacja (z katalogu code/):
+ * ```
+ * g++ -std=c++17 -O2 -Iinclude tools/nmea_bench.cpp src/nmea_parser.cpp \
+ *     src/capture_replay.cpp src/trip_log_format.cpp -o nmea_bench
+ * ```
+ * Fuzzing z sanitizerami: dodatkowo `-g -fsanitize=address,undefined`.
+ * Porównanie z TinyGPSPlus: dodatkowo `-DWITH_TINYGPS -I<TinyGPSPlus/src>
+ * <TinyGPSPlus/src>/TinyGPS++.cpp` oraz katalog z nagłówkiem Arduino.h
+ * (millis(), radians(), degrees(), sq(), TWO_PI) na ścieżce -I.
+ *
+ * Użycie:
+ * ```
+ * nmea_bench [plik.nmea | --capture link_capture.bin] [--seconds s] [--fuzz n] [--seed n]
+ * ```
+ * Kod wyjścia 1 oznacza niezgodność z parserem odniesienia, zależność od
+ * podziału strumienia lub naruszenie niezmienników w fuzzingu.
+ */
+
+#include "nmea_parser.h"
+#include "capture_replay.h"
+#include "trip_log_format.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+#ifdef WITH_TINYGPS
+#include <TinyGPS++.h>
+#endif
+
+static uint32_t rng = 12345;
+static uint32_t random32() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+// =============================================================================
+// STRUMIEŃ SYNTETYCZNY
+// =============================================================================
+
+static void appendSentence(std::string& out, const char* body) {
+
+    uint8_t sum = 0;
+    for (const char* p = body; *p; p++) sum ^= (uint8_t)*p;
+    char tail[8];
+    snprintf(tail, sizeof(tail), "*%02X\r\n", sum);
+    out += '$';
+    out += body;
+    out += tail;
+}
+
+// Kąt w formacie NMEA (d)ddmm.mmmmm
+static void angle(char* out, size_t len, double deg, int degDigits) {
+
+    long long m5 = llround(fabs(deg) * 60 * 100000);    // Minuty x 1e5
+    int d = (int)(m5 / 6000000);
+    long long rest = m5 % 6000000;
+    snprintf(out, len, "%0*d%02lld.%05lld", degDigits, d, rest / 100000, rest % 100000);
+}
+
+// Sekunda jazdy: ~600 B NMEA jak z typowego modułu przy 9600 bodów
+static std::string synthetic(uint32_t seconds) {
+
+    std::string out;
+    double lat = 52.2297, lng = 21.0122, course = 87.5, kmh = 0;
+    const char* talker[2] = { "GP", "GN" };
+    char body[128], la[24], lo[24];
+
+    for (uint32_t s = 0; s < seconds; s++) {
+
+        uint32_t t = 8 * 3600 + s;
+        unsigned hh = (t / 3600) % 24, mm = (t / 60) % 60, ss = t % 60;
+        unsigned day = 20 + t / 86400;
+        bool fix = s % 120 >= 5;                         // Co 2 minuty 5 s bez fixu
+        const char* tk = talker[s / 300 % 2];
+
+        // Ruch: przyspieszenie, jazda, hamowanie, skręty
+        double target = (s % 90 < 60) ? 50.0 + 20.0 * sin(s / 17.0) : 0.0;
+        kmh += (target - kmh) * 0.2;
+        if (kmh < 0.05) kmh = 0;
+        course = fmod(course + 3.0 * sin(s / 11.0) + 360.0, 360.0);
+        double step = kmh / 3.6 / 6371000.0 * 180.0 / M_PI;
+        lat += step * cos(course * M_PI / 180.0);
+        lng += step * sin(course * M_PI / 180.0) / cos(lat * M_PI / 180.0);
+        angle(la, sizeof(la), lat, 2);
+        angle(lo, sizeof(lo), lng, 3);
+        unsigned sats = 6 + s % 7;
+        double hdop = 0.7 + (s % 13) / 10.0;
+
+        if (fix) {
+            snprintf(body, sizeof(body), "%sRMC,%02u%02u%02u.00,A,%s,N,%s,E,%.3f,%.2f,%02u0125,,,A",
+                     tk, hh, mm, ss, la, lo, kmh / 1.852, course, day);
+            appendSentence(out, body);
+            snprintf(body, sizeof(body), "%sVTG,%.2f,T,,M,%.3f,N,%.3f,K,A", tk, course, kmh / 1.852, kmh);
+            appendSentence(out, body);
+            snprintf(body, sizeof(body), "%sGGA,%02u%02u%02u.00,%s,N,%s,E,1,%02u,%.2f,110.4,M,34.1,M,,",
+                     tk, hh, mm, ss, la, lo, sats, hdop);
+            appendSentence(out, body);
+            snprintf(body, sizeof(body), "%sGSA,A,3,02,05,07,09,13,16,20,26,29,,,,%.2f,%.2f,%.2f",
+                     tk, hdop + 0.4, hdop, hdop + 0.2);
+            appendSentence(out, body);
+        } else {
+            snprintf(body, sizeof(body), "%sRMC,%02u%02u%02u.00,V,,,,,,,%02u0125,,,N", tk, hh, mm, ss, day);
+            appendSentence(out, body);
+            snprintf(body, sizeof(body), "%sVTG,,,,,,,,,N", tk);
+            appendSentence(out, body);
+            snprintf(body, sizeof(body), "%sGGA,%02u%02u%02u.00,,,,,0,00,99.99,,,,,,", tk, hh, mm, ss);
+            appendSentence(out, body);
+            snprintf(body, sizeof(body), "%sGSA,A,1,,,,,,,,,,,,,99.99,99.99,99.99", tk);
+            appendSentence(out, body);
+        }
+        for (int g = 0; g < 3; g++) {
+            snprintf(body, sizeof(body), "GPGSV,3,%d,11,%02d,45,120,38,%02d,30,200,35,%02d,60,310,40,%02d,10,045,22",
+                     g + 1, 2 + g * 4, 5 + g * 4, 7 + g * 4, 9 + g * 4);
+            appendSentence(out, body);
+        }
+        snprintf(body, sizeof(body), "%sGLL,%s,N,%s,E,%02u%02u%02u.00,%c,A", tk, la, lo, hh, mm, ss, fix ? 'A' : 'V');
+        appendSentence(out, body);
+        if (s % 60 == 0) appendSentence(out, "GPTXT,01,01,02,ANTSTATUS=OK");
+    }
+    return out;
+}
+
+// =============================================================================
+// PARSER ODNIESIENIA (podział na pola, strtod)
+// =============================================================================
+
+struct RefField {
+    bool empty, number, dot;
+    char letter;
+    size_t intDigits;
+    double value;
+};
+
+// Składnia pola jak w firmware: pojedyncza litera albo cyfry[.cyfry], do 9 cyfr części całkowitej
+static bool refField(const std::string& f, RefField& r) {
+
+    r = RefField{ f.empty(), false, false, '\0', 0, 0.0 };
+    if (f.empty()) return true;
+    if (f.size() == 1 && isalpha((unsigned char)f[0])) {
+        r.letter = f[0];
+        return true;
+    }
+    size_t dot = f.find('.');
+    r.dot = dot != std::string::npos;
+    r.intDigits = r.dot ? dot : f.size();
+    for (size_t i = 0; i < f.size(); i++)
+        if (i != dot && !isdigit((unsigned char)f[i])) return false;
+    if (r.intDigits > 9) return false;
+    r.number = true;
+    r.value = strtod(f.c_str(), nullptr);           // "." -> 0
+    return true;
+}
+
+// Przyjęte zdanie: typ, flagi i wartości jak NmeaParser::Data
+struct RefResult {
+    NmeaParser::Sentence type;
+    uint16_t updated;
+    NmeaParser::Data data;
+};
+
+// s: od '$' do drugiej cyfry sumy włącznie
+static bool refParse(const std::string& s, RefResult& out) {
+
+    out = RefResult{ NmeaParser::NONE, 0, NmeaParser::Data() };
+
+    size_t star = s.find('*');
+    if (s.size() < 4 || s[0] != '$' || star == std::string::npos || star + 3 != s.size()) return false;
+    uint8_t sum = 0;
+    for (size_t i = 1; i < star; i++) sum ^= (uint8_t)s[i];
+    if (!isxdigit((unsigned char)s[star + 1]) || !isxdigit((unsigned char)s[star + 2])) return false;
+    if (sum != (uint8_t)strtoul(s.substr(star + 1, 2).c_str(), nullptr, 16)) return false;
+
+    std::vector<std::string> f;
+    size_t pos = 1;
+    while (true) {
+        size_t comma = s.find(',', pos);
+        if (comma == std::string::npos || comma > star) {
+            f.push_back(s.substr(pos, star - pos));
+            break;
+        }
+        f.push_back(s.substr(pos, comma - pos));
+        pos = comma + 1;
+    }
+    if (f.size() < 2 || f[0].size() != 5 || f[0][0] == 'P') return false;
+
+    std::string type = f[0].substr(2);
+    // Indeksy pól: time, status, lat, ns, lng, ew, speed, course, date, quality, sats, hdop, fixType
+    int idx[13];
+    for (int& i : idx) i = -1;
+    if (type == "RMC") {
+        out.type = NmeaParser::RMC;
+        int m[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, -1, -1, -1, -1 };
+        memcpy(idx, m, sizeof(idx));
+    } else if (type == "GGA") {
+        out.type = NmeaParser::GGA;
+        int m[] = { 1, -1, 2, 3, 4, 5, -1, -1, -1, 6, 7, 8, -1 };
+        memcpy(idx, m, sizeof(idx));
+    } else if (type == "GSA") {
+        out.type = NmeaParser::GSA;
+        int m[] = { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 16, 2 };
+        memcpy(idx, m, sizeof(idx));
+    } else {
+        return false;
+    }
+
+    RefField r[13];
+    for (int k = 0; k < 13; k++) {
+        if (idx[k] < 0 || idx[k] >= (int)f.size()) {
+            r[k] = RefField{ true, false, false, '\0', 0, 0.0 };
+            continue;
+        }
+        if (!refField(f[idx[k]], r[k])) return false;
+    }
+
+    NmeaParser::Data& d = out.data;
+    uint16_t& u = out.updated;
+    const RefField &time = r[0], &status = r[1], &lat = r[2], &ns = r[3], &lng = r[4], &ew = r[5],
+                   &speed = r[6], &course = r[7], &date = r[8], &quality = r[9], &sats = r[10],
+                   &hdop = r[11], &fixType = r[12];
+
+    if (!time.empty) {
+        if (!time.number || time.intDigits != 6) return false;
+        long hms = (long)floor(time.value);
+        long hh = hms / 10000, mm = hms / 100 % 100, ss = hms % 100;
+        if (hh > 23 || mm > 59 || ss > 60) return false;
+        d.timeMs = (uint32_t)(((hh * 60 + mm) * 60 + ss) * 1000 + (long)floor((time.value - hms) * 1000 + 1e-6));
+        u |= NmeaParser::UPD_TIME;
+    }
+    if (!status.empty) {
+        if (status.letter != 'A' && status.letter != 'V') return false;
+        d.rmcValid = status.letter == 'A';
+        u |= NmeaParser::UPD_STATUS;
+    }
+    long long e7[2] = { 0, 0 };
+    const RefField* ang[2] = { &lat, &lng };
+    for (int k = 0; k < 2; k++) {
+        const RefField& a = *ang[k];
+        if (a.empty) continue;
+        double maxDeg = k == 0 ? 90 : 180;
+        if (!a.number || a.intDigits < 3) return false;
+        double deg = floor(a.value / 100), min = a.value - deg * 100;
+        if (deg > maxDeg || min >= 60) return false;
+        e7[k] = llround((deg + min / 60) * 1e7);
+        if (e7[k] > maxDeg * 1e7 + 1) return false;
+    }
+    if (!ns.empty && ns.letter != 'N' && ns.letter != 'S') return false;
+    if (!ew.empty && ew.letter != 'E' && ew.letter != 'W') return false;
+    if (!speed.empty) {
+        if (!speed.number || speed.value >= 100000) return false;
+        d.speedMmS = (uint32_t)llround(speed.value * 1852.0 / 3.6);
+        u |= NmeaParser::UPD_SPEED;
+    }
+    if (!course.empty) {
+        if (!course.number || course.value >= 361) return false;
+        d.courseCdeg = (uint16_t)(llround(course.value * 100) % 36000);
+        u |= NmeaParser::UPD_COURSE;
+    }
+    if (!date.empty) {
+        if (!date.number || date.dot || date.intDigits != 6) return false;
+        long v = (long)date.value, dd = v / 10000, mo = v / 100 % 100;
+        if (dd < 1 || dd > 31 || mo < 1 || mo > 12) return false;
+        d.day = (uint8_t)dd;
+        d.month = (uint8_t)mo;
+        d.year = (uint16_t)(2000 + v % 100);
+        u |= NmeaParser::UPD_DATE;
+    }
+    if (!quality.empty) {
+        if (!quality.number || quality.dot || quality.value > 9) return false;
+        d.quality = (uint8_t)quality.value;
+        u |= NmeaParser::UPD_QUALITY;
+    }
+    if (!sats.empty) {
+        if (!sats.number || sats.dot || sats.value > 99) return false;
+        d.sats = (uint8_t)sats.value;
+        u |= NmeaParser::UPD_SATS;
+    }
+    if (!hdop.empty) {
+        if (!hdop.number) return false;
+        d.hdop = hdop.value >= 655 ? 65535 : (uint16_t)llround(hdop.value * 100);
+        u |= NmeaParser::UPD_HDOP;
+    }
+    if (!fixType.empty) {
+        if (!fixType.number || fixType.dot || fixType.value < 1 || fixType.value > 3) return false;
+        d.fixType = (uint8_t)fixType.value;
+        u |= NmeaParser::UPD_FIX_TYPE;
+    }
+
+    bool fix = out.type == NmeaParser::RMC ? (u & NmeaParser::UPD_STATUS) && d.rmcValid
+             : out.type == NmeaParser::GGA ? (u & NmeaParser::UPD_QUALITY) && d.quality > 0
+             : false;
+    if (fix && !lat.empty && !lng.empty && !ns.empty && !ew.empty) {
+        d.latE7 = (int32_t)(ns.letter == 'S' ? -e7[0] : e7[0]);
+        d.lngE7 = (int32_t)(ew.letter == 'W' ? -e7[1] : e7[1]);
+        u |= NmeaParser::UPD_POSITION;
+    }
+    return true;
+}
+
+static bool near(long long a, long long b, long long tol) {
+    return llabs(a - b) <= tol;
+}
+
+// Wartości zaktualizowane przez zdanie zgodne z odniesieniem
+static bool sameValues(const NmeaParser::Data& p, const RefResult& r) {
+
+    const NmeaParser::Data& d = r.data;
+    uint16_t u = r.updated;
+    if ((p.updated & u) != u || p.updated != u) return false;
+    if ((u & NmeaParser::UPD_POSITION) && (!near(p.latE7, d.latE7, 1) || !near(p.lngE7, d.lngE7, 1))) return false;
+    if ((u & NmeaParser::UPD_SPEED) && !near(p.speedMmS, d.speedMmS, 1)) return false;
+    if ((u & NmeaParser::UPD_COURSE) && !near(p.courseCdeg, d.courseCdeg, 1)
+        && !near((p.courseCdeg + 1) % 36000, d.courseCdeg, 1)) return false;
+    if ((u & NmeaParser::UPD_TIME) && !near(p.timeMs, d.timeMs, 1)) return false;
+    if ((u & NmeaParser::UPD_DATE) && (p.day != d.day || p.month != d.month || p.year != d.year)) return false;
+    if ((u & NmeaParser::UPD_SATS) && p.sats != d.sats) return false;
+    if ((u & NmeaParser::UPD_HDOP) && !near(p.hdop, d.hdop, 1)) return false;
+    if ((u & NmeaParser::UPD_STATUS) && p.rmcValid != d.rmcValid) return false;
+    if ((u & NmeaParser::UPD_QUALITY) && p.quality != d.quality) return false;
+    if ((u & NmeaParser::UPD_FIX_TYPE) && p.fixType != d.fixType) return false;
+    return true;
+}
+
+// Zakresy wartości zatwierdzonych - niezależnie od wejścia
+static bool inRange(const NmeaParser::Data& d) {
+
+    return d.latE7 >= -900000000 && d.latE7 <= 900000000
+        && d.lngE7 >= -1800000000 && d.lngE7 <= 1800000000
+        && d.courseCdeg < 36000 && d.timeMs < 86401000
+        && d.day <= 31 && d.month <= 12 && (d.year == 0 || (d.year >= 2000 && d.year <= 2099))
+        && d.sats <= 99 && d.quality <= 9 && d.fixType <= 3;
+}
+
+// =============================================================================
+// PORÓWNANIE Z ODNIESIENIEM
+// =============================================================================
+
+struct Check {
+    uint32_t compared = 0;          // Zdania z sumą ocenione przez oba parsery
+    uint32_t accepted = 0;
+    uint32_t mismatches = 0;
+    uint32_t rangeErrors = 0;
+    uint32_t historyErrors = 0;
+    std::string firstMismatch;
+};
+
+// Strumień podawany znak po znaku; w chwili gdy zdanie się kończy (druga cyfra sumy)
+// decyzja parsera musi być taka jak odniesienia
+static void checkStream(const std::string& in, NmeaParser& p, Check& c) {
+
+    std::string cur;
+    bool active = false;
+
+    for (size_t i = 0; i < in.size(); i++) {
+
+        char ch = in[i];
+        NmeaParser::Sentence got = p.encode(ch);
+
+        // Ramka zdania jak w parserze: '$' od nowa, koniec linii przerywa
+        bool evaluate = false;
+        if (ch == '$') {
+            cur = "$";
+            active = true;
+        } else if (ch == '\r' || ch == '\n') {
+            active = false;
+        } else if (active) {
+            cur += ch;
+            size_t star = cur.find('*');
+            if (cur.size() - 1 > NmeaParser::MAX_SENTENCE) active = false;
+            else if (star != std::string::npos && star < cur.find(',')) active = false;     // '*' w adresie
+            else if (star != std::string::npos && cur.size() > star + 1) {
+                if (!isxdigit((unsigned char)ch)) active = false;
+                else if (cur.size() == star + 3) {
+                    evaluate = true;
+                    active = false;
+                }
+            }
+        }
+
+        RefResult ref;
+        bool refOk = evaluate && refParse(cur, ref);
+        if (evaluate) c.compared++;
+
+        bool match = refOk ? (got == ref.type && sameValues(p.data(), ref)) : got == NmeaParser::NONE;
+        if (got != NmeaParser::NONE) c.accepted++;
+        if (!match) {
+            if (c.mismatches++ == 0) c.firstMismatch = cur;
+        }
+        p.clearUpdated();
+
+        if (!inRange(p.data())) c.rangeErrors++;
+    }
+
+    // Historia: linie zakończone zerem, nie dłuższe niż bufor (bajty 0 z wejścia są zachowane)
+    char line[40];
+    for (size_t age = 0; age < NmeaParser::HISTORY_LINES + 1; age++) {
+        size_t outLen = 1 + random32() % sizeof(line);
+        size_t n = p.rawLine(age, line, outLen);
+        if (n >= outLen || line[n] != '\0') c.historyErrors++;
+    }
+}
+
+static bool report(const char* name, const Check& c) {
+
+    bool ok = c.mismatches == 0 && c.rangeErrors == 0 && c.historyErrors == 0;
+    printf("[nmea] %s: %u sentences compared, %u accepted, %u mismatches, %u range errors, %u history errors: %s\n",
+           name, c.compared, c.accepted, c.mismatches, c.rangeErrors, c.historyErrors, ok ? "OK" : "FAILED");
+    if (c.mismatches) printf("[nmea]   first mismatch: %s\n", c.firstMismatch.c_str());
+    return ok;
+}
+
+// =============================================================================
+// PODZIAŁ STRUMIENIA I WYDAJNOŚĆ
+// =============================================================================
+
+// Ostatnie Data i liczniki zależą tylko od treści strumienia
+static bool sameChunking(const std::string& in) {
+
+    NmeaParser a, b, r;
+    a.feed((const uint8_t*)in.data(), in.size());
+    for (size_t i = 0; i < in.size(); i++) b.feed((const uint8_t*)in.data() + i, 1);
+    for (size_t pos = 0; pos < in.size();) {
+        size_t n = 1 + random32() % 64;
+        if (n > in.size() - pos) n = in.size() - pos;
+        r.feed((const uint8_t*)in.data() + pos, n);
+        pos += n;
+    }
+    return memcmp(&a.data(), &b.data(), sizeof(NmeaParser::Data)) == 0
+        && memcmp(&a.data(), &r.data(), sizeof(NmeaParser::Data)) == 0
+        && memcmp(&a.stats(), &b.stats(), sizeof(NmeaParser::Stats)) == 0
+        && memcmp(&a.stats(), &r.stats(), sizeof(NmeaParser::Stats)) == 0;
+}
+
+static uint64_t tsc() {
+#if HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+struct Throughput {
+    double bytesPerSec;
+    double nsPerSentence;
+    double cyclesPerSentence;
+};
+
+// Cały strumień wielokrotnie, fragmentami po 64 B jak z UART w tasku GPS
+template <typename Feed>
+static Throughput measure(const std::string& in, uint32_t lines, Feed feed) {
+
+    int passes = 0;
+    uint64_t c0 = tsc();
+    auto t0 = std::chrono::steady_clock::now();
+    double elapsed = 0;
+    while (elapsed < 0.5) {
+        for (size_t pos = 0; pos < in.size(); pos += 64)
+            feed((const uint8_t*)in.data() + pos, in.size() - pos < 64 ? in.size() - pos : 64);
+        passes++;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    }
+    uint64_t cycles = tsc() - c0;
+    double n = (double)lines * passes;
+    return Throughput{ (double)in.size() * passes / elapsed, elapsed * 1e9 / n, HAVE_TSC ? cycles / n : 0 };
+}
+
+static void printThroughput(const char* name, const Throughput& t) {
+
+    printf("[nmea] %-12s %7.1f MB/s, %6.1f ns/sentence", name, t.bytesPerSec / 1e6, t.nsPerSentence);
+    if (HAVE_TSC) printf(", %6.0f TSC cycles/sentence", t.cyclesPerSentence);
+    printf("\n");
+}
+
+static uint32_t countLines(const std::string& in) {
+
+    uint32_t n = 0;
+    for (char c : in) if (c == '$') n++;
+    return n ? n : 1;
+}
+
+// =============================================================================
+// FUZZING
+// =============================================================================
+
+static char randomChar() {
+
+    static const char alphabet[] = "$*,.\r\n0123456789ABCDEFNSEWVAGPRMC-+ ";
+    uint32_t r = random32();
+    if (r % 4 == 0) return (char)(r >> 8);
+    return alphabet[(r >> 8) % (sizeof(alphabet) - 1)];
+}
+
+// Przeliczenie sum kontrolnych wszystkich linii "$...*hh"
+static void fixChecksums(std::string& s) {
+
+    size_t pos = 0;
+    while ((pos = s.find('$', pos)) != std::string::npos) {
+        size_t star = s.find('*', pos);
+        size_t next = s.find('$', pos + 1);
+        if (star == std::string::npos || (next != std::string::npos && star > next) || star + 2 >= s.size()) {
+            pos++;
+            continue;
+        }
+        uint8_t sum = 0;
+        for (size_t i = pos + 1; i < star; i++) sum ^= (uint8_t)s[i];
+        char hex[3];
+        snprintf(hex, sizeof(hex), "%02X", sum);
+        s[star + 1] = hex[0];
+        s[star + 2] = hex[1];
+        pos = star;
+    }
+}
+
+static std::string mutate(const std::string& base) {
+
+    // Kilka kolejnych linii ze strumienia
+    size_t start = base.empty() ? 0 : random32() % base.size();
+    start = base.rfind('$', start);
+    if (start == std::string::npos) start = 0;
+    std::string s = base.substr(start, 80 + random32() % 600);
+
+    int edits = 1 + random32() % 4;
+    for (int e = 0; e < edits && !s.empty(); e++) {
+
+        size_t at = random32() % s.size();
+        switch (random32() % 9) {
+            case 0: s[at] ^= (char)(1 << (random32() % 8)); break;
+            case 1: s[at] = randomChar(); break;
+            case 2: s.erase(at, 1 + random32() % 4); break;
+            case 3: s.insert(at, 1, randomChar()); break;
+            case 4: s.resize(at); break;
+            case 5: s.insert(at, s.substr(at, random32() % 40)); break;
+            case 6: s.insert(at, std::string(100 + random32() % 300, randomChar())); break;
+            case 7: {
+                std::string junk;
+                for (int k = random32() % 64; k > 0; k--) junk += randomChar();
+                s.insert(at, junk);
+                break;
+            }
+            case 8: {
+                // Zamiana cyfr na granice zakresów
+                static const char* const edge[] = { "999999999", "0000000000", "60", "9000.0001", "18000.0", "361", "." , "" };
+                size_t comma = s.find(',', at);
+                if (comma == std::string::npos) break;
+                size_t end = s.find_first_of(",*", comma + 1);
+                if (end == std::string::npos) break;
+                s.replace(comma + 1, end - comma - 1, edge[random32() % 8]);
+                break;
+            }
+        }
+    }
+    if (random32() % 2) fixChecksums(s);
+    return s;
+}
+
+static bool fuzz(const std::string& base, uint32_t cases) {
+
+    Check c;
+    uint64_t bytes = 0;
+    NmeaParser p;
+    for (uint32_t i = 0; i < cases; i++) {
+        if (i % 64 == 0) p.reset();
+        std::string s = mutate(base);
+        bytes += s.size();
+        checkStream(s, p, c);
+        // Fragment kończy się w dowolnym miejscu - następny zaczyna się od nowej linii
+        checkStream("\r\n", p, c);
+    }
+    printf("[nmea] fuzz %u cases, %llu bytes\n", cases, (unsigned long long)bytes);
+    return report("fuzz", c);
+}
+
+// =============================================================================
+// WEJŚCIE
+// =============================================================================
+
+static bool readFile(const char* path, std::string& out) {
+
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return false;
+    }
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+    fclose(f);
+    return true;
+}
+
+static void onCaptureChunk(void* ctx, uint64_t, uint8_t channel, const uint8_t* data, size_t len) {
+    if (channel == TripLogFormat::CAPTURE_GPS_RX) static_cast<std::string*>(ctx)->append((const char*)data, len);
+}
+
+static bool readCapture(const char* path, std::string& out) {
+
+    std::string file;
+    if (!readFile(path, file)) return false;
+    CaptureReplay replay;
+    if (!replay.load((const uint8_t*)file.data(), file.size())) {
+        fprintf(stderr, "%s: not a link capture\n", path);
+        return false;
+    }
+    replay.run(onCaptureChunk, &out);
+    return true;
+}
+
+int main(int argc, char** argv) {
+
+    const char* path = nullptr;
+    const char* capture = nullptr;
+    uint32_t seconds = 3600, cases = 20000;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--capture") && i + 1 < argc) capture = argv[++i];
+        else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--fuzz") && i + 1 < argc) cases = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) rng = (uint32_t)strtoul(argv[++i], nullptr, 0) | 1;
+        else if (argv[i][0] != '-') path = argv[i];
+        else {
+            fprintf(stderr, "usage: nmea_bench [file.nmea | --capture link_capture.bin] [--seconds s] [--fuzz n] [--seed n]\n");
+            return 2;
+        }
+    }
+
+    std::string in;
+    if (capture) {
+        if (!readCapture(capture, in)) return 2;
+    } else if (path) {
+        if (!readFile(path, in)) return 2;
+    } else {
+        in = synthetic(seconds);
+    }
+    uint32_t lines = countLines(in);
+
+    // 1. Odniesienie
+    NmeaParser p;
+    Check c;
+    checkStream(in, p, c);
+    const NmeaParser::Stats& st = p.stats();
+    printf("[nmea] %zu bytes, %u lines: RMC %u, GGA %u, GSA %u, skipped %u, checksum errors %u, malformed %u\n",
+           in.size(), lines, st.sentences[NmeaParser::RMC], st.sentences[NmeaParser::GGA],
+           st.sentences[NmeaParser::GSA], st.skipped, st.checksumErrors, st.malformed);
+    const NmeaParser::Data& d = p.data();
+    printf("[nmea] last: %.7f %.7f, %.2f km/h, course %.2f, %02u:%02u:%02u %04u-%02u-%02u, %u sats, HDOP %.2f, fix %u\n",
+           d.latE7 / 1e7, d.lngE7 / 1e7, d.speedMmS * 0.0036, d.courseCdeg / 100.0,
+           (unsigned)(d.timeMs / 3600000), (unsigned)(d.timeMs / 60000 % 60), (unsigned)(d.timeMs / 1000 % 60),
+           d.year, d.month, d.day, d.sats, d.hdop / 100.0, d.fixType);
+    bool ok = report("reference", c);
+
+    // 2. Podział strumienia
+    bool same = sameChunking(in);
+    printf("[nmea] chunking (whole, 1 B, random 1-64 B): %s\n", same ? "identical" : "DIFFERENT");
+    ok = ok && same;
+
+    // 3. Wydajność
+    NmeaParser bench;
+    printThroughput("NmeaParser", measure(in, lines, [&](const uint8_t* b, size_t n) { bench.feed(b, n); }));
+#ifdef WITH_TINYGPS
+    TinyGPSPlus tiny;
+    printThroughput("TinyGPSPlus", measure(in, lines, [&](const uint8_t* b, size_t n) {
+        for (size_t i = 0; i < n; i++) tiny.encode((char)b[i]);
+    }));
+    printf("[nmea] TinyGPSPlus: %u passed, %u failed checksum\n", tiny.passedChecksum(), tiny.failedChecksum());
+#endif
+
+    // 4. Fuzzing
+    if (cases) ok = fuzz(in, cases) && ok;
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,636 @@
+/**
+ * @file obd_bench.cpp
+ * @brief Narzędzie hosta - test protokołu i benchmark OBD na emulatorze ELM327
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Uruchamia emulator ELM327 (elm327_emulator.h) w procesie, na zegarze
+ * wirtualnym (symulowana godzina jazdy trwa ułamek sekundy):
+ *
+ * 1. init  - czas uruchomienia ELM327: dotychczasowa sekwencja ze stałymi
+ *            przerwami wobec obd_discovery.h (pierwsze połączenie z wykrywaniem,
+ *            pojazd z pamięci, zmiana pojazdu)
+ * 2. check - zapytania pojedyncze, zbiorcze i wieloramkowe oraz odometr,
+ *            przy ATS0 i ATS1; odczyty ObdPid i odometr dekodowany wg profilu
+ *            pojazdu (vehicle_profile.h) porównane z wartościami skryptu
+ * 3. bench - harmonogram ObdScheduler z kanałami firmware (cabulator_settings.h)
+ *            na łączu z opóźnieniem i zakłóceniami; wynik: zapytania/s, PID/s
+ *            i osiągnięte częstotliwości wobec starej pętli co 2 s; ta sama sesja
+ *            emulatora (skrypt, ziarno, zegar) jest uruchamiana dwukrotnie -
+ *            zapytaniami zbiorczymi i po jednym PID na zapytanie - z porównaniem
+ *            próbek/s i liczby zapytań na łączu (round-trip); po utracie odpowiedzi
+ *            na pierwsze zapytanie zbiorcze zapytania zbiorcze muszą pozostać
+ *            włączone (ObdPid::BatchProbe); połączenie
+ *            prowadzi ObdConnection jak w firmware - z --disconnect wynik
+ *            obejmuje utraty łącza, ponowne połączenia i czas bez danych
+ *
+ * Z opcją --pty emulator jest udostępniany na pseudoterminalu w czasie
+ * rzeczywistym (np. dla zewnętrznych narzędzi OBD).
+ *
+ * Kompilacja (z katalogu code/):
+ * ```
+ * g++ -std=c++17 -O2 -Iinclude tools/obd_bench.cpp src/elm327_emulator.cpp \
+ *     src/obd_pid.cpp src/obd_scheduler.cpp src/obd_discovery.cpp src/obd_connection.cpp \
+ *     src/vehicle_profile.cpp -o obd_bench
+ * ```
+ *
+ * Użycie:
+ * ```
+ * obd_bench [--script plik] [--profile plik] [--latency ms] [--jitter ms] [--per-pid ms]
+ *           [--noise %] [--nodata %] [--drop %] [--disconnect n:ms]
+ *           [--chunk B] [--vin VIN|none] [--single] [--seconds s] [--seed n] [--pty] [-v]
+ * ```
+ * Kod wyjścia 1 oznacza niezgodność odczytów ze skryptem.
+ */
+
+#include "elm327_emulator.h"
+#include "obd_pid.h"
+#include "obd_scheduler.h"
+#include "obd_discovery.h"
+#include "obd_connection.h"
+#include "vehicle_profile.h"
+#include "../cabulator_settings.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+
+// =============================================================================
+// ZEGAR WIRTUALNY I ŁĄCZE
+// =============================================================================
+
+static uint32_t virtualNow = 0;
+static uint32_t nowVirtual() { return virtualNow; }
+static void sleepVirtual(uint32_t ms) { virtualNow += ms; }
+
+static bool verbose = false;
+static std::string rx;
+static bool rxComplete = false;
+
+static void onData(const uint8_t* data, size_t size) {
+    for (size_t i = 0; i < size && !rxComplete; i++) {
+        if (data[i] == '>') rxComplete = true;
+        else rx += (char)data[i];
+    }
+}
+
+// Normalizacja jak w ObdLink: \r i \n -> pojedyncze \n, bez pustych linii
+static std::string normalize(const std::string& in) {
+
+    std::string out;
+    for (char c : in) {
+        if (c == '\r' || c == '\n') {
+            if (!out.empty() && out.back() != '\n') out += '\n';
+        } else {
+            out += c;
+        }
+    }
+    while (!out.empty() && (out.back() == ' ' || out.back() == '\n')) out.pop_back();
+    return out;
+}
+
+struct LinkCounters {
+    uint32_t commands = 0;
+    uint32_t timeouts = 0;
+    uint64_t busyMs = 0;
+};
+static LinkCounters counters;
+
+// Odpowiednik ObdLink::transact na zegarze wirtualnym (nullptr = timeout)
+static const char* transact(Elm327Emulator& elm, const char* cmd, uint32_t timeoutMs = 1000) {
+
+    static std::string response;
+    rx.clear();
+    rxComplete = false;
+
+    uint32_t t0 = virtualNow;
+    std::string line = std::string(cmd) + "\r";
+    size_t written = elm.write((const uint8_t*)line.data(), line.size());
+    counters.commands++;
+
+    // Jak ObdLink: bez połączenia komenda nie jest wysyłana i nie czeka na odpowiedź
+    if (written != line.size()) {
+        counters.timeouts++;
+        if (verbose) printf("  %-8s -> (not connected)\n", cmd);
+        return nullptr;
+    }
+
+    if (!rxComplete || virtualNow - t0 > timeoutMs) {
+        virtualNow = t0 + timeoutMs;
+        counters.timeouts++;
+        counters.busyMs += timeoutMs;
+        if (verbose) printf("  %-8s -> (timeout)\n", cmd);
+        return nullptr;
+    }
+    counters.busyMs += virtualNow - t0;
+
+    response = normalize(rx);
+    if (verbose) printf("  %-8s -> %s\n", cmd, response.c_str());
+    return response.empty() ? nullptr : response.c_str();
+}
+
+// Profil pojazdu (domyślnie wbudowany, --profile plik)
+static VehicleProfile profile;
+
+// Odometr jak OBD::readOdometer (pole odometru profilu)
+static long readOdometer(Elm327Emulator& elm) {
+
+    float km;
+    if (!VehicleProfile::decode(profile.odometer, transact(elm, profile.odometer.command), km)) return -1;
+    return (long)km;
+}
+
+// =============================================================================
+// ETAPY
+// =============================================================================
+
+// Transact dla ObdDiscovery (wskaźnik na funkcję - emulator przez zmienną globalną)
+static Elm327Emulator* discoveryElm = nullptr;
+static const char* discoveryTransact(const char* cmd, uint32_t timeoutMs) {
+    return transact(*discoveryElm, cmd, timeoutMs);
+}
+
+// Dotychczasowa sekwencja firmware: stałe przerwy 500 ms i protokół 6 na sztywno
+static bool legacyInit(Elm327Emulator& elm) {
+
+    virtualNow += 500;
+    transact(elm, "ATZ", 2000);
+    virtualNow += 500;
+    const char* seq[] = { "ATE0", "ATL0", "ATS0", "ATH0" };
+    for (const char* cmd : seq) transact(elm, cmd, 500);
+    transact(elm, "ATSP6", 1000);
+    const char* resp = transact(elm, "0100", 3000);
+    return resp && strstr(resp, "41") != nullptr;
+}
+
+static bool runInit(Elm327Emulator& elm) {
+
+    printf("[init] time from Bluetooth connect to ELM ready (adapter reset %u ms, protocol search %u ms)\n",
+           elm.getConfig().resetMs, elm.getConfig().searchMs);
+
+    uint32_t t0 = virtualNow;
+    bool legacyOk = legacyInit(elm);
+    printf("[init] legacy fixed sequence:   %5u ms, %s\n", virtualNow - t0, legacyOk ? "OK" : "FAILED");
+
+    // Pierwsze połączenie - wykrywanie; kolejne - pojazd z pamięci
+    discoveryElm = &elm;
+    ObdDiscovery::Vehicle vehicle = {};
+    t0 = virtualNow;
+    ObdDiscovery::Outcome first = ObdDiscovery::bringUp(discoveryTransact, profile, vehicle);
+    printf("[init] first connect:           %5u ms, %s\n", virtualNow - t0,
+           first == ObdDiscovery::DISCOVERED ? "discovered" : "FAILED");
+    printf("[init]   VIN %s, protocol %X, PIDs %08X %08X, fuel %s, odometer %s\n",
+           vehicle.vin[0] ? vehicle.vin : "-", vehicle.protocol, vehicle.supported[0], vehicle.supported[1],
+           ObdDiscovery::fuelSourceLabel(vehicle.fuelSource), vehicle.odometer ? "yes" : "no");
+
+    t0 = virtualNow;
+    ObdDiscovery::Outcome cached = ObdDiscovery::bringUp(discoveryTransact, profile, vehicle);
+    printf("[init] cached vehicle:          %5u ms, %s\n", virtualNow - t0,
+           cached == ObdDiscovery::CACHED ? "cached" : "FAILED");
+
+    // Inny pojazd niż zapamiętany - weryfikacja nie przechodzi, wykrywanie od nowa
+    ObdDiscovery::Vehicle other = vehicle;
+    strcpy(other.vin, "WVWZZZ1KZ8W000001");
+    other.protocol = 3;
+    t0 = virtualNow;
+    ObdDiscovery::Outcome changed = ObdDiscovery::bringUp(discoveryTransact, profile, other);
+    printf("[init] different vehicle:       %5u ms, %s\n", virtualNow - t0,
+           changed == ObdDiscovery::DISCOVERED && strcmp(other.vin, vehicle.vin) == 0 ? "rediscovered" : "FAILED");
+
+    return first == ObdDiscovery::DISCOVERED && cached == ObdDiscovery::CACHED
+        && changed == ObdDiscovery::DISCOVERED;
+}
+
+// Porównanie odczytów z wartościami skryptu (bez szumu i błędów łącza)
+static int runCheck(Elm327Emulator& elm, const Elm327Emulator::Config& base) {
+
+    Elm327Emulator::Config cfg = base;
+    cfg.noisePct = 0;
+    cfg.noDataPct = 0;
+    cfg.dropPct = 0;
+    cfg.disconnectAfter = 0;
+    cfg.multiPid = true;
+    elm.setConfig(cfg);
+
+    const uint8_t batches[][ObdPid::MAX_BATCH] = {
+        { ObdPid::PID_SPEED },
+        { ObdPid::PID_MAF, ObdPid::PID_SPEED },
+        { ObdPid::PID_SUPPORTED_01_20, ObdPid::PID_MAF, ObdPid::PID_SPEED,
+          ObdPid::PID_RPM, ObdPid::PID_COOLANT_TEMP },             // Wieloramkowa
+    };
+    const size_t batchSizes[] = { 1, 2, 5 };
+
+    int errors = 0, checks = 0;
+    for (int spaces = 0; spaces <= 1; spaces++) {
+
+        transact(elm, spaces ? "ATS1" : "ATS0");
+
+        for (size_t b = 0; b < sizeof(batchSizes) / sizeof(batchSizes[0]); b++) {
+
+            ObdPid::Value values[ObdPid::MAX_BATCH];
+            uint8_t pids[ObdPid::MAX_BATCH];
+            for (size_t i = 0; i < batchSizes[b]; i++) {
+                pids[i] = batches[b][i];
+                values[i] = { batches[b][i], false, 0, {} };
+            }
+
+            // Emulator odczytuje skrypt w chwili odebrania komendy
+            char cmd[3 + 2 * ObdPid::MAX_BATCH + 1];
+            ObdPid::buildRequest(pids, batchSizes[b], cmd, sizeof(cmd));
+            uint32_t sentAt = virtualNow;
+            const char* resp = transact(elm, cmd);
+            ObdPid::parseResponse(resp ? resp : "", values, batchSizes[b]);
+
+            for (size_t i = 0; i < batchSizes[b]; i++) {
+                if (pids[i] % 0x20 == 0) continue;         // Mapa PID - tylko obecność
+                char key[5];
+                snprintf(key, sizeof(key), "01%02X", pids[i]);
+                uint8_t expected[4], len = 0;
+                checks++;
+                if (!elm.scriptValue(key, sentAt, expected, &len) || !values[i].valid
+                    || values[i].len != len || memcmp(values[i].data, expected, len) != 0) {
+                    errors++;
+                    printf("[check] %s PID %02X mismatch\n", cmd, pids[i]);
+                }
+            }
+            virtualNow += 5000;
+        }
+
+        uint32_t sentAt = virtualNow;
+        long odo = readOdometer(elm);
+        const VehicleProfile::Field& f = profile.odometer;
+        uint8_t expected[4], len = 0;
+        uint32_t raw = 0;
+        checks++;
+        bool scripted = elm.scriptValue(f.command, sentAt, expected, &len) && f.start + f.length <= len;
+        for (uint8_t b = 0; scripted && b < f.length; b++) raw = raw << 8 | expected[f.start + b];
+        if (!scripted || odo != (long)(raw * f.scale + f.offset)) {
+            errors++;
+            printf("[check] odometer mismatch (%ld)\n", odo);
+        }
+    }
+    transact(elm, "ATS0");
+
+    printf("[check] %d/%d values match the script\n", checks - errors, checks);
+    elm.setConfig(base);
+    return errors;
+}
+
+struct BenchResult {
+    uint32_t commands;          // Zapytania na łączu (round-trip ELM327)
+    uint32_t samples;           // Odczytane wartości PID i odometru
+    double secs;
+    uint32_t batchRequests;     // Zapytania z wieloma PID
+    ObdPid::BatchProbe::State batchState;
+};
+
+// batched = false: każdy PID z zapytania harmonogramu osobną komendą
+// (jak firmware przed zapytaniami z wieloma PID);
+// dropFirstBatch: odpowiedź na pierwsze zapytanie zbiorcze ginie (utracona ramka Bluetooth)
+static BenchResult runBench(Elm327Emulator& elm, uint32_t seconds, const char* mode, bool batched,
+                            bool dropFirstBatch = false) {
+
+    ObdScheduler scheduler(OBD_CONFIG::LINK_UTIL_PCT);
+    const uint8_t pids[] = { ObdPid::PID_MAF, ObdPid::PID_SPEED, ObdScheduler::NO_PID };
+    const char* names[] = { "MAF", "SPEED", "ODO" };
+    scheduler.addChannel({ ObdPid::PID_MAF, OBD_CONFIG::MAF_PERIOD_MS,
+                           OBD_CONFIG::MAF_STALE_MS, OBD_CONFIG::MAF_PRIORITY });
+    scheduler.addChannel({ ObdPid::PID_SPEED, OBD_CONFIG::SPEED_PERIOD_MS,
+                           OBD_CONFIG::SPEED_STALE_MS, OBD_CONFIG::SPEED_PRIORITY });
+    scheduler.addChannel({ ObdScheduler::NO_PID, OBD_CONFIG::ODO_PERIOD_MS,
+                           OBD_CONFIG::ODO_STALE_MS, OBD_CONFIG::ODO_PRIORITY });
+
+    // Połączenie jak w firmware (task OBD): łączenie z backoffem, ELM327 z pamięci pojazdu
+    ObdConnection conn({ OBD_CONFIG::RECONNECT_MIN_MS, OBD_CONFIG::RECONNECT_MAX_MS,
+                         OBD_CONFIG::DEGRADED_TIMEOUTS, OBD_CONFIG::LINK_LOST_TIMEOUTS });
+    ObdDiscovery::Vehicle vehicle = {};
+    discoveryElm = &elm;
+
+    counters = LinkCounters();
+    uint32_t start = virtualNow;
+    uint32_t end = start + seconds * 1000;
+    ObdPid::BatchProbe batchProbe(OBD_CONFIG::BATCH_REJECTS);     // Jak OBD::readPids
+    uint32_t batchRequests = 0;
+    uint32_t pidsRead = 0;
+    uint32_t offlineMs = 0, lastTick = start, longestOfflineMs = 0, offlineSince = start;
+    bool wasOnline = false;
+
+    // Liczniki kanałów sumowane przez ponowne połączenia (reset harmonogramu je zeruje)
+    uint32_t totalOk[3] = { 0 }, totalFailed[3] = { 0 };
+    auto foldChannels = [&]() {
+        for (size_t ch = 0; ch < scheduler.channelCount(); ch++) {
+            ObdScheduler::ChannelStats cs;
+            scheduler.channelStats(ch, virtualNow, cs);
+            totalOk[ch] += cs.samples;
+            totalFailed[ch] += cs.failures;
+        }
+    };
+
+    while (virtualNow < end) {
+
+        // Czas bez odpytywania ECU (łączenie, uruchomienie ELM327, backoff)
+        if (!wasOnline) offlineMs += virtualNow - lastTick;
+        lastTick = virtualNow;
+        if (conn.online() != wasOnline) {
+            wasOnline = conn.online();
+            if (wasOnline && virtualNow - offlineSince > longestOfflineMs) longestOfflineMs = virtualNow - offlineSince;
+            if (!wasOnline) offlineSince = virtualNow;
+        }
+
+        uint32_t connWaitMs;
+        ObdConnection::Action action = conn.step(virtualNow, connWaitMs);
+        if (action == ObdConnection::ACT_WAIT) {
+            virtualNow += connWaitMs;
+            continue;
+        }
+        if (action == ObdConnection::ACT_CONNECT) {
+            conn.onConnectResult(elm.connect(), virtualNow);
+            continue;
+        }
+        if (action == ObdConnection::ACT_INIT) {
+            bool ok = ObdDiscovery::bringUp(discoveryTransact, profile, vehicle) != ObdDiscovery::FAILED;
+            conn.onInitResult(ok, virtualNow);
+            if (ok) {
+                foldChannels();
+                scheduler.reset(virtualNow);
+                batchProbe.reset();
+            }
+            continue;
+        }
+        if (!elm.connected()) {
+            conn.onTransportLost(virtualNow);
+            continue;
+        }
+
+        ObdScheduler::Request req;
+        uint32_t waitMs = scheduler.next(virtualNow, req);
+        if (waitMs > 0) {
+            virtualNow += waitMs;
+            continue;
+        }
+
+        bool ok[ObdPid::MAX_BATCH] = { false };
+        uint32_t t0 = virtualNow;
+        LinkCounters before = counters;
+
+        if (pids[req.channels[0]] == ObdScheduler::NO_PID) {
+            ok[0] = readOdometer(elm) >= 0;
+        } else {
+            // Jak OBD::readPids: zbiorczo, brakujące pojedynczo
+            ObdPid::Value values[ObdPid::MAX_BATCH];
+            uint8_t list[ObdPid::MAX_BATCH];
+            for (size_t i = 0; i < req.count; i++) {
+                list[i] = pids[req.channels[i]];
+                values[i] = { list[i], false, 0, {} };
+            }
+
+            size_t got = 0;
+            bool sent = false;
+            char cmd[3 + 2 * ObdPid::MAX_BATCH + 1];
+            if (batched && (req.count == 1 || batchProbe.enabled())) {
+                sent = true;
+                ObdPid::buildRequest(list, req.count, cmd, sizeof(cmd));
+
+                Elm327Emulator::Config saved = elm.getConfig();
+                bool drop = dropFirstBatch && req.count > 1 && batchRequests == 0;
+                if (drop) {
+                    Elm327Emulator::Config lossy = saved;
+                    lossy.dropPct = 100;
+                    elm.setConfig(lossy);
+                }
+
+                uint32_t timeoutsBefore = counters.timeouts;
+                const char* resp = transact(elm, cmd);
+                if (drop) elm.setConfig(saved);
+
+                got = ObdPid::parseResponse(resp ? resp : "", values, req.count);
+                if (req.count > 1) {
+                    batchRequests++;
+                    batchProbe.onReply(resp && counters.timeouts == timeoutsBefore, got, req.count);
+                }
+            }
+            for (size_t i = 0; got < req.count && i < req.count; i++) {
+                if (values[i].valid || (sent && req.count == 1)) continue;
+                ObdPid::buildRequest(&list[i], 1, cmd, sizeof(cmd));
+                const char* resp = transact(elm, cmd);
+                got += ObdPid::parseResponse(resp ? resp : "", &values[i], 1);
+            }
+            for (size_t i = 0; i < req.count; i++) ok[i] = values[i].valid;
+        }
+
+        for (size_t i = 0; i < req.count; i++) pidsRead += ok[i];
+        conn.onRequest(counters.commands - before.commands > counters.timeouts - before.timeouts, virtualNow);
+        scheduler.complete(req, ok, virtualNow, virtualNow - t0);
+    }
+    if (!wasOnline) offlineMs += virtualNow - lastTick;
+    foldChannels();
+
+    double secs = (virtualNow - start) / 1000.0;
+    Elm327Emulator::Stats es = elm.getStats();
+    ObdScheduler::LinkStats ls = scheduler.linkStats();
+
+    printf("[bench] %s %.0f s simulated: %u commands (%.2f/s), %u PID samples (%.2f/s), %u timeouts\n",
+           mode, secs, counters.commands, counters.commands / secs, pidsRead, pidsRead / secs, counters.timeouts);
+    printf("[bench] %s link: avg %u ms, load %.0f%%, gap %u ms; emulator: %u NO DATA, %u dropped, %u disconnects\n",
+           mode, ls.latencyMs, 100.0 * counters.busyMs / (virtualNow - start), ls.gapMs,
+           es.noData, es.dropped, es.disconnects);
+
+    ObdConnection::Stats cs = conn.stats();
+    printf("[bench] %s connection: %u attempts, %u ELM init failures, %u link losses, offline %.1f s (%.1f%%), longest %.1f s\n",
+           mode, cs.attempts, cs.initFailures, cs.linkLosses, offlineMs / 1000.0,
+           100.0 * offlineMs / (virtualNow - start), longestOfflineMs / 1000.0);
+
+    for (size_t ch = 0; ch < scheduler.channelCount(); ch++) {
+        ObdScheduler::ChannelStats cs;
+        scheduler.channelStats(ch, virtualNow, cs);
+        printf("[bench] %s %-5s %6.2f Hz (target %5.2f Hz, old loop 0.50 Hz), %u ok, %u failed\n",
+               mode, names[ch], totalOk[ch] / secs, 1000.0 / cs.periodMs, totalOk[ch], totalFailed[ch]);
+    }
+    return { counters.commands, pidsRead, secs, batchRequests, batchProbe.state() };
+}
+
+// =============================================================================
+// PSEUDOTERMINAL
+// =============================================================================
+
+static int ptyFd = -1;
+
+static uint32_t nowReal() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static void sleepReal(uint32_t ms) { usleep(ms * 1000); }
+
+static void onPtyData(const uint8_t* data, size_t size) {
+    if (write(ptyFd, data, size) < 0) perror("pty write");
+}
+
+static int runPty(Elm327Emulator& elm) {
+
+    ptyFd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (ptyFd < 0 || grantpt(ptyFd) != 0 || unlockpt(ptyFd) != 0) {
+        perror("posix_openpt");
+        return 1;
+    }
+
+    // Strona podrzędna w trybie surowym, otwarta przez cały czas (bez zawieszenia po rozłączeniu klienta)
+    const char* name = ptsname(ptyFd);
+    int slave = open(name, O_RDWR | O_NOCTTY);
+    struct termios tio;
+    if (slave >= 0 && tcgetattr(slave, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(slave, TCSANOW, &tio);
+    }
+
+    elm.setHandler(onPtyData);
+    printf("[pty] ELM327 emulator on %s (Ctrl+C to stop)\n", name);
+    fflush(stdout);
+
+    uint8_t buf[256];
+    while (true) {
+        ssize_t n = read(ptyFd, buf, sizeof(buf));
+        if (n < 0) {
+            perror("pty read");
+            return 1;
+        }
+        if (n > 0) elm.write(buf, (size_t)n);
+    }
+}
+
+// =============================================================================
+// MAIN
+// =============================================================================
+
+static std::string readText(const char* path) {
+
+    std::string text;
+    FILE* f = fopen(path, "r");
+    if (!f) return text;
+    char buf[1024];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, n);
+    fclose(f);
+    return text;
+}
+
+int main(int argc, char** argv) {
+
+    bool pty = false;
+    uint32_t seconds = 600;
+    std::string script = Elm327Emulator::DEFAULT_SCRIPT;
+    std::string profileText = VehicleProfile::BUILTIN;
+    Elm327Emulator::Config cfg = Elm327Emulator::defaultConfig(nowVirtual, sleepVirtual);
+
+    for (int i = 1; i < argc; i++) {
+
+        std::string a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool hasValue = v != nullptr;
+
+        if (a == "--pty") pty = true;
+        else if (a == "--single") cfg.multiPid = false;
+        else if (a == "-v") verbose = true;
+        else if (a == "--script" && hasValue) {
+            script = readText(v);
+            if (script.empty()) { fprintf(stderr, "%s: cannot read script\n", v); return 2; }
+            i++;
+        }
+        else if (a == "--profile" && hasValue) {
+            profileText = readText(v);
+            if (profileText.empty()) { fprintf(stderr, "%s: cannot read profile\n", v); return 2; }
+            i++;
+        }
+        else if (a == "--latency" && hasValue) { cfg.latencyMs = atoi(v); i++; }
+        else if (a == "--jitter" && hasValue) { cfg.jitterMs = atoi(v); i++; }
+        else if (a == "--per-pid" && hasValue) { cfg.perPidMs = atoi(v); i++; }
+        else if (a == "--noise" && hasValue) { cfg.noisePct = atoi(v); i++; }
+        else if (a == "--nodata" && hasValue) { cfg.noDataPct = atoi(v); i++; }
+        else if (a == "--drop" && hasValue) { cfg.dropPct = atoi(v); i++; }
+        else if (a == "--chunk" && hasValue) { cfg.chunkBytes = atoi(v); i++; }
+        else if (a == "--vin" && hasValue) { cfg.vin = strcmp(v, "none") == 0 ? nullptr : v; i++; }
+        else if (a == "--seconds" && hasValue) { seconds = atoi(v); i++; }
+        else if (a == "--seed" && hasValue) { cfg.seed = strtoul(v, nullptr, 10); i++; }
+        else if (a == "--disconnect" && hasValue) {
+            unsigned n = 0, ms = 0;
+            if (sscanf(v, "%u:%u", &n, &ms) != 2) { fprintf(stderr, "--disconnect expects n:ms\n"); return 2; }
+            cfg.disconnectAfter = n;
+            cfg.disconnectMs = ms;
+            i++;
+        }
+        else {
+            fprintf(stderr, "usage: %s [--script file] [--profile file] [--latency ms] [--jitter ms] [--per-pid ms] [--noise %%]\n"
+                            "       [--nodata %%] [--drop %%] [--disconnect n:ms] [--chunk B] [--vin VIN|none]\n"
+                            "       [--single] [--seconds s] [--seed n] [--pty] [-v]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    char err[48];
+    if (!VehicleProfile::compile(profileText.c_str(), profile, err, sizeof(err))) {
+        fprintf(stderr, "profile error: %s\n", err);
+        return 2;
+    }
+    if (profile.odometer.requestLen == 0) {
+        fprintf(stderr, "profile has no odometer\n");
+        return 2;
+    }
+
+    if (pty) {
+        cfg.nowMs = nowReal;
+        cfg.sleepMs = sleepReal;
+    }
+
+    Elm327Emulator elm(cfg);
+    int errorLine = 0;
+    if (!elm.loadScript(script.c_str(), &errorLine)) {
+        fprintf(stderr, "script error at line %d\n", errorLine);
+        return 2;
+    }
+
+    if (pty) return runPty(elm);
+
+    elm.setHandler(onData);
+    if (!runInit(elm)) return 1;
+    int errors = runCheck(elm, cfg);
+
+    // Ta sama sesja (skrypt, ziarno, zegar) raz zapytaniami zbiorczymi, raz po jednym PID
+    uint32_t benchStart = virtualNow;
+    BenchResult results[2];
+    for (int single = 0; single <= 1; single++) {
+
+        virtualNow = benchStart;
+        Elm327Emulator session(cfg);
+        session.loadScript(script.c_str());
+        session.setHandler(onData);
+        results[single] = runBench(session, seconds, single ? "single " : "batched", !single);
+    }
+
+    const BenchResult& b = results[0];
+    const BenchResult& s = results[1];
+    printf("[bench] batched vs single PID: %.2f vs %.2f samples/s (x%.2f), %u vs %u round-trips "
+           "(%.2f vs %.2f samples/round-trip)\n",
+           b.samples / b.secs, s.samples / s.secs, s.samples ? (double)b.samples / s.samples : 0.0,
+           b.commands, s.commands, b.commands ? (double)b.samples / b.commands : 0.0,
+           s.commands ? (double)s.samples / s.commands : 0.0);
+
+    // Utracona odpowiedź na pierwsze zapytanie zbiorcze nie może wyłączyć zapytań zbiorczych
+    virtualNow = benchStart;
+    Elm327Emulator lossy(cfg);
+    lossy.loadScript(script.c_str());
+    lossy.setHandler(onData);
+    BenchResult d = runBench(lossy, 60, "drop1st", true, true);
+    bool batching = d.batchState != ObdPid::BatchProbe::NO && d.batchRequests > 1;
+    bool expected = cfg.multiPid;               // --single: ECU odrzuca zapytania zbiorcze
+    printf("[bench] first batch response lost: %u batch requests, multi-PID %s -> %s\n", d.batchRequests,
+           batching ? "kept" : "disabled", batching == expected ? "OK" : "FAILED");
+    if (batching != expected) errors++;
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,320 @@
+/**
+ * @file profile_bench.cpp
+ * @brief Narzędzie hosta - kompilacja profilu pojazdu i przepustowość dekodowania
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * 1. compile - profil wbudowany, opcjonalny plik (--profile) i zestaw
+ *              błędnych opisów, które muszą zostać odrzucone z numerem linii
+ * 2. check   - odpowiedzi odometru w formatach ELM327 (ATS0, ATS1,
+ *              SEARCHING..., odpowiedź negatywna 7F, NO DATA) dekodowane
+ *              tablicą profilu wobec wartości zadanej; stary odczyt
+ *              (strstr + strncpy + strtol po prefiksie 62DD01) dla porównania
+ * 3. bench   - dekodowania na sekundę: stary odczyt, tablica profilu z tekstu
+ *              odpowiedzi (ObdPid::collectBytes + nagłówek) i sama tablica na
+ *              bajtach; spalanie z MAF wg profilu wobec stałych 14.7 / 0.755
+ *
+ * Kompilacja (z katalogu code/):
+ * ```
+ * g++ -std=c++17 -O2 -Iinclude tools/profile_bench.cpp src/vehicle_profile.cpp src/obd_pid.cpp -o profile_bench
+ * ```
+ *
+ * Użycie:
+ * ```
+ * profile_bench [--profile vehicle.txt] [--count n]
+ * ```
+ * Kod wyjścia 1 oznacza błędne dekodowanie lub przyjęty błędny opis profilu.
+ */
+
+#include "vehicle_profile.h"
+#include "obd_pid.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// =============================================================================
+// STARY ODCZYT (OBD::readOdometer sprzed profilu)
+// =============================================================================
+
+static long legacyOdometer(const char* resp) {
+
+    if (!resp) return -1;
+    const char* p = strstr(resp, "62DD01");
+    if (p != NULL && strlen(p) >= 12) {
+        char hexStr[7];
+        strncpy(hexStr, p + 6, 6);
+        hexStr[6] = '\0';
+        long kilometers = strtol(hexStr, NULL, 16);
+        if (kilometers >= 1000 && kilometers < 999999999) return kilometers;
+    }
+    return -1;
+}
+
+static float legacyFuelLph(float maf) {
+    return (maf / 14.7f / 0.755f) * 3.6f;
+}
+
+// =============================================================================
+// ODPOWIEDZI
+// =============================================================================
+
+static uint32_t rng = 12345;
+static uint32_t random32() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+struct Sample {
+    std::string response;
+    float expected;             ///< < 0 = odpowiedź bez wartości
+    bool legacyFormat;          ///< Stary odczyt obsługuje ten format
+};
+
+// Bajty odpowiedzi pola (nagłówek + wartość na pozycji start) jako tekst ELM327
+static std::string formatResponse(const VehicleProfile::Field& f, uint32_t raw, bool spaces) {
+
+    uint8_t bytes[VehicleProfile::MAX_REQUEST + 64];
+    size_t n = 0;
+    bytes[n++] = (uint8_t)(f.request[0] + 0x40);
+    for (size_t i = 1; i < f.requestLen; i++) bytes[n++] = f.request[i];
+    for (size_t i = 0; i < f.start; i++) bytes[n++] = (uint8_t)random32();
+    for (int b = f.length - 1; b >= 0; b--) bytes[n++] = (uint8_t)(raw >> (8 * b));
+
+    std::string s;
+    char hex[4];
+    for (size_t i = 0; i < n; i++) {
+        snprintf(hex, sizeof(hex), spaces ? "%02X " : "%02X", bytes[i]);
+        s += hex;
+    }
+    if (spaces) s.pop_back();
+    return s;
+}
+
+static std::vector<Sample> makeSamples(const VehicleProfile& p, size_t count) {
+
+    const VehicleProfile::Field& f = p.odometer;
+    uint32_t maxRaw = f.length == 4 ? 0xFFFFFFFFu : (1u << (8 * f.length)) - 1;
+    std::vector<Sample> out;
+
+    for (size_t i = 0; i < count; i++) {
+
+        uint32_t raw = 1000 + random32() % (maxRaw - 1000);
+        float value = raw * f.scale + f.offset;
+        bool legacy = strcmp(f.command, "22DD01") == 0 && f.start == 0 && f.length == 3 && f.scale == 1.0f;
+
+        switch (i % 8) {
+            case 0: case 1: case 2: case 3:         // ATS0 - format firmware
+                out.push_back({ formatResponse(f, raw, false), value, legacy });
+                break;
+            case 4:                                 // ATS1
+                out.push_back({ formatResponse(f, raw, true), value, false });
+                break;
+            case 5:                                 // Pierwsza odpowiedź po wyszukaniu protokołu
+                out.push_back({ "SEARCHING...\r" + formatResponse(f, raw, false), value, legacy });
+                break;
+            case 6: {                               // Odpowiedź negatywna (ECU odrzuca zapytanie)
+                char neg[16];
+                snprintf(neg, sizeof(neg), "7F%02X31", f.request[0]);
+                out.push_back({ neg, -1.0f, true });
+                break;
+            }
+            default:
+                out.push_back({ "NO DATA", -1.0f, true });
+                break;
+        }
+    }
+    return out;
+}
+
+// =============================================================================
+// ETAPY
+// =============================================================================
+
+static int runCompile(const VehicleProfile& p) {
+
+    static const struct {
+        const char* text;
+        int line;
+    } BAD[] = {
+        { "fuel kerosene\n", 1 },
+        { "engine 1596\n", 1 },
+        { "# ok\nodometer 22DD0 0 3 1\n", 2 },          // Nieparzysta liczba cyfr
+        { "odometer 62DD01 0 3 1\n", 1 },               // Kod odpowiedzi zamiast zapytania
+        { "odometer 22DD01 0 5 1\n", 1 },               // Wartość dłuższa niż 4 B
+        { "odometer 22DD01 0 3 0\n", 1 },               // Skala 0
+        { "can speed 800 0 2 0.01\n", 1 },              // Identyfikator > 11 bit
+        { "can speed 1A0 6 4 0.01\n", 1 },              // Poza ramką 8 B
+        { "can rpm 1A0 0 2 1\n", 1 },
+        { "afr 40\n", 1 },
+        { "name\tVolvo V40 with a very long model name\n", 1 },
+        { "odometr 22DD01 0 3 1\n", 1 },
+    };
+
+    int errors = 0;
+    for (const auto& b : BAD) {
+        VehicleProfile v;
+        char err[48] = "";
+        char expected[16];
+        snprintf(expected, sizeof(expected), "line %d:", b.line);
+        if (VehicleProfile::compile(b.text, v, err, sizeof(err)) || strncmp(err, expected, strlen(expected)) != 0) {
+            errors++;
+            printf("[compile] accepted or wrong line: \"%s\" -> %s\n", b.text, err);
+        }
+    }
+
+    // Paliwo: wartości domyślne i nadpisanie
+    VehicleProfile d;
+    char err[48];
+    if (!VehicleProfile::compile("fuel diesel\ndensity 0.840\n", d, err, sizeof(err))
+        || d.afr != 14.5f || d.densityKgL != 0.840f || fabsf(d.lphPerGs - 3.6f / (14.5f * 0.840f)) > 1e-6f) {
+        errors++;
+        printf("[compile] diesel profile wrong\n");
+    }
+
+    printf("[compile] %s: fuel %s (AFR %.1f, %.3f kg/L), engine %u cm3 VE %u%%, odometer %s @%u+%u x%g, "
+           "CAN speed %s, CAN odometer %s, id %08X\n",
+           p.name, VehicleProfile::fuelLabel(p.fuel), p.afr, p.densityKgL, p.displacementCc, p.vePct,
+           p.odometer.requestLen ? p.odometer.command : "none", p.odometer.start, p.odometer.length,
+           p.odometer.scale, p.hasCan[VehicleProfile::CAN_SPEED] ? "yes" : "no",
+           p.hasCan[VehicleProfile::CAN_ODOMETER] ? "yes" : "no", p.id);
+    printf("[compile] %zu invalid descriptions rejected with line numbers: %s\n",
+           sizeof(BAD) / sizeof(BAD[0]), errors ? "FAILED" : "OK");
+    return errors;
+}
+
+static int runCheck(const VehicleProfile& p, const std::vector<Sample>& samples) {
+
+    int errors = 0, legacyWrong = 0, legacyMissed = 0;
+    for (const Sample& s : samples) {
+
+        float value = -1.0f;
+        bool ok = VehicleProfile::decode(p.odometer, s.response.c_str(), value);
+        if (ok != (s.expected >= 0) || (ok && fabsf(value - s.expected) > fabsf(s.expected) * 1e-6f)) {
+            if (errors++ < 5) printf("[check] \"%s\" -> %s %.1f (expected %.1f)\n",
+                                     s.response.c_str(), ok ? "ok" : "none", value, s.expected);
+        }
+
+        long legacy = legacyOdometer(s.response.c_str());
+        if (s.expected < 0 && legacy >= 0) legacyWrong++;
+        else if (s.expected >= 0 && (!s.legacyFormat || legacy < 0)) legacyMissed++;
+        else if (s.expected >= 0 && legacy != (long)s.expected) legacyWrong++;
+    }
+
+    printf("[check] %zu responses: profile table %zu/%zu correct; legacy parser %d missed, %d wrong\n",
+           samples.size(), samples.size() - errors, samples.size(), legacyMissed, legacyWrong);
+    return errors;
+}
+
+template <typename F>
+static double nsPerCall(size_t calls, F body) {
+    auto t0 = std::chrono::steady_clock::now();
+    body();
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / calls;
+}
+
+static void runBench(const VehicleProfile& p, const std::vector<Sample>& samples, int rounds) {
+
+    size_t calls = samples.size() * rounds;
+    volatile double sink = 0;
+
+    // Bajty odpowiedzi zebrane wcześniej - koszt samej tablicy
+    std::vector<std::vector<uint8_t>> bytes;
+    for (const Sample& s : samples) {
+        uint8_t b[VehicleProfile::MAX_RESPONSE];
+        size_t n = ObdPid::collectBytes(s.response.c_str(), b, sizeof(b));
+        bytes.emplace_back(b, b + n);
+    }
+
+    double legacyNs = nsPerCall(calls, [&] {
+        for (int r = 0; r < rounds; r++)
+            for (const Sample& s : samples) sink = sink + legacyOdometer(s.response.c_str());
+    });
+    double textNs = nsPerCall(calls, [&] {
+        float v;
+        for (int r = 0; r < rounds; r++)
+            for (const Sample& s : samples)
+                if (VehicleProfile::decode(p.odometer, s.response.c_str(), v)) sink = sink + v;
+    });
+    double tableNs = nsPerCall(calls, [&] {
+        float v;
+        for (int r = 0; r < rounds; r++)
+            for (const auto& b : bytes)
+                if (VehicleProfile::decode(p.odometer, b.data(), b.size(), v)) sink = sink + v;
+    });
+
+    printf("[bench] odometer, %zu decodes:\n", calls);
+    printf("[bench]   legacy strstr/strtol:        %7.1f ns  (%6.2f M/s)\n", legacyNs, 1e3 / legacyNs);
+    printf("[bench]   profile table from text:     %7.1f ns  (%6.2f M/s)\n", textNs, 1e3 / textNs);
+    printf("[bench]   profile table from bytes:    %7.1f ns  (%6.2f M/s)\n", tableNs, 1e3 / tableNs);
+
+    // Spalanie z MAF: profil benzynowy = stałe sprzed zmiany
+    float worst = 0;
+    for (int g = 0; g <= 25000; g++) {
+        float maf = g / 100.0f;
+        float diff = fabsf(p.fuelLph(maf) - legacyFuelLph(maf));
+        if (diff > worst) worst = diff;
+    }
+    printf("[bench] MAF fuel rate, %s: max difference to 14.7 / 0.755 constants %.6f L/h\n",
+           VehicleProfile::fuelLabel(p.fuel), worst);
+}
+
+// =============================================================================
+// MAIN
+// =============================================================================
+
+int main(int argc, char** argv) {
+
+    std::string text = VehicleProfile::BUILTIN;
+    size_t count = 4000;
+
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (a == "--profile" && hasValue) {
+            FILE* f = fopen(argv[++i], "rb");
+            if (!f) { fprintf(stderr, "%s: cannot open\n", argv[i]); return 2; }
+            text.clear();
+            char buf[1024];
+            size_t n;
+            while ((n = fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, n);
+            fclose(f);
+        }
+        else if (a == "--count" && hasValue) count = (size_t)atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [--profile file] [--count n]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    char err[48];
+    VehicleProfile profile;
+    if (!VehicleProfile::compile(text.c_str(), profile, err, sizeof(err))) {
+        fprintf(stderr, "profile error: %s\n", err);
+        return 2;
+    }
+    if (profile.odometer.requestLen == 0) {
+        fprintf(stderr, "profile has no odometer\n");
+        return 2;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    VehicleProfile compiled;
+    for (int i = 0; i < 1000; i++) VehicleProfile::compile(text.c_str(), compiled, err, sizeof(err));
+    double compileUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / 1000;
+    printf("[compile] %zu B profile compiled in %.1f us, %zu B table\n", text.size(), compileUs, sizeof(VehicleProfile));
+
+    int errors = runCompile(profile);
+    std::vector<Sample> samples = makeSamples(profile, count);
+    errors += runCheck(profile, samples);
+    runBench(profile, samples, 200);
+    return errors ? 1 : 0;
+}
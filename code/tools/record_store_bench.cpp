@@ -0,0 +1,485 @@
+/**
+ * @file record_store_bench.cpp
+ * @brief Narzędzie hosta - magazyn rekordów (RecordStore, SettingsCore) na RamFlash
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Magazyn o geometrii partycji cabstore (4 sektory po 4 kB) na emulatorze
+ * NOR RamFlash, z nakładką liczącą kasowania sektorów, czas operacji na
+ * zegarze wirtualnym i utratę zasilania w wybranej chwili. Scenariusze:
+ *
+ * - roundtrip - put/get/remove dla kluczy o różnych rozmiarach, odczyt
+ *   z błędnym rozmiarem, stan po ponownym montowaniu,
+ * - gc - losowe zapisy i usunięcia porównywane z modelem do odśmiecenia
+ *   każdego sektora kilka razy: aktualne wartości po każdym odśmiecaniu
+ *   i po montowaniu, licznik kasowań rośnie i zgadza się z nagłówkami,
+ * - gc-cut - utrata zasilania w RecordStore::collect() po skasowaniu
+ *   sektora docelowego, przed zapisem jego nagłówka: po montowaniu
+ *   obowiązuje poprzedni sektor z poprzednimi wartościami,
+ * - torn - utrata zasilania w połowie zapisu rekordu: rekord liczony
+ *   w corruptRecords, obowiązuje starsza wartość, kolejne zapisy działają,
+ * - bitflip - uszkodzony bajt wartości ostatniego rekordu: jak wyżej,
+ * - tombstone - usunięcie klucza przy pełnym aktywnym sektorze (nagrobek
+ *   się nie mieści): odśmiecanie bez usuwanego klucza,
+ * - metrics - SettingsCore: liczba zapisów, czas zapisu bez odśmiecania
+ *   i z odśmiecaniem (kasowanie sektora), licznik kasowań.
+ *
+ * Kompilacja (z katalogu code/):
+ * ```
+ * g++ -std=c++17 -O2 -Iinclude tools/record_store_bench.cpp src/record_store.cpp src/settings_core.cpp \
+ *     src/trip_log_format.cpp -o record_store_bench
+ * ```
+ *
+ * Użycie:
+ * ```
+ * record_store_bench [--seed n] [--writes n]
+ * ```
+ * Kod wyjścia 1 oznacza naruszenie któregoś z powyższych warunków.
+ */
+
+#include "record_store.h"
+#include "settings_core.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <vector>
+
+typedef std::map<uint8_t, std::vector<uint8_t>> Model;
+
+static const uint32_t SECTOR_SIZE = 4096;      // Jak PartitionFlash (settings_store.cpp)
+static const uint32_t SECTOR_COUNT = 4;        // cabstore 0x4000 (partitions.csv)
+static const uint32_t ERASE_US = 45000;        // Typowe kasowanie sektora 4 kB
+static const uint32_t WRITE_US = 60;           // Zapis (do 256 B)
+
+static uint32_t rng = 12345;
+static uint32_t random32() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+static uint32_t virtualUs = 0;
+static uint32_t clockUs() { return virtualUs; }
+
+// =============================================================================
+// PAMIĘĆ FLASH Z UTRATĄ ZASILANIA
+// =============================================================================
+
+class BenchFlash : public FlashDevice {
+public:
+    enum Cut : uint8_t {
+        CUT_NONE = 0,
+        CUT_AFTER_ERASE,        // Po skasowaniu sektora i cutWrites kolejnych zapisach
+        CUT_HALF_WRITE          // W połowie najbliższego zapisu
+    };
+
+    uint8_t mem[SECTOR_SIZE * SECTOR_COUNT];
+    RamFlash ram;
+    uint32_t erases[SECTOR_COUNT] = {};
+    Cut cut = CUT_NONE;
+    uint32_t cutWrites = 0;
+    uint32_t cutAddr = 0;       // Adres zapisu przerwanego utratą zasilania
+    bool powered = true;
+
+    BenchFlash() : ram(mem, SECTOR_SIZE, SECTOR_COUNT) {
+        memset(mem, 0xFF, sizeof(mem));
+    }
+
+    // Ponowne uruchomienie - zawartość pamięci zostaje
+    void powerOn() {
+        cut = CUT_NONE;
+        erased = false;
+        powered = true;
+    }
+
+    uint32_t sectorSize() const override { return SECTOR_SIZE; }
+    uint32_t sectorCount() const override { return SECTOR_COUNT; }
+
+    bool read(uint32_t addr, void* buf, size_t len) override {
+        return powered && ram.read(addr, buf, len);
+    }
+
+    bool write(uint32_t addr, const void* buf, size_t len) override {
+
+        if (!powered) return false;
+        virtualUs += WRITE_US;
+
+        if (cut == CUT_AFTER_ERASE && erased) {
+            if (cutWrites == 0) {
+                cutAddr = addr;
+                powered = false;
+                return false;
+            }
+            cutWrites--;
+        }
+        if (cut == CUT_HALF_WRITE) {
+            ram.write(addr, buf, len / 2);
+            powered = false;
+            return false;
+        }
+        return ram.write(addr, buf, len);
+    }
+
+    bool erase(uint32_t sector) override {
+
+        if (!powered) return false;
+        virtualUs += ERASE_US;
+        if (sector < SECTOR_COUNT) erases[sector]++;
+        erased = true;
+        return ram.erase(sector);
+    }
+
+private:
+    bool erased = false;
+};
+
+// =============================================================================
+// POMOCNICZE
+// =============================================================================
+
+static bool check(bool cond, const char* scenario, const char* what) {
+    if (!cond) printf("[store]   %s: %s  <-- FAILED\n", scenario, what);
+    return cond;
+}
+
+static std::vector<uint8_t> randomValue(size_t len) {
+
+    std::vector<uint8_t> v(len);
+    for (uint8_t& b : v) b = (uint8_t)random32();
+    return v;
+}
+
+// Porównanie całego magazynu z modelem (wszystkie klucze)
+static bool matches(RecordStore& store, const Model& model) {
+
+    uint8_t buf[RecordStore::MAX_PAYLOAD];
+    for (uint8_t k = 1; k < RecordStore::MAX_KEYS; k++) {
+
+        auto it = model.find(k);
+        if (it == model.end()) {
+            if (store.contains(k)) return false;
+            continue;
+        }
+        const std::vector<uint8_t>& v = it->second;
+        if (!store.get(k, buf, v.size()) || memcmp(buf, v.data(), v.size()) != 0) return false;
+    }
+    return true;
+}
+
+static bool put(RecordStore& store, Model& model, uint8_t key, const std::vector<uint8_t>& v) {
+
+    if (!store.put(key, v.data(), v.size())) return false;
+    model[key] = v;
+    return true;
+}
+
+// Zapisy jednego klucza do chwili, gdy następny zapis wymusi odśmiecanie
+static bool fillActive(RecordStore& store, Model& model, uint8_t key, size_t len) {
+
+    const uint32_t size = 12 + ((len + 3) & ~3u);      // Nagłówek rekordu + wyrównana wartość
+    while (store.stats().freeBytes >= size)
+        if (!put(store, model, key, randomValue(len))) return false;
+    return true;
+}
+
+// Adres ostatnio zapisanego rekordu (wolne miejsce tuż przed zapisem)
+static uint32_t recordAddr(const RecordStore::Stats& before) {
+    return before.activeSector * SECTOR_SIZE + SECTOR_SIZE - before.freeBytes;
+}
+
+// =============================================================================
+// SCENARIUSZE
+// =============================================================================
+
+static bool roundtrip() {
+
+    const char* name = "roundtrip";
+    BenchFlash flash;
+    RecordStore store(flash);
+    Model model;
+    bool ok = check(store.mount(), name, "mount of blank flash");
+
+    const size_t sizes[] = { 1, 4, 24, 41, RecordStore::MAX_PAYLOAD };
+    for (uint8_t k = 1; k <= 5; k++)
+        ok &= check(put(store, model, k, randomValue(sizes[k - 1])), name, "put");
+    ok &= check(put(store, model, 2, randomValue(4)), name, "overwrite");
+    ok &= check(matches(store, model), name, "get returns the last value");
+
+    uint8_t buf[RecordStore::MAX_PAYLOAD + 1] = {};
+    ok &= check(!store.get(3, buf, 23), name, "get with a wrong size is rejected");
+    ok &= check(!store.put(6, buf, RecordStore::MAX_PAYLOAD + 1), name, "oversized put is rejected");
+    ok &= check(!store.put(0, buf, 1) && !store.put(RecordStore::MAX_KEYS, buf, 1), name, "invalid key is rejected");
+
+    ok &= check(store.remove(4) && !store.contains(4), name, "remove");
+    model.erase(4);
+    ok &= check(store.remove(4) && store.remove(7), name, "remove of a missing key");
+    ok &= check(matches(store, model), name, "other keys after remove");
+
+    RecordStore again(flash);
+    ok &= check(again.mount() && matches(again, model), name, "values after remount");
+    ok &= check(again.stats().corruptRecords == 0, name, "no corrupt records");
+
+    printf("[store] roundtrip: %zu keys, %u records, %u B free\n",
+           model.size(), store.stats().recordsWritten, store.stats().freeBytes);
+    return ok;
+}
+
+static bool gc(uint32_t writes) {
+
+    const char* name = "gc";
+    BenchFlash flash;
+    RecordStore store(flash);
+    Model model;
+    bool ok = check(store.mount(), name, "mount");
+
+    uint32_t lastGc = 0;
+    uint32_t lastErase = store.stats().eraseCount;
+    uint32_t n = 0;
+    while (n < writes || store.stats().gcRuns < 3 * SECTOR_COUNT) {
+
+        uint8_t key = 1 + random32() % 12;
+        if (random32() % 10 == 0) {
+            ok &= check(store.remove(key), name, "remove");
+            model.erase(key);
+        } else {
+            // Stały rozmiar na klucz (jak struktury Settings)
+            ok &= check(put(store, model, key, randomValue(1 + key * 7)), name, "put");
+        }
+        n++;
+
+        RecordStore::Stats s = store.stats();
+        if (s.gcRuns != lastGc) {
+            lastGc = s.gcRuns;
+            ok &= check(matches(store, model), name, "live records after GC");
+            ok &= check(s.eraseCount > lastErase, name, "erase count grows with GC");
+            lastErase = s.eraseCount;
+        }
+        if (!ok) break;
+    }
+
+    bool allErased = true;
+    for (uint32_t e : flash.erases) allErased &= e >= 2;
+    ok &= check(allErased, name, "GC reached every sector");
+
+    RecordStore::Stats s = store.stats();
+    RecordStore again(flash);
+    ok &= check(again.mount() && matches(again, model), name, "values after remount");
+    ok &= check(again.stats().eraseCount == s.eraseCount, name, "erase count from sector headers");
+    ok &= check(again.stats().corruptRecords == 0, name, "no corrupt records");
+
+    printf("[store] gc: %u writes, %u GC runs, %u erases (sectors %u/%u/%u/%u), %zu live keys\n",
+           n, s.gcRuns, s.eraseCount, flash.erases[0], flash.erases[1], flash.erases[2], flash.erases[3],
+           model.size());
+    return ok;
+}
+
+static bool gcCut() {
+
+    const char* name = "gc-cut";
+    BenchFlash flash;
+    RecordStore store(flash);
+    Model model;
+    bool ok = check(store.mount(), name, "mount");
+
+    for (uint8_t k = 1; k <= 6; k++) ok &= check(put(store, model, k, randomValue(24)), name, "put");
+    ok &= check(fillActive(store, model, 1, 24), name, "fill active sector");
+
+    RecordStore::Stats before = store.stats();
+    uint32_t next = (before.activeSector + 1) % SECTOR_COUNT;
+    uint32_t nextErases = flash.erases[next];
+
+    // Ten zapis wymusza odśmiecanie - zasilanie znika po skopiowaniu aktualnych
+    // rekordów (jeden zapis na klucz), przed nagłówkiem nowego sektora
+    flash.cut = BenchFlash::CUT_AFTER_ERASE;
+    flash.cutWrites = (uint32_t)model.size();
+    std::vector<uint8_t> lost = randomValue(24);
+    ok &= check(!store.put(2, lost.data(), lost.size()), name, "put fails at power cut");
+    ok &= check(flash.erases[next] == nextErases + 1, name, "target sector erased before the cut");
+    ok &= check(flash.cutAddr == next * SECTOR_SIZE, name, "cut hits the target sector header");
+
+    flash.powerOn();
+    RecordStore again(flash);
+    ok &= check(again.mount(), name, "remount");
+    ok &= check(again.stats().activeSector == before.activeSector, name, "previous sector stays active");
+    ok &= check(matches(again, model), name, "previous values after remount");
+
+    // Kolejne odśmiecanie kończy się poprawnie
+    ok &= check(put(again, model, 2, lost), name, "put after power-up");
+    ok &= check(again.stats().gcRuns == 1 && again.stats().activeSector == next, name, "GC completes after power-up");
+
+    RecordStore third(flash);
+    ok &= check(third.mount() && matches(third, model), name, "values after second remount");
+
+    printf("[store] gc-cut: cut in collect() of sector %u -> %u, sector %u active after remount\n",
+           before.activeSector, next, before.activeSector);
+    return ok;
+}
+
+static bool torn() {
+
+    const char* name = "torn";
+    BenchFlash flash;
+    RecordStore store(flash);
+    Model model;
+    bool ok = check(store.mount(), name, "mount");
+
+    ok &= check(put(store, model, 3, randomValue(24)), name, "put");
+    ok &= check(put(store, model, 4, randomValue(41)), name, "put");
+
+    flash.cut = BenchFlash::CUT_HALF_WRITE;
+    std::vector<uint8_t> v = randomValue(24);
+    ok &= check(!store.put(3, v.data(), v.size()), name, "put fails at power cut");
+
+    flash.powerOn();
+    RecordStore again(flash);
+    ok &= check(again.mount(), name, "remount");
+    ok &= check(again.stats().corruptRecords == 1, name, "torn record counted in corruptRecords");
+    ok &= check(matches(again, model), name, "older value kept");
+
+    ok &= check(put(again, model, 3, v), name, "put after power-up");
+    RecordStore third(flash);
+    ok &= check(third.mount() && matches(third, model), name, "new value after remount");
+
+    printf("[store] torn: %u corrupt record(s) skipped\n", again.stats().corruptRecords);
+    return ok;
+}
+
+static bool bitflip() {
+
+    const char* name = "bitflip";
+    BenchFlash flash;
+    RecordStore store(flash);
+    Model model;
+    bool ok = check(store.mount(), name, "mount");
+
+    ok &= check(put(store, model, 5, randomValue(24)), name, "put");
+    RecordStore::Stats before = store.stats();
+    std::vector<uint8_t> v = randomValue(24);
+    ok &= check(store.put(5, v.data(), v.size()), name, "put");
+
+    // Bajt wartości nowszego rekordu (za 12 B nagłówka)
+    flash.mem[recordAddr(before) + 12 + 7] ^= 0x10;
+
+    RecordStore again(flash);
+    ok &= check(again.mount(), name, "remount");
+    ok &= check(again.stats().corruptRecords == 1, name, "flipped record counted in corruptRecords");
+    ok &= check(matches(again, model), name, "older value kept");
+
+    printf("[store] bitflip: %u corrupt record(s) skipped\n", again.stats().corruptRecords);
+    return ok;
+}
+
+static bool tombstone() {
+
+    const char* name = "tombstone";
+    BenchFlash flash;
+    RecordStore store(flash);
+    Model model;
+    bool ok = check(store.mount(), name, "mount");
+
+    for (uint8_t k = 1; k <= 4; k++) ok &= check(put(store, model, k, randomValue(24)), name, "put");
+    ok &= check(fillActive(store, model, 1, 24), name, "fill active sector");
+
+    // Dopełnienie do mniej niż 12 B wolnego miejsca (nagrobek się nie zmieści)
+    if (store.stats().freeBytes >= 12) ok &= check(fillActive(store, model, 6, 0), name, "fill active sector");
+    RecordStore::Stats before = store.stats();
+    ok &= check(before.freeBytes < 12 && before.gcRuns == 0, name, "active sector full");
+
+    ok &= check(store.remove(3), name, "remove with a full sector");
+    model.erase(3);
+    RecordStore::Stats after = store.stats();
+    ok &= check(after.gcRuns == 1, name, "remove runs GC");
+    ok &= check(after.recordsWritten == before.recordsWritten, name, "no tombstone written");
+    ok &= check(matches(store, model), name, "key removed, others kept");
+
+    RecordStore again(flash);
+    ok &= check(again.mount() && matches(again, model), name, "values after remount");
+
+    printf("[store] tombstone: %u B free before, sector %u -> %u, %u B free after\n",
+           before.freeBytes, before.activeSector, after.activeSector, after.freeBytes);
+    return ok;
+}
+
+static bool metrics() {
+
+    const char* name = "metrics";
+    BenchFlash flash;
+    SettingsCore core(flash, clockUs);
+    bool ok = check(core.mount(), name, "mount");
+
+    uint32_t eraseStart = core.stats().store.eraseCount;
+    uint32_t commits = 0, gcCommits = 0, plainCommits = 0;
+    uint32_t maxPlainUs = 0, minGcUs = UINT32_MAX;
+    uint64_t plainSumUs = 0;
+
+    while (core.stats().store.gcRuns < SECTOR_COUNT + 1) {
+
+        // Checkpoint trasy co 10 s (24 B) i co jakiś czas jasność
+        std::vector<uint8_t> v = randomValue(commits % 8 ? 24 : 1);
+        uint8_t key = commits % 8 ? 3 : 1;
+        uint32_t gcBefore = core.stats().store.gcRuns;
+        ok &= check(core.put(key, v.data(), v.size()), name, "put");
+        commits++;
+
+        SettingsCore::Stats s = core.stats();
+        if (s.store.gcRuns != gcBefore) {
+            gcCommits++;
+            if (s.lastCommitUs < minGcUs) minGcUs = s.lastCommitUs;
+        } else {
+            plainCommits++;
+            plainSumUs += s.lastCommitUs;
+            if (s.lastCommitUs > maxPlainUs) maxPlainUs = s.lastCommitUs;
+        }
+        if (!ok) break;
+    }
+
+    SettingsCore::Stats s = core.stats();
+    ok &= check(s.commits == commits, name, "commit count");
+    ok &= check(gcCommits == s.store.gcRuns, name, "one GC per GC commit");
+    ok &= check(minGcUs >= ERASE_US, name, "GC commit latency includes the sector erase");
+    ok &= check(maxPlainUs < ERASE_US, name, "plain commit latency has no erase");
+    ok &= check(s.maxCommitUs >= minGcUs, name, "max commit latency");
+    ok &= check(s.store.eraseCount == eraseStart + s.store.gcRuns, name, "erase count per GC");
+    ok &= check(s.store.erasesSinceBoot == s.store.eraseCount, name, "erases since boot");
+
+    printf("[store] metrics: %u commits (%u with GC), plain avg %.0f us max %u us, GC min %u us, "
+           "max %u us, %u erases\n",
+           s.commits, gcCommits, plainCommits ? (double)plainSumUs / plainCommits : 0.0, maxPlainUs,
+           minGcUs, s.maxCommitUs, s.store.eraseCount);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+
+    uint32_t writes = 20000;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            rng = (uint32_t)strtoul(argv[++i], nullptr, 0);
+            if (rng == 0) rng = 12345;          // xorshift nie wychodzi z zera
+        }
+        else if (!strcmp(argv[i], "--writes") && i + 1 < argc) writes = (uint32_t)atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: record_store_bench [--seed n] [--writes n]\n");
+            return 2;
+        }
+    }
+
+    printf("[store] %u sectors x %u B, erase %u us, write %u us\n", SECTOR_COUNT, SECTOR_SIZE, ERASE_US, WRITE_US);
+
+    bool ok = true;
+    ok &= roundtrip();
+    ok &= gc(writes);
+    ok &= gcCut();
+    ok &= torn();
+    ok &= bitflip();
+    ok &= tombstone();
+    ok &= metrics();
+
+    printf("[store] %s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,420 @@
+/**
+ * @file tariff_replay.cpp
+ * @brief Narzędzie hosta - odtwarzanie kursów przez skompilowaną taryfę i porównanie z oczekiwaną należnością
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Tryb wbudowany (bez argumentu) - kursy opisane krokami (jazda, postój,
+ * checkpoint), próbki co 1 s jak w tasku OBD (setClock() + addSample()),
+ * czas lokalny z kalendarza. Należności oczekiwane policzone ręcznie
+ * (rozpisane przy każdym kursie):
+ *
+ * - progi km i postój w dzień,
+ * - wejście w stawkę nocną o 22:00 i wyjście o 6:00 (godzina końcowa
+ *   przedziału `mult` nie jest objęta),
+ * - przejście przez północ w noc przed świętem: święto od 00:00 ma
+ *   pierwszeństwo przed mnożnikiem nocnym,
+ * - checkpoint w trakcie kursu (snapshot -> restore() w nowym silniku jak
+ *   po restarcie, screen_trip.cpp), także w połowie postoju przez północ
+ *   i w taryfie za litr: należność i jej część za postój zaraz po restore()
+ *   muszą być równe zapisanym, a należność końcowa - oczekiwanej,
+ * - błędne linie taryfy (np. święto bez MM-DD, kwota ponad 1 000 000 zł) odrzucane przez compile()
+ *   z właściwym komunikatem, poprawne przypadki brzegowe przyjmowane.
+ *
+ * Tryb nagranego kursu - obd_log.csv z karty SD (logi binarne najpierw przez
+ * trip_log_to_csv):
+ * ```
+ * Timestamp,DistanceKm,FuelLiters,TotalCost,UtcMs,TimeSource
+ * ```
+ * Przyrosty między wierszami trafiają do FareEngine (prędkość średnia
+ * przyrostu), czas lokalny z UtcMs w strefie TARIFF::TIME_ZONE. Wypisywana
+ * jest należność wg podanej taryfy obok zapisanej TotalCost; z --expect
+ * niezgodność z podaną kwotą kończy się kodem 1.
+ *
+ * Kompilacja (z katalogu code/):
+ * ```
+ * g++ -std=c++17 -O2 -Iinclude tools/tariff_replay.cpp src/fare_engine.cpp src/tariff_table.cpp -o tariff_replay
+ * ```
+ *
+ * Użycie:
+ * ```
+ * tariff_replay [-v]
+ * tariff_replay --tariff tariff.txt <folder_trasy | obd_log.csv> [--expect zł]
+ * ```
+ * Kod wyjścia 1 oznacza należność inną niż oczekiwana.
+ */
+
+#include "fare_engine.h"
+#include "tariff_table.h"
+#include "../cabulator_settings.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <sys/stat.h>
+
+static bool verbose = false;
+
+// Taryfa kursów wbudowanych
+static const char* TARIFF_CITY =
+    "mode km\n"
+    "flagfall 8.00\n"
+    "band 0 3.00\n"
+    "band 10 2.50\n"
+    "waiting 1.20 10           # 2 gr/s, w nocy 3 gr/s\n"
+    "mult 1-5 22-6 150\n"
+    "mult 6-7 0-24 150\n"
+    "holiday 12-25 200\n";
+
+static const char* TARIFF_LITRE =
+    "mode litre\n"
+    "flagfall 9.00\n"
+    "rate 6.00                 # 0.6 gr/ml\n";
+
+// =============================================================================
+// KALENDARZ (czas lokalny)
+// =============================================================================
+
+struct LocalTime {
+    int year, month, day, hour, minute, second;
+    int weekday;                // 0 = pon
+};
+
+static int daysInMonth(int year, int month) {
+    static const int days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return month == 2 && leap ? 29 : days[month - 1];
+}
+
+// Dzień tygodnia (0 = pon) z dni od 1970-01-01 (czwartek)
+static int weekdayOf(int year, int month, int day) {
+    int y = year - (month <= 2);
+    int era = y / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    long days = (long)era * 146097 + doe - 719468;
+    return (int)((days + 3) % 7);
+}
+
+static bool parseLocal(const char* s, LocalTime& t) {
+    if (sscanf(s, "%d-%d-%d %d:%d:%d", &t.year, &t.month, &t.day, &t.hour, &t.minute, &t.second) != 6)
+        return false;
+    t.weekday = weekdayOf(t.year, t.month, t.day);
+    return true;
+}
+
+static void tick(LocalTime& t) {
+    if (++t.second < 60) return;
+    t.second = 0;
+    if (++t.minute < 60) return;
+    t.minute = 0;
+    if (++t.hour < 24) return;
+    t.hour = 0;
+    t.weekday = (t.weekday + 1) % 7;
+    if (++t.day <= daysInMonth(t.year, t.month)) return;
+    t.day = 1;
+    if (++t.month <= 12) return;
+    t.month = 1;
+    t.year++;
+}
+
+static void setClock(FareEngine& e, const LocalTime& t) {
+    e.setClock((uint8_t)t.weekday, (uint8_t)t.hour, (uint8_t)t.month, (uint8_t)t.day);
+}
+
+// =============================================================================
+// KURSY WBUDOWANE
+// =============================================================================
+
+struct Step {
+    char kind;                  // 'D' jazda, 'W' postój, 'C' checkpoint i restore(), 0 = koniec
+    uint32_t seconds;
+    uint32_t distanceM;         // Jazda: dystans kroku (równomiernie)
+    uint32_t fuelMl;            // Paliwo kroku (równomiernie)
+};
+
+struct Case {
+    const char* name;
+    const char* tariff;
+    const char* start;          // Czas lokalny pierwszej próbki - 1 s
+    Step steps[6];
+    uint32_t expectedGr;
+};
+
+static const Case CASES[] = {
+
+    // 6 rozpoczętych km x 3.00 + 8.00 = 26.00
+    { "day, 5.5 km", TARIFF_CITY, "2025-01-20 10:00:00",
+      { { 'D', 600, 5500, 400 } }, 2600 },
+
+    // km 0-9 x 3.00 + km 10-12 x 2.50 + 8.00 = 45.50
+    { "day, bands, 12.3 km", TARIFF_CITY, "2025-01-20 10:00:00",
+      { { 'D', 1200, 12300, 900 } }, 4550 },
+
+    // postój 300 s x 2 gr + 3 km x 3.00 + 8.00 = 23.00
+    { "day, 5 min waiting", TARIFF_CITY, "2025-01-20 10:00:00",
+      { { 'W', 300, 0, 60 }, { 'D', 300, 2200, 150 } }, 2300 },
+
+    // pon 21:55:30, 10 m/s: km 0-2 przed 22:00 (3.00), km 3 od 22:00:30, km 3-5 x 4.50 + 8.00 = 30.50
+    { "into night at 22:00", TARIFF_CITY, "2025-01-20 21:55:30",
+      { { 'D', 550, 5500, 400 } }, 3050 },
+
+    // wt 05:58:00, 10 m/s: km 0-1 x 4.50 (przed 6:00), km 2 od 06:01:20 x 3.00 + 8.00 = 20.00
+    { "out of night at 6:00", TARIFF_CITY, "2025-01-21 05:58:00",
+      { { 'D', 290, 2900, 200 } }, 2000 },
+
+    // śr 24.12 23:58:30, 10 m/s: km 0 noc x 4.50, km 1-3 od 00:00:10 święto x 6.00 + 8.00 = 30.50
+    { "midnight into holiday", TARIFF_CITY, "2025-12-24 23:58:30",
+      { { 'D', 350, 3500, 250 } }, 3050 },
+
+    // 25.12 12:00: postój 120 s x 4 gr + 3 km x 6.00 + 8.00 = 30.80
+    { "holiday, waiting", TARIFF_CITY, "2025-12-25 12:00:00",
+      { { 'W', 120, 0, 20 }, { 'D', 300, 2500, 200 } }, 3080 },
+
+    // jak "bands" z restartem po 600 s (6150 m): 45.50
+    { "checkpoint, bands", TARIFF_CITY, "2025-01-20 10:00:00",
+      { { 'D', 600, 6150, 450 }, { 'C', 0, 0, 0 }, { 'D', 600, 6150, 450 } }, 4550 },
+
+    // pon 23:50: postój 900 s w nocy x 3 gr (restart po 450 s, przez północ),
+    // potem km 0-1 x 4.50 + 8.00 = 27.00 + 9.00 + 8.00 = 44.00
+    { "checkpoint, night waiting across midnight", TARIFF_CITY, "2025-01-20 23:50:00",
+      { { 'W', 450, 0, 90 }, { 'C', 0, 0, 0 }, { 'W', 450, 0, 90 }, { 'D', 180, 1500, 120 } }, 4400 },
+
+    // 1500 ml x 0.6 gr + 9.00 = 18.00, restart po 750 ml
+    { "checkpoint, litre", TARIFF_LITRE, "2025-01-20 10:00:00",
+      { { 'D', 600, 6000, 750 }, { 'C', 0, 0, 0 }, { 'D', 600, 6000, 750 } }, 1800 },
+};
+
+// Linie dopisywane do TARIFF_CITY: error = oczekiwany błąd compile(), nullptr = linia poprawna
+struct BadLine {
+    const char* line;
+    const char* error;
+};
+
+static const BadLine BAD_LINES[] = {
+    { "holiday 5 150", "bad holiday" },         // Sama liczba - nie 5 maja
+    { "holiday 2-30 150", "bad holiday" },
+    { "holiday 4-31 150", "bad holiday" },
+    { "holiday 13-1 150", "bad holiday" },
+    { "holiday 5- 150", "bad holiday" },
+    { "holiday 2-29 150", nullptr },            // Święto o stałej dacie może wypaść 29 lutego
+    { "holiday 12-31 150", nullptr },
+    { "flagfall 99999999999", "bad amount" },   // Przepełnienie uint32 dawało małą kwotę
+    { "flagfall 1000000.01", nullptr },
+    { "flagfall 1000001", "bad amount" },
+    { "band 50 42949673", "bad band" },
+    { "waiting 5000000 10", "bad waiting" },
+};
+
+static bool runBadLine(const BadLine& b) {
+
+    std::string text = std::string(TARIFF_CITY) + b.line + "\n";
+    TariffTable table;
+    char err[64] = "";
+    bool compiled = TariffTable::compile(text.c_str(), table, err, sizeof(err));
+
+    bool pass = b.error ? !compiled && strstr(err, b.error) != nullptr : compiled;
+    printf("[tariff] %-42s %s%s\n", b.line, compiled ? "accepted" : err, pass ? "" : "  <-- FAILED");
+    return pass;
+}
+
+// Część całkowita i reszta przy równomiernym rozłożeniu total na n próbek
+static uint32_t share(uint64_t total, uint32_t n, uint32_t i) {
+    return (uint32_t)(total * (i + 1) / n - total * i / n);
+}
+
+static bool runCase(const Case& c) {
+
+    TariffTable table;
+    char err[64];
+    if (!TariffTable::compile(c.tariff, table, err, sizeof(err))) {
+        printf("[tariff] %s: tariff error %s\n", c.name, err);
+        return false;
+    }
+
+    LocalTime t;
+    if (!parseLocal(c.start, t)) {
+        printf("[tariff] %s: bad start time\n", c.name);
+        return false;
+    }
+
+    FareEngine engine;
+    engine.setTable(table);
+    setClock(engine, t);
+    bool ok = true;
+    int restores = 0;
+
+    for (const Step& s : c.steps) {
+
+        if (!s.kind) break;
+
+        if (s.kind == 'C') {
+            // Checkpoint jak w saveTripCheckpoint(), restart i loadTripCheckpoint()
+            FareEngine::Snapshot cp = engine.snapshot();
+            engine = FareEngine();
+            engine.setTable(table);
+            engine.restore(cp.distanceM, cp.fuelMl, cp.elapsedMs, cp.waitingMs, cp.dueGr, cp.waitingGr);
+            setClock(engine, t);
+            FareEngine::Snapshot after = engine.snapshot();
+            restores++;
+            if (after.dueGr != cp.dueGr || after.distanceM != cp.distanceM || after.waitingMs != cp.waitingMs
+                    || after.waitingGr != cp.waitingGr) {
+                printf("[tariff] %s: restore changed the trip: %u gr (waiting %u gr) %u m -> %u gr (waiting %u gr) %u m\n",
+                       c.name, cp.dueGr, cp.waitingGr, cp.distanceM, after.dueGr, after.waitingGr, after.distanceM);
+                ok = false;
+            }
+            if (verbose)
+                printf("[tariff]   checkpoint at %02d:%02d:%02d: %u m, %u gr\n",
+                       t.hour, t.minute, t.second, cp.distanceM, cp.dueGr);
+            continue;
+        }
+
+        for (uint32_t i = 0; i < s.seconds; i++) {
+            tick(t);
+            uint32_t mm = s.kind == 'D' ? share((uint64_t)s.distanceM * 1000, s.seconds, i) : 0;
+            uint32_t ul = share((uint64_t)s.fuelMl * 1000, s.seconds, i);
+            int16_t kmh = (int16_t)(mm * 36 / 10000);
+            setClock(engine, t);
+            engine.addSample(mm, ul, 1000, kmh);
+        }
+    }
+
+    FareEngine::Snapshot f = engine.snapshot();
+    bool pass = ok && f.dueGr == c.expectedGr;
+    printf("[tariff] %-42s %6.2f PLN (expected %6.2f), %2u km started, waiting %3u s%s%s\n",
+           c.name, f.dueGr / 100.0, c.expectedGr / 100.0, f.startedKm, f.waitingMs / 1000,
+           restores ? ", restored" : "", pass ? "" : "  <-- FAILED");
+    return pass;
+}
+
+// =============================================================================
+// NAGRANY KURS (obd_log.csv)
+// =============================================================================
+
+static bool readFile(const char* path, std::string& out) {
+
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    char buf[4096];
+    size_t n;
+    out.clear();
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+    fclose(f);
+    return true;
+}
+
+static int replayRecorded(const char* tariffPath, const char* logPath, double expectPln) {
+
+    std::string text;
+    if (!readFile(tariffPath, text)) {
+        fprintf(stderr, "%s: cannot read\n", tariffPath);
+        return 2;
+    }
+    TariffTable table;
+    char err[64];
+    if (!TariffTable::compile(text.c_str(), table, err, sizeof(err))) {
+        fprintf(stderr, "%s: %s\n", tariffPath, err);
+        return 2;
+    }
+
+    std::string obdPath = logPath;
+    struct stat sb;
+    if (stat(logPath, &sb) == 0 && S_ISDIR(sb.st_mode)) obdPath += "/obd_log.csv";
+    FILE* f = fopen(obdPath.c_str(), "r");
+    if (!f) {
+        fprintf(stderr, "%s: cannot read\n", obdPath.c_str());
+        return 2;
+    }
+
+    // Mnożniki w czasie lokalnym jak w firmware (Fare::updateClock)
+    setenv("TZ", TARIFF::TIME_ZONE, 1);
+    tzset();
+
+    FareEngine engine;
+    engine.setTable(table);
+
+    char line[256];
+    unsigned long prevTs = 0;
+    double prevKm = 0, prevL = 0, loggedCost = 0;
+    long rows = 0, noUtc = 0;
+    while (fgets(line, sizeof(line), f)) {
+
+        unsigned long ts;
+        double km, litres, cost;
+        unsigned long long utcMs = 0;
+        int n = sscanf(line, "%lu,%lf,%lf,%lf,%llu", &ts, &km, &litres, &cost, &utcMs);
+        if (n < 4) continue;                            // Nagłówek
+
+        if (utcMs) {
+            time_t sec = (time_t)(utcMs / 1000);
+            struct tm lt;
+            localtime_r(&sec, &lt);
+            engine.setClock((uint8_t)((lt.tm_wday + 6) % 7), (uint8_t)lt.tm_hour,
+                            (uint8_t)(lt.tm_mon + 1), (uint8_t)lt.tm_mday);
+        } else {
+            engine.setClock(0xFF, 0, 0, 0);
+            noUtc++;
+        }
+
+        if (rows > 0 && ts > prevTs) {
+            double dKm = km - prevKm, dL = litres - prevL;
+            engine.addSample(dKm > 0 ? (uint32_t)(dKm * 1e6 + 0.5) : 0, dL > 0 ? (uint32_t)(dL * 1e6 + 0.5) : 0,
+                             (uint32_t)(ts - prevTs), -1);
+        }
+        prevTs = ts;
+        prevKm = km;
+        prevL = litres;
+        loggedCost = cost;
+        rows++;
+    }
+    fclose(f);
+
+    FareEngine::Snapshot s = engine.snapshot();
+    printf("[tariff] %s: %ld rows, %.3f km, %.3f l, waiting %u s, %u km started, multiplier now %u%%%s\n",
+           obdPath.c_str(), rows, s.distanceM / 1000.0, s.fuelMl / 1000.0, s.waitingMs / 1000, s.startedKm,
+           s.multiplierPct, noUtc ? " (rows without UtcMs at 100%)" : "");
+    printf("[tariff] fare %.2f PLN (logged TotalCost %.2f PLN)\n", s.dueGr / 100.0, loggedCost);
+
+    if (expectPln < 0) return 0;
+    bool ok = s.dueGr == (uint32_t)(expectPln * 100 + 0.5);
+    printf("[tariff] %s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+
+    const char* tariffPath = nullptr;
+    const char* logPath = nullptr;
+    double expectPln = -1;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--tariff") && i + 1 < argc) tariffPath = argv[++i];
+        else if (!strcmp(argv[i], "--expect") && i + 1 < argc) expectPln = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-v")) verbose = true;
+        else if (argv[i][0] != '-') logPath = argv[i];
+        else {
+            fprintf(stderr, "usage: tariff_replay [-v] | tariff_replay --tariff tariff.txt <trip_folder | obd_log.csv> "
+                            "[--expect pln]\n");
+            return 2;
+        }
+    }
+
+    if (logPath || tariffPath) {
+        if (!logPath || !tariffPath) {
+            fprintf(stderr, "recorded replay needs --tariff and a trip folder or obd_log.csv\n");
+            return 2;
+        }
+        return replayRecorded(tariffPath, logPath, expectPln);
+    }
+
+    bool ok = true;
+    for (const Case& c : CASES) ok = runCase(c) && ok;
+    for (const BadLine& b : BAD_LINES) ok = runBadLine(b) && ok;
+
+    printf("[tariff] %s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
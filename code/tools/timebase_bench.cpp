@@ -0,0 +1,265 @@
+/**
+ * @file timebase_bench.cpp
+ * @brief Narzędzie hosta - dokładność i koszt ClockDiscipline na symulowanym kwarcu i odniesieniach GPS
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Zegar monotoniczny ESP32 jest symulowany jako kwarc ze stałym dryfem
+ * i wolnym wahaniem (temperatura w kabinie). Odniesienia podaje się tak
+ * jak Timebase w firmware (timebase.cpp, parametry z cabulator_settings.h):
+ *
+ * - NMEA - chwila początku paczki zdań minus TIMEBASE::NMEA_LATENCY_MS;
+ *   rzeczywiste opóźnienie modułu różni się od przyjętego (błąd stały)
+ *   i ma rozrzut; część paczek jest przypisana do złej epoki (odbiór
+ *   opóźniony przez inne taski)
+ * - PPS - chwila przerwania impulsu (rozrzut kilkudziesięciu us)
+ * - zegar systemowy po restarcie ESP32 (błąd ~1.5 s) przed pierwszym fixem
+ *
+ * W każdym scenariuszu jest przerwa w odbiorze (tunel, parking podziemny).
+ * Co 100 ms czasu prawdziwego porównywany jest UTC z modelu z prawdziwym:
+ * największy błąd po ustaleniu się modelu (poza przerwą i w przerwie),
+ * pokrycie błędu przez podwojoną podawaną niepewność, cofnięcia UTC między kolejnymi
+ * odczytami. Dla porównania - dotychczasowe jednorazowe ustawienie zegara
+ * pierwszym fixem (dalej sam kwarc).
+ *
+ * Koszt: ns na odniesienie (addReference) i na przeliczenie (Model::utcAt).
+ *
+ * Kompilacja (z katalogu code/):
+ * ```
+ * g++ -std=c++17 -O2 -Iinclude tools/timebase_bench.cpp src/clock_discipline.cpp -o timebase_bench
+ * ```
+ *
+ * Użycie:
+ * ```
+ * timebase_bench [--minutes n] [--drift ppm] [--seed n]
+ * ```
+ * Kod wyjścia 1 oznacza błąd ponad próg scenariusza lub niepewność
+ * niepokrywającą błędu.
+ */
+
+#include "clock_discipline.h"
+#include "../cabulator_settings.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+
+static constexpr int64_t UTC0_US = 1737331200LL * 1000000;     // 2025-01-20 00:00:00 UTC
+static constexpr double PI = 3.14159265358979;
+
+// =============================================================================
+// KWARC I LOSOWANIE
+// =============================================================================
+
+static uint32_t rng = 1;
+
+static double uniform() {
+    rng = rng * 1664525u + 1013904223u;
+    return (rng >> 8) / 16777216.0;
+}
+
+/**
+ * Zegar monotoniczny w chwili prawdziwej t [us]: dryf stały + wahanie
+ * sinusoidalne (całka w postaci zamkniętej)
+ */
+struct Crystal {
+    double ppm;             // Dryf stały
+    double wanderPpm;       // Amplituda wahania
+    double periodS;         // Okres wahania
+
+    int64_t mono(double tUs) const {
+        double w = 2.0 * PI / (periodS * 1e6);
+        double dev = ppm * 1e-6 * tUs + wanderPpm * 1e-6 * (1.0 - cos(w * tUs)) / w;
+        return (int64_t)llround(tUs + dev);
+    }
+};
+
+// =============================================================================
+// SCENARIUSZE
+// =============================================================================
+
+struct Scenario {
+    const char* name;
+    uint8_t source;             // ClockDiscipline::SOURCE_NMEA / SOURCE_PPS
+    uint32_t rateMs;            // Okres epok
+    bool systemSeed;            // Start z zegara systemowego (restart ESP32)
+    double latencyBiasMs;       // Rzeczywiste opóźnienie NMEA - przyjęte
+    double jitterMs;            // Rozrzut opóźnienia NMEA (+/-)
+    double wrongEpochPct;       // Paczki przypisane do poprzedniej epoki [%]
+    double maxErrMs;            // Próg błędu poza przerwą
+    double maxHoldoverMs;       // Próg błędu w przerwie
+};
+
+static const Scenario SCENARIOS[] = {
+    { "nmea-1hz",  ClockDiscipline::SOURCE_NMEA, 1000, false, 15.0, 10.0, 0.0, 30.0, 40.0 },
+    { "nmea-5hz",  ClockDiscipline::SOURCE_NMEA,  200, false, 15.0, 10.0, 0.0, 30.0, 40.0 },
+    { "outliers",  ClockDiscipline::SOURCE_NMEA,  200, false, 15.0, 10.0, 2.0, 30.0, 40.0 },
+    { "rtc-seed",  ClockDiscipline::SOURCE_NMEA,  200, true,  15.0, 10.0, 0.0, 30.0, 40.0 },
+    { "pps",       ClockDiscipline::SOURCE_PPS,  1000, false,  0.0,  0.0, 0.0,  0.1,  5.0 },
+};
+
+struct Outcome {
+    double maxErrMs;            // Poza przerwą, po ustaleniu
+    double maxHoldoverMs;       // W przerwie
+    double maxOldMs;            // Jednorazowe ustawienie zegara
+    uint32_t uncovered;         // Próbki z błędem ponad 2 x podawana niepewność
+    uint32_t backwards;         // Cofnięcia UTC między kolejnymi próbkami
+    uint32_t samples;
+    double driftPpm;            // Korekta częstotliwości modelu na końcu
+    ClockDiscipline::Stats st;
+};
+
+static ClockDiscipline::Config firmwareConfig() {
+
+    ClockDiscipline::Config c;
+    c.windowS = TIMEBASE::WINDOW_S;
+    c.ppsWindowS = TIMEBASE::PPS_WINDOW_S;
+    c.minSpanS = TIMEBASE::MIN_SPAN_S;
+    c.maxPpm = TIMEBASE::MAX_PPM;
+    c.stepUs = TIMEBASE::STEP_MS * 1000;
+    c.holdoverMs = TIMEBASE::HOLDOVER_MS;
+    return c;
+}
+
+static Outcome run(const Scenario& sc, const Crystal& xtal, uint32_t minutes) {
+
+    ClockDiscipline clock(firmwareConfig());
+    Outcome out = {};
+
+    double endUs = minutes * 60e6;
+    double gapFrom = endUs * 0.5, gapTo = gapFrom + 10 * 60e6;     // 10 min bez odbioru
+    double settleUs = 3 * 60e6;                                     // Ustalanie modelu
+    double periodUs = sc.rateMs * 1000.0;
+    double refUs = ceil((2e6 + uniform() * 1e6) / periodUs) * periodUs;    // Pierwsza epoka po starcie
+    int64_t oldOffsetUs = 0;                                        // Jednorazowe ustawienie: UTC - mono
+    bool oldSet = false;
+    int64_t prevUtc = INT64_MIN;
+
+    if (sc.systemSeed)
+        clock.addReference(xtal.mono(0), UTC0_US + 1500000, TIMEBASE::SYSTEM_ACC_MS * 1000,
+                           ClockDiscipline::SOURCE_SYSTEM);
+
+    for (double t = 0; t < endUs; t += 100000) {
+
+        // Odniesienia do chwili t
+        for (; refUs <= t; refUs += periodUs) {
+            if (refUs >= gapFrom && refUs < gapTo) continue;
+            int64_t utc = UTC0_US + (int64_t)llround(refUs);
+
+            if (sc.source == ClockDiscipline::SOURCE_PPS) {
+                if (fmod(refUs, 1e6) > 1.0) continue;
+                int64_t mono = xtal.mono(refUs + 5.0 + uniform() * 30.0);
+                clock.addReference(mono, utc, TIMEBASE::PPS_ACC_US, ClockDiscipline::SOURCE_PPS);
+            } else {
+                double lag = sc.latencyBiasMs + (uniform() * 2.0 - 1.0) * sc.jitterMs;
+                double at = refUs + lag * 1000.0;
+                if (uniform() * 100.0 < sc.wrongEpochPct) at += periodUs;
+                int64_t mono = xtal.mono(at);
+                clock.addReference(mono, utc, TIMEBASE::NMEA_ACC_MS * 1000, ClockDiscipline::SOURCE_NMEA);
+            }
+            if (!oldSet) {
+                oldOffsetUs = utc - xtal.mono(refUs);
+                oldSet = true;
+            }
+        }
+
+        const ClockDiscipline::Model& m = clock.model();
+        if (m.source == ClockDiscipline::SOURCE_NONE) continue;
+
+        int64_t mono = xtal.mono(t);
+        int64_t utc = m.utcAt(mono);
+        double errUs = (double)(utc - (UTC0_US + (int64_t)llround(t)));
+        if (prevUtc != INT64_MIN && utc < prevUtc) out.backwards++;
+        prevUtc = utc;
+
+        if (t < settleUs) continue;
+        out.samples++;
+        double errMs = fabs(errUs) / 1000.0;
+        bool inGap = t >= gapFrom && t < gapTo + periodUs;      // Do pierwszego odniesienia po przerwie
+        if (inGap) {
+            if (errMs > out.maxHoldoverMs) out.maxHoldoverMs = errMs;
+        } else if (errMs > out.maxErrMs) {
+            out.maxErrMs = errMs;
+        }
+        // Niepewność (~1 sigma) bez błędu stałego opóźnienia NMEA (nieznany z samego NMEA)
+        if (fabs(errUs) - sc.latencyBiasMs * 1000.0 > 2.0 * m.accuracyAt(mono)) out.uncovered++;
+
+        double oldMs = fabs((double)(mono + oldOffsetUs - (UTC0_US + (int64_t)llround(t)))) / 1000.0;
+        if (oldMs > out.maxOldMs) out.maxOldMs = oldMs;
+    }
+
+    out.driftPpm = clock.model().ppb / 1000.0;
+    out.st = clock.stats();
+    return out;
+}
+
+// =============================================================================
+// KOSZT
+// =============================================================================
+
+static void measureCost(const Crystal& xtal) {
+
+    using Clock = std::chrono::steady_clock;
+    constexpr int N = 200000;
+
+    ClockDiscipline clock(firmwareConfig());
+    auto t0 = Clock::now();
+    for (int i = 0; i < N; i++) {
+        double t = i * 200000.0;
+        clock.addReference(xtal.mono(t), UTC0_US + (int64_t)t, TIMEBASE::NMEA_ACC_MS * 1000,
+                           ClockDiscipline::SOURCE_NMEA);
+    }
+    double refNs = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / N;
+
+    ClockDiscipline::Model m = clock.model();
+    volatile int64_t sink = 0;
+    int64_t base = m.monoUs;
+    t0 = Clock::now();
+    for (int i = 0; i < N * 10; i++)
+        sink = sink + m.utcAt(base + i * 1000);
+    double convNs = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / (N * 10);
+
+    printf("[time] cost: %.0f ns per reference (incl. crystal model), %.1f ns per conversion\n", refNs, convNs);
+}
+
+int main(int argc, char** argv) {
+
+    uint32_t minutes = 60;
+    Crystal xtal = { 35.0, 3.0, 1800.0 };
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--minutes") && i + 1 < argc) minutes = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--drift") && i + 1 < argc) xtal.ppm = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) rng = (uint32_t)atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: timebase_bench [--minutes n] [--drift ppm] [--seed n]\n");
+            return 2;
+        }
+    }
+    if (minutes < 30) minutes = 30;
+
+    printf("[time] %lu min, crystal %+.1f ppm +/- %.1f ppm (period %.0f s), 10 min reception gap mid-run\n",
+        (unsigned long)minutes, xtal.ppm, xtal.wanderPpm, xtal.periodS);
+
+    int failures = 0;
+    for (const Scenario& sc : SCENARIOS) {
+
+        Outcome o = run(sc, xtal, minutes);
+        bool ok = o.maxErrMs <= sc.maxErrMs && o.maxHoldoverMs <= sc.maxHoldoverMs && o.uncovered == 0;
+        if (!ok) failures++;
+
+        printf("[time] %-9s err %7.3f ms, holdover %7.3f ms (set-once clock %6.1f ms), correction %+6.2f ppm, "
+               "%lu refs, %lu ignored, %lu rejected, %lu steps, uncovered %lu/%lu, backwards %lu%s\n",
+            sc.name, o.maxErrMs, o.maxHoldoverMs, o.maxOldMs, o.driftPpm,
+            (unsigned long)o.st.references, (unsigned long)o.st.ignored, (unsigned long)o.st.rejected,
+            (unsigned long)o.st.steps, (unsigned long)o.uncovered, (unsigned long)o.samples,
+            (unsigned long)o.backwards, ok ? "" : "  <-- FAIL");
+    }
+
+    measureCost(xtal);
+    printf("[time] %s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
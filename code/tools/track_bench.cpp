@@ -0,0 +1,413 @@
+/**
+ * @file track_bench.cpp
+ * @brief Narzędzie hosta - kompresja i błąd upraszczania śladu GPS (TrackSimplifier)
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Tryb trasy - folder trasy z karty SD (gps_log.csv; logi binarne najpierw
+ * przez trip_log_to_csv) albo sam plik gps_log.csv:
+ * ```
+ * Timestamp,Latitude,Longitude,Satellites,HDOP,Valid[,UtcMs,TimeSource]
+ * ```
+ * Tryb syntetyczny (bez argumentu) - zmiana taksówki: 40 min na postoju,
+ * jazda miejska ze światłami, prosta drogą szybkiego ruchu z tunelem, znów
+ * miasto i postój; fixy co 1 s z błądzeniem pozycji (Gauss-Markow), szumem
+ * białym i skokami wielodrogowymi.
+ *
+ * Dla kilku tolerancji (w tym SDCARD::TRACK_TOLERANCE_MM) wypisywane są:
+ * liczba zachowanych punktów i stopień kompresji, rozmiar gps_log.csv
+ * i gps_log.bin przed i po, największy i średni błąd odtworzenia (pozycja
+ * interpolowana z zachowanych punktów w chwili każdego punktu wejściowego,
+ * haversine) oraz koszt add() na punkt. Sprawdzane są punkty obowiązkowe:
+ * pierwszy i ostatni, zmiany ważności fixu i odstęp SDCARD::TRACK_MAX_GAP_MS.
+ * --emit zapisuje ślad uproszczony z tolerancją SDCARD::TRACK_TOLERANCE_MM.
+ *
+ * Kompilacja (z katalogu code/):
+ * ```
+ * g++ -std=c++17 -O2 -Iinclude tools/track_bench.cpp src/track_simplifier.cpp src/trip_log_format.cpp -o track_bench
+ * ```
+ *
+ * Użycie:
+ * ```
+ * track_bench [folder_trasy | gps_log.csv] [--seed n] [--emit gps_log.csv]
+ * ```
+ * Kod wyjścia 1 oznacza błąd odtworzenia ponad tolerancję lub brak punktu
+ * obowiązkowego.
+ */
+
+#include "track_simplifier.h"
+#include "trip_log_format.h"
+#include "../cabulator_settings.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+static const double EARTH_R = 6371008.8;
+
+static uint32_t rng = 12345;
+static uint32_t random32() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+static double uniform() {
+    return (random32() >> 8) / 16777216.0;
+}
+
+static double gauss() {
+    double u = uniform() + 1e-12, v = uniform();
+    return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+static double haversineM(double lat1, double lng1, double lat2, double lng2) {
+
+    double p1 = lat1 * M_PI / 180, p2 = lat2 * M_PI / 180;
+    double dp = p2 - p1, dl = (lng2 - lng1) * M_PI / 180;
+    double a = sin(dp / 2) * sin(dp / 2) + cos(p1) * cos(p2) * sin(dl / 2) * sin(dl / 2);
+    return 2 * EARTH_R * asin(sqrt(a));
+}
+
+struct Fix {
+    uint32_t tMs;
+    bool valid;
+    int32_t latE7, lngE7;
+    uint16_t hdop;
+    uint8_t sats;
+    char phase;             // Tryb syntetyczny: P postój, C miasto, H droga szybkiego ruchu
+};
+
+// Wiersz gps_log.csv w układzie firmware (trip_logger.cpp)
+static int csvRow(char* out, size_t len, const Fix& f) {
+    return snprintf(out, len, "%u,%.6f,%.6f,%u,%u,%d,%llu,%s\n", f.tMs, f.latE7 / 1e7, f.lngE7 / 1e7,
+                    (unsigned)f.sats, (unsigned)f.hdop, f.valid ? 1 : 0,
+                    1760000000000ULL + f.tMs, "nmea");
+}
+
+static size_t csvBytes(const std::vector<Fix>& fixes) {
+
+    char row[160];
+    size_t total = 0;
+    for (const Fix& f : fixes) total += (size_t)csvRow(row, sizeof(row), f);
+    return total;
+}
+
+static size_t binBytes(const std::vector<Fix>& fixes) {
+
+    TripLogFormat::BlockEncoder enc(TripLogFormat::STREAM_GPS);
+    uint8_t block[TripLogFormat::BLOCK_MAX];
+    size_t total = TripLogFormat::FILE_HEADER_SIZE;
+    for (const Fix& f : fixes) {
+        TripLogFormat::GpsSample s = {};
+        s.timestampMs = f.tMs;
+        s.lat = f.latE7;
+        s.lng = f.lngE7;
+        s.sats = f.sats;
+        s.hdop = f.hdop;
+        s.valid = f.valid;
+        s.utcMs = 1760000000000ULL + f.tMs;
+        s.timeSource = 3;
+        if (!enc.add(s)) {
+            total += enc.finish(block);
+            enc.add(s);
+        }
+    }
+    return total + enc.finish(block);
+}
+
+// =============================================================================
+// UPRASZCZANIE I OCENA
+// =============================================================================
+
+struct Result {
+    std::vector<size_t> kept;       // Indeksy zachowanych punktów
+    TrackSimplifier::Stats stats;
+    double nsPerPoint;
+    double maxErrM;
+    double meanErrM;
+    size_t maxErrAt;
+    int missing;                    // Brakujące punkty obowiązkowe
+};
+
+// Decyzje jak w trip_logger.cpp: wstrzymany poprzedni punkt, finish() na końcu
+static std::vector<size_t> simplify(const std::vector<Fix>& fixes, TrackSimplifier& ts) {
+
+    std::vector<size_t> kept;
+    ts.reset();
+    for (size_t i = 0; i < fixes.size(); i++) {
+        const Fix& f = fixes[i];
+        uint8_t keep = ts.add({ f.tMs, f.latE7, f.lngE7, f.valid });
+        if (keep & TrackSimplifier::KEEP_PREVIOUS) kept.push_back(i - 1);
+        if (keep & TrackSimplifier::KEEP_CURRENT) kept.push_back(i);
+    }
+    if (ts.finish()) kept.push_back(fixes.size() - 1);
+    return kept;
+}
+
+static Result run(const std::vector<Fix>& fixes, uint32_t toleranceMm) {
+
+    TrackSimplifier::Config c;
+    c.toleranceMm = toleranceMm;
+    c.maxGapMs = SDCARD::TRACK_MAX_GAP_MS;
+    TrackSimplifier ts(c);
+
+    Result r = {};
+    r.kept = simplify(fixes, ts);
+    r.stats = ts.stats();
+
+    // Koszt add() - kilka przebiegów
+    const int REPEAT = 20;
+    auto t0 = std::chrono::steady_clock::now();
+    size_t sink = 0;
+    for (int k = 0; k < REPEAT; k++) sink += simplify(fixes, ts).size();
+    auto t1 = std::chrono::steady_clock::now();
+    r.nsPerPoint = std::chrono::duration<double, std::nano>(t1 - t0).count() / (REPEAT * fixes.size()) + (sink == 0);
+
+    // Błąd odtworzenia: interpolacja między sąsiednimi zachowanymi punktami w chwili punktu
+    double sum = 0;
+    size_t n = 0;
+    size_t k = 0;
+    for (size_t i = 0; i < fixes.size(); i++) {
+        while (k + 1 < r.kept.size() && r.kept[k + 1] <= i) k++;
+        const Fix& f = fixes[i];
+        if (!f.valid || k + 1 >= r.kept.size() || r.kept[k] == i) continue;
+        const Fix& a = fixes[r.kept[k]];
+        const Fix& b = fixes[r.kept[k + 1]];
+        if (!a.valid || !b.valid) continue;
+        double u = b.tMs == a.tMs ? 0 : (double)(f.tMs - a.tMs) / (double)(b.tMs - a.tMs);
+        double lat = (a.latE7 + u * (double)(b.latE7 - a.latE7)) / 1e7;
+        double lng = (a.lngE7 + u * (double)(b.lngE7 - a.lngE7)) / 1e7;
+        double e = haversineM(lat, lng, f.latE7 / 1e7, f.lngE7 / 1e7);
+        sum += e;
+        n++;
+        if (e > r.maxErrM) {
+            r.maxErrM = e;
+            r.maxErrAt = i;
+        }
+    }
+    r.meanErrM = n ? sum / n : 0;
+
+    // Punkty obowiązkowe
+    std::vector<bool> isKept(fixes.size(), false);
+    for (size_t i : r.kept) isKept[i] = true;
+    if (!isKept.front()) r.missing++;
+    if (!isKept.back()) r.missing++;
+    for (size_t i = 1; i < fixes.size(); i++)
+        if (fixes[i].valid != fixes[i - 1].valid && (!isKept[i] || !isKept[i - 1])) r.missing++;
+    for (size_t j = 1; j < r.kept.size(); j++) {
+        const Fix& a = fixes[r.kept[j - 1]];
+        const Fix& b = fixes[r.kept[j]];
+        bool sampleGap = r.kept[j] == r.kept[j - 1] + 1;
+        if (!sampleGap && b.tMs - a.tMs > (uint32_t)SDCARD::TRACK_MAX_GAP_MS) r.missing++;
+    }
+    return r;
+}
+
+// =============================================================================
+// DANE WEJŚCIOWE
+// =============================================================================
+
+static bool readGpsCsv(const std::string& path, std::vector<Fix>& out) {
+
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f) {
+        fprintf(stderr, "%s: cannot open\n", path.c_str());
+        return false;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        // Format: Timestamp,Latitude,Longitude,Satellites,HDOP,Valid[,UtcMs,TimeSource]
+        unsigned long ts;
+        double lat, lng;
+        unsigned sats, hdop;
+        int valid;
+        if (sscanf(line, "%lu,%lf,%lf,%u,%u,%d", &ts, &lat, &lng, &sats, &hdop, &valid) != 6) continue;
+        Fix x = {};
+        x.tMs = (uint32_t)ts;
+        x.valid = valid != 0;
+        x.latE7 = (int32_t)llround(lat * 1e7);
+        x.lngE7 = (int32_t)llround(lng * 1e7);
+        x.hdop = (uint16_t)(hdop > 65535 ? 65535 : hdop);
+        x.sats = (uint8_t)(sats > 255 ? 255 : sats);
+        x.phase = '-';
+        out.push_back(x);
+    }
+    fclose(f);
+    return true;
+}
+
+// Zmiana: postój 40 min, miasto 25 min, droga szybkiego ruchu 15 min (tunel), miasto 20 min, postój 10 min
+static std::vector<Fix> synthetic() {
+
+    struct Leg { char phase; uint32_t seconds; };
+    static const Leg legs[] = { {'P', 2400}, {'C', 1500}, {'H', 900}, {'C', 1200}, {'P', 600} };
+
+    std::vector<Fix> fixes;
+    double lat = 52.2297, lng = 21.0122, heading = 30, v = 0;
+    double walkN = 0, walkE = 0;
+    int outlierLeft = 0;
+    double outN = 0, outE = 0;
+    uint32_t t = 0;
+
+    for (const Leg& leg : legs) {
+        for (uint32_t s = 0; s < leg.seconds; s++, t++) {
+
+            // Miasto: światła co 90 s (25 s postoju), skręty 90 stopni co ok. 3 min
+            double target = 0;
+            bool turn = false;
+            if (leg.phase == 'C') {
+                target = s % 90 < 65 ? 11 + 3 * sin(t / 17.0) : 0;
+                turn = s % 180 == 70;
+            } else if (leg.phase == 'H') {
+                target = 25;
+            }
+            if (turn) heading += random32() % 2 ? 90 : -90;
+            for (int k = 0; k < 100; k++) {
+                v += (target - v) * 0.003;
+                if (target == 0 && v < 0.3) v = 0;
+                heading += leg.phase == 'H' ? 0.0005 * sin(t / 300.0) : 0.0;
+                double d = v * 0.01;
+                lat += d * cos(heading * M_PI / 180) / EARTH_R * 180 / M_PI;
+                lng += d * sin(heading * M_PI / 180) / (EARTH_R * cos(lat * M_PI / 180)) * 180 / M_PI;
+            }
+
+            bool tunnel = leg.phase == 'H' && s >= 400 && s < 460;
+            uint16_t hdop = (uint16_t)(80 + random32() % 60);
+            uint8_t sats = (uint8_t)(8 + random32() % 5);
+
+            // Błąd pozycji: Gauss-Markow (tau 30 s, sigma 1.5 m x HDOP) + szum biały 0.5 m
+            double sigma = 1.5 * hdop / 100.0, a = exp(-1.0 / 30);
+            walkN = a * walkN + sqrt(1 - a * a) * sigma * gauss();
+            walkE = a * walkE + sqrt(1 - a * a) * sigma * gauss();
+            double errN = walkN + 0.5 * gauss(), errE = walkE + 0.5 * gauss();
+
+            // Wielodrogowość: skok 30-150 m przez 1-3 fixy, ok. 1 na 10 minut
+            if (outlierLeft == 0 && random32() % 600 == 0) {
+                outlierLeft = 1 + random32() % 3;
+                double mag = 30 + uniform() * 120, dir = uniform() * 2 * M_PI;
+                outN = mag * cos(dir);
+                outE = mag * sin(dir);
+            }
+            if (outlierLeft > 0) {
+                errN += outN;
+                errE += outE;
+                outlierLeft--;
+            }
+
+            Fix f = {};
+            f.tMs = 1000 * t + 120 + random32() % 40;
+            f.valid = !tunnel;
+            f.latE7 = (int32_t)llround((lat + errN / EARTH_R * 180 / M_PI) * 1e7);
+            f.lngE7 = (int32_t)llround((lng + errE / (EARTH_R * cos(lat * M_PI / 180)) * 180 / M_PI) * 1e7);
+            f.hdop = hdop;
+            f.sats = sats;
+            f.phase = leg.phase;
+            fixes.push_back(f);
+        }
+    }
+    return fixes;
+}
+
+static void emitCsv(const char* path, const std::vector<Fix>& fixes, const std::vector<size_t>& kept) {
+
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "%s: cannot open for writing\n", path);
+        return;
+    }
+    fprintf(f, "Timestamp,Latitude,Longitude,Satellites,HDOP,Valid\n");
+    for (size_t i : kept) {
+        const Fix& x = fixes[i];
+        fprintf(f, "%u,%.6f,%.6f,%u,%u,%d\n", x.tMs, x.latE7 / 1e7, x.lngE7 / 1e7,
+                (unsigned)x.sats, (unsigned)x.hdop, x.valid ? 1 : 0);
+    }
+    fclose(f);
+    printf("[track] %zu points written to %s\n", kept.size(), path);
+}
+
+int main(int argc, char** argv) {
+
+    const char* path = nullptr;
+    const char* emitPath = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            rng = (uint32_t)strtoul(argv[++i], nullptr, 0);
+            if (rng == 0) rng = 12345;          // xorshift nie wychodzi z zera
+        }
+        else if (!strcmp(argv[i], "--emit") && i + 1 < argc) emitPath = argv[++i];
+        else if (argv[i][0] != '-') path = argv[i];
+        else {
+            fprintf(stderr, "usage: track_bench [trip_folder | gps_log.csv] [--seed n] [--emit gps_log.csv]\n");
+            return 2;
+        }
+    }
+
+    std::vector<Fix> fixes;
+    if (path) {
+        struct stat sb;
+        std::string gpsPath = path;
+        if (stat(path, &sb) == 0 && S_ISDIR(sb.st_mode)) gpsPath += "/gps_log.csv";
+        if (!readGpsCsv(gpsPath, fixes)) return 2;
+        if (fixes.empty()) {
+            fprintf(stderr, "%s: no GPS records\n", gpsPath.c_str());
+            return 2;
+        }
+        printf("[track] %s: %zu points over %.1f min\n", gpsPath.c_str(), fixes.size(),
+               (fixes.back().tMs - fixes.front().tMs) / 60000.0);
+    } else {
+        fixes = synthetic();
+        printf("[track] synthetic shift: %zu points over %.1f min (rank 40 min, city, expressway with tunnel, city, rank 10 min)\n",
+               fixes.size(), (fixes.back().tMs - fixes.front().tMs) / 60000.0);
+    }
+
+    size_t csvIn = csvBytes(fixes), binIn = binBytes(fixes);
+    printf("[track] input: gps_log.csv %.1f kB, gps_log.bin %.1f kB; max gap %d s\n",
+           csvIn / 1024.0, binIn / 1024.0, SDCARD::TRACK_MAX_GAP_MS / 1000);
+
+    static const uint32_t tolerances[] = { 2000, 5000, (uint32_t)SDCARD::TRACK_TOLERANCE_MM, 20000, 50000 };
+    bool ok = true;
+    uint32_t prevTol = 0;
+    for (uint32_t tol : tolerances) {
+        if (tol == prevTol) continue;
+        prevTol = tol;
+
+        Result r = run(fixes, tol);
+        std::vector<Fix> out;
+        for (size_t i : r.kept) out.push_back(fixes[i]);
+        double ratio = (double)fixes.size() / r.kept.size();
+        bool pass = r.maxErrM <= tol / 1000.0 + 0.05 && r.missing == 0;
+        ok = ok && pass;
+
+        printf("[track] tol %5.1f m%s: kept %6zu (%5.1fx, %u forced, %u full windows), csv %7.1f kB, bin %6.1f kB, "
+               "err max %5.2f m mean %4.2f m, %5.1f ns/point%s\n",
+               tol / 1000.0, tol == (uint32_t)SDCARD::TRACK_TOLERANCE_MM ? "*" : " ", r.kept.size(), ratio,
+               r.stats.forced, r.stats.windowFull, csvBytes(out) / 1024.0, binBytes(out) / 1024.0,
+               r.maxErrM, r.meanErrM, r.nsPerPoint, pass ? "" : "  <-- FAILED");
+        if (r.missing) printf("[track]   %d mandatory points missing\n", r.missing);
+
+        if (tol == (uint32_t)SDCARD::TRACK_TOLERANCE_MM) {
+            if (!path) {
+                for (char phase : { 'P', 'C', 'H' }) {
+                    size_t in = 0, kept = 0;
+                    for (const Fix& f : fixes) in += f.phase == phase;
+                    for (size_t i : r.kept) kept += fixes[i].phase == phase;
+                    printf("[track]   %-10s %6zu -> %5zu points\n",
+                           phase == 'P' ? "rank" : phase == 'C' ? "city" : "expressway", in, kept);
+                }
+            }
+            if (emitPath) emitCsv(emitPath, fixes, r.kept);
+        }
+    }
+
+    printf("[track] %s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
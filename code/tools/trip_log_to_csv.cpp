@@ -0,0 +1,148 @@
+/**
+ * @file trip_log_to_csv.cpp
+ * @brief Narzędzie hosta - konwersja binarnych logów trasy do CSV
+ * @version 1.0
+ * @date 2025-01-20
+ *
+ * @details
+ * Odczytuje gps_log.bin i obd_log.bin z folderu trasy (format opisany
+ * w include/trip_log_format.h) i zapisuje gps_log.csv oraz obd_log.csv
+ * w tym samym układzie kolumn, który tworzy firmware w trybie CSV.
+ * Bloki z błędnym CRC są pomijane (z komunikatem na stderr). Pliki w wersji 1
+ * formatu (bez znacznika UTC) dają UtcMs = 0 i TimeSource = none.
+ *
+ * Kompilacja (z katalogu code/):
+ * ```
+ * g++ -std=c++17 -O2 -Iinclude tools/trip_log_to_csv.cpp src/trip_log_format.cpp -o trip_log_to_csv
+ * ```
+ *
+ * Użycie:
+ * ```
+ * trip_log_to_csv <folder_trasy> [folder_wyjściowy]
+ * ```
+ */
+
+#include "trip_log_format.h"
+#include "clock_discipline.h"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+using namespace TripLogFormat;
+
+// Wczytanie całego pliku do pamięci
+static bool readFile(const std::string& path, std::vector<uint8_t>& out) {
+
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+
+    uint8_t buf[4096];
+    size_t n;
+    out.clear();
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        out.insert(out.end(), buf, buf + n);
+    fclose(f);
+    return true;
+}
+
+// Konwersja jednego pliku .bin do .csv, zwraca liczbę rekordów lub -1
+static long convert(const std::string& inPath, const std::string& outPath) {
+
+    std::vector<uint8_t> data;
+    if (!readFile(inPath, data)) return -1;
+
+    StreamType type;
+    uint8_t version;
+    if (data.size() < FILE_HEADER_SIZE || !readFileHeader(data.data(), type, version)) {
+        fprintf(stderr, "%s: invalid file header\n", inPath.c_str());
+        return -1;
+    }
+
+    FILE* out = fopen(outPath.c_str(), "w");
+    if (!out) {
+        fprintf(stderr, "%s: cannot open for writing\n", outPath.c_str());
+        return -1;
+    }
+
+    if (type == STREAM_GPS)
+        fprintf(out, "Timestamp,Latitude,Longitude,Satellites,HDOP,Valid,UtcMs,TimeSource\n");
+    else
+        fprintf(out, "Timestamp,DistanceKm,FuelLiters,TotalCost,UtcMs,TimeSource\n");
+
+    long records = 0;
+    size_t pos = FILE_HEADER_SIZE;
+    while (pos + BLOCK_HEADER_SIZE <= data.size()) {
+
+        BlockHeader hdr;
+        if (!readBlockHeader(&data[pos], hdr) || pos + BLOCK_HEADER_SIZE + hdr.length > data.size()) {
+            // Resynchronizacja: szukanie kolejnego znacznika bloku
+            fprintf(stderr, "%s: corrupt block at offset %zu, resyncing\n", inPath.c_str(), pos);
+            pos++;
+            continue;
+        }
+
+        BlockReader reader;
+        if (!reader.begin(hdr, &data[pos + BLOCK_HEADER_SIZE], version)) {
+            fprintf(stderr, "%s: CRC mismatch in block at offset %zu, skipped\n", inPath.c_str(), pos);
+            pos += BLOCK_HEADER_SIZE + hdr.length;
+            continue;
+        }
+
+        if (type == STREAM_GPS) {
+            GpsSample s;
+            while (reader.next(s)) {
+                // Format: Timestamp,Latitude,Longitude,Satellites,HDOP,Valid,UtcMs,TimeSource
+                fprintf(out, "%u,%.6f,%.6f,%u,%u,%d,%llu,%s\n",
+                    s.timestampMs, s.lat / 1e7, s.lng / 1e7,
+                    (unsigned)s.sats, (unsigned)s.hdop, s.valid ? 1 : 0,
+                    (unsigned long long)s.utcMs, ClockDiscipline::sourceName(s.timeSource));
+                records++;
+            }
+        } else {
+            ObdSample s;
+            while (reader.next(s)) {
+                // Format: Timestamp,DistanceKm,FuelLiters,TotalCost,UtcMs,TimeSource
+                fprintf(out, "%u,%.3f,%.3f,%.2f,%llu,%s\n",
+                    s.timestampMs, s.distanceM / 1000.0, s.fuelMl / 1000.0, s.costGr / 100.0,
+                    (unsigned long long)s.utcMs, ClockDiscipline::sourceName(s.timeSource));
+                records++;
+            }
+        }
+        pos += BLOCK_HEADER_SIZE + hdr.length;
+    }
+
+    fclose(out);
+    return records;
+}
+
+int main(int argc, char** argv) {
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <trip_folder> [output_folder]\n", argv[0]);
+        return 2;
+    }
+
+    std::string in = argv[1];
+    std::string out = (argc >= 3) ? argv[2] : in;
+
+    int converted = 0;
+    const char* names[][2] = {
+        { "/gps_log.bin", "/gps_log.csv" },
+        { "/obd_log.bin", "/obd_log.csv" }
+    };
+
+    for (auto& n : names) {
+        long records = convert(in + n[0], out + n[1]);
+        if (records >= 0) {
+            printf("%s -> %s: %ld records\n", (in + n[0]).c_str(), (out + n[1]).c_str(), records);
+            converted++;
+        }
+    }
+
+    if (converted == 0) {
+        fprintf(stderr, "%s: no binary logs found\n", in.c_str());
+        return 1;
+    }
+    return 0;
+}